@@ -47,7 +47,22 @@ if (CMAKE_SYSTEM_NAME STREQUAL "Emscripten")
 
     set(CMAKE_EXECUTABLE_SUFFIX ".html")
     add_executable(${GLFM_APP_TARGET_NAME} ${GLFM_APP_SRC})
-    if (DEFINED GLFM_APP_ASSETS_DIR)
+    if (DEFINED GLFM_APP_ASSETS_DIR AND GLFM_EMSCRIPTEN_STREAM_ASSETS)
+        # Copy assets next to the html file, and write a manifest of each asset's size and hash.
+        # Assets are fetched on demand with glfmRequestAsset() and cached in IndexedDB by hash.
+        set(GLFM_APP_ASSETS_OUTPUT_DIR ${CMAKE_CURRENT_BINARY_DIR}/${GLFM_APP_TARGET_NAME}_assets)
+        file(COPY ${GLFM_APP_ASSETS} DESTINATION ${GLFM_APP_ASSETS_OUTPUT_DIR})
+        set(GLFM_APP_ASSETS_MANIFEST "")
+        foreach(GLFM_APP_ASSET ${GLFM_APP_ASSETS})
+            get_filename_component(GLFM_APP_ASSET_NAME ${GLFM_APP_ASSET} NAME)
+            file(SHA256 ${GLFM_APP_ASSET} GLFM_APP_ASSET_HASH)
+            file(SIZE ${GLFM_APP_ASSET} GLFM_APP_ASSET_SIZE)
+            string(APPEND GLFM_APP_ASSETS_MANIFEST "    \"${GLFM_APP_ASSET_NAME}\": { size: ${GLFM_APP_ASSET_SIZE}, hash: \"${GLFM_APP_ASSET_HASH}\" },\n")
+        endforeach()
+        file(WRITE ${CMAKE_CURRENT_BINARY_DIR}/${GLFM_APP_TARGET_NAME}_assets.js
+             "Module['glfmAssets'] = {\n  base: \"${GLFM_APP_TARGET_NAME}_assets/\",\n  files: {\n${GLFM_APP_ASSETS_MANIFEST}  }\n};\n")
+        set(GLFM_PRELOAD_FLAG "-sFORCE_FILESYSTEM --pre-js ${CMAKE_CURRENT_BINARY_DIR}/${GLFM_APP_TARGET_NAME}_assets.js")
+    elseif (DEFINED GLFM_APP_ASSETS_DIR)
         set(GLFM_PRELOAD_FLAG "--preload-file ${GLFM_APP_ASSETS_DIR}@")
     else()
         set(GLFM_PRELOAD_FLAG "")
@@ -184,6 +199,13 @@ elseif (CMAKE_SYSTEM_NAME STREQUAL "Darwin")
         "</dict>\n"
         "</plist>\n"
     )
+elseif (CMAKE_SYSTEM_NAME STREQUAL "Linux")
+    # Windowed app using the library's main(). Assets are read from the working directory, so
+    # copy them next to the executable and run it from there.
+    add_executable(${GLFM_APP_TARGET_NAME} ${GLFM_APP_SRC})
+    if (DEFINED GLFM_APP_ASSETS_DIR)
+        file(COPY ${GLFM_APP_ASSETS} DESTINATION ${CMAKE_CURRENT_BINARY_DIR})
+    endif()
 endif()
 
 set_target_properties(${GLFM_APP_TARGET_NAME} PROPERTIES C_STANDARD 11)
@@ -163,53 +163,17 @@ static void onSensor(GLFMDisplay *display, GLFMSensorEvent event) {
         CompassApp *app = glfmGetUserData(display);
         app->sensorDataReceived = true;
 
-        GLFMInterfaceOrientation orientation = glfmGetInterfaceOrientation(display);
-        switch (orientation) {
-            case GLFMInterfaceOrientationPortrait: default:
-                app->rotation.m00 = event.matrix.m00;
-                app->rotation.m01 = event.matrix.m01;
-                app->rotation.m02 = event.matrix.m02;
-                app->rotation.m10 = event.matrix.m10;
-                app->rotation.m11 = event.matrix.m11;
-                app->rotation.m12 = event.matrix.m12;
-                app->rotation.m20 = event.matrix.m20;
-                app->rotation.m21 = event.matrix.m21;
-                app->rotation.m22 = event.matrix.m22;
-                break;
-            case GLFMInterfaceOrientationLandscapeLeft: // Rotate Z 90 degrees
-                app->rotation.m00 = event.matrix.m10;
-                app->rotation.m01 = event.matrix.m11;
-                app->rotation.m02 = event.matrix.m12;
-                app->rotation.m10 = -event.matrix.m00;
-                app->rotation.m11 = -event.matrix.m01;
-                app->rotation.m12 = -event.matrix.m02;
-                app->rotation.m20 = event.matrix.m20;
-                app->rotation.m21 = event.matrix.m21;
-                app->rotation.m22 = event.matrix.m22;
-                break;
-            case GLFMInterfaceOrientationPortraitUpsideDown: // Rotate Z 180 degrees
-                app->rotation.m00 = -event.matrix.m00;
-                app->rotation.m01 = -event.matrix.m01;
-                app->rotation.m02 = -event.matrix.m02;
-                app->rotation.m10 = -event.matrix.m10;
-                app->rotation.m11 = -event.matrix.m11;
-                app->rotation.m12 = -event.matrix.m12;
-                app->rotation.m20 = event.matrix.m20;
-                app->rotation.m21 = event.matrix.m21;
-                app->rotation.m22 = event.matrix.m22;
-                break;
-            case GLFMInterfaceOrientationLandscapeRight: // Rotate Z -90 degrees
-                app->rotation.m00 = -event.matrix.m10;
-                app->rotation.m01 = -event.matrix.m11;
-                app->rotation.m02 = -event.matrix.m12;
-                app->rotation.m10 = event.matrix.m00;
-                app->rotation.m11 = event.matrix.m01;
-                app->rotation.m12 = event.matrix.m02;
-                app->rotation.m20 = event.matrix.m20;
-                app->rotation.m21 = event.matrix.m21;
-                app->rotation.m22 = event.matrix.m22;
-                break;
-        }
+        // The matrix is already remapped to the interface orientation.
+        // See glfmSetSensorRemappingEnabled() in glfmMain().
+        app->rotation.m00 = event.matrix.m00;
+        app->rotation.m01 = event.matrix.m01;
+        app->rotation.m02 = event.matrix.m02;
+        app->rotation.m10 = event.matrix.m10;
+        app->rotation.m11 = event.matrix.m11;
+        app->rotation.m12 = event.matrix.m12;
+        app->rotation.m20 = event.matrix.m20;
+        app->rotation.m21 = event.matrix.m21;
+        app->rotation.m22 = event.matrix.m22;
     }
 }
 
@@ -227,6 +191,9 @@ void glfmMain(GLFMDisplay *display) {
     glfmSetRenderFunc(display, onDraw);
     
     if (glfmIsSensorAvailable(display, GLFMSensorRotationMatrix)) {
+        // Receive sensor events relative to the interface orientation rather than the device's
+        // natural orientation.
+        glfmSetSensorRemappingEnabled(display, true);
         // Enable sensor for the device's rotation matrix. To disable, set the callback function to NULL.
         glfmSetSensorFunc(display, GLFMSensorRotationMatrix, onSensor);
     } else {
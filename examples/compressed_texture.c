@@ -0,0 +1,206 @@
+// Compressed texture example
+// Encodes a procedural texture on a job worker to the best format supported by the device, then
+// draws it zooming in and out so that all mipmap levels are visible.
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "glfm.h"
+
+#define TEXTURE_SIZE 1024
+
+static GLint program = 0;
+static GLuint vertexBuffer = 0;
+static GLuint vertexArray = 0;
+static GLuint texture = 0;
+static GLint scaleLocation = -1;
+
+static uint8_t *image = NULL;
+static GLFMTextureJob *job = NULL;
+static GLFMTexture compressedTexture = { 0 };
+static bool hasCompressedTexture = false;
+
+static void onDraw(GLFMDisplay *display);
+static void onSurfaceCreated(GLFMDisplay *display, int width, int height);
+static void onSurfaceDestroyed(GLFMDisplay *display);
+
+void glfmMain(GLFMDisplay *display) {
+    glfmSetDisplayConfig(display,
+                         GLFMRenderingAPIOpenGLES3,
+                         GLFMColorFormatRGBA8888,
+                         GLFMDepthFormatNone,
+                         GLFMStencilFormatNone,
+                         GLFMMultisampleNone);
+    glfmSetRenderFunc(display, onDraw);
+    glfmSetSurfaceCreatedFunc(display, onSurfaceCreated);
+    glfmSetSurfaceDestroyedFunc(display, onSurfaceDestroyed);
+}
+
+static uint8_t *createImage(int size) {
+    uint8_t *data = malloc((size_t)size * (size_t)size * 4);
+    if (!data) {
+        return NULL;
+    }
+    uint8_t *p = data;
+    for (int y = 0; y < size; y++) {
+        for (int x = 0; x < size; x++) {
+            const float u = (float)x / (float)size;
+            const float v = (float)y / (float)size;
+            const float dx = u - 0.5f;
+            const float dy = v - 0.5f;
+            const float rings = 0.5f + 0.5f * sinf(sqrtf(dx * dx + dy * dy) * 120.0f);
+            const bool checker = ((x / 64) + (y / 64)) & 1;
+            *p++ = (uint8_t)(255.0f * u);
+            *p++ = (uint8_t)(255.0f * rings);
+            *p++ = (uint8_t)(checker ? 255.0f * v : 64.0f);
+            *p++ = 255;
+        }
+    }
+    return data;
+}
+
+static void onSurfaceCreated(GLFMDisplay *display, int width, int height) {
+    (void)width;
+    (void)height;
+    if (hasCompressedTexture || job) {
+        return;
+    }
+    // The compressed texture is kept so that it can be uploaded again, without encoding again, if
+    // the surface is recreated.
+    const uint32_t formats = glfmGetSupportedTextureFormats(display);
+    const GLFMTextureFormat format = glfmGetPreferredTextureFormat(formats, false);
+    printf("Supported formats:");
+    for (int i = GLFMTextureFormatRGBA8; i <= GLFMTextureFormatASTC4x4; i++) {
+        if (formats & (1u << i)) {
+            printf(" %s", glfmGetTextureFormatName((GLFMTextureFormat)i));
+        }
+    }
+    printf("\nEncoding %ix%i texture to %s on %i job workers\n", TEXTURE_SIZE, TEXTURE_SIZE,
+           glfmGetTextureFormatName(format), glfmGetJobWorkerCount());
+    if (!image) {
+        image = createImage(TEXTURE_SIZE);
+    }
+    job = glfmEncodeTextureAsync(image, TEXTURE_SIZE, TEXTURE_SIZE, format, true);
+}
+
+static void onSurfaceDestroyed(GLFMDisplay *display) {
+    (void)display;
+    // When the surface is destroyed, all existing GL resources are no longer valid.
+    program = 0;
+    vertexBuffer = 0;
+    vertexArray = 0;
+    texture = 0;
+}
+
+static void finishJob(void) {
+    hasCompressedTexture = glfmFinishTextureJob(job, &compressedTexture);
+    job = NULL;
+    free(image);
+    image = NULL;
+    if (!hasCompressedTexture) {
+        printf("Encoding failed\n");
+        return;
+    }
+    const double mb = (double)compressedTexture.rgbaSize / (1024.0 * 1024.0);
+    printf("Encoded %i levels to %s in %.1f ms (%.1f MB/s)\n",
+           compressedTexture.levelCount, glfmGetTextureFormatName(compressedTexture.format),
+           compressedTexture.encodeTime * 1000.0, mb / compressedTexture.encodeTime);
+    printf("GPU memory: %.2f MB (RGBA8: %.2f MB, saved %.2f MB)\n",
+           (double)compressedTexture.dataSize / (1024.0 * 1024.0), mb,
+           (double)(compressedTexture.rgbaSize - compressedTexture.dataSize) / (1024.0 * 1024.0));
+}
+
+static GLuint compileShader(const GLenum type, const GLchar *shaderString, GLint shaderLength) {
+    GLuint shader = glCreateShader(type);
+    glShaderSource(shader, 1, &shaderString, &shaderLength);
+    glCompileShader(shader);
+    return shader;
+}
+
+static void onDraw(GLFMDisplay *display) {
+    if (job && glfmIsTextureJobComplete(job)) {
+        finishJob();
+    }
+    if (texture == 0 && hasCompressedTexture) {
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        if (!glfmUploadTexture(&compressedTexture)) {
+            printf("Upload failed\n");
+        }
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    }
+    if (program == 0) {
+        const GLchar vertexShader[] =
+            "#version 100\n"
+            "attribute highp vec2 position;\n"
+            "uniform highp vec2 scale;\n"
+            "varying mediump vec2 texCoord;\n"
+            "void main() {\n"
+            "   texCoord = position * 0.5 + 0.5;\n"
+            "   gl_Position = vec4(position * scale, 0.0, 1.0);\n"
+            "}";
+
+        const GLchar fragmentShader[] =
+            "#version 100\n"
+            "varying mediump vec2 texCoord;\n"
+            "uniform lowp sampler2D texture0;\n"
+            "void main() {\n"
+            "  gl_FragColor = texture2D(texture0, texCoord);\n"
+            "}";
+
+        program = glCreateProgram();
+        GLuint vertShader = compileShader(GL_VERTEX_SHADER, vertexShader, sizeof(vertexShader) - 1);
+        GLuint fragShader = compileShader(GL_FRAGMENT_SHADER, fragmentShader, sizeof(fragmentShader) - 1);
+
+        glAttachShader(program, vertShader);
+        glAttachShader(program, fragShader);
+
+        glBindAttribLocation(program, 0, "position");
+        glLinkProgram(program);
+
+        glDeleteShader(vertShader);
+        glDeleteShader(fragShader);
+
+        scaleLocation = glGetUniformLocation(program, "scale");
+    }
+    if (vertexBuffer == 0) {
+        const GLfloat vertices[] = {
+            -1.0, -1.0,
+             1.0, -1.0,
+            -1.0,  1.0,
+             1.0,  1.0,
+        };
+        glGenBuffers(1, &vertexBuffer);
+        glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+    }
+
+    int width, height;
+    glfmGetDisplaySize(display, &width, &height);
+    glViewport(0, 0, width, height);
+    glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+
+    if (texture != 0) {
+#if defined(GL_VERSION_3_0) && GL_VERSION_3_0
+        if (vertexArray == 0) {
+            glGenVertexArrays(1, &vertexArray);
+        }
+        glBindVertexArray(vertexArray);
+#endif
+        // Zoom from 1/16 size to 4x size, so that each mipmap level is used
+        const float zoom = powf(2.0f, 3.0f * sinf((float)glfmGetTime() * 0.5f) - 1.0f);
+        const float aspect = (float)height / (float)(width > 0 ? width : 1);
+        glUseProgram(program);
+        glUniform2f(scaleLocation, zoom * (aspect < 1.0f ? aspect : 1.0f),
+                    zoom * (aspect < 1.0f ? 1.0f : 1.0f / aspect));
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, 0);
+        glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    }
+
+    glfmSwapBuffers(display);
+}
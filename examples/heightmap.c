@@ -165,6 +165,24 @@ static void heightmapGenerate(HeightmapApp *app) {
     heightmapGenerateDiamondSquare(app, MAX_HEIGHT / 2, MAP_SIDE_TILE_COUNT);
 }
 
+static void heightmapGenerateVertexRows(void *userData, int start, int end) {
+    HeightmapApp *app = userData;
+    for (size_t z = (size_t)start; z < (size_t)end; z++) {
+        size_t i = z * MAP_SIDE_VERTEX_COUNT * MAP_VERTEX_STRIDE;
+        for (size_t x = 0; x < MAP_SIDE_VERTEX_COUNT; x++) {
+            float y = app->heightmap[x][z];
+            float color = app->triangleMode ? (y + MAX_HEIGHT) / (2.0f * MAX_HEIGHT) : 1.0f;
+            app->vertices[i + 0] = 2.0f * (float)x / (float)MAP_SIDE_TILE_COUNT - 1.0f;
+            app->vertices[i + 1] = y;
+            app->vertices[i + 2] = 2.0f * (float)z / (float)MAP_SIDE_TILE_COUNT - 1.0f;
+            app->vertices[i + 3] = color;
+            app->vertices[i + 4] = color;
+            app->vertices[i + 5] = color;
+            i += MAP_VERTEX_STRIDE;
+        }
+    }
+}
+
 static bool onTouch(GLFMDisplay *display, int touch, GLFMTouchPhase phase, double x, double y) {
     if (phase == GLFMTouchPhaseHover) {
         return false;
@@ -357,21 +375,8 @@ static void draw(HeightmapApp *app, int width, int height) {
         heightmapGenerate(app);
     }
     if (app->needsRegeneration || app->needsRenderModeChange || app->vertexBuffer == 0 || app->indexBuffer == 0) {
-        // Generate vertices
-        size_t i = 0;
-        for (size_t z = 0; z < MAP_SIDE_VERTEX_COUNT; z++) {
-            for (size_t x = 0; x < MAP_SIDE_VERTEX_COUNT; x++) {
-                float y = app->heightmap[x][z];
-                float color = app->triangleMode ? (y + MAX_HEIGHT) / (2.0f * MAX_HEIGHT) : 1.0f;
-                app->vertices[i + 0] = 2.0f * (float)x / (float)MAP_SIDE_TILE_COUNT - 1.0f;
-                app->vertices[i + 1] = y;
-                app->vertices[i + 2] = 2.0f * (float)z / (float)MAP_SIDE_TILE_COUNT - 1.0f;
-                app->vertices[i + 3] = color;
-                app->vertices[i + 4] = color;
-                app->vertices[i + 5] = color;
-                i += 6;
-            }
-        }
+        // Generate vertices. Rows are independent, so they are generated in parallel.
+        glfmParallelFor(MAP_SIDE_VERTEX_COUNT, 0, heightmapGenerateVertexRows, app);
         if (app->vertexBuffer == 0) {
             glGenBuffers(1, &app->vertexBuffer);
         }
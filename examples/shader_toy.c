@@ -17,6 +17,7 @@ typedef struct {
     double startTime;
     double pausedTime;
     int resolution[2];
+    int assetsAvailable;
 } ShaderToyApp;
 
 static GLuint compileShader(GLFMDisplay *display, GLenum type, const char *shaderName) {
@@ -72,9 +73,9 @@ static GLuint compileShader(GLFMDisplay *display, GLenum type, const char *shade
     return shader;
 }
 
-static void onSurfaceCreated(GLFMDisplay *display, int width, int height) {
+static void createProgram(GLFMDisplay *display) {
     ShaderToyApp *app = glfmGetUserData(display);
-    
+
     GLuint vertShader = compileShader(display, GL_VERTEX_SHADER, "shader_toy.vert");
     GLuint fragShader = compileShader(display, GL_FRAGMENT_SHADER, "shader_toy.frag");
     if (vertShader != 0 && fragShader != 0) {
@@ -93,6 +94,10 @@ static void onSurfaceCreated(GLFMDisplay *display, int width, int height) {
         app->uniformTime = glGetUniformLocation(app->program, "iTime");
         app->uniformResolution = glGetUniformLocation(app->program, "iResolution");
     }
+}
+
+static void onSurfaceCreated(GLFMDisplay *display, int width, int height) {
+    ShaderToyApp *app = glfmGetUserData(display);
     
     glGenBuffers(1, &app->vertexBuffer);
     
@@ -122,6 +127,15 @@ static void onFocus(GLFMDisplay *display, bool focused) {
     }
 }
 
+static void onAsset(GLFMDisplay *display, const char *path, bool available) {
+    ShaderToyApp *app = glfmGetUserData(display);
+    if (available) {
+        app->assetsAvailable++;
+    } else {
+        printf("Couldn't load asset: %s\n", path);
+    }
+}
+
 static void onDraw(GLFMDisplay *display) {
     ShaderToyApp *app = glfmGetUserData(display);
     
@@ -133,6 +147,15 @@ static void onDraw(GLFMDisplay *display) {
     glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
     glClear(GL_COLOR_BUFFER_BIT);
 
+    // Create the program once the shaders are available (they may be streamed on the web)
+    if (app->program == 0 && app->assetsAvailable == 2) {
+        createProgram(display);
+    }
+    if (app->program == 0) {
+        glfmSwapBuffers(display);
+        return;
+    }
+
     // Set iTime
     glUseProgram(app->program);
     if (app->uniformTime >= 0) {
@@ -191,4 +214,6 @@ void glfmMain(GLFMDisplay *display) {
     glfmSetSurfaceDestroyedFunc(display, onSurfaceDestroyed);
     glfmSetAppFocusFunc(display, onFocus);
     glfmSetRenderFunc(display, onDraw);
+    glfmRequestAsset(display, "shader_toy.vert", onAsset);
+    glfmRequestAsset(display, "shader_toy.frag", onAsset);
 }
@@ -15,6 +15,9 @@ typedef struct {
 
 #define impl_of(this_renderer) ((RendererGLES2 *)(void *)((uint8_t *)this_renderer - offsetof(RendererGLES2, renderer)))
 
+// Uploaded uncompressed, not with glfmEncodeTexture(): the test pattern checks that each texel
+// lands on one screen pixel, and its blocks where borders meet the 1-pixel checkerboard have more
+// colors than the block formats keep exactly. It is also recreated at the display size on resize.
 static Texture textureUpload(Renderer *renderer, uint32_t width, uint32_t height, uint8_t *data) {
     GLuint textureId = 0;
     glGenTextures(1, &textureId);
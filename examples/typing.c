@@ -650,10 +650,18 @@ static void onSurfaceCreatedOrResized(GLFMDisplay *display, int width, int heigh
             memset(textureData + offset, 0, (FONT_CHAR_WIDTH + TEXTURE_SPACING) * bpp);
         }
 
+        // Every block of the atlas has at most two colors (premultiplied white and transparent),
+        // which each compressed format encodes exactly.
+        uint32_t formats = glfmGetSupportedTextureFormats(display);
+        GLFMTexture texture;
         glGenTextures(1, &app->texture);
         glBindTexture(GL_TEXTURE_2D, app->texture);
-        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, textureWidth, textureHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, textureData);
+        if (!glfmEncodeTexture(textureData, textureWidth, textureHeight,
+                               glfmGetPreferredTextureFormat(formats, true), false, &texture) ||
+            !glfmUploadTexture(&texture)) {
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, textureWidth, textureHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, textureData);
+        }
+        glfmFreeTexture(&texture);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
@@ -6,7 +6,7 @@
 #ifndef GLFM_H
 #define GLFM_H
 
-#if !defined(__APPLE__) && !defined(__ANDROID__) && !defined(__EMSCRIPTEN__)
+#if !defined(__APPLE__) && !defined(__ANDROID__) && !defined(__EMSCRIPTEN__) && !defined(__linux__)
 #  error Unsupported platform
 #endif
 
@@ -71,7 +71,21 @@
 #  define GLFM_DEPRECATED(message)
 #endif
 
+// GCC warns when a deprecated type is used in the declaration of a deprecated function
+#if defined(__GNUC__) && (__STDC_VERSION__ >= 199901L || __cplusplus >= 201103L)
+#  define GLFM_IGNORE_DEPRECATIONS_START \
+    _Pragma("GCC diagnostic push") \
+    _Pragma("GCC diagnostic ignored \"-Wdeprecated-declarations\"")
+#  define GLFM_IGNORE_DEPRECATIONS_END \
+    _Pragma("GCC diagnostic pop")
+#else
+#  define GLFM_IGNORE_DEPRECATIONS_START
+#  define GLFM_IGNORE_DEPRECATIONS_END
+#endif
+
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -85,6 +99,9 @@ typedef enum {
     GLFMRenderingAPIOpenGLES31,
     GLFMRenderingAPIOpenGLES32,
     GLFMRenderingAPIMetal,
+    /// *Experimental.* The swapchain has only been tested with software drivers, and the API may
+    /// change. See ``glfmAcquireVulkanFrame``.
+    GLFMRenderingAPIVulkan,
 } GLFMRenderingAPI;
 
 typedef enum {
@@ -114,6 +131,26 @@ typedef enum {
     GLFMSwapBehaviorBufferPreserved,
 } GLFMSwapBehavior;
 
+/// The trade-off between input-to-display latency and smooth presentation.
+/// See ``glfmSetLatencyMode``.
+typedef enum {
+    /// Presentation is synchronized to the display refresh, with the platform's default buffering.
+    GLFMLatencyModeBalanced,
+    /// Frames are presented as soon as possible, with as few queued frames as the platform allows.
+    /// Presentation may tear.
+    GLFMLatencyModeLowLatency,
+    /// Presentation is synchronized to the display refresh, and an extra frame may be queued so
+    /// that a slow frame doesn't miss a refresh. Adds up to one frame of latency.
+    GLFMLatencyModeThroughput,
+} GLFMLatencyMode;
+
+/// The GPU power preference used when creating a context. See ``GLFMWebContextConfig``.
+typedef enum {
+    GLFMPowerPreferenceDefault,
+    GLFMPowerPreferenceLowPower,
+    GLFMPowerPreferenceHighPerformance,
+} GLFMPowerPreference;
+
 /// Defines whether system UI chrome (status bar, navigation bar) is shown.
 typedef enum {
     /// Displays the app with the navigation bar.
@@ -377,6 +414,11 @@ typedef enum {
     /// Rotation sensor.
     /// In ``GLFMSensorFunc``, the `GLFMSensorEvent` matrix is the rotation matrix where the
     /// X axis points North and the Z axis is vertical.
+    ///
+    /// - Android: If the device doesn't have a rotation vector sensor, the rotation is computed
+    ///   from the accelerometer, gyroscope, and magnetometer.
+    /// - Emscripten: If the browser doesn't provide device orientation events, the rotation is
+    ///   computed from device motion events.
     GLFMSensorRotationMatrix,
 } GLFMSensor;
 
@@ -386,6 +428,27 @@ typedef enum {
     GLFMHapticFeedbackHeavy,
 } GLFMHapticFeedbackStyle;
 
+/// The priority of an idle task. See ``glfmScheduleIdleTask``.
+typedef enum {
+    GLFMIdleTaskPriorityLow,
+    GLFMIdleTaskPriorityNormal,
+    GLFMIdleTaskPriorityHigh,
+} GLFMIdleTaskPriority;
+
+/// The thermal state of the device. See ``glfmGetThermalState``.
+typedef enum {
+    /// The thermal state is unavailable.
+    GLFMThermalStateUnknown,
+    /// The device is within normal operating temperatures.
+    GLFMThermalStateNominal,
+    /// The device is warm. Performance is not yet reduced.
+    GLFMThermalStateFair,
+    /// The device is hot, and performance is reduced.
+    GLFMThermalStateSerious,
+    /// The device is very hot, and performance is significantly reduced.
+    GLFMThermalStateCritical,
+} GLFMThermalState;
+
 // MARK: - Structs and function pointers
 
 typedef struct GLFMDisplay GLFMDisplay;
@@ -440,6 +503,26 @@ typedef void (*GLFMCharFunc)(GLFMDisplay *display, const char *string, int modif
 ///             is no text in the clipboard, or if the text could not be converted to UTF-8.
 typedef void (*GLFMClipboardTextFunc)(GLFMDisplay *display, const char *string);
 
+/// Callback function when an asset is available. See ``glfmRequestAsset``.
+///
+/// - Parameters:
+///   - path: The path that was requested. The string is only valid during the callback.
+///   - available: `true` if the asset can be read with `fopen`, `false` otherwise.
+typedef void (*GLFMAssetFunc)(GLFMDisplay *display, const char *path, bool available);
+
+/// Callback function to perform deferred work in the time left after a frame.
+/// See ``glfmScheduleIdleTask``.
+///
+/// The task should do work in small steps, checking ``glfmGetTime`` between steps, and return
+/// before the deadline.
+///
+/// - Parameters:
+///   - deadline: The time, in the same timebase as ``glfmGetTime``, when the task should return
+///               so that the next frame isn't delayed. May be in the past, in which case the task
+///               should do the smallest useful step of work.
+/// - Returns: `true` if the task is complete, or `false` to continue in a later idle period.
+typedef bool (*GLFMIdleTaskFunc)(GLFMDisplay *display, void *userData, double deadline);
+
 /// Callback function when mouse wheel input events occur. See ``glfmSetMouseWheelFunc``.
 /// - Parameters:
 ///   - x: The x location of the event, in pixels.
@@ -449,6 +532,13 @@ typedef bool (*GLFMMouseWheelFunc)(GLFMDisplay *display, double x, double y,
                                    GLFMMouseWheelDeltaType deltaType,
                                    double deltaX, double deltaY, double deltaZ);
 
+/// Callback function with the relative mouse motion of a frame, while the pointer is locked.
+/// See ``glfmSetRelativeMouseFunc`` and ``glfmSetPointerLocked``.
+/// - Parameters:
+///   - deltaX: The horizontal motion since the previous frame. Positive values are to the right.
+///   - deltaY: The vertical motion since the previous frame. Positive values are down.
+typedef void (*GLFMRelativeMouseFunc)(GLFMDisplay *display, double deltaX, double deltaY);
+
 /// Callback function when the virtual keyboard visibility changes.
 /// See ``glfmSetKeyboardVisibilityChangedFunc``.
 typedef void (*GLFMKeyboardVisibilityChangedFunc)(GLFMDisplay *display, bool visible,
@@ -488,6 +578,15 @@ typedef void (*GLFMSurfaceDestroyedFunc)(GLFMDisplay *display);
 /// See ``glfmSetMemoryWarningFunc``.
 typedef void (*GLFMMemoryWarningFunc)(GLFMDisplay *display);
 
+/// Callback function when the recommended quality changes because of the device's thermal state.
+/// See ``glfmSetThermalRecommendationFunc``.
+///
+/// - Parameters:
+///   - maxFrameRate: The recommended maximum frame rate, in frames per second, or 0 for no limit.
+///   - renderScale: The recommended scale of the render resolution, from 0 to 1.
+typedef void (*GLFMThermalRecommendationFunc)(GLFMDisplay *display, int maxFrameRate,
+                                              double renderScale);
+
 /// Callback function when the app loses or gains focus. See ``glfmSetAppFocusFunc``.
 ///
 /// This function is called on startup after `glfmMain()`.
@@ -522,11 +621,152 @@ typedef struct {
 /// Callback function when sensor events occur. See ``glfmSetSensorFunc``.
 typedef void (*GLFMSensorFunc)(GLFMDisplay *display, GLFMSensorEvent event);
 
+/// The type of a ``GLFMEvent``.
+typedef enum {
+    GLFMEventTypeTouch = 1,
+    GLFMEventTypeKey,
+    GLFMEventTypeChar,
+    GLFMEventTypeMouseWheel,
+    GLFMEventTypeSensor,
+    GLFMEventTypeRelativeMouse,
+} GLFMEventType;
+
+/// The timing of a frame. See ``glfmGetPresentFeedback``.
+///
+/// Times are in the ``glfmGetTime`` timebase.
+typedef struct {
+    /// The ID returned from ``glfmSwapBuffers``.
+    uint64_t frameId;
+    /// The time ``glfmSwapBuffers`` was called.
+    double swapTime;
+    /// The time the GPU finished rendering the frame.
+    double gpuCompleteTime;
+    /// The time the frame was latched for display.
+    double latchTime;
+    /// The time the frame was shown on the display.
+    double presentTime;
+    /// Whether the times were measured by the platform. Otherwise, they are estimated.
+    bool measured;
+    /// Whether some times are not known yet, and are estimated. Query again in a later frame.
+    bool pending;
+} GLFMPresentFeedback;
+
+/// The state of a touch in a ``GLFMInputSnapshot``.
+typedef struct {
+    /// Whether the touch is down, from `GLFMTouchPhaseBegan` until `GLFMTouchPhaseEnded` or
+    /// `GLFMTouchPhaseCancelled`.
+    bool active;
+    /// The phase of the most recent event.
+    GLFMTouchPhase phase;
+    /// The location of the most recent event, in pixels.
+    double x, y;
+    /// The velocity between the two most recent events, in pixels per second. Zero when the touch
+    /// begins.
+    double velocityX, velocityY;
+    /// The time of the most recent event, in the ``glfmGetTime`` timebase.
+    double timestamp;
+} GLFMTouchState;
+
+/// The input state at the start of a frame. See ``glfmGetInputSnapshot``.
+typedef struct {
+    /// A bitset of the keys that are down, indexed by ``GLFMKeyCode``. See ``glfmIsKeyDown``.
+    uint32_t keysDown[8];
+    /// The ``GLFMKeyModifier`` bitmask of the most recent key event.
+    int modifiers;
+    /// Touches, indexed by touch number. Touch numbers of 10 or more are not tracked. When
+    /// multitouch is disabled, only the first touch is used. For mouse input, the first touch is
+    /// the primary button, and its location is updated when hovering.
+    GLFMTouchState touches[10];
+    /// The most recent event of each sensor, indexed by ``GLFMSensor``. Sensors are enabled with
+    /// ``glfmSetSensorFunc``.
+    GLFMSensorEvent sensors[4];
+    /// Whether an event was received for each sensor.
+    bool sensorsValid[4];
+    /// The relative mouse motion since the previous frame, while the pointer is locked. See
+    /// ``GLFMRelativeMouseFunc``.
+    double mouseDeltaX, mouseDeltaY;
+} GLFMInputSnapshot;
+
+/// An input event. See ``glfmPollEvents``.
+///
+/// The fields of each event type match the parameters of its callback function.
+typedef struct {
+    GLFMEventType type;
+    /// The time the event occurred, in the ``glfmGetTime`` timebase. Where the platform doesn't
+    /// report event times, and for sensor and relative mouse events, the time it was queued.
+    double timestamp;
+    union {
+        /// For `GLFMEventTypeTouch`. See ``GLFMTouchFunc``.
+        struct {
+            int touch;
+            GLFMTouchPhase phase;
+            double x, y;
+        } touch;
+        /// For `GLFMEventTypeKey`. See ``GLFMKeyFunc``.
+        struct {
+            GLFMKeyCode keyCode;
+            GLFMKeyAction action;
+            int modifiers;
+        } key;
+        /// For `GLFMEventTypeChar`. A NULL-terminated UTF-8 string of one or more characters.
+        /// Longer strings are split into several events. See ``GLFMCharFunc``.
+        struct {
+            char string[16];
+        } character;
+        /// For `GLFMEventTypeMouseWheel`. See ``GLFMMouseWheelFunc``.
+        struct {
+            double x, y;
+            GLFMMouseWheelDeltaType deltaType;
+            double deltaX, deltaY, deltaZ;
+        } mouseWheel;
+        /// For `GLFMEventTypeSensor`. See ``GLFMSensorFunc``.
+        GLFMSensorEvent sensor;
+        /// For `GLFMEventTypeRelativeMouse`. At most one is queued per frame.
+        /// See ``GLFMRelativeMouseFunc``.
+        struct {
+            double deltaX, deltaY;
+        } relativeMouse;
+    };
+} GLFMEvent;
+
+/// Web context creation hints. See ``glfmSetWebContextConfig``.
+typedef struct {
+    /// Requests a "desynchronized" canvas, which may be presented without waiting for the
+    /// browser's compositor.
+    bool desynchronized;
+    /// Requests low-latency presentation, which is a desynchronized, opaque canvas without
+    /// multisampling. Useful for pen and drawing apps.
+    bool lowLatency;
+    /// The GPU power preference. `GLFMPowerPreferenceDefault` is treated as high performance.
+    GLFMPowerPreference powerPreference;
+    /// A NULL-terminated list of WebGL extension names to enable when the context is created,
+    /// or NULL. The list must remain valid until the surface is created.
+    const char *const *extensions;
+} GLFMWebContextConfig;
+
+/// The negotiated web context. See ``glfmGetWebContextInfo``.
+typedef struct {
+    /// Whether the browser created a desynchronized canvas.
+    bool desynchronized;
+    /// Whether the context is desynchronized and opaque, which is required for low-latency
+    /// presentation.
+    bool lowLatency;
+    /// The power preference the context was created with.
+    GLFMPowerPreference powerPreference;
+    /// The number of extensions in ``GLFMWebContextConfig`` that were enabled.
+    int enabledExtensionCount;
+    /// The number of extensions in ``GLFMWebContextConfig`` that were requested.
+    int requestedExtensionCount;
+} GLFMWebContextInfo;
+
 // MARK: - Functions
 
 /// Main entry point for a GLFM app.
 ///
 /// In this function, call ``glfmSetDisplayConfig`` and ``glfmSetRenderFunc``.
+///
+/// - Linux: Only used by windowed apps. Apps that define their own `main()` create headless
+///   displays with ``glfmCreateDisplay`` instead.
 extern void glfmMain(GLFMDisplay *display);
 
 /// Sets the requested display configuration.
@@ -537,6 +777,9 @@ extern void glfmMain(GLFMDisplay *display);
 /// used (OpenGL ES 2.0 if OpenGL ES 3.0 is not available, for example).
 /// Call ``glfmGetRenderingAPI`` in the ``GLFMSurfaceCreatedFunc`` to check which rendering API is
 /// used.
+///
+/// `GLFMRenderingAPIVulkan` is experimental, and is available on Android and Linux when the Vulkan
+/// loader is present. Otherwise, the newest available version of OpenGL ES is used. See ``glfmAcquireVulkanFrame``.
 void glfmSetDisplayConfig(GLFMDisplay *display,
                           GLFMRenderingAPI preferredAPI,
                           GLFMColorFormat colorFormat,
@@ -563,7 +806,14 @@ void *glfmGetUserData(const GLFMDisplay *display);
 ///
 /// - Apple platforms: When using the Metal rendering API, this function does nothing.
 /// Presenting the Metal drawable must happen in application code.
-void glfmSwapBuffers(GLFMDisplay *display);
+///
+/// - Android, Linux: When using the Vulkan rendering API, this function presents the image
+/// acquired with ``glfmAcquireVulkanFrame``.
+///
+/// - Returns: An ID for the frame, which can be passed to ``glfmGetPresentFeedback``.
+uint64_t glfmSwapBuffers(GLFMDisplay *display);
+
+GLFM_IGNORE_DEPRECATIONS_START
 
 /// *Deprecated:* Use ``glfmGetSupportedInterfaceOrientation``.
 GLFMUserInterfaceOrientation glfmGetUserInterfaceOrientation(GLFMDisplay *display)
@@ -574,6 +824,8 @@ void glfmSetUserInterfaceOrientation(GLFMDisplay *display,
                                      GLFMUserInterfaceOrientation supportedOrientations)
 GLFM_DEPRECATED("Replaced with glfmSetSupportedInterfaceOrientation");
 
+GLFM_IGNORE_DEPRECATIONS_END
+
 /// Returns the supported user interface orientations. Default is `GLFMInterfaceOrientationAll`.
 ///
 /// Actual support may be limited by the device or platform.
@@ -643,6 +895,53 @@ void glfmSetSwapBehavior(GLFMDisplay *display, GLFMSwapBehavior behavior);
 /// Returns the swap buffer behavior.
 GLFMSwapBehavior glfmGetSwapBehavior(const GLFMDisplay *display);
 
+/// Sets the latency mode. The default is `GLFMLatencyModeBalanced`.
+///
+/// The mode sets the default swap interval (see ``glfmSetSwapInterval``) and the number of frames
+/// that may be queued for presentation, which is included in ``glfmGetTargetPresentTime``.
+///
+/// - Android, Linux: Sets the EGL swap interval. The number of buffers is chosen by the system.
+/// - iOS, tvOS, macOS: With Metal, `GLFMLatencyModeLowLatency` limits the `CAMetalLayer` to two
+///   drawables. On macOS, it also disables display sync.
+/// - Emscripten: `GLFMLatencyModeLowLatency` requests a desynchronized canvas. In order to take
+///   effect, the mode should be set before the surface is created, preferably in the ``glfmMain``
+///   function.
+void glfmSetLatencyMode(GLFMDisplay *display, GLFMLatencyMode latencyMode);
+
+/// Gets the latency mode. See ``glfmSetLatencyMode``.
+GLFMLatencyMode glfmGetLatencyMode(const GLFMDisplay *display);
+
+/// Sets the minimum number of display refreshes between presented frames.
+///
+/// An interval of 0 presents frames without waiting for the display refresh, where supported. An
+/// interval of 2 or more reduces the frame rate. A negative interval restores the default for the
+/// latency mode, which is 0 for `GLFMLatencyModeLowLatency` and 1 otherwise.
+///
+/// - Android, Linux: Sets the EGL swap interval, which the driver clamps to the supported range.
+/// - iOS, tvOS: An interval of 0 is treated as 1.
+/// - macOS: With OpenGL, intervals of 2 or more are treated as 1.
+/// - Emscripten: Frames are rendered on every Nth `requestAnimationFrame` callback. An interval
+///   of 0 is treated as 1.
+void glfmSetSwapInterval(GLFMDisplay *display, int swapInterval);
+
+/// Gets the swap interval. See ``glfmSetSwapInterval``.
+int glfmGetSwapInterval(const GLFMDisplay *display);
+
+/// Sets hints for creating the WebGL context (Emscripten only).
+///
+/// In order to take effect, the hints should be set before the surface is created, preferably in
+/// the ``glfmMain`` function. The hints are negotiated with the browser, which may ignore them.
+/// Use ``glfmGetWebContextInfo`` to get the result.
+///
+/// If `config` is NULL, the default hints are used.
+void glfmSetWebContextConfig(GLFMDisplay *display, const GLFMWebContextConfig *config);
+
+/// Gets the result of negotiating the ``GLFMWebContextConfig`` with the browser.
+///
+/// - Returns: `true` if `info` was set, or `false` if the surface was not created or this is not
+///            a web platform.
+bool glfmGetWebContextInfo(const GLFMDisplay *display, GLFMWebContextInfo *info);
+
 /// Gets the address of the specified function.
 GLFMProc glfmGetProcAddress(const char *functionName);
 
@@ -666,7 +965,8 @@ bool glfmHasClipboardText(const GLFMDisplay *display);
 ///
 /// - Emscripten: On some browsers, this function can only be called in an event handler, like
 ///               ``GLFMTouchFunc`` or ``GLFMKeyFunc``. Currently, Firefox does not support reading
-///               from the clipboard.
+///               from the clipboard. When built with `GLFM_EMSCRIPTEN_OFFSCREEN_CANVAS`, the
+///               `clipboardTextFunc` callback is invoked with a NULL string.
 /// - tvOS: No clipboard API is available. The `clipboardTextFunc` callback is invoked with a NULL
 ///         string.
 void glfmRequestClipboardText(GLFMDisplay *display, GLFMClipboardTextFunc clipboardTextFunc);
@@ -685,6 +985,109 @@ bool glfmSetClipboardText(GLFMDisplay *display, const char *string);
 /// The time should not be considered related to wall-clock time.
 double glfmGetTime(void);
 
+/// Gets the time of the current frame, in seconds, in the same timebase as ``glfmGetTime``.
+///
+/// When called from the ``GLFMRenderFunc`` callback, this is the vsync-aligned time the frame
+/// began. It is the same value for every call during a frame, so it is more suitable for animation
+/// than ``glfmGetTime``. If no frame has been rendered yet, returns ``glfmGetTime``.
+///
+/// - iOS, tvOS: The `CADisplayLink` timestamp. On macOS, and when using Metal, the time the
+///              render callback was invoked.
+/// - Android: The `AChoreographer` vsync time on API 24 (64-bit) or API 29 and newer. On older
+///            versions, the time the render callback was invoked.
+/// - Emscripten: The `requestAnimationFrame` timestamp.
+double glfmGetFrameTime(const GLFMDisplay *display);
+
+/// Gets the estimated time, in seconds, that the current frame will be presented on the display,
+/// in the same timebase as ``glfmGetTime``.
+///
+/// With `GLFMLatencyModeThroughput`, one frame interval is added, since the frame may be queued
+/// behind the previous frame. See ``glfmSetLatencyMode``.
+///
+/// - iOS, tvOS: The `CADisplayLink` target timestamp.
+/// - Other platforms: Estimated from the frame time and the measured interval between frames.
+double glfmGetTargetPresentTime(const GLFMDisplay *display);
+
+/// Gets the timing of a frame passed to ``glfmSwapBuffers``. Feedback is kept for the 16 most
+/// recent frames.
+///
+/// Measured times may not be known until a few frames after the swap. Until then, they are
+/// estimated from the target present time, and `pending` is `true`.
+///
+/// - Android: Measured with `EGL_ANDROID_get_frame_timestamps`, where available.
+/// - Linux: Measured for headless displays with an output (see ``glfmSetOutputConfig``). The
+///   latch time is when the frame was read back, and the present time is when it was written.
+/// - Other platforms: Estimated.
+///
+/// - Parameters:
+///   - frameId: The ID returned from ``glfmSwapBuffers``.
+///   - feedback: The feedback for the frame.
+/// - Returns: `false` if the frame ID is not one of the most recent frames.
+bool glfmGetPresentFeedback(GLFMDisplay *display, uint64_t frameId, GLFMPresentFeedback *feedback);
+
+/// Gets the duration, in seconds, of the most recent period the app was inactive, measured from
+/// when ``GLFMAppFocusFunc`` was invoked with `focused` set to `false` until it was invoked with
+/// `focused` set to `true`.
+///
+/// Call this function from the ``GLFMAppFocusFunc`` callback, for example, to advance a
+/// simulation by the time spent in the background. Returns 0 if the app has not been inactive.
+///
+/// - Emscripten: The app is inactive while the page is hidden, unfocused, or frozen.
+double glfmGetSuspendDuration(const GLFMDisplay *display);
+
+/// Schedules a task to run on the render thread in the time left after a frame, before the next
+/// frame is expected to begin.
+///
+/// After each frame, tasks run, highest priority first, and then in the order they were
+/// scheduled, until the deadline (the predicted start of the next frame, less a 1 millisecond
+/// margin) is reached. A task that returns `false` continues first in the next idle period, ahead
+/// of tasks of the same priority. One task runs after every frame even if no time is left, so that
+/// tasks always make progress.
+///
+/// Tasks don't run while the app is inactive, and pending tasks are discarded when the display is
+/// destroyed.
+///
+/// - Linux: With a fixed frame rate (see ``GLFMOutputConfig``), frame times are simulated, but the
+///   deadline is still one frame interval after the frame started, in real time.
+///
+/// - Parameters:
+///   - func: The task.
+///   - userData: The parameter passed to the task.
+///   - priority: The priority.
+/// - Returns: `false` if too many tasks (64) are scheduled.
+bool glfmScheduleIdleTask(GLFMDisplay *display, GLFMIdleTaskFunc func, void *userData,
+                          GLFMIdleTaskPriority priority);
+
+/// Cancels scheduled idle tasks with the matching function and user data.
+/// See ``glfmScheduleIdleTask``.
+void glfmCancelIdleTask(GLFMDisplay *display, GLFMIdleTaskFunc func, void *userData);
+
+/// Gets the number of scheduled idle tasks. See ``glfmScheduleIdleTask``.
+int glfmGetIdleTaskCount(const GLFMDisplay *display);
+
+/// Sets the target work duration, in seconds, reported to the system's performance hint session.
+///
+/// The work duration of a frame is the time from the start of the render function to the call to
+/// ``glfmSwapBuffers``. The system uses the target and the reported durations to adjust CPU clocks
+/// for the render thread and the job worker threads (see ``glfmRunJob``), so that frames complete
+/// in time without wasting power.
+///
+/// By default (or if `targetDuration` is 0), the target is the measured frame interval. Apps that
+/// render at a lower rate than the display refresh rate, or that want to leave headroom, may set a
+/// different target.
+///
+/// - Android: Uses the Android Dynamic Performance Framework (API 33+).
+///
+/// - iOS, tvOS, macOS, Emscripten, Linux: Does nothing.
+void glfmSetPerformanceHintTarget(GLFMDisplay *display, double targetDuration);
+
+/// Gets the target work duration set with ``glfmSetPerformanceHintTarget``, or 0 if the target is
+/// the measured frame interval.
+double glfmGetPerformanceHintTarget(const GLFMDisplay *display);
+
+/// Checks if a performance hint session is available. See ``glfmSetPerformanceHintTarget``.
+bool glfmIsPerformanceHintSupported(const GLFMDisplay *display);
+
 // MARK: - Callback functions
 
 /// Sets the function to call before each frame is displayed.
@@ -695,12 +1098,16 @@ double glfmGetTime(void);
 /// not render content, it should return without calling ``glfmSwapBuffers``.
 GLFMRenderFunc glfmSetRenderFunc(GLFMDisplay *display, GLFMRenderFunc renderFunc);
 
+GLFM_IGNORE_DEPRECATIONS_START
+
 /// *Deprecated:* Use ``glfmSetRenderFunc``.
 ///
 /// If this function is set, ``glfmSwapBuffers`` is called after calling the `GLFMMainLoopFunc`.
 GLFMMainLoopFunc glfmSetMainLoopFunc(GLFMDisplay *display, GLFMMainLoopFunc mainLoopFunc)
 GLFM_DEPRECATED("See glfmSetRenderFunc and glfmSwapBuffers");
 
+GLFM_IGNORE_DEPRECATIONS_END
+
 /// Sets the function to call when the surface could not be created.
 ///
 /// For example, the browser does not support WebGL.
@@ -746,6 +1153,9 @@ GLFMMemoryWarningFunc glfmSetMemoryWarningFunc(GLFMDisplay *display,
 
 /// Sets the function to call when the app loses or gains focus (goes into the background or returns
 /// from the background).
+///
+/// - Linux: When the window is closed, the function is called with `focused` set to `false` before
+///   the surface is destroyed.
 GLFMAppFocusFunc glfmSetAppFocusFunc(GLFMDisplay *display, GLFMAppFocusFunc focusFunc);
 
 // MARK: - Input functions
@@ -761,16 +1171,55 @@ void glfmSetMultitouchEnabled(GLFMDisplay *display, bool multitouchEnabled);
 bool glfmGetMultitouchEnabled(const GLFMDisplay *display);
 
 /// Gets whether the display has touch capabilities.
+///
+/// - Linux: Returns `true` if the window receives XInput 2.2 touch events.
 bool glfmHasTouch(const GLFMDisplay *display);
 
 /// Checks if a hardware sensor is available.
 ///
-/// - Emscripten: Always returns `false`.
+/// - Emscripten: Returns `true` if the browser supports the sensor's events, even if the device
+///   doesn't have the hardware. The magnetometer requires the Generic Sensor API.
 bool glfmIsSensorAvailable(const GLFMDisplay *display, GLFMSensor sensor);
 
 /// Sets the mouse cursor (only on platforms with a mouse).
 void glfmSetMouseCursor(GLFMDisplay *display, GLFMMouseCursor mouseCursor);
 
+/// Requests to lock or unlock the mouse pointer. By default, the pointer is unlocked.
+///
+/// While locked, the cursor is hidden and held in place, and mouse motion is sent to the
+/// ``GLFMRelativeMouseFunc`` as unaccelerated deltas where the platform provides them. Motion is
+/// read at the device's polling rate and accumulated with sub-pixel precision, and the sum is sent
+/// once per frame, before the render function. Mouse buttons are still sent to the
+/// ``GLFMTouchFunc``, at a fixed location; hover and drag events are not sent.
+///
+/// The lock may be granted later, and the system may release it, for example when the app loses
+/// focus. The request is kept, and the lock is restored when possible. Use
+/// ``glfmIsPointerLocked`` to check whether the pointer is locked.
+///
+/// The units of the motion depend on the platform, so apps should scale them by a sensitivity
+/// setting rather than treat them as a distance on screen.
+///
+/// - Emscripten: Uses the Pointer Lock API, with `unadjustedMovement` if the browser supports it.
+///   Browsers only grant the lock after a user gesture, so the lock is requested again when the
+///   canvas is clicked. The user can release the lock with the Escape key. Motion is in CSS pixels.
+/// - Android: Uses pointer capture, which requires API 26. Motion is in the units of the mouse's
+///   relative axes.
+/// - macOS: Disassociates the mouse from the cursor position. Motion is in pixels, with the
+///   system's acceleration applied.
+/// - Linux: Grabs the pointer and reads XInput 2 raw motion, in device units. Without XInput 2,
+///   the pointer is warped to the center of the window and motion is in pixels. Headless displays
+///   are always locked when requested.
+/// - iOS and tvOS: This function does nothing.
+void glfmSetPointerLocked(GLFMDisplay *display, bool locked);
+
+/// Returns `true` if the mouse pointer is currently locked. See ``glfmSetPointerLocked``.
+bool glfmIsPointerLocked(const GLFMDisplay *display);
+
+/// Sets the function to call with the relative mouse motion of each frame, while the pointer is
+/// locked. The function is only called for frames with motion. See ``glfmSetPointerLocked``.
+GLFMRelativeMouseFunc glfmSetRelativeMouseFunc(GLFMDisplay *display,
+                                               GLFMRelativeMouseFunc relativeMouseFunc);
+
 /// Gets whether a virtual onscreen keyboard can be displayed.
 ///
 /// Returns `true` on iOS and Android, `false` on other platforms.
@@ -870,6 +1319,65 @@ GLFMMouseWheelFunc glfmSetMouseWheelFunc(GLFMDisplay *display, GLFMMouseWheelFun
 /// Sensors are automatically disabled when the app is inactive, and re-enabled when active again.
 GLFMSensorFunc glfmSetSensorFunc(GLFMDisplay *display, GLFMSensor sensor, GLFMSensorFunc sensorFunc);
 
+/// Sets whether sensor events are remapped to the current interface orientation.
+/// By default, remapping is disabled.
+///
+/// When disabled, sensor vectors and matrices are relative to the device's natural orientation
+/// (usually portrait). When enabled, they are rotated around the Z axis so that the X and Y axes
+/// match the interface orientation (see ``glfmGetInterfaceOrientation``). This avoids querying the
+/// interface orientation for every sensor event.
+void glfmSetSensorRemappingEnabled(GLFMDisplay *display, bool remappingEnabled);
+
+/// Gets whether sensor events are remapped to the current interface orientation.
+/// See ``glfmSetSensorRemappingEnabled``.
+bool glfmGetSensorRemappingEnabled(const GLFMDisplay *display);
+
+/// Sets whether input events are queued for ``glfmPollEvents``. By default, polling is disabled.
+///
+/// When enabled, touch, key, character, mouse wheel, relative mouse, and sensor events are queued
+/// instead of being sent to their callback functions, and are reported to the system as handled.
+/// Sensors are still enabled with ``glfmSetSensorFunc``.
+///
+/// The queue holds 256 events. When it is full, new events are dropped and reported to the system
+/// as not handled, so poll the queue at least once per frame.
+void glfmSetEventPollingEnabled(GLFMDisplay *display, bool pollingEnabled);
+
+/// Gets whether input events are queued for ``glfmPollEvents``.
+/// See ``glfmSetEventPollingEnabled``.
+bool glfmIsEventPollingEnabled(const GLFMDisplay *display);
+
+/// Removes events from the input queue, oldest first, and copies them to `events`.
+///
+/// Call this function from ``GLFMRenderFunc``, for example at the start of each frame.
+///
+/// - Parameters:
+///   - events: The buffer to copy events to.
+///   - capacity: The maximum number of events to copy.
+/// - Returns: The number of events copied. If it equals `capacity`, more events may be waiting.
+int glfmPollEvents(GLFMDisplay *display, GLFMEvent *events, int capacity);
+
+/// Sets whether the input snapshot is updated. By default, the snapshot is disabled.
+///
+/// When enabled, GLFM tracks which keys are down, where each touch is, and the latest sensor
+/// events, in addition to sending events to callback functions or the event queue. The snapshot
+/// is updated once per frame, before ``GLFMRenderFunc`` is called.
+///
+/// Keys and touches are released when the app loses focus.
+void glfmSetInputSnapshotEnabled(GLFMDisplay *display, bool snapshotEnabled);
+
+/// Gets whether the input snapshot is updated. See ``glfmSetInputSnapshotEnabled``.
+bool glfmIsInputSnapshotEnabled(const GLFMDisplay *display);
+
+/// Gets the input state at the start of the current frame. The snapshot doesn't change during the
+/// frame, and is valid until the display is destroyed.
+///
+/// Returns a snapshot with no input if the snapshot is disabled.
+/// See ``glfmSetInputSnapshotEnabled``.
+const GLFMInputSnapshot *glfmGetInputSnapshot(const GLFMDisplay *display);
+
+/// Checks if a key is down in an input snapshot.
+bool glfmIsKeyDown(const GLFMInputSnapshot *snapshot, GLFMKeyCode keyCode);
+
 // MARK: - Haptics
 
 /// Returns true if the device supports haptic feedback.
@@ -884,11 +1392,422 @@ bool glfmIsHapticFeedbackSupported(const GLFMDisplay *display);
 /// - Emscripten: This function does nothing.
 void glfmPerformHapticFeedback(GLFMDisplay *display, GLFMHapticFeedbackStyle style);
 
+// MARK: - Thermal
+
+/// Gets the thermal headroom, smoothed over recent samples.
+///
+/// The headroom is 0 when the device is cool, and 1 when the device is throttling heavily. Values
+/// above 1 are possible. The headroom is sampled every 2 seconds while frames are drawn.
+///
+/// - Android: Uses `AThermal_getThermalHeadroom` with a 10 second forecast (API 31+). On API 30,
+///   the headroom is estimated from the thermal status.
+/// - iOS, tvOS, macOS: The headroom is estimated from `ProcessInfo.thermalState`.
+/// - Emscripten, Linux: Returns -1.
+///
+/// - Returns: The headroom, or -1 if unavailable.
+double glfmGetThermalHeadroom(const GLFMDisplay *display);
+
+/// Gets the thermal state of the device. The state is sampled with the thermal headroom.
+/// See ``glfmGetThermalHeadroom``.
+GLFMThermalState glfmGetThermalState(const GLFMDisplay *display);
+
+/// Sets the function to call when the recommended frame rate cap or render scale changes.
+///
+/// The recommendation is made from the thermal headroom and its trend, so that quality is reduced
+/// before the device throttles, rather than after frame rate collapses. Quality is reduced one step
+/// at a time, and restored only after the headroom has stayed low for 30 seconds. The steps are:
+///
+/// 1. Render scale 0.85.
+/// 2. Render scale 0.75, frame rate capped at 60.
+/// 3. Render scale 0.6, frame rate capped at 30.
+///
+/// The function is called on the render thread, before the render function. The initial
+/// recommendation is no frame rate cap and a render scale of 1; the function is not called for it.
+///
+/// - Emscripten, Linux: The function is never called.
+GLFMThermalRecommendationFunc glfmSetThermalRecommendationFunc(GLFMDisplay *display,
+                                                               GLFMThermalRecommendationFunc func);
+
+// MARK: - Assets
+
+/// Requests that an asset is made available for reading with `fopen`.
+///
+/// The `assetFunc` callback is invoked once, on the main thread, when the asset is available or
+/// if the request failed. The `assetFunc` may be NULL to prefetch an asset.
+///
+/// - Emscripten: If the app was built with streamed assets (see the `GLFM_EMSCRIPTEN_STREAM_ASSETS`
+///               CMake option), the asset is fetched after the first frame is displayed and
+///               written to the in-memory file system. Fetched assets are cached in IndexedDB,
+///               keyed by a hash of their contents, so later visits don't download them again.
+///               If the app was built with preloaded assets, the callback is invoked on the next
+///               frame.
+/// - Linux: Assets are read relative to the working directory. The callback is invoked
+///          immediately with `available` set to `true`.
+/// - Other platforms: Assets are bundled with the app. The callback is invoked immediately with
+///                    `available` set to `true`.
+///
+/// - Parameters:
+///   - path: The path of the asset, relative to the resources directory.
+void glfmRequestAsset(GLFMDisplay *display, const char *path, GLFMAssetFunc assetFunc);
+
+// MARK: - Jobs
+
+/// Counts incomplete jobs. See ``glfmCreateJobCounter``.
+typedef struct GLFMJobCounter GLFMJobCounter;
+
+/// A job, invoked on a worker thread or on a thread waiting for jobs.
+typedef void (*GLFMJobFunc)(void *userData);
+
+/// A job that processes the iterations from `start` (inclusive) to `end` (exclusive) of a
+/// ``glfmParallelFor`` loop.
+typedef void (*GLFMJobRangeFunc)(void *userData, int start, int end);
+
+/// Sets the number of job worker threads. Must be called before any other job function, otherwise
+/// it has no effect.
+///
+/// By default, there is one worker for each performance core, minus one for the calling thread,
+/// which runs jobs while it waits for them. Set to `0` to run every job on the thread that submits
+/// it.
+void glfmSetJobWorkerCount(int workerCount);
+
+/// Gets the number of job worker threads, starting the workers if needed.
+///
+/// - Emscripten: Workers require building with `-pthread`, and the app must be able to block
+///               while workers start, so use `GLFM_EMSCRIPTEN_OFFSCREEN_CANVAS`. Otherwise, there
+///               are no workers.
+int glfmGetJobWorkerCount(void);
+
+/// Creates a counter. Jobs submitted with a counter increment it, and decrement it when they
+/// complete.
+///
+/// - Returns: The counter, or NULL if memory could not be allocated.
+GLFMJobCounter *glfmCreateJobCounter(void);
+
+/// Waits for the jobs counted by the counter, and frees it.
+void glfmDestroyJobCounter(GLFMJobCounter *counter);
+
+/// Returns `true` if the counter's jobs are complete. Does not block.
+bool glfmIsJobCounterComplete(const GLFMJobCounter *counter);
+
+/// Runs a job on a worker thread.
+///
+/// Jobs submitted from a worker are usually run by the same worker, newest first. Idle workers
+/// take the oldest jobs from other workers.
+///
+/// - Parameters:
+///   - func: The job.
+///   - userData: The parameter passed to the job.
+///   - counter: The counter to increment now and decrement when the job completes. May be NULL.
+void glfmRunJob(GLFMJobFunc func, void *userData, GLFMJobCounter *counter);
+
+/// Runs a job on a worker thread after the jobs counted by `dependency` complete. If the
+/// dependency is already complete, this function is the same as ``glfmRunJob``.
+///
+/// The `counter` is incremented immediately, so waiting on it also waits for the dependency.
+void glfmRunJobAfter(GLFMJobCounter *dependency, GLFMJobFunc func, void *userData,
+                     GLFMJobCounter *counter);
+
+/// Waits for the jobs counted by the counter to complete. While waiting, the calling thread runs
+/// queued jobs.
+void glfmWaitForJobCounter(GLFMJobCounter *counter);
+
+/// Runs `func` on ranges of `[0, count)` on the calling thread and the worker threads, and waits
+/// for all iterations to complete.
+///
+/// - Parameters:
+///   - count: The number of iterations.
+///   - chunkSize: The number of iterations of each range, or `0` to choose automatically.
+///   - func: The function to process each range.
+///   - userData: The parameter passed to the function.
+void glfmParallelFor(int count, int chunkSize, GLFMJobRangeFunc func, void *userData);
+
+/// Gets the display's frame job counter. The jobs it counts complete before the next
+/// ``GLFMRenderFunc`` is invoked. The counter is owned by the display.
+///
+/// For example, a job submitted in the render function with this counter runs alongside the
+/// rendering of this frame, and its results are ready for the next frame.
+GLFMJobCounter *glfmGetFrameJobCounter(GLFMDisplay *display);
+
+// MARK: - Thread policy
+
+/// A thread, or group of threads, managed by GLFM. See ``glfmSetThreadPolicy``.
+typedef enum {
+    /// The thread that invokes `glfmMain()`, the render function, and other callbacks.
+    GLFMThreadRender,
+    /// The job worker threads. See ``glfmRunJob``.
+    GLFMThreadJobs,
+} GLFMThread;
+
+/// Scheduling policy flags. See ``glfmSetThreadPolicy``.
+typedef enum {
+    /// Default priority, on any core.
+    GLFMThreadPolicyDefault = 0,
+    /// Raise the priority above other threads of the app.
+    GLFMThreadPolicyHighPriority = (1 << 0),
+    /// Use the real-time FIFO scheduler, if permitted. If not permitted, the priority is raised
+    /// as with `GLFMThreadPolicyHighPriority`.
+    GLFMThreadPolicyRealtime = (1 << 1),
+    /// Run only on the cores with the highest capacity (all cores except the lowest-capacity
+    /// ones), so that the thread isn't placed on a little core next to background work.
+    GLFMThreadPolicyPerformanceCores = (1 << 2),
+} GLFMThreadPolicy;
+
+/// The placement of a thread, or group of threads. See ``glfmGetThreadPlacement``.
+typedef struct {
+    /// The policy in effect. For a group, only flags in effect for every thread are set.
+    GLFMThreadPolicy policy;
+    /// The cores the thread may run on, one bit per core, for the first 64 cores. For a group, the
+    /// cores any thread may run on. Zero if unknown.
+    uint64_t cpuMask;
+    /// The cores with the highest capacity, one bit per core. Zero if unknown.
+    uint64_t performanceCpuMask;
+} GLFMThreadPlacement;
+
+/// Sets the scheduling policy of a thread, or group of threads.
+///
+/// The policy replaces any previous policy: flags not set are restored to the thread's values from
+/// before GLFM first changed it. ``GLFMThreadPolicyDefault`` leaves a thread that GLFM never
+/// changed alone, so a priority or affinity set by the app is kept. For ``GLFMThreadRender``, call this function on the render thread (for example, in `glfmMain()`).
+/// The policy of ``GLFMThreadJobs`` applies to every display, and starts the workers if needed.
+///
+/// - Android, Linux: Priority is raised with a nice value of -8. The real-time scheduler usually
+///   requires `CAP_SYS_NICE`, and isn't permitted for Android apps. The highest-capacity cores are
+///   detected from `/sys/devices/system/cpu/cpu*/cpu_capacity`, or from the maximum frequency of
+///   each core if capacities are unavailable.
+/// - iOS, tvOS, macOS: Threads have the user-interactive quality of service, which the system
+///   places on performance cores. This function has no other effect.
+/// - Emscripten: This function has no effect.
+///
+/// - Returns: `true` if every requested flag is in effect. See ``glfmGetThreadPlacement``.
+bool glfmSetThreadPolicy(GLFMDisplay *display, GLFMThread thread, GLFMThreadPolicy policy);
+
+/// Gets the effective policy and core placement of a thread, or group of threads.
+///
+/// For ``GLFMThreadRender``, if ``glfmSetThreadPolicy`` hasn't been called, the placement of the
+/// calling thread is returned.
+///
+/// - Returns: `false` if the placement is unavailable, in which case `placement` is set to the
+///   default policy and unknown cores.
+bool glfmGetThreadPlacement(const GLFMDisplay *display, GLFMThread thread,
+                            GLFMThreadPlacement *placement);
+
+// MARK: - Textures
+
+/// A texture format. See ``glfmGetSupportedTextureFormats``.
+typedef enum {
+    /// Uncompressed, 32 bits per pixel.
+    GLFMTextureFormatRGBA8,
+    /// ETC2 RGB8, 4 bits per pixel. Core in OpenGL ES 3.0.
+    GLFMTextureFormatETC2RGB8,
+    /// ETC2 RGBA8 with EAC alpha, 8 bits per pixel. Core in OpenGL ES 3.0.
+    GLFMTextureFormatETC2RGBA8,
+    /// BC1 (S3TC DXT1) RGB, 4 bits per pixel.
+    GLFMTextureFormatBC1,
+    /// BC3 (S3TC DXT5) RGBA, 8 bits per pixel.
+    GLFMTextureFormatBC3,
+    /// ASTC 4x4 LDR, 8 bits per pixel.
+    GLFMTextureFormatASTC4x4,
+} GLFMTextureFormat;
+
+/// A mipmap level of a ``GLFMTexture``.
+typedef struct {
+    int width;
+    int height;
+    /// The offset of the level in the texture's `data`.
+    size_t offset;
+    /// The size of the level, in bytes.
+    size_t size;
+} GLFMTextureLevel;
+
+/// An encoded texture, with its mipmap levels in one allocation. Free with ``glfmFreeTexture``.
+typedef struct {
+    GLFMTextureFormat format;
+    int levelCount;
+    GLFMTextureLevel levels[16];
+    uint8_t *data;
+    size_t dataSize;
+    /// The size the levels would be as RGBA8, for comparing with `dataSize`.
+    size_t rgbaSize;
+    /// The time spent loading and encoding the texture, in seconds.
+    double encodeTime;
+} GLFMTexture;
+
+/// A texture encoded on a job worker. See ``glfmEncodeTextureAsync``.
+typedef struct GLFMTextureJob GLFMTextureJob;
+
+/// Gets the texture formats the display's OpenGL ES context can upload, as a bit mask with one bit
+/// per format (`1 << GLFMTextureFormatBC1`, etc.). ``GLFMTextureFormatRGBA8`` is always set.
+///
+/// The formats are queried once per context, so call this function on the render thread while the
+/// surface exists (for example, in the ``GLFMSurfaceCreatedFunc``). If the display uses Vulkan or
+/// Metal, only ``GLFMTextureFormatRGBA8`` is set; query the device instead.
+uint32_t glfmGetSupportedTextureFormats(GLFMDisplay *display);
+
+/// Chooses the texture format with the least memory of the supported formats.
+///
+/// S3TC (BC1, BC3) is chosen first, because desktop drivers often emulate ETC2 and ASTC by
+/// decompressing them.
+///
+/// - Parameters:
+///   - supportedFormats: Formats from ``glfmGetSupportedTextureFormats``.
+///   - hasAlpha: `true` if the texture needs an alpha channel.
+GLFMTextureFormat glfmGetPreferredTextureFormat(uint32_t supportedFormats, bool hasAlpha);
+
+/// Gets the name of a texture format, like "ETC2 RGB8".
+const char *glfmGetTextureFormatName(GLFMTextureFormat format);
+
+/// Encodes an RGBA8 image, optionally building its mipmap chain with a box filter.
+///
+/// Blocks are encoded in parallel with ``glfmParallelFor``. The encoders are meant for load time,
+/// not for offline quality: blocks of one or two colors are exact, and other blocks are usually
+/// within a few levels of the original. To encode without blocking, see
+/// ``glfmEncodeTextureAsync``.
+///
+/// - Parameters:
+///   - rgba: The image, top row first, four bytes per pixel with no row padding.
+///   - width: The width of the image, from 1 to 16384.
+///   - height: The height of the image, from 1 to 16384.
+///   - format: The format to encode to.
+///   - mipmaps: `true` to add levels down to 1x1.
+///   - texture: The encoded texture. On failure, it is cleared.
+/// - Returns: `true` if successful, or `false` if a parameter is invalid or memory could not be
+///   allocated.
+bool glfmEncodeTexture(const uint8_t *rgba, int width, int height, GLFMTextureFormat format,
+                       bool mipmaps, GLFMTexture *texture);
+
+/// Loads a texture from a KTX2 file in memory.
+///
+/// Files in a supported block format (BC1, BC3, ETC2 RGB8, ETC2 RGBA8, or ASTC 4x4 UNORM) are used
+/// as-is, so check that the format is supported before uploading. RGBA8 files are encoded to
+/// `format`, like ``glfmEncodeTexture``; if the file has no mipmap levels (a level count of zero),
+/// the mipmap chain is built.
+///
+/// Levels supercompressed with zlib are supported if GLFM was built with zlib (Linux).
+/// Basis Universal and Zstandard supercompression, cube maps, arrays, and 3D textures are not
+/// supported.
+///
+/// Requires the `GLFM_FEATURE_KTX2` CMake option. Without it, this function returns `false`.
+///
+/// - Returns: `true` if successful. On failure, `texture` is cleared.
+bool glfmLoadKTX2Texture(const void *data, size_t size, GLFMTextureFormat format,
+                         GLFMTexture *texture);
+
+/// Encodes an RGBA8 image on a job worker. See ``glfmEncodeTexture``.
+///
+/// The `rgba` data must remain valid until ``glfmFinishTextureJob`` is called.
+///
+/// - Returns: The job, or NULL if `rgba` is NULL or memory could not be allocated.
+GLFMTextureJob *glfmEncodeTextureAsync(const uint8_t *rgba, int width, int height,
+                                       GLFMTextureFormat format, bool mipmaps);
+
+/// Loads a KTX2 texture on a job worker. See ``glfmLoadKTX2Texture``.
+///
+/// The `data` must remain valid until ``glfmFinishTextureJob`` is called.
+///
+/// - Returns: The job, or NULL if `data` is NULL, memory could not be allocated, or the
+///   `GLFM_FEATURE_KTX2` CMake option is off.
+GLFMTextureJob *glfmLoadKTX2TextureAsync(const void *data, size_t size, GLFMTextureFormat format);
+
+/// Returns `true` if the texture job is complete. Does not block.
+bool glfmIsTextureJobComplete(const GLFMTextureJob *job);
+
+/// Waits for a texture job to complete, and frees it.
+///
+/// - Parameters:
+///   - job: The job.
+///   - texture: The texture, owned by the caller. If NULL, the texture is freed.
+/// - Returns: `true` if the texture was encoded.
+bool glfmFinishTextureJob(GLFMTextureJob *job, GLFMTexture *texture);
+
+/// Uploads every level of a texture to the bound `GL_TEXTURE_2D`, with `glTexImage2D` or
+/// `glCompressedTexImage2D`.
+///
+/// Texture parameters, like filters, are not changed.
+///
+/// - Returns: `true` if successful, `false` if OpenGL reported an error (for example, if the
+///   format isn't supported).
+bool glfmUploadTexture(const GLFMTexture *texture);
+
+/// Frees the data of a texture, and clears it.
+void glfmFreeTexture(GLFMTexture *texture);
+
 // MARK: - Platform-specific functions
 
 /// Returns `true` if this is an Apple platform that supports Metal, `false` otherwise.
 bool glfmIsMetalSupported(const GLFMDisplay *display);
 
+/// Returns `true` if the Vulkan loader is available, `false` otherwise.
+///
+/// Vulkan is only supported on Android and Linux.
+bool glfmIsVulkanSupported(const GLFMDisplay *display);
+
+#if defined(VK_VERSION_1_0) && defined(__linux__)
+
+/// *Android and Linux only*: The Vulkan objects created by GLFM. Include `vulkan/vulkan.h` before
+/// `glfm.h` to use this struct.
+typedef struct {
+    VkInstance instance;
+    VkPhysicalDevice physicalDevice;
+    /// The device, created with the `VK_KHR_swapchain` extension and no optional features.
+    VkDevice device;
+    /// The queue family of `queue`, which supports both graphics and presentation.
+    uint32_t queueFamilyIndex;
+    VkQueue queue;
+    /// The loader's `vkGetInstanceProcAddr`, for loading other Vulkan functions.
+    PFN_vkGetInstanceProcAddr getInstanceProcAddr;
+} GLFMVulkanContext;
+
+/// *Android and Linux only*: A swapchain image to render to. See ``glfmAcquireVulkanFrame``.
+typedef struct {
+    uint32_t imageIndex;
+    VkImage image;
+    VkImageView imageView;
+    VkFormat format;
+    VkExtent2D extent;
+    /// Signaled when the image is ready to be rendered to. The app's submission must wait on it
+    /// (at the `VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT` stage).
+    VkSemaphore acquireSemaphore;
+    /// The app's final submission for the frame must signal this semaphore. The image is
+    /// presented after it is signaled.
+    VkSemaphore renderSemaphore;
+    /// The app's final submission for the frame must signal this fence. GLFM waits on it before
+    /// the frame slot is reused.
+    VkFence fence;
+    /// The frame slot, either 0 or 1. Apps that keep per-frame resources, like command buffers,
+    /// should keep one per frame slot.
+    uint32_t frameIndex;
+} GLFMVulkanFrame;
+
+/// *Android and Linux only*: Gets the Vulkan objects created by GLFM.
+///
+/// The objects are valid from ``GLFMSurfaceCreatedFunc`` until ``GLFMSurfaceDestroyedFunc``, where
+/// the app must destroy everything it created with the device. The device is kept when the window
+/// is temporarily lost, for example when an Android app is in the background.
+///
+/// - Returns: `false` if the rendering API isn't `GLFMRenderingAPIVulkan`.
+bool glfmGetVulkanContext(const GLFMDisplay *display, GLFMVulkanContext *context);
+
+/// *Android and Linux only*: Acquires the next swapchain image. Call this function in the
+/// ``GLFMRenderFunc``, then submit the frame's rendering and call ``glfmSwapBuffers`` to present
+/// it. The image must be in the `VK_IMAGE_LAYOUT_PRESENT_SRC_KHR` layout when the app's submission
+/// completes.
+///
+/// Up to two frames are in flight (one with `GLFMLatencyModeLowLatency`). This function waits
+/// until the frame slot's previous submission is complete.
+///
+/// The swapchain is recreated as needed when the surface is resized or reported out of date, or
+/// when the swap interval or latency mode changes. A swap interval of 0 uses the mailbox or
+/// immediate present mode; otherwise, the FIFO present mode is used.
+///
+/// - Linux: Windowed apps present to a Wayland or X11 window. Headless displays present to a
+/// `VK_EXT_headless_surface`, and the output (see ``glfmSetOutputConfig``) is not available.
+///
+/// - Returns: `false` if no image is available, for example when the window has no area or the
+///   surface was lost. In that case, skip rendering the frame.
+bool glfmAcquireVulkanFrame(GLFMDisplay *display, GLFMVulkanFrame *frame);
+
+#endif // VK_VERSION_1_0
+
 #if defined(__APPLE__) || defined(GLFM_EXPOSE_NATIVE_APPLE)
 
 /// *Apple platforms only*: Returns a pointer to an `MTKView` instance, or `NULL` if Metal is not
@@ -922,6 +1841,154 @@ void *glfmGetAndroidActivity(const GLFMDisplay *display);
 
 #endif // GLFM_EXPOSE_NATIVE_ANDROID
 
+#if defined(__linux__) && !defined(__ANDROID__)
+
+/// *Linux only*: The entry point of a display created with ``glfmCreateDisplay``. Like
+/// ``glfmMain``, call ``glfmSetDisplayConfig`` and ``glfmSetRenderFunc`` in this function.
+typedef void (*GLFMMainFunc)(GLFMDisplay *display);
+
+/// *Linux only*: Creates a headless display that renders to an offscreen EGL surface.
+///
+/// Each display has its own context, callbacks, and user data, and there is no state shared
+/// between displays, so several displays can run concurrently on different threads. A display must
+/// only be used by one thread at a time.
+///
+/// - Parameters:
+///   - mainFunc: The function to configure the display, invoked before this function returns.
+///   - width: The width of the surface, in pixels, or 0 for the default.
+///   - height: The height of the surface, in pixels, or 0 for the default.
+///   - userData: The initial user data pointer. See ``glfmGetUserData``.
+/// - Returns: The display, or NULL if memory could not be allocated.
+GLFMDisplay *glfmCreateDisplay(GLFMMainFunc mainFunc, int width, int height, void *userData);
+
+/// *Linux only*: Renders `frameCount` frames on the calling thread, as fast as possible.
+///
+/// The surface is created on the first call, and ``GLFMSurfaceCreatedFunc`` is invoked. The
+/// context is current on the calling thread only for the duration of this call, so later calls
+/// may be made from a different thread.
+///
+/// - Returns: `false` if the surface could not be created.
+bool glfmRunDisplay(GLFMDisplay *display, int frameCount);
+
+/// *Linux only*: Destroys the surface, invoking ``GLFMSurfaceDestroyedFunc``, and frees the
+/// display.
+void glfmDestroyDisplay(GLFMDisplay *display);
+
+/// *Linux only*: The format of frames written by a headless display. See ``GLFMOutputConfig``.
+typedef enum {
+    /// No output.
+    GLFMOutputFormatNone,
+    /// A sequence of PNG images. The output path is a pattern with one integer conversion, like
+    /// `"frame%05d.png"`, which is replaced by the frame index.
+    GLFMOutputFormatPNG,
+    /// A YUV4MPEG2 stream (4:2:0, BT.601), suitable for piping to a video encoder.
+    GLFMOutputFormatY4M,
+    /// Raw, top-to-bottom RGBA frames with no header, suitable for piping to a video encoder.
+    GLFMOutputFormatRGBA,
+} GLFMOutputFormat;
+
+/// *Linux only*: Output settings for a headless display. See ``glfmSetOutputConfig``.
+typedef struct {
+    /// The format of the output.
+    GLFMOutputFormat format;
+    /// The output file, or `"-"` for the standard output. The file may be a named pipe.
+    const char *path;
+    /// The maximum number of frames waiting to be encoded, or 0 for the default (4). When the
+    /// queue is full, ``glfmSwapBuffers`` blocks until the encoder catches up.
+    int queueDepth;
+    /// If greater than zero, frames are rendered with a fixed timestep: ``glfmGetFrameTime``
+    /// returns the frame index divided by the frame rate, regardless of how long each frame takes
+    /// to render, so the output is deterministic. Otherwise, the real time is used.
+    double frameRate;
+} GLFMOutputConfig;
+
+/// *Linux only*: Sets where the frames of a headless display are written.
+///
+/// When set, each call to ``glfmSwapBuffers`` reads the frame back and queues it for encoding on a
+/// background thread. With OpenGL ES 3.0, frames are read back asynchronously with pixel buffer
+/// objects. All queued frames are written before ``glfmRunDisplay`` returns.
+///
+/// Output is not available when using the Vulkan rendering API.
+///
+/// Call this function from the `mainFunc` passed to ``glfmCreateDisplay``, or between calls to
+/// ``glfmRunDisplay`` on the thread that runs the display.
+///
+/// - Parameters:
+///   - config: The output settings, or NULL to stop writing output.
+/// - Returns: `false` if the output could not be opened.
+bool glfmSetOutputConfig(GLFMDisplay *display, const GLFMOutputConfig *config);
+
+/// *Linux only*: The type of a ``GLFMInjectedEvent``.
+typedef enum {
+    /// A touch or mouse event. `code` is the touch number, `action` is a ``GLFMTouchPhase``, and
+    /// `values` are the x and y location.
+    GLFMInjectedEventTypeTouch = 1,
+    /// A key event. `code` is a ``GLFMKeyCode``, `action` is a ``GLFMKeyAction``, and
+    /// `modifiers` is a bitmask of ``GLFMKeyModifier``.
+    GLFMInjectedEventTypeKey,
+    /// A character event. `text` is the UTF-8 character, padded with zeros.
+    GLFMInjectedEventTypeChar,
+    /// A mouse wheel event. `code` is a ``GLFMMouseWheelDeltaType``, and `values` are the x and y
+    /// location followed by the x and y deltas.
+    GLFMInjectedEventTypeMouseWheel,
+    /// A sensor event. `code` is a ``GLFMSensor`` other than `GLFMSensorRotationMatrix`, and
+    /// `values` are the vector.
+    GLFMInjectedEventTypeSensor,
+    /// Relative mouse motion. `values` are the x and y deltas, which are accumulated like real
+    /// motion while the pointer is locked. See ``glfmSetPointerLocked``.
+    GLFMInjectedEventTypeRelativeMouse,
+} GLFMInjectedEventType;
+
+/// *Linux only*: An input event sent to the input server, in host byte order.
+/// See ``glfmSetInputServerPath``.
+typedef struct {
+    /// A ``GLFMInjectedEventType``.
+    uint32_t type;
+    int32_t code;
+    int32_t action;
+    int32_t modifiers;
+    /// If nonzero, a ``GLFMInjectedEventAck`` with this identifier is sent back when the frame
+    /// that consumed the event is presented.
+    uint64_t id;
+    double values[4];
+    char text[8];
+    /// The time the event occurred, in the ``glfmGetTime`` timebase, or 0 to use the time the
+    /// event is read from the socket. Replayed input should set this, since events are read in
+    /// batches at the start of each frame.
+    double timestamp;
+} GLFMInjectedEvent;
+
+/// *Linux only*: Sent by the input server when the frame that consumed a ``GLFMInjectedEvent``
+/// is presented. Times are in the ``glfmGetTime`` timebase, which is `CLOCK_MONOTONIC`.
+typedef struct {
+    /// The `id` of the event.
+    uint64_t id;
+    /// The time the event was read from the socket.
+    double receiveTime;
+    /// The `timestamp` of the event, or `receiveTime` if it was 0.
+    double eventTime;
+    /// The frame time of the frame that consumed the event. See ``glfmGetFrameTime``.
+    double frameTime;
+    /// The time ``glfmSwapBuffers`` returned for that frame.
+    double presentTime;
+} GLFMInjectedEventAck;
+
+/// *Linux only*: Starts a server on a Unix domain socket that injects input events, for automated
+/// testing.
+///
+/// A client connects to the socket and writes ``GLFMInjectedEvent`` records. At the start of each
+/// frame, pending events are read and dispatched to the same callbacks as real input, on the
+/// thread that runs the display. The server accepts one client at a time, and never blocks.
+///
+/// - Parameters:
+///   - path: The socket path, or NULL to stop the server. An existing socket at the path is
+///           replaced if no server is listening on it.
+/// - Returns: `false` if the socket could not be created, or if another server, like another
+///            instance of the app, is listening at the path.
+bool glfmSetInputServerPath(GLFMDisplay *display, const char *path);
+
+#endif // __linux__
+
 #ifdef __cplusplus
 }
 #endif
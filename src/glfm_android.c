@@ -3,6 +3,13 @@
 
 #if defined(__ANDROID__)
 
+// The Vulkan loader is opened at runtime, so only the Vulkan headers are needed to build.
+#if GLFM_HAS_VULKAN
+#  define VK_NO_PROTOTYPES
+#  define VK_USE_PLATFORM_ANDROID_KHR
+#  include <vulkan/vulkan.h>
+#endif
+
 #include "glfm.h"
 #include "glfm_internal.h"
 
@@ -30,6 +37,11 @@
 #  endif
 #endif
 
+#include "glfm_vulkan.h"
+#include "glfm_threads.h"
+#include "glfm_jobs.h"
+#include "glfm_texture.h"
+
 #define GLFM_MAX_SIMULTANEOUS_TOUCHES 5
 // Same update interval as iOS
 #define GLFM_SENSOR_UPDATE_INTERVAL_MICROS ((int)(0.01 * 1000000))
@@ -83,6 +95,10 @@ typedef struct {
     EGLConfig eglConfig;
     EGLContext eglContext;
     bool eglContextCurrent;
+    EGLint eglSwapInterval; // Negative if not set on the surface
+    bool eglTimestampsChecked;
+    bool eglTimestampsEnabled;
+    bool eglTimestampSupported[3]; // See glfm__eglTimestampNames
 
     int32_t width;
     int32_t height;
@@ -97,13 +113,21 @@ typedef struct {
     GLFMDisplay *display;
     GLFMRenderingAPI renderingAPI;
 
+#if GLFM_FEATURE_SENSORS
     ASensorEventQueue *sensorEventQueue;
     GLFMSensorEvent sensorEvent[GLFM_NUM_SENSORS];
     bool sensorEventValid[GLFM_NUM_SENSORS];
     bool deviceSensorEnabled[GLFM_NUM_SENSORS];
+    GLFMSensorFusion sensorFusion;
+    bool sensorFusionEnabled;
+#endif
 
     GLFMInterfaceOrientation orientation;
 
+    void *choreographer;
+    bool choreographerFramePending;
+    double vsyncTime;
+
     JNIEnv *jniEnv;
 } GLFMPlatformData;
 
@@ -113,7 +137,9 @@ static GLFMPlatformData *platformDataGlobal = NULL;
 
 static void *glfm__mainLoop(void *param);
 static int glfm__looperCallback(int pipe, int events, void *userData);
+#if GLFM_FEATURE_SENSORS
 static void glfm__setAllRequestedSensorsEnabled(GLFMDisplay *display, bool enable);
+#endif
 static void glfm__reportOrientationChangeIfNeeded(GLFMDisplay *display);
 static void glfm__reportInsetsChangedIfNeeded(GLFMDisplay *display);
 static bool glfm__updateSurfaceSizeIfNeeded(GLFMDisplay *display, bool force);
@@ -323,6 +349,9 @@ static void glfm__eglSurfaceInit(GLFMPlatformData *platformData) {
         platformData->eglSurface = eglCreateWindowSurface(platformData->eglDisplay,
                                                           platformData->eglConfig,
                                                           platformData->window, NULL);
+        platformData->eglSwapInterval = -1;
+        platformData->eglTimestampsChecked = false;
+        platformData->eglTimestampsEnabled = false;
 
         switch (platformData->display->swapBehavior) {
         case GLFMSwapBehaviorPlatformDefault:
@@ -526,6 +555,20 @@ static void glfm__eglDestroy(GLFMPlatformData *platformData) {
     platformData->eglContext = EGL_NO_CONTEXT;
     platformData->eglSurface = EGL_NO_SURFACE;
     platformData->eglContextCurrent = false;
+    if (platformData->display) {
+        platformData->display->textureFormats = 0;
+    }
+}
+
+/// Sets the swap interval of the current surface if it has changed. See glfmSetSwapInterval().
+static void glfm__eglUpdateSwapInterval(GLFMPlatformData *platformData) {
+    const EGLint swapInterval = glfmGetSwapInterval(platformData->display);
+    if (platformData->eglSwapInterval != swapInterval) {
+        platformData->eglSwapInterval = swapInterval;
+        if (!eglSwapInterval(platformData->eglDisplay, swapInterval)) {
+            GLFM_LOG("eglSwapInterval(%i) failed", (int)swapInterval);
+        }
+    }
 }
 
 static void glfm__eglCheckError(GLFMPlatformData *platformData) {
@@ -552,12 +595,488 @@ static void glfm__eglCheckError(GLFMPlatformData *platformData) {
     }
 }
 
+// MARK: - Vulkan
+
+#if GLFM_HAS_VULKAN
+
+/// Creates a surface for the current window. A GLFMVulkanSurfaceFunc.
+static VkResult glfm__vulkanCreateSurface(GLFMDisplay *display,
+                                          PFN_vkGetInstanceProcAddr getInstanceProcAddr,
+                                          VkInstance instance, VkSurfaceKHR *surface) {
+    GLFMPlatformData *platformData = (GLFMPlatformData *)display->platformData;
+    PFN_vkCreateAndroidSurfaceKHR createAndroidSurface = (PFN_vkCreateAndroidSurfaceKHR)
+        getInstanceProcAddr(instance, "vkCreateAndroidSurfaceKHR");
+    if (!createAndroidSurface || !platformData->window) {
+        return VK_ERROR_INITIALIZATION_FAILED;
+    }
+    VkAndroidSurfaceCreateInfoKHR createInfo;
+    memset(&createInfo, 0, sizeof(createInfo));
+    createInfo.sType = VK_STRUCTURE_TYPE_ANDROID_SURFACE_CREATE_INFO_KHR;
+    createInfo.window = platformData->window;
+    return createAndroidSurface(instance, &createInfo, NULL, surface);
+}
+
+#endif // GLFM_HAS_VULKAN
+
+/// Creates the Vulkan surface for the current window if the app prefers Vulkan. The device is
+/// created with the first surface, and kept until the activity is destroyed. Returns false if
+/// OpenGL ES should be used instead.
+static bool glfm__vulkanInit(GLFMPlatformData *platformData) {
+#if GLFM_HAS_VULKAN
+    GLFMDisplay *display = platformData->display;
+    if (!display || !platformData->window) {
+        return false;
+    }
+    if (!display->vulkan) {
+        if (display->preferredAPI != GLFMRenderingAPIVulkan ||
+            platformData->eglContext != EGL_NO_CONTEXT) {
+            return false;
+        }
+        display->vulkan = glfm__vulkanCreate(VK_KHR_ANDROID_SURFACE_EXTENSION_NAME,
+                                             glfm__vulkanCreateSurface);
+        if (!display->vulkan) {
+            return false;
+        }
+    }
+    if (!glfm__vulkanSurfaceInit(display, display->vulkan)) {
+        if (!platformData->surfaceCreatedNotified) {
+            // The app hasn't used the device yet, so fall back to OpenGL ES.
+            glfm__vulkanDestroy(display->vulkan);
+            display->vulkan = NULL;
+            return false;
+        }
+        glfm__vulkanSurfaceDestroy(display->vulkan);
+        glfm__reportSurfaceError(display, "Couldn't create Vulkan surface");
+        return true;
+    }
+    platformData->renderingAPI = GLFMRenderingAPIVulkan;
+    platformData->width = ANativeWindow_getWidth(platformData->window);
+    platformData->height = ANativeWindow_getHeight(platformData->window);
+    if (!platformData->surfaceCreatedNotified) {
+        platformData->surfaceCreatedNotified = true;
+        if (display->surfaceCreatedFunc) {
+            display->surfaceCreatedFunc(display, platformData->width, platformData->height);
+        }
+    }
+    return true;
+#else
+    (void)platformData;
+    return false;
+#endif
+}
+
+/// Destroys the swapchain and surface when the window is destroyed. The device is kept.
+static void glfm__vulkanReleaseWindow(GLFMPlatformData *platformData) {
+#if GLFM_HAS_VULKAN
+    if (platformData->display && platformData->display->vulkan) {
+        glfm__vulkanSurfaceDestroy(platformData->display->vulkan);
+    }
+#else
+    (void)platformData;
+#endif
+}
+
+/// Invokes the GLFMSurfaceDestroyedFunc, so that the app can release its Vulkan resources, and
+/// then destroys the device.
+static void glfm__vulkanDisplayDestroy(GLFMPlatformData *platformData) {
+#if GLFM_HAS_VULKAN
+    GLFMDisplay *display = platformData->display;
+    if (!display || !display->vulkan) {
+        return;
+    }
+    if (platformData->surfaceCreatedNotified) {
+        platformData->surfaceCreatedNotified = false;
+        if (display->surfaceDestroyedFunc) {
+            display->surfaceDestroyedFunc(display);
+        }
+    }
+    glfm__vulkanDestroy(display->vulkan);
+    display->vulkan = NULL;
+#else
+    (void)platformData;
+#endif
+}
+
+static bool glfm__isSurfaceReady(const GLFMPlatformData *platformData) {
+#if GLFM_HAS_VULKAN
+    if (platformData->display && platformData->display->vulkan) {
+        return platformData->display->vulkan->surface != VK_NULL_HANDLE;
+    }
+#endif
+    return platformData->eglContextCurrent;
+}
+
+// MARK: - Frame timestamps
+
+/// Converts a CLOCK_MONOTONIC time, in nanoseconds, to the glfmGetTime() timebase.
+static double glfm__monotonicNanosToTime(int64_t nanos) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    const int64_t nowNanos = (int64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+    return glfmGetTime() - (double)(nowNanos - nanos) / 1e9;
+}
+
+// EGL_ANDROID_get_frame_timestamps is loaded dynamically, since older NDK headers don't declare it
+// and older devices don't support it.
+#ifndef EGL_TIMESTAMPS_ANDROID
+#  define EGL_TIMESTAMPS_ANDROID 0x3430
+#endif
+#ifndef EGL_RENDERING_COMPLETE_TIME_ANDROID
+#  define EGL_RENDERING_COMPLETE_TIME_ANDROID 0x3435
+#endif
+#ifndef EGL_COMPOSITION_LATCH_TIME_ANDROID
+#  define EGL_COMPOSITION_LATCH_TIME_ANDROID 0x3436
+#endif
+#ifndef EGL_DISPLAY_PRESENT_TIME_ANDROID
+#  define EGL_DISPLAY_PRESENT_TIME_ANDROID 0x343A
+#endif
+#define GLFM_EGL_TIMESTAMP_PENDING ((int64_t)-2)
+
+typedef EGLBoolean (EGLAPIENTRYP GLFMEGLGetNextFrameIdFunc)(EGLDisplay dpy, EGLSurface surface,
+                                                             uint64_t *frameId);
+typedef EGLBoolean (EGLAPIENTRYP GLFMEGLGetFrameTimestampsFunc)(EGLDisplay dpy, EGLSurface surface,
+                                                                 uint64_t frameId,
+                                                                 EGLint numTimestamps,
+                                                                 const EGLint *timestamps,
+                                                                 int64_t *values);
+typedef EGLBoolean (EGLAPIENTRYP GLFMEGLGetFrameTimestampSupportedFunc)(EGLDisplay dpy,
+                                                                         EGLSurface surface,
+                                                                         EGLint timestamp);
+
+static struct {
+    bool loaded;
+    GLFMEGLGetNextFrameIdFunc getNextFrameId;
+    GLFMEGLGetFrameTimestampsFunc getFrameTimestamps;
+    GLFMEGLGetFrameTimestampSupportedFunc getFrameTimestampSupported;
+} glfm__frameTimestampsFunctions;
+
+// In the same order as the times in GLFMPresentFeedback
+static const EGLint glfm__eglTimestampNames[3] = {
+    EGL_RENDERING_COMPLETE_TIME_ANDROID,
+    EGL_COMPOSITION_LATCH_TIME_ANDROID,
+    EGL_DISPLAY_PRESENT_TIME_ANDROID,
+};
+
+/// Enables frame timestamps on the current surface, if supported, and gets the EGL ID of the next
+/// frame. Returns 0 if frame timestamps are unavailable.
+static uint64_t glfm__eglGetNextFrameId(GLFMPlatformData *platformData) {
+    if (!glfm__frameTimestampsFunctions.loaded) {
+        glfm__frameTimestampsFunctions.loaded = true;
+        const char *extensions = eglQueryString(platformData->eglDisplay, EGL_EXTENSIONS);
+        if (extensions && strstr(extensions, "EGL_ANDROID_get_frame_timestamps")) {
+            glfm__frameTimestampsFunctions.getNextFrameId = (GLFMEGLGetNextFrameIdFunc)
+                eglGetProcAddress("eglGetNextFrameIdANDROID");
+            glfm__frameTimestampsFunctions.getFrameTimestamps = (GLFMEGLGetFrameTimestampsFunc)
+                eglGetProcAddress("eglGetFrameTimestampsANDROID");
+            glfm__frameTimestampsFunctions.getFrameTimestampSupported = (GLFMEGLGetFrameTimestampSupportedFunc)
+                eglGetProcAddress("eglGetFrameTimestampSupportedANDROID");
+        }
+    }
+    if (!glfm__frameTimestampsFunctions.getNextFrameId ||
+        !glfm__frameTimestampsFunctions.getFrameTimestamps ||
+        !glfm__frameTimestampsFunctions.getFrameTimestampSupported ||
+        platformData->eglSurface == EGL_NO_SURFACE) {
+        return 0;
+    }
+    if (!platformData->eglTimestampsChecked) {
+        platformData->eglTimestampsChecked = true;
+        platformData->eglTimestampsEnabled = eglSurfaceAttrib(platformData->eglDisplay,
+                                                              platformData->eglSurface,
+                                                              EGL_TIMESTAMPS_ANDROID, EGL_TRUE);
+        for (int i = 0; i < 3; i++) {
+            platformData->eglTimestampSupported[i] = (platformData->eglTimestampsEnabled &&
+                glfm__frameTimestampsFunctions.getFrameTimestampSupported(platformData->eglDisplay,
+                                                                          platformData->eglSurface,
+                                                                          glfm__eglTimestampNames[i]));
+        }
+    }
+    uint64_t frameId = 0;
+    if (!platformData->eglTimestampsEnabled ||
+        !glfm__frameTimestampsFunctions.getNextFrameId(platformData->eglDisplay,
+                                                       platformData->eglSurface, &frameId)) {
+        return 0;
+    }
+    return frameId;
+}
+
+/// Gets the measured times of a frame. A GLFMFrameTimestampsFunc.
+static void glfm__eglGetFrameTimestamps(GLFMDisplay *display, uint64_t platformFrameId,
+                                        GLFMPresentFeedback *feedback) {
+    GLFMPlatformData *platformData = display->platformData;
+    feedback->pending = false;
+    if (platformFrameId == 0 || !platformData->eglTimestampsEnabled ||
+        platformData->eglSurface == EGL_NO_SURFACE) {
+        return;
+    }
+    double *times[3] = { &feedback->gpuCompleteTime, &feedback->latchTime, &feedback->presentTime };
+    for (int i = 0; i < 3; i++) {
+        int64_t value = 0;
+        if (!platformData->eglTimestampSupported[i] ||
+            !glfm__frameTimestampsFunctions.getFrameTimestamps(platformData->eglDisplay,
+                                                               platformData->eglSurface,
+                                                               platformFrameId, 1,
+                                                               &glfm__eglTimestampNames[i], &value)) {
+            continue;
+        }
+        if (value == GLFM_EGL_TIMESTAMP_PENDING) {
+            feedback->pending = true;
+        } else if (value > 0) {
+            *times[i] = glfm__monotonicNanosToTime(value);
+            feedback->measured = true;
+        }
+    }
+}
+
+// MARK: - Choreographer
+
+// AChoreographer is available in API 24, but loaded dynamically to support older versions.
+// AChoreographer_postFrameCallback passes the frame time as a `long`, which is only usable on 64-bit
+// devices; AChoreographer_postFrameCallback64 was added in API 29.
+typedef void (*GLFMChoreographerFrameCallback)(long frameTimeNanos, void *data);
+typedef void (*GLFMChoreographerFrameCallback64)(int64_t frameTimeNanos, void *data);
+typedef void *(*GLFMChoreographerGetInstanceFunc)(void);
+typedef void (*GLFMChoreographerPostFrameCallbackFunc)(void *choreographer,
+                                                       GLFMChoreographerFrameCallback callback,
+                                                       void *data);
+typedef void (*GLFMChoreographerPostFrameCallback64Func)(void *choreographer,
+                                                         GLFMChoreographerFrameCallback64 callback,
+                                                         void *data);
+
+static struct {
+    bool loaded;
+    GLFMChoreographerGetInstanceFunc getInstance;
+    GLFMChoreographerPostFrameCallbackFunc postFrameCallback;
+    GLFMChoreographerPostFrameCallback64Func postFrameCallback64;
+} glfm__choreographerFunctions;
+
+/// Gets the AChoreographer for the current thread, which must have a looper. Returns NULL if
+/// unavailable.
+static void *glfm__getChoreographer(void) {
+    if (!glfm__choreographerFunctions.loaded) {
+        glfm__choreographerFunctions.loaded = true;
+        void *handle = dlopen("libandroid.so", RTLD_NOW | RTLD_LOCAL);
+        if (handle) {
+            glfm__choreographerFunctions.getInstance = (GLFMChoreographerGetInstanceFunc)
+                dlsym(handle, "AChoreographer_getInstance");
+            glfm__choreographerFunctions.postFrameCallback = (GLFMChoreographerPostFrameCallbackFunc)
+                dlsym(handle, "AChoreographer_postFrameCallback");
+            glfm__choreographerFunctions.postFrameCallback64 = (GLFMChoreographerPostFrameCallback64Func)
+                dlsym(handle, "AChoreographer_postFrameCallback64");
+        }
+        if (sizeof(long) < sizeof(int64_t)) {
+            glfm__choreographerFunctions.postFrameCallback = NULL;
+        }
+    }
+    if (!glfm__choreographerFunctions.getInstance ||
+        (!glfm__choreographerFunctions.postFrameCallback64 &&
+         !glfm__choreographerFunctions.postFrameCallback)) {
+        return NULL;
+    }
+    return glfm__choreographerFunctions.getInstance();
+}
+
+static void glfm__choreographerFrameCallback64(int64_t frameTimeNanos, void *data) {
+    GLFMPlatformData *platformData = data;
+    platformData->choreographerFramePending = false;
+
+    // The frame time is in the CLOCK_MONOTONIC timebase, which may differ from glfmGetTime().
+    const double vsyncTime = glfm__monotonicNanosToTime(frameTimeNanos);
+    const double now = glfmGetTime();
+    platformData->vsyncTime = vsyncTime < now ? vsyncTime : now;
+}
+
+static void glfm__choreographerFrameCallback(long frameTimeNanos, void *data) {
+    glfm__choreographerFrameCallback64((int64_t)frameTimeNanos, data);
+}
+
+/// Requests the vsync time of the next frame. The callback is invoked from ALooper_pollAll().
+static void glfm__requestVsyncTime(GLFMPlatformData *platformData) {
+    if (!platformData->choreographer || platformData->choreographerFramePending) {
+        return;
+    }
+    platformData->choreographerFramePending = true;
+    if (glfm__choreographerFunctions.postFrameCallback64) {
+        glfm__choreographerFunctions.postFrameCallback64(platformData->choreographer,
+                                                         glfm__choreographerFrameCallback64,
+                                                         platformData);
+    } else {
+        glfm__choreographerFunctions.postFrameCallback(platformData->choreographer,
+                                                       glfm__choreographerFrameCallback,
+                                                       platformData);
+    }
+}
+
+// MARK: - Performance hints
+
+// APerformanceHint is available in API 33, but loaded dynamically to support older versions.
+// APerformanceHint_setThreads was added in API 34.
+typedef void *(*GLFMPerformanceHintGetManagerFunc)(void);
+typedef void *(*GLFMPerformanceHintCreateSessionFunc)(void *manager, const int32_t *threadIds,
+                                                      size_t size, int64_t targetNanos);
+typedef int (*GLFMPerformanceHintUpdateTargetFunc)(void *session, int64_t targetNanos);
+typedef int (*GLFMPerformanceHintReportActualFunc)(void *session, int64_t actualNanos);
+typedef void (*GLFMPerformanceHintCloseSessionFunc)(void *session);
+typedef int (*GLFMPerformanceHintSetThreadsFunc)(void *session, const int32_t *threadIds, size_t size);
+
+static struct {
+    bool loaded;
+    void *manager;
+    GLFMPerformanceHintCreateSessionFunc createSession;
+    GLFMPerformanceHintUpdateTargetFunc updateTarget;
+    GLFMPerformanceHintReportActualFunc reportActual;
+    GLFMPerformanceHintCloseSessionFunc closeSession;
+    GLFMPerformanceHintSetThreadsFunc setThreads;
+} glfm__performanceHintFunctions;
+
+static void *glfm__performanceHintCreateSession(const int32_t *threadIds, int threadCount,
+                                                int64_t targetNanos) {
+    return glfm__performanceHintFunctions.createSession(glfm__performanceHintFunctions.manager,
+                                                        threadIds, (size_t)threadCount, targetNanos);
+}
+
+static bool glfm__performanceHintSetThreads(void *session, const int32_t *threadIds, int threadCount) {
+    if (!glfm__performanceHintFunctions.setThreads) {
+        return false;
+    }
+    return glfm__performanceHintFunctions.setThreads(session, threadIds, (size_t)threadCount) == 0;
+}
+
+static void glfm__performanceHintUpdateTarget(void *session, int64_t targetNanos) {
+    glfm__performanceHintFunctions.updateTarget(session, targetNanos);
+}
+
+static void glfm__performanceHintReportActual(void *session, int64_t actualNanos) {
+    glfm__performanceHintFunctions.reportActual(session, actualNanos);
+}
+
+static void glfm__performanceHintCloseSession(void *session) {
+    glfm__performanceHintFunctions.closeSession(session);
+}
+
+static const GLFMPerformanceHintFuncs glfm__performanceHintFuncs = {
+    .createSession = glfm__performanceHintCreateSession,
+    .setThreads = glfm__performanceHintSetThreads,
+    .updateTarget = glfm__performanceHintUpdateTarget,
+    .reportActual = glfm__performanceHintReportActual,
+    .closeSession = glfm__performanceHintCloseSession,
+};
+
+/// Gets the performance hint functions, or NULL if unavailable.
+static const GLFMPerformanceHintFuncs *glfm__getPerformanceHintFuncs(void) {
+    if (!glfm__performanceHintFunctions.loaded) {
+        glfm__performanceHintFunctions.loaded = true;
+        void *handle = dlopen("libandroid.so", RTLD_NOW | RTLD_LOCAL);
+        if (handle) {
+            GLFMPerformanceHintGetManagerFunc getManager = (GLFMPerformanceHintGetManagerFunc)
+                dlsym(handle, "APerformanceHint_getManager");
+            glfm__performanceHintFunctions.createSession = (GLFMPerformanceHintCreateSessionFunc)
+                dlsym(handle, "APerformanceHint_createSession");
+            glfm__performanceHintFunctions.updateTarget = (GLFMPerformanceHintUpdateTargetFunc)
+                dlsym(handle, "APerformanceHint_updateTargetWorkDuration");
+            glfm__performanceHintFunctions.reportActual = (GLFMPerformanceHintReportActualFunc)
+                dlsym(handle, "APerformanceHint_reportActualWorkDuration");
+            glfm__performanceHintFunctions.closeSession = (GLFMPerformanceHintCloseSessionFunc)
+                dlsym(handle, "APerformanceHint_closeSession");
+            glfm__performanceHintFunctions.setThreads = (GLFMPerformanceHintSetThreadsFunc)
+                dlsym(handle, "APerformanceHint_setThreads");
+            if (getManager && glfm__performanceHintFunctions.createSession &&
+                glfm__performanceHintFunctions.updateTarget &&
+                glfm__performanceHintFunctions.reportActual &&
+                glfm__performanceHintFunctions.closeSession) {
+                glfm__performanceHintFunctions.manager = getManager();
+            }
+        }
+    }
+    return glfm__performanceHintFunctions.manager ? &glfm__performanceHintFuncs : NULL;
+}
+
+/// Reports the frame's work duration for the render thread and the job worker threads.
+static void glfm__performanceHintReport(GLFMDisplay *display) {
+    if (!display->performanceHint.funcs) {
+        return;
+    }
+    int32_t threadIds[GLFM_MAX_PERFORMANCE_HINT_THREADS];
+    threadIds[0] = (int32_t)gettid();
+    const int threadCount = 1 + glfm__jobGetThreadIds(threadIds + 1, GLFM_MAX_PERFORMANCE_HINT_THREADS - 1);
+    glfm__performanceHintEndWork(display, threadIds, threadCount);
+}
+
+// MARK: - Thermal
+
+// AThermal is available in API 30, but loaded dynamically to support older versions.
+// AThermal_getThermalHeadroom was added in API 31.
+typedef void *(*GLFMThermalAcquireManagerFunc)(void);
+typedef int (*GLFMThermalGetCurrentStatusFunc)(void *manager);
+typedef float (*GLFMThermalGetHeadroomFunc)(void *manager, int forecastSeconds);
+
+static struct {
+    bool loaded;
+    void *manager;
+    GLFMThermalGetCurrentStatusFunc getCurrentStatus;
+    GLFMThermalGetHeadroomFunc getHeadroom;
+} glfm__thermalFunctions;
+
+static bool glfm__thermalPoll(GLFMDisplay *display, double *headroom, GLFMThermalState *state) {
+    (void)display;
+    if (!glfm__thermalFunctions.loaded) {
+        glfm__thermalFunctions.loaded = true;
+        void *handle = dlopen("libandroid.so", RTLD_NOW | RTLD_LOCAL);
+        if (handle) {
+            GLFMThermalAcquireManagerFunc acquireManager = (GLFMThermalAcquireManagerFunc)
+                dlsym(handle, "AThermal_acquireManager");
+            glfm__thermalFunctions.getCurrentStatus = (GLFMThermalGetCurrentStatusFunc)
+                dlsym(handle, "AThermal_getCurrentThermalStatus");
+            glfm__thermalFunctions.getHeadroom = (GLFMThermalGetHeadroomFunc)
+                dlsym(handle, "AThermal_getThermalHeadroom");
+            if (acquireManager && glfm__thermalFunctions.getCurrentStatus) {
+                glfm__thermalFunctions.manager = acquireManager();
+            }
+        }
+    }
+    if (!glfm__thermalFunctions.manager) {
+        return false;
+    }
+
+    // AThermalStatus values
+    const int status = glfm__thermalFunctions.getCurrentStatus(glfm__thermalFunctions.manager);
+    if (status < 0) { // ATHERMAL_STATUS_ERROR
+        *state = GLFMThermalStateUnknown;
+    } else if (status == 0) { // ATHERMAL_STATUS_NONE
+        *state = GLFMThermalStateNominal;
+    } else if (status <= 2) { // ATHERMAL_STATUS_LIGHT, ATHERMAL_STATUS_MODERATE
+        *state = GLFMThermalStateFair;
+    } else if (status == 3) { // ATHERMAL_STATUS_SEVERE
+        *state = GLFMThermalStateSerious;
+    } else { // ATHERMAL_STATUS_CRITICAL, ATHERMAL_STATUS_EMERGENCY, ATHERMAL_STATUS_SHUTDOWN
+        *state = GLFMThermalStateCritical;
+    }
+
+    // The headroom is NaN if unavailable, or if called more than once per second
+    if (glfm__thermalFunctions.getHeadroom) {
+        *headroom = glfm__thermalFunctions.getHeadroom(glfm__thermalFunctions.manager, 10);
+    }
+    return true;
+}
+
+// MARK: - Drawing
+
 static void glfm__drawFrame(GLFMPlatformData *platformData) {
-    if (!platformData->eglContextCurrent) {
+    if (!glfm__isSurfaceReady(platformData)) {
         // Probably a bad config (Happens on Android 2.3 emulator)
         return;
     }
 
+    // Use the vsync time if it was received since the last frame
+    if (platformData->display) {
+        double frameTime = platformData->vsyncTime;
+        platformData->vsyncTime = 0;
+        if (frameTime <= 0) {
+            frameTime = glfmGetTime();
+        }
+        glfm__setFrameTime(platformData->display, frameTime, 0);
+        glfm__requestVsyncTime(platformData);
+    }
+
     // Check for resize (or rotate)
     glfm__updateSurfaceSizeIfNeeded(platformData->display, false);
 
@@ -568,7 +1087,12 @@ static void glfm__drawFrame(GLFMPlatformData *platformData) {
             platformData->display->surfaceRefreshFunc(platformData->display);
         }
     }
+    if (platformData->display) {
+        glfm__waitForFrameJobs(platformData->display);
+        glfm__swapInputSnapshot(platformData->display);
+    }
     if (platformData->display && platformData->display->renderFunc) {
+        glfm__performanceHintBeginWork(platformData->display);
         platformData->display->renderFunc(platformData->display);
     }
 }
@@ -851,10 +1375,15 @@ static void glfm__setAnimating(GLFMPlatformData *platformData, bool animating) {
     if (platformData->animating != animating) {
         platformData->animating = animating;
         platformData->refreshRequested = true;
+        if (platformData->display) {
+            glfm__setSuspended(platformData->display, !animating);
+        }
         if (platformData->display && platformData->display->focusFunc) {
             platformData->display->focusFunc(platformData->display, animating);
         }
+#if GLFM_FEATURE_SENSORS
         glfm__setAllRequestedSensorsEnabled(platformData->display, animating);
+#endif
     }
 }
 
@@ -867,7 +1396,7 @@ static void glfm__onAppCmd(GLFMPlatformData *platformData, GLFMActivityCommand c
             pthread_cond_broadcast(&platformData->cond);
             pthread_mutex_unlock(&platformData->mutex);
 
-            const bool success = glfm__eglInit(platformData);
+            const bool success = glfm__vulkanInit(platformData) || glfm__eglInit(platformData);
             if (!success) {
                 glfm__eglCheckError(platformData);
             }
@@ -881,6 +1410,7 @@ static void glfm__onAppCmd(GLFMPlatformData *platformData, GLFMActivityCommand c
         }
         case GLFMActivityCommandOnNativeWindowDestroyed: {
             GLFM_LOG_LIFECYCLE("OnNativeWindowDestroyed");
+            glfm__vulkanReleaseWindow(platformData);
             platformData->window = NULL;
             glfm__eglSurfaceDestroy(platformData);
             glfm__setAnimating(platformData, false);
@@ -894,10 +1424,17 @@ static void glfm__onAppCmd(GLFMPlatformData *platformData, GLFMActivityCommand c
         case GLFMActivityCommandOnWindowFocusGained: {
             GLFM_LOG_LIFECYCLE("OnWindowFocusGained");
             glfm__setAnimating(platformData, true);
+            if (platformData->display && platformData->display->pointerLockRequested) {
+                // Pointer capture is released when the window loses focus
+                glfm__pointerLockUpdated(platformData->display);
+            }
             break;
         }
         case GLFMActivityCommandOnWindowFocusLost: {
             GLFM_LOG_LIFECYCLE("OnWindowFocusLost");
+            if (platformData->display) {
+                platformData->display->pointerLocked = false;
+            }
             if (platformData->animating) {
                 platformData->refreshRequested = true;
                 glfm__drawFrame(platformData);
@@ -959,6 +1496,7 @@ static void glfm__onAppCmd(GLFMPlatformData *platformData, GLFMActivityCommand c
 #endif
         case GLFMActivityCommandOnDestroy: {
             GLFM_LOG_LIFECYCLE("OnDestroy");
+            glfm__vulkanDisplayDestroy(platformData);
             glfm__eglDestroy(platformData);
             glfm__setAnimating(platformData, false);
             platformData->destroyRequested = true;
@@ -989,6 +1527,7 @@ static void glfm__onAppCmd(GLFMPlatformData *platformData, GLFMActivityCommand c
             GLFM_LOG_LIFECYCLE("OnConfigurationChanged");
             AConfiguration_fromAssetManager(platformData->config,
                                             platformData->activity->assetManager);
+            glfm__reportOrientationChangeIfNeeded(platformData->display);
             break;
         }
         default: {
@@ -998,6 +1537,8 @@ static void glfm__onAppCmd(GLFMPlatformData *platformData, GLFMActivityCommand c
     }
 }
 
+#if GLFM_FEATURE_KEYBOARD
+
 static void glfm__unicodeToUTF8(uint32_t unicode, char utf8[5]) {
     if (unicode < 0x80) {
         utf8[0] = (char)(unicode & 0x7fu);
@@ -1053,6 +1594,8 @@ static uint32_t glfm__getUnicodeChar(GLFMPlatformData *platformData, jint keyCod
     return (uint32_t)unicodeKey;
 }
 
+#endif // GLFM_FEATURE_KEYBOARD
+
 /*
  * Move task to the back if it is root task. This make the back button have the same behavior
  * as the home button.
@@ -1077,6 +1620,8 @@ static bool glfm__handleBackButton(GLFMPlatformData *platformData) {
     return !glfm__wasJavaExceptionThrown(jni) && handled;
 }
 
+#if GLFM_FEATURE_KEYBOARD
+
 static bool glfm__onKeyEvent(GLFMPlatformData *platformData, AInputEvent *event) {
     if (!platformData || !platformData->display) {
         return false;
@@ -1085,22 +1630,24 @@ static bool glfm__onKeyEvent(GLFMPlatformData *platformData, AInputEvent *event)
     int32_t aAction = AKeyEvent_getAction(event);
     int32_t aKeyCode = AKeyEvent_getKeyCode(event);
     int32_t aMetaState = AKeyEvent_getMetaState(event);
+    // Input event times are in the CLOCK_MONOTONIC timebase (SystemClock.uptimeMillis)
+    const double timestamp = glfm__monotonicNanosToTime(AKeyEvent_getEventTime(event));
     if (aKeyCode == 0) {
         // aKeyCode is 0 for many non-ASCII keys from the virtual keyboard.
         return false;
     }
     if (aKeyCode == INT32_MAX) {
         // This is a special key code for GLFM where the scancode represents a unicode character.
-        if (display->charFunc) {
+        if (glfm__isCharInputNeeded(display)) {
             uint32_t unicode = (uint32_t)AKeyEvent_getScanCode(event);
             char utf8[5];
             glfm__unicodeToUTF8(unicode, utf8);
-            display->charFunc(display, utf8, 0);
+            glfm__dispatchCharEvent(display, timestamp, utf8);
         }
         return true;
     }
     bool handled = false;
-    if (display->keyFunc) {
+    if (glfm__isKeyInputNeeded(display)) {
         static const GLFMKeyCode AKEYCODE_MAP[] = {
                 [AKEYCODE_BACK]            = GLFMKeyCodeNavigationBack,
 
@@ -1244,7 +1791,8 @@ static bool glfm__onKeyEvent(GLFMPlatformData *platformData, AInputEvent *event)
         }
 
         if (aAction == AKEY_EVENT_ACTION_UP) {
-            handled = display->keyFunc(display, keyCode, GLFMKeyActionReleased, modifiers);
+            handled = glfm__dispatchKeyEvent(display, timestamp, keyCode, GLFMKeyActionReleased,
+                                             modifiers);
         } else if (aAction == AKEY_EVENT_ACTION_DOWN) {
             GLFMKeyAction keyAction;
             if (AKeyEvent_getRepeatCount(event) > 0) {
@@ -1252,15 +1800,13 @@ static bool glfm__onKeyEvent(GLFMPlatformData *platformData, AInputEvent *event)
             } else {
                 keyAction = GLFMKeyActionPressed;
             }
-            handled = display->keyFunc(display, keyCode, keyAction, modifiers);
+            handled = glfm__dispatchKeyEvent(display, timestamp, keyCode, keyAction, modifiers);
         } else if (aAction == AKEY_EVENT_ACTION_MULTIPLE) {
             for (int i = AKeyEvent_getRepeatCount(event); i > 0; i--) {
-                if (display->keyFunc) {
-                    handled |= display->keyFunc(display, keyCode, GLFMKeyActionPressed, modifiers);
-                }
-                if (display->keyFunc) {
-                    handled |= display->keyFunc(display, keyCode, GLFMKeyActionReleased, modifiers);
-                }
+                handled |= glfm__dispatchKeyEvent(display, timestamp, keyCode, GLFMKeyActionPressed,
+                                                  modifiers);
+                handled |= glfm__dispatchKeyEvent(display, timestamp, keyCode, GLFMKeyActionReleased,
+                                                  modifiers);
             }
         }
     }
@@ -1271,18 +1817,17 @@ static bool glfm__onKeyEvent(GLFMPlatformData *platformData, AInputEvent *event)
     }
 #endif
 
-    if (display->charFunc && (aAction == AKEY_EVENT_ACTION_DOWN || aAction == AKEY_EVENT_ACTION_MULTIPLE)) {
+    if (glfm__isCharInputNeeded(display) &&
+        (aAction == AKEY_EVENT_ACTION_DOWN || aAction == AKEY_EVENT_ACTION_MULTIPLE)) {
         uint32_t unicode = glfm__getUnicodeChar(platformData, aKeyCode, aMetaState);
         if (unicode >= ' ') {
             char utf8[5];
             glfm__unicodeToUTF8(unicode, utf8);
             if (aAction == AKEY_EVENT_ACTION_DOWN) {
-                display->charFunc(display, utf8, 0);
+                glfm__dispatchCharEvent(display, timestamp, utf8);
             } else {
                 for (int i = AKeyEvent_getRepeatCount(event); i > 0; i--) {
-                    if (display->charFunc) {
-                        display->charFunc(display, utf8, 0);
-                    }
+                    glfm__dispatchCharEvent(display, timestamp, utf8);
                 }
             }
         }
@@ -1290,14 +1835,33 @@ static bool glfm__onKeyEvent(GLFMPlatformData *platformData, AInputEvent *event)
     return handled;
 }
 
+#else
+
+static bool glfm__onKeyEvent(GLFMPlatformData *platformData, AInputEvent *event) {
+#if GLFM_HANDLE_BACK_BUTTON
+    if (AKeyEvent_getAction(event) == AKEY_EVENT_ACTION_UP &&
+        AKeyEvent_getKeyCode(event) == AKEYCODE_BACK) {
+        return glfm__handleBackButton(platformData);
+    }
+#else
+    (void)platformData;
+    (void)event;
+#endif
+    return false;
+}
+
+#endif // GLFM_FEATURE_KEYBOARD
+
 static bool glfm__onTouchEvent(GLFMPlatformData *platformData, AInputEvent *event) {
-    if (!platformData || !platformData->display || !platformData->display->touchFunc) {
+    if (!platformData || !platformData->display ||
+        !glfm__isTouchInputNeeded(platformData->display)) {
         return false;
     }
     GLFMDisplay *display = platformData->display;
     const int maxTouches = platformData->multitouchEnabled ? GLFM_MAX_SIMULTANEOUS_TOUCHES : 1;
     const int32_t action = AMotionEvent_getAction(event);
     const uint32_t maskedAction = (uint32_t)action & (uint32_t)AMOTION_EVENT_ACTION_MASK;
+    const double timestamp = glfm__monotonicNanosToTime(AMotionEvent_getEventTime(event));
 
     GLFMTouchPhase phase;
     bool validAction = true;
@@ -1328,10 +1892,10 @@ static bool glfm__onTouchEvent(GLFMPlatformData *platformData, AInputEvent *even
             const size_t count = AMotionEvent_getPointerCount(event);
             for (size_t i = 0; i < count; i++) {
                 const int touchNumber = AMotionEvent_getPointerId(event, i);
-                if (touchNumber >= 0 && touchNumber < maxTouches && display->touchFunc) {
+                if (touchNumber >= 0 && touchNumber < maxTouches) {
                     double x = (double)AMotionEvent_getX(event, i);
                     double y = (double)AMotionEvent_getY(event, i);
-                    display->touchFunc(display, touchNumber, phase, x, y);
+                    glfm__dispatchTouchEvent(display, timestamp, touchNumber, phase, x, y);
                 }
             }
         } else {
@@ -1339,12 +1903,61 @@ static bool glfm__onTouchEvent(GLFMPlatformData *platformData, AInputEvent *even
                     (uint32_t)AMOTION_EVENT_ACTION_POINTER_INDEX_MASK) >>
                     (uint32_t)AMOTION_EVENT_ACTION_POINTER_INDEX_SHIFT);
             const int touchNumber = AMotionEvent_getPointerId(event, index);
-            if (touchNumber >= 0 && touchNumber < maxTouches && display->touchFunc) {
+            if (touchNumber >= 0 && touchNumber < maxTouches) {
                 double x = (double)AMotionEvent_getX(event, index);
                 double y = (double)AMotionEvent_getY(event, index);
-                display->touchFunc(display, touchNumber, phase, x, y);
+                glfm__dispatchTouchEvent(display, timestamp, touchNumber, phase, x, y);
+            }
+        }
+    }
+    return true;
+}
+
+/// Handles a mouse event while the pointer is captured. The location is the relative motion.
+static bool glfm__onRelativeMouseEvent(GLFMPlatformData *platformData, AInputEvent *event) {
+    if (!platformData || !platformData->display ||
+        !platformData->display->pointerLockRequested) {
+        return false;
+    }
+    GLFMDisplay *display = platformData->display;
+    display->pointerLocked = true;
+    const int32_t action = AMotionEvent_getAction(event);
+    const uint32_t maskedAction = (uint32_t)action & (uint32_t)AMOTION_EVENT_ACTION_MASK;
+
+    GLFMTouchPhase phase;
+    switch (maskedAction) {
+        case AMOTION_EVENT_ACTION_MOVE:
+        case AMOTION_EVENT_ACTION_HOVER_MOVE: {
+            // Samples since the previous event, at the device's rate, are in the history
+            double deltaX = 0.0;
+            double deltaY = 0.0;
+            const size_t historySize = AMotionEvent_getHistorySize(event);
+            for (size_t i = 0; i < historySize; i++) {
+                deltaX += (double)AMotionEvent_getHistoricalX(event, 0, i);
+                deltaY += (double)AMotionEvent_getHistoricalY(event, 0, i);
             }
+            deltaX += (double)AMotionEvent_getX(event, 0);
+            deltaY += (double)AMotionEvent_getY(event, 0);
+            glfm__addRelativeMouseMotion(display, deltaX, deltaY);
+            return true;
         }
+        case AMOTION_EVENT_ACTION_DOWN:
+            phase = GLFMTouchPhaseBegan;
+            break;
+        case AMOTION_EVENT_ACTION_UP:
+            phase = GLFMTouchPhaseEnded;
+            break;
+        case AMOTION_EVENT_ACTION_CANCEL:
+            phase = GLFMTouchPhaseCancelled;
+            break;
+        default:
+            return true;
+    }
+    // The captured pointer has no location, so buttons are sent at the center of the view
+    if (glfm__isTouchInputNeeded(display)) {
+        const double timestamp = glfm__monotonicNanosToTime(AMotionEvent_getEventTime(event));
+        glfm__dispatchTouchEvent(display, timestamp, 0, phase, platformData->width / 2.0,
+                                 platformData->height / 2.0);
     }
     return true;
 }
@@ -1360,15 +1973,22 @@ static void glfm__onInputEvent(GLFMPlatformData *platformData) {
         if (eventType == AINPUT_EVENT_TYPE_KEY) {
             handled = glfm__onKeyEvent(platformData, event);
         } else if (eventType == AINPUT_EVENT_TYPE_MOTION) {
-            handled = glfm__onTouchEvent(platformData, event);
+            if (AInputEvent_getSource(event) == AINPUT_SOURCE_MOUSE_RELATIVE) {
+                handled = glfm__onRelativeMouseEvent(platformData, event);
+            } else {
+                handled = glfm__onTouchEvent(platformData, event);
+            }
         }
         AInputQueue_finishEvent(platformData->inputQueue, event, (int)handled);
     }
 }
 
+#if GLFM_FEATURE_SENSORS
+
 static void glfm__onSensorEvent(GLFMPlatformData *platformData) {
     ASensorEvent event;
     bool sensorEventReceived[GLFM_NUM_SENSORS] = { 0 };
+    bool fusionUpdated = false;
     while (ASensorEventQueue_getEvents(platformData->sensorEventQueue, &event, 1) > 0) {
         if (event.type == ASENSOR_TYPE_ACCELEROMETER) {
             // Convert to iOS format
@@ -1380,6 +2000,16 @@ static void glfm__onSensorEvent(GLFMPlatformData *platformData) {
             sensorEvent->vector.z = (double)event.acceleration.z / -(double)ASENSOR_STANDARD_GRAVITY;
             sensorEventReceived[GLFMSensorAccelerometer] = true;
             platformData->sensorEventValid[GLFMSensorAccelerometer] = true;
+            if (platformData->sensorFusionEnabled) {
+                glfm__sensorFusionAddAccelerometer(&platformData->sensorFusion,
+                                                   event.acceleration.x, event.acceleration.y,
+                                                   event.acceleration.z);
+                if (!platformData->deviceSensorEnabled[GLFMSensorGyroscope]) {
+                    fusionUpdated |= glfm__sensorFusionAddGyroscope(&platformData->sensorFusion,
+                                                                    sensorEvent->timestamp,
+                                                                    0.0f, 0.0f, 0.0f);
+                }
+            }
         } else if (event.type == ASENSOR_TYPE_MAGNETIC_FIELD) {
             GLFMSensorEvent *sensorEvent = &platformData->sensorEvent[GLFMSensorMagnetometer];
             sensorEvent->sensor = GLFMSensorMagnetometer;
@@ -1389,6 +2019,11 @@ static void glfm__onSensorEvent(GLFMPlatformData *platformData) {
             sensorEvent->vector.z = (double)event.magnetic.z;
             sensorEventReceived[GLFMSensorMagnetometer] = true;
             platformData->sensorEventValid[GLFMSensorMagnetometer] = true;
+            if (platformData->sensorFusionEnabled) {
+                glfm__sensorFusionAddMagnetometer(&platformData->sensorFusion,
+                                                  event.magnetic.x, event.magnetic.y,
+                                                  event.magnetic.z);
+            }
         } else if (event.type == ASENSOR_TYPE_GYROSCOPE) {
             GLFMSensorEvent *sensorEvent = &platformData->sensorEvent[GLFMSensorGyroscope];
             sensorEvent->sensor = GLFMSensorGyroscope;
@@ -1398,6 +2033,12 @@ static void glfm__onSensorEvent(GLFMPlatformData *platformData) {
             sensorEvent->vector.z = (double)event.vector.z;
             sensorEventReceived[GLFMSensorGyroscope] = true;
             platformData->sensorEventValid[GLFMSensorGyroscope] = true;
+            if (platformData->sensorFusionEnabled) {
+                fusionUpdated |= glfm__sensorFusionAddGyroscope(&platformData->sensorFusion,
+                                                                sensorEvent->timestamp,
+                                                                event.vector.x, event.vector.y,
+                                                                event.vector.z);
+            }
         } else if (event.type == ASENSOR_TYPE_ROTATION_VECTOR) {
             const int SDK_INT = platformData->activity->sdkVersion;
 
@@ -1503,15 +2144,28 @@ static void glfm__onSensorEvent(GLFMPlatformData *platformData) {
         }
     }
 
+    if (fusionUpdated) {
+        glfm__sensorFusionGetEvent(&platformData->sensorFusion,
+                                   &platformData->sensorEvent[GLFMSensorRotationMatrix]);
+        sensorEventReceived[GLFMSensorRotationMatrix] = true;
+        platformData->sensorEventValid[GLFMSensorRotationMatrix] = true;
+    }
+
     // Send callbacks
     for (int i = 0; i < GLFM_NUM_SENSORS; i++) {
-        GLFMSensorFunc sensorFunc = platformData->display->sensorFuncs[i];
-        if (sensorFunc && sensorEventReceived[i]) {
-            sensorFunc(platformData->display, platformData->sensorEvent[i]);
+        if (platformData->display->sensorFuncs[i] && sensorEventReceived[i]) {
+            GLFMSensorEvent sensorEvent = platformData->sensorEvent[i];
+            if (platformData->display->sensorRemappingEnabled) {
+                // Use the cached orientation to avoid several JNI calls per event
+                glfm__remapSensorEvent(&sensorEvent, platformData->orientation);
+            }
+            glfm__dispatchSensorEvent(platformData->display, sensorEvent);
         }
     }
 }
 
+#endif // GLFM_FEATURE_SENSORS
+
 // MARK: - Thread entry point
 
 static void *glfm__mainLoop(void *param) {
@@ -1529,6 +2183,11 @@ static void *glfm__mainLoop(void *param) {
     ALooper_addFd(platformData->looper, platformData->commandPipeRead,
                   GLFMLooperIDCommand, ALOOPER_EVENT_INPUT, NULL, NULL);
 
+    // Init choreographer (requires the looper)
+    platformData->choreographer = glfm__getChoreographer();
+    platformData->choreographerFramePending = false;
+    platformData->vsyncTime = 0;
+
     // Init java env
     JavaVM *jvm = platformData->activity->vm;
     (*jvm)->AttachCurrentThread(jvm, &platformData->jniEnv, NULL);
@@ -1550,6 +2209,10 @@ static void *glfm__mainLoop(void *param) {
         platformData->display->platformData = platformData;
         platformData->display->supportedOrientations = GLFMInterfaceOrientationAll;
         platformData->display->swapBehavior = GLFMSwapBehaviorPlatformDefault;
+        platformData->display->swapInterval = -1;
+        platformData->display->frameTimestampsFunc = glfm__eglGetFrameTimestamps;
+        platformData->display->performanceHint.funcs = glfm__getPerformanceHintFuncs();
+        platformData->display->thermalPollFunc = glfm__thermalPoll;
         platformData->resizeEventWaitFrames = GLFM_RESIZE_EVENT_MAX_WAIT_FRAMES;
         glfmMain(platformData->display);
     }
@@ -1615,8 +2278,10 @@ static void *glfm__mainLoop(void *param) {
                 }
             } else if (eventIdentifier == GLFMLooperIDInput) {
                 glfm__onInputEvent(platformData);
+#if GLFM_FEATURE_SENSORS
             } else if (eventIdentifier == GLFMLooperIDSensor) {
                 glfm__onSensorEvent(platformData);
+#endif
             }
             if (platformData->destroyRequested) {
                 break;
@@ -1626,6 +2291,9 @@ static void *glfm__mainLoop(void *param) {
         if (platformData->animating && platformData->display) {
             platformData->swapCalled = false;
             glfm__drawFrame(platformData);
+            if (glfm__isSurfaceReady(platformData)) {
+                glfm__runIdleTasks(platformData->display, glfm__getIdleDeadline(platformData->display));
+            }
             if (!platformData->swapCalled) {
                 // Sleep until next swap time (1/60 second after last swap time)
                 const float refreshRate = glfm__getRefreshRate(platformData->display);
@@ -1657,21 +2325,28 @@ static void *glfm__mainLoop(void *param) {
         AInputQueue_detachLooper(platformData->inputQueue);
         platformData->inputQueue = NULL;
     }
+#if GLFM_FEATURE_SENSORS
     if (platformData->sensorEventQueue) {
         glfm__setAllRequestedSensorsEnabled(platformData->display, false);
         ASensorManager *sensorManager = ASensorManager_getInstance();
         ASensorManager_destroyEventQueue(sensorManager, platformData->sensorEventQueue);
         platformData->sensorEventQueue = NULL;
     }
+#endif
     if (platformData->config) {
         AConfiguration_delete(platformData->config);
         platformData->config = NULL;
     }
+    if (platformData->display) {
+        glfm__performanceHintDestroy(platformData->display);
+    }
+    glfm__vulkanDisplayDestroy(platformData);
     glfm__eglDestroy(platformData);
     glfm__setAnimating(platformData, false);
     (*jvm)->DetachCurrentThread(jvm);
     platformData->window = NULL;
     platformData->looper = NULL;
+    platformData->choreographer = NULL;
 
     // Notify thread no longer running
     pthread_mutex_lock(&platformData->mutex);
@@ -1699,6 +2374,8 @@ static jobject glfm__getDecorView(JNIEnv *jni, GLFMPlatformData *platformData) {
     return glfm__wasJavaExceptionThrown(jni) ? NULL : decorView;
 }
 
+#if GLFM_FEATURE_KEYBOARD
+
 static ARect glfm__getDecorViewRect(GLFMPlatformData *platformData, const ARect *defaultRect) {
     JNIEnv *jni = platformData->jniEnv;
     if ((*jni)->ExceptionCheck(jni)) {
@@ -1740,6 +2417,8 @@ static ARect glfm__getDecorViewRect(GLFMPlatformData *platformData, const ARect
     return result;
 }
 
+#endif // GLFM_FEATURE_KEYBOARD
+
 static void glfm__updateUserInterfaceChromeCallback(GLFMPlatformData *platformData, void *userData) {
     (void)userData;
     glfm__updateUserInterfaceChrome(platformData);
@@ -1860,6 +2539,28 @@ static void glfm__updateUserInterfaceChrome(GLFMPlatformData *platformData) {
     (*jni)->DeleteLocalRef(jni, decorView);
 }
 
+// Called from the UI thread. The userData is non-NULL to request capture, or NULL to release it.
+static void glfm__updatePointerCaptureCallback(GLFMPlatformData *platformData, void *userData) {
+    JavaVM *jvm = platformData->activity->vm;
+    JNIEnv *jni = NULL;
+    (*jvm)->GetEnv(jvm, (void **) &jni, JNI_VERSION_1_2);
+    if (!jni || (*jni)->ExceptionCheck(jni)) {
+        return;
+    }
+
+    jobject decorView = glfm__getDecorView(jni, platformData);
+    if (!decorView) {
+        return;
+    }
+    if (userData) {
+        glfm__callJavaMethod(jni, decorView, "requestPointerCapture", "()V", Void);
+    } else {
+        glfm__callJavaMethod(jni, decorView, "releasePointerCapture", "()V", Void);
+    }
+    glfm__clearJavaException(jni);
+    (*jni)->DeleteLocalRef(jni, decorView);
+}
+
 static void glfm__resetContentRect(GLFMPlatformData *platformData) {
     // Reset's NativeActivity's content rect so that onContentRectChanged acts as a
     // OnGlobalLayoutListener. This is needed to detect changes to getWindowVisibleDisplayFrame()
@@ -2047,8 +2748,16 @@ static bool glfm__updateSurfaceSizeIfNeeded(GLFMDisplay *display, bool force) {
     int32_t width = 0;
     int32_t height = 0;
     EGLBoolean success = true;
-    success &= eglQuerySurface(platformData->eglDisplay, platformData->eglSurface, EGL_WIDTH, &width);
-    success &= eglQuerySurface(platformData->eglDisplay, platformData->eglSurface, EGL_HEIGHT, &height);
+    if (display->vulkan) {
+        success = platformData->window != NULL;
+        if (success) {
+            width = ANativeWindow_getWidth(platformData->window);
+            height = ANativeWindow_getHeight(platformData->window);
+        }
+    } else {
+        success &= eglQuerySurface(platformData->eglDisplay, platformData->eglSurface, EGL_WIDTH, &width);
+        success &= eglQuerySurface(platformData->eglDisplay, platformData->eglSurface, EGL_HEIGHT, &height);
+    }
     if (success && (width != platformData->width || height != platformData->height)) {
         if (force || platformData->resizeEventWaitFrames <= 0) {
             GLFM_LOG_LIFECYCLE("Resize: %i x %i", width, height);
@@ -2122,17 +2831,23 @@ static void glfm__reportOrientationChangeIfNeeded(GLFMDisplay *display) {
     if (!display) {
         return;
     }
+    // The orientation is cached even without GLFM_FEATURE_ORIENTATION, since sensor events are
+    // remapped with it.
     GLFMPlatformData *platformData = (GLFMPlatformData *)display->platformData;
     GLFMInterfaceOrientation orientation = glfmGetInterfaceOrientation(display);
     if (platformData->orientation != orientation) {
         platformData->orientation = orientation;
         platformData->refreshRequested = true;
+#if GLFM_FEATURE_ORIENTATION
         if (display->orientationChangedFunc) {
             display->orientationChangedFunc(display, orientation);
         }
+#endif
     }
 }
 
+#if GLFM_FEATURE_ORIENTATION
+
 static void glfm__setOrientation(GLFMPlatformData *platformData) {
     static const int ActivityInfo_SCREEN_ORIENTATION_SENSOR = 0x00000004;
     static const int ActivityInfo_SCREEN_ORIENTATION_SENSOR_LANDSCAPE = 0x00000006;
@@ -2164,11 +2879,28 @@ static void glfm__setOrientation(GLFMPlatformData *platformData) {
     glfm__clearJavaException(jni);
 }
 
+#endif // GLFM_FEATURE_ORIENTATION
+
 static void glfm__displayChromeUpdated(GLFMDisplay *display) {
     GLFMPlatformData *platformData = (GLFMPlatformData *)display->platformData;
     glfm__updateUserInterfaceChrome(platformData);
 }
 
+static void glfm__pointerLockUpdated(GLFMDisplay *display) {
+    GLFMPlatformData *platformData = (GLFMPlatformData *)display->platformData;
+    if (!display->pointerLockRequested) {
+        display->pointerLocked = false;
+    }
+    // Pointer capture requires API 26. The lock is granted when captured events are received. See
+    // glfm__onRelativeMouseEvent().
+    if (platformData->activity->sdkVersion >= 26) {
+        glfm__runOnUIThread(platformData, glfm__updatePointerCaptureCallback,
+                            display->pointerLockRequested ? platformData : NULL);
+    }
+}
+
+#if GLFM_FEATURE_SENSORS
+
 static const ASensor *glfm__getDeviceSensor(GLFMSensor sensor) {
     ASensorManager *sensorManager = ASensorManager_getInstance();
     switch (sensor) {
@@ -2185,15 +2917,32 @@ static const ASensor *glfm__getDeviceSensor(GLFMSensor sensor) {
     }
 }
 
+/// Returns true if GLFMSensorRotationMatrix is computed from other sensors, because the device
+/// doesn't have a rotation vector sensor.
+static bool glfm__isSensorFusionNeeded(void) {
+    return (glfm__getDeviceSensor(GLFMSensorRotationMatrix) == NULL &&
+            glfm__getDeviceSensor(GLFMSensorAccelerometer) != NULL &&
+            (glfm__getDeviceSensor(GLFMSensorGyroscope) != NULL ||
+             glfm__getDeviceSensor(GLFMSensorMagnetometer) != NULL));
+}
+
 static void glfm__setAllRequestedSensorsEnabled(GLFMDisplay *display, bool enabledGlobally) {
     if (!display) {
         return;
     }
     GLFMPlatformData *platformData = (GLFMPlatformData *)display->platformData;
+    bool sensorFusionEnabled = (enabledGlobally &&
+                                display->sensorFuncs[GLFMSensorRotationMatrix] != NULL &&
+                                glfm__isSensorFusionNeeded());
+    if (sensorFusionEnabled && !platformData->sensorFusionEnabled) {
+        glfm__sensorFusionReset(&platformData->sensorFusion);
+    }
+    platformData->sensorFusionEnabled = sensorFusionEnabled;
     for (int i = 0; i < GLFM_NUM_SENSORS; i++) {
         GLFMSensor sensor = (GLFMSensor)i;
         const ASensor *deviceSensor = glfm__getDeviceSensor(sensor);
-        bool isNeededEnabled = display->sensorFuncs[i] != NULL;
+        bool isNeededEnabled = (display->sensorFuncs[i] != NULL ||
+                                (sensorFusionEnabled && sensor != GLFMSensorRotationMatrix));
         bool shouldEnable = enabledGlobally && isNeededEnabled;
         bool isEnabled = platformData->deviceSensorEnabled[i];
         if (!shouldEnable) {
@@ -2231,13 +2980,21 @@ static void glfm__setAllRequestedSensorsEnabled(GLFMDisplay *display, bool enabl
     }
 }
 
+#endif // GLFM_FEATURE_SENSORS
+
 static void glfm__sensorFuncUpdated(GLFMDisplay *display) {
+#if GLFM_FEATURE_SENSORS
     if (display) {
         GLFMPlatformData *platformData = (GLFMPlatformData *)display->platformData;
         glfm__setAllRequestedSensorsEnabled(display, platformData->animating);
     }
+#else
+    (void)display;
+#endif
 }
 
+#if GLFM_FEATURE_KEYBOARD || GLFM_FEATURE_HAPTICS || GLFM_FEATURE_CLIPBOARD
+
 /// Gets an Android system service. The "serviceName" is a field from android.content.Context,
 /// like "INPUT_METHOD_SERVICE" or "VIBRATOR_SERVICE".
 ///
@@ -2269,6 +3026,10 @@ static jobject glfm__getSystemService(GLFMPlatformData *platformData, const char
     return service;
 }
 
+#endif
+
+#if GLFM_FEATURE_KEYBOARD
+
 static bool glfm__setKeyboardVisible(GLFMPlatformData *platformData, bool visible) {
     static const int InputMethodManager_SHOW_FORCED = 2;
 
@@ -2312,7 +3073,10 @@ static bool glfm__setKeyboardVisible(GLFMPlatformData *platformData, bool visibl
     return !glfm__wasJavaExceptionThrown(jni);
 }
 
+#endif // GLFM_FEATURE_KEYBOARD
+
 static void glfm__updateKeyboardVisibility(GLFMPlatformData *platformData) {
+#if GLFM_FEATURE_KEYBOARD
     if (platformData->display) {
         const ARect *contentRect = &platformData->contentRectArray[platformData->contentRectIndex];
         ARect windowRect = glfm__getDecorViewRect(platformData, contentRect);
@@ -2383,6 +3147,9 @@ static void glfm__updateKeyboardVisibility(GLFMPlatformData *platformData) {
             }
         }
     }
+#else
+    (void)platformData;
+#endif
 }
 
 // MARK: - GLFM public functions
@@ -2412,23 +3179,43 @@ double glfmGetTime(void) {
     return (double)(time.tv_sec - initTime) + (double)time.tv_nsec / 1e9;
 }
 
-void glfmSwapBuffers(GLFMDisplay *display) {
+uint64_t glfmSwapBuffers(GLFMDisplay *display) {
+#if GLFM_HAS_VULKAN
+    if (display && display->vulkan) {
+        GLFMPlatformData *platformData = (GLFMPlatformData *)display->platformData;
+        glfm__performanceHintReport(display);
+        if (!glfm__vulkanPresent(display->vulkan)) {
+            return 0;
+        }
+        platformData->swapCalled = true;
+        platformData->lastSwapTime = glfmGetTime();
+        return glfm__recordSwap(display, 0);
+    }
+#endif
     if (display) {
         GLFMPlatformData *platformData = (GLFMPlatformData *)display->platformData;
+        glfm__performanceHintReport(display);
+        glfm__eglUpdateSwapInterval(platformData);
+        const uint64_t platformFrameId = glfm__eglGetNextFrameId(platformData);
         EGLBoolean result = eglSwapBuffers(platformData->eglDisplay, platformData->eglSurface);
         platformData->swapCalled = true;
         platformData->lastSwapTime = glfmGetTime();
+        const uint64_t frameId = glfm__recordSwap(display, platformFrameId);
         if (!result) {
             glfm__eglCheckError(platformData);
         }
+        return frameId;
     }
+    return 0;
 }
 
 void glfmSetSupportedInterfaceOrientation(GLFMDisplay *display, GLFMInterfaceOrientation supportedOrientations) {
     if (display && display->supportedOrientations != supportedOrientations) {
         display->supportedOrientations = supportedOrientations;
+#if GLFM_FEATURE_ORIENTATION
         GLFMPlatformData *platformData = (GLFMPlatformData *)display->platformData;
         glfm__setOrientation(platformData);
+#endif
     }
 }
 
@@ -2528,14 +3315,19 @@ GLFMProc glfmGetProcAddress(const char *functionName) {
 
 bool glfmHasVirtualKeyboard(const GLFMDisplay *display) {
     (void)display;
-    return true;
+    return GLFM_FEATURE_KEYBOARD;
 }
 
 void glfmSetKeyboardVisible(GLFMDisplay *display, bool visible) {
+#if GLFM_FEATURE_KEYBOARD
     GLFMPlatformData *platformData = (GLFMPlatformData *)display->platformData;
     if (glfm__setKeyboardVisible(platformData, visible)) {
         glfm__updateUserInterfaceChrome(platformData);
     }
+#else
+    (void)display;
+    (void)visible;
+#endif
 }
 
 bool glfmIsKeyboardVisible(const GLFMDisplay *display) {
@@ -2545,9 +3337,19 @@ bool glfmIsKeyboardVisible(const GLFMDisplay *display) {
 
 bool glfmIsSensorAvailable(const GLFMDisplay *display, GLFMSensor sensor) {
     (void)display;
+#if GLFM_FEATURE_SENSORS
+    if (sensor == GLFMSensorRotationMatrix && glfm__isSensorFusionNeeded()) {
+        return true;
+    }
     return glfm__getDeviceSensor(sensor) != NULL;
+#else
+    (void)sensor;
+    return false;
+#endif
 }
 
+#if GLFM_FEATURE_HAPTICS
+
 bool glfmIsHapticFeedbackSupported(const GLFMDisplay *display) {
     /*
     Vibrator vibrator = (Vibrator)context.getSystemService(Context.VIBRATOR_SERVICE);
@@ -2627,6 +3429,35 @@ void glfmPerformHapticFeedback(GLFMDisplay *display, GLFMHapticFeedbackStyle sty
     (*jni)->DeleteLocalRef(jni, decorView);
 }
 
+#else
+
+bool glfmIsHapticFeedbackSupported(const GLFMDisplay *display) {
+    (void)display;
+    return false;
+}
+
+void glfmPerformHapticFeedback(GLFMDisplay *display, GLFMHapticFeedbackStyle style) {
+    (void)display;
+    (void)style;
+}
+
+#endif // GLFM_FEATURE_HAPTICS
+
+bool glfmGetWebContextInfo(const GLFMDisplay *display, GLFMWebContextInfo *info) {
+    (void)display;
+    (void)info;
+    return false;
+}
+
+void glfmRequestAsset(GLFMDisplay *display, const char *path, GLFMAssetFunc assetFunc) {
+    // Assets are in the APK, and are read with AAssetManager
+    if (display && path && assetFunc) {
+        assetFunc(display, path, true);
+    }
+}
+
+#if GLFM_FEATURE_CLIPBOARD
+
 bool glfmHasClipboardText(const GLFMDisplay *display) {
     if (!display || !display->platformData) {
         return false;
@@ -2785,6 +3616,27 @@ bool glfmSetClipboardText(GLFMDisplay *display, const char *string) {
     return !glfm__wasJavaExceptionThrown(jni);
 }
 
+#else
+
+bool glfmHasClipboardText(const GLFMDisplay *display) {
+    (void)display;
+    return false;
+}
+
+void glfmRequestClipboardText(GLFMDisplay *display, GLFMClipboardTextFunc clipboardTextFunc) {
+    if (clipboardTextFunc) {
+        clipboardTextFunc(display, NULL);
+    }
+}
+
+bool glfmSetClipboardText(GLFMDisplay *display, const char *string) {
+    (void)display;
+    (void)string;
+    return false;
+}
+
+#endif // GLFM_FEATURE_CLIPBOARD
+
 // MARK: - Platform-specific functions
 
 bool glfmIsMetalSupported(const GLFMDisplay *display) {
@@ -38,6 +38,10 @@
 #  define GLFM_LOG(...) NSLog(@__VA_ARGS__)
 #endif
 
+#include "glfm_threads.h"
+#include "glfm_jobs.h"
+#include "glfm_texture.h"
+
 #if __has_feature(objc_arc)
 #  define GLFM_AUTORELEASE(value) value
 #  define GLFM_RELEASE(value) ((void)0)
@@ -66,10 +70,29 @@ static bool glfm__isCGFloatEqual(CGFloat value1, CGFloat value2) {
 #endif
 }
 
+static bool glfm__thermalPoll(GLFMDisplay *display, double *headroom, GLFMThermalState *state) {
+    (void)display;
+    (void)headroom; // Unavailable; estimated from the state
+    if (@available(iOS 11, tvOS 11, macOS 10.10.3, *)) {
+        switch (NSProcessInfo.processInfo.thermalState) {
+            case NSProcessInfoThermalStateNominal: *state = GLFMThermalStateNominal; break;
+            case NSProcessInfoThermalStateFair: *state = GLFMThermalStateFair; break;
+            case NSProcessInfoThermalStateSerious: *state = GLFMThermalStateSerious; break;
+            case NSProcessInfoThermalStateCritical: *state = GLFMThermalStateCritical; break;
+            default: *state = GLFMThermalStateUnknown; break;
+        }
+        return true;
+    }
+    return false;
+}
+
 static void glfm__getDefaultDisplaySize(const GLFMDisplay *display,
                                         double *width, double *height, double *scale);
 static void glfm__getDrawableSize(double displayWidth, double displayHeight, double displayScale,
                                   int *width, int *height);
+#if TARGET_OS_IOS
+static GLFMInterfaceOrientation glfm__getInterfaceOrientation(UIInterfaceOrientation orientation);
+#endif
 
 // MARK: - GLFMView protocol
 
@@ -157,6 +180,8 @@ static void glfm__getDrawableSize(double displayWidth, double displayHeight, dou
 @property(nonatomic, assign) BOOL surfaceCreatedNotified;
 @property(nonatomic, assign) BOOL refreshRequested;
 @property(nonatomic, assign) BOOL isDrawing;
+@property(nonatomic, assign) GLFMLatencyMode appliedLatencyMode;
+@property(nonatomic, assign) int appliedSwapInterval;
 
 @end
 
@@ -171,6 +196,7 @@ static void glfm__getDrawableSize(double displayWidth, double displayHeight, dou
 @implementation GLFMMetalView
 
 @synthesize drawableWidth, drawableHeight, surfaceCreatedNotified, refreshRequested, isDrawing;
+@synthesize appliedLatencyMode, appliedSwapInterval;
 @synthesize glfmDisplay = _glfmDisplay, preRenderCallback = _preRenderCallback;
 @dynamic renderingAPI, animating;
 
@@ -223,6 +249,7 @@ static void glfm__getDrawableSize(double displayWidth, double displayHeight, dou
         }
         
         self.sampleCount = (glfmDisplay->multisample == GLFMMultisampleNone) ? 1 : 4;
+        self.appliedSwapInterval = -1;
     }
     return self;
 }
@@ -292,11 +319,50 @@ static void glfm__getDrawableSize(double displayWidth, double displayHeight, dou
     
 }
 
+/// Applies the latency mode and swap interval if they have changed. See glfmSetLatencyMode().
+- (void)updateSwapInterval {
+    const GLFMLatencyMode latencyMode = self.glfmDisplay->latencyMode;
+    const int swapInterval = glfmGetSwapInterval(self.glfmDisplay);
+    if (self.appliedLatencyMode == latencyMode && self.appliedSwapInterval == swapInterval) {
+        return;
+    }
+    self.appliedLatencyMode = latencyMode;
+    self.appliedSwapInterval = swapInterval;
+
+    CAMetalLayer *metalLayer = (CAMetalLayer *)self.layer;
+    if (@available(iOS 11.2, tvOS 11.2, macOS 10.13.2, *)) {
+        metalLayer.maximumDrawableCount = (latencyMode == GLFMLatencyModeLowLatency) ? 2 : 3;
+    }
+#if TARGET_OS_OSX
+    if (@available(macOS 10.13, *)) {
+        metalLayer.displaySyncEnabled = (swapInterval != 0);
+    }
+#endif
+    // MTKView's default is 60 frames per second. Use the display's maximum, so that ProMotion
+    // displays aren't limited to 60.
+    NSInteger maximumFramesPerSecond = 0;
+#if TARGET_OS_OSX
+    if (@available(macOS 12.0, *)) {
+        maximumFramesPerSecond = self.window.screen.maximumFramesPerSecond;
+    }
+#else
+    if (@available(iOS 10.3, tvOS 10.3, *)) {
+        maximumFramesPerSecond = self.window.screen.maximumFramesPerSecond;
+    }
+#endif
+    if (maximumFramesPerSecond <= 0) {
+        maximumFramesPerSecond = 60;
+    }
+    self.preferredFramesPerSecond = maximumFramesPerSecond / (swapInterval > 1 ? swapInterval : 1);
+}
+
 - (void)drawInMTKView:(MTKView *)view {
     if (self.isDrawing) {
         return;
     }
     self.isDrawing = YES;
+    [self updateSwapInterval];
+    glfm__setFrameTime(self.glfmDisplay, glfmGetTime(), 0);
     int newDrawableWidth = (int)self.drawableSize.width;
     int newDrawableHeight = (int)self.drawableSize.height;
     if (!self.surfaceCreatedNotified) {
@@ -329,9 +395,12 @@ static void glfm__getDrawableSize(double displayWidth, double displayHeight, dou
         }
     }
     
+    glfm__waitForFrameJobs(self.glfmDisplay);
+    glfm__swapInputSnapshot(self.glfmDisplay);
     if (self.glfmDisplay->renderFunc) {
         self.glfmDisplay->renderFunc(self.glfmDisplay);
     }
+    glfm__runIdleTasks(self.glfmDisplay, glfm__getIdleDeadline(self.glfmDisplay));
 
     self.isDrawing = NO;
 }
@@ -370,14 +439,14 @@ static void glfm__getDrawableSize(double displayWidth, double displayHeight, dou
 
 - (void)insertText:(id)text replacementRange:(NSRange)replacementRange {
     // Input from the Character Palette
-    if (self.glfmDisplay->charFunc) {
+    if (glfm__isCharInputNeeded(self.glfmDisplay)) {
         NSString *string;
         if ([(NSObject *)text isKindOfClass:[NSAttributedString class]]) {
             string = ((NSAttributedString *)text).string;
         } else {
             string = text;
         }
-        self.glfmDisplay->charFunc(self.glfmDisplay, string.UTF8String, 0);
+        glfm__dispatchCharEvent(self.glfmDisplay, glfmGetTime(), string.UTF8String);
     }
 }
 
@@ -448,6 +517,7 @@ static void glfm__getDrawableSize(double displayWidth, double displayHeight, dou
 @property(nonatomic, assign) BOOL surfaceSizeChanged;
 @property(nonatomic, assign) BOOL refreshRequested;
 @property(nonatomic, assign) BOOL isDrawing;
+@property(nonatomic, assign) int appliedSwapInterval;
 
 @end
 
@@ -464,6 +534,7 @@ static void glfm__getDrawableSize(double displayWidth, double displayHeight, dou
 @synthesize renderingAPI, displayLink, context, colorFormat, preserveBackbuffer;
 @synthesize depthBits, stencilBits, multisampling;
 @synthesize surfaceCreatedNotified, surfaceSizeChanged, refreshRequested, isDrawing;
+@synthesize appliedSwapInterval;
 @synthesize glfmDisplay = _glfmDisplay, preRenderCallback = _preRenderCallback;
 @dynamic drawableWidth, drawableHeight, animating;
 
@@ -477,6 +548,8 @@ static void glfm__getDrawableSize(double displayWidth, double displayHeight, dou
         
         self.contentScaleFactor = contentScaleFactor;
         self.glfmDisplay = glfmDisplay;
+        glfmDisplay->textureFormats = 0; // New context
+        self.appliedSwapInterval = -1;
         [self requestRefresh];
         
         if (glfmDisplay->preferredAPI >= GLFMRenderingAPIOpenGLES3) {
@@ -570,6 +643,7 @@ static void glfm__getDrawableSize(double displayWidth, double displayHeight, dou
         } else {
             self.displayLink = [CADisplayLink displayLinkWithTarget:self
                                                            selector:@selector(render:)];
+            self.appliedSwapInterval = -1;
             [self.displayLink addToRunLoop:[NSRunLoop mainRunLoop] forMode:NSRunLoopCommonModes];
         }
     }
@@ -773,13 +847,30 @@ static void glfm__getDrawableSize(double displayWidth, double displayHeight, dou
     GLFM_CHECK_GL_ERROR();
 }
 
+/// Applies the swap interval if it has changed. See glfmSetSwapInterval().
+- (void)updateSwapInterval {
+    const int swapInterval = glfmGetSwapInterval(self.glfmDisplay);
+    if (self.appliedSwapInterval == swapInterval) {
+        return;
+    }
+    self.appliedSwapInterval = swapInterval;
+    if (@available(iOS 10.3, tvOS 10.3, *)) {
+        // Zero is the display's maximum frame rate
+        NSInteger maximumFramesPerSecond = self.window.screen.maximumFramesPerSecond;
+        self.displayLink.preferredFramesPerSecond = (swapInterval > 1 ?
+                                                     maximumFramesPerSecond / swapInterval : 0);
+    }
+}
+
 - (void)render:(CADisplayLink *)displayLink {
     if (self.isDrawing) {
         return;
     }
     self.isDrawing = YES;
+    [self updateSwapInterval];
     
     [EAGLContext setCurrentContext:self.context];
+    glfm__setFrameTime(self.glfmDisplay, displayLink.timestamp, displayLink.targetTimestamp);
     
     if (!self.surfaceCreatedNotified) {
         self.surfaceCreatedNotified = YES;
@@ -809,10 +900,13 @@ static void glfm__getDrawableSize(double displayWidth, double displayHeight, dou
             self.glfmDisplay->surfaceRefreshFunc(self.glfmDisplay);
         }
     }
+    glfm__waitForFrameJobs(self.glfmDisplay);
+    glfm__swapInputSnapshot(self.glfmDisplay);
     if (self.glfmDisplay->renderFunc) {
         [self prepareRender];
         self.glfmDisplay->renderFunc(self.glfmDisplay);
     }
+    glfm__runIdleTasks(self.glfmDisplay, glfm__getIdleDeadline(self.glfmDisplay));
 
     self.isDrawing = NO;
 }
@@ -865,6 +959,7 @@ static void glfm__getDrawableSize(double displayWidth, double displayHeight, dou
 @property(nonatomic, assign) BOOL surfaceCreatedNotified;
 @property(nonatomic, assign) BOOL refreshRequested;
 @property(nonatomic, assign) BOOL isDrawing;
+@property(nonatomic, assign) int appliedSwapInterval;
 
 @end
 
@@ -875,7 +970,7 @@ static void glfm__getDrawableSize(double displayWidth, double displayHeight, dou
 
 @synthesize glfmDisplay = _glfmDisplay, preRenderCallback = _preRenderCallback;
 @synthesize drawableWidth, drawableHeight;
-@synthesize surfaceCreatedNotified, refreshRequested, isDrawing;
+@synthesize surfaceCreatedNotified, refreshRequested, isDrawing, appliedSwapInterval;
 @dynamic renderingAPI, animating;
 
 - (instancetype)initWithFrame:(CGRect)frame
@@ -960,11 +1055,11 @@ static void glfm__getDrawableSize(double displayWidth, double displayHeight, dou
         return nil;
     }
     
-    GLint swapInterval = 1;
-    [openGLContext setValues:&swapInterval forParameter:NSOpenGLContextParameterSwapInterval];
+    self.appliedSwapInterval = -1;
     self.wantsBestResolutionOpenGLSurface = YES;
     self.layerContentsPlacement = NSViewLayerContentsPlacementTopLeft;
     self.glfmDisplay = glfmDisplay;
+    glfmDisplay->textureFormats = 0; // New context
 
 #if 0
     // Print attributes
@@ -1063,6 +1158,16 @@ static void glfm__getDrawableSize(double displayWidth, double displayHeight, dou
     }
 }
 
+/// Applies the swap interval if it has changed. See glfmSetSwapInterval().
+- (void)updateSwapInterval {
+    const int swapInterval = glfmGetSwapInterval(self.glfmDisplay);
+    if (self.appliedSwapInterval != swapInterval) {
+        self.appliedSwapInterval = swapInterval;
+        GLint value = swapInterval > 0 ? 1 : 0;
+        [self.openGLContext setValues:&value forParameter:NSOpenGLContextParameterSwapInterval];
+    }
+}
+
 - (void)draw {
     if (self.isDrawing) {
         return;
@@ -1075,6 +1180,8 @@ static void glfm__getDrawableSize(double displayWidth, double displayHeight, dou
     assert([NSThread isMainThread]);
 
     [self.openGLContext makeCurrentContext];
+    [self updateSwapInterval];
+    glfm__setFrameTime(self.glfmDisplay, glfmGetTime(), 0);
 
     if (!self.surfaceCreatedNotified) {
         self.surfaceCreatedNotified = YES;
@@ -1106,9 +1213,12 @@ static void glfm__getDrawableSize(double displayWidth, double displayHeight, dou
         }
     }
     
+    glfm__waitForFrameJobs(self.glfmDisplay);
+    glfm__swapInputSnapshot(self.glfmDisplay);
     if (self.glfmDisplay->renderFunc) {
         self.glfmDisplay->renderFunc(self.glfmDisplay);
     }
+    glfm__runIdleTasks(self.glfmDisplay, glfm__getIdleDeadline(self.glfmDisplay));
 
     self.isDrawing = NO;
 }
@@ -1140,14 +1250,14 @@ static void glfm__getDrawableSize(double displayWidth, double displayHeight, dou
 
 - (void)insertText:(id)text replacementRange:(NSRange)replacementRange {
     // Input from the Character Palette
-    if (self.glfmDisplay->charFunc) {
+    if (glfm__isCharInputNeeded(self.glfmDisplay)) {
         NSString *string;
         if ([(NSObject *)text isKindOfClass:[NSAttributedString class]]) {
             string = ((NSAttributedString *)text).string;
         } else {
             string = text;
         }
-        self.glfmDisplay->charFunc(self.glfmDisplay, string.UTF8String, 0);
+        glfm__dispatchCharEvent(self.glfmDisplay, glfmGetTime(), string.UTF8String);
     }
 }
 
@@ -1280,6 +1390,8 @@ static void glfm__getDrawableSize(double displayWidth, double displayHeight, dou
         self.glfmDisplay = calloc(1, sizeof(GLFMDisplay));
         self.glfmDisplay->platformData = (__bridge void *)self;
         self.glfmDisplay->supportedOrientations = GLFMInterfaceOrientationAll;
+        self.glfmDisplay->swapInterval = -1;
+        self.glfmDisplay->thermalPollFunc = glfm__thermalPoll;
         self.defaultFrame = frame;
         self.defaultContentScale = contentScale;
 
@@ -1320,6 +1432,7 @@ static void glfm__getDrawableSize(double displayWidth, double displayHeight, dou
 }
 
 - (void)dealloc {
+    glfmDestroyJobCounter(self.glfmDisplay->frameJobCounter);
     if (self.glfmViewIfLoaded.surfaceCreatedNotified && self.glfmDisplay->surfaceDestroyedFunc) {
         self.glfmDisplay->surfaceDestroyedFunc(self.glfmDisplay);
     }
@@ -1583,41 +1696,44 @@ static void glfm__getDrawableSize(double displayWidth, double displayHeight, dou
         // No readings yet
         return;
     }
-    GLFMSensorFunc accelerometerFunc = self.glfmDisplay->sensorFuncs[GLFMSensorAccelerometer];
-    if (accelerometerFunc) {
+    GLFMInterfaceOrientation orientation = GLFMInterfaceOrientationPortrait;
+    if (self.glfmDisplay->sensorRemappingEnabled) {
+        orientation = glfm__getInterfaceOrientation(self.orientation);
+    }
+    if (self.glfmDisplay->sensorFuncs[GLFMSensorAccelerometer]) {
         GLFMSensorEvent event = { 0 };
         event.sensor = GLFMSensorAccelerometer;
         event.timestamp = deviceMotion.timestamp;
         event.vector.x = deviceMotion.userAcceleration.x + deviceMotion.gravity.x;
         event.vector.y = deviceMotion.userAcceleration.y + deviceMotion.gravity.y;
         event.vector.z = deviceMotion.userAcceleration.z + deviceMotion.gravity.z;
-        accelerometerFunc(self.glfmDisplay, event);
+        glfm__remapSensorEvent(&event, orientation);
+        glfm__dispatchSensorEvent(self.glfmDisplay, event);
     }
     
-    GLFMSensorFunc magnetometerFunc = self.glfmDisplay->sensorFuncs[GLFMSensorMagnetometer];
-    if (magnetometerFunc) {
+    if (self.glfmDisplay->sensorFuncs[GLFMSensorMagnetometer]) {
         GLFMSensorEvent event = { 0 };
         event.sensor = GLFMSensorMagnetometer;
         event.timestamp = deviceMotion.timestamp;
         event.vector.x = deviceMotion.magneticField.field.x;
         event.vector.y = deviceMotion.magneticField.field.y;
         event.vector.z = deviceMotion.magneticField.field.z;
-        magnetometerFunc(self.glfmDisplay, event);
+        glfm__remapSensorEvent(&event, orientation);
+        glfm__dispatchSensorEvent(self.glfmDisplay, event);
     }
     
-    GLFMSensorFunc gyroscopeFunc = self.glfmDisplay->sensorFuncs[GLFMSensorGyroscope];
-    if (gyroscopeFunc) {
+    if (self.glfmDisplay->sensorFuncs[GLFMSensorGyroscope]) {
         GLFMSensorEvent event = { 0 };
         event.sensor = GLFMSensorGyroscope;
         event.timestamp = deviceMotion.timestamp;
         event.vector.x = deviceMotion.rotationRate.x;
         event.vector.y = deviceMotion.rotationRate.y;
         event.vector.z = deviceMotion.rotationRate.z;
-        gyroscopeFunc(self.glfmDisplay, event);
+        glfm__remapSensorEvent(&event, orientation);
+        glfm__dispatchSensorEvent(self.glfmDisplay, event);
     }
     
-    GLFMSensorFunc rotationFunc = self.glfmDisplay->sensorFuncs[GLFMSensorRotationMatrix];
-    if (rotationFunc) {
+    if (self.glfmDisplay->sensorFuncs[GLFMSensorRotationMatrix]) {
         GLFMSensorEvent event = { 0 };
         event.sensor = GLFMSensorRotationMatrix;
         event.timestamp = deviceMotion.timestamp;
@@ -1625,7 +1741,8 @@ static void glfm__getDrawableSize(double displayWidth, double displayHeight, dou
         event.matrix.m00 = matrix.m11; event.matrix.m01 = matrix.m12; event.matrix.m02 = matrix.m13;
         event.matrix.m10 = matrix.m21; event.matrix.m11 = matrix.m22; event.matrix.m12 = matrix.m23;
         event.matrix.m20 = matrix.m31; event.matrix.m21 = matrix.m32; event.matrix.m22 = matrix.m33;
-        rotationFunc(self.glfmDisplay, event);
+        glfm__remapSensorEvent(&event, orientation);
+        glfm__dispatchSensorEvent(self.glfmDisplay, event);
     }
 }
 
@@ -1694,13 +1811,14 @@ static void glfm__getDrawableSize(double displayWidth, double displayHeight, dou
         activeTouches[index] = (__bridge const void *)touch;
     }
 
-    if (self.glfmDisplay->touchFunc) {
+    if (glfm__isTouchInputNeeded(self.glfmDisplay)) {
         CGPoint currLocation = [touch locationInView:self.view];
         currLocation.x *= self.view.contentScaleFactor;
         currLocation.y *= self.view.contentScaleFactor;
 
-        self.glfmDisplay->touchFunc(self.glfmDisplay, index, phase,
-                                    (double)currLocation.x, (double)currLocation.y);
+        // Event timestamps are in the glfmGetTime() timebase (time since startup)
+        glfm__dispatchTouchEvent(self.glfmDisplay, touch.timestamp, index, phase,
+                                 (double)currLocation.x, (double)currLocation.y);
     }
 
     if (phase == GLFMTouchPhaseEnded || phase == GLFMTouchPhaseCancelled) {
@@ -1735,14 +1853,15 @@ static void glfm__getDrawableSize(double displayWidth, double displayHeight, dou
 #if TARGET_OS_IOS
 
 - (void)hover:(UIHoverGestureRecognizer *)recognizer API_AVAILABLE(ios(13.4)) {
-    if (self.glfmDisplay->touchFunc && (recognizer.state == UIGestureRecognizerStateBegan ||
-                                        recognizer.state == UIGestureRecognizerStateChanged)) {
+    if (glfm__isTouchInputNeeded(self.glfmDisplay) &&
+        (recognizer.state == UIGestureRecognizerStateBegan ||
+         recognizer.state == UIGestureRecognizerStateChanged)) {
         CGPoint currLocation = [recognizer locationInView:self.view];
         currLocation.x *= self.view.contentScaleFactor;
         currLocation.y *= self.view.contentScaleFactor;
 
-        self.glfmDisplay->touchFunc(self.glfmDisplay, 0, GLFMTouchPhaseHover,
-                                    (double)currLocation.x, (double)currLocation.y);
+        glfm__dispatchTouchEvent(self.glfmDisplay, glfmGetTime(), 0, GLFMTouchPhaseHover,
+                                 (double)currLocation.x, (double)currLocation.y);
     }
 }
 
@@ -1770,11 +1889,11 @@ static void glfm__getDrawableSize(double displayWidth, double displayHeight, dou
 
 - (BOOL)handlePress:(UIPress *)press withAction:(GLFMKeyAction)action {
 #if TARGET_OS_IOS
-    if (!self.glfmDisplay->keyFunc) {
+    if (!glfm__isKeyInputNeeded(self.glfmDisplay)) {
         return NO;
     }
 #elif TARGET_OS_TV
-    if (!self.glfmDisplay->keyFunc && !self.glfmDisplay->charFunc) {
+    if (!glfm__isKeyInputNeeded(self.glfmDisplay) && !glfm__isCharInputNeeded(self.glfmDisplay)) {
         return NO;
     }
 #endif
@@ -1935,7 +2054,8 @@ static void glfm__getDrawableSize(double displayWidth, double displayHeight, dou
             if (key.keyCode >= 0 && (size_t)key.keyCode < sizeof(HID_MAP) / sizeof(*HID_MAP)) {
                 keyCode = HID_MAP[key.keyCode];
             }
-            if (self.isFirstResponder && self.glfmDisplay->charFunc != NULL &&
+            if (self.isFirstResponder &&
+                glfm__isCharInputNeeded(self.glfmDisplay) &&
                 action != GLFMKeyActionReleased && !isControlKey &&
                 keyCode >= GLFMKeyCodeSpace && keyCode != GLFMKeyCodeDelete) {
                 NSString *chars = key.charactersIgnoringModifiers;
@@ -1958,8 +2078,10 @@ static void glfm__getDrawableSize(double displayWidth, double displayHeight, dou
         // The tab key on the Magic Keyboard sends two UIPress events. For the second one, press.key=nil and press.type=0xcb.
         return NO;
     }
-    BOOL handled = self.glfmDisplay->keyFunc(self.glfmDisplay, keyCode, action, modifierFlags);
-    if (self.isFirstResponder && isPrintable && self.glfmDisplay->charFunc) {
+    BOOL handled = glfm__dispatchKeyEvent(self.glfmDisplay, press.timestamp, keyCode, action,
+                                          modifierFlags);
+    if (self.isFirstResponder && isPrintable &&
+        glfm__isCharInputNeeded(self.glfmDisplay)) {
         // Send text via insertText.
         return NO;
     }
@@ -2002,12 +2124,14 @@ static void glfm__getDrawableSize(double displayWidth, double displayHeight, dou
     }
 
     BOOL handled = NO;
-    if (self.glfmDisplay->keyFunc) {
-        handled = self.glfmDisplay->keyFunc(self.glfmDisplay, keyCode, action, modifierFlags);
+    if (glfm__isKeyInputNeeded(self.glfmDisplay)) {
+        handled = glfm__dispatchKeyEvent(self.glfmDisplay, press.timestamp, keyCode, action,
+                                         modifierFlags);
     }
     if (@available(iOS 13.4, tvOS 13.4, *)) {
-        if (self.isFirstResponder && hasKey && isPrintable && self.glfmDisplay->charFunc) {
-            self.glfmDisplay->charFunc(self.glfmDisplay, press.key.characters.UTF8String, 0);
+        if (self.isFirstResponder && hasKey && isPrintable &&
+            glfm__isCharInputNeeded(self.glfmDisplay)) {
+            glfm__dispatchCharEvent(self.glfmDisplay, press.timestamp, press.key.characters.UTF8String);
         }
     }
     return handled;
@@ -2110,34 +2234,24 @@ static void glfm__getDrawableSize(double displayWidth, double displayHeight, dou
 }
 
 - (void)insertText:(NSString *)text {
+    const double timestamp = glfmGetTime();
     if ([text isEqualToString:@"\n"]) {
-        if (self.glfmDisplay->keyFunc) {
-            self.glfmDisplay->keyFunc(self.glfmDisplay, GLFMKeyCodeEnter, GLFMKeyActionPressed, 0);
-        }
-        if (self.glfmDisplay->keyFunc) {
-            self.glfmDisplay->keyFunc(self.glfmDisplay, GLFMKeyCodeEnter, GLFMKeyActionReleased, 0);
-        }
+        glfm__dispatchKeyEvent(self.glfmDisplay, timestamp, GLFMKeyCodeEnter, GLFMKeyActionPressed, 0);
+        glfm__dispatchKeyEvent(self.glfmDisplay, timestamp, GLFMKeyCodeEnter, GLFMKeyActionReleased, 0);
     } else if ([text isEqualToString:@"\t"]) {
-        if (self.glfmDisplay->keyFunc) {
-            self.glfmDisplay->keyFunc(self.glfmDisplay, GLFMKeyCodeTab, GLFMKeyActionPressed, 0);
-        }
-        if (self.glfmDisplay->keyFunc) {
-            self.glfmDisplay->keyFunc(self.glfmDisplay, GLFMKeyCodeTab, GLFMKeyActionReleased, 0);
-        }
-    } else if (self.glfmDisplay->charFunc) {
-        self.glfmDisplay->charFunc(self.glfmDisplay, text.UTF8String, 0);
+        glfm__dispatchKeyEvent(self.glfmDisplay, timestamp, GLFMKeyCodeTab, GLFMKeyActionPressed, 0);
+        glfm__dispatchKeyEvent(self.glfmDisplay, timestamp, GLFMKeyCodeTab, GLFMKeyActionReleased, 0);
+    } else {
+        glfm__dispatchCharEvent(self.glfmDisplay, timestamp, text.UTF8String);
     }
 }
 
 - (void)deleteBackward {
     // NOTE: This method is called for key repeat events when using a hardware keyboard, but not
     // when using the software keyboard.
-    if (self.glfmDisplay->keyFunc) {
-        self.glfmDisplay->keyFunc(self.glfmDisplay, GLFMKeyCodeBackspace, GLFMKeyActionPressed, 0);
-    }
-    if (self.glfmDisplay->keyFunc) {
-        self.glfmDisplay->keyFunc(self.glfmDisplay, GLFMKeyCodeBackspace, GLFMKeyActionReleased, 0);
-    }
+    const double timestamp = glfmGetTime();
+    glfm__dispatchKeyEvent(self.glfmDisplay, timestamp, GLFMKeyCodeBackspace, GLFMKeyActionPressed, 0);
+    glfm__dispatchKeyEvent(self.glfmDisplay, timestamp, GLFMKeyCodeBackspace, GLFMKeyActionReleased, 0);
 }
 
 #endif // TARGET_OS_IOS
@@ -2185,12 +2299,9 @@ static void glfm__getDrawableSize(double displayWidth, double displayHeight, dou
     } else if (key == UIKeyInputPageDown) {
         keyCode = GLFMKeyCodePageDown;
     }
-    if (self.glfmDisplay->keyFunc) {
-        self.glfmDisplay->keyFunc(self.glfmDisplay, keyCode, GLFMKeyActionPressed, 0);
-    }
-    if (self.glfmDisplay->keyFunc) {
-        self.glfmDisplay->keyFunc(self.glfmDisplay, keyCode, GLFMKeyActionReleased, 0);
-    }
+    const double timestamp = glfmGetTime();
+    glfm__dispatchKeyEvent(self.glfmDisplay, timestamp, keyCode, GLFMKeyActionPressed, 0);
+    glfm__dispatchKeyEvent(self.glfmDisplay, timestamp, keyCode, GLFMKeyActionReleased, 0);
 }
 
 #endif // TARGET_OS_IOS || TARGET_OS_TV
@@ -2224,7 +2335,14 @@ static void glfm__getDrawableSize(double displayWidth, double displayHeight, dou
 }
 
 - (void)sendMouseEvent:(NSEvent *)event withType:(GLFMTouchPhase)phase {
-    if (!self.glfmDisplay->touchFunc) {
+    if (self.glfmDisplay->pointerLocked &&
+        (phase == GLFMTouchPhaseHover || phase == GLFMTouchPhaseMoved)) {
+        // The cursor doesn't move while locked. Deltas are in points, with sub-pixel precision.
+        CGFloat scale = self.glfmViewIfLoaded.window.backingScaleFactor;
+        glfm__addRelativeMouseMotion(self.glfmDisplay, event.deltaX * scale, event.deltaY * scale);
+        return;
+    }
+    if (!glfm__isTouchInputNeeded(self.glfmDisplay)) {
         return;
     }
 
@@ -2240,7 +2358,8 @@ static void glfm__getDrawableSize(double displayWidth, double displayHeight, dou
         }
     }
 
-    self.glfmDisplay->touchFunc(self.glfmDisplay, (int)event.buttonNumber, phase, x, y);
+    // Event timestamps are in the glfmGetTime() timebase (time since startup)
+    glfm__dispatchTouchEvent(self.glfmDisplay, event.timestamp, (int)event.buttonNumber, phase, x, y);
 }
 
 - (void)mouseMoved:(NSEvent *)event {
@@ -2284,7 +2403,7 @@ static void glfm__getDrawableSize(double displayWidth, double displayHeight, dou
 }
 
 - (void)scrollWheel:(NSEvent *)event {
-    if (!self.glfmDisplay->mouseWheelFunc) {
+    if (!glfm__isMouseWheelInputNeeded(self.glfmDisplay)) {
         return;
     }
 
@@ -2299,7 +2418,8 @@ static void glfm__getDrawableSize(double displayWidth, double displayHeight, dou
     GLFMMouseWheelDeltaType deltaType = (event.hasPreciseScrollingDeltas ? GLFMMouseWheelDeltaPixel
                                          : GLFMMouseWheelDeltaLine);
 
-    self.glfmDisplay->mouseWheelFunc(self.glfmDisplay, x, y, deltaType, deltaX, deltaY, 0.0);
+    glfm__dispatchMouseWheelEvent(self.glfmDisplay, event.timestamp, x, y, deltaType, deltaX, deltaY,
+                                  0.0);
 }
 
 - (void)cursorUpdate:(NSEvent *)event {
@@ -2342,7 +2462,7 @@ static void glfm__getDrawableSize(double displayWidth, double displayHeight, dou
     BOOL handled = NO;
 
     // Send key event
-    if (self.glfmDisplay->keyFunc) {
+    if (glfm__isKeyInputNeeded(self.glfmDisplay)) {
         static const GLFMKeyCode VK_MAP[] = {
             [kVK_Return]                    = GLFMKeyCodeEnter,
             [kVK_Tab]                       = GLFMKeyCodeTab,
@@ -2479,11 +2599,11 @@ static void glfm__getDrawableSize(double displayWidth, double displayHeight, dou
             modifiers |= GLFMKeyModifierFunction;
         }
 
-        handled = self.glfmDisplay->keyFunc(self.glfmDisplay, keyCode, action, modifiers);
+        handled = glfm__dispatchKeyEvent(self.glfmDisplay, event.timestamp, keyCode, action, modifiers);
     }
 
     // Send char event
-    if (self.glfmDisplay->charFunc &&
+    if (glfm__isCharInputNeeded(self.glfmDisplay) &&
         event.type == NSEventTypeKeyDown &&
         (event.modifierFlags & NSEventModifierFlagFunction) == 0 &&
         (event.modifierFlags & NSEventModifierFlagCommand) == 0 &&
@@ -2518,7 +2638,7 @@ static void glfm__getDrawableSize(double displayWidth, double displayHeight, dou
             if (self.hideMouseCursorWhileTyping) {
                 [NSCursor setHiddenUntilMouseMoves:YES];
             }
-            self.glfmDisplay->charFunc(self.glfmDisplay, utf8, 0);
+            glfm__dispatchCharEvent(self.glfmDisplay, event.timestamp, utf8);
         }
     }
     return handled;
@@ -2574,6 +2694,36 @@ static void glfm__getDrawableSize(double displayWidth, double displayHeight, dou
     self.deadKeyState = 0;
 }
 
+// MARK: Pointer lock
+
+/// Locks or unlocks the cursor to match the pointer lock request. The cursor is only locked while
+/// the window is active.
+- (void)updatePointerLock {
+    GLFMDisplay *display = self.glfmDisplay;
+    if (!display) {
+        return;
+    }
+    GLFMWindow *window = (GLFMWindow *)self.glfmViewIfLoaded.window;
+    BOOL locked = display->pointerLockRequested && window.active;
+    if (locked == display->pointerLocked) {
+        return;
+    }
+    if (locked) {
+        // Move the cursor to the center of the view, so that clicks stay in the window.
+        // Quartz coordinates are flipped relative to the main screen.
+        NSView *view = self.glfmViewIfLoaded;
+        NSRect frame = [window convertRectToScreen:[view convertRect:view.bounds toView:nil]];
+        CGFloat mainScreenHeight = NSScreen.screens.firstObject.frame.size.height;
+        CGWarpMouseCursorPosition(CGPointMake(NSMidX(frame), mainScreenHeight - NSMidY(frame)));
+        CGAssociateMouseAndMouseCursorPosition(false);
+        [NSCursor hide];
+    } else {
+        CGAssociateMouseAndMouseCursorPosition(true);
+        [NSCursor unhide];
+    }
+    display->pointerLocked = locked;
+}
+
 #endif // TARGET_OS_OSX
 
 @end // GLFMViewController
@@ -2593,6 +2743,9 @@ static void glfm__getDrawableSize(double displayWidth, double displayHeight, dou
 #else
         GLFMViewController *viewController = (GLFMViewController *)self.rootViewController;
 #endif
+        if (viewController.glfmDisplay) {
+            glfm__setSuspended(viewController.glfmDisplay, !_active);
+        }
         if (viewController.glfmDisplay && viewController.glfmDisplay->focusFunc) {
             viewController.glfmDisplay->focusFunc(viewController.glfmDisplay, _active);
         }
@@ -2614,6 +2767,7 @@ static void glfm__getDrawableSize(double displayWidth, double displayHeight, dou
 #endif
 #if TARGET_OS_OSX
         [viewController clearActiveKeys];
+        [viewController updatePointerLock];
 #endif
     }
 }
@@ -3102,6 +3256,18 @@ static void glfm__sensorFuncUpdated(GLFMDisplay *display) {
 #endif
 }
 
+static void glfm__pointerLockUpdated(GLFMDisplay *display) {
+#if TARGET_OS_OSX
+    if (display && display->platformData) {
+        GLFMViewController *viewController = (__bridge GLFMViewController *)display->platformData;
+        [viewController updatePointerLock];
+    }
+#else
+    (void)display;
+    // No mouse pointer to lock
+#endif
+}
+
 // MARK: - GLFM public functions
 
 double glfmGetTime(void) {
@@ -3116,11 +3282,13 @@ GLFMProc glfmGetProcAddress(const char *functionName) {
     return handle ? (GLFMProc)dlsym(handle, functionName) : NULL;
 }
 
-void glfmSwapBuffers(GLFMDisplay *display) {
+uint64_t glfmSwapBuffers(GLFMDisplay *display) {
     if (display && display->platformData) {
         GLFMViewController *viewController = (__bridge GLFMViewController *)display->platformData;
         [viewController.glfmViewIfLoaded swapBuffers];
+        return glfm__recordSwap(display, 0);
     }
+    return 0;
 }
 
 void glfmSetSupportedInterfaceOrientation(GLFMDisplay *display, GLFMInterfaceOrientation supportedOrientations) {
@@ -3145,10 +3313,9 @@ void glfmSetSupportedInterfaceOrientation(GLFMDisplay *display, GLFMInterfaceOri
     }
 }
 
-GLFMInterfaceOrientation glfmGetInterfaceOrientation(const GLFMDisplay *display) {
-    (void)display;
 #if TARGET_OS_IOS
-    UIInterfaceOrientation orientation = [[UIApplication sharedApplication] statusBarOrientation];
+
+static GLFMInterfaceOrientation glfm__getInterfaceOrientation(UIInterfaceOrientation orientation) {
     switch (orientation) {
         case UIInterfaceOrientationPortrait:
             return GLFMInterfaceOrientationPortrait;
@@ -3161,6 +3328,14 @@ GLFMInterfaceOrientation glfmGetInterfaceOrientation(const GLFMDisplay *display)
         case UIInterfaceOrientationUnknown: default:
             return GLFMInterfaceOrientationUnknown;
     }
+}
+
+#endif
+
+GLFMInterfaceOrientation glfmGetInterfaceOrientation(const GLFMDisplay *display) {
+    (void)display;
+#if TARGET_OS_IOS
+    return glfm__getInterfaceOrientation([[UIApplication sharedApplication] statusBarOrientation]);
 #else
     return GLFMInterfaceOrientationUnknown;
 #endif
@@ -3455,6 +3630,19 @@ void glfmPerformHapticFeedback(GLFMDisplay *display, GLFMHapticFeedbackStyle sty
 #endif
 }
 
+bool glfmGetWebContextInfo(const GLFMDisplay *display, GLFMWebContextInfo *info) {
+    (void)display;
+    (void)info;
+    return false;
+}
+
+void glfmRequestAsset(GLFMDisplay *display, const char *path, GLFMAssetFunc assetFunc) {
+    // Assets are in the app bundle
+    if (display && path && assetFunc) {
+        assetFunc(display, path, true);
+    }
+}
+
 #if TARGET_OS_TV
 
 bool glfmHasClipboardText(const GLFMDisplay *display) {
@@ -3544,6 +3732,11 @@ bool glfmIsMetalSupported(const GLFMDisplay *display) {
     return false;
 }
 
+bool glfmIsVulkanSupported(const GLFMDisplay *display) {
+    (void)display;
+    return false;
+}
+
 void *glfmGetMetalView(const GLFMDisplay *display) {
 #if GLFM_INCLUDE_METAL
     if (display) {
@@ -9,6 +9,7 @@
 #include <emscripten/emscripten.h>
 #include <emscripten/html5.h>
 #include <math.h>
+#include <stddef.h>
 #include <stdlib.h>
 #include <sys/time.h>
 #include <time.h>
@@ -21,8 +22,33 @@
 #  define GLFM_LOG(...) do { printf("%.3f: ", glfmGetTime()); printf(__VA_ARGS__); printf("\n"); } while (0)
 #endif
 
+#include "glfm_threads.h"
+#include "glfm_jobs.h"
+#include "glfm_texture.h"
+
 #define GLFM_MAX_ACTIVE_TOUCHES 10
 
+// If 1, the canvas is transferred to an OffscreenCanvas, and glfmMain() and all rendering run on a
+// worker thread. DOM events are forwarded from the browser's main thread through a ring buffer.
+// Requires linking with -pthread, -sPROXY_TO_PTHREAD, and -sOFFSCREENCANVAS_SUPPORT.
+#ifndef GLFM_EMSCRIPTEN_OFFSCREEN_CANVAS
+#  define GLFM_EMSCRIPTEN_OFFSCREEN_CANVAS 0
+#endif
+
+#if GLFM_EMSCRIPTEN_OFFSCREEN_CANVAS
+#  if !defined(__EMSCRIPTEN_PTHREADS__)
+#    error GLFM_EMSCRIPTEN_OFFSCREEN_CANVAS requires building with -pthread
+#  endif
+#  define GLFM_EVENT_RING_CAPACITY 512
+#  define GLFM_PAUSED_EVENT_POLL_INTERVAL_MS 100
+#endif
+
+// Sensor samples are written by JavaScript event listeners and read once per frame.
+#define GLFM_SENSOR_RING_CAPACITY 256
+#define GLFM_SENSOR_RING_RECORD_SIZE 8
+#define GLFM_STANDARD_GRAVITY 9.80665
+#define GLFM_DEGREES_TO_RADIANS (3.14159265358979323846 / 180.0)
+
 // If 1, test if keyboard event arrays are sorted.
 #define GLFM_TEST_KEYBOARD_EVENT_ARRAYS 0
 
@@ -39,6 +65,101 @@ typedef struct {
     bool active;
 } GLFMActiveTouch;
 
+// Record types in the sensor ring. Each record is GLFM_SENSOR_RING_RECORD_SIZE doubles:
+// { type, timestamp, values... }
+typedef enum {
+    // { accelerationIncludingGravity x, y, z, rotationRate alpha, beta, gamma }
+    GLFMSensorRecordMotion = 1,
+    // { alpha, beta, gamma }
+    GLFMSensorRecordOrientation = 2,
+    // { x, y, z }
+    GLFMSensorRecordMagnetometer = 3,
+} GLFMSensorRecordType;
+
+typedef struct {
+    double records[GLFM_SENSOR_RING_CAPACITY * GLFM_SENSOR_RING_RECORD_SIZE];
+    uint32_t writeIndex; // Written by JavaScript
+    uint32_t readIndex;
+} GLFMSensorRing;
+
+typedef enum {
+    GLFMAssetRequestStatePending = 0,
+    GLFMAssetRequestStateLoading = 1,
+    GLFMAssetRequestStateAvailable = 2,
+    GLFMAssetRequestStateFailed = 3,
+} GLFMAssetRequestState;
+
+typedef struct GLFMAssetRequest {
+    struct GLFMAssetRequest *next;
+    GLFMAssetFunc assetFunc;
+    int32_t state; // GLFMAssetRequestState. Set from JavaScript.
+    char path[];
+} GLFMAssetRequest;
+
+#if GLFM_EMSCRIPTEN_OFFSCREEN_CANVAS
+
+// DOM event types forwarded to the worker thread. The values are used in JavaScript.
+typedef enum {
+    GLFMForwardedEventMouseDown = 1,
+    GLFMForwardedEventMouseUp = 2,
+    GLFMForwardedEventMouseMove = 3,
+    GLFMForwardedEventWheel = 4,
+    GLFMForwardedEventTouchStart = 5,
+    GLFMForwardedEventTouchMove = 6,
+    GLFMForwardedEventTouchEnd = 7,
+    GLFMForwardedEventTouchCancel = 8,
+    GLFMForwardedEventKeyDown = 9,
+    GLFMForwardedEventKeyUp = 10,
+    GLFMForwardedEventKeyPress = 11,
+    GLFMForwardedEventFocus = 12,
+    GLFMForwardedEventBlur = 13,
+    GLFMForwardedEventVisibilityChange = 14,
+    GLFMForwardedEventBeforeUnload = 15,
+    GLFMForwardedEventResize = 16,
+    GLFMForwardedEventOrientationChange = 17,
+    GLFMForwardedEventFreeze = 18,
+    GLFMForwardedEventResume = 19,
+    GLFMForwardedEventPointerLockChange = 20,
+    GLFMForwardedEventRelativeMouseMove = 21,
+} GLFMForwardedEventType;
+
+// Flags written by the worker thread, read by JavaScript to decide whether to call
+// preventDefault(), which has to be decided before the event is handled.
+typedef enum {
+    GLFMForwardedEventFlagTouch = (1 << 0),
+    GLFMForwardedEventFlagKey = (1 << 1),
+    GLFMForwardedEventFlagWheel = (1 << 2),
+} GLFMForwardedEventFlag;
+
+// The layout is used in JavaScript. See glfm__startEventForwarding().
+typedef struct {
+    int32_t type;
+    int32_t value0; // Button, touch identifier, modifiers, hidden or locked flag, or wheel x position
+    int32_t value1; // Mouse inside canvas, key repeat, or wheel delta mode
+    int32_t value2; // Wheel y position
+    double x; // Canvas-relative position, wheel delta, relative motion, or CSS width
+    double y; // Canvas-relative position, wheel delta, relative motion, or CSS height
+    double z; // Wheel delta or device pixel ratio
+    char key[32];
+    char code[32];
+    double time; // performance.timeOrigin + event.timeStamp, which is comparable between threads
+} GLFMForwardedEvent;
+
+_Static_assert(offsetof(GLFMForwardedEvent, x) == 16, "GLFMForwardedEvent layout");
+_Static_assert(offsetof(GLFMForwardedEvent, key) == 40, "GLFMForwardedEvent layout");
+_Static_assert(offsetof(GLFMForwardedEvent, code) == 72, "GLFMForwardedEvent layout");
+_Static_assert(offsetof(GLFMForwardedEvent, time) == 104, "GLFMForwardedEvent layout");
+_Static_assert(sizeof(GLFMForwardedEvent) == 112, "GLFMForwardedEvent layout");
+
+typedef struct {
+    GLFMForwardedEvent events[GLFM_EVENT_RING_CAPACITY];
+    uint32_t writeIndex; // Written by JavaScript on the main thread
+    uint32_t readIndex; // Written by the worker thread
+    int32_t flags;
+} GLFMEventRing;
+
+#endif
+
 typedef struct {
     bool multitouchEnabled;
     int32_t width;
@@ -51,13 +172,46 @@ typedef struct {
 
     bool isVisible;
     bool isFocused;
+    bool isFrozen;
     bool refreshRequested;
+    bool contextCreated;
+    bool animationFrameLoopRunning;
+    int skippedAnimationFrames;
     
     GLFMInterfaceOrientation orientation;
+
+#if GLFM_FEATURE_SENSORS
+    GLFMSensorRing sensorRing;
+    GLFMSensorFusion sensorFusion;
+    bool orientationSensorReceived;
+#endif
+
+    GLFMAssetRequest *assetRequests;
+    int contextHandle;
+    EmscriptenWebGLContextAttributes contextAttributes;
+    GLFMWebContextInfo webContextInfo;
+
+#if GLFM_EMSCRIPTEN_OFFSCREEN_CANVAS
+    GLFMEventRing eventRing;
+    double canvasClientWidth;
+    double canvasClientHeight;
+    double devicePixelRatio;
+    bool pausedEventPollScheduled;
+#endif
 } GLFMPlatformData;
 
 // MARK: - GLFM private functions
 
+static bool glfm__isActive(const GLFMPlatformData *platformData) {
+    return platformData->isVisible && platformData->isFocused && !platformData->isFrozen;
+}
+
+/// Returns true if the animation frame loop should run. The loop stops while the page is hidden
+/// or frozen, but not when it is only unfocused.
+static bool glfm__shouldAnimate(const GLFMPlatformData *platformData) {
+    return platformData->isVisible && !platformData->isFrozen;
+}
+
 #if GLFM_TEST_KEYBOARD_EVENT_ARRAYS
 
 static bool glfm__listIsSorted(const char *list[], size_t size) {
@@ -71,6 +225,8 @@ static bool glfm__listIsSorted(const char *list[], size_t size) {
 
 #endif
 
+#if GLFM_FEATURE_KEYBOARD
+
 static int glfm__sortedListSearch(const char *list[], size_t size, const char *word) {
     int left = 0;
     int right = (int)size - 1;
@@ -89,6 +245,8 @@ static int glfm__sortedListSearch(const char *list[], size_t size, const char *w
     return -1;
 }
 
+#endif
+
 static void glfm__clearActiveTouches(GLFMPlatformData *platformData) {
     for (int i = 0; i < GLFM_MAX_ACTIVE_TOUCHES; i++) {
         platformData->activeTouches[i].active = false;
@@ -99,11 +257,313 @@ static void glfm__displayChromeUpdated(GLFMDisplay *display) {
     (void)display;
 }
 
-void glfm__sensorFuncUpdated(GLFMDisplay *display) {
+static void glfm__sensorFuncUpdated(GLFMDisplay *display) {
+#if GLFM_FEATURE_SENSORS
+    GLFMPlatformData *platformData = display->platformData;
+    bool active = glfm__isActive(platformData);
+    bool rotationEnabled = active && display->sensorFuncs[GLFMSensorRotationMatrix] != NULL;
+    // The motion event is also used for sensor fusion if the orientation event isn't available.
+    bool motionEnabled = active && (display->sensorFuncs[GLFMSensorAccelerometer] != NULL ||
+                                    display->sensorFuncs[GLFMSensorGyroscope] != NULL ||
+                                    rotationEnabled);
+    // The magnetometer corrects the heading of sensor fusion. It is needed until an orientation
+    // event shows that fusion isn't.
+    bool magnetometerEnabled = active && (display->sensorFuncs[GLFMSensorMagnetometer] != NULL ||
+                                          (rotationEnabled && !platformData->orientationSensorReceived));
+    if (!rotationEnabled) {
+        platformData->orientationSensorReceived = false;
+        glfm__sensorFusionReset(&platformData->sensorFusion);
+    }
+
+    // Sensor events are only available on the main thread
+    MAIN_THREAD_EM_ASM({
+        var sensors = Module['glfmSensors'];
+        if (!sensors) {
+            sensors = Module['glfmSensors'] = {};
+            sensors.write = function(type, timestamp, v0, v1, v2, v3, v4, v5) {
+                var index = Atomics.load(HEAPU32, $1 >> 2);
+                var offset = ($0 >> 3) + (index % $2) * $3;
+                HEAPF64[offset + 0] = type;
+                HEAPF64[offset + 1] = timestamp / 1000;
+                HEAPF64[offset + 2] = v0;
+                HEAPF64[offset + 3] = v1;
+                HEAPF64[offset + 4] = v2;
+                HEAPF64[offset + 5] = v3;
+                HEAPF64[offset + 6] = v4;
+                HEAPF64[offset + 7] = v5;
+                Atomics.store(HEAPU32, $1 >> 2, (index + 1) >>> 0);
+            };
+            sensors.value = function(v) {
+                return (v === null || v === undefined) ? NaN : v;
+            };
+            // iOS 13+ requires permission, which can only be requested from a user gesture.
+            sensors.requestPermission = function() {
+                var request = function() {
+                    window.removeEventListener('touchend', request);
+                    window.removeEventListener('click', request);
+                    DeviceMotionEvent.requestPermission().catch(function() { });
+                    if (typeof DeviceOrientationEvent.requestPermission === 'function') {
+                        DeviceOrientationEvent.requestPermission().catch(function() { });
+                    }
+                };
+                if (!sensors.permissionRequested && typeof DeviceMotionEvent !== 'undefined' &&
+                    typeof DeviceMotionEvent.requestPermission === 'function') {
+                    sensors.permissionRequested = true;
+                    window.addEventListener('touchend', request);
+                    window.addEventListener('click', request);
+                }
+            };
+        }
+
+        var motionEnabled = $4;
+        var orientationEnabled = $5;
+        var magnetometerEnabled = $6;
+        if (motionEnabled && !sensors.motionListener) {
+            sensors.motionListener = function(event) {
+                var a = event.accelerationIncludingGravity;
+                var r = event.rotationRate;
+                sensors.write(1, event.timeStamp,
+                              sensors.value(a && a.x), sensors.value(a && a.y), sensors.value(a && a.z),
+                              sensors.value(r && r.alpha), sensors.value(r && r.beta), sensors.value(r && r.gamma));
+            };
+            window.addEventListener('devicemotion', sensors.motionListener);
+            sensors.requestPermission();
+        } else if (!motionEnabled && sensors.motionListener) {
+            window.removeEventListener('devicemotion', sensors.motionListener);
+            sensors.motionListener = null;
+        }
+
+        if (orientationEnabled && !sensors.orientationListener) {
+            sensors.orientationEventName = ('ondeviceorientationabsolute' in window) ?
+                'deviceorientationabsolute' : 'deviceorientation';
+            sensors.orientationListener = function(event) {
+                var alpha = event.alpha;
+                if (typeof event.webkitCompassHeading === 'number') {
+                    // iOS: alpha is relative to an arbitrary direction
+                    alpha = 360 - event.webkitCompassHeading;
+                }
+                sensors.write(2, event.timeStamp,
+                              sensors.value(alpha), sensors.value(event.beta), sensors.value(event.gamma),
+                              0, 0, 0);
+            };
+            window.addEventListener(sensors.orientationEventName, sensors.orientationListener);
+            sensors.requestPermission();
+        } else if (!orientationEnabled && sensors.orientationListener) {
+            window.removeEventListener(sensors.orientationEventName, sensors.orientationListener);
+            sensors.orientationListener = null;
+        }
+
+        if (magnetometerEnabled && !sensors.magnetometer && typeof Magnetometer === 'function') {
+            try {
+                var magnetometer = new Magnetometer({ frequency: 60 });
+                magnetometer.addEventListener('reading', function() {
+                    sensors.write(3, magnetometer.timestamp,
+                                  magnetometer.x, magnetometer.y, magnetometer.z, 0, 0, 0);
+                });
+                magnetometer.start();
+                sensors.magnetometer = magnetometer;
+            } catch (error) {
+                sensors.magnetometer = null;
+            }
+        } else if (!magnetometerEnabled && sensors.magnetometer) {
+            sensors.magnetometer.stop();
+            sensors.magnetometer = null;
+        }
+    }, platformData->sensorRing.records, &platformData->sensorRing.writeIndex,
+       GLFM_SENSOR_RING_CAPACITY, GLFM_SENSOR_RING_RECORD_SIZE,
+       motionEnabled, rotationEnabled, magnetometerEnabled);
+#else
     (void)display;
-    // TODO: Sensors
+#endif
+}
+
+static void glfm__pointerLockUpdated(GLFMDisplay *display) {
+    if (!display->pointerLockRequested) {
+        display->pointerLocked = false;
+    }
+    // The Pointer Lock API is only available on the main thread. With OffscreenCanvas, lock changes
+    // and motion are forwarded to the worker thread. Otherwise, they are written to the display.
+    MAIN_THREAD_EM_ASM({
+        var canvas = Module['canvas'];
+        var lock = Module['glfmPointerLock'];
+        if (!lock) {
+            lock = Module['glfmPointerLock'] = {};
+            if ($0) {
+                lock.setLocked = function(locked) {
+                    Module['glfmForwardEvent'](20, locked ? 1 : 0, 0, 0, 0, 0);
+                };
+                lock.write = function(x, y) {
+                    Module['glfmForwardEvent'](21, 0, 0, x, y, 0);
+                };
+            } else {
+                lock.setLocked = function(locked) {
+                    HEAP8[$1] = locked ? 1 : 0;
+                };
+                lock.write = function(x, y) {
+                    HEAPF64[$2 >> 3] += x;
+                    HEAPF64[$3 >> 3] += y;
+                };
+            }
+            // unadjustedMovement disables mouse acceleration. Browsers that don't support it reject
+            // the request, which is then retried without it.
+            lock.requestWithOptions = function(options) {
+                var promise = options ? canvas.requestPointerLock(options) : canvas.requestPointerLock();
+                if (promise && typeof promise.catch === 'function') {
+                    promise.catch(function(error) {
+                        if (options && error && error.name === 'NotSupportedError' && lock.requested) {
+                            lock.requestWithOptions(null);
+                        }
+                    });
+                }
+            };
+            // Browsers only grant the lock after a user gesture, so the lock is also requested when
+            // the canvas is clicked.
+            lock.request = function() {
+                if (lock.requested && document.pointerLockElement !== canvas &&
+                    typeof canvas.requestPointerLock === 'function') {
+                    lock.requestWithOptions({ unadjustedMovement: true });
+                }
+            };
+            // pointerrawupdate is sent at the device's rate, instead of once per animation frame.
+            lock.moveEventName = ('onpointerrawupdate' in window) ? 'pointerrawupdate' : 'mousemove';
+            lock.move = function(event) {
+                if (document.pointerLockElement === canvas) {
+                    lock.write(event.movementX || 0, event.movementY || 0);
+                }
+            };
+            document.addEventListener('pointerlockchange', function() {
+                lock.setLocked(document.pointerLockElement === canvas);
+            });
+            canvas.addEventListener('mousedown', lock.request);
+        }
+        lock.requested = $4;
+        if (lock.requested) {
+            window.addEventListener(lock.moveEventName, lock.move, true);
+            lock.request();
+        } else {
+            window.removeEventListener(lock.moveEventName, lock.move, true);
+            if (document.pointerLockElement === canvas) {
+                document.exitPointerLock();
+            }
+        }
+    }, GLFM_EMSCRIPTEN_OFFSCREEN_CANVAS, &display->pointerLocked, &display->relativeMouseDeltaX,
+       &display->relativeMouseDeltaY, display->pointerLockRequested);
+}
+
+#if GLFM_FEATURE_SENSORS
+
+static void glfm__sendSensorEvent(GLFMDisplay *display, GLFMSensorEvent *event) {
+    if (display->sensorFuncs[event->sensor]) {
+        if (display->sensorRemappingEnabled) {
+            GLFMPlatformData *platformData = display->platformData;
+            glfm__remapSensorEvent(event, platformData->orientation);
+        }
+        glfm__dispatchSensorEvent(display, *event);
+    }
 }
 
+/// Sends all sensor samples written to the ring since the last frame.
+static void glfm__sendSensorEvents(GLFMDisplay *display) {
+    GLFMPlatformData *platformData = display->platformData;
+    GLFMSensorRing *ring = &platformData->sensorRing;
+    uint32_t writeIndex = __atomic_load_n(&ring->writeIndex, __ATOMIC_ACQUIRE);
+    if (writeIndex - ring->readIndex > GLFM_SENSOR_RING_CAPACITY) {
+        // Overflow; drop the oldest samples
+        ring->readIndex = writeIndex - GLFM_SENSOR_RING_CAPACITY;
+    }
+#if !GLFM_FEATURE_ORIENTATION
+    // Without the orientation change listener, update the cached orientation once per batch
+    if (ring->readIndex != writeIndex && display->sensorRemappingEnabled) {
+        platformData->orientation = glfmGetInterfaceOrientation(display);
+    }
+#endif
+    for (; ring->readIndex != writeIndex; ring->readIndex++) {
+        const double *record = (ring->records +
+                                (ring->readIndex % GLFM_SENSOR_RING_CAPACITY) * GLFM_SENSOR_RING_RECORD_SIZE);
+        GLFMSensorRecordType type = (GLFMSensorRecordType)record[0];
+        GLFMSensorEvent event = { 0 };
+        event.timestamp = record[1];
+        if (type == GLFMSensorRecordMotion) {
+            bool hasAcceleration = !isnan(record[2]) && !isnan(record[3]) && !isnan(record[4]);
+            bool hasRotationRate = !isnan(record[5]) && !isnan(record[6]) && !isnan(record[7]);
+            bool fusionNeeded = (display->sensorFuncs[GLFMSensorRotationMatrix] &&
+                                 !platformData->orientationSensorReceived);
+            if (hasAcceleration) {
+                // Convert to iOS format
+                event.sensor = GLFMSensorAccelerometer;
+                event.vector.x = record[2] / -GLFM_STANDARD_GRAVITY;
+                event.vector.y = record[3] / -GLFM_STANDARD_GRAVITY;
+                event.vector.z = record[4] / -GLFM_STANDARD_GRAVITY;
+                glfm__sendSensorEvent(display, &event);
+                if (fusionNeeded) {
+                    glfm__sensorFusionAddAccelerometer(&platformData->sensorFusion, (float)record[2],
+                                                       (float)record[3], (float)record[4]);
+                }
+            }
+            if (hasRotationRate) {
+                // Degrees/second to radians/second. Alpha is around the Z axis, beta is around the
+                // X axis, and gamma is around the Y axis.
+                event.sensor = GLFMSensorGyroscope;
+                event.vector.x = record[6] * GLFM_DEGREES_TO_RADIANS;
+                event.vector.y = record[7] * GLFM_DEGREES_TO_RADIANS;
+                event.vector.z = record[5] * GLFM_DEGREES_TO_RADIANS;
+                glfm__sendSensorEvent(display, &event);
+            }
+            if (fusionNeeded && hasAcceleration) {
+                float gx = hasRotationRate ? (float)(record[6] * GLFM_DEGREES_TO_RADIANS) : 0.0f;
+                float gy = hasRotationRate ? (float)(record[7] * GLFM_DEGREES_TO_RADIANS) : 0.0f;
+                float gz = hasRotationRate ? (float)(record[5] * GLFM_DEGREES_TO_RADIANS) : 0.0f;
+                if (glfm__sensorFusionAddGyroscope(&platformData->sensorFusion, event.timestamp,
+                                                   gx, gy, gz)) {
+                    glfm__sensorFusionGetEvent(&platformData->sensorFusion, &event);
+                    glfm__sendSensorEvent(display, &event);
+                }
+            }
+        } else if (type == GLFMSensorRecordOrientation) {
+            if (isnan(record[2]) || isnan(record[3]) || isnan(record[4])) {
+                // No orientation hardware. Use sensor fusion instead.
+                continue;
+            }
+            if (!platformData->orientationSensorReceived) {
+                platformData->orientationSensorReceived = true;
+                // Stop the magnetometer, if it was only used for sensor fusion
+                glfm__sensorFuncUpdated(display);
+            }
+
+            // Convert the Z-X'-Y'' Euler angles to a unit quaternion, where the X axis points
+            // East and the Y axis points North.
+            const double toHalfRadians = GLFM_DEGREES_TO_RADIANS / 2.0;
+            double cz = cos(record[2] * toHalfRadians), sz = sin(record[2] * toHalfRadians);
+            double cx = cos(record[3] * toHalfRadians), sx = sin(record[3] * toHalfRadians);
+            double cy = cos(record[4] * toHalfRadians), sy = sin(record[4] * toHalfRadians);
+            double qw = cx * cy * cz - sx * sy * sz;
+            double qx = sx * cy * cz - cx * sy * sz;
+            double qy = cx * sy * cz + sx * cy * sz;
+            double qz = cx * cy * sz + sx * sy * cz;
+
+            // Rotate -90 degrees around the Z axis, so that the X axis points North (same as iOS).
+            const double f = sqrt(0.5);
+            glfm__setSensorEventRotation(&event, f * (qz + qw), f * (qy + qx), f * (qy - qx),
+                                         f * (qz - qw));
+            glfm__sendSensorEvent(display, &event);
+        } else if (type == GLFMSensorRecordMagnetometer) {
+            event.sensor = GLFMSensorMagnetometer;
+            event.vector.x = record[2];
+            event.vector.y = record[3];
+            event.vector.z = record[4];
+            glfm__sendSensorEvent(display, &event);
+            if (display->sensorFuncs[GLFMSensorRotationMatrix]) {
+                glfm__sensorFusionAddMagnetometer(&platformData->sensorFusion, (float)record[2],
+                                                  (float)record[3], (float)record[4]);
+            }
+        }
+    }
+}
+
+#endif // GLFM_FEATURE_SENSORS
+
+#if GLFM_FEATURE_CLIPBOARD
+
 EMSCRIPTEN_KEEPALIVE extern
 void glfm__requestClipboardTextCallback(GLFMDisplay *display,
                                         GLFMClipboardTextFunc clipboardTextFunc, const char *text);
@@ -117,22 +577,176 @@ void glfm__requestClipboardTextCallback(GLFMDisplay *display,
     }
 }
 
+#endif
+
+// MARK: - Assets
+
+/// Starts loading an asset. Streamed assets are listed in `Module['glfmAssets']`, which is written
+/// by a `--pre-js` file at build time (see GLFMAppTarget.cmake). Assets that are not listed
+/// (for example, preloaded assets) are only checked for existence.
+static void glfm__startAssetRequest(GLFMAssetRequest *request) {
+    // The file system and IndexedDB are accessed on the main thread
+    MAIN_THREAD_EM_ASM({
+        var path = UTF8ToString($0);
+        var statePtr = $1;
+        var done = function(available) {
+            Atomics.store(HEAP32, statePtr >> 2, available ? 2 : 3);
+        };
+        var exists = function() {
+            return FS.analyzePath(path).exists;
+        };
+        var assets = Module['glfmAssets'];
+        var entry = assets ? assets.files[path] : null;
+        if (!entry || exists()) {
+            done(exists());
+            return;
+        }
+
+        var loader = Module['glfmAssetLoader'];
+        if (!loader) {
+            loader = Module['glfmAssetLoader'] = { pending: {} };
+            loader.db = new Promise(function(resolve) {
+                if (typeof indexedDB === 'undefined') {
+                    resolve(null);
+                    return;
+                }
+                var request = indexedDB.open('glfm-assets', 1);
+                request.onupgradeneeded = function() {
+                    request.result.createObjectStore('files');
+                };
+                request.onsuccess = function() { resolve(request.result); };
+                request.onerror = function() { resolve(null); };
+            });
+            loader.get = function(db, key) {
+                return new Promise(function(resolve) {
+                    if (!db) {
+                        resolve(null);
+                        return;
+                    }
+                    try {
+                        var request = db.transaction('files', 'readonly').objectStore('files').get(key);
+                        request.onsuccess = function() { resolve(request.result || null); };
+                        request.onerror = function() { resolve(null); };
+                    } catch (e) {
+                        resolve(null);
+                    }
+                });
+            };
+            loader.put = function(db, key, data) {
+                if (db) {
+                    try {
+                        db.transaction('files', 'readwrite').objectStore('files').put(data, key);
+                    } catch (e) {
+                        // Ignore; the asset is fetched again next time
+                    }
+                }
+            };
+        }
+
+        // The cache is keyed by content hash, so a changed asset is never read from a stale entry.
+        var pending = loader.pending[path];
+        if (!pending) {
+            pending = loader.pending[path] = loader.db.then(function(db) {
+                return loader.get(db, entry.hash).then(function(data) {
+                    if (data && data.byteLength === entry.size) {
+                        return data;
+                    }
+                    return fetch(assets.base + encodeURI(path)).then(function(response) {
+                        if (!response.ok) {
+                            throw new Error(response.status + " " + response.statusText);
+                        }
+                        return response.arrayBuffer();
+                    }).then(function(data) {
+                        if (data.byteLength !== entry.size) {
+                            throw new Error("Unexpected size");
+                        }
+                        loader.put(db, entry.hash, data);
+                        return data;
+                    });
+                });
+            }).then(function(data) {
+                var slash = path.lastIndexOf("/");
+                if (slash > 0) {
+                    FS.mkdirTree(path.substring(0, slash));
+                }
+                FS.writeFile(path, new Uint8Array(data));
+                return true;
+            }).catch(function(error) {
+                console.warn("Couldn't load asset " + path + ": " + error);
+                delete loader.pending[path];
+                return false;
+            });
+        }
+        pending.then(done);
+    }, request->path, &request->state);
+}
+
+/// Starts pending asset requests and invokes the callback of finished requests. Called after
+/// each frame, so that loading assets never delays the first frame.
+static void glfm__updateAssetRequests(GLFMDisplay *display) {
+    GLFMPlatformData *platformData = display->platformData;
+    GLFMAssetRequest **link = &platformData->assetRequests;
+    while (*link) {
+        GLFMAssetRequest *request = *link;
+        int32_t state = __atomic_load_n(&request->state, __ATOMIC_ACQUIRE);
+        if (state == GLFMAssetRequestStatePending) {
+            request->state = GLFMAssetRequestStateLoading;
+            glfm__startAssetRequest(request);
+            link = &request->next;
+        } else if (state == GLFMAssetRequestStateLoading) {
+            link = &request->next;
+        } else {
+            // Unlink before invoking the callback, which may request another asset
+            *link = request->next;
+            if (request->assetFunc) {
+                request->assetFunc(display, request->path, state == GLFMAssetRequestStateAvailable);
+            }
+            free(request);
+        }
+    }
+}
+
+void glfmRequestAsset(GLFMDisplay *display, const char *path, GLFMAssetFunc assetFunc) {
+    if (!display || !path) {
+        return;
+    }
+    GLFMPlatformData *platformData = display->platformData;
+    size_t pathLength = strlen(path);
+    GLFMAssetRequest *request = calloc(1, sizeof(GLFMAssetRequest) + pathLength + 1);
+    if (!request) {
+        if (assetFunc) {
+            assetFunc(display, path, false);
+        }
+        return;
+    }
+    request->assetFunc = assetFunc;
+    request->state = GLFMAssetRequestStatePending;
+    memcpy(request->path, path, pathLength + 1);
+
+    // Append, so that callbacks are invoked in request order when possible
+    GLFMAssetRequest **link = &platformData->assetRequests;
+    while (*link) {
+        link = &(*link)->next;
+    }
+    *link = request;
+}
+
 // MARK: - GLFM public functions
 
 double glfmGetTime(void) {
     return emscripten_get_now() / 1000.0;
 }
 
-void glfmSwapBuffers(GLFMDisplay *display) {
-    (void)display;
-    // Do nothing; swap is implicit
+uint64_t glfmSwapBuffers(GLFMDisplay *display) {
+    // Swap is implicit. Only record the frame.
+    return display ? glfm__recordSwap(display, 0) : 0;
 }
 
 void glfmSetSupportedInterfaceOrientation(GLFMDisplay *display,
                                           GLFMInterfaceOrientation supportedOrientations) {
     if (display->supportedOrientations != supportedOrientations) {
         display->supportedOrientations = supportedOrientations;
-
+#if GLFM_FEATURE_ORIENTATION
         bool portraitRequested = (supportedOrientations & (GLFMInterfaceOrientationPortrait | GLFMInterfaceOrientationPortraitUpsideDown));
         bool landscapeRequested = (supportedOrientations & GLFMInterfaceOrientationLandscape);
         if (portraitRequested && landscapeRequested) {
@@ -147,6 +761,7 @@ void glfmSetSupportedInterfaceOrientation(GLFMDisplay *display,
             emscripten_lock_orientation(EMSCRIPTEN_ORIENTATION_PORTRAIT_PRIMARY |
                                         EMSCRIPTEN_ORIENTATION_PORTRAIT_SECONDARY);
         }
+#endif
     }
 }
 
@@ -189,28 +804,28 @@ void glfmGetDisplayChromeInsets(const GLFMDisplay *display, double *top, double
                                 double *bottom, double *left) {
     GLFMPlatformData *platformData = display->platformData;
     if (top) {
-        *top = platformData->scale * EM_ASM_DOUBLE_V( {
+        *top = platformData->scale * MAIN_THREAD_EM_ASM_DOUBLE( {
             var htmlStyles = window.getComputedStyle(document.querySelector("html"));
             return ((parseInt(htmlStyles.getPropertyValue("--glfm-chrome-top-old")) || 0) +
                     (parseInt(htmlStyles.getPropertyValue("--glfm-chrome-top")) || 0));
         } );
     }
     if (right) {
-        *right = platformData->scale * EM_ASM_DOUBLE_V( {
+        *right = platformData->scale * MAIN_THREAD_EM_ASM_DOUBLE( {
             var htmlStyles = window.getComputedStyle(document.querySelector("html"));
             return ((parseInt(htmlStyles.getPropertyValue("--glfm-chrome-right-old")) || 0) +
                     (parseInt(htmlStyles.getPropertyValue("--glfm-chrome-right")) || 0));
         } );
     }
     if (bottom) {
-        *bottom = platformData->scale * EM_ASM_DOUBLE_V( {
+        *bottom = platformData->scale * MAIN_THREAD_EM_ASM_DOUBLE( {
             var htmlStyles = window.getComputedStyle(document.querySelector("html"));
             return ((parseInt(htmlStyles.getPropertyValue("--glfm-chrome-bottom-old")) || 0) +
                     (parseInt(htmlStyles.getPropertyValue("--glfm-chrome-bottom")) || 0));
         } );
     }
     if (left) {
-        *left = platformData->scale * EM_ASM_DOUBLE_V( {
+        *left = platformData->scale * MAIN_THREAD_EM_ASM_DOUBLE( {
             var htmlStyles = window.getComputedStyle(document.querySelector("html"));
             return ((parseInt(htmlStyles.getPropertyValue("--glfm-chrome-left-old")) || 0) +
                     (parseInt(htmlStyles.getPropertyValue("--glfm-chrome-left")) || 0));
@@ -225,13 +840,16 @@ GLFMRenderingAPI glfmGetRenderingAPI(const GLFMDisplay *display) {
 
 bool glfmHasTouch(const GLFMDisplay *display) {
     (void)display;
-    return EM_ASM_INT_V({
+    return MAIN_THREAD_EM_ASM_INT({
         return (('ontouchstart' in window) || (navigator.msMaxTouchPoints > 0));
     });
 }
 
 void glfmSetMouseCursor(GLFMDisplay *display, GLFMMouseCursor mouseCursor) {
     (void)display;
+#if !GLFM_FEATURE_MOUSE_CURSOR
+    (void)mouseCursor;
+#else
     // Make sure the javascript array emCursors is referenced properly
     int emCursor = 0;
     switch (mouseCursor) {
@@ -257,10 +875,11 @@ void glfmSetMouseCursor(GLFMDisplay *display, GLFMMouseCursor mouseCursor) {
             emCursor = 6;
             break;
     }
-    EM_ASM_({
+    MAIN_THREAD_EM_ASM({
         var emCursors = new Array('auto', 'none', 'default', 'pointer', 'crosshair', 'text', 'vertical-text');
         Module['canvas'].style.cursor = emCursors[$0];
     }, emCursor);
+#endif
 }
 
 void glfmSetMultitouchEnabled(GLFMDisplay *display, bool multitouchEnabled) {
@@ -295,9 +914,29 @@ GLFMProc glfmGetProcAddress(const char *functionName) {
 
 bool glfmIsSensorAvailable(const GLFMDisplay *display, GLFMSensor sensor) {
     (void)display;
+#if !GLFM_FEATURE_SENSORS
     (void)sensor;
-    // TODO: Sensors
     return false;
+#else
+    switch (sensor) {
+        case GLFMSensorAccelerometer:
+        case GLFMSensorGyroscope:
+            return MAIN_THREAD_EM_ASM_INT({
+                return (typeof DeviceMotionEvent !== 'undefined') ? 1 : 0;
+            });
+        case GLFMSensorMagnetometer:
+            return MAIN_THREAD_EM_ASM_INT({
+                return (typeof Magnetometer === 'function') ? 1 : 0;
+            });
+        case GLFMSensorRotationMatrix:
+            return MAIN_THREAD_EM_ASM_INT({
+                return (typeof DeviceOrientationEvent !== 'undefined' ||
+                        typeof DeviceMotionEvent !== 'undefined') ? 1 : 0;
+            });
+        default:
+            return false;
+    }
+#endif
 }
 
 bool glfmIsHapticFeedbackSupported(const GLFMDisplay *display) {
@@ -311,10 +950,12 @@ void glfmPerformHapticFeedback(GLFMDisplay *display, GLFMHapticFeedbackStyle sty
     // Do nothing
 }
 
+#if GLFM_FEATURE_CLIPBOARD
+
 bool glfmHasClipboardText(const GLFMDisplay *display) {
     (void)display;
     // Currently, chrome supports navigator.userActivation, but Safari and Firefox do not.
-    int result = EM_ASM_INT({
+    int result = MAIN_THREAD_EM_ASM_INT({
         var hasReadText = (navigator && navigator.clipboard && navigator.clipboard.readText);
         var hasUserActivation = (navigator && navigator.userActivation) ? navigator.userActivation.isActive : true;
         return (hasReadText && hasUserActivation) ? 1 : 0;
@@ -326,6 +967,11 @@ void glfmRequestClipboardText(GLFMDisplay *display, GLFMClipboardTextFunc clipbo
     if (!clipboardTextFunc) {
         return;
     }
+#if GLFM_EMSCRIPTEN_OFFSCREEN_CANVAS
+    // The clipboard is only available on the main thread, and the result would be delivered there.
+    clipboardTextFunc(display, NULL);
+    return;
+#else
     if (!glfmHasClipboardText(display)) {
         clipboardTextFunc(display, NULL);
         return;
@@ -363,6 +1009,7 @@ void glfmRequestClipboardText(GLFMDisplay *display, GLFMClipboardTextFunc clipbo
             }
         });
     }, display, clipboardTextFunc);
+#endif
 }
 
 bool glfmSetClipboardText(GLFMDisplay *display, const char *string) {
@@ -370,7 +1017,7 @@ bool glfmSetClipboardText(GLFMDisplay *display, const char *string) {
     if (!string) {
         return false;
     }
-    int result = EM_ASM_INT({
+    int result = MAIN_THREAD_EM_ASM_INT({
         if (navigator.clipboard && navigator.clipboard.writeText) {
             var text = UTF8ToString($0);
             if (text) {
@@ -383,6 +1030,27 @@ bool glfmSetClipboardText(GLFMDisplay *display, const char *string) {
     return result == 1;
 }
 
+#else
+
+bool glfmHasClipboardText(const GLFMDisplay *display) {
+    (void)display;
+    return false;
+}
+
+void glfmRequestClipboardText(GLFMDisplay *display, GLFMClipboardTextFunc clipboardTextFunc) {
+    if (clipboardTextFunc) {
+        clipboardTextFunc(display, NULL);
+    }
+}
+
+bool glfmSetClipboardText(GLFMDisplay *display, const char *string) {
+    (void)display;
+    (void)string;
+    return false;
+}
+
+#endif // GLFM_FEATURE_CLIPBOARD
+
 // MARK: - Platform-specific functions
 
 bool glfmIsMetalSupported(const GLFMDisplay *display) {
@@ -390,46 +1058,136 @@ bool glfmIsMetalSupported(const GLFMDisplay *display) {
     return false;
 }
 
+bool glfmIsVulkanSupported(const GLFMDisplay *display) {
+    (void)display;
+    return false;
+}
+
 // MARK: - Emscripten glue
 
+static const char *glfm__webGLTarget = "#canvas";
+
 static int glfm__getDisplayWidth(GLFMDisplay *display) {
     (void)display;
-    const double width = EM_ASM_DOUBLE_V({
-        var canvas = Module['canvas'];
-        return canvas.width;
-    });
-    return (int)(round(width));
+    int width = 0;
+    int height = 0;
+    emscripten_get_canvas_element_size(glfm__webGLTarget, &width, &height);
+    return width;
 }
 
 static int glfm__getDisplayHeight(GLFMDisplay *display) {
     (void)display;
-    const double height = EM_ASM_DOUBLE_V({
-        var canvas = Module['canvas'];
-        return canvas.height;
-    });
-    return (int)(round(height));
+    int width = 0;
+    int height = 0;
+    emscripten_get_canvas_element_size(glfm__webGLTarget, &width, &height);
+    return height;
 }
 
-static void glfm__setVisibleAndFocused(GLFMDisplay *display, bool visible, bool focused) {
+static void glfm__updateAnimationFrameLoop(GLFMDisplay *display);
+
+static void glfm__setActiveState(GLFMDisplay *display, bool visible, bool focused, bool frozen) {
     GLFMPlatformData *platformData = display->platformData;
-    bool wasActive = platformData->isVisible && platformData->isFocused;
+    bool wasActive = glfm__isActive(platformData);
     platformData->isVisible = visible;
     platformData->isFocused = focused;
-    bool isActive = platformData->isVisible && platformData->isFocused;
+    platformData->isFrozen = frozen;
+    bool isActive = glfm__isActive(platformData);
+    glfm__updateAnimationFrameLoop(display);
     if (wasActive != isActive) {
         platformData->refreshRequested = true;
         glfm__clearActiveTouches(platformData);
+        glfm__sensorFuncUpdated(display);
+        glfm__setSuspended(display, !isActive);
         if (display->focusFunc) {
             display->focusFunc(display, isActive);
         }
     }
 }
 
-static void glfm__mainLoopFunc(void *userData) {
+static void glfm__setVisibleAndFocused(GLFMDisplay *display, bool visible, bool focused) {
+    GLFMPlatformData *platformData = display->platformData;
+    glfm__setActiveState(display, visible, focused, platformData->isFrozen);
+}
+
+static void glfm__setFrozen(GLFMDisplay *display, bool frozen) {
+    GLFMPlatformData *platformData = display->platformData;
+    glfm__setActiveState(display, platformData->isVisible, platformData->isFocused, frozen);
+}
+
+#if GLFM_EMSCRIPTEN_OFFSCREEN_CANVAS
+
+static void glfm__receiveForwardedEvents(GLFMDisplay *display);
+static void glfm__schedulePausedEventPoll(GLFMDisplay *display);
+
+static void glfm__pausedEventPollCallback(void *userData) {
+    GLFMDisplay *display = userData;
+    GLFMPlatformData *platformData = display->platformData;
+    platformData->pausedEventPollScheduled = false;
+    glfm__receiveForwardedEvents(display);
+    if (!platformData->animationFrameLoopRunning) {
+        glfm__schedulePausedEventPoll(display);
+    }
+}
+
+/// While the animation frame loop is stopped, forwarded events (like the page becoming visible)
+/// are polled at a low rate, since the worker can't receive DOM events directly.
+static void glfm__schedulePausedEventPoll(GLFMDisplay *display) {
+    GLFMPlatformData *platformData = display->platformData;
+    if (!platformData->pausedEventPollScheduled) {
+        platformData->pausedEventPollScheduled = true;
+        emscripten_set_timeout(glfm__pausedEventPollCallback, GLFM_PAUSED_EVENT_POLL_INTERVAL_MS,
+                               display);
+    }
+}
+
+#endif
+
+static EM_BOOL glfm__animationFrameCallback(double time, void *userData) {
     GLFMDisplay *display = userData;
     if (display) {
         GLFMPlatformData *platformData = display->platformData;
-        
+
+#if GLFM_EMSCRIPTEN_OFFSCREEN_CANVAS
+        glfm__receiveForwardedEvents(display);
+#endif
+        if (!glfm__shouldAnimate(platformData)) {
+            // Stop the loop. It is restarted in glfm__updateAnimationFrameLoop().
+            platformData->animationFrameLoopRunning = false;
+#if GLFM_EMSCRIPTEN_OFFSCREEN_CANVAS
+            glfm__schedulePausedEventPoll(display);
+#endif
+            return 0;
+        }
+
+        // With a swap interval of N, render on every Nth animation frame
+        const int swapInterval = glfmGetSwapInterval(display);
+        if (swapInterval > 1 && ++platformData->skippedAnimationFrames < swapInterval) {
+            return 1;
+        }
+        platformData->skippedAnimationFrames = 0;
+
+        // The requestAnimationFrame timestamp is in milliseconds, relative to the thread's
+        // performance.timeOrigin. In a worker, the origin may differ from glfmGetTime().
+#if GLFM_EMSCRIPTEN_OFFSCREEN_CANVAS
+        const double age = (EM_ASM_DOUBLE({ return performance.now(); }) - time) / 1000.0;
+        glfm__setFrameTime(display, glfmGetTime() - (age > 0.0 ? age : 0.0), 0.0);
+#else
+        glfm__setFrameTime(display, time / 1000.0, 0.0);
+#endif
+
+#if GLFM_EMSCRIPTEN_OFFSCREEN_CANVAS
+        // Check if canvas size has changed. The canvas is an OffscreenCanvas owned by this thread;
+        // its CSS size is forwarded from the main thread.
+        int displayChanged = 0;
+        if (platformData->canvasClientWidth > 0 && platformData->canvasClientHeight > 0) {
+            int width = (int)(platformData->canvasClientWidth * platformData->devicePixelRatio);
+            int height = (int)(platformData->canvasClientHeight * platformData->devicePixelRatio);
+            if (width != platformData->width || height != platformData->height) {
+                emscripten_set_canvas_element_size(glfm__webGLTarget, width, height);
+                displayChanged = 1;
+            }
+        }
+#else
         // Check if canvas size has changed
         int displayChanged = EM_ASM_INT_V({
             var canvas = Module['canvas'];
@@ -444,16 +1202,25 @@ static void glfm__mainLoopFunc(void *userData) {
                 return 0;
             }
         });
+#endif
         if (displayChanged) {
             platformData->refreshRequested = true;
             platformData->width = glfm__getDisplayWidth(display);
             platformData->height = glfm__getDisplayHeight(display);
+#if GLFM_EMSCRIPTEN_OFFSCREEN_CANVAS
+            platformData->scale = platformData->devicePixelRatio;
+#else
             platformData->scale = emscripten_get_device_pixel_ratio();
+#endif
             if (display->surfaceResizedFunc) {
                 display->surfaceResizedFunc(display, platformData->width, platformData->height);
             }
         }
 
+#if GLFM_FEATURE_SENSORS
+        glfm__sendSensorEvents(display);
+#endif
+
         // Tick
         if (platformData->refreshRequested) {
             platformData->refreshRequested = false;
@@ -461,9 +1228,28 @@ static void glfm__mainLoopFunc(void *userData) {
                 display->surfaceRefreshFunc(display);
             }
         }
+        glfm__waitForFrameJobs(display);
+        glfm__swapInputSnapshot(display);
         if (display->renderFunc) {
             display->renderFunc(display);
         }
+        glfm__runIdleTasks(display, glfm__getIdleDeadline(display));
+
+        // Start asset requests after the first frame, and report finished requests
+        glfm__updateAssetRequests(display);
+    }
+    return 1;
+}
+
+static void glfm__negotiateWebContext(GLFMDisplay *display);
+
+static void glfm__updateAnimationFrameLoop(GLFMDisplay *display) {
+    GLFMPlatformData *platformData = display->platformData;
+    if (platformData->contextCreated && glfm__shouldAnimate(platformData) &&
+        !platformData->animationFrameLoopRunning) {
+        platformData->animationFrameLoopRunning = true;
+        platformData->refreshRequested = true;
+        emscripten_request_animation_frame_loop(glfm__animationFrameCallback, display);
     }
 }
 
@@ -474,11 +1260,13 @@ static EM_BOOL glfm__webGLContextCallback(int eventType, const void *reserved, v
     platformData->refreshRequested = true;
     switch (eventType) {
         case EMSCRIPTEN_EVENT_WEBGLCONTEXTLOST:
+            display->textureFormats = 0;
             if (display->surfaceDestroyedFunc) {
                 display->surfaceDestroyedFunc(display);
             }
             return 1;
         case EMSCRIPTEN_EVENT_WEBGLCONTEXTRESTORED:
+            glfm__negotiateWebContext(display);
             if (display->surfaceCreatedFunc) {
                 display->surfaceCreatedFunc(display, platformData->width, platformData->height);
             }
@@ -513,6 +1301,18 @@ static const char *glfm__beforeUnloadCallback(int eventType, const void *reserve
     return NULL;
 }
 
+#if !GLFM_EMSCRIPTEN_OFFSCREEN_CANVAS
+
+// Called from JavaScript for the Page Lifecycle API "freeze" and "resume" events.
+EMSCRIPTEN_KEEPALIVE void glfm__pageLifecycleCallback(GLFMDisplay *display, int frozen);
+EMSCRIPTEN_KEEPALIVE void glfm__pageLifecycleCallback(GLFMDisplay *display, int frozen) {
+    glfm__setFrozen(display, frozen != 0);
+}
+
+#endif
+
+#if GLFM_FEATURE_ORIENTATION
+
 static EM_BOOL glfm__orientationChangeCallback(int eventType,
                                                const EmscriptenDeviceOrientationEvent *deviceOrientationEvent,
                                                void *userData) {
@@ -531,12 +1331,27 @@ static EM_BOOL glfm__orientationChangeCallback(int eventType,
     return 1;
 }
 
+#endif // GLFM_FEATURE_ORIENTATION
+
+/// Converts the time of a DOM event (`event.timeStamp`, in milliseconds since
+/// `performance.timeOrigin` of this thread) to the glfmGetTime() timebase. Returns the current
+/// time for events without a valid time, like from older browsers that used the Unix epoch.
+static double glfm__getEventTime(double timeStamp) {
+    const double age = (EM_ASM_DOUBLE({ return performance.now(); }) - timeStamp) / 1000.0;
+    const double now = glfmGetTime();
+    return (age >= 0.0 && age < 60.0) ? now - age : now;
+}
+
+#if GLFM_FEATURE_KEYBOARD
+
 static EM_BOOL glfm__keyCallback(int eventType, const EmscriptenKeyboardEvent *event, void *userData) {
     GLFMDisplay *display = userData;
+    const double timestamp = glfm__getEventTime(event->timestamp);
     EM_BOOL handled = 0;
 
     // Key input
-    if (display->keyFunc && (eventType == EMSCRIPTEN_EVENT_KEYDOWN || eventType == EMSCRIPTEN_EVENT_KEYUP)) {
+    if (glfm__isKeyInputNeeded(display) &&
+        (eventType == EMSCRIPTEN_EVENT_KEYDOWN || eventType == EMSCRIPTEN_EVENT_KEYUP)) {
         // This list of code values is from https://www.w3.org/TR/uievents-code/
         // (Added functions keys F13-F24)
         // egrep -o '<code class="code" id="code-.*?</code>' uievents-code.html | sort | awk -F"[><]" '{print $3}' | awk 1 ORS=', '
@@ -622,11 +1437,12 @@ static EM_BOOL glfm__keyCallback(int eventType, const EmscriptenKeyboardEvent *e
 
         int codeIndex = glfm__sortedListSearch(KEYBOARD_EVENT_CODES, KEYBOARD_EVENT_CODES_LENGTH, event->code);
         GLFMKeyCode keyCode = codeIndex >= 0 ? GLFM_KEY_CODES[codeIndex] : GLFMKeyCodeUnknown;
-        handled = display->keyFunc(display, keyCode, action, modifiers);
+        handled = glfm__dispatchKeyEvent(display, timestamp, keyCode, action, modifiers);
     }
 
     // Character input
-    if (display->charFunc && eventType == EMSCRIPTEN_EVENT_KEYDOWN && !event->ctrlKey && !event->metaKey) {
+    if (glfm__isCharInputNeeded(display) &&
+        eventType == EMSCRIPTEN_EVENT_KEYDOWN && !event->ctrlKey && !event->metaKey) {
         // It appears the only way to detect printable character input is to check if the "key" value is
         // not one of the pre-defined key values.
         // This list of pre-defined key values is from https://www.w3.org/TR/uievents-key/
@@ -698,7 +1514,7 @@ static EM_BOOL glfm__keyCallback(int eventType, const EmscriptenKeyboardEvent *e
                 isPredefinedKey = glfm__sortedListSearch(KEYBOARD_EVENT_KEYS, KEYBOARD_EVENT_KEYS_LENGTH, event->key) >= 0;
             }
             if (isSingleChar || !isPredefinedKey) {
-                display->charFunc(display, event->key, 0);
+                glfm__dispatchCharEvent(display, timestamp, event->key);
                 handled = 1;
             }
         }
@@ -707,27 +1523,21 @@ static EM_BOOL glfm__keyCallback(int eventType, const EmscriptenKeyboardEvent *e
     return handled;
 }
 
-static EM_BOOL glfm__mouseCallback(int eventType, const EmscriptenMouseEvent *event, void *userData) {
-    GLFMDisplay *display = userData;
+#endif // GLFM_FEATURE_KEYBOARD
+
+/// Handles a mouse event, where the position is relative to the canvas, in CSS pixels.
+static EM_BOOL glfm__handleMouseEvent(GLFMDisplay *display, double timestamp, int eventType,
+                                      unsigned short button, float mouseX, float mouseY,
+                                      bool mouseInside) {
     GLFMPlatformData *platformData = display->platformData;
-    if (!display->touchFunc) {
+    if (!glfm__isTouchInputNeeded(display)) {
         platformData->mouseDown = false;
         return 0;
     }
-    
-    // The mouse event handler targets EMSCRIPTEN_EVENT_TARGET_WINDOW so that dragging the mouse outside the canvas can be detected.
-    // If a mouse drag begins inside the canvas, the mouse release event is sent even if the mouse is released outside the canvas.
-    float canvasX, canvasY, canvasW, canvasH;
-    EM_ASM({
-        var rect = Module['canvas'].getBoundingClientRect();
-        setValue($0, rect.x, "float");
-        setValue($1, rect.y, "float");
-        setValue($2, rect.width, "float");
-        setValue($3, rect.height, "float");
-    }, &canvasX, &canvasY, &canvasW, &canvasH);
-    const float mouseX = (float)event->targetX - canvasX;
-    const float mouseY = (float)event->targetY - canvasY;
-    const bool mouseInside = mouseX >= 0 && mouseY >= 0 && mouseX < canvasW && mouseY < canvasH;
+    if (display->pointerLocked && eventType == EMSCRIPTEN_EVENT_MOUSEMOVE) {
+        // The position doesn't change while locked. Motion is sent to the relative mouse func.
+        return 1;
+    }
     if (!mouseInside && eventType == EMSCRIPTEN_EVENT_MOUSEDOWN) {
         // Mouse click outside canvas
         return 0;
@@ -762,19 +1572,47 @@ static EM_BOOL glfm__mouseCallback(int eventType, const EmscriptenMouseEvent *ev
             platformData->mouseDown = false;
             break;
     }
-    bool handled = display->touchFunc(display, event->button, touchPhase,
-                                      platformData->scale * (double)mouseX,
-                                      platformData->scale * (double)mouseY);
+    bool handled = glfm__dispatchTouchEvent(display, timestamp, button, touchPhase,
+                                            platformData->scale * (double)mouseX,
+                                            platformData->scale * (double)mouseY);
     // Always return `false` when the event is `mouseDown` for iframe support.
     // Returning `true` invokes `preventDefault`, and invoking `preventDefault` on
     // `mouseDown` events prevents `mouseMove` events outside the iframe.
     return handled && eventType != EMSCRIPTEN_EVENT_MOUSEDOWN;
 }
 
+#if !GLFM_EMSCRIPTEN_OFFSCREEN_CANVAS
+
+static EM_BOOL glfm__mouseCallback(int eventType, const EmscriptenMouseEvent *event, void *userData) {
+    GLFMDisplay *display = userData;
+    if (!glfm__isTouchInputNeeded(display) ||
+        (display->pointerLocked && eventType == EMSCRIPTEN_EVENT_MOUSEMOVE)) {
+        return glfm__handleMouseEvent(display, 0.0, eventType, event->button, 0.0f, 0.0f, false);
+    }
+
+    // The mouse event handler targets EMSCRIPTEN_EVENT_TARGET_WINDOW so that dragging the mouse outside the canvas can be detected.
+    // If a mouse drag begins inside the canvas, the mouse release event is sent even if the mouse is released outside the canvas.
+    float canvasX, canvasY, canvasW, canvasH;
+    EM_ASM({
+        var rect = Module['canvas'].getBoundingClientRect();
+        setValue($0, rect.x, "float");
+        setValue($1, rect.y, "float");
+        setValue($2, rect.width, "float");
+        setValue($3, rect.height, "float");
+    }, &canvasX, &canvasY, &canvasW, &canvasH);
+    const float mouseX = (float)event->targetX - canvasX;
+    const float mouseY = (float)event->targetY - canvasY;
+    const bool mouseInside = mouseX >= 0 && mouseY >= 0 && mouseX < canvasW && mouseY < canvasH;
+    return glfm__handleMouseEvent(display, glfm__getEventTime(event->timestamp), eventType,
+                                  event->button, mouseX, mouseY, mouseInside);
+}
+
+#endif
+
 static EM_BOOL glfm__mouseWheelCallback(int eventType, const EmscriptenWheelEvent *wheelEvent, void *userData) {
     (void)eventType;
     GLFMDisplay *display = userData;
-    if (!display->mouseWheelFunc) {
+    if (!glfm__isMouseWheelInputNeeded(display)) {
         return 0;
     }
     GLFMPlatformData *platformData = display->platformData;
@@ -790,10 +1628,11 @@ static EM_BOOL glfm__mouseWheelCallback(int eventType, const EmscriptenWheelEven
             deltaType = GLFMMouseWheelDeltaPage;
             break;
     }
-    return display->mouseWheelFunc(display,
-                                   platformData->scale * (double)wheelEvent->mouse.targetX,
-                                   platformData->scale * (double)wheelEvent->mouse.targetY,
-                                   deltaType, wheelEvent->deltaX, wheelEvent->deltaY, wheelEvent->deltaZ);
+    return glfm__dispatchMouseWheelEvent(display, glfm__getEventTime(wheelEvent->mouse.timestamp),
+                                         platformData->scale * (double)wheelEvent->mouse.targetX,
+                                         platformData->scale * (double)wheelEvent->mouse.targetY,
+                                         deltaType, wheelEvent->deltaX, wheelEvent->deltaY,
+                                         wheelEvent->deltaZ);
 }
 
 static int glfm__getTouchIdentifier(GLFMPlatformData *platformData, const EmscriptenTouchPoint *touch) {
@@ -823,10 +1662,11 @@ static int glfm__getTouchIdentifier(GLFMPlatformData *platformData, const Emscri
 
 static EM_BOOL glfm__touchCallback(int eventType, const EmscriptenTouchEvent *event, void *userData) {
     GLFMDisplay *display = userData;
-    if (!display->touchFunc) {
+    if (!glfm__isTouchInputNeeded(display)) {
         return 0;
     }
     GLFMPlatformData *platformData = display->platformData;
+    const double timestamp = glfm__getEventTime(event->timestamp);
     GLFMTouchPhase touchPhase;
     switch (eventType) {
         case EMSCRIPTEN_EVENT_TOUCHSTART:
@@ -854,9 +1694,9 @@ static EM_BOOL glfm__touchCallback(int eventType, const EmscriptenTouchEvent *ev
             int identifier = glfm__getTouchIdentifier(platformData, touch);
             if (identifier >= 0) {
                 if ((platformData->multitouchEnabled || identifier == 0)) {
-                    handled |= display->touchFunc(display, identifier, touchPhase,
-                                                  platformData->scale * (double)touch->targetX,
-                                                  platformData->scale * (double)touch->targetY);
+                    handled |= glfm__dispatchTouchEvent(display, timestamp, identifier, touchPhase,
+                                                        platformData->scale * (double)touch->targetX,
+                                                        platformData->scale * (double)touch->targetY);
                 }
 
                 if (touchPhase == GLFMTouchPhaseEnded || touchPhase == GLFMTouchPhaseCancelled) {
@@ -868,6 +1708,407 @@ static EM_BOOL glfm__touchCallback(int eventType, const EmscriptenTouchEvent *ev
     return handled;
 }
 
+// MARK: - Event forwarding (OffscreenCanvas)
+
+#if GLFM_EMSCRIPTEN_OFFSCREEN_CANVAS
+
+/// Adds DOM event listeners on the browser's main thread. The listeners write events to the event
+/// ring, which is read by the worker thread in glfm__receiveForwardedEvents().
+static void glfm__startEventForwarding(GLFMDisplay *display) {
+    GLFMPlatformData *platformData = display->platformData;
+    GLFMEventRing *ring = &platformData->eventRing;
+    MAIN_THREAD_EM_ASM({
+        var events = $0;
+        var capacity = $1;
+        var eventSize = $2;
+        var writeIndexPtr = $3;
+        var readIndexPtr = $4;
+        var flagsPtr = $5;
+        var keyboardEnabled = $6;
+        var orientationEnabled = $7;
+        var canvas = Module['canvas'];
+
+        var write = function(type, value0, value1, x, y, z, key, code, value2, timeStamp) {
+            var writeIndex = Atomics.load(HEAPU32, writeIndexPtr >> 2);
+            var readIndex = Atomics.load(HEAPU32, readIndexPtr >> 2);
+            if (((writeIndex - readIndex) >>> 0) >= capacity) {
+                // Full. The worker thread is busy; drop the event.
+                return;
+            }
+            var offset = events + (writeIndex % capacity) * eventSize;
+            HEAP32[offset >> 2] = type;
+            HEAP32[(offset + 4) >> 2] = value0;
+            HEAP32[(offset + 8) >> 2] = value1;
+            HEAP32[(offset + 12) >> 2] = value2 | 0;
+            HEAPF64[(offset + 16) >> 3] = x;
+            HEAPF64[(offset + 24) >> 3] = y;
+            HEAPF64[(offset + 32) >> 3] = z;
+            stringToUTF8(key || "", offset + 40, 32);
+            stringToUTF8(code || "", offset + 72, 32);
+            HEAPF64[(offset + 104) >> 3] = performance.timeOrigin + (timeStamp || performance.now());
+            Atomics.store(HEAPU32, writeIndexPtr >> 2, (writeIndex + 1) >>> 0);
+        };
+        var hasFlag = function(flag) {
+            return (Atomics.load(HEAP32, flagsPtr >> 2) & flag) != 0;
+        };
+        var writeSize = function() {
+            write(16, 0, 0, canvas.clientWidth, canvas.clientHeight, window.devicePixelRatio || 1);
+        };
+        // Used by glfm__pointerLockUpdated()
+        Module['glfmForwardEvent'] = write;
+
+        // Mouse events target the window so that dragging outside the canvas can be detected.
+        var mouseListener = function(type) {
+            return function(event) {
+                if (type == 3 && document.pointerLockElement === canvas) {
+                    // Motion is forwarded by the pointer lock listener
+                    return;
+                }
+                var rect = canvas.getBoundingClientRect();
+                var x = event.clientX - rect.left;
+                var y = event.clientY - rect.top;
+                var inside = x >= 0 && y >= 0 && x < rect.width && y < rect.height;
+                write(type, event.button, inside ? 1 : 0, x, y, 0, "", "", 0, event.timeStamp);
+                // Same as glfm__handleMouseEvent: never prevent default on mousedown for iframe support.
+                if (inside && type != 1 && hasFlag(1)) {
+                    event.preventDefault();
+                }
+            };
+        };
+        window.addEventListener('mousedown', mouseListener(1), true);
+        window.addEventListener('mouseup', mouseListener(2), true);
+        window.addEventListener('mousemove', mouseListener(3), true);
+
+        canvas.addEventListener('wheel', function(event) {
+            var rect = canvas.getBoundingClientRect();
+            write(4, event.clientX - rect.left, event.deltaMode, event.deltaX, event.deltaY, event.deltaZ,
+                  "", "", event.clientY - rect.top, event.timeStamp);
+            if (hasFlag(4)) {
+                event.preventDefault();
+            }
+        }, { capture: true, passive: false });
+
+        var touchListener = function(type) {
+            return function(event) {
+                var rect = canvas.getBoundingClientRect();
+                for (var i = 0; i < event.changedTouches.length; i++) {
+                    var touch = event.changedTouches[i];
+                    write(type, touch.identifier, 0, touch.clientX - rect.left, touch.clientY - rect.top, 0,
+                          "", "", 0, event.timeStamp);
+                }
+                if (hasFlag(1)) {
+                    event.preventDefault();
+                }
+            };
+        };
+        canvas.addEventListener('touchstart', touchListener(5), { capture: true, passive: false });
+        canvas.addEventListener('touchmove', touchListener(6), { capture: true, passive: false });
+        canvas.addEventListener('touchend', touchListener(7), { capture: true, passive: false });
+        canvas.addEventListener('touchcancel', touchListener(8), { capture: true, passive: false });
+
+        var keyListener = function(type) {
+            return function(event) {
+                var modifiers = ((event.shiftKey ? 1 : 0) | (event.ctrlKey ? 2 : 0) |
+                                 (event.altKey ? 4 : 0) | (event.metaKey ? 8 : 0));
+                write(type, modifiers, event.repeat ? 1 : 0, 0, 0, 0, event.key, event.code, 0,
+                      event.timeStamp);
+                // Keep browser shortcuts working
+                if (hasFlag(2) && !event.ctrlKey && !event.metaKey) {
+                    event.preventDefault();
+                }
+            };
+        };
+        if (keyboardEnabled) {
+            window.addEventListener('keydown', keyListener(9), true);
+            window.addEventListener('keyup', keyListener(10), true);
+            window.addEventListener('keypress', keyListener(11), true);
+        }
+
+        window.addEventListener('focus', function() { write(12, 0, 0, 0, 0, 0); }, true);
+        window.addEventListener('blur', function() { write(13, 0, 0, 0, 0, 0); }, true);
+        document.addEventListener('visibilitychange', function() {
+            write(14, document.hidden ? 1 : 0, 0, 0, 0, 0);
+        }, true);
+        window.addEventListener('beforeunload', function() { write(15, 0, 0, 0, 0, 0); });
+
+        window.addEventListener('resize', writeSize);
+        if (typeof ResizeObserver === 'function') {
+            new ResizeObserver(writeSize).observe(canvas);
+        }
+        if (orientationEnabled) {
+            window.addEventListener('orientationchange', function() { write(17, 0, 0, 0, 0, 0); });
+        }
+        document.addEventListener('freeze', function() { write(18, 0, 0, 0, 0, 0); });
+        document.addEventListener('resume', function() { write(19, 0, 0, 0, 0, 0); });
+        writeSize();
+    }, ring->events, GLFM_EVENT_RING_CAPACITY, sizeof(GLFMForwardedEvent),
+       &ring->writeIndex, &ring->readIndex, &ring->flags,
+       GLFM_FEATURE_KEYBOARD, GLFM_FEATURE_ORIENTATION);
+}
+
+static void glfm__updateForwardedEventFlags(GLFMDisplay *display) {
+    GLFMPlatformData *platformData = display->platformData;
+    int32_t flags = 0;
+    if (glfm__isTouchInputNeeded(display)) {
+        flags |= GLFMForwardedEventFlagTouch;
+    }
+#if GLFM_FEATURE_KEYBOARD
+    if (glfm__isKeyInputNeeded(display) || glfm__isCharInputNeeded(display)) {
+        flags |= GLFMForwardedEventFlagKey;
+    }
+#endif
+    if (glfm__isMouseWheelInputNeeded(display)) {
+        flags |= GLFMForwardedEventFlagWheel;
+    }
+    __atomic_store_n(&platformData->eventRing.flags, flags, __ATOMIC_RELAXED);
+}
+
+/// Dispatches the events forwarded from the browser's main thread to the existing event handlers.
+static void glfm__receiveForwardedEvents(GLFMDisplay *display) {
+    GLFMPlatformData *platformData = display->platformData;
+    GLFMEventRing *ring = &platformData->eventRing;
+    glfm__updateForwardedEventFlags(display);
+
+    uint32_t writeIndex = __atomic_load_n(&ring->writeIndex, __ATOMIC_ACQUIRE);
+    uint32_t readIndex = ring->readIndex;
+    // Event times are converted to this thread's event.timeStamp timebase
+    const double timeOrigin = EM_ASM_DOUBLE({ return performance.timeOrigin; });
+    while (readIndex != writeIndex) {
+        const GLFMForwardedEvent *event = &ring->events[readIndex % GLFM_EVENT_RING_CAPACITY];
+        const double timeStamp = event->time - timeOrigin;
+        switch ((GLFMForwardedEventType)event->type) {
+            case GLFMForwardedEventMouseDown:
+            case GLFMForwardedEventMouseUp:
+            case GLFMForwardedEventMouseMove: {
+                static const int eventTypes[] = {
+                    EMSCRIPTEN_EVENT_MOUSEDOWN, EMSCRIPTEN_EVENT_MOUSEUP, EMSCRIPTEN_EVENT_MOUSEMOVE
+                };
+                glfm__handleMouseEvent(display, glfm__getEventTime(timeStamp),
+                                       eventTypes[event->type - GLFMForwardedEventMouseDown],
+                                       (unsigned short)event->value0, (float)event->x, (float)event->y,
+                                       event->value1 != 0);
+                break;
+            }
+            case GLFMForwardedEventWheel: {
+                EmscriptenWheelEvent wheelEvent = { 0 };
+                wheelEvent.mouse.timestamp = timeStamp;
+                wheelEvent.mouse.targetX = event->value0;
+                wheelEvent.mouse.targetY = event->value2;
+                wheelEvent.deltaMode = (unsigned long)event->value1;
+                wheelEvent.deltaX = event->x;
+                wheelEvent.deltaY = event->y;
+                wheelEvent.deltaZ = event->z;
+                glfm__mouseWheelCallback(EMSCRIPTEN_EVENT_WHEEL, &wheelEvent, display);
+                break;
+            }
+            case GLFMForwardedEventTouchStart:
+            case GLFMForwardedEventTouchMove:
+            case GLFMForwardedEventTouchEnd:
+            case GLFMForwardedEventTouchCancel: {
+                static const int eventTypes[] = {
+                    EMSCRIPTEN_EVENT_TOUCHSTART, EMSCRIPTEN_EVENT_TOUCHMOVE,
+                    EMSCRIPTEN_EVENT_TOUCHEND, EMSCRIPTEN_EVENT_TOUCHCANCEL
+                };
+                EmscriptenTouchEvent touchEvent = { 0 };
+                touchEvent.timestamp = timeStamp;
+                touchEvent.numTouches = 1;
+                touchEvent.touches[0].identifier = event->value0;
+                touchEvent.touches[0].isChanged = 1;
+                touchEvent.touches[0].targetX = (int)event->x;
+                touchEvent.touches[0].targetY = (int)event->y;
+                glfm__touchCallback(eventTypes[event->type - GLFMForwardedEventTouchStart],
+                                    &touchEvent, display);
+                break;
+            }
+#if GLFM_FEATURE_KEYBOARD
+            case GLFMForwardedEventKeyDown:
+            case GLFMForwardedEventKeyUp:
+            case GLFMForwardedEventKeyPress: {
+                static const int eventTypes[] = {
+                    EMSCRIPTEN_EVENT_KEYDOWN, EMSCRIPTEN_EVENT_KEYUP, EMSCRIPTEN_EVENT_KEYPRESS
+                };
+                EmscriptenKeyboardEvent keyEvent = { 0 };
+                keyEvent.timestamp = timeStamp;
+                keyEvent.shiftKey = (event->value0 & 1) != 0;
+                keyEvent.ctrlKey = (event->value0 & 2) != 0;
+                keyEvent.altKey = (event->value0 & 4) != 0;
+                keyEvent.metaKey = (event->value0 & 8) != 0;
+                keyEvent.repeat = event->value1 != 0;
+                memcpy(keyEvent.key, event->key, sizeof(event->key));
+                memcpy(keyEvent.code, event->code, sizeof(event->code));
+                keyEvent.key[sizeof(keyEvent.key) - 1] = '\0';
+                keyEvent.code[sizeof(keyEvent.code) - 1] = '\0';
+                glfm__keyCallback(eventTypes[event->type - GLFMForwardedEventKeyDown],
+                                  &keyEvent, display);
+                break;
+            }
+#endif
+            case GLFMForwardedEventFocus:
+                glfm__focusCallback(EMSCRIPTEN_EVENT_FOCUS, NULL, display);
+                break;
+            case GLFMForwardedEventBlur:
+                glfm__focusCallback(EMSCRIPTEN_EVENT_BLUR, NULL, display);
+                break;
+            case GLFMForwardedEventVisibilityChange: {
+                EmscriptenVisibilityChangeEvent visibilityEvent = { 0 };
+                visibilityEvent.hidden = event->value0;
+                glfm__visibilityChangeCallback(EMSCRIPTEN_EVENT_VISIBILITYCHANGE, &visibilityEvent, display);
+                break;
+            }
+            case GLFMForwardedEventBeforeUnload:
+                glfm__beforeUnloadCallback(EMSCRIPTEN_EVENT_BEFOREUNLOAD, NULL, display);
+                break;
+            case GLFMForwardedEventResize:
+                platformData->canvasClientWidth = event->x;
+                platformData->canvasClientHeight = event->y;
+                platformData->devicePixelRatio = event->z;
+                break;
+#if GLFM_FEATURE_ORIENTATION
+            case GLFMForwardedEventOrientationChange:
+                glfm__orientationChangeCallback(EMSCRIPTEN_EVENT_ORIENTATIONCHANGE, NULL, display);
+                break;
+#endif
+            case GLFMForwardedEventFreeze:
+            case GLFMForwardedEventResume:
+                glfm__setFrozen(display, event->type == GLFMForwardedEventFreeze);
+                break;
+            case GLFMForwardedEventPointerLockChange:
+                display->pointerLocked = display->pointerLockRequested && event->value0 != 0;
+                break;
+            case GLFMForwardedEventRelativeMouseMove:
+                if (display->pointerLocked) {
+                    glfm__addRelativeMouseMotion(display, event->x, event->y);
+                }
+                break;
+            default:
+                break;
+        }
+        readIndex++;
+        __atomic_store_n(&ring->readIndex, readIndex, __ATOMIC_RELEASE);
+    }
+}
+
+#endif // GLFM_EMSCRIPTEN_OFFSCREEN_CANVAS
+
+// MARK: - WebGL context
+
+/// Gets the context attributes to request from the display config and ``GLFMWebContextConfig``.
+/// The `desynchronized` attribute isn't in EmscriptenWebGLContextAttributes, so it's returned
+/// separately.
+static void glfm__getWebGLContextAttributes(const GLFMDisplay *display,
+                                            EmscriptenWebGLContextAttributes *attribs,
+                                            bool *desynchronized) {
+    const GLFMWebContextConfig *config = &display->webContextConfig;
+    emscripten_webgl_init_context_attributes(attribs);
+    attribs->alpha = display->colorFormat == GLFMColorFormatRGBA8888;
+    attribs->depth = display->depthFormat != GLFMDepthFormatNone;
+    attribs->stencil = display->stencilFormat != GLFMStencilFormatNone;
+    attribs->antialias = display->multisample != GLFMMultisampleNone;
+    attribs->premultipliedAlpha = 1;
+    attribs->preserveDrawingBuffer = 0;
+    switch (config->powerPreference) {
+        case GLFMPowerPreferenceLowPower:
+            attribs->powerPreference = EM_WEBGL_POWER_PREFERENCE_LOW_POWER;
+            break;
+        case GLFMPowerPreferenceDefault:
+        case GLFMPowerPreferenceHighPerformance:
+        default:
+            attribs->powerPreference = EM_WEBGL_POWER_PREFERENCE_HIGH_PERFORMANCE;
+            break;
+    }
+    attribs->failIfMajorPerformanceCaveat = 0;
+    attribs->enableExtensionsByDefault = 0;
+
+    *desynchronized = (config->desynchronized || config->lowLatency ||
+                       display->latencyMode == GLFMLatencyModeLowLatency);
+    if (config->lowLatency) {
+        // Browsers only bypass the compositor for opaque canvases. Multisampling adds a resolve
+        // step before presentation.
+        attribs->alpha = 0;
+        attribs->antialias = 0;
+    }
+}
+
+/// Adds the `desynchronized` attribute to the next WebGL context created on this thread. If the
+/// browser can't create a desynchronized context, a regular context is created instead.
+static void glfm__setDesynchronizedContextRequested(bool requested) {
+    EM_ASM({
+        var requested = $0;
+        var patch = function(proto) {
+            if (!proto) {
+                return;
+            }
+            if (requested && !proto.glfmGetContext) {
+                proto.glfmGetContext = proto.getContext;
+                proto.getContext = function(type, attributes) {
+                    if (attributes && (type === "webgl" || type === "webgl2")) {
+                        var desynchronizedAttributes = Object.assign({}, attributes);
+                        desynchronizedAttributes.desynchronized = true;
+                        var context = this.glfmGetContext(type, desynchronizedAttributes);
+                        if (context) {
+                            return context;
+                        }
+                        // Not supported. Fall back to a regular context; the negotiated result
+                        // reports that the context isn't desynchronized.
+                    }
+                    return this.glfmGetContext(type, attributes);
+                };
+            } else if (!requested && proto.glfmGetContext) {
+                proto.getContext = proto.glfmGetContext;
+                delete proto.glfmGetContext;
+            }
+        };
+        if (typeof HTMLCanvasElement !== "undefined") {
+            patch(HTMLCanvasElement.prototype);
+        }
+        if (typeof OffscreenCanvas !== "undefined") {
+            patch(OffscreenCanvas.prototype);
+        }
+    }, requested);
+}
+
+/// Enables the requested extensions and records what the browser provided. Called when the
+/// context is created or restored.
+static void glfm__negotiateWebContext(GLFMDisplay *display) {
+    GLFMPlatformData *platformData = display->platformData;
+    const int contextHandle = platformData->contextHandle;
+    const EmscriptenWebGLContextAttributes *attribs = &platformData->contextAttributes;
+    GLFMWebContextInfo *info = &platformData->webContextInfo;
+    memset(info, 0, sizeof(GLFMWebContextInfo));
+    info->desynchronized = EM_ASM_INT({
+        var context = GL.getContext($0);
+        var attributes = context ? context.GLctx.getContextAttributes() : null;
+        return (attributes && attributes.desynchronized) ? 1 : 0;
+    }, contextHandle);
+    info->lowLatency = info->desynchronized && !attribs->alpha;
+    if (attribs->powerPreference == EM_WEBGL_POWER_PREFERENCE_LOW_POWER) {
+        info->powerPreference = GLFMPowerPreferenceLowPower;
+    } else {
+        info->powerPreference = GLFMPowerPreferenceHighPerformance;
+    }
+    const char *const *extensions = display->webContextConfig.extensions;
+    for (size_t i = 0; extensions && extensions[i]; i++) {
+        info->requestedExtensionCount++;
+        if (emscripten_webgl_enable_extension(contextHandle, extensions[i])) {
+            info->enabledExtensionCount++;
+        } else {
+            GLFM_LOG("WebGL extension not available: %s", extensions[i]);
+        }
+    }
+}
+
+bool glfmGetWebContextInfo(const GLFMDisplay *display, GLFMWebContextInfo *info) {
+    if (!display || !info) {
+        return false;
+    }
+    GLFMPlatformData *platformData = display->platformData;
+    if (!platformData->contextCreated) {
+        return false;
+    }
+    *info = platformData->webContextInfo;
+    return true;
+}
+
 // MARK: - main
 
 int main(void) {
@@ -875,36 +2116,43 @@ int main(void) {
     GLFMPlatformData *platformData = calloc(1, sizeof(GLFMPlatformData));
     glfmDisplay->platformData = platformData;
     glfmDisplay->supportedOrientations = GLFMInterfaceOrientationAll;
+    glfmDisplay->swapInterval = -1;
     platformData->orientation = glfmGetInterfaceOrientation(glfmDisplay);
+#if GLFM_FEATURE_SENSORS
+    glfm__sensorFusionReset(&platformData->sensorFusion);
+#endif
 
     // Main entry
     glfmMain(glfmDisplay);
 
     // Init resizable canvas
+#if GLFM_EMSCRIPTEN_OFFSCREEN_CANVAS
+    platformData->canvasClientWidth = MAIN_THREAD_EM_ASM_DOUBLE({ return Module['canvas'].clientWidth; });
+    platformData->canvasClientHeight = MAIN_THREAD_EM_ASM_DOUBLE({ return Module['canvas'].clientHeight; });
+    platformData->devicePixelRatio = MAIN_THREAD_EM_ASM_DOUBLE({ return window.devicePixelRatio || 1; });
+    emscripten_set_canvas_element_size(glfm__webGLTarget,
+                                       (int)(platformData->canvasClientWidth * platformData->devicePixelRatio),
+                                       (int)(platformData->canvasClientHeight * platformData->devicePixelRatio));
+    platformData->scale = platformData->devicePixelRatio;
+#else
     EM_ASM({
         var canvas = Module['canvas'];
         var devicePixelRatio = window.devicePixelRatio || 1;
         canvas.width = canvas.clientWidth * devicePixelRatio;
         canvas.height = canvas.clientHeight * devicePixelRatio;
     });
+    platformData->scale = emscripten_get_device_pixel_ratio();
+#endif
     platformData->width = glfm__getDisplayWidth(glfmDisplay);
     platformData->height = glfm__getDisplayHeight(glfmDisplay);
-    platformData->scale = emscripten_get_device_pixel_ratio();
 
     // Create WebGL context
     EmscriptenWebGLContextAttributes attribs;
-    emscripten_webgl_init_context_attributes(&attribs);
-    attribs.alpha = glfmDisplay->colorFormat == GLFMColorFormatRGBA8888;
-    attribs.depth = glfmDisplay->depthFormat != GLFMDepthFormatNone;
-    attribs.stencil = glfmDisplay->stencilFormat != GLFMStencilFormatNone;
-    attribs.antialias = glfmDisplay->multisample != GLFMMultisampleNone;
-    attribs.premultipliedAlpha = 1;
-    attribs.preserveDrawingBuffer = 0;
-    attribs.powerPreference = EM_WEBGL_POWER_PREFERENCE_HIGH_PERFORMANCE;
-    attribs.failIfMajorPerformanceCaveat = 0;
-    attribs.enableExtensionsByDefault = 0;
-
-    const char *webGLTarget = "#canvas";
+    bool desynchronized;
+    glfm__getWebGLContextAttributes(glfmDisplay, &attribs, &desynchronized);
+    glfm__setDesynchronizedContextRequested(desynchronized);
+
+    const char *webGLTarget = glfm__webGLTarget;
     int contextHandle = 0;
     if (glfmDisplay->preferredAPI >= GLFMRenderingAPIOpenGLES3) {
         // OpenGL ES 3.0 / WebGL 2.0
@@ -924,6 +2172,7 @@ int main(void) {
             platformData->renderingAPI = GLFMRenderingAPIOpenGLES2;
         }
     }
+    glfm__setDesynchronizedContextRequested(false);
     if (!contextHandle) {
         GLFM_LOG("Couldn't create GL context");
         glfm__reportSurfaceError(glfmDisplay, "Couldn't create GL context");
@@ -931,6 +2180,10 @@ int main(void) {
     }
 
     emscripten_webgl_make_context_current(contextHandle);
+    platformData->contextCreated = true;
+    platformData->contextHandle = contextHandle;
+    platformData->contextAttributes = attribs;
+    glfm__negotiateWebContext(glfmDisplay);
 
     if (glfmDisplay->surfaceCreatedFunc) {
         glfmDisplay->surfaceCreatedFunc(glfmDisplay, platformData->width, platformData->height);
@@ -938,7 +2191,13 @@ int main(void) {
     glfm__setVisibleAndFocused(glfmDisplay, true, true);
 
     // Setup callbacks
-    emscripten_set_main_loop_arg(glfm__mainLoopFunc, glfmDisplay, 0, 0);
+    glfm__updateAnimationFrameLoop(glfmDisplay);
+    emscripten_set_webglcontextlost_callback(webGLTarget, glfmDisplay, 1, glfm__webGLContextCallback);
+    emscripten_set_webglcontextrestored_callback(webGLTarget, glfmDisplay, 1, glfm__webGLContextCallback);
+#if GLFM_EMSCRIPTEN_OFFSCREEN_CANVAS
+    // DOM events are only available on the browser's main thread
+    glfm__startEventForwarding(glfmDisplay);
+#else
     emscripten_set_touchstart_callback(webGLTarget, glfmDisplay, 1, glfm__touchCallback);
     emscripten_set_touchend_callback(webGLTarget, glfmDisplay, 1, glfm__touchCallback);
     emscripten_set_touchmove_callback(webGLTarget, glfmDisplay, 1, glfm__touchCallback);
@@ -949,17 +2208,30 @@ int main(void) {
     emscripten_set_wheel_callback(webGLTarget, glfmDisplay, 1, glfm__mouseWheelCallback);
     //emscripten_set_click_callback(webGLTarget, glfmDisplay, 1, glfm__mouseCallback);
     //emscripten_set_dblclick_callback(webGLTarget, glfmDisplay, 1, glfm__mouseCallback);
+#if GLFM_FEATURE_KEYBOARD
     emscripten_set_keypress_callback(EMSCRIPTEN_EVENT_TARGET_WINDOW, glfmDisplay, 1, glfm__keyCallback);
     emscripten_set_keydown_callback(EMSCRIPTEN_EVENT_TARGET_WINDOW, glfmDisplay, 1, glfm__keyCallback);
     emscripten_set_keyup_callback(EMSCRIPTEN_EVENT_TARGET_WINDOW, glfmDisplay, 1, glfm__keyCallback);
-    emscripten_set_webglcontextlost_callback(webGLTarget, glfmDisplay, 1, glfm__webGLContextCallback);
-    emscripten_set_webglcontextrestored_callback(webGLTarget, glfmDisplay, 1, glfm__webGLContextCallback);
+#endif
     emscripten_set_visibilitychange_callback(glfmDisplay, 1, glfm__visibilityChangeCallback);
     emscripten_set_focus_callback(EMSCRIPTEN_EVENT_TARGET_WINDOW, glfmDisplay, 1, glfm__focusCallback);
     emscripten_set_blur_callback(EMSCRIPTEN_EVENT_TARGET_WINDOW, glfmDisplay, 1, glfm__focusCallback);
     emscripten_set_beforeunload_callback(glfmDisplay, glfm__beforeUnloadCallback);
+#if GLFM_FEATURE_ORIENTATION
     emscripten_set_deviceorientation_callback(glfmDisplay, 1, glfm__orientationChangeCallback);
+#endif
+    EM_ASM({
+        // Page Lifecycle API. A hidden page may be frozen, which stops all tasks.
+        document.addEventListener('freeze', function() { _glfm__pageLifecycleCallback($0, 1); });
+        document.addEventListener('resume', function() { _glfm__pageLifecycleCallback($0, 0); });
+    }, glfmDisplay);
+#endif
+#if GLFM_EMSCRIPTEN_OFFSCREEN_CANVAS
+    // Keep the worker thread alive after main() returns. The animation frame loop doesn't.
+    emscripten_exit_with_live_runtime();
+#else
     return 0;
+#endif
 }
 
 #endif // __EMSCRIPTEN__
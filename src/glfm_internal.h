@@ -5,6 +5,7 @@
 #define GLFM_INTERNAL_H
 
 #include "glfm.h"
+#include <math.h>
 #include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -15,17 +16,106 @@ extern "C" {
 #endif
 
 #define GLFM_NUM_SENSORS 4
+#define GLFM_DEFAULT_FRAME_INTERVAL (1.0 / 60.0)
+#define GLFM_MAX_FRAME_INTERVAL 0.25
+#define GLFM_EVENT_QUEUE_CAPACITY 256
+#define GLFM_PRESENT_FEEDBACK_CAPACITY 16
+#define GLFM_IDLE_TASK_CAPACITY 64
+#define GLFM_IDLE_TASK_MARGIN 0.001
+#define GLFM_MAX_PERFORMANCE_HINT_THREADS 33
+#define GLFM_THERMAL_POLL_INTERVAL 2.0
+#define GLFM_THERMAL_SMOOTHING_TIME 6.0
+#define GLFM_THERMAL_TREND_TIME 30.0
+#define GLFM_THERMAL_LOOKAHEAD 30.0
+#define GLFM_THERMAL_STEP_UP_DELAY 6.0
+#define GLFM_THERMAL_STEP_UP_INTERVAL 10.0
+#define GLFM_THERMAL_STEP_DOWN_INTERVAL 30.0
+#define GLFM_THERMAL_HYSTERESIS 0.1
+#define GLFM_THERMAL_LEVEL_COUNT 4
 
-#if defined(__GNUC__) && __STDC_VERSION__ >= 199901
-#define GLFM_IGNORE_DEPRECATIONS_START \
-    _Pragma("GCC diagnostic push") \
-    _Pragma("GCC diagnostic ignored \"-Wdeprecated-declarations\"")
-#define GLFM_IGNORE_DEPRECATIONS_END \
-   _Pragma("GCC diagnostic pop")
-#else
-#define GLFM_IGNORE_DEPRECATIONS_START
-#define GLFM_IGNORE_DEPRECATIONS_END
+// Optional features. When a feature is 0, its code and its startup work (JNI lookups, DOM
+// callbacks, X11 atoms) are removed, and its functions behave as if the feature is unavailable on
+// the device. Set with the matching CMake options. Android, Emscripten, and Linux only.
+#ifndef GLFM_FEATURE_SENSORS
+#define GLFM_FEATURE_SENSORS 1
 #endif
+#ifndef GLFM_FEATURE_CLIPBOARD
+#define GLFM_FEATURE_CLIPBOARD 1
+#endif
+#ifndef GLFM_FEATURE_HAPTICS
+#define GLFM_FEATURE_HAPTICS 1
+#endif
+#ifndef GLFM_FEATURE_KEYBOARD
+#define GLFM_FEATURE_KEYBOARD 1
+#endif
+#ifndef GLFM_FEATURE_MOUSE_CURSOR
+#define GLFM_FEATURE_MOUSE_CURSOR 1
+#endif
+#ifndef GLFM_FEATURE_ORIENTATION
+#define GLFM_FEATURE_ORIENTATION 1
+#endif
+// KTX2 texture loading has no platform code, so it may be removed on Apple platforms too.
+#ifndef GLFM_FEATURE_KTX2
+#define GLFM_FEATURE_KTX2 1
+#endif
+
+#if defined(__APPLE__) && !(GLFM_FEATURE_SENSORS && GLFM_FEATURE_CLIPBOARD && GLFM_FEATURE_HAPTICS && \
+                            GLFM_FEATURE_KEYBOARD && GLFM_FEATURE_MOUSE_CURSOR && GLFM_FEATURE_ORIENTATION)
+#error "GLFM_FEATURE_* options are not supported on Apple platforms"
+#endif
+
+/// Updates the pending times of a frame from the platform. Sets `pending` to false when the times
+/// are final, or if they are unavailable. See glfm__recordSwap().
+typedef void (*GLFMFrameTimestampsFunc)(GLFMDisplay *display, uint64_t platformFrameId,
+                                        GLFMPresentFeedback *feedback);
+
+/// Samples the thermal headroom and state from the platform. Sets `headroom` to NAN if only the
+/// state is available. Returns false if neither is available, in which case the sample is skipped.
+/// See glfm__updateThermalGovernor().
+typedef bool (*GLFMThermalPollFunc)(GLFMDisplay *display, double *headroom, GLFMThermalState *state);
+
+/// The thermal governor. Levels are indexes into glfm__thermalLevels.
+typedef struct {
+    double headroom; // Smoothed over GLFM_THERMAL_SMOOTHING_TIME
+    double slowHeadroom; // Smoothed over GLFM_THERMAL_TREND_TIME
+    double trend; // Change in headroom per second
+    GLFMThermalState state;
+    double sampleTime; // 0 before the first sample
+    double pollTime; // When the platform was last polled, or 0
+    int level;
+    double levelTime; // When the level last changed
+    double highTime; // When the predicted headroom reached the next level's threshold, or 0
+    double lowTime; // When the headroom fell below the current level's threshold, or 0
+} GLFMThermalGovernor;
+
+/// Platform functions for performance hint sessions. See glfm__performanceHintEndWork().
+/// Android implements these with APerformanceHint. Other platforms have none.
+typedef struct {
+    void *(*createSession)(const int32_t *threadIds, int threadCount, int64_t targetNanos);
+    /// May be NULL, in which case the session is recreated when the threads change.
+    bool (*setThreads)(void *session, const int32_t *threadIds, int threadCount);
+    void (*updateTarget)(void *session, int64_t targetNanos);
+    void (*reportActual)(void *session, int64_t actualNanos);
+    void (*closeSession)(void *session);
+} GLFMPerformanceHintFuncs;
+
+typedef struct {
+    const GLFMPerformanceHintFuncs *funcs; // NULL if unsupported
+    void *session;
+    bool sessionFailed;
+    int32_t threadIds[GLFM_MAX_PERFORMANCE_HINT_THREADS];
+    int threadCount;
+    int64_t targetNanos; // The target of the session
+    double requestedTarget; // Set by the app, or 0 for automatic
+    double workStartTime; // 0 if no frame is in progress
+} GLFMPerformanceHint;
+
+typedef struct {
+    GLFMIdleTaskFunc func;
+    void *userData;
+    GLFMIdleTaskPriority priority;
+    uint64_t sequence; // Order scheduled, for tasks of the same priority
+} GLFMIdleTask;
 
 struct GLFMDisplay {
     // Config
@@ -37,6 +127,10 @@ struct GLFMDisplay {
     GLFMInterfaceOrientation supportedOrientations;
     GLFMUserInterfaceChrome uiChrome;
     GLFMSwapBehavior swapBehavior;
+    GLFMLatencyMode latencyMode;
+    int swapInterval; // Negative for the latency mode's default
+    GLFMWebContextConfig webContextConfig;
+    bool sensorRemappingEnabled;
 
     // Callbacks
     GLFM_IGNORE_DEPRECATIONS_START
@@ -47,6 +141,7 @@ struct GLFMDisplay {
     GLFMKeyFunc keyFunc;
     GLFMCharFunc charFunc;
     GLFMMouseWheelFunc mouseWheelFunc;
+    GLFMRelativeMouseFunc relativeMouseFunc;
     GLFMSurfaceErrorFunc surfaceErrorFunc;
     GLFMSurfaceCreatedFunc surfaceCreatedFunc;
     GLFMSurfaceResizedFunc surfaceResizedFunc;
@@ -59,6 +154,73 @@ struct GLFMDisplay {
     GLFMAppFocusFunc focusFunc;
     GLFMSensorFunc sensorFuncs[GLFM_NUM_SENSORS];
 
+    // Event polling. A ring of eventQueueCount events starting at eventQueueHead.
+    // See glfm__queueEvent().
+    bool eventPollingEnabled;
+    int eventQueueHead;
+    int eventQueueCount;
+    GLFMEvent eventQueue[GLFM_EVENT_QUEUE_CAPACITY];
+
+    // Input snapshot. Events update inputState, which is copied to inputSnapshot at the start of
+    // each frame. See glfm__swapInputSnapshot().
+    bool inputSnapshotEnabled;
+    GLFMInputSnapshot inputState;
+    GLFMInputSnapshot inputSnapshot;
+
+    // Pointer lock. The backend sets pointerLocked when the lock is granted or released, and adds
+    // relative motion, which is sent once per frame. See glfm__pointerLockUpdated() and
+    // glfm__sendRelativeMouseMotion().
+    bool pointerLockRequested;
+    bool pointerLocked;
+    double relativeMouseDeltaX;
+    double relativeMouseDeltaY;
+
+    // Frame timing, in the glfmGetTime() timebase. See glfm__setFrameTime(). The frame time may be
+    // simulated, so the frame start time is the real time, for idle task deadlines.
+    double frameTime;
+    double frameStartTime;
+    double frameInterval;
+    double targetPresentTime;
+
+    // Present feedback of recent frames, indexed by frame ID. See glfm__recordSwap().
+    uint64_t lastFrameId;
+    GLFMPresentFeedback presentFeedback[GLFM_PRESENT_FEEDBACK_CAPACITY];
+    uint64_t platformFrameIds[GLFM_PRESENT_FEEDBACK_CAPACITY];
+    GLFMFrameTimestampsFunc frameTimestampsFunc;
+
+    // Suspension, in the glfmGetTime() timebase. See glfm__setSuspended().
+    bool suspended;
+    double suspendStartTime;
+    double suspendDuration;
+
+    // Idle tasks, unordered. The running task is not in the list, and its func is set to NULL if
+    // it is cancelled. See glfm__runIdleTasks().
+    int idleTaskCount;
+    uint64_t idleTaskSequence;
+    GLFMIdleTask idleTasks[GLFM_IDLE_TASK_CAPACITY];
+    GLFMIdleTask runningIdleTask;
+
+    // Thermal state and quality recommendations. See glfm__updateThermalGovernor().
+    GLFMThermalPollFunc thermalPollFunc;
+    GLFMThermalGovernor thermalGovernor;
+    GLFMThermalRecommendationFunc thermalRecommendationFunc;
+
+    // Performance hint session for the render and job threads. See glfm__performanceHintEndWork().
+    GLFMPerformanceHint performanceHint;
+
+    // Vulkan surface and swapchain, or NULL when using OpenGL ES. See glfm_vulkan.h.
+    struct GLFMVulkan *vulkan;
+
+    // Jobs to complete before the next render func, or NULL. See glfm_jobs.h.
+    GLFMJobCounter *frameJobCounter;
+
+    // Thread ID of the render thread, or 0 if glfmSetThreadPolicy() wasn't called. See glfm_threads.h.
+    int32_t renderThreadId;
+
+    // Texture formats of the current context, or 0 if not queried. Cleared when the context is
+    // destroyed. See glfm_texture.h.
+    uint32_t textureFormats;
+
     // External data
     void *userData;
     void *platformData;
@@ -68,6 +230,7 @@ struct GLFMDisplay {
 
 static void glfm__displayChromeUpdated(GLFMDisplay *display);
 static void glfm__sensorFuncUpdated(GLFMDisplay *display);
+static void glfm__pointerLockUpdated(GLFMDisplay *display);
 
 // MARK: - Setters
 
@@ -100,6 +263,8 @@ GLFMInterfaceOrientation glfmGetSupportedInterfaceOrientation(const GLFMDisplay
     return display ? display->supportedOrientations : GLFMInterfaceOrientationAll;
 }
 
+GLFM_IGNORE_DEPRECATIONS_START
+
 GLFMUserInterfaceOrientation glfmGetUserInterfaceOrientation(GLFMDisplay *display) {
     return (GLFMUserInterfaceOrientation)glfmGetSupportedInterfaceOrientation(display);
 }
@@ -109,6 +274,8 @@ void glfmSetUserInterfaceOrientation(GLFMDisplay *display,
     glfmSetSupportedInterfaceOrientation(display, (GLFMInterfaceOrientation)supportedOrientations);
 }
 
+GLFM_IGNORE_DEPRECATIONS_END
+
 void glfmSetUserData(GLFMDisplay *display, void *userData) {
     if (display) {
         display->userData = userData;
@@ -142,11 +309,13 @@ GLFMRenderFunc glfmSetRenderFunc(GLFMDisplay *display, GLFMRenderFunc renderFunc
 static void glfm__deprecatedMainLoopRenderAdapter(GLFMDisplay *display) {
     if (display && display->deprecatedMainLoopFunc) {
         // Mimic the behavior of the deprecated "MainLoop" callback
-        display->deprecatedMainLoopFunc(display, glfmGetTime());
+        display->deprecatedMainLoopFunc(display, glfmGetFrameTime(display));
         glfmSwapBuffers(display);
     }
 }
 
+GLFM_IGNORE_DEPRECATIONS_START
+
 GLFMMainLoopFunc glfmSetMainLoopFunc(GLFMDisplay *display, GLFMMainLoopFunc mainLoopFunc) {
     GLFMMainLoopFunc previous = NULL;
     if (display) {
@@ -157,6 +326,8 @@ GLFMMainLoopFunc glfmSetMainLoopFunc(GLFMDisplay *display, GLFMMainLoopFunc main
     return previous;
 }
 
+GLFM_IGNORE_DEPRECATIONS_END
+
 GLFMSurfaceCreatedFunc glfmSetSurfaceCreatedFunc(GLFMDisplay *display,
                                                  GLFMSurfaceCreatedFunc surfaceCreatedFunc) {
     GLFMSurfaceCreatedFunc previous = NULL;
@@ -263,6 +434,27 @@ GLFMMouseWheelFunc glfmSetMouseWheelFunc(GLFMDisplay *display, GLFMMouseWheelFun
     return previous;
 }
 
+GLFMRelativeMouseFunc glfmSetRelativeMouseFunc(GLFMDisplay *display,
+                                               GLFMRelativeMouseFunc relativeMouseFunc) {
+    GLFMRelativeMouseFunc previous = NULL;
+    if (display) {
+        previous = display->relativeMouseFunc;
+        display->relativeMouseFunc = relativeMouseFunc;
+    }
+    return previous;
+}
+
+void glfmSetPointerLocked(GLFMDisplay *display, bool locked) {
+    if (display && display->pointerLockRequested != locked) {
+        display->pointerLockRequested = locked;
+        glfm__pointerLockUpdated(display);
+    }
+}
+
+bool glfmIsPointerLocked(const GLFMDisplay *display) {
+    return display ? display->pointerLocked : false;
+}
+
 GLFMSensorFunc glfmSetSensorFunc(GLFMDisplay *display, GLFMSensor sensor, GLFMSensorFunc sensorFunc) {
     GLFMSensorFunc previous = NULL;
     int index = (int)sensor;
@@ -276,6 +468,16 @@ GLFMSensorFunc glfmSetSensorFunc(GLFMDisplay *display, GLFMSensor sensor, GLFMSe
     return previous;
 }
 
+void glfmSetSensorRemappingEnabled(GLFMDisplay *display, bool remappingEnabled) {
+    if (display) {
+        display->sensorRemappingEnabled = remappingEnabled;
+    }
+}
+
+bool glfmGetSensorRemappingEnabled(const GLFMDisplay *display) {
+    return display ? display->sensorRemappingEnabled : false;
+}
+
 GLFMMemoryWarningFunc glfmSetMemoryWarningFunc(GLFMDisplay *display, GLFMMemoryWarningFunc lowMemoryFunc) {
     GLFMMemoryWarningFunc previous = NULL;
     if (display) {
@@ -285,6 +487,16 @@ GLFMMemoryWarningFunc glfmSetMemoryWarningFunc(GLFMDisplay *display, GLFMMemoryW
     return previous;
 }
 
+GLFMThermalRecommendationFunc glfmSetThermalRecommendationFunc(GLFMDisplay *display,
+                                                               GLFMThermalRecommendationFunc func) {
+    GLFMThermalRecommendationFunc previous = NULL;
+    if (display) {
+        previous = display->thermalRecommendationFunc;
+        display->thermalRecommendationFunc = func;
+    }
+    return previous;
+}
+
 GLFMAppFocusFunc glfmSetAppFocusFunc(GLFMDisplay *display, GLFMAppFocusFunc focusFunc) {
     GLFMAppFocusFunc previous = NULL;
     if (display) {
@@ -308,6 +520,598 @@ GLFMSwapBehavior glfmGetSwapBehavior(const GLFMDisplay *display) {
     return GLFMSwapBehaviorPlatformDefault;
 }
 
+void glfmSetLatencyMode(GLFMDisplay *display, GLFMLatencyMode latencyMode) {
+    if (display) {
+        display->latencyMode = latencyMode;
+    }
+}
+
+GLFMLatencyMode glfmGetLatencyMode(const GLFMDisplay *display) {
+    return display ? display->latencyMode : GLFMLatencyModeBalanced;
+}
+
+void glfmSetSwapInterval(GLFMDisplay *display, int swapInterval) {
+    if (display) {
+        display->swapInterval = swapInterval < 0 ? -1 : swapInterval;
+    }
+}
+
+int glfmGetSwapInterval(const GLFMDisplay *display) {
+    if (!display) {
+        return 1;
+    }
+    if (display->swapInterval >= 0) {
+        return display->swapInterval;
+    }
+    return display->latencyMode == GLFMLatencyModeLowLatency ? 0 : 1;
+}
+
+void glfmSetWebContextConfig(GLFMDisplay *display, const GLFMWebContextConfig *config) {
+    if (display) {
+        if (config) {
+            display->webContextConfig = *config;
+        } else {
+            memset(&display->webContextConfig, 0, sizeof(display->webContextConfig));
+        }
+    }
+}
+
+double glfmGetFrameTime(const GLFMDisplay *display) {
+    if (display && display->targetPresentTime > 0) {
+        return display->frameTime;
+    }
+    return glfmGetTime();
+}
+
+double glfmGetTargetPresentTime(const GLFMDisplay *display) {
+    if (display && display->targetPresentTime > 0) {
+        return display->targetPresentTime;
+    }
+    return glfmGetTime() + GLFM_DEFAULT_FRAME_INTERVAL;
+}
+
+bool glfmGetPresentFeedback(GLFMDisplay *display, uint64_t frameId, GLFMPresentFeedback *feedback) {
+    if (!display || !feedback || frameId == 0 || frameId > display->lastFrameId ||
+        display->lastFrameId - frameId >= GLFM_PRESENT_FEEDBACK_CAPACITY) {
+        return false;
+    }
+    const size_t index = (size_t)(frameId % GLFM_PRESENT_FEEDBACK_CAPACITY);
+    GLFMPresentFeedback *record = &display->presentFeedback[index];
+    if (record->pending) {
+        if (display->frameTimestampsFunc) {
+            display->frameTimestampsFunc(display, display->platformFrameIds[index], record);
+        } else {
+            record->pending = false;
+        }
+    }
+    *feedback = *record;
+    return true;
+}
+
+double glfmGetSuspendDuration(const GLFMDisplay *display) {
+    return display ? display->suspendDuration : 0.0;
+}
+
+bool glfmScheduleIdleTask(GLFMDisplay *display, GLFMIdleTaskFunc func, void *userData,
+                          GLFMIdleTaskPriority priority) {
+    if (!display || !func) {
+        return false;
+    }
+    // Keep room for the running task, which is added back if it doesn't complete
+    const int reserved = display->runningIdleTask.func ? 1 : 0;
+    if (display->idleTaskCount + reserved >= GLFM_IDLE_TASK_CAPACITY) {
+        return false;
+    }
+    GLFMIdleTask *task = &display->idleTasks[display->idleTaskCount++];
+    task->func = func;
+    task->userData = userData;
+    task->priority = priority;
+    task->sequence = ++display->idleTaskSequence;
+    return true;
+}
+
+void glfmCancelIdleTask(GLFMDisplay *display, GLFMIdleTaskFunc func, void *userData) {
+    if (!display) {
+        return;
+    }
+    for (int i = display->idleTaskCount - 1; i >= 0; i--) {
+        const GLFMIdleTask *task = &display->idleTasks[i];
+        if (task->func == func && task->userData == userData) {
+            display->idleTasks[i] = display->idleTasks[--display->idleTaskCount];
+        }
+    }
+    if (display->runningIdleTask.func == func && display->runningIdleTask.userData == userData) {
+        display->runningIdleTask.func = NULL;
+    }
+}
+
+int glfmGetIdleTaskCount(const GLFMDisplay *display) {
+    return display ? display->idleTaskCount : 0;
+}
+
+void glfmSetPerformanceHintTarget(GLFMDisplay *display, double targetDuration) {
+    if (display) {
+        display->performanceHint.requestedTarget = targetDuration > 0 ? targetDuration : 0;
+    }
+}
+
+double glfmGetPerformanceHintTarget(const GLFMDisplay *display) {
+    return display ? display->performanceHint.requestedTarget : 0;
+}
+
+bool glfmIsPerformanceHintSupported(const GLFMDisplay *display) {
+    return display && display->performanceHint.funcs && !display->performanceHint.sessionFailed;
+}
+
+double glfmGetThermalHeadroom(const GLFMDisplay *display) {
+    return display && display->thermalGovernor.sampleTime > 0 ? display->thermalGovernor.headroom : -1;
+}
+
+GLFMThermalState glfmGetThermalState(const GLFMDisplay *display) {
+    return display ? display->thermalGovernor.state : GLFMThermalStateUnknown;
+}
+
+void glfmSetEventPollingEnabled(GLFMDisplay *display, bool pollingEnabled) {
+    if (display) {
+        display->eventPollingEnabled = pollingEnabled;
+        if (!pollingEnabled) {
+            display->eventQueueHead = 0;
+            display->eventQueueCount = 0;
+        }
+    }
+}
+
+bool glfmIsEventPollingEnabled(const GLFMDisplay *display) {
+    return display ? display->eventPollingEnabled : false;
+}
+
+int glfmPollEvents(GLFMDisplay *display, GLFMEvent *events, int capacity) {
+    if (!display || !events || capacity <= 0) {
+        return 0;
+    }
+    int count = display->eventQueueCount < capacity ? display->eventQueueCount : capacity;
+    for (int i = 0; i < count; i++) {
+        events[i] = display->eventQueue[(display->eventQueueHead + i) % GLFM_EVENT_QUEUE_CAPACITY];
+    }
+    display->eventQueueHead = (display->eventQueueHead + count) % GLFM_EVENT_QUEUE_CAPACITY;
+    display->eventQueueCount -= count;
+    return count;
+}
+
+void glfmSetInputSnapshotEnabled(GLFMDisplay *display, bool snapshotEnabled) {
+    if (display) {
+        display->inputSnapshotEnabled = snapshotEnabled;
+        if (!snapshotEnabled) {
+            memset(&display->inputState, 0, sizeof(display->inputState));
+            memset(&display->inputSnapshot, 0, sizeof(display->inputSnapshot));
+        }
+    }
+}
+
+bool glfmIsInputSnapshotEnabled(const GLFMDisplay *display) {
+    return display ? display->inputSnapshotEnabled : false;
+}
+
+const GLFMInputSnapshot *glfmGetInputSnapshot(const GLFMDisplay *display) {
+    return display ? &display->inputSnapshot : NULL;
+}
+
+bool glfmIsKeyDown(const GLFMInputSnapshot *snapshot, GLFMKeyCode keyCode) {
+    const unsigned int index = (unsigned int)keyCode;
+    if (!snapshot || index >= sizeof(snapshot->keysDown) * 8) {
+        return false;
+    }
+    return (snapshot->keysDown[index / 32] & (1u << (index % 32))) != 0;
+}
+
+// MARK: - Input snapshot
+
+#define GLFM_INPUT_SNAPSHOT_MAX_TOUCHES ((int)(sizeof(((GLFMInputSnapshot *)0)->touches) / \
+                                               sizeof(GLFMTouchState)))
+
+/// Updates a touch of the input snapshot. The velocity is measured with the event times, since a
+/// batch of events can be dispatched at once.
+static void glfm__updateTouchState(GLFMDisplay *display, double timestamp, int touch,
+                                   GLFMTouchPhase phase, double x, double y) {
+    if (touch < 0 || touch >= GLFM_INPUT_SNAPSHOT_MAX_TOUCHES) {
+        return;
+    }
+    GLFMTouchState *state = &display->inputState.touches[touch];
+    if (phase == GLFMTouchPhaseMoved && state->active) {
+        const double dt = timestamp - state->timestamp;
+        if (dt > 0) {
+            state->velocityX = (x - state->x) / dt;
+            state->velocityY = (y - state->y) / dt;
+        }
+    } else {
+        state->velocityX = 0;
+        state->velocityY = 0;
+    }
+    switch (phase) {
+        case GLFMTouchPhaseBegan:
+            state->active = true;
+            break;
+        case GLFMTouchPhaseEnded:
+        case GLFMTouchPhaseCancelled:
+            state->active = false;
+            break;
+        case GLFMTouchPhaseHover:
+        case GLFMTouchPhaseMoved:
+            break;
+    }
+    state->phase = phase;
+    state->x = x;
+    state->y = y;
+    state->timestamp = timestamp;
+}
+
+#if GLFM_FEATURE_KEYBOARD
+
+static void glfm__updateKeyState(GLFMDisplay *display, GLFMKeyCode keyCode, GLFMKeyAction action,
+                                 int modifiers) {
+    GLFMInputSnapshot *state = &display->inputState;
+    const unsigned int index = (unsigned int)keyCode;
+    if (index < sizeof(state->keysDown) * 8) {
+        if (action == GLFMKeyActionReleased) {
+            state->keysDown[index / 32] &= ~(1u << (index % 32));
+        } else {
+            state->keysDown[index / 32] |= (1u << (index % 32));
+        }
+    }
+    state->modifiers = modifiers;
+}
+
+#endif // GLFM_FEATURE_KEYBOARD
+
+/// Releases all keys and touches. Called when focus is lost, since release events may not arrive.
+static void glfm__releaseInputState(GLFMDisplay *display) {
+    memset(display->inputState.keysDown, 0, sizeof(display->inputState.keysDown));
+    display->inputState.modifiers = 0;
+    for (int i = 0; i < GLFM_INPUT_SNAPSHOT_MAX_TOUCHES; i++) {
+        GLFMTouchState *state = &display->inputState.touches[i];
+        if (state->active) {
+            state->active = false;
+            state->phase = GLFMTouchPhaseCancelled;
+            state->velocityX = 0;
+            state->velocityY = 0;
+        }
+    }
+}
+
+static void glfm__sendRelativeMouseMotion(GLFMDisplay *display);
+
+/// Publishes the input state for glfmGetInputSnapshot(), and sends the relative mouse motion of
+/// the frame. Call before invoking the render function.
+static void glfm__swapInputSnapshot(GLFMDisplay *display) {
+    glfm__sendRelativeMouseMotion(display);
+    if (display->inputSnapshotEnabled) {
+        display->inputSnapshot = display->inputState;
+    }
+}
+
+// MARK: - Event dispatch
+
+// Backends send input events through these functions. When polling is enabled, events are queued
+// for glfmPollEvents(); otherwise, they are sent to the callback functions. The input snapshot is
+// updated either way.
+//
+// The `timestamp` is the time the event occurred, in the glfmGetTime() timebase. Events can be
+// dispatched long after they occur, for example when the platform batches input, so use the
+// platform's event time when it is available.
+
+static bool glfm__isTouchInputNeeded(const GLFMDisplay *display) {
+    return display->touchFunc || display->eventPollingEnabled || display->inputSnapshotEnabled;
+}
+
+#if GLFM_FEATURE_KEYBOARD
+
+static bool glfm__isKeyInputNeeded(const GLFMDisplay *display) {
+    return display->keyFunc || display->eventPollingEnabled || display->inputSnapshotEnabled;
+}
+
+static bool glfm__isCharInputNeeded(const GLFMDisplay *display) {
+    return display->charFunc || display->eventPollingEnabled;
+}
+
+#endif // GLFM_FEATURE_KEYBOARD
+
+static bool glfm__isMouseWheelInputNeeded(const GLFMDisplay *display) {
+    return display->mouseWheelFunc || display->eventPollingEnabled;
+}
+
+/// Queues an event. Returns `false` if the queue is full, in which case the event is dropped.
+static bool glfm__queueEvent(GLFMDisplay *display, const GLFMEvent *event) {
+    if (display->eventQueueCount == GLFM_EVENT_QUEUE_CAPACITY) {
+        // Keep the oldest events, so that the app sees the start of each touch
+        return false;
+    }
+    int index = (display->eventQueueHead + display->eventQueueCount) % GLFM_EVENT_QUEUE_CAPACITY;
+    display->eventQueue[index] = *event;
+    display->eventQueueCount++;
+    return true;
+}
+
+static bool glfm__dispatchTouchEvent(GLFMDisplay *display, double timestamp, int touch,
+                                     GLFMTouchPhase phase, double x, double y) {
+    if (display->inputSnapshotEnabled) {
+        glfm__updateTouchState(display, timestamp, touch, phase, x, y);
+    }
+    if (display->eventPollingEnabled) {
+        GLFMEvent event = { .type = GLFMEventTypeTouch, .timestamp = timestamp };
+        event.touch.touch = touch;
+        event.touch.phase = phase;
+        event.touch.x = x;
+        event.touch.y = y;
+        return glfm__queueEvent(display, &event);
+    }
+    return display->touchFunc ? display->touchFunc(display, touch, phase, x, y) : false;
+}
+
+#if GLFM_FEATURE_KEYBOARD
+
+static bool glfm__dispatchKeyEvent(GLFMDisplay *display, double timestamp, GLFMKeyCode keyCode,
+                                   GLFMKeyAction action, int modifiers) {
+    if (display->inputSnapshotEnabled) {
+        glfm__updateKeyState(display, keyCode, action, modifiers);
+    }
+    if (display->eventPollingEnabled) {
+        GLFMEvent event = { .type = GLFMEventTypeKey, .timestamp = timestamp };
+        event.key.keyCode = keyCode;
+        event.key.action = action;
+        event.key.modifiers = modifiers;
+        return glfm__queueEvent(display, &event);
+    }
+    return display->keyFunc ? display->keyFunc(display, keyCode, action, modifiers) : false;
+}
+
+static void glfm__dispatchCharEvent(GLFMDisplay *display, double timestamp, const char *string) {
+    if (!display->eventPollingEnabled) {
+        if (display->charFunc) {
+            display->charFunc(display, string, 0);
+        }
+        return;
+    }
+    // Split into events of whole UTF-8 characters
+    GLFMEvent event = { .type = GLFMEventTypeChar, .timestamp = timestamp };
+    const size_t maxLength = sizeof(event.character.string) - 1;
+    size_t length = strlen(string);
+    while (length > 0) {
+        size_t eventLength = length < maxLength ? length : maxLength;
+        while (eventLength < length && ((unsigned char)string[eventLength] & 0xc0) == 0x80) {
+            eventLength--;
+        }
+        if (eventLength == 0) {
+            // Invalid UTF-8
+            break;
+        }
+        memset(event.character.string, 0, sizeof(event.character.string));
+        memcpy(event.character.string, string, eventLength);
+        if (!glfm__queueEvent(display, &event)) {
+            break;
+        }
+        string += eventLength;
+        length -= eventLength;
+    }
+}
+
+#endif // GLFM_FEATURE_KEYBOARD
+
+static bool glfm__dispatchMouseWheelEvent(GLFMDisplay *display, double timestamp, double x, double y,
+                                          GLFMMouseWheelDeltaType deltaType,
+                                          double deltaX, double deltaY, double deltaZ) {
+    if (display->eventPollingEnabled) {
+        GLFMEvent event = { .type = GLFMEventTypeMouseWheel, .timestamp = timestamp };
+        event.mouseWheel.x = x;
+        event.mouseWheel.y = y;
+        event.mouseWheel.deltaType = deltaType;
+        event.mouseWheel.deltaX = deltaX;
+        event.mouseWheel.deltaY = deltaY;
+        event.mouseWheel.deltaZ = deltaZ;
+        return glfm__queueEvent(display, &event);
+    }
+    if (display->mouseWheelFunc) {
+        return display->mouseWheelFunc(display, x, y, deltaType, deltaX, deltaY, deltaZ);
+    }
+    return false;
+}
+
+/// Adds relative mouse motion, which is sent at the start of the next frame. Backends call this for
+/// every motion event they receive, so that no sub-pixel motion is lost.
+static void glfm__addRelativeMouseMotion(GLFMDisplay *display, double deltaX, double deltaY) {
+    display->relativeMouseDeltaX += deltaX;
+    display->relativeMouseDeltaY += deltaY;
+}
+
+/// Sends the relative mouse motion accumulated since the previous frame. Called from
+/// glfm__swapInputSnapshot().
+static void glfm__sendRelativeMouseMotion(GLFMDisplay *display) {
+    const double deltaX = display->relativeMouseDeltaX;
+    const double deltaY = display->relativeMouseDeltaY;
+    display->relativeMouseDeltaX = 0.0;
+    display->relativeMouseDeltaY = 0.0;
+    display->inputState.mouseDeltaX = deltaX;
+    display->inputState.mouseDeltaY = deltaY;
+    if (deltaX == 0.0 && deltaY == 0.0) {
+        return;
+    }
+    if (display->eventPollingEnabled) {
+        GLFMEvent event = { .type = GLFMEventTypeRelativeMouse, .timestamp = glfmGetTime() };
+        event.relativeMouse.deltaX = deltaX;
+        event.relativeMouse.deltaY = deltaY;
+        glfm__queueEvent(display, &event);
+    } else if (display->relativeMouseFunc) {
+        display->relativeMouseFunc(display, deltaX, deltaY);
+    }
+}
+
+#if GLFM_FEATURE_SENSORS
+
+static void glfm__dispatchSensorEvent(GLFMDisplay *display, GLFMSensorEvent sensorEvent) {
+    GLFMSensorFunc sensorFunc = display->sensorFuncs[sensorEvent.sensor];
+    if (!sensorFunc) {
+        // Sensor is disabled
+        return;
+    }
+    if (display->inputSnapshotEnabled) {
+        display->inputState.sensors[sensorEvent.sensor] = sensorEvent;
+        display->inputState.sensorsValid[sensorEvent.sensor] = true;
+    }
+    if (display->eventPollingEnabled) {
+        // The sensor timestamp may use a different timebase
+        GLFMEvent event = { .type = GLFMEventTypeSensor, .timestamp = glfmGetTime() };
+        event.sensor = sensorEvent;
+        glfm__queueEvent(display, &event);
+    } else {
+        sensorFunc(display, sensorEvent);
+    }
+}
+
+#endif // GLFM_FEATURE_SENSORS
+
+// MARK: - Thermal governor
+
+/// Quality levels, from full quality to lowest. A level is entered when the predicted headroom
+/// reaches its threshold, or when the thermal state reaches its state (if not unknown).
+static const struct {
+    double threshold;
+    GLFMThermalState state;
+    int maxFrameRate;
+    double renderScale;
+} glfm__thermalLevels[GLFM_THERMAL_LEVEL_COUNT] = {
+    { 0.0, GLFMThermalStateUnknown, 0, 1.0 },
+    { 0.75, GLFMThermalStateUnknown, 0, 0.85 },
+    { 0.85, GLFMThermalStateSerious, 60, 0.75 },
+    { 0.95, GLFMThermalStateCritical, 30, 0.6 },
+};
+
+/// Estimates the headroom from the thermal state, for platforms that only report the state.
+static double glfm__thermalStateHeadroom(GLFMThermalState state) {
+    switch (state) {
+        case GLFMThermalStateNominal: return 0.4;
+        case GLFMThermalStateFair: return 0.75;
+        case GLFMThermalStateSerious: return 1.0;
+        case GLFMThermalStateCritical: return 1.2;
+        case GLFMThermalStateUnknown: default: return NAN;
+    }
+}
+
+/// Adds a thermal sample to the governor, and returns the new level. The policy is independent of
+/// the platform:
+///
+/// - The headroom is smoothed, so that a single sample doesn't change the level. The trend is the
+///   difference between a fast and a slow moving average, which for a steady rise is the rate of
+///   change times the difference in their time constants.
+/// - The level steps up when the headroom predicted GLFM_THERMAL_LOOKAHEAD seconds ahead stays
+///   above the next threshold for GLFM_THERMAL_STEP_UP_DELAY seconds, at most once per
+///   GLFM_THERMAL_STEP_UP_INTERVAL. The level steps up immediately if the thermal state reaches a
+///   level's state.
+/// - The level steps down after the headroom has stayed below the current threshold, less
+///   GLFM_THERMAL_HYSTERESIS, for GLFM_THERMAL_STEP_DOWN_INTERVAL seconds.
+/// - A sample without a finite headroom uses an estimate from the state, and is skipped if the
+///   state is unknown.
+static int glfm__thermalGovernorUpdate(GLFMThermalGovernor *governor, double time, double headroom,
+                                       GLFMThermalState state) {
+    if (!isfinite(headroom)) {
+        headroom = glfm__thermalStateHeadroom(state);
+        if (isnan(headroom)) {
+            return governor->level;
+        }
+    }
+
+    // Smooth
+    if (governor->sampleTime <= 0) {
+        governor->headroom = headroom;
+        governor->slowHeadroom = headroom;
+        governor->levelTime = time;
+    } else {
+        const double dt = time - governor->sampleTime;
+        if (dt <= 0) {
+            return governor->level;
+        }
+        governor->headroom += ((headroom - governor->headroom) *
+                               (1.0 - exp(-dt / GLFM_THERMAL_SMOOTHING_TIME)));
+        governor->slowHeadroom += ((headroom - governor->slowHeadroom) *
+                                   (1.0 - exp(-dt / GLFM_THERMAL_TREND_TIME)));
+    }
+    governor->trend = ((governor->headroom - governor->slowHeadroom) /
+                       (GLFM_THERMAL_TREND_TIME - GLFM_THERMAL_SMOOTHING_TIME));
+    governor->sampleTime = time;
+    governor->state = state;
+
+    // Step up
+    int stateLevel = 0;
+    int predictedLevel = 0;
+    const double predicted = governor->headroom + fmax(governor->trend, 0.0) * GLFM_THERMAL_LOOKAHEAD;
+    for (int i = 1; i < GLFM_THERMAL_LEVEL_COUNT; i++) {
+        if (glfm__thermalLevels[i].state != GLFMThermalStateUnknown &&
+            state >= glfm__thermalLevels[i].state) {
+            stateLevel = i;
+        }
+        if (predicted >= glfm__thermalLevels[i].threshold) {
+            predictedLevel = i;
+        }
+    }
+    if (stateLevel > governor->level) {
+        governor->level = stateLevel;
+        governor->levelTime = time;
+        governor->highTime = 0;
+        governor->lowTime = 0;
+        return governor->level;
+    }
+    if (predictedLevel > governor->level) {
+        governor->lowTime = 0;
+        if (governor->highTime <= 0) {
+            governor->highTime = time;
+        } else if (time - governor->highTime >= GLFM_THERMAL_STEP_UP_DELAY &&
+                   time - governor->levelTime >= GLFM_THERMAL_STEP_UP_INTERVAL) {
+            governor->level++;
+            governor->levelTime = time;
+            governor->highTime = 0;
+        }
+        return governor->level;
+    }
+    governor->highTime = 0;
+
+    // Step down
+    const double lowThreshold = glfm__thermalLevels[governor->level].threshold - GLFM_THERMAL_HYSTERESIS;
+    if (governor->level > stateLevel && governor->headroom < lowThreshold) {
+        if (governor->lowTime <= 0) {
+            governor->lowTime = time;
+        } else if (time - governor->lowTime >= GLFM_THERMAL_STEP_DOWN_INTERVAL) {
+            governor->level--;
+            governor->levelTime = time;
+            governor->lowTime = 0;
+        }
+    } else {
+        governor->lowTime = 0;
+    }
+    return governor->level;
+}
+
+/// Samples the thermal state every GLFM_THERMAL_POLL_INTERVAL seconds, and calls the thermal
+/// recommendation function if the level changed. Called from glfm__setFrameTime().
+static void glfm__updateThermalGovernor(GLFMDisplay *display) {
+    GLFMThermalGovernor *governor = &display->thermalGovernor;
+    const double now = glfmGetTime();
+    if (!display->thermalPollFunc ||
+        (governor->pollTime > 0 && now - governor->pollTime < GLFM_THERMAL_POLL_INTERVAL)) {
+        return;
+    }
+    governor->pollTime = now;
+    double headroom = NAN;
+    GLFMThermalState state = GLFMThermalStateUnknown;
+    if (!display->thermalPollFunc(display, &headroom, &state)) {
+        // Skip the sample. Polling continues, since the platform may recover.
+        return;
+    }
+    const int previousLevel = governor->level;
+    const int level = glfm__thermalGovernorUpdate(governor, now, headroom, state);
+    if (level != previousLevel && display->thermalRecommendationFunc) {
+        display->thermalRecommendationFunc(display, glfm__thermalLevels[level].maxFrameRate,
+                                           glfm__thermalLevels[level].renderScale);
+    }
+}
+
 // MARK: - Helper functions
 
 static void glfm__reportSurfaceError(GLFMDisplay *display, const char *errorMessage) {
@@ -316,6 +1120,475 @@ static void glfm__reportSurfaceError(GLFMDisplay *display, const char *errorMess
     }
 }
 
+/// Gets the number of frames that may be waiting to be presented, including the current frame.
+static int glfm__getQueuedFrameCount(const GLFMDisplay *display) {
+    return display->latencyMode == GLFMLatencyModeThroughput ? 2 : 1;
+}
+
+/// Sets the frame time and target present time for the next call to the render function.
+/// If `targetPresentTime` is unknown (zero), it is estimated from the interval between frames.
+static void glfm__setFrameTime(GLFMDisplay *display, double frameTime, double targetPresentTime) {
+    const double delta = frameTime - display->frameTime;
+    if (display->targetPresentTime > 0 && delta > 0 && delta < GLFM_MAX_FRAME_INTERVAL) {
+        // Smooth the interval so that a single late frame doesn't move the estimate much
+        if (display->frameInterval > 0) {
+            display->frameInterval += (delta - display->frameInterval) * 0.1;
+        } else {
+            display->frameInterval = delta;
+        }
+    }
+    const double frameInterval = (display->frameInterval > 0 ?
+                                  display->frameInterval : GLFM_DEFAULT_FRAME_INTERVAL);
+    const double queueDelay = frameInterval * (glfm__getQueuedFrameCount(display) - 1);
+    const double now = glfmGetTime();
+    display->frameTime = frameTime;
+    if (frameTime <= now && now - frameTime < GLFM_MAX_FRAME_INTERVAL) {
+        display->frameStartTime = frameTime;
+    } else {
+        // Simulated
+        display->frameStartTime = now;
+    }
+    if (targetPresentTime > frameTime) {
+        display->targetPresentTime = targetPresentTime + queueDelay;
+    } else {
+        display->targetPresentTime = frameTime + frameInterval + queueDelay;
+    }
+    glfm__updateThermalGovernor(display);
+}
+
+/// Gets the deadline for idle tasks after the current frame: the predicted start of the next frame,
+/// less a margin. The deadline is a real time, even if the frame time is simulated.
+static double glfm__getIdleDeadline(const GLFMDisplay *display) {
+    const double frameInterval = (display->frameInterval > 0 ?
+                                  display->frameInterval : GLFM_DEFAULT_FRAME_INTERVAL);
+    return display->frameStartTime + frameInterval - GLFM_IDLE_TASK_MARGIN;
+}
+
+/// Runs idle tasks until the deadline, highest priority first, then in the order they were
+/// scheduled. The first task runs even if the deadline has passed. A task that doesn't complete
+/// ends the idle period, and keeps its place for the next one. Call after the render function.
+static void glfm__runIdleTasks(GLFMDisplay *display, double deadline) {
+    bool first = true;
+    while (display->idleTaskCount > 0 && (first || glfmGetTime() < deadline)) {
+        first = false;
+        int next = 0;
+        for (int i = 1; i < display->idleTaskCount; i++) {
+            const GLFMIdleTask *task = &display->idleTasks[i];
+            const GLFMIdleTask *nextTask = &display->idleTasks[next];
+            if (task->priority > nextTask->priority ||
+                (task->priority == nextTask->priority && task->sequence < nextTask->sequence)) {
+                next = i;
+            }
+        }
+        display->runningIdleTask = display->idleTasks[next];
+        display->idleTasks[next] = display->idleTasks[--display->idleTaskCount];
+
+        // The task may schedule or cancel tasks, including itself
+        const bool complete = display->runningIdleTask.func(display, display->runningIdleTask.userData,
+                                                            deadline);
+        const bool cancelled = display->runningIdleTask.func == NULL;
+        if (!complete && !cancelled) {
+            display->idleTasks[display->idleTaskCount++] = display->runningIdleTask;
+        }
+        display->runningIdleTask.func = NULL;
+        if (!complete) {
+            break;
+        }
+    }
+}
+
+// The performance hint functions are inline, so that backends without performance hint sessions
+// don't need to call them.
+
+/// Marks the start of a frame's work. Call before the render function.
+static inline void glfm__performanceHintBeginWork(GLFMDisplay *display) {
+    if (display->performanceHint.funcs) {
+        display->performanceHint.workStartTime = glfmGetTime();
+    }
+}
+
+/// Marks the end of a frame's work, and reports its duration to the performance hint session.
+/// Call before swapping, so that time blocked in the swap isn't reported as work.
+///
+/// The session is created on the first frame, for the threads given, and recreated (or updated,
+/// if possible) when the threads change. The target is the app's requested target, or the frame
+/// interval measured by glfm__setFrameTime(). The automatic target is only updated when it changes
+/// by more than 5%, so that jitter in the measured interval isn't reported.
+static inline void glfm__performanceHintEndWork(GLFMDisplay *display, const int32_t *threadIds,
+                                                int threadCount) {
+    GLFMPerformanceHint *hint = &display->performanceHint;
+    if (!hint->funcs || hint->workStartTime <= 0) {
+        return;
+    }
+    const double actualDuration = glfmGetTime() - hint->workStartTime;
+    hint->workStartTime = 0;
+    threadCount = threadCount < GLFM_MAX_PERFORMANCE_HINT_THREADS ? threadCount : GLFM_MAX_PERFORMANCE_HINT_THREADS;
+
+    // Target
+    int64_t targetNanos;
+    if (hint->requestedTarget > 0) {
+        targetNanos = (int64_t)(hint->requestedTarget * 1e9);
+    } else {
+        const double frameInterval = (display->frameInterval > 0 ?
+                                      display->frameInterval : GLFM_DEFAULT_FRAME_INTERVAL);
+        targetNanos = (int64_t)(frameInterval * 1e9);
+        if (hint->targetNanos > 0 && llabs(targetNanos - hint->targetNanos) <= hint->targetNanos / 20) {
+            targetNanos = hint->targetNanos;
+        }
+    }
+
+    // Session
+    const bool threadsChanged = (threadCount != hint->threadCount ||
+                                 memcmp(threadIds, hint->threadIds, sizeof(int32_t) * (size_t)threadCount) != 0);
+    if (threadsChanged) {
+        memcpy(hint->threadIds, threadIds, sizeof(int32_t) * (size_t)threadCount);
+        hint->threadCount = threadCount;
+        if (hint->session && !(hint->funcs->setThreads &&
+                               hint->funcs->setThreads(hint->session, threadIds, threadCount))) {
+            hint->funcs->closeSession(hint->session);
+            hint->session = NULL;
+        }
+        hint->sessionFailed = false;
+    }
+    if (!hint->session) {
+        if (hint->sessionFailed || threadCount <= 0) {
+            return;
+        }
+        hint->session = hint->funcs->createSession(threadIds, threadCount, targetNanos);
+        if (!hint->session) {
+            hint->sessionFailed = true;
+            return;
+        }
+        hint->targetNanos = targetNanos;
+    } else if (targetNanos != hint->targetNanos) {
+        hint->funcs->updateTarget(hint->session, targetNanos);
+        hint->targetNanos = targetNanos;
+    }
+    hint->funcs->reportActual(hint->session, (int64_t)(actualDuration * 1e9));
+}
+
+static inline void glfm__performanceHintDestroy(GLFMDisplay *display) {
+    GLFMPerformanceHint *hint = &display->performanceHint;
+    if (hint->session) {
+        hint->funcs->closeSession(hint->session);
+        hint->session = NULL;
+    }
+    hint->threadCount = 0;
+    hint->targetNanos = 0;
+    hint->workStartTime = 0;
+}
+
+/// Records a call to glfmSwapBuffers(), and returns the frame ID. The times are estimated from the
+/// target present time. If the display has a frameTimestampsFunc, the times are pending until it
+/// reports them for `platformFrameId`.
+static uint64_t glfm__recordSwap(GLFMDisplay *display, uint64_t platformFrameId) {
+    const uint64_t frameId = ++display->lastFrameId;
+    const size_t index = (size_t)(frameId % GLFM_PRESENT_FEEDBACK_CAPACITY);
+    const double now = glfmGetTime();
+    const double frameInterval = (display->frameInterval > 0 ?
+                                  display->frameInterval : GLFM_DEFAULT_FRAME_INTERVAL);
+    double presentTime = glfmGetTargetPresentTime(display);
+    if (presentTime < now) {
+        // Late. Assume the frame is shown at the next refresh.
+        presentTime += ceil((now - presentTime) / frameInterval) * frameInterval;
+    }
+    GLFMPresentFeedback *feedback = &display->presentFeedback[index];
+    memset(feedback, 0, sizeof(GLFMPresentFeedback));
+    feedback->frameId = frameId;
+    feedback->swapTime = now;
+    feedback->gpuCompleteTime = now;
+    feedback->latchTime = fmax(now, presentTime - frameInterval);
+    feedback->presentTime = presentTime;
+    feedback->pending = display->frameTimestampsFunc != NULL;
+    display->platformFrameIds[index] = platformFrameId;
+    return frameId;
+}
+
+/// Records the start or end of a suspension. Call before invoking the focus function.
+static void glfm__setSuspended(GLFMDisplay *display, bool suspended) {
+    if (display->suspended != suspended) {
+        display->suspended = suspended;
+        if (suspended) {
+            display->suspendStartTime = glfmGetTime();
+            glfm__releaseInputState(display);
+        } else {
+            display->suspendDuration = glfmGetTime() - display->suspendStartTime;
+        }
+    }
+}
+
+#if GLFM_FEATURE_SENSORS
+
+/// Remaps a sensor event from the device's natural orientation to the interface orientation, by
+/// rotating around the Z axis. Vectors are remapped the same way as the rows of the matrix.
+static void glfm__remapSensorEvent(GLFMSensorEvent *event, GLFMInterfaceOrientation orientation) {
+    double x, y, z;
+    switch (orientation) {
+        case GLFMInterfaceOrientationLandscapeLeft: // Rotate Z 90 degrees
+            if (event->sensor == GLFMSensorRotationMatrix) {
+                x = event->matrix.m00; y = event->matrix.m01; z = event->matrix.m02;
+                event->matrix.m00 = event->matrix.m10;
+                event->matrix.m01 = event->matrix.m11;
+                event->matrix.m02 = event->matrix.m12;
+                event->matrix.m10 = -x;
+                event->matrix.m11 = -y;
+                event->matrix.m12 = -z;
+            } else {
+                x = event->vector.x;
+                event->vector.x = event->vector.y;
+                event->vector.y = -x;
+            }
+            break;
+        case GLFMInterfaceOrientationPortraitUpsideDown: // Rotate Z 180 degrees
+            if (event->sensor == GLFMSensorRotationMatrix) {
+                event->matrix.m00 = -event->matrix.m00;
+                event->matrix.m01 = -event->matrix.m01;
+                event->matrix.m02 = -event->matrix.m02;
+                event->matrix.m10 = -event->matrix.m10;
+                event->matrix.m11 = -event->matrix.m11;
+                event->matrix.m12 = -event->matrix.m12;
+            } else {
+                event->vector.x = -event->vector.x;
+                event->vector.y = -event->vector.y;
+            }
+            break;
+        case GLFMInterfaceOrientationLandscapeRight: // Rotate Z -90 degrees
+            if (event->sensor == GLFMSensorRotationMatrix) {
+                x = event->matrix.m00; y = event->matrix.m01; z = event->matrix.m02;
+                event->matrix.m00 = -event->matrix.m10;
+                event->matrix.m01 = -event->matrix.m11;
+                event->matrix.m02 = -event->matrix.m12;
+                event->matrix.m10 = x;
+                event->matrix.m11 = y;
+                event->matrix.m12 = z;
+            } else {
+                x = event->vector.x;
+                event->vector.x = -event->vector.y;
+                event->vector.y = x;
+            }
+            break;
+        case GLFMInterfaceOrientationPortrait: default:
+            break;
+    }
+}
+
+// MARK: - Sensor fusion
+
+// Mahony filter gains. The integral gain is what estimates the gyroscope bias.
+#define GLFM_SENSOR_FUSION_KP 1.0f
+#define GLFM_SENSOR_FUSION_KI 0.02f
+#define GLFM_SENSOR_FUSION_MAX_DELTA_TIME 0.5
+
+/// Attitude estimation from accelerometer, gyroscope, and (optionally) magnetometer samples, used
+/// when the platform does not provide a rotation sensor.
+///
+/// Samples are in the Android/W3C device frame: acceleration includes gravity and points up when
+/// the device is at rest (any unit), rotation rate is in radians/second, and the magnetic field is
+/// in any unit. The estimated attitude uses the GLFM reference frame: the X axis points to magnetic
+/// North (or an arbitrary direction without a magnetometer) and the Z axis is vertical.
+typedef struct {
+    float qw, qx, qy, qz; // Device-to-world rotation
+    float biasX, biasY, biasZ; // Integral feedback (negated gyroscope bias)
+    float accelX, accelY, accelZ;
+    float magX, magY, magZ;
+    double timestamp;
+    bool hasAccel;
+    bool hasMag;
+    bool initialized;
+} GLFMSensorFusion;
+
+static void glfm__sensorFusionReset(GLFMSensorFusion *fusion) {
+    memset(fusion, 0, sizeof(GLFMSensorFusion));
+    fusion->qw = 1.0f;
+}
+
+/// Sets the attitude directly from the latest acceleration and magnetic field.
+static void glfm__sensorFusionInitAttitude(GLFMSensorFusion *fusion) {
+    // Up, East, and North in device coordinates. Without a magnetometer, the device's Y axis is
+    // used as the reference direction.
+    float ux = fusion->accelX, uy = fusion->accelY, uz = fusion->accelZ;
+    float mx = 0.0f, my = 1.0f, mz = 0.0f;
+    if (fusion->hasMag) {
+        mx = fusion->magX; my = fusion->magY; mz = fusion->magZ;
+    }
+    float ex = my * uz - mz * uy;
+    float ey = mz * ux - mx * uz;
+    float ez = mx * uy - my * ux;
+    float eNorm = sqrtf(ex * ex + ey * ey + ez * ez);
+    float uNorm = sqrtf(ux * ux + uy * uy + uz * uz);
+    if (eNorm < 1e-6f || uNorm < 1e-6f) {
+        // Free fall, or the reference direction is vertical
+        return;
+    }
+    ex /= eNorm; ey /= eNorm; ez /= eNorm;
+    ux /= uNorm; uy /= uNorm; uz /= uNorm;
+    float nx = uy * ez - uz * ey;
+    float ny = uz * ex - ux * ez;
+    float nz = ux * ey - uy * ex;
+
+    // The rows of the device-to-world matrix are North, West, and Up.
+    float r00 = nx, r01 = ny, r02 = nz;
+    float r10 = -ex, r11 = -ey, r12 = -ez;
+    float r20 = ux, r21 = uy, r22 = uz;
+    float trace = r00 + r11 + r22;
+    if (trace > 0.0f) {
+        float t = 2.0f * sqrtf(1.0f + trace);
+        fusion->qw = 0.25f * t;
+        fusion->qx = (r21 - r12) / t;
+        fusion->qy = (r02 - r20) / t;
+        fusion->qz = (r10 - r01) / t;
+    } else if (r00 > r11 && r00 > r22) {
+        float t = 2.0f * sqrtf(1.0f + r00 - r11 - r22);
+        fusion->qw = (r21 - r12) / t;
+        fusion->qx = 0.25f * t;
+        fusion->qy = (r01 + r10) / t;
+        fusion->qz = (r02 + r20) / t;
+    } else if (r11 > r22) {
+        float t = 2.0f * sqrtf(1.0f + r11 - r00 - r22);
+        fusion->qw = (r02 - r20) / t;
+        fusion->qx = (r01 + r10) / t;
+        fusion->qy = 0.25f * t;
+        fusion->qz = (r12 + r21) / t;
+    } else {
+        float t = 2.0f * sqrtf(1.0f + r22 - r00 - r11);
+        fusion->qw = (r10 - r01) / t;
+        fusion->qx = (r02 + r20) / t;
+        fusion->qy = (r12 + r21) / t;
+        fusion->qz = 0.25f * t;
+    }
+    fusion->initialized = true;
+}
+
+static void glfm__sensorFusionAddAccelerometer(GLFMSensorFusion *fusion, float x, float y, float z) {
+    fusion->accelX = x;
+    fusion->accelY = y;
+    fusion->accelZ = z;
+    fusion->hasAccel = true;
+}
+
+static void glfm__sensorFusionAddMagnetometer(GLFMSensorFusion *fusion, float x, float y, float z) {
+    fusion->magX = x;
+    fusion->magY = y;
+    fusion->magZ = z;
+    fusion->hasMag = true;
+}
+
+/// Integrates a gyroscope sample, corrected by the latest acceleration and magnetic field.
+/// Returns `true` if the attitude is valid.
+///
+/// On devices without a gyroscope, call this function with a zero rotation rate after each
+/// accelerometer sample.
+static bool glfm__sensorFusionAddGyroscope(GLFMSensorFusion *fusion, double timestamp,
+                                           float gx, float gy, float gz) {
+    if (!fusion->hasAccel) {
+        return false;
+    }
+    if (!fusion->initialized) {
+        fusion->timestamp = timestamp;
+        glfm__sensorFusionInitAttitude(fusion);
+        return fusion->initialized;
+    }
+    double dt = timestamp - fusion->timestamp;
+    fusion->timestamp = timestamp;
+    if (dt <= 0.0 || dt > GLFM_SENSOR_FUSION_MAX_DELTA_TIME) {
+        return true;
+    }
+    float halfDt = 0.5f * (float)dt;
+    float qw = fusion->qw, qx = fusion->qx, qy = fusion->qy, qz = fusion->qz;
+
+    float ax = fusion->accelX, ay = fusion->accelY, az = fusion->accelZ;
+    float aNorm = sqrtf(ax * ax + ay * ay + az * az);
+    if (aNorm > 1e-6f) {
+        ax /= aNorm; ay /= aNorm; az /= aNorm;
+
+        // Estimated direction of gravity (up) in device coordinates
+        float vx = 2.0f * (qx * qz - qw * qy);
+        float vy = 2.0f * (qw * qx + qy * qz);
+        float vz = qw * qw - qx * qx - qy * qy + qz * qz;
+
+        // Error is the cross product between the estimated and measured directions
+        float errorX = ay * vz - az * vy;
+        float errorY = az * vx - ax * vz;
+        float errorZ = ax * vy - ay * vx;
+
+        float mx = fusion->magX, my = fusion->magY, mz = fusion->magZ;
+        float mNorm = sqrtf(mx * mx + my * my + mz * mz);
+        if (fusion->hasMag && mNorm > 1e-6f) {
+            mx /= mNorm; my /= mNorm; mz /= mNorm;
+
+            // Magnetic field in world coordinates, rotated to have no Y component
+            float hx = 2.0f * (mx * (0.5f - qy * qy - qz * qz) + my * (qx * qy - qw * qz) +
+                               mz * (qx * qz + qw * qy));
+            float hy = 2.0f * (mx * (qx * qy + qw * qz) + my * (0.5f - qx * qx - qz * qz) +
+                               mz * (qy * qz - qw * qx));
+            float bx = sqrtf(hx * hx + hy * hy);
+            float bz = 2.0f * (mx * (qx * qz - qw * qy) + my * (qy * qz + qw * qx) +
+                               mz * (0.5f - qx * qx - qy * qy));
+
+            // Estimated direction of the magnetic field in device coordinates
+            float wx = 2.0f * (bx * (0.5f - qy * qy - qz * qz) + bz * (qx * qz - qw * qy));
+            float wy = 2.0f * (bx * (qx * qy - qw * qz) + bz * (qw * qx + qy * qz));
+            float wz = 2.0f * (bx * (qw * qy + qx * qz) + bz * (0.5f - qx * qx - qy * qy));
+
+            errorX += my * wz - mz * wy;
+            errorY += mz * wx - mx * wz;
+            errorZ += mx * wy - my * wx;
+        }
+
+        fusion->biasX += GLFM_SENSOR_FUSION_KI * errorX * (float)dt;
+        fusion->biasY += GLFM_SENSOR_FUSION_KI * errorY * (float)dt;
+        fusion->biasZ += GLFM_SENSOR_FUSION_KI * errorZ * (float)dt;
+        gx += GLFM_SENSOR_FUSION_KP * errorX + fusion->biasX;
+        gy += GLFM_SENSOR_FUSION_KP * errorY + fusion->biasY;
+        gz += GLFM_SENSOR_FUSION_KP * errorZ + fusion->biasZ;
+    }
+
+    // Integrate the rate of change of the quaternion
+    gx *= halfDt;
+    gy *= halfDt;
+    gz *= halfDt;
+    fusion->qw = qw - qx * gx - qy * gy - qz * gz;
+    fusion->qx = qx + qw * gx + qy * gz - qz * gy;
+    fusion->qy = qy + qw * gy - qx * gz + qz * gx;
+    fusion->qz = qz + qw * gz + qx * gy - qy * gx;
+
+    float qNorm = sqrtf(fusion->qw * fusion->qw + fusion->qx * fusion->qx +
+                        fusion->qy * fusion->qy + fusion->qz * fusion->qz);
+    if (qNorm < 1e-6f) {
+        glfm__sensorFusionReset(fusion);
+        return false;
+    }
+    fusion->qw /= qNorm;
+    fusion->qx /= qNorm;
+    fusion->qy /= qNorm;
+    fusion->qz /= qNorm;
+    return true;
+}
+
+/// Sets the matrix of a `GLFMSensorRotationMatrix` event from a unit quaternion describing the
+/// device-to-world rotation, where the world's X axis points North and the Z axis is vertical.
+static void glfm__setSensorEventRotation(GLFMSensorEvent *event,
+                                         double qw, double qx, double qy, double qz) {
+    event->sensor = GLFMSensorRotationMatrix;
+    event->matrix.m00 = 1 - 2 * (qy * qy + qz * qz);
+    event->matrix.m10 = 2 * (qx * qy - qz * qw);
+    event->matrix.m20 = 2 * (qx * qz + qy * qw);
+    event->matrix.m01 = 2 * (qx * qy + qz * qw);
+    event->matrix.m11 = 1 - 2 * (qx * qx + qz * qz);
+    event->matrix.m21 = 2 * (qy * qz - qx * qw);
+    event->matrix.m02 = 2 * (qx * qz - qy * qw);
+    event->matrix.m12 = 2 * (qy * qz + qx * qw);
+    event->matrix.m22 = 1 - 2 * (qx * qx + qy * qy);
+}
+
+/// Gets the estimated attitude as a `GLFMSensorRotationMatrix` event.
+static void glfm__sensorFusionGetEvent(const GLFMSensorFusion *fusion, GLFMSensorEvent *event) {
+    glfm__setSensorEventRotation(event, fusion->qw, fusion->qx, fusion->qy, fusion->qz);
+    event->timestamp = fusion->timestamp;
+}
+
+#endif // GLFM_FEATURE_SENSORS
+
 #ifdef __cplusplus
 }
 #endif
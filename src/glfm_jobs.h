@@ -0,0 +1,584 @@
+// GLFM
+// https://github.com/brackeen/glfm
+
+#ifndef GLFM_JOBS_H
+#define GLFM_JOBS_H
+
+// Job system, shared by all backends. Each backend includes this file after glfm_internal.h.
+//
+// Workers are started on first use, one per performance core minus one for the render thread.
+// Each worker owns a deque: it pushes and pops its own jobs at the back, and idle workers steal
+// from the front. Jobs submitted by other threads go to a shared deque that every worker takes
+// from. Threads that wait on a counter run queued jobs while they wait, so waiting never idles a
+// core that could make progress.
+//
+// Without threads (Emscripten without -pthread), there are no workers, and jobs run immediately
+// on the thread that submits them.
+
+#include "glfm_internal.h"
+#include "glfm_threads.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if !defined(__EMSCRIPTEN__) || defined(__EMSCRIPTEN_PTHREADS__)
+#  define GLFM_HAS_JOB_THREADS 1
+#  include <pthread.h>
+#  include <sched.h>
+#  include <unistd.h>
+#  if defined(__APPLE__)
+#    include <sys/sysctl.h>
+#  elif defined(__EMSCRIPTEN__)
+#    include <emscripten/threading.h>
+#  endif
+#else
+#  define GLFM_HAS_JOB_THREADS 0
+#endif
+
+#define GLFM_MAX_JOB_WORKERS 32
+#define GLFM_JOB_DEQUE_INITIAL_CAPACITY 256
+#define GLFM_JOB_SPIN_COUNT 64
+
+typedef struct {
+    GLFMJobFunc func;
+    void *userData;
+    GLFMJobCounter *counter;
+} GLFMJob;
+
+/// A job waiting for a counter to reach zero. See glfmRunJobAfter().
+typedef struct GLFMDeferredJob {
+    GLFMJob job;
+    struct GLFMDeferredJob *next;
+} GLFMDeferredJob;
+
+struct GLFMJobCounter {
+    int value; // Atomic. Modified under the mutex when it reaches zero.
+#if GLFM_HAS_JOB_THREADS
+    pthread_mutex_t mutex;
+#endif
+    GLFMDeferredJob *deferredJobs;
+};
+
+#if GLFM_HAS_JOB_THREADS
+
+/// A ring of `count` jobs starting at `head`. The count is read without the lock to skip empty
+/// deques.
+typedef struct {
+    pthread_mutex_t mutex;
+    GLFMJob *jobs;
+    size_t capacity;
+    size_t head;
+    size_t count;
+} GLFMJobDeque;
+
+typedef struct {
+    int workerCount; // Final once the system has started
+    // One deque per worker. The last deque, at GLFM_MAX_JOB_WORKERS, is shared.
+    GLFMJobDeque deques[GLFM_MAX_JOB_WORKERS + 1];
+    pthread_t threads[GLFM_MAX_JOB_WORKERS];
+#if GLFM_HAS_THREAD_POLICY
+    int32_t threadIds[GLFM_MAX_JOB_WORKERS]; // Atomic. Set by each worker when it starts.
+    int threadPolicy; // Atomic. The policy plus one, or 0 if not set. See glfmSetThreadPolicy().
+#endif
+    int queuedJobs; // Atomic
+
+    // Idle workers, and threads waiting on a counter, sleep on this condition. It is signaled when
+    // a job is queued, and broadcast when a counter reaches zero.
+    pthread_mutex_t sleepMutex;
+    pthread_cond_t sleepCond;
+    int sleepers;
+} GLFMJobSystem;
+
+static GLFMJobSystem glfm__jobSystem;
+static pthread_once_t glfm__jobSystemOnce = PTHREAD_ONCE_INIT;
+static int glfm__jobRequestedWorkerCount = -1;
+static _Thread_local int glfm__jobWorkerIndex = -1;
+
+#endif // GLFM_HAS_JOB_THREADS
+
+// MARK: - Counters
+
+static void glfm__jobCounterInit(GLFMJobCounter *counter) {
+    counter->value = 0;
+    counter->deferredJobs = NULL;
+#if GLFM_HAS_JOB_THREADS
+    pthread_mutex_init(&counter->mutex, NULL);
+#endif
+}
+
+static void glfm__jobCounterDestroy(GLFMJobCounter *counter) {
+#if GLFM_HAS_JOB_THREADS
+    // The thread that decremented the counter to zero may still hold the lock.
+    pthread_mutex_lock(&counter->mutex);
+    pthread_mutex_unlock(&counter->mutex);
+    pthread_mutex_destroy(&counter->mutex);
+#else
+    (void)counter;
+#endif
+}
+
+static void glfm__jobPush(GLFMJob job);
+
+static void glfm__jobWake(bool all) {
+#if GLFM_HAS_JOB_THREADS
+    GLFMJobSystem *system = &glfm__jobSystem;
+    pthread_mutex_lock(&system->sleepMutex);
+    if (system->sleepers > 0) {
+        if (all) {
+            pthread_cond_broadcast(&system->sleepCond);
+        } else {
+            pthread_cond_signal(&system->sleepCond);
+        }
+    }
+    pthread_mutex_unlock(&system->sleepMutex);
+#else
+    (void)all;
+#endif
+}
+
+/// Decrements the counter, and queues its deferred jobs if it reached zero. The counter is not
+/// accessed after its lock is released, so a waiting thread may destroy it.
+static void glfm__jobCounterDecrement(GLFMJobCounter *counter) {
+    GLFMDeferredJob *deferredJobs = NULL;
+#if GLFM_HAS_JOB_THREADS
+    pthread_mutex_lock(&counter->mutex);
+#endif
+    const bool complete = __atomic_sub_fetch(&counter->value, 1, __ATOMIC_ACQ_REL) == 0;
+    if (complete) {
+        deferredJobs = counter->deferredJobs;
+        counter->deferredJobs = NULL;
+    }
+#if GLFM_HAS_JOB_THREADS
+    pthread_mutex_unlock(&counter->mutex);
+#endif
+    while (deferredJobs) {
+        GLFMDeferredJob *next = deferredJobs->next;
+        glfm__jobPush(deferredJobs->job);
+        free(deferredJobs);
+        deferredJobs = next;
+    }
+    if (complete) {
+        glfm__jobWake(true);
+    }
+}
+
+static void glfm__jobRun(const GLFMJob *job) {
+    job->func(job->userData);
+    if (job->counter) {
+        glfm__jobCounterDecrement(job->counter);
+    }
+}
+
+#if GLFM_HAS_JOB_THREADS
+
+// MARK: - Deques
+
+static void glfm__jobDequeInit(GLFMJobDeque *deque) {
+    pthread_mutex_init(&deque->mutex, NULL);
+    deque->jobs = NULL;
+    deque->capacity = 0;
+    deque->head = 0;
+    deque->count = 0;
+}
+
+static bool glfm__jobDequePush(GLFMJobDeque *deque, GLFMJob job) {
+    pthread_mutex_lock(&deque->mutex);
+    if (deque->count == deque->capacity) {
+        const size_t newCapacity = deque->capacity > 0 ? deque->capacity * 2 : GLFM_JOB_DEQUE_INITIAL_CAPACITY;
+        GLFMJob *newJobs = malloc(newCapacity * sizeof(GLFMJob));
+        if (!newJobs) {
+            pthread_mutex_unlock(&deque->mutex);
+            return false;
+        }
+        for (size_t i = 0; i < deque->count; i++) {
+            newJobs[i] = deque->jobs[(deque->head + i) % deque->capacity];
+        }
+        free(deque->jobs);
+        deque->jobs = newJobs;
+        deque->capacity = newCapacity;
+        deque->head = 0;
+    }
+    deque->jobs[(deque->head + deque->count) % deque->capacity] = job;
+    __atomic_store_n(&deque->count, deque->count + 1, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&deque->mutex);
+    return true;
+}
+
+/// Takes a job from the back (the owner, newest first) or the front (thieves, oldest first).
+static bool glfm__jobDequeTake(GLFMJobDeque *deque, bool back, GLFMJob *job) {
+    if (__atomic_load_n(&deque->count, __ATOMIC_ACQUIRE) == 0) {
+        return false;
+    }
+    pthread_mutex_lock(&deque->mutex);
+    const bool taken = deque->count > 0;
+    if (taken) {
+        if (back) {
+            *job = deque->jobs[(deque->head + deque->count - 1) % deque->capacity];
+        } else {
+            *job = deque->jobs[deque->head];
+            deque->head = (deque->head + 1) % deque->capacity;
+        }
+        __atomic_store_n(&deque->count, deque->count - 1, __ATOMIC_RELEASE);
+    }
+    pthread_mutex_unlock(&deque->mutex);
+    return taken;
+}
+
+/// Takes a job for the worker (or -1 for other threads): its own newest job, then the oldest
+/// shared job, then the oldest job of another worker.
+static bool glfm__jobTake(int workerIndex, GLFMJob *job) {
+    GLFMJobSystem *system = &glfm__jobSystem;
+    const int workerCount = __atomic_load_n(&system->workerCount, __ATOMIC_ACQUIRE);
+    bool taken = ((workerIndex >= 0 && glfm__jobDequeTake(&system->deques[workerIndex], true, job)) ||
+                  glfm__jobDequeTake(&system->deques[GLFM_MAX_JOB_WORKERS], false, job));
+    for (int i = 1; !taken && i <= workerCount; i++) {
+        const int victim = (workerIndex + i + workerCount) % workerCount;
+        if (victim != workerIndex) {
+            taken = glfm__jobDequeTake(&system->deques[victim], false, job);
+        }
+    }
+    if (taken) {
+        __atomic_sub_fetch(&system->queuedJobs, 1, __ATOMIC_ACQ_REL);
+    }
+    return taken;
+}
+
+// MARK: - Workers
+
+/// Gets the number of performance cores. On devices with heterogeneous cores, the cores with the
+/// lowest capacity are excluded. See glfm__readCpuTopology().
+static int glfm__jobPerformanceCoreCount(void) {
+#if defined(__APPLE__)
+    int count = 0;
+    size_t size = sizeof(count);
+    if (sysctlbyname("hw.perflevel0.logicalcpu", &count, &size, NULL, 0) != 0 || count <= 0) {
+        size = sizeof(count);
+        if (sysctlbyname("hw.activecpu", &count, &size, NULL, 0) != 0) {
+            count = 1;
+        }
+    }
+    return count;
+#elif defined(__EMSCRIPTEN__)
+    return emscripten_num_logical_cores();
+#else
+    // Sysfs lists offline cores too
+    const GLFMCpuTopology *topology = glfm__getCpuTopology();
+    const int count = __builtin_popcountll(topology->performanceCpuMask);
+    const long onlineCount = sysconf(_SC_NPROCESSORS_ONLN);
+    return onlineCount > 0 && onlineCount < count ? (int)onlineCount : count;
+#endif
+}
+
+static void *glfm__jobWorkerMain(void *param) {
+    GLFMJobSystem *system = &glfm__jobSystem;
+    const int workerIndex = (int)(intptr_t)param;
+    glfm__jobWorkerIndex = workerIndex;
+#if defined(__APPLE__)
+    pthread_set_qos_class_self_np(QOS_CLASS_USER_INTERACTIVE, 0);
+#elif GLFM_HAS_THREAD_POLICY
+    // If the policy is set while this worker starts, either this worker or the setter applies it
+    const int32_t threadId = glfm__getThreadId();
+    __atomic_store_n(&system->threadIds[workerIndex], threadId, __ATOMIC_SEQ_CST);
+    const int threadPolicy = __atomic_load_n(&system->threadPolicy, __ATOMIC_SEQ_CST);
+    if (threadPolicy > 0) {
+        glfm__applyThreadPolicy(threadId, (GLFMThreadPolicy)(threadPolicy - 1));
+    }
+#endif
+    int spins = 0;
+    while (true) {
+        GLFMJob job;
+        if (glfm__jobTake(workerIndex, &job)) {
+            glfm__jobRun(&job);
+            spins = 0;
+        } else if (spins < GLFM_JOB_SPIN_COUNT) {
+            // Jobs are often queued in bursts. Yield briefly before sleeping.
+            spins++;
+            sched_yield();
+        } else {
+            pthread_mutex_lock(&system->sleepMutex);
+            while (__atomic_load_n(&system->queuedJobs, __ATOMIC_ACQUIRE) == 0) {
+                system->sleepers++;
+                pthread_cond_wait(&system->sleepCond, &system->sleepMutex);
+                system->sleepers--;
+            }
+            pthread_mutex_unlock(&system->sleepMutex);
+            spins = 0;
+        }
+    }
+    return NULL;
+}
+
+static void glfm__jobSystemStart(void) {
+    GLFMJobSystem *system = &glfm__jobSystem;
+    int workerCount = glfm__jobRequestedWorkerCount;
+    if (workerCount < 0) {
+        workerCount = glfm__jobPerformanceCoreCount() - 1;
+    }
+    workerCount = workerCount < GLFM_MAX_JOB_WORKERS ? workerCount : GLFM_MAX_JOB_WORKERS;
+    pthread_mutex_init(&system->sleepMutex, NULL);
+    pthread_cond_init(&system->sleepCond, NULL);
+    for (int i = 0; i <= GLFM_MAX_JOB_WORKERS; i++) {
+        glfm__jobDequeInit(&system->deques[i]);
+    }
+    for (int i = 0; i < workerCount; i++) {
+        pthread_attr_t attr;
+        pthread_attr_init(&attr);
+        pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+        const bool created = pthread_create(&system->threads[i], &attr, glfm__jobWorkerMain,
+                                            (void *)(intptr_t)i) == 0;
+        pthread_attr_destroy(&attr);
+        if (!created) {
+            GLFM_LOG("Couldn't create job worker %i", i);
+            break;
+        }
+        __atomic_store_n(&system->workerCount, i + 1, __ATOMIC_RELEASE);
+    }
+    GLFM_LOG("Job system started with %i workers", system->workerCount);
+}
+
+static void glfm__jobSystemInit(void) {
+    pthread_once(&glfm__jobSystemOnce, glfm__jobSystemStart);
+}
+
+#endif // GLFM_HAS_JOB_THREADS
+
+static void glfm__jobPush(GLFMJob job) {
+#if GLFM_HAS_JOB_THREADS
+    GLFMJobSystem *system = &glfm__jobSystem;
+    if (__atomic_load_n(&system->workerCount, __ATOMIC_ACQUIRE) > 0) {
+        const int workerIndex = glfm__jobWorkerIndex;
+        GLFMJobDeque *deque = &system->deques[workerIndex >= 0 ? workerIndex : GLFM_MAX_JOB_WORKERS];
+        // Counted before it is queued, so that the count is never less than the number of jobs
+        __atomic_add_fetch(&system->queuedJobs, 1, __ATOMIC_ACQ_REL);
+        if (glfm__jobDequePush(deque, job)) {
+            glfm__jobWake(false);
+            return;
+        }
+        __atomic_sub_fetch(&system->queuedJobs, 1, __ATOMIC_ACQ_REL);
+    }
+#endif
+    glfm__jobRun(&job);
+}
+
+#if GLFM_HAS_THREAD_POLICY
+
+/// Gets the thread IDs of the job workers that have started, without starting the job system.
+/// Returns the number of IDs written.
+static int glfm__jobGetThreadIds(int32_t *threadIds, int maxCount) {
+    GLFMJobSystem *system = &glfm__jobSystem;
+    const int workerCount = __atomic_load_n(&system->workerCount, __ATOMIC_ACQUIRE);
+    int count = 0;
+    for (int i = 0; i < workerCount && count < maxCount; i++) {
+        const int32_t threadId = __atomic_load_n(&system->threadIds[i], __ATOMIC_SEQ_CST);
+        if (threadId != 0) {
+            threadIds[count++] = threadId;
+        }
+    }
+    return count;
+}
+
+static void glfm__jobSetThreadPolicy(GLFMThreadPolicy policy) {
+    glfm__jobSystemInit();
+    __atomic_store_n(&glfm__jobSystem.threadPolicy, (int)policy + 1, __ATOMIC_SEQ_CST);
+    int32_t threadIds[GLFM_MAX_JOB_WORKERS];
+    const int count = glfm__jobGetThreadIds(threadIds, GLFM_MAX_JOB_WORKERS);
+    for (int i = 0; i < count; i++) {
+        glfm__applyThreadPolicy(threadIds[i], policy);
+    }
+}
+
+/// Gets the placement of the job workers. Only policy flags in effect for every worker are set.
+static bool glfm__jobGetThreadPlacement(GLFMThreadPlacement *placement) {
+    int32_t threadIds[GLFM_MAX_JOB_WORKERS];
+    const int count = glfm__jobGetThreadIds(threadIds, GLFM_MAX_JOB_WORKERS);
+    int policy = -1;
+    for (int i = 0; i < count; i++) {
+        GLFMThreadPlacement workerPlacement;
+        if (!glfm__getThreadPlacement(threadIds[i], &workerPlacement)) {
+            return false;
+        }
+        policy &= (int)workerPlacement.policy;
+        placement->cpuMask |= workerPlacement.cpuMask;
+        placement->performanceCpuMask = workerPlacement.performanceCpuMask;
+    }
+    placement->policy = (GLFMThreadPolicy)(count > 0 ? policy : GLFMThreadPolicyDefault);
+    return count > 0;
+}
+
+#endif
+
+// MARK: - Frame jobs
+
+/// Waits for the jobs counted by the display's frame job counter. Called before each render func.
+static void glfm__waitForFrameJobs(GLFMDisplay *display) {
+    if (display && display->frameJobCounter) {
+        glfmWaitForJobCounter(display->frameJobCounter);
+    }
+}
+
+// MARK: - Public functions
+
+void glfmSetJobWorkerCount(int workerCount) {
+#if GLFM_HAS_JOB_THREADS
+    glfm__jobRequestedWorkerCount = workerCount < 0 ? -1 : workerCount;
+#else
+    (void)workerCount;
+#endif
+}
+
+int glfmGetJobWorkerCount(void) {
+#if GLFM_HAS_JOB_THREADS
+    glfm__jobSystemInit();
+    return glfm__jobSystem.workerCount;
+#else
+    return 0;
+#endif
+}
+
+GLFMJobCounter *glfmCreateJobCounter(void) {
+    GLFMJobCounter *counter = malloc(sizeof(GLFMJobCounter));
+    if (counter) {
+        glfm__jobCounterInit(counter);
+    }
+    return counter;
+}
+
+void glfmDestroyJobCounter(GLFMJobCounter *counter) {
+    if (counter) {
+        glfmWaitForJobCounter(counter);
+        glfm__jobCounterDestroy(counter);
+        free(counter);
+    }
+}
+
+bool glfmIsJobCounterComplete(const GLFMJobCounter *counter) {
+    return !counter || __atomic_load_n(&counter->value, __ATOMIC_ACQUIRE) == 0;
+}
+
+void glfmRunJob(GLFMJobFunc func, void *userData, GLFMJobCounter *counter) {
+    glfmRunJobAfter(NULL, func, userData, counter);
+}
+
+void glfmRunJobAfter(GLFMJobCounter *dependency, GLFMJobFunc func, void *userData,
+                     GLFMJobCounter *counter) {
+    if (!func) {
+        return;
+    }
+#if GLFM_HAS_JOB_THREADS
+    glfm__jobSystemInit();
+#endif
+    if (counter) {
+        __atomic_add_fetch(&counter->value, 1, __ATOMIC_ACQ_REL);
+    }
+    GLFMJob job = { func, userData, counter };
+    if (dependency) {
+#if GLFM_HAS_JOB_THREADS
+        pthread_mutex_lock(&dependency->mutex);
+#endif
+        if (__atomic_load_n(&dependency->value, __ATOMIC_ACQUIRE) > 0) {
+            GLFMDeferredJob *deferredJob = malloc(sizeof(GLFMDeferredJob));
+            if (deferredJob) {
+                deferredJob->job = job;
+                deferredJob->next = dependency->deferredJobs;
+                dependency->deferredJobs = deferredJob;
+                job.func = NULL;
+            }
+        }
+#if GLFM_HAS_JOB_THREADS
+        pthread_mutex_unlock(&dependency->mutex);
+#endif
+        if (!job.func) {
+            return;
+        }
+        // Out of memory: run the job once the dependency is complete.
+        glfmWaitForJobCounter(dependency);
+    }
+    glfm__jobPush(job);
+}
+
+void glfmWaitForJobCounter(GLFMJobCounter *counter) {
+    if (!counter) {
+        return;
+    }
+#if GLFM_HAS_JOB_THREADS
+    GLFMJobSystem *system = &glfm__jobSystem;
+    while (__atomic_load_n(&counter->value, __ATOMIC_ACQUIRE) > 0) {
+        GLFMJob job;
+        if (glfm__jobTake(glfm__jobWorkerIndex, &job)) {
+            glfm__jobRun(&job);
+            continue;
+        }
+        pthread_mutex_lock(&system->sleepMutex);
+        while (__atomic_load_n(&counter->value, __ATOMIC_ACQUIRE) > 0 &&
+               __atomic_load_n(&system->queuedJobs, __ATOMIC_ACQUIRE) == 0) {
+            system->sleepers++;
+            pthread_cond_wait(&system->sleepCond, &system->sleepMutex);
+            system->sleepers--;
+        }
+        pthread_mutex_unlock(&system->sleepMutex);
+    }
+#endif
+}
+
+/// A range of a glfmParallelFor() loop. Each job (and the calling thread) claims chunks of
+/// iterations until none are left.
+typedef struct {
+    GLFMJobRangeFunc func;
+    void *userData;
+    int count;
+    int chunkSize;
+    int nextIndex; // Atomic
+} GLFMJobRange;
+
+static void glfm__jobRangeRun(void *userData) {
+    GLFMJobRange *range = userData;
+    while (true) {
+        const int start = __atomic_fetch_add(&range->nextIndex, range->chunkSize, __ATOMIC_ACQ_REL);
+        if (start >= range->count) {
+            break;
+        }
+        const int end = range->count - start > range->chunkSize ? start + range->chunkSize : range->count;
+        range->func(range->userData, start, end);
+    }
+}
+
+void glfmParallelFor(int count, int chunkSize, GLFMJobRangeFunc func, void *userData) {
+    if (count <= 0 || !func) {
+        return;
+    }
+    const int workerCount = glfmGetJobWorkerCount();
+    if (chunkSize <= 0) {
+        // About four chunks per thread, so threads that finish early can balance the load
+        chunkSize = count / ((workerCount + 1) * 4);
+        chunkSize = chunkSize > 0 ? chunkSize : 1;
+    }
+    GLFMJobRange range = { func, userData, count, chunkSize, 0 };
+    const int chunkCount = (count + chunkSize - 1) / chunkSize;
+    const int jobCount = chunkCount - 1 < workerCount ? chunkCount - 1 : workerCount;
+    if (jobCount <= 0) {
+        glfm__jobRangeRun(&range);
+        return;
+    }
+    GLFMJobCounter counter;
+    glfm__jobCounterInit(&counter);
+    for (int i = 0; i < jobCount; i++) {
+        glfmRunJob(glfm__jobRangeRun, &range, &counter);
+    }
+    glfm__jobRangeRun(&range);
+    glfmWaitForJobCounter(&counter);
+    glfm__jobCounterDestroy(&counter);
+}
+
+GLFMJobCounter *glfmGetFrameJobCounter(GLFMDisplay *display) {
+    if (display && !display->frameJobCounter) {
+        display->frameJobCounter = glfmCreateJobCounter();
+    }
+    return display ? display->frameJobCounter : NULL;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // GLFM_JOBS_H
@@ -0,0 +1,3994 @@
+// GLFM
+// https://github.com/brackeen/glfm
+
+#if defined(__linux__) && !defined(__ANDROID__)
+
+// Pixel buffer objects are used for asynchronous readback when the context supports them.
+#define GLFM_INCLUDE_ES3
+
+// The Vulkan loader is opened at runtime, so only the Vulkan headers are needed to build.
+#if GLFM_HAS_VULKAN
+#  define VK_NO_PROTOTYPES
+#  if GLFM_HAS_X11
+#    define VK_USE_PLATFORM_XLIB_KHR
+#  endif
+#  if GLFM_HAS_WAYLAND
+#    define VK_USE_PLATFORM_WAYLAND_KHR
+#  endif
+#  include <vulkan/vulkan.h>
+#endif
+
+#include "glfm.h"
+
+// Windowed displays require Wayland or X11. Without them, only headless displays are available.
+#if GLFM_HAS_X11 || GLFM_HAS_WAYLAND
+#  define GLFM_HAS_WINDOW 1
+#else
+#  define GLFM_HAS_WINDOW 0
+#endif
+#if !GLFM_HAS_X11 && !defined(EGL_NO_X11)
+#  define EGL_NO_X11
+#endif
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <locale.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#if GLFM_HAS_X11
+#  include <X11/XKBlib.h>
+#  include <X11/Xatom.h>
+#  include <X11/Xlib.h>
+#  include <X11/Xutil.h>
+#  include <X11/cursorfont.h>
+#  include <X11/keysym.h>
+#  if GLFM_HAS_XINPUT2
+#    include <X11/extensions/XInput2.h>
+#  endif
+#endif
+
+#if GLFM_HAS_WAYLAND
+#  include <linux/input-event-codes.h>
+#  include <poll.h>
+#  include <sys/mman.h>
+#  include <wayland-client.h>
+#  include <wayland-cursor.h>
+#  include <wayland-egl.h>
+#  include <xkbcommon/xkbcommon.h>
+// Generated by wayland-scanner
+#  include "pointer-constraints-unstable-v1-client-protocol.h"
+#  include "relative-pointer-unstable-v1-client-protocol.h"
+#  include "xdg-shell-client-protocol.h"
+#endif
+
+#if GLFM_HAS_ZLIB
+#  include <zlib.h>
+#endif
+
+#include "glfm_internal.h"
+
+#ifdef NDEBUG
+#  define GLFM_LOG(...) do { } while (0)
+#else
+#  define GLFM_LOG(...) do { fprintf(stderr, "GLFM: "); fprintf(stderr, __VA_ARGS__); fprintf(stderr, "\n"); } while (0)
+#endif
+
+#include "glfm_vulkan.h"
+#include "glfm_threads.h"
+#include "glfm_jobs.h"
+#include "glfm_texture.h"
+
+#define GLFM_DEFAULT_DISPLAY_WIDTH 1280
+#define GLFM_DEFAULT_DISPLAY_HEIGHT 720
+#define GLFM_OUTPUT_DEFAULT_QUEUE_DEPTH 4
+// Pixel buffers are mapped this many frames after their readback is issued.
+#define GLFM_OUTPUT_READBACK_SLOTS 3
+// Read and write times are kept for this many recent frames, for present feedback.
+#define GLFM_OUTPUT_TIMING_SLOTS 64
+#define GLFM_MAX_ACTIVE_TOUCHES 10
+#define GLFM_INPUT_SERVER_RECEIVE_EVENTS 256
+#define GLFM_INPUT_SERVER_MAX_SEND_SIZE (1 << 20)
+
+// MARK: - Platform data
+
+typedef struct {
+    int64_t frameIndex;
+    double readTime;
+    double writeTime;
+} GLFMOutputFrameTiming;
+
+typedef struct {
+    GLFMOutputFormat format;
+    char *path;
+    FILE *file;
+    int width;
+    int height;
+    double frameRate;
+    int64_t frameIndex;
+
+    // Render thread. With OpenGL ES 3.0, frames are read into pixel buffer objects, which are
+    // mapped GLFM_OUTPUT_READBACK_SLOTS frames later so that readback doesn't stall rendering.
+    GLuint pixelBuffers[GLFM_OUTPUT_READBACK_SLOTS];
+    int64_t pixelBufferFrameIndex[GLFM_OUTPUT_READBACK_SLOTS];
+    bool pixelBuffersCreated;
+    bool errorReported;
+
+    // Encoder queue: a ring of `queueDepth` frames, guarded by `mutex`. Slots in the range
+    // [queueHead, queueHead + queueCount) belong to the encoder thread; the rest belong to the
+    // render thread.
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    uint8_t **queuePixels;
+    int64_t *queueFrameIndex;
+    int queueDepth;
+    int queueHead;
+    int queueCount;
+    bool stopRequested;
+    bool failed;
+    // Frame times, indexed by frame index. See glfm__outputGetFrameTimestamps().
+    GLFMOutputFrameTiming timings[GLFM_OUTPUT_TIMING_SLOTS];
+
+    // Encoder thread
+    uint8_t *encodeBuffer;
+} GLFMOutput;
+
+typedef struct {
+    int listenSocket;
+    int clientSocket;
+    char *path;
+
+    // Received bytes, which may end with a partial event
+    uint8_t receiveBuffer[GLFM_INPUT_SERVER_RECEIVE_EVENTS * sizeof(GLFMInjectedEvent)];
+    size_t receiveLength;
+
+    // Acknowledgements of events consumed by the current frame, sent when it is presented
+    GLFMInjectedEventAck *pendingAcks;
+    int pendingAckCount;
+    int pendingAckCapacity;
+
+    // Bytes not yet sent because the socket was full
+    uint8_t *sendBuffer;
+    size_t sendLength;
+    size_t sendCapacity;
+} GLFMInputServer;
+
+// Every GLFMDisplay owns its platform data. There is no mutable global state, so displays can be
+// run concurrently on different threads.
+typedef struct {
+    EGLDisplay eglDisplay;
+    EGLConfig eglConfig;
+    EGLContext eglContext;
+    EGLSurface eglSurface;
+    EGLint eglSwapInterval; // Negative if not set on the surface
+    bool surfaceCreatedNotified;
+
+    int32_t width;
+    int32_t height;
+
+    GLFMRenderingAPI renderingAPI;
+    bool multitouchEnabled;
+    char *clipboardText;
+
+    GLFMOutput *output;
+    GLFMInputServer *inputServer;
+    double fixedFrameRate;
+    int64_t fixedFrameIndex;
+
+#if GLFM_FEATURE_SENSORS
+    // Rotation computed from injected sensor events
+    GLFMSensorFusion sensorFusion;
+    bool gyroscopeInjected;
+#endif
+
+#if GLFM_HAS_WINDOW
+    // Window state, for both window systems
+    bool windowClosed;
+    bool windowVisible;
+    bool focused;
+    bool refreshRequested;
+    bool touchAvailable;
+    bool keysDown[256];
+    unsigned int mouseButtonsDown;
+    // The glfmGetTime() time minus the window system's time, for event timestamps
+    double eventTimeOffset;
+    bool eventTimeOffsetValid;
+    struct {
+        int touchId;
+        bool active;
+        // The last location, because Wayland touch up events have none
+        double x;
+        double y;
+    } activeTouches[GLFM_MAX_ACTIVE_TOUCHES];
+#endif
+
+#if GLFM_HAS_X11
+    // X11 window. NULL for headless displays and Wayland windows.
+    Display *xDisplay;
+    Window xWindow;
+    Colormap xColormap;
+    XIM xInputMethod;
+    XIC xInputContext;
+    Cursor xCursor;
+    Cursor xHiddenCursor; // For pointer lock
+    Atom wmDeleteWindow;
+    // While the pointer is locked, the location of mouse button events
+    int pointerLockX;
+    int pointerLockY;
+#  if GLFM_HAS_XINPUT2
+    int xInputOpcode;
+    bool rawMotionAvailable;
+#  endif
+#endif
+
+#if GLFM_HAS_WAYLAND
+    // Wayland window. NULL for headless displays and X11 windows.
+    struct wl_display *wlDisplay;
+    struct wl_registry *wlRegistry;
+    struct wl_compositor *wlCompositor;
+    struct wl_shm *wlShm;
+    struct wl_seat *wlSeat;
+    struct xdg_wm_base *xdgWmBase;
+    struct zwp_pointer_constraints_v1 *wlPointerConstraints; // Optional
+    struct zwp_relative_pointer_manager_v1 *wlRelativePointerManager; // Optional
+    struct wl_surface *wlSurface;
+    struct xdg_surface *xdgSurface;
+    struct xdg_toplevel *xdgToplevel;
+    struct wl_egl_window *wlEglWindow; // NULL for Vulkan
+    bool wlConfigured;
+    // State of the next configure event
+    int32_t wlPendingWidth;
+    int32_t wlPendingHeight;
+    bool wlPendingActivated;
+    bool wlPendingSuspended;
+    bool wlActivated;
+
+    // Pointer
+    struct wl_pointer *wlPointer;
+    uint32_t wlPointerEnterSerial;
+    double wlPointerX;
+    double wlPointerY;
+    struct zwp_locked_pointer_v1 *wlLockedPointer;
+    struct zwp_relative_pointer_v1 *wlRelativePointer;
+    struct wl_cursor_theme *wlCursorTheme;
+    struct wl_surface *wlCursorSurface;
+    GLFMMouseCursor wlMouseCursor;
+
+    // Keyboard. Without a keymap, key events are sent, but not character events.
+    struct wl_keyboard *wlKeyboard;
+    struct xkb_context *xkbContext;
+    struct xkb_keymap *xkbKeymap;
+    struct xkb_state *xkbState;
+    // Key repeat, which Wayland clients implement
+    int32_t wlRepeatRate;
+    double wlRepeatDelay;
+    uint32_t wlRepeatKey;
+    double wlRepeatTime;
+    bool wlRepeating;
+
+    struct wl_touch *wlTouch;
+#endif
+} GLFMPlatformData;
+
+static bool glfm__isWindowed(const GLFMPlatformData *platformData) {
+#if GLFM_HAS_X11
+    if (platformData->xDisplay) {
+        return true;
+    }
+#endif
+#if GLFM_HAS_WAYLAND
+    if (platformData->wlDisplay) {
+        return true;
+    }
+#endif
+    (void)platformData;
+    return false;
+}
+
+#if GLFM_HAS_WINDOW
+static bool glfm__createWindow(GLFMDisplay *display);
+static void glfm__destroyWindow(GLFMDisplay *display);
+#endif
+
+// MARK: - EGL
+
+/// Gets the EGL display. For headless displays, Mesa's surfaceless platform is preferred, so that
+/// no window system is needed. Wayland windows require the Wayland platform. The EGL display is
+/// shared by all GLFMDisplays in the process and is never terminated, because terminating it would
+/// destroy the contexts of displays running on other threads.
+static EGLDisplay glfm__eglGetDisplay(GLFMPlatformData *platformData) {
+#if GLFM_HAS_X11
+    if (platformData->xDisplay) {
+        return eglGetDisplay((EGLNativeDisplayType)platformData->xDisplay);
+    }
+#endif
+#if GLFM_HAS_WAYLAND && defined(EGL_EXT_platform_base)
+    if (platformData->wlDisplay) {
+        const char *extensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+        PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)
+            eglGetProcAddress("eglGetPlatformDisplayEXT");
+        if (!extensions || !getPlatformDisplay ||
+            (!strstr(extensions, "EGL_EXT_platform_wayland") &&
+             !strstr(extensions, "EGL_KHR_platform_wayland"))) {
+            return EGL_NO_DISPLAY;
+        }
+        return getPlatformDisplay(EGL_PLATFORM_WAYLAND_KHR, platformData->wlDisplay, NULL);
+    }
+#endif
+    (void)platformData;
+    EGLDisplay eglDisplay = EGL_NO_DISPLAY;
+#if defined(EGL_MESA_platform_surfaceless) && defined(EGL_EXT_platform_base)
+    const char *extensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+    if (extensions && strstr(extensions, "EGL_MESA_platform_surfaceless")) {
+        PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)
+            eglGetProcAddress("eglGetPlatformDisplayEXT");
+        if (getPlatformDisplay) {
+            eglDisplay = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+        }
+    }
+#endif
+    if (eglDisplay == EGL_NO_DISPLAY) {
+        eglDisplay = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    }
+    return eglDisplay;
+}
+
+#if GLFM_HAS_WINDOW
+
+static EGLSurface glfm__eglCreateWindowSurface(GLFMPlatformData *platformData) {
+#if GLFM_HAS_WAYLAND && defined(EGL_EXT_platform_base)
+    if (platformData->wlDisplay) {
+        // The display is a platform display, so the surface is a platform surface
+        PFNEGLCREATEPLATFORMWINDOWSURFACEEXTPROC createPlatformWindowSurface =
+            (PFNEGLCREATEPLATFORMWINDOWSURFACEEXTPROC)
+            eglGetProcAddress("eglCreatePlatformWindowSurfaceEXT");
+        if (!createPlatformWindowSurface) {
+            return EGL_NO_SURFACE;
+        }
+        return createPlatformWindowSurface(platformData->eglDisplay, platformData->eglConfig,
+                                           platformData->wlEglWindow, NULL);
+    }
+#endif
+#if GLFM_HAS_X11
+    return eglCreateWindowSurface(platformData->eglDisplay, platformData->eglConfig,
+                                  (EGLNativeWindowType)platformData->xWindow, NULL);
+#else
+    (void)platformData;
+    return EGL_NO_SURFACE;
+#endif
+}
+
+#endif // GLFM_HAS_WINDOW
+
+static bool glfm__eglContextInit(GLFMDisplay *display) {
+    GLFMPlatformData *platformData = display->platformData;
+    static const struct {
+        GLFMRenderingAPI api;
+        EGLint majorVersion;
+        EGLint minorVersion;
+    } versions[] = {
+        { GLFMRenderingAPIOpenGLES32, 3, 2 },
+        { GLFMRenderingAPIOpenGLES31, 3, 1 },
+        { GLFMRenderingAPIOpenGLES3, 3, 0 },
+        { GLFMRenderingAPIOpenGLES2, 2, 0 },
+    };
+    for (size_t i = 0; i < sizeof(versions) / sizeof(*versions); i++) {
+        if (versions[i].api != GLFMRenderingAPIOpenGLES2 && display->preferredAPI < versions[i].api) {
+            continue;
+        }
+        const EGLint contextAttribList[] = {
+            EGL_CONTEXT_MAJOR_VERSION, versions[i].majorVersion,
+            EGL_CONTEXT_MINOR_VERSION, versions[i].minorVersion,
+            EGL_NONE, EGL_NONE
+        };
+        platformData->eglContext = eglCreateContext(platformData->eglDisplay,
+                                                    platformData->eglConfig,
+                                                    EGL_NO_CONTEXT, contextAttribList);
+        if (platformData->eglContext != EGL_NO_CONTEXT) {
+            platformData->renderingAPI = versions[i].api;
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool glfm__eglInit(GLFMDisplay *display) {
+    GLFMPlatformData *platformData = display->platformData;
+    if (platformData->eglContext != EGL_NO_CONTEXT) {
+        return true;
+    }
+
+    int rBits, gBits, bBits, aBits;
+    int depthBits, stencilBits, samples;
+
+    switch (display->colorFormat) {
+        case GLFMColorFormatRGB565:
+            rBits = 5;
+            gBits = 6;
+            bBits = 5;
+            aBits = 0;
+            break;
+        case GLFMColorFormatRGBA8888:
+        default:
+            rBits = 8;
+            gBits = 8;
+            bBits = 8;
+            aBits = 8;
+            break;
+    }
+
+    switch (display->depthFormat) {
+        case GLFMDepthFormatNone:
+        default:
+            depthBits = 0;
+            break;
+        case GLFMDepthFormat16:
+            depthBits = 16;
+            break;
+        case GLFMDepthFormat24:
+            depthBits = 24;
+            break;
+    }
+
+    switch (display->stencilFormat) {
+        case GLFMStencilFormatNone:
+        default:
+            stencilBits = 0;
+            break;
+        case GLFMStencilFormat8:
+            stencilBits = 8;
+            if (depthBits > 0) {
+                // Many implementations only allow 24-bit depth with 8-bit stencil.
+                depthBits = 24;
+            }
+            break;
+    }
+
+    samples = display->multisample == GLFMMultisample4X ? 4 : 0;
+
+    platformData->eglDisplay = glfm__eglGetDisplay(platformData);
+    if (platformData->eglDisplay == EGL_NO_DISPLAY ||
+        !eglInitialize(platformData->eglDisplay, NULL, NULL)) {
+        platformData->eglDisplay = EGL_NO_DISPLAY;
+        glfm__reportSurfaceError(display, "eglInitialize() failed");
+        return false;
+    }
+
+    while (true) {
+        const EGLint attribList[] = {
+            EGL_RENDERABLE_TYPE, EGL_OPENGL_ES2_BIT,
+            EGL_SURFACE_TYPE, glfm__isWindowed(platformData) ? EGL_WINDOW_BIT : EGL_PBUFFER_BIT,
+            EGL_RED_SIZE, rBits,
+            EGL_GREEN_SIZE, gBits,
+            EGL_BLUE_SIZE, bBits,
+            EGL_ALPHA_SIZE, aBits,
+            EGL_DEPTH_SIZE, depthBits,
+            EGL_STENCIL_SIZE, stencilBits,
+            EGL_SAMPLE_BUFFERS, samples > 0 ? 1 : 0,
+            EGL_SAMPLES, samples > 0 ? samples : 0,
+            EGL_NONE, EGL_NONE
+        };
+        EGLint numConfigs = 0;
+        eglChooseConfig(platformData->eglDisplay, attribList,
+                        &platformData->eglConfig, 1, &numConfigs);
+        if (numConfigs) {
+            break;
+        }
+        if (samples > 0) {
+            // Try 2x multisampling or no multisampling
+            samples -= 2;
+        } else if (depthBits > 8) {
+            // Try 16-bit depth or 8-bit depth
+            depthBits -= 8;
+        } else {
+            glfm__reportSurfaceError(display, "eglChooseConfig() failed");
+            platformData->eglDisplay = EGL_NO_DISPLAY;
+            return false;
+        }
+    }
+
+    eglBindAPI(EGL_OPENGL_ES_API);
+    if (!glfm__eglContextInit(display)) {
+        glfm__reportSurfaceError(display, "eglCreateContext() failed");
+        platformData->eglDisplay = EGL_NO_DISPLAY;
+        return false;
+    }
+
+#if GLFM_HAS_WINDOW
+    if (glfm__isWindowed(platformData)) {
+        if (glfm__createWindow(display)) {
+            platformData->eglSurface = glfm__eglCreateWindowSurface(platformData);
+        }
+    } else
+#endif
+    {
+        const EGLint surfaceAttribList[] = {
+            EGL_WIDTH, platformData->width,
+            EGL_HEIGHT, platformData->height,
+            EGL_NONE, EGL_NONE
+        };
+        platformData->eglSurface = eglCreatePbufferSurface(platformData->eglDisplay,
+                                                           platformData->eglConfig,
+                                                           surfaceAttribList);
+    }
+    if (platformData->eglSurface == EGL_NO_SURFACE) {
+        eglDestroyContext(platformData->eglDisplay, platformData->eglContext);
+        platformData->eglContext = EGL_NO_CONTEXT;
+        platformData->eglDisplay = EGL_NO_DISPLAY;
+        glfm__reportSurfaceError(display, "Couldn't create EGL surface");
+        return false;
+    }
+    switch (display->swapBehavior) {
+        case GLFMSwapBehaviorPlatformDefault:
+            // Platform default, do nothing.
+            break;
+        case GLFMSwapBehaviorBufferPreserved:
+            eglSurfaceAttrib(platformData->eglDisplay, platformData->eglSurface,
+                             EGL_SWAP_BEHAVIOR, EGL_BUFFER_PRESERVED);
+            break;
+        case GLFMSwapBehaviorBufferDestroyed:
+            eglSurfaceAttrib(platformData->eglDisplay, platformData->eglSurface,
+                             EGL_SWAP_BEHAVIOR, EGL_BUFFER_DESTROYED);
+            break;
+    }
+    return true;
+}
+
+static bool glfm__eglMakeCurrent(GLFMDisplay *display) {
+    GLFMPlatformData *platformData = display->platformData;
+    // The bound API is per-thread state.
+    eglBindAPI(EGL_OPENGL_ES_API);
+    if (!eglMakeCurrent(platformData->eglDisplay, platformData->eglSurface,
+                        platformData->eglSurface, platformData->eglContext)) {
+        glfm__reportSurfaceError(display, "eglMakeCurrent() failed");
+        return false;
+    }
+    return true;
+}
+
+static void glfm__eglDestroy(GLFMDisplay *display) {
+    GLFMPlatformData *platformData = display->platformData;
+    if (platformData->eglDisplay == EGL_NO_DISPLAY) {
+        return;
+    }
+    if (platformData->surfaceCreatedNotified) {
+        platformData->surfaceCreatedNotified = false;
+        if (display->surfaceDestroyedFunc && glfm__eglMakeCurrent(display)) {
+            display->surfaceDestroyedFunc(display);
+        }
+    }
+    eglMakeCurrent(platformData->eglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    if (platformData->eglSurface != EGL_NO_SURFACE) {
+        eglDestroySurface(platformData->eglDisplay, platformData->eglSurface);
+    }
+    if (platformData->eglContext != EGL_NO_CONTEXT) {
+        eglDestroyContext(platformData->eglDisplay, platformData->eglContext);
+    }
+    eglReleaseThread();
+    platformData->eglDisplay = EGL_NO_DISPLAY;
+    platformData->eglContext = EGL_NO_CONTEXT;
+    platformData->eglSurface = EGL_NO_SURFACE;
+    platformData->eglSwapInterval = -1;
+    display->textureFormats = 0;
+}
+
+/// Sets the swap interval of the current surface if it has changed. See glfmSetSwapInterval().
+static void glfm__eglUpdateSwapInterval(GLFMDisplay *display) {
+    GLFMPlatformData *platformData = display->platformData;
+    const EGLint swapInterval = glfmGetSwapInterval(display);
+    if (platformData->eglSwapInterval != swapInterval) {
+        platformData->eglSwapInterval = swapInterval;
+        if (!eglSwapInterval(platformData->eglDisplay, swapInterval)) {
+            GLFM_LOG("eglSwapInterval(%i) failed", (int)swapInterval);
+        }
+    }
+}
+
+// MARK: - Vulkan
+
+#if GLFM_HAS_VULKAN
+
+/// Creates a Wayland or X11 surface for windowed displays, and a headless surface otherwise.
+/// A GLFMVulkanSurfaceFunc.
+static VkResult glfm__vulkanCreateSurface(GLFMDisplay *display,
+                                          PFN_vkGetInstanceProcAddr getInstanceProcAddr,
+                                          VkInstance instance, VkSurfaceKHR *surface) {
+    GLFMPlatformData *platformData = display->platformData;
+#if GLFM_HAS_WAYLAND
+    if (platformData->wlDisplay) {
+        PFN_vkCreateWaylandSurfaceKHR createWaylandSurface = (PFN_vkCreateWaylandSurfaceKHR)
+            getInstanceProcAddr(instance, "vkCreateWaylandSurfaceKHR");
+        if (!createWaylandSurface) {
+            return VK_ERROR_EXTENSION_NOT_PRESENT;
+        }
+        VkWaylandSurfaceCreateInfoKHR createInfo;
+        memset(&createInfo, 0, sizeof(createInfo));
+        createInfo.sType = VK_STRUCTURE_TYPE_WAYLAND_SURFACE_CREATE_INFO_KHR;
+        createInfo.display = platformData->wlDisplay;
+        createInfo.surface = platformData->wlSurface;
+        return createWaylandSurface(instance, &createInfo, NULL, surface);
+    }
+#endif
+#if GLFM_HAS_X11
+    if (glfm__isWindowed(platformData)) {
+        PFN_vkCreateXlibSurfaceKHR createXlibSurface = (PFN_vkCreateXlibSurfaceKHR)
+            getInstanceProcAddr(instance, "vkCreateXlibSurfaceKHR");
+        if (!createXlibSurface) {
+            return VK_ERROR_EXTENSION_NOT_PRESENT;
+        }
+        VkXlibSurfaceCreateInfoKHR createInfo;
+        memset(&createInfo, 0, sizeof(createInfo));
+        createInfo.sType = VK_STRUCTURE_TYPE_XLIB_SURFACE_CREATE_INFO_KHR;
+        createInfo.dpy = platformData->xDisplay;
+        createInfo.window = platformData->xWindow;
+        return createXlibSurface(instance, &createInfo, NULL, surface);
+    }
+#else
+    (void)platformData;
+#endif
+    PFN_vkCreateHeadlessSurfaceEXT createHeadlessSurface = (PFN_vkCreateHeadlessSurfaceEXT)
+        getInstanceProcAddr(instance, "vkCreateHeadlessSurfaceEXT");
+    if (!createHeadlessSurface) {
+        return VK_ERROR_EXTENSION_NOT_PRESENT;
+    }
+    VkHeadlessSurfaceCreateInfoEXT createInfo;
+    memset(&createInfo, 0, sizeof(createInfo));
+    createInfo.sType = VK_STRUCTURE_TYPE_HEADLESS_SURFACE_CREATE_INFO_EXT;
+    return createHeadlessSurface(instance, &createInfo, NULL, surface);
+}
+
+#endif // GLFM_HAS_VULKAN
+
+/// Creates the Vulkan surface (and, for windowed displays, the window) if the app prefers Vulkan.
+/// Returns false if OpenGL ES should be used instead.
+static bool glfm__vulkanInit(GLFMDisplay *display) {
+#if GLFM_HAS_VULKAN
+    GLFMPlatformData *platformData = display->platformData;
+    if (display->vulkan) {
+        return true;
+    }
+    if (display->preferredAPI != GLFMRenderingAPIVulkan ||
+        platformData->eglContext != EGL_NO_CONTEXT) {
+        return false;
+    }
+    const char *surfaceExtension = VK_EXT_HEADLESS_SURFACE_EXTENSION_NAME;
+#if GLFM_HAS_X11
+    if (platformData->xDisplay) {
+        surfaceExtension = VK_KHR_XLIB_SURFACE_EXTENSION_NAME;
+    }
+#endif
+#if GLFM_HAS_WAYLAND
+    if (platformData->wlDisplay) {
+        surfaceExtension = VK_KHR_WAYLAND_SURFACE_EXTENSION_NAME;
+    }
+#endif
+    GLFMVulkan *vulkan = glfm__vulkanCreate(surfaceExtension, glfm__vulkanCreateSurface);
+    if (!vulkan) {
+        return false;
+    }
+    bool success = true;
+#if GLFM_HAS_WINDOW
+    if (glfm__isWindowed(platformData)) {
+        success = glfm__createWindow(display);
+    }
+#endif
+    success = success && glfm__vulkanSurfaceInit(display, vulkan);
+    if (!success) {
+        // Fall back to OpenGL ES, which creates its own window
+        glfm__vulkanDestroy(vulkan);
+#if GLFM_HAS_WINDOW
+        glfm__destroyWindow(display);
+#endif
+        return false;
+    }
+    display->vulkan = vulkan;
+    platformData->renderingAPI = GLFMRenderingAPIVulkan;
+    return true;
+#else
+    (void)display;
+    return false;
+#endif
+}
+
+/// Invokes the GLFMSurfaceDestroyedFunc, so that the app can release its Vulkan resources, and
+/// then destroys the device.
+static void glfm__vulkanDisplayDestroy(GLFMDisplay *display) {
+#if GLFM_HAS_VULKAN
+    GLFMPlatformData *platformData = display->platformData;
+    if (!display->vulkan) {
+        return;
+    }
+    if (platformData->surfaceCreatedNotified) {
+        platformData->surfaceCreatedNotified = false;
+        if (display->surfaceDestroyedFunc) {
+            display->surfaceDestroyedFunc(display);
+        }
+    }
+    glfm__vulkanDestroy(display->vulkan);
+    display->vulkan = NULL;
+#else
+    (void)display;
+#endif
+}
+
+// MARK: - Output
+
+/// Formats the path of a frame from a pattern with one integer conversion, like "frame%05d.png".
+/// Returns false if the pattern is invalid or the path doesn't fit.
+static bool glfm__formatFramePath(char *path, size_t size, const char *pattern, int64_t frameIndex) {
+    size_t length = 0;
+    int conversions = 0;
+    for (const char *p = pattern; *p; p++) {
+        if (*p == '%' && p[1] == '%') {
+            p++;
+        } else if (*p == '%') {
+            p++;
+            bool zeroPad = (*p == '0');
+            if (zeroPad) {
+                p++;
+            }
+            int width = 0;
+            while (*p >= '0' && *p <= '9') {
+                width = width * 10 + (*p - '0');
+                p++;
+            }
+            if (*p != 'd' || width > 20 || conversions++ > 0) {
+                return false;
+            }
+            char digits[24];
+            int numDigits = snprintf(digits, sizeof(digits), "%lld", (long long)frameIndex);
+            for (int i = numDigits; i < width; i++) {
+                if (length + 1 >= size) {
+                    return false;
+                }
+                path[length++] = zeroPad ? '0' : ' ';
+            }
+            for (int i = 0; i < numDigits; i++) {
+                if (length + 1 >= size) {
+                    return false;
+                }
+                path[length++] = digits[i];
+            }
+            continue;
+        }
+        if (length + 1 >= size) {
+            return false;
+        }
+        path[length++] = *p;
+    }
+    path[length] = '\0';
+    return conversions == 1;
+}
+
+#if GLFM_HAS_ZLIB
+
+static void glfm__writeBigEndian32(uint8_t *dst, uint32_t value) {
+    dst[0] = (uint8_t)(value >> 24);
+    dst[1] = (uint8_t)(value >> 16);
+    dst[2] = (uint8_t)(value >> 8);
+    dst[3] = (uint8_t)value;
+}
+
+#endif
+
+/// Encodes a frame. Called on the encoder thread. Frames are bottom-to-top, as read by
+/// glReadPixels().
+static bool glfm__outputEncodeFrame(GLFMOutput *output, const uint8_t *pixels, int64_t frameIndex) {
+    const int width = output->width;
+    const int height = output->height;
+    const size_t stride = (size_t)width * 4;
+    switch (output->format) {
+        case GLFMOutputFormatRGBA: {
+            for (int y = height - 1; y >= 0; y--) {
+                if (fwrite(pixels + (size_t)y * stride, 1, stride, output->file) != stride) {
+                    return false;
+                }
+            }
+            return true;
+        }
+        case GLFMOutputFormatY4M: {
+            // BT.601 limited range. Chroma is the average of each 2x2 block (C420jpeg siting).
+            const int chromaWidth = (width + 1) / 2;
+            const int chromaHeight = (height + 1) / 2;
+            uint8_t *yPlane = output->encodeBuffer;
+            uint8_t *uPlane = yPlane + (size_t)width * (size_t)height;
+            uint8_t *vPlane = uPlane + (size_t)chromaWidth * (size_t)chromaHeight;
+            for (int y = 0; y < height; y++) {
+                const uint8_t *src = pixels + (size_t)(height - 1 - y) * stride;
+                uint8_t *dst = yPlane + (size_t)y * (size_t)width;
+                for (int x = 0; x < width; x++, src += 4) {
+                    dst[x] = (uint8_t)(((66 * src[0] + 129 * src[1] + 25 * src[2] + 128) >> 8) + 16);
+                }
+            }
+            for (int cy = 0; cy < chromaHeight; cy++) {
+                const int y0 = height - 1 - cy * 2;
+                const int y1 = y0 > 0 ? y0 - 1 : y0;
+                for (int cx = 0; cx < chromaWidth; cx++) {
+                    const int x0 = cx * 2;
+                    const int x1 = x0 + 1 < width ? x0 + 1 : x0;
+                    const uint8_t *p00 = pixels + (size_t)y0 * stride + (size_t)x0 * 4;
+                    const uint8_t *p01 = pixels + (size_t)y0 * stride + (size_t)x1 * 4;
+                    const uint8_t *p10 = pixels + (size_t)y1 * stride + (size_t)x0 * 4;
+                    const uint8_t *p11 = pixels + (size_t)y1 * stride + (size_t)x1 * 4;
+                    const int r = (p00[0] + p01[0] + p10[0] + p11[0] + 2) >> 2;
+                    const int g = (p00[1] + p01[1] + p10[1] + p11[1] + 2) >> 2;
+                    const int b = (p00[2] + p01[2] + p10[2] + p11[2] + 2) >> 2;
+                    const size_t i = (size_t)cy * (size_t)chromaWidth + (size_t)cx;
+                    // The 128 offset is added before the shift, so the shifted value is never
+                    // negative
+                    uPlane[i] = (uint8_t)((-38 * r - 74 * g + 112 * b + 128 + (128 << 8)) >> 8);
+                    vPlane[i] = (uint8_t)((112 * r - 94 * g - 18 * b + 128 + (128 << 8)) >> 8);
+                }
+            }
+            const size_t size = (size_t)width * (size_t)height + 2 * (size_t)chromaWidth * (size_t)chromaHeight;
+            return (fputs("FRAME\n", output->file) >= 0 &&
+                    fwrite(output->encodeBuffer, 1, size, output->file) == size);
+        }
+        case GLFMOutputFormatPNG: {
+#if GLFM_HAS_ZLIB
+            char path[4096];
+            if (!glfm__formatFramePath(path, sizeof(path), output->path, frameIndex)) {
+                return false;
+            }
+
+            // Scanlines, top to bottom, each with the "Up" filter
+            uint8_t *filtered = output->encodeBuffer;
+            uint8_t *compressed = filtered + (stride + 1) * (size_t)height;
+            for (int y = 0; y < height; y++) {
+                const uint8_t *row = pixels + (size_t)(height - 1 - y) * stride;
+                const uint8_t *prevRow = y > 0 ? row + stride : NULL;
+                uint8_t *dst = filtered + (size_t)y * (stride + 1);
+                dst[0] = 2;
+                for (size_t i = 0; i < stride; i++) {
+                    dst[i + 1] = (uint8_t)(row[i] - (prevRow ? prevRow[i] : 0));
+                }
+            }
+            uLongf compressedSize = compressBound((uLong)((stride + 1) * (size_t)height));
+            if (compress2(compressed + 8, &compressedSize, filtered,
+                          (uLong)((stride + 1) * (size_t)height), Z_BEST_SPEED) != Z_OK) {
+                return false;
+            }
+
+            // Chunks are written in place: length, type, data, CRC
+            static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+            uint8_t header[8 + 13 + 4];
+            glfm__writeBigEndian32(header, 13);
+            memcpy(header + 4, "IHDR", 4);
+            glfm__writeBigEndian32(header + 8, (uint32_t)width);
+            glfm__writeBigEndian32(header + 12, (uint32_t)height);
+            header[16] = 8; // Bit depth
+            header[17] = 6; // RGBA
+            header[18] = 0; // Deflate
+            header[19] = 0; // Adaptive filtering
+            header[20] = 0; // No interlace
+            glfm__writeBigEndian32(header + 21, (uint32_t)crc32(0, header + 4, 4 + 13));
+            glfm__writeBigEndian32(compressed, (uint32_t)compressedSize);
+            memcpy(compressed + 4, "IDAT", 4);
+            glfm__writeBigEndian32(compressed + 8 + compressedSize,
+                                   (uint32_t)crc32(0, compressed + 4, (uInt)(4 + compressedSize)));
+            static const uint8_t footer[12] = { 0, 0, 0, 0, 'I', 'E', 'N', 'D', 0xae, 0x42, 0x60, 0x82 };
+
+            FILE *file = fopen(path, "wb");
+            if (!file) {
+                return false;
+            }
+            bool success = (fwrite(signature, 1, sizeof(signature), file) == sizeof(signature) &&
+                            fwrite(header, 1, sizeof(header), file) == sizeof(header) &&
+                            fwrite(compressed, 1, 12 + compressedSize, file) == 12 + compressedSize &&
+                            fwrite(footer, 1, sizeof(footer), file) == sizeof(footer));
+            return (fclose(file) == 0) && success;
+#else
+            (void)frameIndex;
+            return false;
+#endif
+        }
+        case GLFMOutputFormatNone:
+        default:
+            return true;
+    }
+}
+
+/// Gets the timing of a recent frame, or NULL if it is too old. Called with `mutex` locked.
+static GLFMOutputFrameTiming *glfm__outputGetFrameTiming(GLFMOutput *output, int64_t frameIndex) {
+    GLFMOutputFrameTiming *timing = &output->timings[frameIndex % GLFM_OUTPUT_TIMING_SLOTS];
+    return (frameIndex >= 0 && timing->frameIndex == frameIndex) ? timing : NULL;
+}
+
+static void *glfm__outputThread(void *param) {
+    GLFMOutput *output = param;
+    pthread_mutex_lock(&output->mutex);
+    while (true) {
+        while (output->queueCount == 0 && !output->stopRequested) {
+            pthread_cond_wait(&output->cond, &output->mutex);
+        }
+        if (output->queueCount == 0) {
+            break;
+        }
+        const int slot = output->queueHead;
+        const bool failed = output->failed;
+        pthread_mutex_unlock(&output->mutex);
+
+        // The slot is owned by this thread until the queue head moves past it
+        bool success = failed || glfm__outputEncodeFrame(output, output->queuePixels[slot],
+                                                         output->queueFrameIndex[slot]);
+
+        pthread_mutex_lock(&output->mutex);
+        if (!success) {
+            output->failed = true;
+        }
+        GLFMOutputFrameTiming *timing = glfm__outputGetFrameTiming(output, output->queueFrameIndex[slot]);
+        if (timing) {
+            timing->writeTime = glfmGetTime();
+        }
+        output->queueHead = (output->queueHead + 1) % output->queueDepth;
+        output->queueCount--;
+        pthread_cond_broadcast(&output->cond);
+    }
+    pthread_mutex_unlock(&output->mutex);
+    return NULL;
+}
+
+/// Gets a free slot in the encoder queue, blocking while the queue is full. Returns NULL if
+/// encoding failed.
+static uint8_t *glfm__outputAcquireSlot(GLFMOutput *output) {
+    pthread_mutex_lock(&output->mutex);
+    while (output->queueCount == output->queueDepth && !output->failed) {
+        pthread_cond_wait(&output->cond, &output->mutex);
+    }
+    uint8_t *pixels = NULL;
+    if (!output->failed) {
+        // The encoder only moves the queue head forward, so this slot stays free after unlocking
+        pixels = output->queuePixels[(output->queueHead + output->queueCount) % output->queueDepth];
+    }
+    pthread_mutex_unlock(&output->mutex);
+    return pixels;
+}
+
+static void glfm__outputCommitSlot(GLFMOutput *output, int64_t frameIndex) {
+    pthread_mutex_lock(&output->mutex);
+    GLFMOutputFrameTiming *timing = glfm__outputGetFrameTiming(output, frameIndex);
+    if (timing) {
+        timing->readTime = glfmGetTime();
+    }
+    output->queueFrameIndex[(output->queueHead + output->queueCount) % output->queueDepth] = frameIndex;
+    output->queueCount++;
+    pthread_cond_broadcast(&output->cond);
+    pthread_mutex_unlock(&output->mutex);
+}
+
+/// Maps a pixel buffer whose readback was issued earlier, and queues it for encoding.
+static void glfm__outputMapPixelBuffer(GLFMOutput *output, int index) {
+    const size_t size = (size_t)output->width * (size_t)output->height * 4;
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, output->pixelBuffers[index]);
+    const void *mapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, (GLsizeiptr)size, GL_MAP_READ_BIT);
+    if (mapped) {
+        uint8_t *pixels = glfm__outputAcquireSlot(output);
+        if (pixels) {
+            memcpy(pixels, mapped, size);
+            glfm__outputCommitSlot(output, output->pixelBufferFrameIndex[index]);
+        }
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    output->pixelBufferFrameIndex[index] = -1;
+}
+
+/// Reads back the current frame. Called from glfmSwapBuffers() with the context current.
+static void glfm__outputCaptureFrame(GLFMDisplay *display) {
+    GLFMPlatformData *platformData = display->platformData;
+    GLFMOutput *output = platformData->output;
+    GLint previousFramebuffer = 0;
+    GLint previousPackAlignment = 4;
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previousFramebuffer);
+    glGetIntegerv(GL_PACK_ALIGNMENT, &previousPackAlignment);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+
+    pthread_mutex_lock(&output->mutex);
+    GLFMOutputFrameTiming *timing = &output->timings[output->frameIndex % GLFM_OUTPUT_TIMING_SLOTS];
+    timing->frameIndex = output->frameIndex;
+    timing->readTime = 0.0;
+    timing->writeTime = 0.0;
+    pthread_mutex_unlock(&output->mutex);
+
+    if (platformData->renderingAPI >= GLFMRenderingAPIOpenGLES3) {
+        // Asynchronous: read into a pixel buffer now, and map it a few frames later
+        const size_t size = (size_t)output->width * (size_t)output->height * 4;
+        GLint previousPackBuffer = 0;
+        glGetIntegerv(GL_PIXEL_PACK_BUFFER_BINDING, &previousPackBuffer);
+        if (!output->pixelBuffersCreated) {
+            output->pixelBuffersCreated = true;
+            glGenBuffers(GLFM_OUTPUT_READBACK_SLOTS, output->pixelBuffers);
+            for (int i = 0; i < GLFM_OUTPUT_READBACK_SLOTS; i++) {
+                glBindBuffer(GL_PIXEL_PACK_BUFFER, output->pixelBuffers[i]);
+                glBufferData(GL_PIXEL_PACK_BUFFER, (GLsizeiptr)size, NULL, GL_STREAM_READ);
+            }
+        }
+        const int index = (int)(output->frameIndex % GLFM_OUTPUT_READBACK_SLOTS);
+        if (output->pixelBufferFrameIndex[index] >= 0) {
+            glfm__outputMapPixelBuffer(output, index);
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, output->pixelBuffers[index]);
+        glReadPixels(0, 0, output->width, output->height, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+        output->pixelBufferFrameIndex[index] = output->frameIndex;
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, (GLuint)previousPackBuffer);
+    } else {
+        // Synchronous: read directly into the encoder queue
+        uint8_t *pixels = glfm__outputAcquireSlot(output);
+        if (pixels) {
+            glReadPixels(0, 0, output->width, output->height, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+            glfm__outputCommitSlot(output, output->frameIndex);
+        }
+    }
+    output->frameIndex++;
+
+    glPixelStorei(GL_PACK_ALIGNMENT, previousPackAlignment);
+    glBindFramebuffer(GL_FRAMEBUFFER, (GLuint)previousFramebuffer);
+}
+
+/// Queues all pending readbacks, and waits until every queued frame is written. Called with the
+/// context current.
+static void glfm__outputFlush(GLFMDisplay *display) {
+    GLFMPlatformData *platformData = display->platformData;
+    GLFMOutput *output = platformData->output;
+    if (!output) {
+        return;
+    }
+    if (output->pixelBuffersCreated) {
+        GLint previousPackBuffer = 0;
+        glGetIntegerv(GL_PIXEL_PACK_BUFFER_BINDING, &previousPackBuffer);
+        // Oldest first
+        for (int64_t frameIndex = output->frameIndex - GLFM_OUTPUT_READBACK_SLOTS;
+             frameIndex < output->frameIndex; frameIndex++) {
+            if (frameIndex >= 0) {
+                const int index = (int)(frameIndex % GLFM_OUTPUT_READBACK_SLOTS);
+                if (output->pixelBufferFrameIndex[index] == frameIndex) {
+                    glfm__outputMapPixelBuffer(output, index);
+                }
+            }
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, (GLuint)previousPackBuffer);
+    }
+    pthread_mutex_lock(&output->mutex);
+    while (output->queueCount > 0) {
+        pthread_cond_wait(&output->cond, &output->mutex);
+    }
+    const bool failed = output->failed;
+    pthread_mutex_unlock(&output->mutex);
+    if (output->file) {
+        fflush(output->file);
+    }
+    if (failed && !output->errorReported) {
+        output->errorReported = true;
+        glfm__reportSurfaceError(display, "Couldn't write output frames");
+    }
+}
+
+/// Gets the read and write times of a frame. A GLFMFrameTimestampsFunc. The platform frame ID is
+/// the output frame index plus one.
+static void glfm__outputGetFrameTimestamps(GLFMDisplay *display, uint64_t platformFrameId,
+                                           GLFMPresentFeedback *feedback) {
+    GLFMPlatformData *platformData = display->platformData;
+    GLFMOutput *output = platformData->output;
+    feedback->pending = false;
+    if (!output || platformFrameId == 0) {
+        return;
+    }
+    pthread_mutex_lock(&output->mutex);
+    const GLFMOutputFrameTiming *timing = glfm__outputGetFrameTiming(output,
+                                                                     (int64_t)platformFrameId - 1);
+    if (timing) {
+        if (timing->readTime > 0.0) {
+            // Reading the frame back waits for the GPU, so it's an upper bound
+            feedback->gpuCompleteTime = timing->readTime;
+            feedback->latchTime = timing->readTime;
+            feedback->measured = true;
+        }
+        if (timing->writeTime > 0.0) {
+            feedback->presentTime = timing->writeTime;
+        } else {
+            feedback->pending = true;
+        }
+    }
+    pthread_mutex_unlock(&output->mutex);
+}
+
+/// Closes the file and frees the output. The encoder thread must not be running.
+static void glfm__outputFree(GLFMOutput *output) {
+    if (output->file && output->file != stdout) {
+        fclose(output->file);
+    } else if (output->file) {
+        fflush(output->file);
+    }
+    if (output->queuePixels) {
+        for (int i = 0; i < output->queueDepth; i++) {
+            free(output->queuePixels[i]);
+        }
+    }
+    free(output->queuePixels);
+    free(output->queueFrameIndex);
+    free(output->encodeBuffer);
+    free(output->path);
+    free(output);
+}
+
+static void glfm__outputDestroy(GLFMDisplay *display) {
+    GLFMPlatformData *platformData = display->platformData;
+    GLFMOutput *output = platformData->output;
+    if (!output) {
+        return;
+    }
+
+    // Pixel buffers belong to the context, which may not be current between runs
+    bool releaseContext = false;
+    if (platformData->eglContext != EGL_NO_CONTEXT && eglGetCurrentContext() != platformData->eglContext) {
+        releaseContext = glfm__eglMakeCurrent(display);
+    }
+    if (platformData->eglContext != EGL_NO_CONTEXT && eglGetCurrentContext() == platformData->eglContext) {
+        glfm__outputFlush(display);
+        if (output->pixelBuffersCreated) {
+            glDeleteBuffers(GLFM_OUTPUT_READBACK_SLOTS, output->pixelBuffers);
+        }
+    }
+    if (releaseContext) {
+        eglMakeCurrent(platformData->eglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    }
+
+    // The encoder thread writes any remaining frames before exiting
+    pthread_mutex_lock(&output->mutex);
+    output->stopRequested = true;
+    pthread_cond_broadcast(&output->cond);
+    pthread_mutex_unlock(&output->mutex);
+    pthread_join(output->thread, NULL);
+    pthread_cond_destroy(&output->cond);
+    pthread_mutex_destroy(&output->mutex);
+
+    glfm__outputFree(output);
+    platformData->output = NULL;
+}
+
+static bool glfm__outputInit(GLFMDisplay *display, const GLFMOutputConfig *config) {
+    GLFMPlatformData *platformData = display->platformData;
+    if (!config->path || (config->format != GLFMOutputFormatPNG &&
+                          config->format != GLFMOutputFormatY4M &&
+                          config->format != GLFMOutputFormatRGBA)) {
+        return false;
+    }
+#if !GLFM_HAS_ZLIB
+    if (config->format == GLFMOutputFormatPNG) {
+        GLFM_LOG("PNG output requires zlib");
+        return false;
+    }
+#endif
+
+    GLFMOutput *output = calloc(1, sizeof(GLFMOutput));
+    if (!output) {
+        return false;
+    }
+    const size_t pathLength = strlen(config->path);
+    output->format = config->format;
+    output->width = platformData->width;
+    output->height = platformData->height;
+    output->frameRate = config->frameRate;
+    output->queueDepth = config->queueDepth > 0 ? config->queueDepth : GLFM_OUTPUT_DEFAULT_QUEUE_DEPTH;
+    output->path = malloc(pathLength + 1);
+    output->queuePixels = calloc((size_t)output->queueDepth, sizeof(uint8_t *));
+    output->queueFrameIndex = calloc((size_t)output->queueDepth, sizeof(int64_t));
+    for (int i = 0; i < GLFM_OUTPUT_READBACK_SLOTS; i++) {
+        output->pixelBufferFrameIndex[i] = -1;
+    }
+    for (int i = 0; i < GLFM_OUTPUT_TIMING_SLOTS; i++) {
+        output->timings[i].frameIndex = -1;
+    }
+
+    const size_t stride = (size_t)output->width * 4;
+    const size_t frameSize = stride * (size_t)output->height;
+    size_t encodeBufferSize = 0;
+    if (output->format == GLFMOutputFormatY4M) {
+        const size_t chromaSize = (size_t)((output->width + 1) / 2) * (size_t)((output->height + 1) / 2);
+        encodeBufferSize = (size_t)output->width * (size_t)output->height + 2 * chromaSize;
+    }
+#if GLFM_HAS_ZLIB
+    if (output->format == GLFMOutputFormatPNG) {
+        const size_t filteredSize = (stride + 1) * (size_t)output->height;
+        encodeBufferSize = filteredSize + 12 + compressBound((uLong)filteredSize);
+    }
+#endif
+    if (encodeBufferSize > 0) {
+        output->encodeBuffer = malloc(encodeBufferSize);
+    }
+    bool success = (output->path && output->queuePixels && output->queueFrameIndex &&
+                    (encodeBufferSize == 0 || output->encodeBuffer));
+    for (int i = 0; success && i < output->queueDepth; i++) {
+        output->queuePixels[i] = malloc(frameSize);
+        success = output->queuePixels[i] != NULL;
+    }
+    if (success) {
+        memcpy(output->path, config->path, pathLength + 1);
+        if (output->format == GLFMOutputFormatPNG) {
+            char path[4096];
+            success = glfm__formatFramePath(path, sizeof(path), output->path, 0);
+            if (!success) {
+                GLFM_LOG("Invalid PNG output path: %s", output->path);
+            }
+        } else if (strcmp(output->path, "-") == 0) {
+            output->file = stdout;
+        } else {
+            output->file = fopen(output->path, "wb");
+            success = output->file != NULL;
+        }
+    }
+    if (success && output->format == GLFMOutputFormatY4M) {
+        // Frame rate as a fraction, in thousandths of a frame
+        long numerator = output->frameRate > 0 ? lround(output->frameRate * 1000.0) : 60000;
+        long denominator = 1000;
+        long a = numerator;
+        long b = denominator;
+        while (b != 0) {
+            long t = a % b;
+            a = b;
+            b = t;
+        }
+        numerator /= a;
+        denominator /= a;
+        success = fprintf(output->file, "YUV4MPEG2 W%d H%d F%ld:%ld Ip A1:1 C420jpeg\n",
+                          output->width, output->height, numerator, denominator) > 0;
+    }
+    if (success) {
+        pthread_mutex_init(&output->mutex, NULL);
+        pthread_cond_init(&output->cond, NULL);
+        success = pthread_create(&output->thread, NULL, glfm__outputThread, output) == 0;
+        if (!success) {
+            pthread_cond_destroy(&output->cond);
+            pthread_mutex_destroy(&output->mutex);
+        }
+    }
+    if (!success) {
+        glfm__outputFree(output);
+        return false;
+    }
+    platformData->output = output;
+    return true;
+}
+
+bool glfmSetOutputConfig(GLFMDisplay *display, const GLFMOutputConfig *config) {
+    if (!display) {
+        return false;
+    }
+    GLFMPlatformData *platformData = display->platformData;
+    glfm__outputDestroy(display);
+    platformData->fixedFrameRate = 0.0;
+    platformData->fixedFrameIndex = 0;
+    if (!config || config->format == GLFMOutputFormatNone) {
+        return true;
+    }
+    if (!glfm__outputInit(display, config)) {
+        return false;
+    }
+    platformData->fixedFrameRate = config->frameRate > 0 ? config->frameRate : 0.0;
+    return true;
+}
+
+// MARK: - Input server
+
+static void glfm__setNonBlocking(int fd) {
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+}
+
+static void glfm__inputServerCloseClient(GLFMInputServer *server) {
+    if (server->clientSocket >= 0) {
+        close(server->clientSocket);
+        server->clientSocket = -1;
+    }
+    server->receiveLength = 0;
+    server->pendingAckCount = 0;
+    server->sendLength = 0;
+}
+
+static void glfm__inputServerDestroy(GLFMDisplay *display) {
+    GLFMPlatformData *platformData = display->platformData;
+    GLFMInputServer *server = platformData->inputServer;
+    if (!server) {
+        return;
+    }
+    glfm__inputServerCloseClient(server);
+    if (server->listenSocket >= 0) {
+        close(server->listenSocket);
+        unlink(server->path);
+    }
+    free(server->pendingAcks);
+    free(server->sendBuffer);
+    free(server->path);
+    free(server);
+    platformData->inputServer = NULL;
+}
+
+#if GLFM_FEATURE_SENSORS
+
+static void glfm__sendSensorEvent(GLFMDisplay *display, GLFMSensorEvent event) {
+    if (display->sensorFuncs[event.sensor]) {
+        if (display->sensorRemappingEnabled) {
+            glfm__remapSensorEvent(&event, glfmGetInterfaceOrientation(display));
+        }
+        glfm__dispatchSensorEvent(display, event);
+    }
+}
+
+/// Dispatches an injected sensor event. Injected vectors are in the device's natural orientation
+/// and in the same format as ``GLFMSensorEvent``. There is no rotation sensor, so
+/// `GLFMSensorRotationMatrix` is computed from the injected samples, like on Android devices
+/// without one.
+static void glfm__inputServerDispatchSensor(GLFMDisplay *display, GLFMSensor sensor,
+                                            double timestamp, double x, double y, double z) {
+    GLFMPlatformData *platformData = display->platformData;
+    GLFMSensorEvent event;
+    memset(&event, 0, sizeof(event));
+    event.sensor = sensor;
+    event.timestamp = timestamp;
+    event.vector.x = x;
+    event.vector.y = y;
+    event.vector.z = z;
+    glfm__sendSensorEvent(display, event);
+
+    if (!display->sensorFuncs[GLFMSensorRotationMatrix]) {
+        return;
+    }
+    GLFMSensorFusion *fusion = &platformData->sensorFusion;
+    bool fusionUpdated = false;
+    if (sensor == GLFMSensorAccelerometer) {
+        // Convert from iOS format
+        glfm__sensorFusionAddAccelerometer(fusion, (float)-x, (float)-y, (float)-z);
+        if (!platformData->gyroscopeInjected) {
+            fusionUpdated = glfm__sensorFusionAddGyroscope(fusion, timestamp, 0.0f, 0.0f, 0.0f);
+        }
+    } else if (sensor == GLFMSensorMagnetometer) {
+        glfm__sensorFusionAddMagnetometer(fusion, (float)x, (float)y, (float)z);
+    } else if (sensor == GLFMSensorGyroscope) {
+        platformData->gyroscopeInjected = true;
+        fusionUpdated = glfm__sensorFusionAddGyroscope(fusion, timestamp, (float)x, (float)y, (float)z);
+    }
+    if (fusionUpdated) {
+        glfm__sensorFusionGetEvent(fusion, &event);
+        glfm__sendSensorEvent(display, event);
+    }
+}
+
+#endif // GLFM_FEATURE_SENSORS
+
+/// Dispatches an injected event to the same callbacks as real input.
+static void glfm__inputServerDispatch(GLFMDisplay *display, const GLFMInjectedEvent *event,
+                                      double timestamp) {
+    GLFMPlatformData *platformData = display->platformData;
+    switch (event->type) {
+        case GLFMInjectedEventTypeTouch:
+            if (event->code < 0 || event->action < GLFMTouchPhaseHover ||
+                event->action > GLFMTouchPhaseCancelled) {
+                break;
+            }
+            if (glfm__isTouchInputNeeded(display) &&
+                (platformData->multitouchEnabled || event->code == 0)) {
+                glfm__dispatchTouchEvent(display, timestamp, event->code,
+                                         (GLFMTouchPhase)event->action, event->values[0],
+                                         event->values[1]);
+            }
+            break;
+#if GLFM_FEATURE_KEYBOARD
+        case GLFMInjectedEventTypeKey:
+            if (glfm__isKeyInputNeeded(display) &&
+                event->action >= GLFMKeyActionPressed && event->action <= GLFMKeyActionReleased) {
+                glfm__dispatchKeyEvent(display, timestamp, (GLFMKeyCode)event->code,
+                                       (GLFMKeyAction)event->action, event->modifiers);
+            }
+            break;
+        case GLFMInjectedEventTypeChar: {
+            char text[sizeof(event->text) + 1];
+            memcpy(text, event->text, sizeof(event->text));
+            text[sizeof(event->text)] = '\0';
+            if (glfm__isCharInputNeeded(display) && text[0] != '\0') {
+                glfm__dispatchCharEvent(display, timestamp, text);
+            }
+            break;
+        }
+#endif
+        case GLFMInjectedEventTypeMouseWheel:
+            if (glfm__isMouseWheelInputNeeded(display) &&
+                event->code >= GLFMMouseWheelDeltaPixel && event->code <= GLFMMouseWheelDeltaPage) {
+                glfm__dispatchMouseWheelEvent(display, timestamp, event->values[0], event->values[1],
+                                              (GLFMMouseWheelDeltaType)event->code,
+                                              event->values[2], event->values[3], 0.0);
+            }
+            break;
+#if GLFM_FEATURE_SENSORS
+        case GLFMInjectedEventTypeSensor:
+            if (event->code >= 0 && event->code < GLFM_NUM_SENSORS &&
+                event->code != GLFMSensorRotationMatrix) {
+                glfm__inputServerDispatchSensor(display, (GLFMSensor)event->code, timestamp,
+                                                event->values[0], event->values[1], event->values[2]);
+            }
+            break;
+#endif
+        case GLFMInjectedEventTypeRelativeMouse:
+            if (display->pointerLocked) {
+                glfm__addRelativeMouseMotion(display, event->values[0], event->values[1]);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+static void glfm__inputServerAddAck(GLFMInputServer *server, uint64_t id, double receiveTime,
+                                    double eventTime, double frameTime) {
+    if (server->pendingAckCount == server->pendingAckCapacity) {
+        int capacity = server->pendingAckCapacity > 0 ? server->pendingAckCapacity * 2 : 64;
+        GLFMInjectedEventAck *acks = realloc(server->pendingAcks,
+                                             (size_t)capacity * sizeof(GLFMInjectedEventAck));
+        if (!acks) {
+            return;
+        }
+        server->pendingAcks = acks;
+        server->pendingAckCapacity = capacity;
+    }
+    GLFMInjectedEventAck *ack = &server->pendingAcks[server->pendingAckCount++];
+    ack->id = id;
+    ack->receiveTime = receiveTime;
+    ack->eventTime = eventTime;
+    ack->frameTime = frameTime;
+    ack->presentTime = 0.0;
+}
+
+/// Accepts a client, and reads and dispatches all pending events. Called at the start of each
+/// frame, on the thread that runs the display.
+static void glfm__inputServerPoll(GLFMDisplay *display) {
+    GLFMPlatformData *platformData = display->platformData;
+    GLFMInputServer *server = platformData->inputServer;
+    if (!server) {
+        return;
+    }
+    if (server->clientSocket < 0) {
+        server->clientSocket = accept(server->listenSocket, NULL, NULL);
+        if (server->clientSocket < 0) {
+            return;
+        }
+        glfm__setNonBlocking(server->clientSocket);
+    }
+    while (true) {
+        ssize_t length = recv(server->clientSocket, server->receiveBuffer + server->receiveLength,
+                              sizeof(server->receiveBuffer) - server->receiveLength, 0);
+        if (length == 0 || (length < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+            // Disconnected
+            glfm__inputServerCloseClient(server);
+            return;
+        }
+        if (length < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        server->receiveLength += (size_t)length;
+        const double receiveTime = glfmGetTime();
+        const size_t count = server->receiveLength / sizeof(GLFMInjectedEvent);
+        for (size_t i = 0; i < count; i++) {
+            GLFMInjectedEvent event;
+            memcpy(&event, server->receiveBuffer + i * sizeof(GLFMInjectedEvent), sizeof(event));
+            // Events without a timestamp occurred no later than they were received
+            const double eventTime = event.timestamp > 0.0 ? event.timestamp : receiveTime;
+            glfm__inputServerDispatch(display, &event, eventTime);
+            if (event.id != 0) {
+                glfm__inputServerAddAck(server, event.id, receiveTime, eventTime, display->frameTime);
+            }
+            if (platformData->inputServer != server || server->clientSocket < 0) {
+                // Stopped from a callback
+                return;
+            }
+        }
+        // Keep a partial record for the next read
+        const size_t consumed = count * sizeof(GLFMInjectedEvent);
+        memmove(server->receiveBuffer, server->receiveBuffer + consumed,
+                server->receiveLength - consumed);
+        server->receiveLength -= consumed;
+    }
+}
+
+/// Sends acknowledgements for the events consumed by the frame that was just presented.
+static void glfm__inputServerPresent(GLFMDisplay *display, double presentTime) {
+    GLFMPlatformData *platformData = display->platformData;
+    GLFMInputServer *server = platformData->inputServer;
+    if (!server || server->clientSocket < 0) {
+        return;
+    }
+    if (server->pendingAckCount > 0) {
+        const size_t size = (size_t)server->pendingAckCount * sizeof(GLFMInjectedEventAck);
+        if (server->sendLength + size > GLFM_INPUT_SERVER_MAX_SEND_SIZE) {
+            // The client isn't reading acknowledgements
+            GLFM_LOG("Input server client disconnected: too many unread acknowledgements");
+            glfm__inputServerCloseClient(server);
+            return;
+        }
+        if (server->sendLength + size > server->sendCapacity) {
+            size_t capacity = server->sendCapacity > 0 ? server->sendCapacity : 4096;
+            while (capacity < server->sendLength + size) {
+                capacity *= 2;
+            }
+            uint8_t *sendBuffer = realloc(server->sendBuffer, capacity);
+            if (!sendBuffer) {
+                return;
+            }
+            server->sendBuffer = sendBuffer;
+            server->sendCapacity = capacity;
+        }
+        for (int i = 0; i < server->pendingAckCount; i++) {
+            server->pendingAcks[i].presentTime = presentTime;
+        }
+        memcpy(server->sendBuffer + server->sendLength, server->pendingAcks, size);
+        server->sendLength += size;
+        server->pendingAckCount = 0;
+    }
+    while (server->sendLength > 0) {
+        ssize_t length = send(server->clientSocket, server->sendBuffer, server->sendLength,
+                              MSG_NOSIGNAL);
+        if (length < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                glfm__inputServerCloseClient(server);
+            }
+            break;
+        }
+        memmove(server->sendBuffer, server->sendBuffer + length, server->sendLength - (size_t)length);
+        server->sendLength -= (size_t)length;
+    }
+}
+
+/// Returns true if nothing is listening on the socket at the address, so it's safe to replace.
+/// Otherwise, errno is set if the check failed, or 0 if a server accepted the connection.
+static bool glfm__isStaleSocket(const struct sockaddr_un *address) {
+    int probe = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (probe < 0) {
+        return false;
+    }
+    // Non-blocking, so that a server with a full backlog doesn't block
+    glfm__setNonBlocking(probe);
+    const int result = connect(probe, (const struct sockaddr *)address, sizeof(*address));
+    const int connectError = errno;
+    close(probe);
+    if (result == 0 || connectError == EAGAIN) {
+        errno = 0;
+        return false;
+    }
+    errno = connectError;
+    return connectError == ECONNREFUSED;
+}
+
+bool glfmSetInputServerPath(GLFMDisplay *display, const char *path) {
+    if (!display) {
+        return false;
+    }
+    GLFMPlatformData *platformData = display->platformData;
+    glfm__inputServerDestroy(display);
+    if (!path) {
+        return true;
+    }
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    const size_t pathLength = strlen(path);
+    if (pathLength == 0 || pathLength >= sizeof(address.sun_path)) {
+        GLFM_LOG("Invalid input server path: %s", path);
+        return false;
+    }
+    memcpy(address.sun_path, path, pathLength + 1);
+
+    GLFMInputServer *server = calloc(1, sizeof(GLFMInputServer));
+    if (!server) {
+        return false;
+    }
+    server->clientSocket = -1;
+    server->path = malloc(pathLength + 1);
+    server->listenSocket = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (server->listenSocket >= 0) {
+        glfm__setNonBlocking(server->listenSocket);
+    }
+    if (!server->path || server->listenSocket < 0) {
+        if (server->listenSocket >= 0) {
+            close(server->listenSocket);
+        }
+        free(server->path);
+        free(server);
+        return false;
+    }
+    memcpy(server->path, path, pathLength + 1);
+
+    // Replace a stale socket, but never another kind of file, or the socket of a running server
+    struct stat fileStat;
+    if (stat(path, &fileStat) == 0 && S_ISSOCK(fileStat.st_mode)) {
+        if (!glfm__isStaleSocket(&address)) {
+            GLFM_LOG("Couldn't start input server at %s: %s", path,
+                     errno ? strerror(errno) : "Another server is running");
+            close(server->listenSocket);
+            free(server->path);
+            free(server);
+            return false;
+        }
+        unlink(path);
+    }
+    if (bind(server->listenSocket, (const struct sockaddr *)&address, sizeof(address)) != 0 ||
+        listen(server->listenSocket, 1) != 0) {
+        GLFM_LOG("Couldn't start input server at %s: %s", path, strerror(errno));
+        close(server->listenSocket);
+        free(server->path);
+        free(server);
+        return false;
+    }
+    platformData->inputServer = server;
+    return true;
+}
+
+// MARK: - Windows
+
+#if GLFM_HAS_WINDOW
+
+/// Converts the window system time of an event, in milliseconds, to the glfmGetTime() timebase.
+///
+/// The window system clock is not necessarily the same clock, so the offset is estimated as the
+/// smallest difference seen between the time an event is handled and its time. The estimate
+/// restarts if the time wraps around (every 49.7 days) or jumps.
+static double glfm__getEventTime(GLFMPlatformData *platformData, uint32_t time) {
+    const double now = glfmGetTime();
+    const double offset = now - (double)time / 1000.0;
+    if (!platformData->eventTimeOffsetValid || offset < platformData->eventTimeOffset ||
+        offset > platformData->eventTimeOffset + 60.0) {
+        platformData->eventTimeOffset = offset;
+        platformData->eventTimeOffsetValid = true;
+    }
+    return (double)time / 1000.0 + platformData->eventTimeOffset;
+}
+
+/// Gets the GLFM touch number of a window system touch, starting the touch if it isn't active.
+/// Returns -1 if too many touches are active.
+static int glfm__getTouchIdentifier(GLFMPlatformData *platformData, int touchId) {
+    int firstNullIndex = -1;
+    int index = -1;
+    for (int i = 0; i < GLFM_MAX_ACTIVE_TOUCHES; i++) {
+        if (platformData->activeTouches[i].touchId == touchId &&
+            platformData->activeTouches[i].active) {
+            index = i;
+            break;
+        }
+        if (firstNullIndex == -1 && !platformData->activeTouches[i].active) {
+            firstNullIndex = i;
+        }
+    }
+    if (index == -1) {
+        if (firstNullIndex == -1) {
+            // Shouldn't happen
+            return -1;
+        }
+        index = firstNullIndex;
+        platformData->activeTouches[index].touchId = touchId;
+        platformData->activeTouches[index].active = true;
+    }
+    return index;
+}
+
+#endif // GLFM_HAS_WINDOW
+
+// MARK: - X11
+
+#if GLFM_HAS_X11
+
+static bool glfm__x11CreateWindow(GLFMDisplay *display) {
+    GLFMPlatformData *platformData = display->platformData;
+    Display *xDisplay = platformData->xDisplay;
+    Window root = DefaultRootWindow(xDisplay);
+
+    // The window's visual must match the EGL config. Vulkan windows use the default visual.
+    EGLint visualId = 0;
+    if (platformData->eglDisplay != EGL_NO_DISPLAY) {
+        eglGetConfigAttrib(platformData->eglDisplay, platformData->eglConfig, EGL_NATIVE_VISUAL_ID,
+                           &visualId);
+    }
+    XVisualInfo visualTemplate;
+    memset(&visualTemplate, 0, sizeof(visualTemplate));
+    visualTemplate.visualid = (VisualID)visualId;
+    int numVisuals = 0;
+    XVisualInfo *visualInfo = XGetVisualInfo(xDisplay, VisualIDMask, &visualTemplate, &numVisuals);
+    Visual *visual = visualInfo ? visualInfo->visual : DefaultVisual(xDisplay, DefaultScreen(xDisplay));
+    int depth = visualInfo ? visualInfo->depth : DefaultDepth(xDisplay, DefaultScreen(xDisplay));
+
+    platformData->xColormap = XCreateColormap(xDisplay, root, visual, AllocNone);
+    XSetWindowAttributes attributes;
+    memset(&attributes, 0, sizeof(attributes));
+    attributes.colormap = platformData->xColormap;
+    attributes.event_mask = (ButtonPressMask | ButtonReleaseMask | PointerMotionMask |
+                             StructureNotifyMask | FocusChangeMask | ExposureMask);
+#if GLFM_FEATURE_KEYBOARD
+    attributes.event_mask |= KeyPressMask | KeyReleaseMask;
+#endif
+    platformData->xWindow = XCreateWindow(xDisplay, root, 0, 0,
+                                          (unsigned int)platformData->width,
+                                          (unsigned int)platformData->height, 0, depth,
+                                          InputOutput, visual,
+                                          CWColormap | CWBorderPixel | CWEventMask, &attributes);
+    if (visualInfo) {
+        XFree(visualInfo);
+    }
+    if (!platformData->xWindow) {
+        return false;
+    }
+
+    platformData->wmDeleteWindow = XInternAtom(xDisplay, "WM_DELETE_WINDOW", False);
+    XSetWMProtocols(xDisplay, platformData->xWindow, &platformData->wmDeleteWindow, 1);
+
+#if GLFM_FEATURE_KEYBOARD
+    // Input method, for UTF-8 character events
+    platformData->xInputMethod = XOpenIM(xDisplay, NULL, NULL, NULL);
+    if (platformData->xInputMethod) {
+        platformData->xInputContext = XCreateIC(platformData->xInputMethod,
+                                                XNInputStyle, XIMPreeditNothing | XIMStatusNothing,
+                                                XNClientWindow, platformData->xWindow,
+                                                XNFocusWindow, platformData->xWindow,
+                                                NULL);
+    }
+
+    // Send repeated key presses without the synthetic key releases in between
+    XkbSetDetectableAutoRepeat(xDisplay, True, NULL);
+#endif
+
+#if GLFM_HAS_XINPUT2
+    // Touch events require XInput 2.2. When selected, touches aren't emulated as pointer events.
+    int firstEvent = 0;
+    int firstError = 0;
+    if (XQueryExtension(xDisplay, "XInputExtension", &platformData->xInputOpcode,
+                        &firstEvent, &firstError)) {
+        int majorVersion = 2;
+        int minorVersion = 2;
+        if (XIQueryVersion(xDisplay, &majorVersion, &minorVersion) == Success) {
+            // Raw motion, for pointer lock, requires XInput 2.0
+            platformData->rawMotionAvailable = (majorVersion >= 2);
+        }
+        if (platformData->rawMotionAvailable &&
+            (majorVersion > 2 || (majorVersion == 2 && minorVersion >= 2))) {
+            unsigned char mask[XIMaskLen(XI_LASTEVENT)];
+            memset(mask, 0, sizeof(mask));
+            XISetMask(mask, XI_TouchBegin);
+            XISetMask(mask, XI_TouchUpdate);
+            XISetMask(mask, XI_TouchEnd);
+            XIEventMask eventMask;
+            eventMask.deviceid = XIAllMasterDevices;
+            eventMask.mask_len = sizeof(mask);
+            eventMask.mask = mask;
+            platformData->touchAvailable = (XISelectEvents(xDisplay, platformData->xWindow,
+                                                           &eventMask, 1) == Success);
+        }
+    }
+#endif
+
+    XMapWindow(xDisplay, platformData->xWindow);
+    return true;
+}
+
+static void glfm__x11DestroyWindow(GLFMDisplay *display) {
+    GLFMPlatformData *platformData = display->platformData;
+    Display *xDisplay = platformData->xDisplay;
+    if (!xDisplay) {
+        return;
+    }
+    if (platformData->xInputContext) {
+        XDestroyIC(platformData->xInputContext);
+        platformData->xInputContext = NULL;
+    }
+    if (platformData->xInputMethod) {
+        XCloseIM(platformData->xInputMethod);
+        platformData->xInputMethod = NULL;
+    }
+    if (platformData->xCursor) {
+        XFreeCursor(xDisplay, platformData->xCursor);
+        platformData->xCursor = None;
+    }
+    if (platformData->xHiddenCursor) {
+        XFreeCursor(xDisplay, platformData->xHiddenCursor);
+        platformData->xHiddenCursor = None;
+    }
+    // Destroying the window releases the pointer grab
+    display->pointerLocked = false;
+    if (platformData->xWindow) {
+        XDestroyWindow(xDisplay, platformData->xWindow);
+        platformData->xWindow = None;
+    }
+    if (platformData->xColormap) {
+        XFreeColormap(xDisplay, platformData->xColormap);
+        platformData->xColormap = None;
+    }
+}
+
+#if GLFM_FEATURE_KEYBOARD
+
+static GLFMKeyCode glfm__x11GetKeyCode(KeySym keySym) {
+    if (keySym >= XK_a && keySym <= XK_z) {
+        return (GLFMKeyCode)(GLFMKeyCodeA + (int)(keySym - XK_a));
+    }
+    if (keySym >= XK_0 && keySym <= XK_9) {
+        return (GLFMKeyCode)(GLFMKeyCode0 + (int)(keySym - XK_0));
+    }
+    if (keySym >= XK_F1 && keySym <= XK_F9) {
+        return (GLFMKeyCode)(GLFMKeyCodeF1 + (int)(keySym - XK_F1));
+    }
+    if (keySym >= XK_F10 && keySym <= XK_F24) {
+        return (GLFMKeyCode)(GLFMKeyCodeF10 + (int)(keySym - XK_F10));
+    }
+    if (keySym >= XK_KP_0 && keySym <= XK_KP_9) {
+        return (GLFMKeyCode)(GLFMKeyCodeNumpad0 + (int)(keySym - XK_KP_0));
+    }
+    switch (keySym) {
+        case XK_BackSpace: return GLFMKeyCodeBackspace;
+        case XK_Tab: return GLFMKeyCodeTab;
+        case XK_ISO_Left_Tab: return GLFMKeyCodeTab;
+        case XK_Return: return GLFMKeyCodeEnter;
+        case XK_Escape: return GLFMKeyCodeEscape;
+        case XK_space: return GLFMKeyCodeSpace;
+        case XK_apostrophe: return GLFMKeyCodeQuote;
+        case XK_comma: return GLFMKeyCodeComma;
+        case XK_minus: return GLFMKeyCodeMinus;
+        case XK_period: return GLFMKeyCodePeriod;
+        case XK_slash: return GLFMKeyCodeSlash;
+        case XK_semicolon: return GLFMKeyCodeSemicolon;
+        case XK_equal: return GLFMKeyCodeEqual;
+        case XK_bracketleft: return GLFMKeyCodeBracketLeft;
+        case XK_backslash: return GLFMKeyCodeBackslash;
+        case XK_bracketright: return GLFMKeyCodeBracketRight;
+        case XK_grave: return GLFMKeyCodeBackquote;
+        case XK_Delete: return GLFMKeyCodeDelete;
+
+        case XK_Caps_Lock: return GLFMKeyCodeCapsLock;
+        case XK_Shift_L: return GLFMKeyCodeShiftLeft;
+        case XK_Shift_R: return GLFMKeyCodeShiftRight;
+        case XK_Control_L: return GLFMKeyCodeControlLeft;
+        case XK_Control_R: return GLFMKeyCodeControlRight;
+        case XK_Alt_L: return GLFMKeyCodeAltLeft;
+        case XK_Alt_R: return GLFMKeyCodeAltRight;
+        case XK_ISO_Level3_Shift: return GLFMKeyCodeAltRight;
+        case XK_Super_L: return GLFMKeyCodeMetaLeft;
+        case XK_Super_R: return GLFMKeyCodeMetaRight;
+        case XK_Meta_L: return GLFMKeyCodeMetaLeft;
+        case XK_Meta_R: return GLFMKeyCodeMetaRight;
+        case XK_Menu: return GLFMKeyCodeMenu;
+
+        case XK_Insert: return GLFMKeyCodeInsert;
+        case XK_Page_Up: return GLFMKeyCodePageUp;
+        case XK_Page_Down: return GLFMKeyCodePageDown;
+        case XK_End: return GLFMKeyCodeEnd;
+        case XK_Home: return GLFMKeyCodeHome;
+        case XK_Left: return GLFMKeyCodeArrowLeft;
+        case XK_Up: return GLFMKeyCodeArrowUp;
+        case XK_Right: return GLFMKeyCodeArrowRight;
+        case XK_Down: return GLFMKeyCodeArrowDown;
+
+        case XK_Print: return GLFMKeyCodePrintScreen;
+        case XK_Scroll_Lock: return GLFMKeyCodeScrollLock;
+        case XK_Pause: return GLFMKeyCodePause;
+
+        // The unshifted keysyms of the numpad are its navigation keys
+        case XK_Num_Lock: return GLFMKeyCodeNumLock;
+        case XK_KP_Decimal: return GLFMKeyCodeNumpadDecimal;
+        case XK_KP_Delete: return GLFMKeyCodeNumpadDecimal;
+        case XK_KP_Multiply: return GLFMKeyCodeNumpadMultiply;
+        case XK_KP_Add: return GLFMKeyCodeNumpadAdd;
+        case XK_KP_Divide: return GLFMKeyCodeNumpadDivide;
+        case XK_KP_Enter: return GLFMKeyCodeNumpadEnter;
+        case XK_KP_Subtract: return GLFMKeyCodeNumpadSubtract;
+        case XK_KP_Equal: return GLFMKeyCodeNumpadEqual;
+        case XK_KP_Insert: return GLFMKeyCodeNumpad0;
+        case XK_KP_End: return GLFMKeyCodeNumpad1;
+        case XK_KP_Down: return GLFMKeyCodeNumpad2;
+        case XK_KP_Page_Down: return GLFMKeyCodeNumpad3;
+        case XK_KP_Left: return GLFMKeyCodeNumpad4;
+        case XK_KP_Begin: return GLFMKeyCodeNumpad5;
+        case XK_KP_Right: return GLFMKeyCodeNumpad6;
+        case XK_KP_Home: return GLFMKeyCodeNumpad7;
+        case XK_KP_Up: return GLFMKeyCodeNumpad8;
+        case XK_KP_Page_Up: return GLFMKeyCodeNumpad9;
+
+        default: return GLFMKeyCodeUnknown;
+    }
+}
+
+static int glfm__x11GetModifiers(unsigned int state) {
+    int modifiers = 0;
+    if (state & ShiftMask) {
+        modifiers |= GLFMKeyModifierShift;
+    }
+    if (state & ControlMask) {
+        modifiers |= GLFMKeyModifierControl;
+    }
+    if (state & Mod1Mask) {
+        modifiers |= GLFMKeyModifierAlt;
+    }
+    if (state & Mod4Mask) {
+        modifiers |= GLFMKeyModifierMeta;
+    }
+    return modifiers;
+}
+
+static void glfm__x11HandleKeyEvent(GLFMDisplay *display, XKeyEvent *event) {
+    GLFMPlatformData *platformData = display->platformData;
+    const bool pressed = (event->type == KeyPress);
+    const unsigned int keycode = event->keycode & 0xff;
+    GLFMKeyAction action;
+    if (pressed) {
+        action = platformData->keysDown[keycode] ? GLFMKeyActionRepeated : GLFMKeyActionPressed;
+    } else {
+        action = GLFMKeyActionReleased;
+    }
+    platformData->keysDown[keycode] = pressed;
+
+    const double timestamp = glfm__getEventTime(platformData, (uint32_t)event->time);
+    if (glfm__isKeyInputNeeded(display)) {
+        GLFMKeyCode keyCode = glfm__x11GetKeyCode(XLookupKeysym(event, 0));
+        glfm__dispatchKeyEvent(display, timestamp, keyCode, action,
+                               glfm__x11GetModifiers(event->state));
+    }
+    if (pressed && glfm__isCharInputNeeded(display) &&
+        platformData->xInputContext) {
+        char utf8[64];
+        KeySym keySym = NoSymbol;
+        Status status = 0;
+        int length = Xutf8LookupString(platformData->xInputContext, event, utf8,
+                                       (int)sizeof(utf8) - 1, &keySym, &status);
+        if ((status == XLookupChars || status == XLookupBoth) && length > 0) {
+            utf8[length] = '\0';
+            // Ignore control characters
+            if ((unsigned char)utf8[0] >= 0x20 && utf8[0] != 0x7f) {
+                glfm__dispatchCharEvent(display, timestamp, utf8);
+            }
+        }
+    }
+}
+
+#endif // GLFM_FEATURE_KEYBOARD
+
+/// Creates a cursor with an empty 1x1 bitmap.
+static Cursor glfm__x11CreateHiddenCursor(Display *xDisplay, Window xWindow) {
+    static const char emptyBits[1] = { 0 };
+    Pixmap pixmap = XCreateBitmapFromData(xDisplay, xWindow, emptyBits, 1, 1);
+    XColor black;
+    memset(&black, 0, sizeof(black));
+    Cursor cursor = XCreatePixmapCursor(xDisplay, pixmap, pixmap, &black, &black, 0, 0);
+    XFreePixmap(xDisplay, pixmap);
+    return cursor;
+}
+
+#if GLFM_HAS_XINPUT2
+
+/// Selects raw motion events, which are unaccelerated and sent at the device's rate. Raw events
+/// are only delivered to the root window.
+static void glfm__x11SelectRawMotion(GLFMPlatformData *platformData, bool selected) {
+    unsigned char mask[XIMaskLen(XI_RawMotion)];
+    memset(mask, 0, sizeof(mask));
+    if (selected) {
+        XISetMask(mask, XI_RawMotion);
+    }
+    XIEventMask eventMask;
+    eventMask.deviceid = XIAllMasterDevices;
+    eventMask.mask_len = sizeof(mask);
+    eventMask.mask = mask;
+    XISelectEvents(platformData->xDisplay, DefaultRootWindow(platformData->xDisplay), &eventMask, 1);
+}
+
+static void glfm__x11HandleRawMotionEvent(GLFMDisplay *display, const XIRawEvent *event) {
+    if (!display->pointerLocked) {
+        return;
+    }
+    // Values are packed in the order of the valuators that are set. Valuators 0 and 1 are x and y.
+    double delta[2] = { 0.0, 0.0 };
+    const double *value = event->raw_values;
+    for (int i = 0; i < 2 && i < event->valuators.mask_len * 8; i++) {
+        if (XIMaskIsSet(event->valuators.mask, i)) {
+            delta[i] = *value++;
+        }
+    }
+    glfm__addRelativeMouseMotion(display, delta[0], delta[1]);
+}
+
+#endif
+
+/// Grabs or releases the pointer to match the pointer lock request. The pointer is only locked
+/// while the window is visible and focused.
+static void glfm__x11UpdatePointerLock(GLFMDisplay *display) {
+    GLFMPlatformData *platformData = display->platformData;
+    Display *xDisplay = platformData->xDisplay;
+    if (!platformData->xWindow) {
+        // Updated when the window is mapped
+        return;
+    }
+    const bool locked = (display->pointerLockRequested && platformData->windowVisible &&
+                         platformData->focused);
+    if (locked == display->pointerLocked) {
+        return;
+    }
+    if (locked) {
+        if (!platformData->xHiddenCursor) {
+            platformData->xHiddenCursor = glfm__x11CreateHiddenCursor(xDisplay,
+                                                                      platformData->xWindow);
+        }
+        const unsigned int eventMask = ButtonPressMask | ButtonReleaseMask | PointerMotionMask;
+        if (XGrabPointer(xDisplay, platformData->xWindow, True, eventMask, GrabModeAsync,
+                         GrabModeAsync, platformData->xWindow, platformData->xHiddenCursor,
+                         CurrentTime) != GrabSuccess) {
+            // Another client has a grab. Retried on the next click or focus change.
+            return;
+        }
+        platformData->pointerLockX = platformData->width / 2;
+        platformData->pointerLockY = platformData->height / 2;
+        XWarpPointer(xDisplay, None, platformData->xWindow, 0, 0, 0, 0,
+                     platformData->pointerLockX, platformData->pointerLockY);
+    } else {
+        XUngrabPointer(xDisplay, CurrentTime);
+    }
+#if GLFM_HAS_XINPUT2
+    if (platformData->rawMotionAvailable) {
+        glfm__x11SelectRawMotion(platformData, locked);
+    }
+#endif
+    display->pointerLocked = locked;
+    XFlush(xDisplay);
+}
+
+/// Gets the GLFM touch number for an X11 mouse button, or -1 if the button isn't a mouse button.
+static int glfm__x11GetMouseButtonTouch(unsigned int button) {
+    switch (button) {
+        case Button1: return 0;
+        case Button3: return 1;
+        case Button2: return 2;
+        case 8: return 3; // Back
+        case 9: return 4; // Forward
+        default: return -1;
+    }
+}
+
+static void glfm__x11HandleButtonEvent(GLFMDisplay *display, XButtonEvent *event) {
+    GLFMPlatformData *platformData = display->platformData;
+    const bool pressed = (event->type == ButtonPress);
+
+    // Buttons 4 to 7 are the scroll wheel: up, down, left, right
+    if (event->button >= Button4 && event->button <= 7) {
+        if (pressed && glfm__isMouseWheelInputNeeded(display)) {
+            double deltaX = 0.0;
+            double deltaY = 0.0;
+            switch (event->button) {
+                case Button4: deltaY = -1.0; break;
+                case Button5: deltaY = 1.0; break;
+                case 6: deltaX = -1.0; break;
+                case 7: default: deltaX = 1.0; break;
+            }
+            const double timestamp = glfm__getEventTime(platformData, (uint32_t)event->time);
+            glfm__dispatchMouseWheelEvent(display, timestamp, event->x, event->y,
+                                          GLFMMouseWheelDeltaLine, deltaX, deltaY, 0.0);
+        }
+        return;
+    }
+
+    int touch = glfm__x11GetMouseButtonTouch(event->button);
+    if (touch < 0) {
+        return;
+    }
+    if (pressed) {
+        platformData->mouseButtonsDown |= (1u << touch);
+    } else if (platformData->mouseButtonsDown & (1u << touch)) {
+        platformData->mouseButtonsDown &= ~(1u << touch);
+    } else {
+        // Release without a press, like after a window manager grab
+        return;
+    }
+    if (pressed && display->pointerLockRequested && !display->pointerLocked) {
+        // Retry a lock that couldn't be granted, like the browser's click to lock
+        glfm__x11UpdatePointerLock(display);
+    }
+    if (!glfm__isTouchInputNeeded(display)) {
+        return;
+    }
+    const GLFMTouchPhase phase = pressed ? GLFMTouchPhaseBegan : GLFMTouchPhaseEnded;
+    const double timestamp = glfm__getEventTime(platformData, (uint32_t)event->time);
+    if (display->pointerLocked) {
+        glfm__dispatchTouchEvent(display, timestamp, touch, phase, platformData->pointerLockX,
+                                 platformData->pointerLockY);
+    } else {
+        glfm__dispatchTouchEvent(display, timestamp, touch, phase, event->x, event->y);
+    }
+}
+
+static void glfm__x11HandleMotionEvent(GLFMDisplay *display, XMotionEvent *event) {
+    GLFMPlatformData *platformData = display->platformData;
+    if (display->pointerLocked) {
+#if GLFM_HAS_XINPUT2
+        if (platformData->rawMotionAvailable) {
+            // Motion is read from raw events
+            return;
+        }
+#endif
+        // Measure the motion from the lock location, and move the pointer back to it
+        const int deltaX = event->x - platformData->pointerLockX;
+        const int deltaY = event->y - platformData->pointerLockY;
+        if (deltaX != 0 || deltaY != 0) {
+            glfm__addRelativeMouseMotion(display, deltaX, deltaY);
+            XWarpPointer(platformData->xDisplay, None, platformData->xWindow, 0, 0, 0, 0,
+                         platformData->pointerLockX, platformData->pointerLockY);
+        }
+        return;
+    }
+    if (!glfm__isTouchInputNeeded(display)) {
+        return;
+    }
+    const double timestamp = glfm__getEventTime(platformData, (uint32_t)event->time);
+    if (platformData->mouseButtonsDown == 0) {
+        glfm__dispatchTouchEvent(display, timestamp, 0, GLFMTouchPhaseHover, event->x, event->y);
+        return;
+    }
+    for (int touch = 0; touch < 5; touch++) {
+        if (platformData->mouseButtonsDown & (1u << touch)) {
+            glfm__dispatchTouchEvent(display, timestamp, touch, GLFMTouchPhaseMoved, event->x,
+                                     event->y);
+        }
+    }
+}
+
+#if GLFM_HAS_XINPUT2
+
+static void glfm__x11HandleTouchEvent(GLFMDisplay *display, const XIDeviceEvent *event) {
+    GLFMPlatformData *platformData = display->platformData;
+    GLFMTouchPhase touchPhase;
+    switch (event->evtype) {
+        case XI_TouchBegin:
+            touchPhase = GLFMTouchPhaseBegan;
+            break;
+        case XI_TouchUpdate:
+            touchPhase = GLFMTouchPhaseMoved;
+            break;
+        case XI_TouchEnd:
+        default:
+            touchPhase = GLFMTouchPhaseEnded;
+            break;
+    }
+    int identifier = glfm__getTouchIdentifier(platformData, event->detail);
+    if (identifier < 0) {
+        return;
+    }
+    if (glfm__isTouchInputNeeded(display) && (platformData->multitouchEnabled || identifier == 0)) {
+        glfm__dispatchTouchEvent(display, glfm__getEventTime(platformData, (uint32_t)event->time),
+                                 identifier, touchPhase, event->event_x, event->event_y);
+    }
+    if (touchPhase == GLFMTouchPhaseEnded) {
+        platformData->activeTouches[identifier].active = false;
+    }
+}
+
+#endif
+
+static void glfm__x11HandleEvent(GLFMDisplay *display, XEvent *event) {
+    GLFMPlatformData *platformData = display->platformData;
+    if (XFilterEvent(event, None)) {
+        // Consumed by the input method
+        return;
+    }
+    switch (event->type) {
+#if GLFM_FEATURE_KEYBOARD
+        case KeyPress:
+        case KeyRelease:
+            glfm__x11HandleKeyEvent(display, &event->xkey);
+            break;
+#endif
+
+        case ButtonPress:
+        case ButtonRelease:
+            glfm__x11HandleButtonEvent(display, &event->xbutton);
+            break;
+
+        case MotionNotify:
+            glfm__x11HandleMotionEvent(display, &event->xmotion);
+            break;
+
+        case ConfigureNotify:
+            if (event->xconfigure.width != platformData->width ||
+                event->xconfigure.height != platformData->height) {
+                platformData->width = event->xconfigure.width;
+                platformData->height = event->xconfigure.height;
+                platformData->refreshRequested = true;
+                if (display->surfaceResizedFunc) {
+                    display->surfaceResizedFunc(display, platformData->width, platformData->height);
+                }
+            }
+            break;
+
+        case MapNotify:
+            platformData->windowVisible = true;
+            platformData->refreshRequested = true;
+            glfm__x11UpdatePointerLock(display);
+            break;
+
+        case UnmapNotify:
+            platformData->windowVisible = false;
+            glfm__x11UpdatePointerLock(display);
+            break;
+
+        case Expose:
+            platformData->refreshRequested = true;
+            break;
+
+        case FocusIn:
+        case FocusOut: {
+            if (event->xfocus.mode == NotifyGrab || event->xfocus.mode == NotifyUngrab) {
+                // Keyboard grabs, like a window manager's alt-tab, don't change focus
+                break;
+            }
+            const bool focused = (event->type == FocusIn);
+            if (platformData->xInputContext) {
+                if (focused) {
+                    XSetICFocus(platformData->xInputContext);
+                } else {
+                    XUnsetICFocus(platformData->xInputContext);
+                }
+            }
+            if (!focused) {
+                // Key releases aren't sent while the window is unfocused
+                memset(platformData->keysDown, 0, sizeof(platformData->keysDown));
+            }
+            if (platformData->focused != focused) {
+                platformData->focused = focused;
+                glfm__x11UpdatePointerLock(display);
+                glfm__setSuspended(display, !focused);
+                if (display->focusFunc) {
+                    display->focusFunc(display, focused);
+                }
+            }
+            break;
+        }
+
+        case ClientMessage:
+            if ((Atom)event->xclient.data.l[0] == platformData->wmDeleteWindow) {
+                platformData->windowClosed = true;
+            }
+            break;
+
+#if GLFM_HAS_XINPUT2
+        case GenericEvent: {
+            XGenericEventCookie *cookie = &event->xcookie;
+            if (cookie->extension == platformData->xInputOpcode &&
+                XGetEventData(platformData->xDisplay, cookie)) {
+                if (cookie->evtype == XI_TouchBegin || cookie->evtype == XI_TouchUpdate ||
+                    cookie->evtype == XI_TouchEnd) {
+                    glfm__x11HandleTouchEvent(display, cookie->data);
+                } else if (cookie->evtype == XI_RawMotion) {
+                    glfm__x11HandleRawMotionEvent(display, cookie->data);
+                }
+                XFreeEventData(platformData->xDisplay, cookie);
+            }
+            break;
+        }
+#endif
+
+        default:
+            break;
+    }
+}
+
+#endif // GLFM_HAS_X11
+
+// MARK: - Wayland
+
+#if GLFM_HAS_WAYLAND
+
+// The highest versions of the globals that GLFM handles. Seat version 5 adds pointer frames.
+#define GLFM_WL_COMPOSITOR_VERSION 4
+#define GLFM_WL_SEAT_VERSION 5
+// xdg-shell version 6 adds the suspended state, for hidden windows. With earlier versions, a hidden
+// window is still drawn, and eglSwapBuffers() waits until it is shown.
+#ifdef XDG_TOPLEVEL_STATE_SUSPENDED_SINCE_VERSION
+#  define GLFM_XDG_WM_BASE_VERSION 6
+#else
+#  define GLFM_XDG_WM_BASE_VERSION 1
+#endif
+#define GLFM_WL_DEFAULT_CURSOR_SIZE 24
+
+static void glfm__waylandUpdatePointerLock(GLFMDisplay *display);
+
+static uint32_t glfm__waylandMinVersion(uint32_t version, uint32_t maxVersion) {
+    return version < maxVersion ? version : maxVersion;
+}
+
+// MARK: Pointer
+
+/// Sets the cursor image for the pointer, which is hidden while the pointer is locked. Without a
+/// cursor theme, the cursor is left unchanged.
+static void glfm__waylandUpdateCursor(GLFMDisplay *display) {
+    GLFMPlatformData *platformData = display->platformData;
+    if (!platformData->wlPointer) {
+        return;
+    }
+    const char *name = NULL;
+    if (!display->pointerLocked) {
+        switch (platformData->wlMouseCursor) {
+            case GLFMMouseCursorAuto:
+            case GLFMMouseCursorDefault:
+            default:
+                name = "left_ptr";
+                break;
+            case GLFMMouseCursorPointer:
+                name = "hand2";
+                break;
+            case GLFMMouseCursorCrosshair:
+                name = "crosshair";
+                break;
+            case GLFMMouseCursorText:
+            case GLFMMouseCursorVerticalText:
+                name = "xterm";
+                break;
+            case GLFMMouseCursorNone:
+                break;
+        }
+    }
+    if (!name) {
+        wl_pointer_set_cursor(platformData->wlPointer, platformData->wlPointerEnterSerial, NULL,
+                              0, 0);
+        return;
+    }
+    if (!platformData->wlCursorTheme && platformData->wlShm) {
+        const char *sizeString = getenv("XCURSOR_SIZE");
+        int size = sizeString ? atoi(sizeString) : 0;
+        platformData->wlCursorTheme = wl_cursor_theme_load(getenv("XCURSOR_THEME"),
+                                                           size > 0 ? size : GLFM_WL_DEFAULT_CURSOR_SIZE,
+                                                           platformData->wlShm);
+    }
+    struct wl_cursor *cursor = NULL;
+    if (platformData->wlCursorTheme) {
+        cursor = wl_cursor_theme_get_cursor(platformData->wlCursorTheme, name);
+    }
+    if (!cursor || cursor->image_count == 0) {
+        return;
+    }
+    struct wl_cursor_image *image = cursor->images[0];
+    struct wl_buffer *buffer = wl_cursor_image_get_buffer(image);
+    if (!buffer) {
+        return;
+    }
+    if (!platformData->wlCursorSurface) {
+        platformData->wlCursorSurface = wl_compositor_create_surface(platformData->wlCompositor);
+    }
+    wl_pointer_set_cursor(platformData->wlPointer, platformData->wlPointerEnterSerial,
+                          platformData->wlCursorSurface, (int32_t)image->hotspot_x,
+                          (int32_t)image->hotspot_y);
+    wl_surface_attach(platformData->wlCursorSurface, buffer, 0, 0);
+    wl_surface_damage(platformData->wlCursorSurface, 0, 0, (int32_t)image->width,
+                      (int32_t)image->height);
+    wl_surface_commit(platformData->wlCursorSurface);
+}
+
+static void glfm__waylandRelativeMotion(void *data, struct zwp_relative_pointer_v1 *relativePointer,
+                                        uint32_t timeHigh, uint32_t timeLow,
+                                        wl_fixed_t deltaX, wl_fixed_t deltaY,
+                                        wl_fixed_t unacceleratedDeltaX,
+                                        wl_fixed_t unacceleratedDeltaY) {
+    (void)relativePointer;
+    (void)timeHigh;
+    (void)timeLow;
+    (void)deltaX;
+    (void)deltaY;
+    GLFMDisplay *display = data;
+    if (display->pointerLocked) {
+        // Unaccelerated, like raw motion on X11
+        glfm__addRelativeMouseMotion(display, wl_fixed_to_double(unacceleratedDeltaX),
+                                     wl_fixed_to_double(unacceleratedDeltaY));
+    }
+}
+
+static const struct zwp_relative_pointer_v1_listener glfm__waylandRelativePointerListener = {
+    .relative_motion = glfm__waylandRelativeMotion,
+};
+
+static void glfm__waylandUnlockPointer(GLFMDisplay *display) {
+    GLFMPlatformData *platformData = display->platformData;
+    if (platformData->wlRelativePointer) {
+        zwp_relative_pointer_v1_destroy(platformData->wlRelativePointer);
+        platformData->wlRelativePointer = NULL;
+    }
+    if (platformData->wlLockedPointer) {
+        zwp_locked_pointer_v1_destroy(platformData->wlLockedPointer);
+        platformData->wlLockedPointer = NULL;
+    }
+    display->pointerLocked = false;
+}
+
+/// Locks or unlocks the pointer to match the pointer lock request. The pointer is only locked while
+/// the window is visible and focused, and only if the compositor supports the pointer constraints
+/// and relative pointer protocols.
+static void glfm__waylandUpdatePointerLock(GLFMDisplay *display) {
+    GLFMPlatformData *platformData = display->platformData;
+    if (!platformData->wlConfigured) {
+        // Updated when the window is configured
+        return;
+    }
+    const bool locked = (display->pointerLockRequested && platformData->windowVisible &&
+                         platformData->focused && platformData->wlPointer &&
+                         platformData->wlPointerConstraints &&
+                         platformData->wlRelativePointerManager);
+    if (locked == display->pointerLocked) {
+        return;
+    }
+    if (locked) {
+        // The compositor activates the lock while the pointer is in the window
+        platformData->wlLockedPointer =
+            zwp_pointer_constraints_v1_lock_pointer(platformData->wlPointerConstraints,
+                                                    platformData->wlSurface, platformData->wlPointer,
+                                                    NULL,
+                                                    ZWP_POINTER_CONSTRAINTS_V1_LIFETIME_PERSISTENT);
+        platformData->wlRelativePointer =
+            zwp_relative_pointer_manager_v1_get_relative_pointer(platformData->wlRelativePointerManager,
+                                                                 platformData->wlPointer);
+        zwp_relative_pointer_v1_add_listener(platformData->wlRelativePointer,
+                                             &glfm__waylandRelativePointerListener, display);
+        display->pointerLocked = true;
+    } else {
+        glfm__waylandUnlockPointer(display);
+    }
+    glfm__waylandUpdateCursor(display);
+}
+
+/// Gets the GLFM touch number for a Linux mouse button, or -1 if the button isn't a mouse button.
+static int glfm__waylandGetMouseButtonTouch(uint32_t button) {
+    switch (button) {
+        case BTN_LEFT: return 0;
+        case BTN_RIGHT: return 1;
+        case BTN_MIDDLE: return 2;
+        case BTN_SIDE: return 3; // Back
+        case BTN_EXTRA: return 4; // Forward
+        default: return -1;
+    }
+}
+
+static void glfm__waylandPointerEnter(void *data, struct wl_pointer *pointer, uint32_t serial,
+                                      struct wl_surface *surface, wl_fixed_t x, wl_fixed_t y) {
+    (void)pointer;
+    (void)surface;
+    GLFMDisplay *display = data;
+    GLFMPlatformData *platformData = display->platformData;
+    platformData->wlPointerEnterSerial = serial;
+    platformData->wlPointerX = wl_fixed_to_double(x);
+    platformData->wlPointerY = wl_fixed_to_double(y);
+    glfm__waylandUpdateCursor(display);
+}
+
+static void glfm__waylandPointerLeave(void *data, struct wl_pointer *pointer, uint32_t serial,
+                                      struct wl_surface *surface) {
+    (void)pointer;
+    (void)serial;
+    (void)surface;
+    GLFMDisplay *display = data;
+    GLFMPlatformData *platformData = display->platformData;
+    // The pointer left while buttons were pressed, like when the compositor starts moving the
+    // window. The buttons are released to the compositor, so the touches are cancelled.
+    if (platformData->mouseButtonsDown != 0 && glfm__isTouchInputNeeded(display)) {
+        const double timestamp = glfmGetTime();
+        for (int touch = 0; touch < 5; touch++) {
+            if (platformData->mouseButtonsDown & (1u << touch)) {
+                glfm__dispatchTouchEvent(display, timestamp, touch, GLFMTouchPhaseCancelled,
+                                         platformData->wlPointerX, platformData->wlPointerY);
+            }
+        }
+    }
+    platformData->mouseButtonsDown = 0;
+}
+
+static void glfm__waylandPointerMotion(void *data, struct wl_pointer *pointer, uint32_t time,
+                                       wl_fixed_t x, wl_fixed_t y) {
+    (void)pointer;
+    GLFMDisplay *display = data;
+    GLFMPlatformData *platformData = display->platformData;
+    platformData->wlPointerX = wl_fixed_to_double(x);
+    platformData->wlPointerY = wl_fixed_to_double(y);
+    if (display->pointerLocked || !glfm__isTouchInputNeeded(display)) {
+        // While locked, motion is read from relative pointer events
+        return;
+    }
+    const double timestamp = glfm__getEventTime(platformData, time);
+    if (platformData->mouseButtonsDown == 0) {
+        glfm__dispatchTouchEvent(display, timestamp, 0, GLFMTouchPhaseHover,
+                                 platformData->wlPointerX, platformData->wlPointerY);
+        return;
+    }
+    for (int touch = 0; touch < 5; touch++) {
+        if (platformData->mouseButtonsDown & (1u << touch)) {
+            glfm__dispatchTouchEvent(display, timestamp, touch, GLFMTouchPhaseMoved,
+                                     platformData->wlPointerX, platformData->wlPointerY);
+        }
+    }
+}
+
+static void glfm__waylandPointerButton(void *data, struct wl_pointer *pointer, uint32_t serial,
+                                       uint32_t time, uint32_t button, uint32_t state) {
+    (void)pointer;
+    (void)serial;
+    GLFMDisplay *display = data;
+    GLFMPlatformData *platformData = display->platformData;
+    const bool pressed = (state == WL_POINTER_BUTTON_STATE_PRESSED);
+    int touch = glfm__waylandGetMouseButtonTouch(button);
+    if (touch < 0) {
+        return;
+    }
+    if (pressed) {
+        platformData->mouseButtonsDown |= (1u << touch);
+    } else if (platformData->mouseButtonsDown & (1u << touch)) {
+        platformData->mouseButtonsDown &= ~(1u << touch);
+    } else {
+        // Release without a press, like after the pointer entered with the button pressed
+        return;
+    }
+    if (pressed && display->pointerLockRequested && !display->pointerLocked) {
+        // Retry a lock that couldn't be granted, like the browser's click to lock
+        glfm__waylandUpdatePointerLock(display);
+    }
+    if (glfm__isTouchInputNeeded(display)) {
+        // The pointer doesn't move while it is locked
+        glfm__dispatchTouchEvent(display, glfm__getEventTime(platformData, time), touch,
+                                 pressed ? GLFMTouchPhaseBegan : GLFMTouchPhaseEnded,
+                                 platformData->wlPointerX, platformData->wlPointerY);
+    }
+}
+
+static void glfm__waylandPointerAxis(void *data, struct wl_pointer *pointer, uint32_t time,
+                                     uint32_t axis, wl_fixed_t value) {
+    (void)pointer;
+    GLFMDisplay *display = data;
+    GLFMPlatformData *platformData = display->platformData;
+    if (!glfm__isMouseWheelInputNeeded(display)) {
+        return;
+    }
+    // The value is in surface coordinates, like motion
+    const double delta = wl_fixed_to_double(value);
+    const bool horizontal = (axis == WL_POINTER_AXIS_HORIZONTAL_SCROLL);
+    glfm__dispatchMouseWheelEvent(display, glfm__getEventTime(platformData, time),
+                                  platformData->wlPointerX, platformData->wlPointerY,
+                                  GLFMMouseWheelDeltaPixel, horizontal ? delta : 0.0,
+                                  horizontal ? 0.0 : delta, 0.0);
+}
+
+static void glfm__waylandPointerFrame(void *data, struct wl_pointer *pointer) {
+    (void)data;
+    (void)pointer;
+}
+
+static void glfm__waylandPointerAxisSource(void *data, struct wl_pointer *pointer,
+                                           uint32_t axisSource) {
+    (void)data;
+    (void)pointer;
+    (void)axisSource;
+}
+
+static void glfm__waylandPointerAxisStop(void *data, struct wl_pointer *pointer, uint32_t time,
+                                         uint32_t axis) {
+    (void)data;
+    (void)pointer;
+    (void)time;
+    (void)axis;
+}
+
+static void glfm__waylandPointerAxisDiscrete(void *data, struct wl_pointer *pointer, uint32_t axis,
+                                             int32_t discrete) {
+    (void)data;
+    (void)pointer;
+    (void)axis;
+    (void)discrete;
+}
+
+static const struct wl_pointer_listener glfm__waylandPointerListener = {
+    .enter = glfm__waylandPointerEnter,
+    .leave = glfm__waylandPointerLeave,
+    .motion = glfm__waylandPointerMotion,
+    .button = glfm__waylandPointerButton,
+    .axis = glfm__waylandPointerAxis,
+    .frame = glfm__waylandPointerFrame,
+    .axis_source = glfm__waylandPointerAxisSource,
+    .axis_stop = glfm__waylandPointerAxisStop,
+    .axis_discrete = glfm__waylandPointerAxisDiscrete,
+};
+
+// MARK: Keyboard
+
+#if GLFM_FEATURE_KEYBOARD
+
+/// Gets the key code of a Linux input event code. Key codes are physical keys, regardless of the
+/// keyboard layout.
+static GLFMKeyCode glfm__waylandGetKeyCode(uint32_t key) {
+    switch (key) {
+        case KEY_A: return GLFMKeyCodeA;
+        case KEY_B: return GLFMKeyCodeB;
+        case KEY_C: return GLFMKeyCodeC;
+        case KEY_D: return GLFMKeyCodeD;
+        case KEY_E: return GLFMKeyCodeE;
+        case KEY_F: return GLFMKeyCodeF;
+        case KEY_G: return GLFMKeyCodeG;
+        case KEY_H: return GLFMKeyCodeH;
+        case KEY_I: return GLFMKeyCodeI;
+        case KEY_J: return GLFMKeyCodeJ;
+        case KEY_K: return GLFMKeyCodeK;
+        case KEY_L: return GLFMKeyCodeL;
+        case KEY_M: return GLFMKeyCodeM;
+        case KEY_N: return GLFMKeyCodeN;
+        case KEY_O: return GLFMKeyCodeO;
+        case KEY_P: return GLFMKeyCodeP;
+        case KEY_Q: return GLFMKeyCodeQ;
+        case KEY_R: return GLFMKeyCodeR;
+        case KEY_S: return GLFMKeyCodeS;
+        case KEY_T: return GLFMKeyCodeT;
+        case KEY_U: return GLFMKeyCodeU;
+        case KEY_V: return GLFMKeyCodeV;
+        case KEY_W: return GLFMKeyCodeW;
+        case KEY_X: return GLFMKeyCodeX;
+        case KEY_Y: return GLFMKeyCodeY;
+        case KEY_Z: return GLFMKeyCodeZ;
+
+        case KEY_0: return GLFMKeyCode0;
+        case KEY_1: return GLFMKeyCode1;
+        case KEY_2: return GLFMKeyCode2;
+        case KEY_3: return GLFMKeyCode3;
+        case KEY_4: return GLFMKeyCode4;
+        case KEY_5: return GLFMKeyCode5;
+        case KEY_6: return GLFMKeyCode6;
+        case KEY_7: return GLFMKeyCode7;
+        case KEY_8: return GLFMKeyCode8;
+        case KEY_9: return GLFMKeyCode9;
+
+        case KEY_F1: return GLFMKeyCodeF1;
+        case KEY_F2: return GLFMKeyCodeF2;
+        case KEY_F3: return GLFMKeyCodeF3;
+        case KEY_F4: return GLFMKeyCodeF4;
+        case KEY_F5: return GLFMKeyCodeF5;
+        case KEY_F6: return GLFMKeyCodeF6;
+        case KEY_F7: return GLFMKeyCodeF7;
+        case KEY_F8: return GLFMKeyCodeF8;
+        case KEY_F9: return GLFMKeyCodeF9;
+        case KEY_F10: return GLFMKeyCodeF10;
+        case KEY_F11: return GLFMKeyCodeF11;
+        case KEY_F12: return GLFMKeyCodeF12;
+        case KEY_F13: return GLFMKeyCodeF13;
+        case KEY_F14: return GLFMKeyCodeF14;
+        case KEY_F15: return GLFMKeyCodeF15;
+        case KEY_F16: return GLFMKeyCodeF16;
+        case KEY_F17: return GLFMKeyCodeF17;
+        case KEY_F18: return GLFMKeyCodeF18;
+        case KEY_F19: return GLFMKeyCodeF19;
+        case KEY_F20: return GLFMKeyCodeF20;
+        case KEY_F21: return GLFMKeyCodeF21;
+        case KEY_F22: return GLFMKeyCodeF22;
+        case KEY_F23: return GLFMKeyCodeF23;
+        case KEY_F24: return GLFMKeyCodeF24;
+
+        case KEY_BACKSPACE: return GLFMKeyCodeBackspace;
+        case KEY_TAB: return GLFMKeyCodeTab;
+        case KEY_ENTER: return GLFMKeyCodeEnter;
+        case KEY_ESC: return GLFMKeyCodeEscape;
+        case KEY_SPACE: return GLFMKeyCodeSpace;
+        case KEY_APOSTROPHE: return GLFMKeyCodeQuote;
+        case KEY_COMMA: return GLFMKeyCodeComma;
+        case KEY_MINUS: return GLFMKeyCodeMinus;
+        case KEY_DOT: return GLFMKeyCodePeriod;
+        case KEY_SLASH: return GLFMKeyCodeSlash;
+        case KEY_SEMICOLON: return GLFMKeyCodeSemicolon;
+        case KEY_EQUAL: return GLFMKeyCodeEqual;
+        case KEY_LEFTBRACE: return GLFMKeyCodeBracketLeft;
+        case KEY_BACKSLASH: return GLFMKeyCodeBackslash;
+        case KEY_RIGHTBRACE: return GLFMKeyCodeBracketRight;
+        case KEY_GRAVE: return GLFMKeyCodeBackquote;
+        case KEY_DELETE: return GLFMKeyCodeDelete;
+
+        case KEY_CAPSLOCK: return GLFMKeyCodeCapsLock;
+        case KEY_LEFTSHIFT: return GLFMKeyCodeShiftLeft;
+        case KEY_RIGHTSHIFT: return GLFMKeyCodeShiftRight;
+        case KEY_LEFTCTRL: return GLFMKeyCodeControlLeft;
+        case KEY_RIGHTCTRL: return GLFMKeyCodeControlRight;
+        case KEY_LEFTALT: return GLFMKeyCodeAltLeft;
+        case KEY_RIGHTALT: return GLFMKeyCodeAltRight;
+        case KEY_LEFTMETA: return GLFMKeyCodeMetaLeft;
+        case KEY_RIGHTMETA: return GLFMKeyCodeMetaRight;
+        case KEY_COMPOSE: return GLFMKeyCodeMenu;
+        case KEY_MENU: return GLFMKeyCodeMenu;
+
+        case KEY_INSERT: return GLFMKeyCodeInsert;
+        case KEY_PAGEUP: return GLFMKeyCodePageUp;
+        case KEY_PAGEDOWN: return GLFMKeyCodePageDown;
+        case KEY_END: return GLFMKeyCodeEnd;
+        case KEY_HOME: return GLFMKeyCodeHome;
+        case KEY_LEFT: return GLFMKeyCodeArrowLeft;
+        case KEY_UP: return GLFMKeyCodeArrowUp;
+        case KEY_RIGHT: return GLFMKeyCodeArrowRight;
+        case KEY_DOWN: return GLFMKeyCodeArrowDown;
+
+        case KEY_POWER: return GLFMKeyCodePower;
+        case KEY_SYSRQ: return GLFMKeyCodePrintScreen;
+        case KEY_SCROLLLOCK: return GLFMKeyCodeScrollLock;
+        case KEY_PAUSE: return GLFMKeyCodePause;
+
+        case KEY_NUMLOCK: return GLFMKeyCodeNumLock;
+        case KEY_KPDOT: return GLFMKeyCodeNumpadDecimal;
+        case KEY_KPASTERISK: return GLFMKeyCodeNumpadMultiply;
+        case KEY_KPPLUS: return GLFMKeyCodeNumpadAdd;
+        case KEY_KPSLASH: return GLFMKeyCodeNumpadDivide;
+        case KEY_KPENTER: return GLFMKeyCodeNumpadEnter;
+        case KEY_KPMINUS: return GLFMKeyCodeNumpadSubtract;
+        case KEY_KPEQUAL: return GLFMKeyCodeNumpadEqual;
+        case KEY_KP0: return GLFMKeyCodeNumpad0;
+        case KEY_KP1: return GLFMKeyCodeNumpad1;
+        case KEY_KP2: return GLFMKeyCodeNumpad2;
+        case KEY_KP3: return GLFMKeyCodeNumpad3;
+        case KEY_KP4: return GLFMKeyCodeNumpad4;
+        case KEY_KP5: return GLFMKeyCodeNumpad5;
+        case KEY_KP6: return GLFMKeyCodeNumpad6;
+        case KEY_KP7: return GLFMKeyCodeNumpad7;
+        case KEY_KP8: return GLFMKeyCodeNumpad8;
+        case KEY_KP9: return GLFMKeyCodeNumpad9;
+
+        default: return GLFMKeyCodeUnknown;
+    }
+}
+
+static int glfm__waylandGetModifiers(GLFMPlatformData *platformData) {
+    struct xkb_state *state = platformData->xkbState;
+    int modifiers = 0;
+    if (!state) {
+        return modifiers;
+    }
+    if (xkb_state_mod_name_is_active(state, XKB_MOD_NAME_SHIFT, XKB_STATE_MODS_EFFECTIVE) > 0) {
+        modifiers |= GLFMKeyModifierShift;
+    }
+    if (xkb_state_mod_name_is_active(state, XKB_MOD_NAME_CTRL, XKB_STATE_MODS_EFFECTIVE) > 0) {
+        modifiers |= GLFMKeyModifierControl;
+    }
+    if (xkb_state_mod_name_is_active(state, XKB_MOD_NAME_ALT, XKB_STATE_MODS_EFFECTIVE) > 0) {
+        modifiers |= GLFMKeyModifierAlt;
+    }
+    if (xkb_state_mod_name_is_active(state, XKB_MOD_NAME_LOGO, XKB_STATE_MODS_EFFECTIVE) > 0) {
+        modifiers |= GLFMKeyModifierMeta;
+    }
+    return modifiers;
+}
+
+/// Sends a key event and, for presses, its character event.
+static void glfm__waylandDispatchKey(GLFMDisplay *display, double timestamp, uint32_t key,
+                                     GLFMKeyAction action) {
+    GLFMPlatformData *platformData = display->platformData;
+    if (glfm__isKeyInputNeeded(display)) {
+        glfm__dispatchKeyEvent(display, timestamp, glfm__waylandGetKeyCode(key), action,
+                               glfm__waylandGetModifiers(platformData));
+    }
+    if (action != GLFMKeyActionReleased && glfm__isCharInputNeeded(display) &&
+        platformData->xkbState) {
+        char utf8[64];
+        // XKB keycodes are Linux input event codes plus 8
+        int length = xkb_state_key_get_utf8(platformData->xkbState, key + 8, utf8, sizeof(utf8));
+        // Ignore control characters
+        if (length > 0 && (size_t)length < sizeof(utf8) &&
+            (unsigned char)utf8[0] >= 0x20 && utf8[0] != 0x7f) {
+            glfm__dispatchCharEvent(display, timestamp, utf8);
+        }
+    }
+}
+
+/// Sends the key repeats that are due. Wayland clients repeat keys themselves.
+static void glfm__waylandRepeatKey(GLFMDisplay *display) {
+    GLFMPlatformData *platformData = display->platformData;
+    if (!platformData->wlRepeating) {
+        return;
+    }
+    const double now = glfmGetTime();
+    if (now - platformData->wlRepeatTime > 1.0) {
+        // After a long frame, repeat from now instead of sending a burst of repeats
+        platformData->wlRepeatTime = now;
+    }
+    while (platformData->wlRepeating && platformData->wlRepeatTime <= now) {
+        glfm__waylandDispatchKey(display, platformData->wlRepeatTime, platformData->wlRepeatKey,
+                                 GLFMKeyActionRepeated);
+        platformData->wlRepeatTime += 1.0 / platformData->wlRepeatRate;
+    }
+}
+
+static void glfm__waylandKeyboardKeymap(void *data, struct wl_keyboard *keyboard, uint32_t format,
+                                        int32_t fd, uint32_t size) {
+    (void)keyboard;
+    GLFMDisplay *display = data;
+    GLFMPlatformData *platformData = display->platformData;
+    xkb_state_unref(platformData->xkbState);
+    xkb_keymap_unref(platformData->xkbKeymap);
+    platformData->xkbState = NULL;
+    platformData->xkbKeymap = NULL;
+    if (format == WL_KEYBOARD_KEYMAP_FORMAT_XKB_V1 && platformData->xkbContext) {
+        char *keymapString = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (keymapString != MAP_FAILED) {
+            platformData->xkbKeymap = xkb_keymap_new_from_buffer(platformData->xkbContext,
+                                                                 keymapString,
+                                                                 strnlen(keymapString, size),
+                                                                 XKB_KEYMAP_FORMAT_TEXT_V1,
+                                                                 XKB_KEYMAP_COMPILE_NO_FLAGS);
+            munmap(keymapString, size);
+        }
+        if (platformData->xkbKeymap) {
+            platformData->xkbState = xkb_state_new(platformData->xkbKeymap);
+        } else {
+            GLFM_LOG("Couldn't compile the keymap");
+        }
+    }
+    close(fd);
+}
+
+static void glfm__waylandKeyboardEnter(void *data, struct wl_keyboard *keyboard, uint32_t serial,
+                                       struct wl_surface *surface, struct wl_array *keys) {
+    (void)data;
+    (void)keyboard;
+    (void)serial;
+    (void)surface;
+    (void)keys;
+}
+
+static void glfm__waylandKeyboardLeave(void *data, struct wl_keyboard *keyboard, uint32_t serial,
+                                       struct wl_surface *surface) {
+    (void)keyboard;
+    (void)serial;
+    (void)surface;
+    GLFMDisplay *display = data;
+    GLFMPlatformData *platformData = display->platformData;
+    platformData->wlRepeating = false;
+}
+
+static void glfm__waylandKeyboardKey(void *data, struct wl_keyboard *keyboard, uint32_t serial,
+                                     uint32_t time, uint32_t key, uint32_t state) {
+    (void)keyboard;
+    (void)serial;
+    GLFMDisplay *display = data;
+    GLFMPlatformData *platformData = display->platformData;
+    const bool pressed = (state == WL_KEYBOARD_KEY_STATE_PRESSED);
+    const double timestamp = glfm__getEventTime(platformData, time);
+    if (pressed) {
+        // Without a keymap, modifier keys can't be told apart, so no keys are repeated
+        if (platformData->wlRepeatRate > 0 && platformData->xkbKeymap &&
+            xkb_keymap_key_repeats(platformData->xkbKeymap, key + 8)) {
+            platformData->wlRepeating = true;
+            platformData->wlRepeatKey = key;
+            platformData->wlRepeatTime = timestamp + platformData->wlRepeatDelay;
+        }
+    } else if (platformData->wlRepeating && platformData->wlRepeatKey == key) {
+        platformData->wlRepeating = false;
+    }
+    glfm__waylandDispatchKey(display, timestamp, key,
+                             pressed ? GLFMKeyActionPressed : GLFMKeyActionReleased);
+}
+
+static void glfm__waylandKeyboardModifiers(void *data, struct wl_keyboard *keyboard,
+                                           uint32_t serial, uint32_t depressed, uint32_t latched,
+                                           uint32_t locked, uint32_t group) {
+    (void)keyboard;
+    (void)serial;
+    GLFMDisplay *display = data;
+    GLFMPlatformData *platformData = display->platformData;
+    if (platformData->xkbState) {
+        xkb_state_update_mask(platformData->xkbState, depressed, latched, locked, 0, 0, group);
+    }
+}
+
+static void glfm__waylandKeyboardRepeatInfo(void *data, struct wl_keyboard *keyboard, int32_t rate,
+                                            int32_t delay) {
+    (void)keyboard;
+    GLFMDisplay *display = data;
+    GLFMPlatformData *platformData = display->platformData;
+    // A rate of zero disables repeat
+    platformData->wlRepeatRate = rate;
+    platformData->wlRepeatDelay = (double)delay / 1000.0;
+    if (rate <= 0) {
+        platformData->wlRepeating = false;
+    }
+}
+
+static const struct wl_keyboard_listener glfm__waylandKeyboardListener = {
+    .keymap = glfm__waylandKeyboardKeymap,
+    .enter = glfm__waylandKeyboardEnter,
+    .leave = glfm__waylandKeyboardLeave,
+    .key = glfm__waylandKeyboardKey,
+    .modifiers = glfm__waylandKeyboardModifiers,
+    .repeat_info = glfm__waylandKeyboardRepeatInfo,
+};
+
+#endif // GLFM_FEATURE_KEYBOARD
+
+// MARK: Touch
+
+static void glfm__waylandHandleTouch(GLFMDisplay *display, uint32_t time, int32_t touchId,
+                                     GLFMTouchPhase phase, double x, double y) {
+    GLFMPlatformData *platformData = display->platformData;
+    int identifier = glfm__getTouchIdentifier(platformData, touchId);
+    if (identifier < 0) {
+        return;
+    }
+    if (phase != GLFMTouchPhaseEnded) {
+        platformData->activeTouches[identifier].x = x;
+        platformData->activeTouches[identifier].y = y;
+    }
+    if (glfm__isTouchInputNeeded(display) && (platformData->multitouchEnabled || identifier == 0)) {
+        glfm__dispatchTouchEvent(display, glfm__getEventTime(platformData, time), identifier,
+                                 phase, platformData->activeTouches[identifier].x,
+                                 platformData->activeTouches[identifier].y);
+    }
+    if (phase == GLFMTouchPhaseEnded) {
+        platformData->activeTouches[identifier].active = false;
+    }
+}
+
+static void glfm__waylandTouchDown(void *data, struct wl_touch *touch, uint32_t serial,
+                                   uint32_t time, struct wl_surface *surface, int32_t id,
+                                   wl_fixed_t x, wl_fixed_t y) {
+    (void)touch;
+    (void)serial;
+    (void)surface;
+    glfm__waylandHandleTouch(data, time, id, GLFMTouchPhaseBegan, wl_fixed_to_double(x),
+                             wl_fixed_to_double(y));
+}
+
+static void glfm__waylandTouchUp(void *data, struct wl_touch *touch, uint32_t serial,
+                                 uint32_t time, int32_t id) {
+    (void)touch;
+    (void)serial;
+    // Ended at the last location
+    glfm__waylandHandleTouch(data, time, id, GLFMTouchPhaseEnded, 0.0, 0.0);
+}
+
+static void glfm__waylandTouchMotion(void *data, struct wl_touch *touch, uint32_t time,
+                                     int32_t id, wl_fixed_t x, wl_fixed_t y) {
+    (void)touch;
+    glfm__waylandHandleTouch(data, time, id, GLFMTouchPhaseMoved, wl_fixed_to_double(x),
+                             wl_fixed_to_double(y));
+}
+
+static void glfm__waylandTouchFrame(void *data, struct wl_touch *touch) {
+    (void)data;
+    (void)touch;
+}
+
+/// The compositor took the touches, like for a gesture.
+static void glfm__waylandTouchCancel(void *data, struct wl_touch *touch) {
+    (void)touch;
+    GLFMDisplay *display = data;
+    GLFMPlatformData *platformData = display->platformData;
+    const double timestamp = glfmGetTime();
+    for (int i = 0; i < GLFM_MAX_ACTIVE_TOUCHES; i++) {
+        if (platformData->activeTouches[i].active) {
+            platformData->activeTouches[i].active = false;
+            if (glfm__isTouchInputNeeded(display) && (platformData->multitouchEnabled || i == 0)) {
+                glfm__dispatchTouchEvent(display, timestamp, i, GLFMTouchPhaseCancelled,
+                                         platformData->activeTouches[i].x,
+                                         platformData->activeTouches[i].y);
+            }
+        }
+    }
+}
+
+// The shape and orientation events are only sent to seats of version 6 and later
+static const struct wl_touch_listener glfm__waylandTouchListener = {
+    .down = glfm__waylandTouchDown,
+    .up = glfm__waylandTouchUp,
+    .motion = glfm__waylandTouchMotion,
+    .frame = glfm__waylandTouchFrame,
+    .cancel = glfm__waylandTouchCancel,
+};
+
+// MARK: Seat
+
+static void glfm__waylandReleasePointer(GLFMDisplay *display) {
+    GLFMPlatformData *platformData = display->platformData;
+    if (!platformData->wlPointer) {
+        return;
+    }
+    glfm__waylandUnlockPointer(display);
+    if (wl_pointer_get_version(platformData->wlPointer) >= WL_POINTER_RELEASE_SINCE_VERSION) {
+        wl_pointer_release(platformData->wlPointer);
+    } else {
+        wl_pointer_destroy(platformData->wlPointer);
+    }
+    platformData->wlPointer = NULL;
+    platformData->mouseButtonsDown = 0;
+}
+
+static void glfm__waylandReleaseKeyboard(GLFMPlatformData *platformData) {
+    if (!platformData->wlKeyboard) {
+        return;
+    }
+    if (wl_keyboard_get_version(platformData->wlKeyboard) >= WL_KEYBOARD_RELEASE_SINCE_VERSION) {
+        wl_keyboard_release(platformData->wlKeyboard);
+    } else {
+        wl_keyboard_destroy(platformData->wlKeyboard);
+    }
+    platformData->wlKeyboard = NULL;
+    platformData->wlRepeating = false;
+}
+
+static void glfm__waylandReleaseTouch(GLFMPlatformData *platformData) {
+    if (!platformData->wlTouch) {
+        return;
+    }
+    if (wl_touch_get_version(platformData->wlTouch) >= WL_TOUCH_RELEASE_SINCE_VERSION) {
+        wl_touch_release(platformData->wlTouch);
+    } else {
+        wl_touch_destroy(platformData->wlTouch);
+    }
+    platformData->wlTouch = NULL;
+    platformData->touchAvailable = false;
+    memset(platformData->activeTouches, 0, sizeof(platformData->activeTouches));
+}
+
+static void glfm__waylandSeatCapabilities(void *data, struct wl_seat *seat, uint32_t capabilities) {
+    GLFMDisplay *display = data;
+    GLFMPlatformData *platformData = display->platformData;
+    if ((capabilities & WL_SEAT_CAPABILITY_POINTER) && !platformData->wlPointer) {
+        platformData->wlPointer = wl_seat_get_pointer(seat);
+        wl_pointer_add_listener(platformData->wlPointer, &glfm__waylandPointerListener, display);
+    } else if (!(capabilities & WL_SEAT_CAPABILITY_POINTER)) {
+        glfm__waylandReleasePointer(display);
+    }
+#if GLFM_FEATURE_KEYBOARD
+    if ((capabilities & WL_SEAT_CAPABILITY_KEYBOARD) && !platformData->wlKeyboard) {
+        platformData->wlKeyboard = wl_seat_get_keyboard(seat);
+        wl_keyboard_add_listener(platformData->wlKeyboard, &glfm__waylandKeyboardListener, display);
+    } else if (!(capabilities & WL_SEAT_CAPABILITY_KEYBOARD)) {
+        glfm__waylandReleaseKeyboard(platformData);
+    }
+#endif
+    if ((capabilities & WL_SEAT_CAPABILITY_TOUCH) && !platformData->wlTouch) {
+        platformData->wlTouch = wl_seat_get_touch(seat);
+        wl_touch_add_listener(platformData->wlTouch, &glfm__waylandTouchListener, display);
+        platformData->touchAvailable = true;
+    } else if (!(capabilities & WL_SEAT_CAPABILITY_TOUCH)) {
+        glfm__waylandReleaseTouch(platformData);
+    }
+}
+
+static void glfm__waylandSeatName(void *data, struct wl_seat *seat, const char *name) {
+    (void)data;
+    (void)seat;
+    (void)name;
+}
+
+static const struct wl_seat_listener glfm__waylandSeatListener = {
+    .capabilities = glfm__waylandSeatCapabilities,
+    .name = glfm__waylandSeatName,
+};
+
+// MARK: Window
+
+/// Sends a focus change if the window's activation changed. Until the surface is created, the
+/// window is focused (see main()).
+static void glfm__waylandUpdateFocus(GLFMDisplay *display) {
+    GLFMPlatformData *platformData = display->platformData;
+    if (!platformData->wlDisplay || !platformData->surfaceCreatedNotified ||
+        platformData->focused == platformData->wlActivated) {
+        return;
+    }
+    const bool focused = platformData->wlActivated;
+    platformData->focused = focused;
+    if (!focused) {
+        platformData->wlRepeating = false;
+    }
+    glfm__waylandUpdatePointerLock(display);
+    glfm__setSuspended(display, !focused);
+    if (display->focusFunc) {
+        display->focusFunc(display, focused);
+    }
+}
+
+static void glfm__waylandWmBasePing(void *data, struct xdg_wm_base *wmBase, uint32_t serial) {
+    (void)data;
+    xdg_wm_base_pong(wmBase, serial);
+}
+
+static const struct xdg_wm_base_listener glfm__waylandWmBaseListener = {
+    .ping = glfm__waylandWmBasePing,
+};
+
+/// Applies the state of the toplevel configure event that precedes this event. Before the surface
+/// is created, the size is the surface's initial size.
+static void glfm__waylandSurfaceConfigure(void *data, struct xdg_surface *xdgSurface,
+                                          uint32_t serial) {
+    GLFMDisplay *display = data;
+    GLFMPlatformData *platformData = display->platformData;
+    xdg_surface_ack_configure(xdgSurface, serial);
+    platformData->wlConfigured = true;
+
+    // A size of zero lets the app choose
+    const int32_t width = (platformData->wlPendingWidth > 0 ?
+                           platformData->wlPendingWidth : platformData->width);
+    const int32_t height = (platformData->wlPendingHeight > 0 ?
+                            platformData->wlPendingHeight : platformData->height);
+    if (width != platformData->width || height != platformData->height) {
+        platformData->width = width;
+        platformData->height = height;
+        if (platformData->wlEglWindow) {
+            wl_egl_window_resize(platformData->wlEglWindow, width, height, 0, 0);
+        }
+        platformData->refreshRequested = true;
+        if (platformData->surfaceCreatedNotified && display->surfaceResizedFunc) {
+            display->surfaceResizedFunc(display, width, height);
+        }
+    }
+
+    const bool visible = !platformData->wlPendingSuspended;
+    if (visible != platformData->windowVisible) {
+        platformData->windowVisible = visible;
+        platformData->refreshRequested = visible;
+    }
+    platformData->wlActivated = platformData->wlPendingActivated;
+    glfm__waylandUpdateFocus(display);
+    glfm__waylandUpdatePointerLock(display);
+}
+
+static const struct xdg_surface_listener glfm__waylandSurfaceListener = {
+    .configure = glfm__waylandSurfaceConfigure,
+};
+
+static void glfm__waylandToplevelConfigure(void *data, struct xdg_toplevel *toplevel,
+                                           int32_t width, int32_t height, struct wl_array *states) {
+    (void)toplevel;
+    GLFMDisplay *display = data;
+    GLFMPlatformData *platformData = display->platformData;
+    platformData->wlPendingWidth = width;
+    platformData->wlPendingHeight = height;
+    platformData->wlPendingActivated = false;
+    platformData->wlPendingSuspended = false;
+    const uint32_t *state;
+    wl_array_for_each(state, states) {
+        if (*state == XDG_TOPLEVEL_STATE_ACTIVATED) {
+            platformData->wlPendingActivated = true;
+        }
+#if GLFM_XDG_WM_BASE_VERSION >= 6
+        if (*state == XDG_TOPLEVEL_STATE_SUSPENDED) {
+            platformData->wlPendingSuspended = true;
+        }
+#endif
+    }
+}
+
+static void glfm__waylandToplevelClose(void *data, struct xdg_toplevel *toplevel) {
+    (void)toplevel;
+    GLFMDisplay *display = data;
+    GLFMPlatformData *platformData = display->platformData;
+    platformData->windowClosed = true;
+}
+
+#if GLFM_XDG_WM_BASE_VERSION >= 6
+
+static void glfm__waylandToplevelConfigureBounds(void *data, struct xdg_toplevel *toplevel,
+                                                 int32_t width, int32_t height) {
+    (void)data;
+    (void)toplevel;
+    (void)width;
+    (void)height;
+}
+
+static void glfm__waylandToplevelWmCapabilities(void *data, struct xdg_toplevel *toplevel,
+                                                struct wl_array *capabilities) {
+    (void)data;
+    (void)toplevel;
+    (void)capabilities;
+}
+
+#endif
+
+static const struct xdg_toplevel_listener glfm__waylandToplevelListener = {
+    .configure = glfm__waylandToplevelConfigure,
+    .close = glfm__waylandToplevelClose,
+#if GLFM_XDG_WM_BASE_VERSION >= 6
+    .configure_bounds = glfm__waylandToplevelConfigureBounds,
+    .wm_capabilities = glfm__waylandToplevelWmCapabilities,
+#endif
+};
+
+static void glfm__waylandDestroyWindow(GLFMDisplay *display) {
+    GLFMPlatformData *platformData = display->platformData;
+    if (!platformData->wlDisplay) {
+        return;
+    }
+    // Destroying the surface releases the pointer lock
+    glfm__waylandUnlockPointer(display);
+    if (platformData->wlEglWindow) {
+        wl_egl_window_destroy(platformData->wlEglWindow);
+        platformData->wlEglWindow = NULL;
+    }
+    if (platformData->xdgToplevel) {
+        xdg_toplevel_destroy(platformData->xdgToplevel);
+        platformData->xdgToplevel = NULL;
+    }
+    if (platformData->xdgSurface) {
+        xdg_surface_destroy(platformData->xdgSurface);
+        platformData->xdgSurface = NULL;
+    }
+    if (platformData->wlSurface) {
+        wl_surface_destroy(platformData->wlSurface);
+        platformData->wlSurface = NULL;
+    }
+    platformData->wlConfigured = false;
+    platformData->windowVisible = false;
+    wl_display_flush(platformData->wlDisplay);
+}
+
+static bool glfm__waylandCreateWindow(GLFMDisplay *display) {
+    GLFMPlatformData *platformData = display->platformData;
+    platformData->wlSurface = wl_compositor_create_surface(platformData->wlCompositor);
+    platformData->xdgSurface = xdg_wm_base_get_xdg_surface(platformData->xdgWmBase,
+                                                           platformData->wlSurface);
+    xdg_surface_add_listener(platformData->xdgSurface, &glfm__waylandSurfaceListener, display);
+    platformData->xdgToplevel = xdg_surface_get_toplevel(platformData->xdgSurface);
+    xdg_toplevel_add_listener(platformData->xdgToplevel, &glfm__waylandToplevelListener, display);
+    wl_surface_commit(platformData->wlSurface);
+
+    // A buffer can't be attached until the window is configured
+    while (!platformData->wlConfigured && !platformData->windowClosed) {
+        if (wl_display_dispatch(platformData->wlDisplay) < 0) {
+            break;
+        }
+    }
+    if (!platformData->wlConfigured) {
+        glfm__waylandDestroyWindow(display);
+        return false;
+    }
+
+    // Vulkan windows use the surface
+    if (platformData->eglDisplay != EGL_NO_DISPLAY) {
+        platformData->wlEglWindow = wl_egl_window_create(platformData->wlSurface,
+                                                         platformData->width, platformData->height);
+        if (!platformData->wlEglWindow) {
+            glfm__waylandDestroyWindow(display);
+            return false;
+        }
+    }
+    return true;
+}
+
+/// Dispatches the events of the connection. Blocks while the window is hidden.
+static void glfm__waylandHandleEvents(GLFMDisplay *display) {
+    GLFMPlatformData *platformData = display->platformData;
+    struct wl_display *wlDisplay = platformData->wlDisplay;
+    do {
+        while (wl_display_prepare_read(wlDisplay) != 0) {
+            wl_display_dispatch_pending(wlDisplay);
+        }
+        wl_display_flush(wlDisplay);
+        struct pollfd pollFd = { .fd = wl_display_get_fd(wlDisplay), .events = POLLIN };
+        const int timeout = platformData->windowVisible ? 0 : -1;
+        if (poll(&pollFd, 1, timeout) > 0) {
+            wl_display_read_events(wlDisplay);
+        } else {
+            wl_display_cancel_read(wlDisplay);
+        }
+        if (wl_display_dispatch_pending(wlDisplay) < 0) {
+            // The connection was lost, like when the compositor exits
+            GLFM_LOG("Wayland connection error %i", wl_display_get_error(wlDisplay));
+            platformData->windowClosed = true;
+        }
+    } while (!platformData->windowClosed && !platformData->windowVisible);
+#if GLFM_FEATURE_KEYBOARD
+    glfm__waylandRepeatKey(display);
+#endif
+}
+
+// MARK: Connection
+
+static void glfm__waylandRegistryGlobal(void *data, struct wl_registry *registry, uint32_t name,
+                                        const char *interface, uint32_t version) {
+    GLFMDisplay *display = data;
+    GLFMPlatformData *platformData = display->platformData;
+    if (strcmp(interface, wl_compositor_interface.name) == 0 && !platformData->wlCompositor) {
+        platformData->wlCompositor =
+            wl_registry_bind(registry, name, &wl_compositor_interface,
+                             glfm__waylandMinVersion(version, GLFM_WL_COMPOSITOR_VERSION));
+    } else if (strcmp(interface, wl_shm_interface.name) == 0 && !platformData->wlShm) {
+        platformData->wlShm = wl_registry_bind(registry, name, &wl_shm_interface, 1);
+    } else if (strcmp(interface, wl_seat_interface.name) == 0 && !platformData->wlSeat) {
+        // Only the first seat is used
+        platformData->wlSeat = wl_registry_bind(registry, name, &wl_seat_interface,
+                                                glfm__waylandMinVersion(version,
+                                                                        GLFM_WL_SEAT_VERSION));
+        wl_seat_add_listener(platformData->wlSeat, &glfm__waylandSeatListener, display);
+    } else if (strcmp(interface, xdg_wm_base_interface.name) == 0 && !platformData->xdgWmBase) {
+        platformData->xdgWmBase = wl_registry_bind(registry, name, &xdg_wm_base_interface,
+                                                   glfm__waylandMinVersion(version,
+                                                                           GLFM_XDG_WM_BASE_VERSION));
+        xdg_wm_base_add_listener(platformData->xdgWmBase, &glfm__waylandWmBaseListener, display);
+    } else if (strcmp(interface, zwp_pointer_constraints_v1_interface.name) == 0 &&
+               !platformData->wlPointerConstraints) {
+        platformData->wlPointerConstraints =
+            wl_registry_bind(registry, name, &zwp_pointer_constraints_v1_interface, 1);
+    } else if (strcmp(interface, zwp_relative_pointer_manager_v1_interface.name) == 0 &&
+               !platformData->wlRelativePointerManager) {
+        platformData->wlRelativePointerManager =
+            wl_registry_bind(registry, name, &zwp_relative_pointer_manager_v1_interface, 1);
+    }
+}
+
+static void glfm__waylandRegistryGlobalRemove(void *data, struct wl_registry *registry,
+                                              uint32_t name) {
+    // The globals that GLFM uses aren't removed while the app runs
+    (void)data;
+    (void)registry;
+    (void)name;
+}
+
+static const struct wl_registry_listener glfm__waylandRegistryListener = {
+    .global = glfm__waylandRegistryGlobal,
+    .global_remove = glfm__waylandRegistryGlobalRemove,
+};
+
+/// Releases the globals of the connection. The connection itself is closed by main().
+static void glfm__waylandDisconnect(GLFMDisplay *display) {
+    GLFMPlatformData *platformData = display->platformData;
+    if (!platformData->wlDisplay) {
+        return;
+    }
+    glfm__waylandReleasePointer(display);
+    glfm__waylandReleaseKeyboard(platformData);
+    glfm__waylandReleaseTouch(platformData);
+    xkb_state_unref(platformData->xkbState);
+    xkb_keymap_unref(platformData->xkbKeymap);
+    xkb_context_unref(platformData->xkbContext);
+    platformData->xkbState = NULL;
+    platformData->xkbKeymap = NULL;
+    platformData->xkbContext = NULL;
+    if (platformData->wlCursorSurface) {
+        wl_surface_destroy(platformData->wlCursorSurface);
+        platformData->wlCursorSurface = NULL;
+    }
+    if (platformData->wlCursorTheme) {
+        wl_cursor_theme_destroy(platformData->wlCursorTheme);
+        platformData->wlCursorTheme = NULL;
+    }
+    if (platformData->wlSeat) {
+        if (wl_seat_get_version(platformData->wlSeat) >= WL_SEAT_RELEASE_SINCE_VERSION) {
+            wl_seat_release(platformData->wlSeat);
+        } else {
+            wl_seat_destroy(platformData->wlSeat);
+        }
+        platformData->wlSeat = NULL;
+    }
+    if (platformData->wlRelativePointerManager) {
+        zwp_relative_pointer_manager_v1_destroy(platformData->wlRelativePointerManager);
+        platformData->wlRelativePointerManager = NULL;
+    }
+    if (platformData->wlPointerConstraints) {
+        zwp_pointer_constraints_v1_destroy(platformData->wlPointerConstraints);
+        platformData->wlPointerConstraints = NULL;
+    }
+    if (platformData->xdgWmBase) {
+        xdg_wm_base_destroy(platformData->xdgWmBase);
+        platformData->xdgWmBase = NULL;
+    }
+    if (platformData->wlShm) {
+        wl_shm_destroy(platformData->wlShm);
+        platformData->wlShm = NULL;
+    }
+    if (platformData->wlCompositor) {
+        wl_compositor_destroy(platformData->wlCompositor);
+        platformData->wlCompositor = NULL;
+    }
+    if (platformData->wlRegistry) {
+        wl_registry_destroy(platformData->wlRegistry);
+        platformData->wlRegistry = NULL;
+    }
+    wl_display_flush(platformData->wlDisplay);
+    platformData->wlDisplay = NULL;
+}
+
+/// Binds the globals of a connection. Returns false if the compositor doesn't support xdg-shell
+/// windows.
+static bool glfm__waylandConnect(GLFMDisplay *display, struct wl_display *wlDisplay) {
+    GLFMPlatformData *platformData = display->platformData;
+    platformData->wlDisplay = wlDisplay;
+#if GLFM_FEATURE_KEYBOARD
+    platformData->xkbContext = xkb_context_new(XKB_CONTEXT_NO_FLAGS);
+#endif
+    platformData->wlRegistry = wl_display_get_registry(wlDisplay);
+    wl_registry_add_listener(platformData->wlRegistry, &glfm__waylandRegistryListener, display);
+    // The first roundtrip binds the globals, and the second gets the seat's capabilities
+    if (wl_display_roundtrip(wlDisplay) < 0 || wl_display_roundtrip(wlDisplay) < 0 ||
+        !platformData->wlCompositor || !platformData->xdgWmBase) {
+        glfm__waylandDisconnect(display);
+        return false;
+    }
+    return true;
+}
+
+#endif // GLFM_HAS_WAYLAND
+
+// MARK: - Display lifecycle
+
+static GLFMDisplay *glfm__createDisplay(int width, int height, void *userData) {
+    GLFMDisplay *display = calloc(1, sizeof(GLFMDisplay));
+    GLFMPlatformData *platformData = calloc(1, sizeof(GLFMPlatformData));
+    if (!display || !platformData) {
+        free(display);
+        free(platformData);
+        return NULL;
+    }
+    display->platformData = platformData;
+    display->supportedOrientations = GLFMInterfaceOrientationAll;
+    display->swapInterval = -1;
+    display->frameTimestampsFunc = glfm__outputGetFrameTimestamps;
+    display->userData = userData;
+    platformData->eglDisplay = EGL_NO_DISPLAY;
+    platformData->eglContext = EGL_NO_CONTEXT;
+    platformData->eglSurface = EGL_NO_SURFACE;
+    platformData->eglSwapInterval = -1;
+    platformData->width = width > 0 ? width : GLFM_DEFAULT_DISPLAY_WIDTH;
+    platformData->height = height > 0 ? height : GLFM_DEFAULT_DISPLAY_HEIGHT;
+#if GLFM_FEATURE_SENSORS
+    glfm__sensorFusionReset(&platformData->sensorFusion);
+#endif
+    return display;
+}
+
+static void glfm__notifySurfaceCreated(GLFMDisplay *display) {
+    GLFMPlatformData *platformData = display->platformData;
+    if (!platformData->surfaceCreatedNotified) {
+        platformData->surfaceCreatedNotified = true;
+        if (display->surfaceCreatedFunc) {
+            display->surfaceCreatedFunc(display, platformData->width, platformData->height);
+        }
+    }
+}
+
+/// Sets the frame time, publishes input, and invokes the render function. With a fixed output
+/// frame rate, frame times advance by exactly one frame interval; otherwise the real time is used.
+static void glfm__drawFrame(GLFMDisplay *display) {
+    GLFMPlatformData *platformData = display->platformData;
+    if (platformData->fixedFrameRate > 0) {
+        const double frameTime = (double)platformData->fixedFrameIndex / platformData->fixedFrameRate;
+        glfm__setFrameTime(display, frameTime, frameTime + 1.0 / platformData->fixedFrameRate);
+        platformData->fixedFrameIndex++;
+    } else {
+        glfm__setFrameTime(display, glfmGetTime(), 0.0);
+    }
+    glfm__inputServerPoll(display);
+    glfm__waitForFrameJobs(display);
+    glfm__swapInputSnapshot(display);
+    if (display->renderFunc) {
+        display->renderFunc(display);
+    }
+    glfm__runIdleTasks(display, glfm__getIdleDeadline(display));
+}
+
+GLFMDisplay *glfmCreateDisplay(GLFMMainFunc mainFunc, int width, int height, void *userData) {
+    GLFMDisplay *display = glfm__createDisplay(width, height, userData);
+    if (display && mainFunc) {
+        mainFunc(display);
+    }
+    return display;
+}
+
+bool glfmRunDisplay(GLFMDisplay *display, int frameCount) {
+    if (!display) {
+        return false;
+    }
+    GLFMPlatformData *platformData = display->platformData;
+    const bool vulkan = glfm__vulkanInit(display);
+    if (!vulkan && (!glfm__eglInit(display) || !glfm__eglMakeCurrent(display))) {
+        return false;
+    }
+    glfm__notifySurfaceCreated(display);
+    for (int i = 0; i < frameCount; i++) {
+        glfm__drawFrame(display);
+    }
+    glfm__outputFlush(display);
+    if (!vulkan) {
+        // Release the context, so that the display can be run from a different thread next time.
+        eglMakeCurrent(platformData->eglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    }
+    return true;
+}
+
+void glfmDestroyDisplay(GLFMDisplay *display) {
+    if (!display) {
+        return;
+    }
+    GLFMPlatformData *platformData = display->platformData;
+    glfmDestroyJobCounter(display->frameJobCounter);
+    glfm__outputDestroy(display);
+    glfm__inputServerDestroy(display);
+    glfm__vulkanDisplayDestroy(display);
+    glfm__eglDestroy(display);
+#if GLFM_HAS_WINDOW
+    glfm__destroyWindow(display);
+#endif
+#if GLFM_HAS_WAYLAND
+    glfm__waylandDisconnect(display);
+#endif
+    free(platformData->clipboardText);
+    free(platformData);
+    free(display);
+}
+
+#if GLFM_HAS_WINDOW
+
+// MARK: - Windowed main
+
+// Apps that create their own headless displays define main() and not glfmMain().
+#pragma weak glfmMain
+
+static bool glfm__createWindow(GLFMDisplay *display) {
+    GLFMPlatformData *platformData = display->platformData;
+#if GLFM_HAS_WAYLAND
+    if (platformData->wlDisplay) {
+        return glfm__waylandCreateWindow(display);
+    }
+#endif
+#if GLFM_HAS_X11
+    if (platformData->xDisplay) {
+        return glfm__x11CreateWindow(display);
+    }
+#endif
+    (void)platformData;
+    return false;
+}
+
+static void glfm__destroyWindow(GLFMDisplay *display) {
+#if GLFM_HAS_WAYLAND
+    glfm__waylandDestroyWindow(display);
+#endif
+#if GLFM_HAS_X11
+    glfm__x11DestroyWindow(display);
+#endif
+}
+
+static void glfm__setWindowTitle(GLFMDisplay *display, const char *title) {
+    GLFMPlatformData *platformData = display->platformData;
+#if GLFM_HAS_WAYLAND
+    if (platformData->xdgToplevel) {
+        xdg_toplevel_set_title(platformData->xdgToplevel, title);
+        xdg_toplevel_set_app_id(platformData->xdgToplevel, title);
+    }
+#endif
+#if GLFM_HAS_X11
+    if (platformData->xDisplay) {
+        XStoreName(platformData->xDisplay, platformData->xWindow, title);
+    }
+#endif
+    (void)platformData;
+    (void)title;
+}
+
+/// Handles the pending window events. Blocks while the window is hidden.
+static void glfm__handleWindowEvents(GLFMDisplay *display) {
+    GLFMPlatformData *platformData = display->platformData;
+#if GLFM_HAS_WAYLAND
+    if (platformData->wlDisplay) {
+        glfm__waylandHandleEvents(display);
+    }
+#endif
+#if GLFM_HAS_X11
+    Display *xDisplay = platformData->xDisplay;
+    while (xDisplay && !platformData->windowClosed &&
+           (XPending(xDisplay) > 0 || !platformData->windowVisible)) {
+        XEvent event;
+        XNextEvent(xDisplay, &event);
+        glfm__x11HandleEvent(display, &event);
+    }
+#endif
+    (void)platformData;
+}
+
+/// Destroys a windowed display, and then closes its connection to the window system.
+static void glfm__destroyWindowedDisplay(GLFMDisplay *display) {
+    GLFMPlatformData *platformData = display->platformData;
+#if GLFM_HAS_WAYLAND
+    struct wl_display *wlDisplay = platformData->wlDisplay;
+#endif
+#if GLFM_HAS_X11
+    Display *xDisplay = platformData->xDisplay;
+#endif
+    (void)platformData;
+    glfmDestroyDisplay(display);
+#if GLFM_HAS_WAYLAND
+    if (wlDisplay) {
+        wl_display_disconnect(wlDisplay);
+    }
+#endif
+#if GLFM_HAS_X11
+    if (xDisplay) {
+        XCloseDisplay(xDisplay);
+    }
+#endif
+}
+
+/// The entry point of windowed apps. Apps that define their own main() replace this one.
+///
+/// Wayland is used if a compositor is running (`WAYLAND_DISPLAY` is set), and X11 otherwise.
+__attribute__((weak)) int main(int argc, char *argv[]) {
+    (void)argc;
+    if (!glfmMain) {
+        fprintf(stderr, "GLFM: glfmMain() is not defined\n");
+        return EXIT_FAILURE;
+    }
+    setlocale(LC_CTYPE, "");
+
+    GLFMDisplay *display = glfm__createDisplay(0, 0, NULL);
+    if (!display) {
+        return EXIT_FAILURE;
+    }
+    GLFMPlatformData *platformData = display->platformData;
+#if GLFM_HAS_WAYLAND
+    const char *waylandDisplayName = getenv("WAYLAND_DISPLAY");
+    if (waylandDisplayName && waylandDisplayName[0]) {
+        struct wl_display *wlDisplay = wl_display_connect(NULL);
+        if (wlDisplay && !glfm__waylandConnect(display, wlDisplay)) {
+            GLFM_LOG("The Wayland compositor doesn't support xdg-shell");
+            wl_display_disconnect(wlDisplay);
+        }
+    }
+#endif
+#if GLFM_HAS_X11
+    if (!glfm__isWindowed(platformData)) {
+        platformData->xDisplay = XOpenDisplay(NULL);
+        if (platformData->xDisplay) {
+            XSetLocaleModifiers("");
+        }
+    }
+#endif
+    if (!glfm__isWindowed(platformData)) {
+        fprintf(stderr, "GLFM: Couldn't connect to a Wayland compositor or an X display\n");
+        glfmDestroyDisplay(display);
+        return EXIT_FAILURE;
+    }
+    glfmMain(display);
+
+    if (!glfm__vulkanInit(display) && (!glfm__eglInit(display) || !glfm__eglMakeCurrent(display))) {
+        glfm__destroyWindowedDisplay(display);
+        return EXIT_FAILURE;
+    }
+    if (argv && argv[0]) {
+        const char *name = strrchr(argv[0], '/');
+        glfm__setWindowTitle(display, name ? name + 1 : argv[0]);
+    }
+    glfm__notifySurfaceCreated(display);
+
+    platformData->focused = true;
+#if GLFM_HAS_WAYLAND
+    // The compositor may not have activated the window
+    glfm__waylandUpdateFocus(display);
+#endif
+    while (!platformData->windowClosed) {
+        glfm__handleWindowEvents(display);
+        if (platformData->windowClosed) {
+            break;
+        }
+        if (platformData->refreshRequested) {
+            platformData->refreshRequested = false;
+            if (display->surfaceRefreshFunc) {
+                display->surfaceRefreshFunc(display);
+            }
+        }
+        glfm__drawFrame(display);
+    }
+
+    // Closing the window ends the app: focus is lost, and then the surface is destroyed
+    if (platformData->focused) {
+        platformData->focused = false;
+        glfm__setSuspended(display, true);
+        if (display->focusFunc) {
+            display->focusFunc(display, false);
+        }
+    }
+    glfm__destroyWindowedDisplay(display);
+    return EXIT_SUCCESS;
+}
+
+#endif // GLFM_HAS_WINDOW
+
+// MARK: - GLFM private functions
+
+static void glfm__displayChromeUpdated(GLFMDisplay *display) {
+    (void)display;
+}
+
+static void glfm__sensorFuncUpdated(GLFMDisplay *display) {
+#if GLFM_FEATURE_SENSORS
+    // No sensors, but sensor events can be injected. See glfm__inputServerDispatchSensor().
+    GLFMPlatformData *platformData = display->platformData;
+    if (!display->sensorFuncs[GLFMSensorRotationMatrix]) {
+        glfm__sensorFusionReset(&platformData->sensorFusion);
+        platformData->gyroscopeInjected = false;
+    }
+#else
+    (void)display;
+#endif
+}
+
+static void glfm__pointerLockUpdated(GLFMDisplay *display) {
+    GLFMPlatformData *platformData = display->platformData;
+#if GLFM_HAS_WAYLAND
+    if (platformData->wlDisplay) {
+        glfm__waylandUpdatePointerLock(display);
+        return;
+    }
+#endif
+#if GLFM_HAS_X11
+    if (platformData->xDisplay) {
+        glfm__x11UpdatePointerLock(display);
+        return;
+    }
+#endif
+    (void)platformData;
+    // Headless displays have no pointer, so the lock is always granted. Motion can be injected.
+    display->pointerLocked = display->pointerLockRequested;
+}
+
+// MARK: - GLFM public functions
+
+double glfmGetTime(void) {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (double)time.tv_sec + (double)time.tv_nsec / 1e9;
+}
+
+uint64_t glfmSwapBuffers(GLFMDisplay *display) {
+    if (!display) {
+        return 0;
+    }
+    GLFMPlatformData *platformData = display->platformData;
+    uint64_t frameId = 0;
+#if GLFM_HAS_VULKAN
+    if (display->vulkan) {
+        if (glfm__vulkanPresent(display->vulkan)) {
+            frameId = glfm__recordSwap(display, 0);
+            glfm__inputServerPresent(display, glfmGetTime());
+        }
+        return frameId;
+    }
+#endif
+    if (platformData->eglSurface != EGL_NO_SURFACE) {
+        uint64_t platformFrameId = 0;
+        if (platformData->output) {
+            platformFrameId = (uint64_t)platformData->output->frameIndex + 1;
+            glfm__outputCaptureFrame(display);
+        }
+        glfm__eglUpdateSwapInterval(display);
+        // Swapping a pbuffer has no effect, so flush to make sure the frame is rendered.
+        eglSwapBuffers(platformData->eglDisplay, platformData->eglSurface);
+        glFlush();
+        frameId = glfm__recordSwap(display, platformFrameId);
+        glfm__inputServerPresent(display, glfmGetTime());
+    }
+    return frameId;
+}
+
+void glfmSetSupportedInterfaceOrientation(GLFMDisplay *display,
+                                          GLFMInterfaceOrientation supportedOrientations) {
+    if (display) {
+        display->supportedOrientations = supportedOrientations;
+    }
+}
+
+GLFMInterfaceOrientation glfmGetInterfaceOrientation(const GLFMDisplay *display) {
+    GLFMPlatformData *platformData = display->platformData;
+    if (platformData->width >= platformData->height) {
+        return GLFMInterfaceOrientationLandscapeRight;
+    } else {
+        return GLFMInterfaceOrientationPortrait;
+    }
+}
+
+void glfmGetDisplaySize(const GLFMDisplay *display, int *width, int *height) {
+    GLFMPlatformData *platformData = display->platformData;
+    if (width) *width = platformData->width;
+    if (height) *height = platformData->height;
+}
+
+double glfmGetDisplayScale(const GLFMDisplay *display) {
+    (void)display;
+    return 1.0;
+}
+
+void glfmGetDisplayChromeInsets(const GLFMDisplay *display, double *top, double *right,
+                                double *bottom, double *left) {
+    (void)display;
+    if (top) *top = 0.0;
+    if (right) *right = 0.0;
+    if (bottom) *bottom = 0.0;
+    if (left) *left = 0.0;
+}
+
+GLFMRenderingAPI glfmGetRenderingAPI(const GLFMDisplay *display) {
+    GLFMPlatformData *platformData = display->platformData;
+    return platformData->renderingAPI;
+}
+
+bool glfmHasTouch(const GLFMDisplay *display) {
+#if GLFM_HAS_WINDOW
+    GLFMPlatformData *platformData = display->platformData;
+    return platformData->touchAvailable;
+#else
+    (void)display;
+    return false;
+#endif
+}
+
+void glfmSetMouseCursor(GLFMDisplay *display, GLFMMouseCursor mouseCursor) {
+#if GLFM_HAS_WINDOW && GLFM_FEATURE_MOUSE_CURSOR
+    GLFMPlatformData *platformData = display->platformData;
+#  if GLFM_HAS_WAYLAND
+    if (platformData->wlDisplay) {
+        platformData->wlMouseCursor = mouseCursor;
+        glfm__waylandUpdateCursor(display);
+        return;
+    }
+#  endif
+#  if GLFM_HAS_X11
+    Display *xDisplay = platformData->xDisplay;
+    if (!xDisplay || !platformData->xWindow) {
+        return;
+    }
+    Cursor cursor = None;
+    switch (mouseCursor) {
+        case GLFMMouseCursorAuto:
+        case GLFMMouseCursorDefault:
+        default:
+            break;
+        case GLFMMouseCursorPointer:
+            cursor = XCreateFontCursor(xDisplay, XC_hand2);
+            break;
+        case GLFMMouseCursorCrosshair:
+            cursor = XCreateFontCursor(xDisplay, XC_crosshair);
+            break;
+        case GLFMMouseCursorText:
+        case GLFMMouseCursorVerticalText:
+            cursor = XCreateFontCursor(xDisplay, XC_xterm);
+            break;
+        case GLFMMouseCursorNone:
+            cursor = glfm__x11CreateHiddenCursor(xDisplay, platformData->xWindow);
+            break;
+    }
+    if (cursor == None) {
+        XUndefineCursor(xDisplay, platformData->xWindow);
+    } else {
+        XDefineCursor(xDisplay, platformData->xWindow, cursor);
+    }
+    if (platformData->xCursor) {
+        XFreeCursor(xDisplay, platformData->xCursor);
+    }
+    platformData->xCursor = cursor;
+    XFlush(xDisplay);
+#  endif
+#else
+    (void)display;
+    (void)mouseCursor;
+    // Do nothing
+#endif
+}
+
+void glfmSetMultitouchEnabled(GLFMDisplay *display, bool multitouchEnabled) {
+    GLFMPlatformData *platformData = display->platformData;
+    platformData->multitouchEnabled = multitouchEnabled;
+}
+
+bool glfmGetMultitouchEnabled(const GLFMDisplay *display) {
+    GLFMPlatformData *platformData = display->platformData;
+    return platformData->multitouchEnabled;
+}
+
+bool glfmHasVirtualKeyboard(const GLFMDisplay *display) {
+    (void)display;
+    return false;
+}
+
+void glfmSetKeyboardVisible(GLFMDisplay *display, bool visible) {
+    (void)display;
+    (void)visible;
+    // Do nothing
+}
+
+bool glfmIsKeyboardVisible(const GLFMDisplay *display) {
+    (void)display;
+    return false;
+}
+
+GLFMProc glfmGetProcAddress(const char *functionName) {
+    return (GLFMProc)eglGetProcAddress(functionName);
+}
+
+bool glfmIsSensorAvailable(const GLFMDisplay *display, GLFMSensor sensor) {
+    (void)display;
+    (void)sensor;
+    return false;
+}
+
+bool glfmIsHapticFeedbackSupported(const GLFMDisplay *display) {
+    (void)display;
+    return false;
+}
+
+void glfmPerformHapticFeedback(GLFMDisplay *display, GLFMHapticFeedbackStyle style) {
+    (void)display;
+    (void)style;
+    // Do nothing
+}
+
+#if GLFM_FEATURE_CLIPBOARD
+
+bool glfmHasClipboardText(const GLFMDisplay *display) {
+    GLFMPlatformData *platformData = display->platformData;
+    return platformData->clipboardText != NULL;
+}
+
+void glfmRequestClipboardText(GLFMDisplay *display, GLFMClipboardTextFunc clipboardTextFunc) {
+    if (clipboardTextFunc) {
+        GLFMPlatformData *platformData = display->platformData;
+        clipboardTextFunc(display, platformData->clipboardText);
+    }
+}
+
+bool glfmSetClipboardText(GLFMDisplay *display, const char *string) {
+    if (!display || !string) {
+        return false;
+    }
+    GLFMPlatformData *platformData = display->platformData;
+    size_t length = strlen(string);
+    char *clipboardText = malloc(length + 1);
+    if (!clipboardText) {
+        return false;
+    }
+    memcpy(clipboardText, string, length + 1);
+    free(platformData->clipboardText);
+    platformData->clipboardText = clipboardText;
+    return true;
+}
+
+#else
+
+bool glfmHasClipboardText(const GLFMDisplay *display) {
+    (void)display;
+    return false;
+}
+
+void glfmRequestClipboardText(GLFMDisplay *display, GLFMClipboardTextFunc clipboardTextFunc) {
+    if (clipboardTextFunc) {
+        clipboardTextFunc(display, NULL);
+    }
+}
+
+bool glfmSetClipboardText(GLFMDisplay *display, const char *string) {
+    (void)display;
+    (void)string;
+    return false;
+}
+
+#endif // GLFM_FEATURE_CLIPBOARD
+
+bool glfmGetWebContextInfo(const GLFMDisplay *display, GLFMWebContextInfo *info) {
+    (void)display;
+    (void)info;
+    return false;
+}
+
+void glfmRequestAsset(GLFMDisplay *display, const char *path, GLFMAssetFunc assetFunc) {
+    // Assets are read from the working directory
+    if (display && path && assetFunc) {
+        assetFunc(display, path, true);
+    }
+}
+
+// MARK: - Platform-specific functions
+
+bool glfmIsMetalSupported(const GLFMDisplay *display) {
+    (void)display;
+    return false;
+}
+
+#endif // __linux__
@@ -0,0 +1,1283 @@
+// GLFM
+// https://github.com/brackeen/glfm
+
+#ifndef GLFM_TEXTURE_H
+#define GLFM_TEXTURE_H
+
+// Texture encoding and upload, shared by all backends. Each backend includes this file after
+// glfm_jobs.h.
+//
+// RGBA8 images are encoded at load time to a GPU block format: BC1 and BC3 (S3TC), ETC2 RGB8 and
+// ETC2 RGBA8 (EAC alpha), or ASTC 4x4. The encoders are single-pass encoders for load time, not for
+// offline asset pipelines. The mip chain is built with a box filter, and the block rows of every
+// level are encoded in parallel with glfmParallelFor(), so encoding uses every job worker.
+//
+// KTX2 files (GLFM_FEATURE_KTX2) are read from memory. Files in a block format are used as-is, and
+// RGBA8 files are encoded like RGBA8 images. Levels compressed with zlib are inflated if GLFM was
+// built with zlib. Basis Universal and Zstandard supercompression aren't supported.
+
+#include "glfm_internal.h"
+#include "glfm_jobs.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#if GLFM_FEATURE_KTX2 && GLFM_HAS_ZLIB
+#  include <zlib.h>
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef GLFM_HAS_ZLIB
+#define GLFM_HAS_ZLIB 0
+#endif
+
+#define GLFM_TEXTURE_MAX_LEVELS 16 // The size of GLFMTexture.levels
+#define GLFM_TEXTURE_MAX_SIZE 16384
+
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+#ifndef GL_COMPRESSED_RGB8_ETC2
+#define GL_COMPRESSED_RGB8_ETC2 0x9274
+#endif
+#ifndef GL_COMPRESSED_RGBA8_ETC2_EAC
+#define GL_COMPRESSED_RGBA8_ETC2_EAC 0x9278
+#endif
+#ifndef GL_COMPRESSED_RGBA_ASTC_4x4_KHR
+#define GL_COMPRESSED_RGBA_ASTC_4x4_KHR 0x93B0
+#endif
+
+struct GLFMTextureJob {
+    GLFMJobCounter *counter;
+    const uint8_t *rgba;
+    int width;
+    int height;
+    bool mipmaps;
+    const void *ktx2Data;
+    size_t ktx2Size;
+    GLFMTextureFormat format;
+    bool success;
+    GLFMTexture texture;
+};
+
+// MARK: - Formats
+
+static bool glfm__textureFormatIsValid(GLFMTextureFormat format) {
+    return format >= GLFMTextureFormatRGBA8 && format <= GLFMTextureFormatASTC4x4;
+}
+
+static size_t glfm__textureLevelSize(GLFMTextureFormat format, int width, int height) {
+    const size_t blockCount = (size_t)((width + 3) / 4) * (size_t)((height + 3) / 4);
+    switch (format) {
+        case GLFMTextureFormatBC1:
+        case GLFMTextureFormatETC2RGB8:
+            return blockCount * 8;
+        case GLFMTextureFormatBC3:
+        case GLFMTextureFormatETC2RGBA8:
+        case GLFMTextureFormatASTC4x4:
+            return blockCount * 16;
+        case GLFMTextureFormatRGBA8:
+        default:
+            return (size_t)width * (size_t)height * 4;
+    }
+}
+
+/// Queries the formats of the current context. Returns 0 if there is no current context.
+static uint32_t glfm__textureQueryFormats(GLFMDisplay *display) {
+    const char *version = (const char *)glGetString(GL_VERSION);
+    if (display->vulkan || !version) {
+        return 0;
+    }
+    uint32_t formats = 1u << GLFMTextureFormatRGBA8;
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_COMPRESSED_TEXTURE_FORMATS, &count);
+    if (count > 0) {
+        GLint *list = (GLint *)calloc((size_t)count, sizeof(GLint));
+        if (list) {
+            glGetIntegerv(GL_COMPRESSED_TEXTURE_FORMATS, list);
+            for (GLint i = 0; i < count; i++) {
+                switch (list[i]) {
+                    case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+                        formats |= 1u << GLFMTextureFormatBC1;
+                        break;
+                    case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+                        formats |= 1u << GLFMTextureFormatBC3;
+                        break;
+                    case GL_COMPRESSED_RGB8_ETC2:
+                        formats |= 1u << GLFMTextureFormatETC2RGB8;
+                        break;
+                    case GL_COMPRESSED_RGBA8_ETC2_EAC:
+                        formats |= 1u << GLFMTextureFormatETC2RGBA8;
+                        break;
+                    case GL_COMPRESSED_RGBA_ASTC_4x4_KHR:
+                        formats |= 1u << GLFMTextureFormatASTC4x4;
+                        break;
+                    default:
+                        break;
+                }
+            }
+            free(list);
+        }
+    }
+#if defined(__APPLE__) && TARGET_OS_OSX
+    // OpenGL 3.2 core profile, where GL_EXTENSIONS isn't a valid string, and the list is complete
+#else
+#if !defined(__EMSCRIPTEN__)
+    // ETC2 is core in OpenGL ES 3.0, but some drivers don't list it. (In WebGL 2, it isn't core.)
+    if (strncmp(version, "OpenGL ES ", 10) == 0 && version[10] >= '3') {
+        formats |= (1u << GLFMTextureFormatETC2RGB8) | (1u << GLFMTextureFormatETC2RGBA8);
+    }
+#endif
+    // S3TC extensions that predate the compressed formats list
+    const char *extensions = (const char *)glGetString(GL_EXTENSIONS);
+    if (extensions && (strstr(extensions, "texture_compression_s3tc") ||
+                       strstr(extensions, "compressed_texture_s3tc"))) {
+        formats |= (1u << GLFMTextureFormatBC1) | (1u << GLFMTextureFormatBC3);
+    }
+#endif
+    return formats;
+}
+
+uint32_t glfmGetSupportedTextureFormats(GLFMDisplay *display) {
+    if (!display) {
+        return 0;
+    }
+    if (display->textureFormats == 0) {
+        display->textureFormats = glfm__textureQueryFormats(display);
+    }
+    return display->textureFormats | (1u << GLFMTextureFormatRGBA8);
+}
+
+GLFMTextureFormat glfmGetPreferredTextureFormat(uint32_t supportedFormats, bool hasAlpha) {
+    // S3TC is preferred, because desktop drivers often emulate ETC2 and ASTC by decompressing them,
+    // which saves no memory. ASTC 4x4 is 8 bits per pixel, twice ETC2 RGB8, so for opaque textures
+    // it is the last choice.
+    static const GLFMTextureFormat opaqueFormats[] = {
+        GLFMTextureFormatBC1, GLFMTextureFormatETC2RGB8, GLFMTextureFormatASTC4x4,
+    };
+    static const GLFMTextureFormat alphaFormats[] = {
+        GLFMTextureFormatBC3, GLFMTextureFormatASTC4x4, GLFMTextureFormatETC2RGBA8,
+    };
+    const GLFMTextureFormat *formats = hasAlpha ? alphaFormats : opaqueFormats;
+    for (int i = 0; i < 3; i++) {
+        if (supportedFormats & (1u << formats[i])) {
+            return formats[i];
+        }
+    }
+    return GLFMTextureFormatRGBA8;
+}
+
+const char *glfmGetTextureFormatName(GLFMTextureFormat format) {
+    switch (format) {
+        case GLFMTextureFormatRGBA8: return "RGBA8";
+        case GLFMTextureFormatETC2RGB8: return "ETC2 RGB8";
+        case GLFMTextureFormatETC2RGBA8: return "ETC2 RGBA8";
+        case GLFMTextureFormatBC1: return "BC1";
+        case GLFMTextureFormatBC3: return "BC3";
+        case GLFMTextureFormatASTC4x4: return "ASTC 4x4";
+        default: return "Unknown";
+    }
+}
+
+// MARK: - Block encoders
+
+static int glfm__clamp255(int value) {
+    return value < 0 ? 0 : (value > 255 ? 255 : value);
+}
+
+static int glfm__roundClamp255(float value) {
+    return glfm__clamp255((int)(value + 0.5f));
+}
+
+/// Reads a 4x4 block, clamping to the image edge.
+static void glfm__readBlock(const uint8_t *rgba, int width, int height, int bx, int by,
+                            uint8_t block[16][4]) {
+    for (int y = 0; y < 4; y++) {
+        const int sy = by + y < height ? by + y : height - 1;
+        for (int x = 0; x < 4; x++) {
+            const int sx = bx + x < width ? bx + x : width - 1;
+            memcpy(block[y * 4 + x], rgba + ((size_t)sy * (size_t)width + (size_t)sx) * 4, 4);
+        }
+    }
+}
+
+/// Fits endpoints to the pixels of a block by least squares, given each pixel's position between
+/// the endpoints, from 0 (`e0`) to 1 (`e1`). Returns false if every pixel has the same position.
+static bool glfm__fitEndpoints(const uint8_t block[16][4], const float positions[16],
+                               int channelCount, int e0[4], int e1[4]) {
+    float a = 0.0f, b = 0.0f, c = 0.0f;
+    float x0[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+    float x1[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+    for (int i = 0; i < 16; i++) {
+        const float f = positions[i];
+        a += (1.0f - f) * (1.0f - f);
+        b += (1.0f - f) * f;
+        c += f * f;
+        for (int ch = 0; ch < channelCount; ch++) {
+            x0[ch] += (1.0f - f) * block[i][ch];
+            x1[ch] += f * block[i][ch];
+        }
+    }
+    const float determinant = a * c - b * b;
+    if (determinant < 1e-6f) {
+        return false;
+    }
+    for (int ch = 0; ch < channelCount; ch++) {
+        e0[ch] = glfm__roundClamp255((c * x0[ch] - b * x1[ch]) / determinant);
+        e1[ch] = glfm__roundClamp255((a * x1[ch] - b * x0[ch]) / determinant);
+    }
+    return true;
+}
+
+// MARK: BC1, BC3
+
+static uint16_t glfm__pack565(const int rgb[3]) {
+    return (uint16_t)(((rgb[0] * 31 + 127) / 255) << 11 | ((rgb[1] * 63 + 127) / 255) << 5 |
+                      ((rgb[2] * 31 + 127) / 255));
+}
+
+static void glfm__unpack565(uint16_t c, int rgb[3]) {
+    const int r = (c >> 11) & 31;
+    const int g = (c >> 5) & 63;
+    const int b = c & 31;
+    rgb[0] = (r << 3) | (r >> 2);
+    rgb[1] = (g << 2) | (g >> 4);
+    rgb[2] = (b << 3) | (b >> 2);
+}
+
+/// Chooses the four-color mode palette entry of each pixel, for endpoints `c0 > c1`. Returns the
+/// squared error.
+static int glfm__bc1Indices(const uint8_t block[16][4], uint16_t c0, uint16_t c1,
+                            uint32_t *indices) {
+    int palette[4][3];
+    glfm__unpack565(c0, palette[0]);
+    glfm__unpack565(c1, palette[1]);
+    for (int c = 0; c < 3; c++) {
+        palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+        palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+    }
+    int error = 0;
+    *indices = 0;
+    for (int i = 0; i < 16; i++) {
+        int best = 0;
+        int bestError = 0x7fffffff;
+        for (int p = 0; p < 4; p++) {
+            const int dr = block[i][0] - palette[p][0];
+            const int dg = block[i][1] - palette[p][1];
+            const int db = block[i][2] - palette[p][2];
+            const int pixelError = dr * dr + dg * dg + db * db;
+            if (pixelError < bestError) {
+                bestError = pixelError;
+                best = p;
+            }
+        }
+        error += bestError;
+        *indices |= (uint32_t)best << (i * 2);
+    }
+    return error;
+}
+
+/// Encodes the color of a block in four-color mode. Endpoints start at the corners of the color
+/// bounding box, along the diagonal that best matches the colors' correlation, and are then refit
+/// to the chosen palette entries, which makes blocks of two colors exact.
+static void glfm__encodeBC1(const uint8_t block[16][4], uint8_t *out) {
+    int min[3] = { 255, 255, 255 };
+    int max[3] = { 0, 0, 0 };
+    int mean[3] = { 0, 0, 0 };
+    for (int i = 0; i < 16; i++) {
+        for (int c = 0; c < 3; c++) {
+            min[c] = block[i][c] < min[c] ? block[i][c] : min[c];
+            max[c] = block[i][c] > max[c] ? block[i][c] : max[c];
+            mean[c] += block[i][c];
+        }
+    }
+    for (int c = 0; c < 3; c++) {
+        mean[c] = (mean[c] + 8) / 16;
+    }
+    // Flip green and blue on the diagonal if they are anti-correlated with red (or with green,
+    // if red is flat).
+    int covRG = 0, covRB = 0, covGB = 0;
+    for (int i = 0; i < 16; i++) {
+        const int r = block[i][0] - mean[0];
+        const int g = block[i][1] - mean[1];
+        const int b = block[i][2] - mean[2];
+        covRG += r * g;
+        covRB += r * b;
+        covGB += g * b;
+    }
+    if (max[0] > min[0]) {
+        if (covRG < 0) {
+            int t = min[1]; min[1] = max[1]; max[1] = t;
+        }
+        if (covRB < 0) {
+            int t = min[2]; min[2] = max[2]; max[2] = t;
+        }
+    } else if (covGB < 0) {
+        int t = min[2]; min[2] = max[2]; max[2] = t;
+    }
+    // Inset the box slightly, which reduces the error of the interpolated colors
+    for (int c = 0; c < 3; c++) {
+        const int inset = (max[c] - min[c]) / 16;
+        min[c] = glfm__clamp255(min[c] + inset);
+        max[c] = glfm__clamp255(max[c] - inset);
+    }
+
+    uint16_t c0 = glfm__pack565(max);
+    uint16_t c1 = glfm__pack565(min);
+    uint32_t indices = 0;
+    if (c0 != c1) {
+        if (c0 < c1) {
+            uint16_t t = c0; c0 = c1; c1 = t;
+        }
+        int error = glfm__bc1Indices(block, c0, c1, &indices);
+
+        // Refit. Palette entries 0 to 3 are at 0, 1, 1/3, and 2/3 of the way from c0 to c1.
+        static const float entryPositions[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+        float positions[16];
+        for (int i = 0; i < 16; i++) {
+            positions[i] = entryPositions[(indices >> (i * 2)) & 3];
+        }
+        int e0[4], e1[4];
+        if (error > 0 && glfm__fitEndpoints(block, positions, 3, e0, e1)) {
+            uint16_t fit0 = glfm__pack565(e0);
+            uint16_t fit1 = glfm__pack565(e1);
+            if (fit0 < fit1) {
+                uint16_t t = fit0; fit0 = fit1; fit1 = t;
+            }
+            uint32_t fitIndices = 0;
+            if (fit0 != fit1 && glfm__bc1Indices(block, fit0, fit1, &fitIndices) < error) {
+                c0 = fit0;
+                c1 = fit1;
+                indices = fitIndices;
+            }
+        }
+    }
+    out[0] = (uint8_t)(c0 & 0xff);
+    out[1] = (uint8_t)(c0 >> 8);
+    out[2] = (uint8_t)(c1 & 0xff);
+    out[3] = (uint8_t)(c1 >> 8);
+    for (int i = 0; i < 4; i++) {
+        out[4 + i] = (uint8_t)(indices >> (i * 8));
+    }
+}
+
+/// Encodes the alpha of a block in eight-value mode, with the minimum and maximum as endpoints.
+static void glfm__encodeBC3Alpha(const uint8_t block[16][4], uint8_t *out) {
+    int a0 = 0;
+    int a1 = 255;
+    for (int i = 0; i < 16; i++) {
+        a0 = block[i][3] > a0 ? block[i][3] : a0;
+        a1 = block[i][3] < a1 ? block[i][3] : a1;
+    }
+    uint64_t indices = 0;
+    if (a0 != a1) {
+        int palette[8];
+        palette[0] = a0;
+        palette[1] = a1;
+        for (int p = 1; p < 7; p++) {
+            palette[p + 1] = ((7 - p) * a0 + p * a1) / 7;
+        }
+        for (int i = 0; i < 16; i++) {
+            int best = 0;
+            int bestError = 256;
+            for (int p = 0; p < 8; p++) {
+                const int error = abs(block[i][3] - palette[p]);
+                if (error < bestError) {
+                    bestError = error;
+                    best = p;
+                }
+            }
+            indices |= (uint64_t)best << (i * 3);
+        }
+    }
+    out[0] = (uint8_t)a0;
+    out[1] = (uint8_t)a1;
+    for (int i = 0; i < 6; i++) {
+        out[2 + i] = (uint8_t)(indices >> (i * 8));
+    }
+}
+
+// MARK: ETC2
+
+static const int glfm__etcModifiers[8][4] = {
+    { 2, 8, -2, -8 }, { 5, 17, -5, -17 }, { 9, 29, -9, -29 }, { 13, 42, -13, -42 },
+    { 18, 60, -18, -60 }, { 24, 80, -24, -80 }, { 33, 106, -33, -106 }, { 47, 183, -47, -183 },
+};
+
+static const int glfm__eacModifiers[16][8] = {
+    { -3, -6, -9, -15, 2, 5, 8, 14 }, { -3, -7, -10, -13, 2, 6, 9, 12 },
+    { -2, -5, -8, -13, 1, 4, 7, 12 }, { -2, -4, -6, -13, 1, 3, 5, 12 },
+    { -3, -6, -8, -12, 2, 5, 7, 11 }, { -3, -7, -9, -11, 2, 6, 8, 10 },
+    { -4, -7, -8, -11, 3, 6, 7, 10 }, { -3, -5, -8, -11, 2, 4, 7, 10 },
+    { -2, -6, -8, -10, 1, 5, 7, 9 }, { -2, -5, -8, -10, 1, 4, 7, 9 },
+    { -2, -4, -8, -10, 1, 3, 7, 9 }, { -2, -5, -7, -10, 1, 4, 6, 9 },
+    { -3, -4, -7, -10, 2, 3, 6, 9 }, { -1, -2, -3, -10, 0, 1, 2, 9 },
+    { -4, -6, -8, -9, 3, 5, 7, 8 }, { -3, -5, -7, -9, 2, 4, 6, 8 },
+};
+
+/// Chooses the modifier table and pixel indices of one ETC sub-block for a base color.
+/// Pixels are identified by their ETC index (x * 4 + y). Returns the squared error.
+static int glfm__etcFitSubblock(const uint8_t block[16][4], const int pixels[8], const int base[3],
+                                int *table, uint32_t *indices) {
+    int bestError = 0x7fffffff;
+    for (int t = 0; t < 8; t++) {
+        int error = 0;
+        uint32_t tableIndices = 0;
+        for (int i = 0; i < 8 && error < bestError; i++) {
+            const int k = pixels[i];
+            const uint8_t *pixel = block[(k & 3) * 4 + (k >> 2)];
+            int bestPixelError = 0x7fffffff;
+            int bestIndex = 0;
+            for (int m = 0; m < 4; m++) {
+                const int modifier = glfm__etcModifiers[t][m];
+                const int dr = pixel[0] - glfm__clamp255(base[0] + modifier);
+                const int dg = pixel[1] - glfm__clamp255(base[1] + modifier);
+                const int db = pixel[2] - glfm__clamp255(base[2] + modifier);
+                const int pixelError = dr * dr + dg * dg + db * db;
+                if (pixelError < bestPixelError) {
+                    bestPixelError = pixelError;
+                    bestIndex = m;
+                }
+            }
+            error += bestPixelError;
+            // MSB at bit 16 + k, LSB at bit k
+            tableIndices |= (uint32_t)(bestIndex >> 1) << (16 + k);
+            tableIndices |= (uint32_t)(bestIndex & 1) << k;
+        }
+        if (error < bestError) {
+            bestError = error;
+            *table = t;
+            *indices = tableIndices;
+        }
+    }
+    return bestError;
+}
+
+/// Tries the individual and differential modes for the target base colors of the two sub-blocks.
+/// Updates `bestBits` if the error is less than `bestError`.
+static void glfm__etcTryBaseColors(const uint8_t block[16][4], const int pixels[2][8],
+                                   const int target[2][3], int flip, int *bestError,
+                                   uint64_t *bestBits) {
+    for (int differential = 1; differential >= 0; differential--) {
+        int quantized[2][3];
+        int base[2][3];
+        for (int s = 0; s < 2; s++) {
+            for (int c = 0; c < 3; c++) {
+                if (differential) {
+                    quantized[s][c] = (target[s][c] * 31 + 127) / 255;
+                    base[s][c] = (quantized[s][c] << 3) | (quantized[s][c] >> 2);
+                } else {
+                    quantized[s][c] = (target[s][c] * 15 + 127) / 255;
+                    base[s][c] = (quantized[s][c] << 4) | quantized[s][c];
+                }
+            }
+        }
+        if (differential) {
+            bool valid = true;
+            for (int c = 0; c < 3; c++) {
+                const int delta = quantized[1][c] - quantized[0][c];
+                valid = valid && delta >= -4 && delta <= 3;
+            }
+            if (!valid) {
+                continue;
+            }
+        }
+        int tables[2];
+        uint32_t indices[2];
+        const int error = (glfm__etcFitSubblock(block, pixels[0], base[0], &tables[0], &indices[0]) +
+                           glfm__etcFitSubblock(block, pixels[1], base[1], &tables[1], &indices[1]));
+        if (error < *bestError) {
+            *bestError = error;
+            uint64_t bits = 0;
+            for (int c = 0; c < 3; c++) {
+                const int shift = 56 - c * 8;
+                if (differential) {
+                    const int delta = quantized[1][c] - quantized[0][c];
+                    bits |= (uint64_t)quantized[0][c] << (shift + 3);
+                    bits |= (uint64_t)(delta & 7) << shift;
+                } else {
+                    bits |= (uint64_t)quantized[0][c] << (shift + 4);
+                    bits |= (uint64_t)quantized[1][c] << shift;
+                }
+            }
+            bits |= (uint64_t)tables[0] << 37;
+            bits |= (uint64_t)tables[1] << 34;
+            bits |= (uint64_t)differential << 33;
+            bits |= (uint64_t)flip << 32;
+            bits |= indices[0] | indices[1];
+            *bestBits = bits;
+        }
+    }
+}
+
+/// Encodes the color of a block with the ETC1 individual and differential modes, which are valid
+/// ETC2. Both sub-block orientations are tried, with the base colors at the sub-block averages, and
+/// at the middle of the sub-blocks' ranges, which the largest modifiers reach for blocks of two
+/// distant colors.
+static void glfm__encodeETC2RGB(const uint8_t block[16][4], uint8_t *out) {
+    uint64_t bestBits = 0;
+    int bestError = 0x7fffffff;
+    for (int flip = 0; flip < 2; flip++) {
+        int pixels[2][8];
+        int sum[2][3] = { { 0, 0, 0 }, { 0, 0, 0 } };
+        int min[2][3] = { { 255, 255, 255 }, { 255, 255, 255 } };
+        int max[2][3] = { { 0, 0, 0 }, { 0, 0, 0 } };
+        int count[2] = { 0, 0 };
+        for (int x = 0; x < 4; x++) {
+            for (int y = 0; y < 4; y++) {
+                const int s = flip ? (y >= 2) : (x >= 2);
+                pixels[s][count[s]++] = x * 4 + y;
+                for (int c = 0; c < 3; c++) {
+                    const int value = block[y * 4 + x][c];
+                    sum[s][c] += value;
+                    min[s][c] = value < min[s][c] ? value : min[s][c];
+                    max[s][c] = value > max[s][c] ? value : max[s][c];
+                }
+            }
+        }
+        int averages[2][3];
+        int midpoints[2][3];
+        bool sameTargets = true;
+        for (int s = 0; s < 2; s++) {
+            for (int c = 0; c < 3; c++) {
+                averages[s][c] = (sum[s][c] + 4) / 8;
+                midpoints[s][c] = (min[s][c] + max[s][c] + 1) / 2;
+                sameTargets = sameTargets && averages[s][c] == midpoints[s][c];
+            }
+        }
+        glfm__etcTryBaseColors(block, (const int (*)[8])pixels, (const int (*)[3])averages, flip,
+                               &bestError, &bestBits);
+        if (!sameTargets && bestError > 0) {
+            glfm__etcTryBaseColors(block, (const int (*)[8])pixels, (const int (*)[3])midpoints,
+                                   flip, &bestError, &bestBits);
+        }
+    }
+    for (int i = 0; i < 8; i++) {
+        out[i] = (uint8_t)(bestBits >> (56 - i * 8));
+    }
+}
+
+/// Encodes the alpha of a block as EAC, searching every table with multipliers near the one that
+/// spans the block's alpha range.
+static void glfm__encodeEACAlpha(const uint8_t block[16][4], uint8_t *out) {
+    int min = 255;
+    int max = 0;
+    for (int i = 0; i < 16; i++) {
+        min = block[i][3] < min ? block[i][3] : min;
+        max = block[i][3] > max ? block[i][3] : max;
+    }
+    uint64_t bestBits = 0;
+    if (min == max) {
+        // Table 13 has a zero modifier at index 4
+        bestBits = (uint64_t)min << 56 | (uint64_t)1 << 52 | (uint64_t)13 << 48;
+        for (int k = 0; k < 16; k++) {
+            bestBits |= (uint64_t)4 << (45 - k * 3);
+        }
+    } else {
+        int bestError = 0x7fffffff;
+        for (int t = 0; t < 16; t++) {
+            const int span = glfm__eacModifiers[t][7] - glfm__eacModifiers[t][3];
+            const int center = (glfm__eacModifiers[t][7] + glfm__eacModifiers[t][3]);
+            const int estimate = (max - min + span / 2) / span;
+            for (int multiplier = estimate - 1; multiplier <= estimate + 1; multiplier++) {
+                if (multiplier < 1 || multiplier > 15) {
+                    continue;
+                }
+                const int base = glfm__clamp255((min + max - center * multiplier + 1) / 2);
+                int error = 0;
+                uint64_t indices = 0;
+                for (int k = 0; k < 16 && error < bestError; k++) {
+                    const int alpha = block[(k & 3) * 4 + (k >> 2)][3];
+                    int bestPixelError = 0x7fffffff;
+                    int bestIndex = 0;
+                    for (int m = 0; m < 8; m++) {
+                        const int d = alpha - glfm__clamp255(base + glfm__eacModifiers[t][m] * multiplier);
+                        if (d * d < bestPixelError) {
+                            bestPixelError = d * d;
+                            bestIndex = m;
+                        }
+                    }
+                    error += bestPixelError;
+                    indices |= (uint64_t)bestIndex << (45 - k * 3);
+                }
+                if (error < bestError) {
+                    bestError = error;
+                    bestBits = ((uint64_t)base << 56 | (uint64_t)multiplier << 52 |
+                                (uint64_t)t << 48 | indices);
+                }
+            }
+        }
+    }
+    for (int i = 0; i < 8; i++) {
+        out[i] = (uint8_t)(bestBits >> (56 - i * 8));
+    }
+}
+
+// MARK: ASTC
+
+// Unquantized weights, from 0 to 64, of the 3-bit (opaque blocks) and 2-bit (blocks with alpha)
+// weight ranges.
+static const int glfm__astcWeights3[8] = { 0, 9, 18, 27, 37, 46, 55, 64 };
+static const int glfm__astcWeights2[4] = { 0, 21, 43, 64 };
+
+/// Chooses the weight of each pixel for the endpoints. Returns the squared error.
+static int glfm__astcFitWeights(const uint8_t block[16][4], const int e0[4], const int e1[4],
+                                int channelCount, const int *weights, int weightCount,
+                                int indices[16]) {
+    int palette[8][4];
+    for (int w = 0; w < weightCount; w++) {
+        for (int c = 0; c < channelCount; c++) {
+            palette[w][c] = (e0[c] * (64 - weights[w]) + e1[c] * weights[w] + 32) >> 6;
+        }
+    }
+    int error = 0;
+    for (int i = 0; i < 16; i++) {
+        int bestError = 0x7fffffff;
+        for (int w = 0; w < weightCount; w++) {
+            int pixelError = 0;
+            for (int c = 0; c < channelCount; c++) {
+                const int d = block[i][c] - palette[w][c];
+                pixelError += d * d;
+            }
+            if (pixelError < bestError) {
+                bestError = pixelError;
+                indices[i] = w;
+            }
+        }
+        error += bestError;
+    }
+    return error;
+}
+
+static void glfm__astcWriteBits(uint8_t *out, int offset, int count, uint32_t value) {
+    for (int i = 0; i < count; i++) {
+        if ((value >> i) & 1) {
+            out[(offset + i) >> 3] |= (uint8_t)(1 << ((offset + i) & 7));
+        }
+    }
+}
+
+/// Encodes a block as ASTC 4x4, with one partition and a 4x4 weight grid. Opaque blocks use LDR RGB
+/// direct endpoints (CEM 8) with 3-bit weights, and blocks with alpha use LDR RGBA direct endpoints
+/// (CEM 12) with 2-bit weights. In both layouts, the endpoints get 8 bits each, so no integer
+/// sequence encoding is needed. The endpoints are the extremes of the block along its principal
+/// axis, refit to the chosen weights.
+static void glfm__encodeASTC(const uint8_t block[16][4], uint8_t *out) {
+    bool hasAlpha = false;
+    for (int i = 0; i < 16; i++) {
+        hasAlpha = hasAlpha || block[i][3] != 255;
+    }
+    const int channelCount = hasAlpha ? 4 : 3;
+    const int *weights = hasAlpha ? glfm__astcWeights2 : glfm__astcWeights3;
+    const int weightCount = hasAlpha ? 4 : 8;
+    const int weightBits = hasAlpha ? 2 : 3;
+
+    // Principal axis, by power iteration from the bounding box diagonal
+    float mean[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+    float axis[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+    int min[4] = { 255, 255, 255, 255 };
+    int max[4] = { 0, 0, 0, 0 };
+    for (int i = 0; i < 16; i++) {
+        for (int c = 0; c < channelCount; c++) {
+            mean[c] += block[i][c] / 16.0f;
+            min[c] = block[i][c] < min[c] ? block[i][c] : min[c];
+            max[c] = block[i][c] > max[c] ? block[i][c] : max[c];
+        }
+    }
+    float covariance[4][4] = { { 0.0f } };
+    for (int i = 0; i < 16; i++) {
+        for (int c = 0; c < channelCount; c++) {
+            for (int d = 0; d < channelCount; d++) {
+                covariance[c][d] += (block[i][c] - mean[c]) * (block[i][d] - mean[d]);
+            }
+        }
+    }
+    for (int c = 0; c < channelCount; c++) {
+        axis[c] = (float)(max[c] - min[c]);
+    }
+    for (int iteration = 0; iteration < 4; iteration++) {
+        float next[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+        float largest = 0.0f;
+        for (int c = 0; c < channelCount; c++) {
+            for (int d = 0; d < channelCount; d++) {
+                next[c] += covariance[c][d] * axis[d];
+            }
+            largest = next[c] > largest ? next[c] : (-next[c] > largest ? -next[c] : largest);
+        }
+        if (largest < 1e-3f) {
+            break;
+        }
+        for (int c = 0; c < channelCount; c++) {
+            axis[c] = next[c] / largest;
+        }
+    }
+    float lengthSquared = 0.0f;
+    for (int c = 0; c < channelCount; c++) {
+        lengthSquared += axis[c] * axis[c];
+    }
+    float tMin = 0.0f;
+    float tMax = 0.0f;
+    if (lengthSquared > 1e-6f) {
+        tMin = 1e9f;
+        tMax = -1e9f;
+        for (int i = 0; i < 16; i++) {
+            float t = 0.0f;
+            for (int c = 0; c < channelCount; c++) {
+                t += (block[i][c] - mean[c]) * axis[c];
+            }
+            tMin = t < tMin ? t : tMin;
+            tMax = t > tMax ? t : tMax;
+        }
+        tMin /= lengthSquared;
+        tMax /= lengthSquared;
+    }
+    int e0[4] = { 0, 0, 0, 255 };
+    int e1[4] = { 0, 0, 0, 255 };
+    for (int c = 0; c < channelCount; c++) {
+        e0[c] = glfm__roundClamp255(mean[c] + tMin * axis[c]);
+        e1[c] = glfm__roundClamp255(mean[c] + tMax * axis[c]);
+    }
+    int indices[16];
+    const int error = glfm__astcFitWeights(block, e0, e1, channelCount, weights, weightCount,
+                                           indices);
+    if (error > 0) {
+        float positions[16];
+        for (int i = 0; i < 16; i++) {
+            positions[i] = (float)weights[indices[i]] / 64.0f;
+        }
+        int fit0[4] = { 0, 0, 0, 255 };
+        int fit1[4] = { 0, 0, 0, 255 };
+        int fitIndices[16];
+        if (glfm__fitEndpoints(block, positions, channelCount, fit0, fit1) &&
+            glfm__astcFitWeights(block, fit0, fit1, channelCount, weights, weightCount,
+                                 fitIndices) < error) {
+            memcpy(e0, fit0, sizeof(e0));
+            memcpy(e1, fit1, sizeof(e1));
+            memcpy(indices, fitIndices, sizeof(indices));
+        }
+    }
+    // The decoder applies blue contraction if the RGB sum of e0 is greater than e1's, so swap them.
+    // The weights are symmetric, so reversing the indices keeps the colors.
+    if (e0[0] + e0[1] + e0[2] > e1[0] + e1[1] + e1[2]) {
+        for (int c = 0; c < 4; c++) {
+            int t = e0[c]; e0[c] = e1[c]; e1[c] = t;
+        }
+        for (int i = 0; i < 16; i++) {
+            indices[i] = weightCount - 1 - indices[i];
+        }
+    }
+
+    // Block mode: a 4x4 grid (A = 2, B = 0), one plane, with weight range 2 (2 bits) or 7 (3 bits)
+    memset(out, 0, 16);
+    glfm__astcWriteBits(out, 0, 11, hasAlpha ? 0x042 : 0x053);
+    // Partition count minus one (bits 11-12) is zero, followed by the endpoint mode
+    glfm__astcWriteBits(out, 13, 4, hasAlpha ? 12 : 8);
+    for (int c = 0; c < channelCount; c++) {
+        glfm__astcWriteBits(out, 17 + c * 16, 8, (uint32_t)e0[c]);
+        glfm__astcWriteBits(out, 17 + c * 16 + 8, 8, (uint32_t)e1[c]);
+    }
+    // Weights are written from the end of the block, bit-reversed
+    for (int i = 0; i < 16; i++) {
+        for (int b = 0; b < weightBits; b++) {
+            glfm__astcWriteBits(out, 127 - (i * weightBits + b), 1, (uint32_t)(indices[i] >> b));
+        }
+    }
+}
+
+// MARK: - Mipmaps and levels
+
+/// Sets the format, level sizes, and level offsets of a texture, and allocates its data. Each level
+/// is half the size of the one before it, until the level count is reached or a level is 1x1.
+static bool glfm__textureCreate(GLFMTexture *texture, GLFMTextureFormat format, int width,
+                                int height, int maxLevelCount) {
+    memset(texture, 0, sizeof(GLFMTexture));
+    texture->format = format;
+    int levelWidth = width;
+    int levelHeight = height;
+    size_t offset = 0;
+    while (texture->levelCount < maxLevelCount && texture->levelCount < GLFM_TEXTURE_MAX_LEVELS) {
+        GLFMTextureLevel *level = &texture->levels[texture->levelCount++];
+        level->width = levelWidth;
+        level->height = levelHeight;
+        level->offset = offset;
+        level->size = glfm__textureLevelSize(format, levelWidth, levelHeight);
+        offset += level->size;
+        texture->rgbaSize += (size_t)levelWidth * (size_t)levelHeight * 4;
+        if (levelWidth == 1 && levelHeight == 1) {
+            break;
+        }
+        levelWidth = levelWidth > 1 ? levelWidth / 2 : 1;
+        levelHeight = levelHeight > 1 ? levelHeight / 2 : 1;
+    }
+    texture->dataSize = offset;
+    texture->data = (uint8_t *)malloc(offset);
+    return texture->data != NULL;
+}
+
+typedef struct {
+    const uint8_t *src;
+    int width;
+    int height;
+    uint8_t *dst;
+} GLFMTextureDownsample;
+
+/// Downsamples rows of an RGBA8 image by half with a box filter.
+static void glfm__textureDownsampleRows(void *userData, int start, int end) {
+    const GLFMTextureDownsample *downsample = (const GLFMTextureDownsample *)userData;
+    const uint8_t *src = downsample->src;
+    const int width = downsample->width;
+    const int height = downsample->height;
+    const int dstWidth = width > 1 ? width / 2 : 1;
+    for (int y = start; y < end; y++) {
+        const int y0 = y * 2 < height ? y * 2 : height - 1;
+        const int y1 = y * 2 + 1 < height ? y * 2 + 1 : height - 1;
+        for (int x = 0; x < dstWidth; x++) {
+            const int x0 = x * 2 < width ? x * 2 : width - 1;
+            const int x1 = x * 2 + 1 < width ? x * 2 + 1 : width - 1;
+            const uint8_t *p00 = src + ((size_t)y0 * (size_t)width + (size_t)x0) * 4;
+            const uint8_t *p01 = src + ((size_t)y0 * (size_t)width + (size_t)x1) * 4;
+            const uint8_t *p10 = src + ((size_t)y1 * (size_t)width + (size_t)x0) * 4;
+            const uint8_t *p11 = src + ((size_t)y1 * (size_t)width + (size_t)x1) * 4;
+            uint8_t *dst = downsample->dst + ((size_t)y * (size_t)dstWidth + (size_t)x) * 4;
+            for (int c = 0; c < 4; c++) {
+                dst[c] = (uint8_t)((p00[c] + p01[c] + p10[c] + p11[c] + 2) / 4);
+            }
+        }
+    }
+}
+
+typedef struct {
+    GLFMTexture *texture;
+    const uint8_t *rgbaLevels[GLFM_TEXTURE_MAX_LEVELS];
+    // The first block row of each level, counting the block rows of every level before it
+    int firstBlockRows[GLFM_TEXTURE_MAX_LEVELS + 1];
+} GLFMTextureEncoder;
+
+/// Encodes block rows of every level. Rows are numbered across levels (see firstBlockRows), so
+/// that one parallel loop balances the work of the whole mip chain.
+static void glfm__textureEncodeRows(void *userData, int start, int end) {
+    const GLFMTextureEncoder *encoder = (const GLFMTextureEncoder *)userData;
+    const GLFMTexture *texture = encoder->texture;
+    const size_t blockSize = glfm__textureLevelSize(texture->format, 1, 1);
+    int levelIndex = 0;
+    for (int row = start; row < end; row++) {
+        while (row >= encoder->firstBlockRows[levelIndex + 1]) {
+            levelIndex++;
+        }
+        const GLFMTextureLevel *level = &texture->levels[levelIndex];
+        const int by = (row - encoder->firstBlockRows[levelIndex]) * 4;
+        const size_t blocksPerRow = (size_t)((level->width + 3) / 4);
+        uint8_t *out = texture->data + level->offset + (size_t)(by / 4) * blocksPerRow * blockSize;
+        uint8_t block[16][4];
+        for (int bx = 0; bx < level->width; bx += 4) {
+            glfm__readBlock(encoder->rgbaLevels[levelIndex], level->width, level->height, bx, by,
+                            block);
+            switch (texture->format) {
+                case GLFMTextureFormatBC1:
+                    glfm__encodeBC1((const uint8_t (*)[4])block, out);
+                    break;
+                case GLFMTextureFormatBC3:
+                    glfm__encodeBC3Alpha((const uint8_t (*)[4])block, out);
+                    glfm__encodeBC1((const uint8_t (*)[4])block, out + 8);
+                    break;
+                case GLFMTextureFormatETC2RGB8:
+                    glfm__encodeETC2RGB((const uint8_t (*)[4])block, out);
+                    break;
+                case GLFMTextureFormatETC2RGBA8:
+                    glfm__encodeEACAlpha((const uint8_t (*)[4])block, out);
+                    glfm__encodeETC2RGB((const uint8_t (*)[4])block, out + 8);
+                    break;
+                case GLFMTextureFormatASTC4x4:
+                    glfm__encodeASTC((const uint8_t (*)[4])block, out);
+                    break;
+                case GLFMTextureFormatRGBA8:
+                default:
+                    break;
+            }
+            out += blockSize;
+        }
+    }
+}
+
+/// Encodes every level of a texture created with glfm__textureCreate(). `rgbaLevels[i]` is the
+/// RGBA8 image of level `i`, or NULL to downsample it from the level before it. Level 0 must be set.
+static bool glfm__textureEncode(GLFMTexture *texture, const uint8_t *rgbaLevels[]) {
+    GLFMTextureEncoder encoder;
+    memset(&encoder, 0, sizeof(encoder));
+    encoder.texture = texture;
+
+    // Downsampled levels are written to the texture (RGBA8) or to scratch memory
+    const bool isRGBA8 = texture->format == GLFMTextureFormatRGBA8;
+    size_t scratchSize = 0;
+    for (int i = 0; i < texture->levelCount && !isRGBA8; i++) {
+        if (!rgbaLevels[i]) {
+            scratchSize += (size_t)texture->levels[i].width * (size_t)texture->levels[i].height * 4;
+        }
+    }
+    uint8_t *scratch = scratchSize > 0 ? (uint8_t *)malloc(scratchSize) : NULL;
+    if (scratchSize > 0 && !scratch) {
+        return false;
+    }
+    uint8_t *nextScratch = scratch;
+    for (int i = 0; i < texture->levelCount; i++) {
+        const GLFMTextureLevel *level = &texture->levels[i];
+        uint8_t *dst = isRGBA8 ? texture->data + level->offset : NULL;
+        if (rgbaLevels[i]) {
+            if (dst) {
+                memcpy(dst, rgbaLevels[i], level->size);
+            }
+        } else if (i > 0) {
+            if (!dst) {
+                dst = nextScratch;
+                nextScratch += (size_t)level->width * (size_t)level->height * 4;
+            }
+            GLFMTextureDownsample downsample = {
+                rgbaLevels[i - 1], texture->levels[i - 1].width, texture->levels[i - 1].height, dst
+            };
+            glfmParallelFor(level->height, 0, glfm__textureDownsampleRows, &downsample);
+            rgbaLevels[i] = dst;
+        }
+        encoder.rgbaLevels[i] = rgbaLevels[i];
+        encoder.firstBlockRows[i + 1] = encoder.firstBlockRows[i] + (level->height + 3) / 4;
+    }
+    if (!isRGBA8) {
+        glfmParallelFor(encoder.firstBlockRows[texture->levelCount], 0, glfm__textureEncodeRows,
+                        &encoder);
+    }
+    free(scratch);
+    return true;
+}
+
+bool glfmEncodeTexture(const uint8_t *rgba, int width, int height, GLFMTextureFormat format,
+                       bool mipmaps, GLFMTexture *texture) {
+    if (!texture) {
+        return false;
+    }
+    memset(texture, 0, sizeof(GLFMTexture));
+    if (!rgba || width <= 0 || height <= 0 || width > GLFM_TEXTURE_MAX_SIZE ||
+        height > GLFM_TEXTURE_MAX_SIZE || !glfm__textureFormatIsValid(format)) {
+        return false;
+    }
+    const double startTime = glfmGetTime();
+    if (!glfm__textureCreate(texture, format, width, height, mipmaps ? GLFM_TEXTURE_MAX_LEVELS : 1)) {
+        glfmFreeTexture(texture);
+        return false;
+    }
+    const uint8_t *rgbaLevels[GLFM_TEXTURE_MAX_LEVELS] = { rgba };
+    if (!glfm__textureEncode(texture, rgbaLevels)) {
+        glfmFreeTexture(texture);
+        return false;
+    }
+    texture->encodeTime = glfmGetTime() - startTime;
+    return true;
+}
+
+// MARK: - KTX2
+
+#if GLFM_FEATURE_KTX2
+
+// VkFormat values of the formats that can be loaded
+#define GLFM_VK_FORMAT_R8G8B8A8_UNORM 37
+#define GLFM_VK_FORMAT_BC1_RGB_UNORM_BLOCK 131
+#define GLFM_VK_FORMAT_BC3_UNORM_BLOCK 137
+#define GLFM_VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK 147
+#define GLFM_VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK 151
+#define GLFM_VK_FORMAT_ASTC_4x4_UNORM_BLOCK 157
+
+#define GLFM_KTX2_SUPERCOMPRESSION_NONE 0
+#define GLFM_KTX2_SUPERCOMPRESSION_ZLIB 3
+#define GLFM_KTX2_HEADER_SIZE 80
+#define GLFM_KTX2_LEVEL_INDEX_ENTRY_SIZE 24
+
+static uint32_t glfm__readLE32(const uint8_t *p) {
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static uint64_t glfm__readLE64(const uint8_t *p) {
+    return (uint64_t)glfm__readLE32(p) | (uint64_t)glfm__readLE32(p + 4) << 32;
+}
+
+static bool glfm__ktx2Format(uint32_t vkFormat, GLFMTextureFormat *format) {
+    switch (vkFormat) {
+        case GLFM_VK_FORMAT_R8G8B8A8_UNORM: *format = GLFMTextureFormatRGBA8; return true;
+        case GLFM_VK_FORMAT_BC1_RGB_UNORM_BLOCK: *format = GLFMTextureFormatBC1; return true;
+        case GLFM_VK_FORMAT_BC3_UNORM_BLOCK: *format = GLFMTextureFormatBC3; return true;
+        case GLFM_VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK: *format = GLFMTextureFormatETC2RGB8; return true;
+        case GLFM_VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK: *format = GLFMTextureFormatETC2RGBA8; return true;
+        case GLFM_VK_FORMAT_ASTC_4x4_UNORM_BLOCK: *format = GLFMTextureFormatASTC4x4; return true;
+        default: return false;
+    }
+}
+
+static bool glfm__loadKTX2(const uint8_t *data, size_t size, GLFMTextureFormat format,
+                           GLFMTexture *texture) {
+    static const uint8_t identifier[12] = {
+        0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A
+    };
+    if (!data || size < GLFM_KTX2_HEADER_SIZE || memcmp(data, identifier, sizeof(identifier)) != 0) {
+        return false;
+    }
+    GLFMTextureFormat fileFormat;
+    const uint32_t width = glfm__readLE32(data + 20);
+    const uint32_t height = glfm__readLE32(data + 24);
+    const uint32_t depth = glfm__readLE32(data + 28);
+    const uint32_t layerCount = glfm__readLE32(data + 32);
+    const uint32_t faceCount = glfm__readLE32(data + 36);
+    const uint32_t levelCount = glfm__readLE32(data + 40);
+    const uint32_t supercompression = glfm__readLE32(data + 44);
+    if (!glfm__ktx2Format(glfm__readLE32(data + 12), &fileFormat) || width == 0 || height == 0 ||
+        width > GLFM_TEXTURE_MAX_SIZE || height > GLFM_TEXTURE_MAX_SIZE || depth > 0 ||
+        layerCount > 1 || faceCount != 1 || levelCount > GLFM_TEXTURE_MAX_LEVELS) {
+        return false;
+    }
+#if GLFM_HAS_ZLIB
+    if (supercompression != GLFM_KTX2_SUPERCOMPRESSION_NONE &&
+        supercompression != GLFM_KTX2_SUPERCOMPRESSION_ZLIB) {
+        return false;
+    }
+#else
+    if (supercompression != GLFM_KTX2_SUPERCOMPRESSION_NONE) {
+        return false;
+    }
+#endif
+    const uint32_t fileLevelCount = levelCount > 0 ? levelCount : 1;
+    if (size < GLFM_KTX2_HEADER_SIZE + (size_t)fileLevelCount * GLFM_KTX2_LEVEL_INDEX_ENTRY_SIZE) {
+        return false;
+    }
+
+    // RGBA8 files are encoded to `format`, with a full mip chain if the file has a level count of
+    // zero. Block-compressed files are used as-is.
+    const bool encode = fileFormat == GLFMTextureFormatRGBA8;
+    const GLFMTextureFormat textureFormat = encode ? format : fileFormat;
+    int maxLevelCount = (int)fileLevelCount;
+    if (encode && levelCount == 0) {
+        maxLevelCount = GLFM_TEXTURE_MAX_LEVELS;
+    }
+    if (!glfm__textureCreate(texture, textureFormat, (int)width, (int)height, maxLevelCount) ||
+        texture->levelCount < (int)fileLevelCount) {
+        return false;
+    }
+
+    // Check the level index, and find the size of the levels when inflated
+    size_t inflatedSize = 0;
+    for (uint32_t i = 0; i < fileLevelCount; i++) {
+        const uint8_t *entry = data + GLFM_KTX2_HEADER_SIZE + i * GLFM_KTX2_LEVEL_INDEX_ENTRY_SIZE;
+        const uint64_t offset = glfm__readLE64(entry);
+        const uint64_t length = glfm__readLE64(entry + 8);
+        const uint64_t uncompressedLength = glfm__readLE64(entry + 16);
+        const GLFMTextureLevel *level = &texture->levels[i];
+        if (offset > size || length > size - offset ||
+            uncompressedLength != glfm__textureLevelSize(fileFormat, level->width, level->height) ||
+            (supercompression == GLFM_KTX2_SUPERCOMPRESSION_NONE && length != uncompressedLength)) {
+            return false;
+        }
+        inflatedSize += (size_t)uncompressedLength;
+    }
+    uint8_t *inflated = NULL;
+    if (supercompression != GLFM_KTX2_SUPERCOMPRESSION_NONE) {
+        inflated = (uint8_t *)malloc(inflatedSize);
+        if (!inflated) {
+            return false;
+        }
+    }
+
+    const uint8_t *rgbaLevels[GLFM_TEXTURE_MAX_LEVELS] = { NULL };
+#if GLFM_HAS_ZLIB
+    uint8_t *nextInflated = inflated;
+#endif
+    bool success = true;
+    for (uint32_t i = 0; i < fileLevelCount && success; i++) {
+        const uint8_t *entry = data + GLFM_KTX2_HEADER_SIZE + i * GLFM_KTX2_LEVEL_INDEX_ENTRY_SIZE;
+        const uint64_t offset = glfm__readLE64(entry);
+        const uint64_t uncompressedLength = glfm__readLE64(entry + 16);
+        const uint8_t *levelData = data + (size_t)offset;
+#if GLFM_HAS_ZLIB
+        if (inflated) {
+            const uint64_t length = glfm__readLE64(entry + 8);
+            uLongf inflatedLength = (uLongf)uncompressedLength;
+            success = (uncompress(nextInflated, &inflatedLength, levelData, (uLong)length) == Z_OK &&
+                       inflatedLength == uncompressedLength);
+            levelData = nextInflated;
+            nextInflated += (size_t)uncompressedLength;
+        }
+#endif
+        if (encode) {
+            rgbaLevels[i] = levelData;
+        } else {
+            memcpy(texture->data + texture->levels[i].offset, levelData, (size_t)uncompressedLength);
+        }
+    }
+    if (success && encode) {
+        success = glfm__textureEncode(texture, rgbaLevels);
+    }
+    free(inflated);
+    return success;
+}
+
+bool glfmLoadKTX2Texture(const void *data, size_t size, GLFMTextureFormat format,
+                         GLFMTexture *texture) {
+    if (!texture) {
+        return false;
+    }
+    memset(texture, 0, sizeof(GLFMTexture));
+    if (!glfm__textureFormatIsValid(format)) {
+        return false;
+    }
+    const double startTime = glfmGetTime();
+    if (!glfm__loadKTX2((const uint8_t *)data, size, format, texture)) {
+        glfmFreeTexture(texture);
+        return false;
+    }
+    texture->encodeTime = glfmGetTime() - startTime;
+    return true;
+}
+
+#else
+
+bool glfmLoadKTX2Texture(const void *data, size_t size, GLFMTextureFormat format,
+                         GLFMTexture *texture) {
+    (void)data;
+    (void)size;
+    (void)format;
+    if (texture) {
+        memset(texture, 0, sizeof(GLFMTexture));
+    }
+    return false;
+}
+
+#endif // GLFM_FEATURE_KTX2
+
+// MARK: - Jobs
+
+static void glfm__textureJobRun(void *userData) {
+    GLFMTextureJob *job = (GLFMTextureJob *)userData;
+    if (job->ktx2Data) {
+        job->success = glfmLoadKTX2Texture(job->ktx2Data, job->ktx2Size, job->format, &job->texture);
+    } else {
+        job->success = glfmEncodeTexture(job->rgba, job->width, job->height, job->format,
+                                         job->mipmaps, &job->texture);
+    }
+}
+
+static GLFMTextureJob *glfm__textureJobStart(GLFMTextureJob *job) {
+    job->counter = glfmCreateJobCounter();
+    if (!job->counter) {
+        free(job);
+        return NULL;
+    }
+    glfmRunJob(glfm__textureJobRun, job, job->counter);
+    return job;
+}
+
+GLFMTextureJob *glfmEncodeTextureAsync(const uint8_t *rgba, int width, int height,
+                                       GLFMTextureFormat format, bool mipmaps) {
+    if (!rgba) {
+        return NULL;
+    }
+    GLFMTextureJob *job = (GLFMTextureJob *)calloc(1, sizeof(GLFMTextureJob));
+    if (!job) {
+        return NULL;
+    }
+    job->rgba = rgba;
+    job->width = width;
+    job->height = height;
+    job->format = format;
+    job->mipmaps = mipmaps;
+    return glfm__textureJobStart(job);
+}
+
+GLFMTextureJob *glfmLoadKTX2TextureAsync(const void *data, size_t size, GLFMTextureFormat format) {
+#if GLFM_FEATURE_KTX2
+    if (!data) {
+        return NULL;
+    }
+    GLFMTextureJob *job = (GLFMTextureJob *)calloc(1, sizeof(GLFMTextureJob));
+    if (!job) {
+        return NULL;
+    }
+    job->ktx2Data = data;
+    job->ktx2Size = size;
+    job->format = format;
+    return glfm__textureJobStart(job);
+#else
+    (void)data;
+    (void)size;
+    (void)format;
+    return NULL;
+#endif
+}
+
+bool glfmIsTextureJobComplete(const GLFMTextureJob *job) {
+    return !job || glfmIsJobCounterComplete(job->counter);
+}
+
+bool glfmFinishTextureJob(GLFMTextureJob *job, GLFMTexture *texture) {
+    if (!job) {
+        if (texture) {
+            memset(texture, 0, sizeof(GLFMTexture));
+        }
+        return false;
+    }
+    glfmDestroyJobCounter(job->counter);
+    const bool success = job->success;
+    if (success && texture) {
+        *texture = job->texture;
+    } else {
+        glfmFreeTexture(&job->texture);
+        if (texture) {
+            memset(texture, 0, sizeof(GLFMTexture));
+        }
+    }
+    free(job);
+    return success && texture;
+}
+
+// MARK: - Upload
+
+bool glfmUploadTexture(const GLFMTexture *texture) {
+    if (!texture || !texture->data) {
+        return false;
+    }
+    GLenum internalFormat = 0;
+    switch (texture->format) {
+        case GLFMTextureFormatBC1: internalFormat = GL_COMPRESSED_RGB_S3TC_DXT1_EXT; break;
+        case GLFMTextureFormatBC3: internalFormat = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT; break;
+        case GLFMTextureFormatETC2RGB8: internalFormat = GL_COMPRESSED_RGB8_ETC2; break;
+        case GLFMTextureFormatETC2RGBA8: internalFormat = GL_COMPRESSED_RGBA8_ETC2_EAC; break;
+        case GLFMTextureFormatASTC4x4: internalFormat = GL_COMPRESSED_RGBA_ASTC_4x4_KHR; break;
+        case GLFMTextureFormatRGBA8:
+        default:
+            break;
+    }
+    while (glGetError() != GL_NO_ERROR) { }
+    for (int i = 0; i < texture->levelCount; i++) {
+        const GLFMTextureLevel *level = &texture->levels[i];
+        if (internalFormat == 0) {
+            glTexImage2D(GL_TEXTURE_2D, i, GL_RGBA, level->width, level->height, 0, GL_RGBA,
+                         GL_UNSIGNED_BYTE, texture->data + level->offset);
+        } else {
+            glCompressedTexImage2D(GL_TEXTURE_2D, i, internalFormat, level->width, level->height,
+                                   0, (GLsizei)level->size, texture->data + level->offset);
+        }
+    }
+    return glGetError() == GL_NO_ERROR;
+}
+
+void glfmFreeTexture(GLFMTexture *texture) {
+    if (texture) {
+        free(texture->data);
+        memset(texture, 0, sizeof(GLFMTexture));
+    }
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // GLFM_TEXTURE_H
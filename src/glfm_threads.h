@@ -0,0 +1,347 @@
+// GLFM
+// https://github.com/brackeen/glfm
+
+#ifndef GLFM_THREADS_H
+#define GLFM_THREADS_H
+
+// Thread scheduling policy and core topology, shared by all backends. Included by glfm_jobs.h.
+//
+// On Android and Linux, a policy is applied to a thread by its thread ID, so it can be applied to
+// the job workers from any thread, and the placement is read back from the kernel rather than
+// remembered. The only state kept is each thread's scheduling from before it was first changed,
+// which flags that aren't set are restored to. Other platforms have no per-thread control.
+
+#include "glfm_internal.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined(__linux__) && !defined(__EMSCRIPTEN__)
+#  define GLFM_HAS_THREAD_POLICY 1
+#  include <errno.h>
+#  include <pthread.h>
+#  include <sched.h>
+#  include <sys/resource.h>
+#  include <sys/syscall.h>
+#  include <unistd.h>
+#else
+#  define GLFM_HAS_THREAD_POLICY 0
+#endif
+
+#define GLFM_MAX_CPUS 64
+#define GLFM_THREAD_HIGH_PRIORITY_NICE (-8) // Android's THREAD_PRIORITY_URGENT_DISPLAY
+#define GLFM_THREAD_REALTIME_PRIORITY 1
+#define GLFM_CPU_SET_WORDS (1024 / (8 * sizeof(unsigned long))) // Same size as cpu_set_t
+
+#if GLFM_HAS_THREAD_POLICY
+
+// Implemented in glfm_jobs.h
+static void glfm__jobSetThreadPolicy(GLFMThreadPolicy policy);
+static bool glfm__jobGetThreadPlacement(GLFMThreadPlacement *placement);
+
+// MARK: - Core topology
+
+typedef struct {
+    int cpuCount;
+    uint64_t cpuMask;
+    uint64_t performanceCpuMask; // Cores above the lowest capacity, or all cores if they are equal
+} GLFMCpuTopology;
+
+static bool glfm__readCpuValue(const char *cpuPath, int cpu, const char *name, long *value) {
+    char path[256];
+    snprintf(path, sizeof(path), "%s/cpu%i/%s", cpuPath, cpu, name);
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        return false;
+    }
+    const bool success = fscanf(file, "%ld", value) == 1 && *value > 0;
+    fclose(file);
+    return success;
+}
+
+/// Reads the core topology from `cpuPath` (normally "/sys/devices/system/cpu"). The capacity of
+/// each core is read from `cpu_capacity`, or from `cpufreq/cpuinfo_max_freq` on kernels without
+/// capacities. If the capacity of any core is unknown (like in many VMs), the cores are assumed to
+/// be the same. Returns false if no cores were found.
+static bool glfm__readCpuTopology(const char *cpuPath, GLFMCpuTopology *topology) {
+    long capacities[GLFM_MAX_CPUS];
+    bool capacitiesKnown = true;
+    int count = 0;
+    for (; count < GLFM_MAX_CPUS; count++) {
+        char path[256];
+        snprintf(path, sizeof(path), "%s/cpu%i", cpuPath, count);
+        if (access(path, F_OK) != 0) {
+            break;
+        }
+        if (!glfm__readCpuValue(cpuPath, count, "cpu_capacity", &capacities[count]) &&
+            !glfm__readCpuValue(cpuPath, count, "cpufreq/cpuinfo_max_freq", &capacities[count])) {
+            capacitiesKnown = false;
+        }
+    }
+    topology->cpuCount = count;
+    topology->cpuMask = count >= GLFM_MAX_CPUS ? UINT64_MAX : (((uint64_t)1 << count) - 1);
+    topology->performanceCpuMask = topology->cpuMask;
+    if (count == 0 || !capacitiesKnown) {
+        return count > 0;
+    }
+    long lowestCapacity = capacities[0];
+    for (int i = 1; i < count; i++) {
+        if (capacities[i] < lowestCapacity) {
+            lowestCapacity = capacities[i];
+        }
+    }
+    uint64_t performanceCpuMask = 0;
+    for (int i = 0; i < count; i++) {
+        if (capacities[i] > lowestCapacity) {
+            performanceCpuMask |= (uint64_t)1 << i;
+        }
+    }
+    if (performanceCpuMask != 0) {
+        topology->performanceCpuMask = performanceCpuMask;
+    }
+    return true;
+}
+
+static GLFMCpuTopology glfm__cpuTopology;
+static pthread_once_t glfm__cpuTopologyOnce = PTHREAD_ONCE_INIT;
+
+static void glfm__cpuTopologyInit(void) {
+    if (!glfm__readCpuTopology("/sys/devices/system/cpu", &glfm__cpuTopology)) {
+        const long cpuCount = sysconf(_SC_NPROCESSORS_CONF);
+        const int count = (int)(cpuCount < 1 ? 1 : (cpuCount < GLFM_MAX_CPUS ? cpuCount : GLFM_MAX_CPUS));
+        glfm__cpuTopology.cpuCount = count;
+        glfm__cpuTopology.cpuMask = count >= GLFM_MAX_CPUS ? UINT64_MAX : (((uint64_t)1 << count) - 1);
+        glfm__cpuTopology.performanceCpuMask = glfm__cpuTopology.cpuMask;
+    }
+}
+
+/// Gets the core topology of this device, read once.
+static const GLFMCpuTopology *glfm__getCpuTopology(void) {
+    pthread_once(&glfm__cpuTopologyOnce, glfm__cpuTopologyInit);
+    return &glfm__cpuTopology;
+}
+
+// MARK: - Thread policy
+
+// The affinity syscalls are used directly, because cpu_set_t and its macros require _GNU_SOURCE.
+// The kernel's mask is an array of unsigned longs, least significant bit first.
+
+static bool glfm__setThreadAffinity(int32_t threadId, uint64_t cpuMask) {
+    unsigned long cpuSet[GLFM_CPU_SET_WORDS] = { 0 };
+    for (int i = 0; i < GLFM_MAX_CPUS; i++) {
+        if (cpuMask & ((uint64_t)1 << i)) {
+            cpuSet[i / (8 * sizeof(unsigned long))] |= 1UL << (i % (8 * sizeof(unsigned long)));
+        }
+    }
+    return syscall(SYS_sched_setaffinity, threadId, sizeof(cpuSet), cpuSet) == 0;
+}
+
+static uint64_t glfm__getThreadAffinity(int32_t threadId) {
+    unsigned long cpuSet[GLFM_CPU_SET_WORDS] = { 0 };
+    if (syscall(SYS_sched_getaffinity, threadId, sizeof(cpuSet), cpuSet) < 0) {
+        return 0;
+    }
+    uint64_t cpuMask = 0;
+    for (int i = 0; i < GLFM_MAX_CPUS; i++) {
+        if (cpuSet[i / (8 * sizeof(unsigned long))] & (1UL << (i % (8 * sizeof(unsigned long))))) {
+            cpuMask |= (uint64_t)1 << i;
+        }
+    }
+    return cpuMask;
+}
+
+static int32_t glfm__getThreadId(void) {
+#if defined(__ANDROID__)
+    return (int32_t)gettid();
+#else
+    return (int32_t)syscall(SYS_gettid);
+#endif
+}
+
+// MARK: - Saved thread state
+
+#define GLFM_MAX_SAVED_THREADS 64
+
+/// The scheduling of a thread before GLFM first changed it.
+typedef struct {
+    int32_t threadId;
+    int scheduler;
+    struct sched_param param;
+    int nice;
+    uint64_t cpuMask;
+} GLFMSavedThreadState;
+
+static GLFMSavedThreadState glfm__savedThreadStates[GLFM_MAX_SAVED_THREADS];
+static int glfm__savedThreadStateCount = 0;
+static pthread_mutex_t glfm__savedThreadStateMutex = PTHREAD_MUTEX_INITIALIZER;
+
+/// Gets the state of the thread from before GLFM first changed it. If `save` is true and the state
+/// wasn't saved yet, the current state is saved first. Returns false if there is no saved state.
+static bool glfm__getSavedThreadState(int32_t threadId, bool save, GLFMSavedThreadState *state) {
+    bool found = false;
+    pthread_mutex_lock(&glfm__savedThreadStateMutex);
+    for (int i = 0; i < glfm__savedThreadStateCount; i++) {
+        if (glfm__savedThreadStates[i].threadId == threadId) {
+            *state = glfm__savedThreadStates[i];
+            found = true;
+            break;
+        }
+    }
+    if (!found && save && glfm__savedThreadStateCount < GLFM_MAX_SAVED_THREADS) {
+        state->threadId = threadId;
+        state->scheduler = sched_getscheduler(threadId);
+        if (state->scheduler < 0 || sched_getparam(threadId, &state->param) != 0) {
+            state->scheduler = SCHED_OTHER;
+            state->param.sched_priority = 0;
+        }
+        errno = 0;
+        state->nice = getpriority(PRIO_PROCESS, (id_t)threadId);
+        if (errno != 0) {
+            state->nice = 0;
+        }
+        state->cpuMask = glfm__getThreadAffinity(threadId);
+        glfm__savedThreadStates[glfm__savedThreadStateCount++] = *state;
+        found = true;
+    } else if (!found && save) {
+        GLFM_LOG("Too many threads with a policy. Thread %i will be restored to the defaults", threadId);
+    }
+    pthread_mutex_unlock(&glfm__savedThreadStateMutex);
+    return found;
+}
+
+// MARK: - Thread policy
+
+/// Applies the policy to the thread. Flags that aren't set are restored to the thread's state from
+/// before GLFM first changed it, and flags that aren't permitted are ignored. A thread that GLFM
+/// never changed is left alone by GLFMThreadPolicyDefault. See glfm__getThreadPlacement() for the
+/// result.
+static void glfm__applyThreadPolicy(int32_t threadId, GLFMThreadPolicy policy) {
+    GLFMSavedThreadState saved;
+    if (!glfm__getSavedThreadState(threadId, policy != GLFMThreadPolicyDefault, &saved)) {
+        if (policy == GLFMThreadPolicyDefault) {
+            return;
+        }
+        // No room to save the state; restore to the defaults instead
+        const GLFMCpuTopology *topology = glfm__getCpuTopology();
+        saved.threadId = threadId;
+        saved.scheduler = SCHED_OTHER;
+        saved.param.sched_priority = 0;
+        saved.nice = 0;
+        saved.cpuMask = topology->cpuMask;
+    }
+
+    // Scheduler. SCHED_FIFO falls back to a raised nice value.
+    bool realtime = false;
+    if (policy & GLFMThreadPolicyRealtime) {
+        struct sched_param param = { 0 };
+        param.sched_priority = GLFM_THREAD_REALTIME_PRIORITY;
+        realtime = sched_setscheduler(threadId, SCHED_FIFO, &param) == 0;
+    }
+    if (!realtime && sched_getscheduler(threadId) != saved.scheduler) {
+        sched_setscheduler(threadId, saved.scheduler, &saved.param);
+    }
+
+    // Priority. On Linux, setpriority() with a thread ID applies to that thread only. A thread that
+    // already has a higher priority keeps it.
+    const bool highPriority = (policy & (GLFMThreadPolicyHighPriority | GLFMThreadPolicyRealtime)) != 0;
+    const int nice = (highPriority && saved.nice > GLFM_THREAD_HIGH_PRIORITY_NICE ?
+                      GLFM_THREAD_HIGH_PRIORITY_NICE : saved.nice);
+    setpriority(PRIO_PROCESS, (id_t)threadId, nice);
+
+    // Affinity
+    const GLFMCpuTopology *topology = glfm__getCpuTopology();
+    uint64_t cpuMask = saved.cpuMask;
+    if (policy & GLFMThreadPolicyPerformanceCores) {
+        cpuMask = topology->performanceCpuMask;
+    }
+    if (cpuMask != 0 && !glfm__setThreadAffinity(threadId, cpuMask)) {
+        GLFM_LOG("Couldn't set affinity of thread %i", threadId);
+    }
+}
+
+/// Reads the effective policy and placement of the thread from the kernel.
+static bool glfm__getThreadPlacement(int32_t threadId, GLFMThreadPlacement *placement) {
+    const GLFMCpuTopology *topology = glfm__getCpuTopology();
+    placement->policy = GLFMThreadPolicyDefault;
+    placement->cpuMask = 0;
+    placement->performanceCpuMask = topology->performanceCpuMask;
+
+    const int scheduler = sched_getscheduler(threadId);
+    if (scheduler < 0) {
+        return false;
+    }
+    int policy = GLFMThreadPolicyDefault;
+    if (scheduler == SCHED_FIFO) {
+        policy |= GLFMThreadPolicyRealtime;
+    }
+    errno = 0;
+    const int nice = getpriority(PRIO_PROCESS, (id_t)threadId);
+    if (errno == 0 && nice < 0) {
+        policy |= GLFMThreadPolicyHighPriority;
+    }
+    placement->cpuMask = glfm__getThreadAffinity(threadId);
+    if (placement->cpuMask != 0 && (placement->cpuMask & ~topology->performanceCpuMask) == 0) {
+        policy |= GLFMThreadPolicyPerformanceCores;
+    }
+    placement->policy = (GLFMThreadPolicy)policy;
+    return true;
+}
+
+#endif // GLFM_HAS_THREAD_POLICY
+
+// MARK: - Public functions
+
+bool glfmSetThreadPolicy(GLFMDisplay *display, GLFMThread thread, GLFMThreadPolicy policy) {
+    if (!display) {
+        return false;
+    }
+#if GLFM_HAS_THREAD_POLICY
+    if (thread == GLFMThreadRender) {
+        display->renderThreadId = glfm__getThreadId();
+        glfm__applyThreadPolicy(display->renderThreadId, policy);
+    } else {
+        glfm__jobSetThreadPolicy(policy);
+    }
+#else
+    (void)thread;
+#endif
+    GLFMThreadPlacement placement;
+    return glfmGetThreadPlacement(display, thread, &placement) && (placement.policy & policy) == policy;
+}
+
+bool glfmGetThreadPlacement(const GLFMDisplay *display, GLFMThread thread,
+                            GLFMThreadPlacement *placement) {
+    if (!placement) {
+        return false;
+    }
+    placement->policy = GLFMThreadPolicyDefault;
+    placement->cpuMask = 0;
+    placement->performanceCpuMask = 0;
+    if (!display) {
+        return false;
+    }
+#if GLFM_HAS_THREAD_POLICY
+    if (thread == GLFMThreadRender) {
+        const int32_t threadId = display->renderThreadId ? display->renderThreadId : glfm__getThreadId();
+        return glfm__getThreadPlacement(threadId, placement);
+    } else {
+        return glfm__jobGetThreadPlacement(placement);
+    }
+#elif defined(__APPLE__)
+    // GLFM threads have the user-interactive QoS class: the main thread by default, and the job
+    // workers set it when they start.
+    (void)thread;
+    placement->policy = GLFMThreadPolicyHighPriority;
+    return true;
+#else
+    (void)thread;
+    return false;
+#endif
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // GLFM_THREADS_H
@@ -0,0 +1,803 @@
+// GLFM
+// https://github.com/brackeen/glfm
+
+#ifndef GLFM_VULKAN_H
+#define GLFM_VULKAN_H
+
+// Vulkan surface and swapchain management, shared by the Android and Linux backends.
+//
+// The Vulkan loader is opened at runtime, so only the Vulkan headers are needed to build, and apps
+// that don't use Vulkan don't depend on the loader. When GLFM_HAS_VULKAN is set, the backend
+// includes <vulkan/vulkan.h> (with VK_NO_PROTOTYPES and its VK_USE_PLATFORM_* macro) before glfm.h,
+// and includes this file after glfm_internal.h.
+
+#include "glfm_internal.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if GLFM_HAS_VULKAN
+
+#include <dlfcn.h>
+
+#define GLFM_VULKAN_MAX_FRAMES_IN_FLIGHT 2
+#define GLFM_VULKAN_MAX_IMAGES 8
+
+/// Creates the platform's surface. The instance was created with the surface extension passed to
+/// glfm__vulkanCreate().
+typedef VkResult (*GLFMVulkanSurfaceFunc)(GLFMDisplay *display,
+                                          PFN_vkGetInstanceProcAddr getInstanceProcAddr,
+                                          VkInstance instance, VkSurfaceKHR *surface);
+
+typedef struct GLFMVulkan {
+    void *library;
+    PFN_vkGetInstanceProcAddr getInstanceProcAddr;
+
+    // Instance functions
+    PFN_vkDestroyInstance destroyInstance;
+    PFN_vkEnumeratePhysicalDevices enumeratePhysicalDevices;
+    PFN_vkGetPhysicalDeviceProperties getPhysicalDeviceProperties;
+    PFN_vkGetPhysicalDeviceQueueFamilyProperties getPhysicalDeviceQueueFamilyProperties;
+    PFN_vkEnumerateDeviceExtensionProperties enumerateDeviceExtensionProperties;
+    PFN_vkCreateDevice createDevice;
+    PFN_vkGetDeviceProcAddr getDeviceProcAddr;
+    PFN_vkDestroySurfaceKHR destroySurface;
+    PFN_vkGetPhysicalDeviceSurfaceSupportKHR getSurfaceSupport;
+    PFN_vkGetPhysicalDeviceSurfaceCapabilitiesKHR getSurfaceCapabilities;
+    PFN_vkGetPhysicalDeviceSurfaceFormatsKHR getSurfaceFormats;
+    PFN_vkGetPhysicalDeviceSurfacePresentModesKHR getSurfacePresentModes;
+
+    // Device functions
+    PFN_vkDestroyDevice destroyDevice;
+    PFN_vkGetDeviceQueue getDeviceQueue;
+    PFN_vkDeviceWaitIdle deviceWaitIdle;
+    PFN_vkCreateSemaphore createSemaphore;
+    PFN_vkDestroySemaphore destroySemaphore;
+    PFN_vkCreateFence createFence;
+    PFN_vkDestroyFence destroyFence;
+    PFN_vkWaitForFences waitForFences;
+    PFN_vkResetFences resetFences;
+    PFN_vkCreateImageView createImageView;
+    PFN_vkDestroyImageView destroyImageView;
+    PFN_vkCreateSwapchainKHR createSwapchain;
+    PFN_vkDestroySwapchainKHR destroySwapchain;
+    PFN_vkGetSwapchainImagesKHR getSwapchainImages;
+    PFN_vkAcquireNextImageKHR acquireNextImage;
+    PFN_vkQueuePresentKHR queuePresent;
+
+    VkInstance instance;
+    VkPhysicalDevice physicalDevice;
+    VkDevice device;
+    uint32_t queueFamilyIndex;
+    VkQueue queue;
+
+    GLFMVulkanSurfaceFunc surfaceFunc;
+    VkSurfaceKHR surface;
+
+    // Swapchain. Recreated when the requested size, swap interval, or latency mode changes.
+    VkSwapchainKHR swapchain;
+    VkFormat format;
+    VkExtent2D extent;
+    uint32_t imageCount;
+    VkImage images[GLFM_VULKAN_MAX_IMAGES];
+    VkImageView imageViews[GLFM_VULKAN_MAX_IMAGES];
+    int requestedWidth;
+    int requestedHeight;
+    int appliedSwapInterval;
+    GLFMLatencyMode appliedLatencyMode;
+    bool swapchainOutOfDate;
+
+    // Frame synchronization. Render semaphores are per image, since an image may still be waiting
+    // to be presented when its frame slot is reused.
+    VkSemaphore acquireSemaphores[GLFM_VULKAN_MAX_FRAMES_IN_FLIGHT];
+    VkFence fences[GLFM_VULKAN_MAX_FRAMES_IN_FLIGHT];
+    VkSemaphore renderSemaphores[GLFM_VULKAN_MAX_IMAGES];
+    uint32_t frameIndex;
+    uint32_t imageIndex;
+    bool imageAcquired;
+} GLFMVulkan;
+
+// MARK: - Loader
+
+static void *glfm__vulkanOpenLibrary(void) {
+#if defined(__ANDROID__)
+    return dlopen("libvulkan.so", RTLD_NOW | RTLD_LOCAL);
+#else
+    void *library = dlopen("libvulkan.so.1", RTLD_NOW | RTLD_LOCAL);
+    if (!library) {
+        library = dlopen("libvulkan.so", RTLD_NOW | RTLD_LOCAL);
+    }
+    return library;
+#endif
+}
+
+#define glfm__vulkanLoadInstanceFunction(vk, var, name) \
+    ((vk)->var = (PFN_##name)(vk)->getInstanceProcAddr((vk)->instance, #name)) != NULL
+
+#define glfm__vulkanLoadDeviceFunction(vk, var, name) \
+    ((vk)->var = (PFN_##name)(vk)->getDeviceProcAddr((vk)->device, #name)) != NULL
+
+static bool glfm__vulkanHasExtension(const VkExtensionProperties *extensions, uint32_t count,
+                                     const char *name) {
+    for (uint32_t i = 0; i < count; i++) {
+        if (strcmp(extensions[i].extensionName, name) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void glfm__vulkanDestroy(GLFMVulkan *vk);
+
+/// Opens the Vulkan loader and creates an instance with the platform's surface extension.
+/// Returns NULL if Vulkan is unavailable, in which case the backend should use OpenGL ES.
+static GLFMVulkan *glfm__vulkanCreate(const char *surfaceExtension,
+                                      GLFMVulkanSurfaceFunc surfaceFunc) {
+    GLFMVulkan *vk = calloc(1, sizeof(GLFMVulkan));
+    if (!vk) {
+        return NULL;
+    }
+    vk->surfaceFunc = surfaceFunc;
+    vk->appliedSwapInterval = -1;
+    vk->library = glfm__vulkanOpenLibrary();
+    if (vk->library) {
+        vk->getInstanceProcAddr = (PFN_vkGetInstanceProcAddr)dlsym(vk->library,
+                                                                   "vkGetInstanceProcAddr");
+    }
+    if (!vk->getInstanceProcAddr) {
+        GLFM_LOG("Vulkan loader not found");
+        glfm__vulkanDestroy(vk);
+        return NULL;
+    }
+
+    PFN_vkEnumerateInstanceExtensionProperties enumerateInstanceExtensionProperties =
+        (PFN_vkEnumerateInstanceExtensionProperties)vk->getInstanceProcAddr(
+            VK_NULL_HANDLE, "vkEnumerateInstanceExtensionProperties");
+    PFN_vkCreateInstance createInstance = (PFN_vkCreateInstance)vk->getInstanceProcAddr(
+        VK_NULL_HANDLE, "vkCreateInstance");
+    if (!enumerateInstanceExtensionProperties || !createInstance) {
+        glfm__vulkanDestroy(vk);
+        return NULL;
+    }
+
+    uint32_t extensionCount = 0;
+    enumerateInstanceExtensionProperties(NULL, &extensionCount, NULL);
+    VkExtensionProperties *extensions = calloc(extensionCount + 1, sizeof(VkExtensionProperties));
+    if (!extensions) {
+        glfm__vulkanDestroy(vk);
+        return NULL;
+    }
+    enumerateInstanceExtensionProperties(NULL, &extensionCount, extensions);
+    const bool hasExtensions = (glfm__vulkanHasExtension(extensions, extensionCount,
+                                                         VK_KHR_SURFACE_EXTENSION_NAME) &&
+                                glfm__vulkanHasExtension(extensions, extensionCount,
+                                                         surfaceExtension));
+    free(extensions);
+    if (!hasExtensions) {
+        GLFM_LOG("Vulkan extension %s not available", surfaceExtension);
+        glfm__vulkanDestroy(vk);
+        return NULL;
+    }
+
+    // Request the highest version the loader supports, so that apps can use it.
+    uint32_t apiVersion = VK_API_VERSION_1_0;
+    PFN_vkEnumerateInstanceVersion enumerateInstanceVersion =
+        (PFN_vkEnumerateInstanceVersion)vk->getInstanceProcAddr(VK_NULL_HANDLE,
+                                                                "vkEnumerateInstanceVersion");
+    if (enumerateInstanceVersion) {
+        enumerateInstanceVersion(&apiVersion);
+    }
+
+    const char *enabledExtensions[] = { VK_KHR_SURFACE_EXTENSION_NAME, surfaceExtension };
+    VkApplicationInfo applicationInfo;
+    memset(&applicationInfo, 0, sizeof(applicationInfo));
+    applicationInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+    applicationInfo.pEngineName = "GLFM";
+    applicationInfo.apiVersion = apiVersion;
+    VkInstanceCreateInfo createInfo;
+    memset(&createInfo, 0, sizeof(createInfo));
+    createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+    createInfo.pApplicationInfo = &applicationInfo;
+    createInfo.enabledExtensionCount = sizeof(enabledExtensions) / sizeof(*enabledExtensions);
+    createInfo.ppEnabledExtensionNames = enabledExtensions;
+    if (createInstance(&createInfo, NULL, &vk->instance) != VK_SUCCESS) {
+        GLFM_LOG("vkCreateInstance() failed");
+        vk->instance = VK_NULL_HANDLE;
+        glfm__vulkanDestroy(vk);
+        return NULL;
+    }
+
+    if (!(glfm__vulkanLoadInstanceFunction(vk, destroyInstance, vkDestroyInstance) &&
+          glfm__vulkanLoadInstanceFunction(vk, enumeratePhysicalDevices,
+                                           vkEnumeratePhysicalDevices) &&
+          glfm__vulkanLoadInstanceFunction(vk, getPhysicalDeviceProperties,
+                                           vkGetPhysicalDeviceProperties) &&
+          glfm__vulkanLoadInstanceFunction(vk, getPhysicalDeviceQueueFamilyProperties,
+                                           vkGetPhysicalDeviceQueueFamilyProperties) &&
+          glfm__vulkanLoadInstanceFunction(vk, enumerateDeviceExtensionProperties,
+                                           vkEnumerateDeviceExtensionProperties) &&
+          glfm__vulkanLoadInstanceFunction(vk, createDevice, vkCreateDevice) &&
+          glfm__vulkanLoadInstanceFunction(vk, getDeviceProcAddr, vkGetDeviceProcAddr) &&
+          glfm__vulkanLoadInstanceFunction(vk, destroySurface, vkDestroySurfaceKHR) &&
+          glfm__vulkanLoadInstanceFunction(vk, getSurfaceSupport,
+                                           vkGetPhysicalDeviceSurfaceSupportKHR) &&
+          glfm__vulkanLoadInstanceFunction(vk, getSurfaceCapabilities,
+                                           vkGetPhysicalDeviceSurfaceCapabilitiesKHR) &&
+          glfm__vulkanLoadInstanceFunction(vk, getSurfaceFormats,
+                                           vkGetPhysicalDeviceSurfaceFormatsKHR) &&
+          glfm__vulkanLoadInstanceFunction(vk, getSurfacePresentModes,
+                                           vkGetPhysicalDeviceSurfacePresentModesKHR))) {
+        glfm__vulkanDestroy(vk);
+        return NULL;
+    }
+    return vk;
+}
+
+// MARK: - Device
+
+/// Ranks a physical device. Hardware devices are preferred over software rasterizers.
+static int glfm__vulkanGetDeviceScore(const VkPhysicalDeviceProperties *properties) {
+    switch (properties->deviceType) {
+        case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU:
+            return 4;
+        case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU:
+            return 3;
+        case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU:
+            return 2;
+        case VK_PHYSICAL_DEVICE_TYPE_CPU:
+        case VK_PHYSICAL_DEVICE_TYPE_OTHER:
+        default:
+            return 1;
+    }
+}
+
+/// Gets a queue family of the physical device that supports both graphics and presenting to the
+/// surface. Returns false if there is none, or if the device doesn't support swapchains.
+static bool glfm__vulkanGetQueueFamily(GLFMVulkan *vk, VkPhysicalDevice physicalDevice,
+                                       uint32_t *queueFamilyIndex) {
+    uint32_t extensionCount = 0;
+    vk->enumerateDeviceExtensionProperties(physicalDevice, NULL, &extensionCount, NULL);
+    VkExtensionProperties *extensions = calloc(extensionCount + 1, sizeof(VkExtensionProperties));
+    if (!extensions) {
+        return false;
+    }
+    vk->enumerateDeviceExtensionProperties(physicalDevice, NULL, &extensionCount, extensions);
+    const bool hasSwapchain = glfm__vulkanHasExtension(extensions, extensionCount,
+                                                       VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+    free(extensions);
+    if (!hasSwapchain) {
+        return false;
+    }
+
+    uint32_t familyCount = 0;
+    vk->getPhysicalDeviceQueueFamilyProperties(physicalDevice, &familyCount, NULL);
+    VkQueueFamilyProperties *families = calloc(familyCount + 1, sizeof(VkQueueFamilyProperties));
+    if (!families) {
+        return false;
+    }
+    vk->getPhysicalDeviceQueueFamilyProperties(physicalDevice, &familyCount, families);
+    bool found = false;
+    for (uint32_t i = 0; i < familyCount && !found; i++) {
+        VkBool32 presentSupported = VK_FALSE;
+        if ((families[i].queueFlags & VK_QUEUE_GRAPHICS_BIT) && families[i].queueCount > 0 &&
+            vk->getSurfaceSupport(physicalDevice, i, vk->surface,
+                                  &presentSupported) == VK_SUCCESS && presentSupported) {
+            *queueFamilyIndex = i;
+            found = true;
+        }
+    }
+    free(families);
+    return found;
+}
+
+/// Creates the logical device, its queue, and the frame synchronization objects. The device is
+/// created once, with the first surface, and is kept when the surface is lost.
+static bool glfm__vulkanDeviceInit(GLFMVulkan *vk) {
+    uint32_t deviceCount = 0;
+    vk->enumeratePhysicalDevices(vk->instance, &deviceCount, NULL);
+    VkPhysicalDevice *physicalDevices = calloc(deviceCount + 1, sizeof(VkPhysicalDevice));
+    if (!physicalDevices) {
+        return false;
+    }
+    vk->enumeratePhysicalDevices(vk->instance, &deviceCount, physicalDevices);
+    int bestScore = 0;
+    for (uint32_t i = 0; i < deviceCount; i++) {
+        VkPhysicalDeviceProperties properties;
+        vk->getPhysicalDeviceProperties(physicalDevices[i], &properties);
+        const int score = glfm__vulkanGetDeviceScore(&properties);
+        uint32_t queueFamilyIndex = 0;
+        if (score > bestScore && glfm__vulkanGetQueueFamily(vk, physicalDevices[i],
+                                                            &queueFamilyIndex)) {
+            bestScore = score;
+            vk->physicalDevice = physicalDevices[i];
+            vk->queueFamilyIndex = queueFamilyIndex;
+        }
+    }
+    free(physicalDevices);
+    if (vk->physicalDevice == VK_NULL_HANDLE) {
+        GLFM_LOG("No Vulkan device can present to the surface");
+        return false;
+    }
+
+    const float queuePriority = 1.0f;
+    VkDeviceQueueCreateInfo queueCreateInfo;
+    memset(&queueCreateInfo, 0, sizeof(queueCreateInfo));
+    queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+    queueCreateInfo.queueFamilyIndex = vk->queueFamilyIndex;
+    queueCreateInfo.queueCount = 1;
+    queueCreateInfo.pQueuePriorities = &queuePriority;
+    const char *enabledExtensions[] = { VK_KHR_SWAPCHAIN_EXTENSION_NAME };
+    VkDeviceCreateInfo createInfo;
+    memset(&createInfo, 0, sizeof(createInfo));
+    createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+    createInfo.queueCreateInfoCount = 1;
+    createInfo.pQueueCreateInfos = &queueCreateInfo;
+    createInfo.enabledExtensionCount = 1;
+    createInfo.ppEnabledExtensionNames = enabledExtensions;
+    if (vk->createDevice(vk->physicalDevice, &createInfo, NULL, &vk->device) != VK_SUCCESS) {
+        GLFM_LOG("vkCreateDevice() failed");
+        vk->device = VK_NULL_HANDLE;
+        return false;
+    }
+
+    if (!(glfm__vulkanLoadDeviceFunction(vk, destroyDevice, vkDestroyDevice) &&
+          glfm__vulkanLoadDeviceFunction(vk, getDeviceQueue, vkGetDeviceQueue) &&
+          glfm__vulkanLoadDeviceFunction(vk, deviceWaitIdle, vkDeviceWaitIdle) &&
+          glfm__vulkanLoadDeviceFunction(vk, createSemaphore, vkCreateSemaphore) &&
+          glfm__vulkanLoadDeviceFunction(vk, destroySemaphore, vkDestroySemaphore) &&
+          glfm__vulkanLoadDeviceFunction(vk, createFence, vkCreateFence) &&
+          glfm__vulkanLoadDeviceFunction(vk, destroyFence, vkDestroyFence) &&
+          glfm__vulkanLoadDeviceFunction(vk, waitForFences, vkWaitForFences) &&
+          glfm__vulkanLoadDeviceFunction(vk, resetFences, vkResetFences) &&
+          glfm__vulkanLoadDeviceFunction(vk, createImageView, vkCreateImageView) &&
+          glfm__vulkanLoadDeviceFunction(vk, destroyImageView, vkDestroyImageView) &&
+          glfm__vulkanLoadDeviceFunction(vk, createSwapchain, vkCreateSwapchainKHR) &&
+          glfm__vulkanLoadDeviceFunction(vk, destroySwapchain, vkDestroySwapchainKHR) &&
+          glfm__vulkanLoadDeviceFunction(vk, getSwapchainImages, vkGetSwapchainImagesKHR) &&
+          glfm__vulkanLoadDeviceFunction(vk, acquireNextImage, vkAcquireNextImageKHR) &&
+          glfm__vulkanLoadDeviceFunction(vk, queuePresent, vkQueuePresentKHR))) {
+        return false;
+    }
+    vk->getDeviceQueue(vk->device, vk->queueFamilyIndex, 0, &vk->queue);
+
+    VkSemaphoreCreateInfo semaphoreCreateInfo;
+    memset(&semaphoreCreateInfo, 0, sizeof(semaphoreCreateInfo));
+    semaphoreCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    // Fences start signaled, so that the first wait on each frame slot returns immediately.
+    VkFenceCreateInfo fenceCreateInfo;
+    memset(&fenceCreateInfo, 0, sizeof(fenceCreateInfo));
+    fenceCreateInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+    fenceCreateInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+    for (uint32_t i = 0; i < GLFM_VULKAN_MAX_FRAMES_IN_FLIGHT; i++) {
+        if (vk->createSemaphore(vk->device, &semaphoreCreateInfo, NULL,
+                                &vk->acquireSemaphores[i]) != VK_SUCCESS ||
+            vk->createFence(vk->device, &fenceCreateInfo, NULL, &vk->fences[i]) != VK_SUCCESS) {
+            return false;
+        }
+    }
+    for (uint32_t i = 0; i < GLFM_VULKAN_MAX_IMAGES; i++) {
+        if (vk->createSemaphore(vk->device, &semaphoreCreateInfo, NULL,
+                                &vk->renderSemaphores[i]) != VK_SUCCESS) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// MARK: - Swapchain
+
+static void glfm__vulkanDestroyImageViews(GLFMVulkan *vk) {
+    for (uint32_t i = 0; i < vk->imageCount; i++) {
+        if (vk->imageViews[i] != VK_NULL_HANDLE) {
+            vk->destroyImageView(vk->device, vk->imageViews[i], NULL);
+            vk->imageViews[i] = VK_NULL_HANDLE;
+        }
+    }
+    vk->imageCount = 0;
+}
+
+/// Gets the present mode for the display's swap interval. A swap interval of 0 prefers mailbox
+/// (no tearing) over immediate. Intervals greater than 1 use FIFO, since Vulkan has no way to skip
+/// refreshes.
+static VkPresentModeKHR glfm__vulkanGetPresentMode(GLFMVulkan *vk, int swapInterval) {
+    if (swapInterval != 0) {
+        return VK_PRESENT_MODE_FIFO_KHR;
+    }
+    VkPresentModeKHR presentModes[8];
+    uint32_t presentModeCount = sizeof(presentModes) / sizeof(*presentModes);
+    const VkResult result = vk->getSurfacePresentModes(vk->physicalDevice, vk->surface,
+                                                       &presentModeCount, presentModes);
+    if (result != VK_SUCCESS && result != VK_INCOMPLETE) {
+        return VK_PRESENT_MODE_FIFO_KHR;
+    }
+    VkPresentModeKHR presentMode = VK_PRESENT_MODE_FIFO_KHR;
+    for (uint32_t i = 0; i < presentModeCount; i++) {
+        if (presentModes[i] == VK_PRESENT_MODE_MAILBOX_KHR) {
+            return VK_PRESENT_MODE_MAILBOX_KHR;
+        } else if (presentModes[i] == VK_PRESENT_MODE_IMMEDIATE_KHR) {
+            presentMode = VK_PRESENT_MODE_IMMEDIATE_KHR;
+        }
+    }
+    return presentMode;
+}
+
+/// Gets the surface format. 8-bit UNORM formats are preferred, to match the OpenGL ES default.
+static bool glfm__vulkanGetSurfaceFormat(GLFMVulkan *vk, VkSurfaceFormatKHR *surfaceFormat) {
+    VkSurfaceFormatKHR formats[32];
+    uint32_t formatCount = sizeof(formats) / sizeof(*formats);
+    const VkResult result = vk->getSurfaceFormats(vk->physicalDevice, vk->surface, &formatCount,
+                                                  formats);
+    if ((result != VK_SUCCESS && result != VK_INCOMPLETE) || formatCount == 0) {
+        return false;
+    }
+    *surfaceFormat = formats[0];
+    for (uint32_t i = 0; i < formatCount; i++) {
+        if (formats[i].format == VK_FORMAT_R8G8B8A8_UNORM ||
+            formats[i].format == VK_FORMAT_B8G8R8A8_UNORM) {
+            *surfaceFormat = formats[i];
+            break;
+        }
+    }
+    if (surfaceFormat->format == VK_FORMAT_UNDEFINED) {
+        surfaceFormat->format = VK_FORMAT_B8G8R8A8_UNORM;
+    }
+    return true;
+}
+
+static uint32_t glfm__vulkanClamp(uint32_t value, uint32_t min, uint32_t max) {
+    return value < min ? min : (value > max ? max : value);
+}
+
+/// Creates (or recreates) the swapchain. The size of the surface is used if the platform defines
+/// it; otherwise, the requested size is used. Returns false if the surface has no area (for
+/// example, a minimized window), or on failure.
+static bool glfm__vulkanCreateSwapchain(GLFMDisplay *display, GLFMVulkan *vk,
+                                        int width, int height) {
+    vk->requestedWidth = width;
+    vk->requestedHeight = height;
+    vk->appliedSwapInterval = glfmGetSwapInterval(display);
+    vk->appliedLatencyMode = display->latencyMode;
+    vk->swapchainOutOfDate = false;
+
+    VkSurfaceCapabilitiesKHR capabilities;
+    VkSurfaceFormatKHR surfaceFormat;
+    if (vk->getSurfaceCapabilities(vk->physicalDevice, vk->surface, &capabilities) != VK_SUCCESS ||
+        !glfm__vulkanGetSurfaceFormat(vk, &surfaceFormat)) {
+        return false;
+    }
+    VkExtent2D extent = capabilities.currentExtent;
+    if (extent.width == UINT32_MAX) {
+        extent.width = glfm__vulkanClamp((uint32_t)(width > 0 ? width : 0),
+                                         capabilities.minImageExtent.width,
+                                         capabilities.maxImageExtent.width);
+        extent.height = glfm__vulkanClamp((uint32_t)(height > 0 ? height : 0),
+                                          capabilities.minImageExtent.height,
+                                          capabilities.maxImageExtent.height);
+    }
+    if (extent.width == 0 || extent.height == 0) {
+        return false;
+    }
+
+    // One extra image in throughput mode, so that the app can render ahead of the display.
+    uint32_t minImageCount = capabilities.minImageCount;
+    if (display->latencyMode == GLFMLatencyModeThroughput) {
+        minImageCount++;
+    }
+    uint32_t maxImageCount = GLFM_VULKAN_MAX_IMAGES;
+    if (capabilities.maxImageCount > 0 && capabilities.maxImageCount < maxImageCount) {
+        maxImageCount = capabilities.maxImageCount;
+    }
+    minImageCount = glfm__vulkanClamp(minImageCount, 1, maxImageCount);
+
+    // Prefer the identity transform, so that apps don't need to rotate their rendering. On
+    // rotated Android devices, this costs a composition pass, like OpenGL ES.
+    VkSurfaceTransformFlagBitsKHR preTransform = capabilities.currentTransform;
+    if (capabilities.supportedTransforms & VK_SURFACE_TRANSFORM_IDENTITY_BIT_KHR) {
+        preTransform = VK_SURFACE_TRANSFORM_IDENTITY_BIT_KHR;
+    }
+    static const VkCompositeAlphaFlagBitsKHR compositeAlphas[] = {
+        VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR,
+        VK_COMPOSITE_ALPHA_INHERIT_BIT_KHR,
+        VK_COMPOSITE_ALPHA_PRE_MULTIPLIED_BIT_KHR,
+        VK_COMPOSITE_ALPHA_POST_MULTIPLIED_BIT_KHR,
+    };
+    VkCompositeAlphaFlagBitsKHR compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
+    for (size_t i = 0; i < sizeof(compositeAlphas) / sizeof(*compositeAlphas); i++) {
+        if (capabilities.supportedCompositeAlpha & (VkCompositeAlphaFlagsKHR)compositeAlphas[i]) {
+            compositeAlpha = compositeAlphas[i];
+            break;
+        }
+    }
+    VkImageUsageFlags imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+    imageUsage |= (capabilities.supportedUsageFlags & (VK_IMAGE_USAGE_TRANSFER_SRC_BIT |
+                                                       VK_IMAGE_USAGE_TRANSFER_DST_BIT));
+
+    // The old swapchain's images may still be in use.
+    vk->deviceWaitIdle(vk->device);
+    glfm__vulkanDestroyImageViews(vk);
+
+    VkSwapchainKHR oldSwapchain = vk->swapchain;
+    VkSwapchainCreateInfoKHR createInfo;
+    memset(&createInfo, 0, sizeof(createInfo));
+    createInfo.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
+    createInfo.surface = vk->surface;
+    createInfo.minImageCount = minImageCount;
+    createInfo.imageFormat = surfaceFormat.format;
+    createInfo.imageColorSpace = surfaceFormat.colorSpace;
+    createInfo.imageExtent = extent;
+    createInfo.imageArrayLayers = 1;
+    createInfo.imageUsage = imageUsage;
+    createInfo.imageSharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    createInfo.preTransform = preTransform;
+    createInfo.compositeAlpha = compositeAlpha;
+    createInfo.presentMode = glfm__vulkanGetPresentMode(vk, vk->appliedSwapInterval);
+    createInfo.clipped = VK_TRUE;
+    createInfo.oldSwapchain = oldSwapchain;
+    const VkResult result = vk->createSwapchain(vk->device, &createInfo, NULL, &vk->swapchain);
+    if (oldSwapchain != VK_NULL_HANDLE) {
+        vk->destroySwapchain(vk->device, oldSwapchain, NULL);
+    }
+    if (result != VK_SUCCESS) {
+        GLFM_LOG("vkCreateSwapchainKHR() failed (%i)", (int)result);
+        vk->swapchain = VK_NULL_HANDLE;
+        return false;
+    }
+
+    uint32_t imageCount = GLFM_VULKAN_MAX_IMAGES;
+    if (vk->getSwapchainImages(vk->device, vk->swapchain, &imageCount, vk->images) < 0) {
+        return false;
+    }
+    vk->format = surfaceFormat.format;
+    vk->extent = extent;
+    for (uint32_t i = 0; i < imageCount; i++) {
+        VkImageViewCreateInfo viewCreateInfo;
+        memset(&viewCreateInfo, 0, sizeof(viewCreateInfo));
+        viewCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        viewCreateInfo.image = vk->images[i];
+        viewCreateInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        viewCreateInfo.format = surfaceFormat.format;
+        viewCreateInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        viewCreateInfo.subresourceRange.levelCount = 1;
+        viewCreateInfo.subresourceRange.layerCount = 1;
+        if (vk->createImageView(vk->device, &viewCreateInfo, NULL,
+                                &vk->imageViews[i]) != VK_SUCCESS) {
+            vk->imageViews[i] = VK_NULL_HANDLE;
+        }
+        vk->imageCount = i + 1;
+    }
+    return true;
+}
+
+// MARK: - Surface lifecycle
+
+/// Creates the surface for the current window, and the device if it doesn't exist yet.
+/// The swapchain is created on the first call to glfm__vulkanAcquire().
+static bool glfm__vulkanSurfaceInit(GLFMDisplay *display, GLFMVulkan *vk) {
+    if (vk->surface != VK_NULL_HANDLE) {
+        return true;
+    }
+    if (vk->surfaceFunc(display, vk->getInstanceProcAddr, vk->instance,
+                        &vk->surface) != VK_SUCCESS) {
+        GLFM_LOG("Couldn't create Vulkan surface");
+        vk->surface = VK_NULL_HANDLE;
+        return false;
+    }
+    if (vk->device == VK_NULL_HANDLE) {
+        return glfm__vulkanDeviceInit(vk);
+    }
+    VkBool32 presentSupported = VK_FALSE;
+    vk->getSurfaceSupport(vk->physicalDevice, vk->queueFamilyIndex, vk->surface,
+                          &presentSupported);
+    return presentSupported == VK_TRUE;
+}
+
+/// Destroys the swapchain and the surface, for example when the window is lost. The device, and
+/// any resources the app created with it, are kept.
+static void glfm__vulkanSurfaceDestroy(GLFMVulkan *vk) {
+    if (vk->device != VK_NULL_HANDLE && vk->deviceWaitIdle) {
+        vk->deviceWaitIdle(vk->device);
+        glfm__vulkanDestroyImageViews(vk);
+        if (vk->swapchain != VK_NULL_HANDLE) {
+            vk->destroySwapchain(vk->device, vk->swapchain, NULL);
+        }
+    }
+    vk->swapchain = VK_NULL_HANDLE;
+    vk->imageAcquired = false;
+    if (vk->surface != VK_NULL_HANDLE) {
+        vk->destroySurface(vk->instance, vk->surface, NULL);
+        vk->surface = VK_NULL_HANDLE;
+    }
+}
+
+/// Destroys everything, including the device. The app must release its Vulkan resources first,
+/// in its GLFMSurfaceDestroyedFunc.
+static void glfm__vulkanDestroy(GLFMVulkan *vk) {
+    if (!vk) {
+        return;
+    }
+    glfm__vulkanSurfaceDestroy(vk);
+    if (vk->device != VK_NULL_HANDLE) {
+        if (vk->destroySemaphore && vk->destroyFence) {
+            for (uint32_t i = 0; i < GLFM_VULKAN_MAX_FRAMES_IN_FLIGHT; i++) {
+                vk->destroySemaphore(vk->device, vk->acquireSemaphores[i], NULL);
+                vk->destroyFence(vk->device, vk->fences[i], NULL);
+            }
+            for (uint32_t i = 0; i < GLFM_VULKAN_MAX_IMAGES; i++) {
+                vk->destroySemaphore(vk->device, vk->renderSemaphores[i], NULL);
+            }
+        }
+        if (vk->destroyDevice) {
+            vk->destroyDevice(vk->device, NULL);
+        }
+    }
+    if (vk->instance != VK_NULL_HANDLE && vk->destroyInstance) {
+        vk->destroyInstance(vk->instance, NULL);
+    }
+    if (vk->library) {
+        dlclose(vk->library);
+    }
+    free(vk);
+}
+
+// MARK: - Frames
+
+/// Acquires the next swapchain image, recreating the swapchain first if the requested size, swap
+/// interval, or latency mode changed, or if the previous present reported it out of date.
+/// Waits until the frame slot's previous submission is complete.
+static bool glfm__vulkanAcquire(GLFMDisplay *display, GLFMVulkan *vk, int width, int height) {
+    if (vk->imageAcquired) {
+        return true;
+    }
+    if (vk->surface == VK_NULL_HANDLE || vk->device == VK_NULL_HANDLE) {
+        return false;
+    }
+    const uint32_t frameIndex = vk->frameIndex;
+    if (vk->waitForFences(vk->device, 1, &vk->fences[frameIndex], VK_TRUE,
+                          UINT64_MAX) != VK_SUCCESS) {
+        return false;
+    }
+    for (int attempt = 0; attempt < 2; attempt++) {
+        if (vk->swapchain == VK_NULL_HANDLE || vk->swapchainOutOfDate ||
+            vk->requestedWidth != width || vk->requestedHeight != height ||
+            vk->appliedSwapInterval != glfmGetSwapInterval(display) ||
+            vk->appliedLatencyMode != display->latencyMode) {
+            if (!glfm__vulkanCreateSwapchain(display, vk, width, height)) {
+                return false;
+            }
+        }
+        const VkResult result = vk->acquireNextImage(vk->device, vk->swapchain, UINT64_MAX,
+                                                     vk->acquireSemaphores[frameIndex],
+                                                     VK_NULL_HANDLE, &vk->imageIndex);
+        // Suboptimal images are still presentable. Android reports them whenever the device is
+        // rotated from its natural orientation, so they don't cause the swapchain to be recreated.
+        if (result == VK_SUCCESS || result == VK_SUBOPTIMAL_KHR) {
+            // Only reset the fence once it's certain the app will submit work that signals it.
+            vk->resetFences(vk->device, 1, &vk->fences[frameIndex]);
+            vk->imageAcquired = true;
+            return true;
+        } else if (result == VK_ERROR_OUT_OF_DATE_KHR) {
+            vk->swapchainOutOfDate = true;
+        } else {
+            GLFM_LOG("vkAcquireNextImageKHR() failed (%i)", (int)result);
+            if (result == VK_ERROR_SURFACE_LOST_KHR) {
+                glfm__reportSurfaceError(display, "Vulkan surface lost");
+            }
+            return false;
+        }
+    }
+    return false;
+}
+
+/// Presents the acquired image, after the app's render semaphore is signaled. Returns false if no
+/// image was acquired.
+static bool glfm__vulkanPresent(GLFMVulkan *vk) {
+    if (!vk->imageAcquired) {
+        return false;
+    }
+    vk->imageAcquired = false;
+    VkPresentInfoKHR presentInfo;
+    memset(&presentInfo, 0, sizeof(presentInfo));
+    presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+    presentInfo.waitSemaphoreCount = 1;
+    presentInfo.pWaitSemaphores = &vk->renderSemaphores[vk->imageIndex];
+    presentInfo.swapchainCount = 1;
+    presentInfo.pSwapchains = &vk->swapchain;
+    presentInfo.pImageIndices = &vk->imageIndex;
+    const VkResult result = vk->queuePresent(vk->queue, &presentInfo);
+    if (result == VK_ERROR_OUT_OF_DATE_KHR) {
+        vk->swapchainOutOfDate = true;
+    } else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
+        GLFM_LOG("vkQueuePresentKHR() failed (%i)", (int)result);
+    }
+
+    // In low latency mode, only one frame is in flight.
+    const uint32_t framesInFlight = (vk->appliedLatencyMode == GLFMLatencyModeLowLatency ?
+                                     1 : GLFM_VULKAN_MAX_FRAMES_IN_FLIGHT);
+    vk->frameIndex = (vk->frameIndex + 1) % framesInFlight;
+    return true;
+}
+
+// MARK: - GLFM public functions (Vulkan)
+
+bool glfmIsVulkanSupported(const GLFMDisplay *display) {
+    (void)display;
+    void *library = glfm__vulkanOpenLibrary();
+    if (!library) {
+        return false;
+    }
+    const bool supported = dlsym(library, "vkGetInstanceProcAddr") != NULL;
+    dlclose(library);
+    return supported;
+}
+
+bool glfmGetVulkanContext(const GLFMDisplay *display, GLFMVulkanContext *context) {
+    if (!display || !context || !display->vulkan || display->vulkan->device == VK_NULL_HANDLE) {
+        return false;
+    }
+    const GLFMVulkan *vk = display->vulkan;
+    context->instance = vk->instance;
+    context->physicalDevice = vk->physicalDevice;
+    context->device = vk->device;
+    context->queueFamilyIndex = vk->queueFamilyIndex;
+    context->queue = vk->queue;
+    context->getInstanceProcAddr = vk->getInstanceProcAddr;
+    return true;
+}
+
+bool glfmAcquireVulkanFrame(GLFMDisplay *display, GLFMVulkanFrame *frame) {
+    if (!display || !frame || !display->vulkan) {
+        return false;
+    }
+    GLFMVulkan *vk = display->vulkan;
+    int width = 0;
+    int height = 0;
+    glfmGetDisplaySize(display, &width, &height);
+    if (!glfm__vulkanAcquire(display, vk, width, height)) {
+        return false;
+    }
+    frame->imageIndex = vk->imageIndex;
+    frame->image = vk->images[vk->imageIndex];
+    frame->imageView = vk->imageViews[vk->imageIndex];
+    frame->format = vk->format;
+    frame->extent = vk->extent;
+    frame->acquireSemaphore = vk->acquireSemaphores[vk->frameIndex];
+    frame->renderSemaphore = vk->renderSemaphores[vk->imageIndex];
+    frame->fence = vk->fences[vk->frameIndex];
+    frame->frameIndex = vk->frameIndex;
+    return true;
+}
+
+#else
+
+// Apps built with the Vulkan headers link to these functions even when GLFM was built without
+// them. The frame and context types are opaque here.
+
+bool glfmIsVulkanSupported(const GLFMDisplay *display);
+bool glfmGetVulkanContext(const GLFMDisplay *display, void *context);
+bool glfmAcquireVulkanFrame(GLFMDisplay *display, void *frame);
+
+bool glfmIsVulkanSupported(const GLFMDisplay *display) {
+    (void)display;
+    return false;
+}
+
+bool glfmGetVulkanContext(const GLFMDisplay *display, void *context) {
+    (void)display;
+    (void)context;
+    return false;
+}
+
+bool glfmAcquireVulkanFrame(GLFMDisplay *display, void *frame) {
+    (void)display;
+    (void)frame;
+    return false;
+}
+
+#endif // GLFM_HAS_VULKAN
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // GLFM_VULKAN_H
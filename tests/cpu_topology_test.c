@@ -0,0 +1,171 @@
+// Tests the detection of performance cores from a fake sysfs CPU directory, for heterogeneous
+// phones, kernels with only frequencies, VMs, and incomplete data. Also checks the affinity of the
+// calling thread, restoring a thread's own scheduling, and prints the topology of this machine.
+
+#include "glfm_test_platform.h"
+#include <sys/stat.h>
+
+static char tempDir[] = "/tmp/glfm_cpu_topology_test_XXXXXX";
+
+/// Creates a fake `cpuPath` directory with `count` cores. A value of 0 is not written, like a
+/// kernel without the file.
+static void createCpuDirectory(char *cpuPath, size_t cpuPathSize, const char *name, int count,
+                               const long *capacities, const long *maxFrequencies) {
+    snprintf(cpuPath, cpuPathSize, "%s/%s", tempDir, name);
+    mkdir(cpuPath, 0755);
+    for (int i = 0; i < count; i++) {
+        char path[512];
+        snprintf(path, sizeof(path), "%s/cpu%i", cpuPath, i);
+        mkdir(path, 0755);
+        snprintf(path, sizeof(path), "%s/cpu%i/cpufreq", cpuPath, i);
+        mkdir(path, 0755);
+        for (int j = 0; j < 2; j++) {
+            const long value = j == 0 ? (capacities ? capacities[i] : 0) :
+                                        (maxFrequencies ? maxFrequencies[i] : 0);
+            if (value != 0) {
+                snprintf(path, sizeof(path), "%s/cpu%i/%s", cpuPath, i,
+                         j == 0 ? "cpu_capacity" : "cpufreq/cpuinfo_max_freq");
+                FILE *file = fopen(path, "w");
+                GLFM_TEST_CHECK(file != NULL);
+                if (file) {
+                    fprintf(file, "%ld\n", value);
+                    fclose(file);
+                }
+            }
+        }
+    }
+}
+
+static void testPhone(void) {
+    // 4 little cores, 3 big cores, and 1 prime core. The capacity is used, not the frequency.
+    static const long capacities[8] = { 446, 446, 446, 446, 871, 871, 871, 1024 };
+    static const long maxFrequencies[8] = { 1800000, 1800000, 1800000, 1800000,
+                                            1800000, 1800000, 1800000, 1800000 };
+    char cpuPath[256];
+    createCpuDirectory(cpuPath, sizeof(cpuPath), "phone", 8, capacities, maxFrequencies);
+    GLFMCpuTopology topology;
+    GLFM_TEST_CHECK(glfm__readCpuTopology(cpuPath, &topology));
+    GLFM_TEST_CHECK(topology.cpuCount == 8);
+    GLFM_TEST_CHECK(topology.cpuMask == 0xff);
+    GLFM_TEST_CHECK(topology.performanceCpuMask == 0xf0);
+}
+
+static void testFrequencies(void) {
+    // A kernel without capacities, with the big cores first
+    static const long maxFrequencies[8] = { 2400000, 2400000, 1800000, 1800000,
+                                            1800000, 1800000, 1800000, 1800000 };
+    char cpuPath[256];
+    createCpuDirectory(cpuPath, sizeof(cpuPath), "frequencies", 8, NULL, maxFrequencies);
+    GLFMCpuTopology topology;
+    GLFM_TEST_CHECK(glfm__readCpuTopology(cpuPath, &topology));
+    GLFM_TEST_CHECK(topology.cpuCount == 8);
+    GLFM_TEST_CHECK(topology.performanceCpuMask == 0x03);
+}
+
+static void testSameCores(void) {
+    // Equal capacities
+    static const long capacities[4] = { 1024, 1024, 1024, 1024 };
+    char cpuPath[256];
+    createCpuDirectory(cpuPath, sizeof(cpuPath), "same", 4, capacities, NULL);
+    GLFMCpuTopology topology;
+    GLFM_TEST_CHECK(glfm__readCpuTopology(cpuPath, &topology));
+    GLFM_TEST_CHECK(topology.cpuCount == 4 && topology.performanceCpuMask == 0x0f);
+
+    // A VM, with neither capacities nor frequencies
+    createCpuDirectory(cpuPath, sizeof(cpuPath), "vm", 4, NULL, NULL);
+    GLFM_TEST_CHECK(glfm__readCpuTopology(cpuPath, &topology));
+    GLFM_TEST_CHECK(topology.cpuCount == 4 && topology.performanceCpuMask == 0x0f);
+
+    // A missing capacity
+    static const long partialCapacities[4] = { 1024, 1024, 0, 512 };
+    createCpuDirectory(cpuPath, sizeof(cpuPath), "partial", 4, partialCapacities, NULL);
+    GLFM_TEST_CHECK(glfm__readCpuTopology(cpuPath, &topology));
+    GLFM_TEST_CHECK(topology.cpuCount == 4 && topology.performanceCpuMask == 0x0f);
+}
+
+static void testMissing(void) {
+    char cpuPath[256];
+    snprintf(cpuPath, sizeof(cpuPath), "%s/missing", tempDir);
+    GLFMCpuTopology topology;
+    GLFM_TEST_CHECK(!glfm__readCpuTopology(cpuPath, &topology));
+
+    // The cores are numbered from 0, so a directory without cpu0 has no cores
+    mkdir(cpuPath, 0755);
+    char path[512];
+    snprintf(path, sizeof(path), "%s/cpu1", cpuPath);
+    mkdir(path, 0755);
+    GLFM_TEST_CHECK(!glfm__readCpuTopology(cpuPath, &topology));
+}
+
+static void testThisMachine(void) {
+    GLFMCpuTopology topology;
+    GLFM_TEST_CHECK(glfm__readCpuTopology("/sys/devices/system/cpu", &topology));
+    GLFM_TEST_CHECK(topology.cpuCount > 0);
+    GLFM_TEST_CHECK((topology.performanceCpuMask & ~topology.cpuMask) == 0);
+    printf("This machine: %i cores, mask 0x%llx, performance mask 0x%llx\n", topology.cpuCount,
+           (unsigned long long)topology.cpuMask, (unsigned long long)topology.performanceCpuMask);
+
+    // Affinity round trip on this thread
+    const int32_t threadId = glfm__getThreadId();
+    const uint64_t cpuMask = glfm__getThreadAffinity(threadId);
+    GLFM_TEST_CHECK(cpuMask != 0);
+    const uint64_t firstCpu = cpuMask & (~cpuMask + 1);
+    GLFM_TEST_CHECK(glfm__setThreadAffinity(threadId, firstCpu));
+    GLFM_TEST_CHECK(glfm__getThreadAffinity(threadId) == firstCpu);
+    GLFM_TEST_CHECK(glfm__setThreadAffinity(threadId, cpuMask));
+    GLFM_TEST_CHECK(glfm__getThreadAffinity(threadId) == cpuMask);
+}
+
+static void *restoreThreadMain(void *param) {
+    (void)param;
+    // A thread with its own priority and affinity, like one the app set up. Raising the nice value
+    // is always permitted.
+    const int32_t threadId = glfm__getThreadId();
+    GLFM_TEST_CHECK(setpriority(PRIO_PROCESS, (id_t)threadId, 5) == 0);
+    const uint64_t cpuMask = glfm__getThreadAffinity(threadId);
+    const uint64_t firstCpu = cpuMask & (~cpuMask + 1);
+    GLFM_TEST_CHECK(glfm__setThreadAffinity(threadId, firstCpu));
+
+    // The default policy leaves a thread that GLFM never changed alone
+    glfm__applyThreadPolicy(threadId, GLFMThreadPolicyDefault);
+    GLFM_TEST_CHECK(getpriority(PRIO_PROCESS, (id_t)threadId) == 5);
+    GLFM_TEST_CHECK(glfm__getThreadAffinity(threadId) == firstCpu);
+
+    // Flags that aren't set are restored to the values from before the first change. The high
+    // priority may not be permitted, but the restore must not lower the nice value either way.
+    glfm__applyThreadPolicy(threadId, GLFMThreadPolicyHighPriority | GLFMThreadPolicyPerformanceCores);
+    GLFM_TEST_CHECK(glfm__getThreadAffinity(threadId) == glfm__getCpuTopology()->performanceCpuMask);
+    glfm__applyThreadPolicy(threadId, GLFMThreadPolicyPerformanceCores);
+    GLFM_TEST_CHECK(getpriority(PRIO_PROCESS, (id_t)threadId) == 5);
+    glfm__applyThreadPolicy(threadId, GLFMThreadPolicyDefault);
+    GLFM_TEST_CHECK(getpriority(PRIO_PROCESS, (id_t)threadId) == 5);
+    GLFM_TEST_CHECK(glfm__getThreadAffinity(threadId) == firstCpu);
+    return NULL;
+}
+
+static void testRestore(void) {
+    // On another thread, so the nice value of the main thread isn't raised
+    pthread_t thread;
+    GLFM_TEST_CHECK(pthread_create(&thread, NULL, restoreThreadMain, NULL) == 0);
+    pthread_join(thread, NULL);
+}
+
+int main(void) {
+    if (!mkdtemp(tempDir)) {
+        perror("mkdtemp");
+        return EXIT_FAILURE;
+    }
+    testPhone();
+    testFrequencies();
+    testSameCores();
+    testMissing();
+    testThisMachine();
+    testRestore();
+
+    char command[512];
+    snprintf(command, sizeof(command), "rm -rf '%s'", tempDir);
+    if (system(command) != 0) {
+        fprintf(stderr, "Could not remove %s\n", tempDir);
+    }
+    return glfmTestResult();
+}
@@ -0,0 +1,318 @@
+// Tests the streamed assets of glfm_emscripten.c under node, with a fake fetch(), IndexedDB, and
+// file system.
+//
+// Usage: node emscripten_assets_test.js path/to/glfm_emscripten.c
+//
+// The JavaScript in glfm__startAssetRequest() is extracted from the source and run for each
+// request. The request state it writes is read back the same way as glfm__updateAssetRequests(),
+// which calls the GLFMAssetFunc with `available` set if the state is
+// GLFMAssetRequestStateAvailable.
+
+'use strict';
+
+const assert = require('assert');
+const harness = require('./emscripten_test_harness.js');
+
+const PATH_PTR = 64;
+const STATE_PTR = 16;
+
+// GLFMAssetRequestState
+const State = { loading: 1, available: 2, failed: 3 };
+
+const script = harness.extractScript(harness.readSource(), 'glfm__startAssetRequest');
+const run = harness.compileScript(script, ['UTF8ToString', 'HEAP32', 'FS', 'Module', 'indexedDB',
+                                           'fetch', 'console']);
+
+// MARK: - Fake browser
+
+function bytes(size, seed) {
+    const data = new Uint8Array(size);
+    for (let i = 0; i < size; i++) {
+        data[i] = (i * 31 + seed) & 0xff;
+    }
+    return data;
+}
+
+/// An IndexedDB with one object store, which is kept between page loads. Requests complete
+/// asynchronously, like in a browser.
+class FakeIndexedDB {
+    constructor() {
+        this.stores = null;
+        this.openFails = false;
+        this.getCount = 0;
+    }
+    open(name, version) {
+        const request = {};
+        setImmediate(() => {
+            if (this.openFails) {
+                request.onerror();
+                return;
+            }
+            request.result = this.createDatabase();
+            if (!this.stores) {
+                this.stores = {};
+                request.onupgradeneeded();
+            }
+            request.onsuccess();
+        });
+        assert.strictEqual(name, 'glfm-assets');
+        assert.strictEqual(version, 1);
+        return request;
+    }
+    createDatabase() {
+        const idb = this;
+        return {
+            createObjectStore: (storeName) => {
+                idb.stores[storeName] = new Map();
+            },
+            transaction: (storeName, mode) => ({
+                objectStore: () => ({
+                    get: (key) => {
+                        idb.getCount++;
+                        const request = {};
+                        setImmediate(() => {
+                            request.result = idb.stores[storeName].get(key);
+                            request.onsuccess();
+                        });
+                        return request;
+                    },
+                    put: (data, key) => {
+                        assert.strictEqual(mode, 'readwrite');
+                        idb.stores[storeName].set(key, data);
+                    },
+                }),
+            }),
+        };
+    }
+    cached(key) {
+        return this.stores ? this.stores['files'].get(key) : undefined;
+    }
+}
+
+/// A web server. Files are served with `status`, which is 200 by default.
+class FakeServer {
+    constructor() {
+        this.files = {};
+        this.status = 200;
+        this.offline = false;
+        this.requests = [];
+        this.fetch = (url) => {
+            this.requests.push(url);
+            if (this.offline) {
+                return Promise.reject(new TypeError('Failed to fetch'));
+            }
+            const data = this.files[url];
+            const status = data ? this.status : 404;
+            return new Promise((resolve) => setImmediate(() => resolve({
+                ok: status === 200,
+                status: status,
+                statusText: status === 200 ? 'OK' : 'Not Found',
+                arrayBuffer: () => Promise.resolve(data.slice().buffer),
+            })));
+        };
+    }
+}
+
+/// A page load: a new Module and file system, with the IndexedDB and server of the browser.
+class FakePage {
+    constructor(browser, manifest, preloadedFiles) {
+        this.browser = browser;
+        this.Module = { glfmAssets: manifest };
+        this.files = new Map(Object.entries(preloadedFiles || {}));
+        this.directories = [];
+        this.warnings = [];
+        this.heap = new harness.FakeHeap(1024);
+        this.FS = {
+            analyzePath: (path) => ({ exists: this.files.has(path) }),
+            mkdirTree: (path) => this.directories.push(path),
+            writeFile: (path, data) => this.files.set(path, data),
+        };
+        this.console = { warn: (message) => this.warnings.push(message) };
+    }
+
+    /// Requests an asset, like glfmRequestAsset(). Returns a promise of the `available` parameter
+    /// of the GLFMAssetFunc.
+    requestAsset(path) {
+        // Each request has its own state in the heap
+        const request = new harness.FakeHeap(1024);
+        request.writeString(PATH_PTR, path);
+        request.HEAP32[STATE_PTR >> 2] = State.loading;
+        run(request.UTF8ToString, request.HEAP32, this.FS, this.Module, this.browser.indexedDB,
+            this.browser.server.fetch, this.console, PATH_PTR, STATE_PTR);
+        return new Promise((resolve, reject) => {
+            let polls = 0;
+            const poll = () => {
+                const state = Atomics.load(request.HEAP32, STATE_PTR >> 2);
+                if (state !== State.loading) {
+                    resolve(state === State.available);
+                } else if (++polls > 1000) {
+                    reject(new Error('Request for ' + path + ' never finished'));
+                } else {
+                    setImmediate(poll);
+                }
+            };
+            poll();
+        });
+    }
+}
+
+function createBrowser() {
+    return { indexedDB: new FakeIndexedDB(), server: new FakeServer() };
+}
+
+const TEXTURE = bytes(5000, 1);
+const SOUND = bytes(300, 2);
+const MANIFEST = {
+    base: 'assets/',
+    files: {
+        'textures/wood floor.png': { hash: 'hash-wood', size: TEXTURE.length },
+        'sound.ogg': { hash: 'hash-sound', size: SOUND.length },
+    },
+};
+
+function createServer(browser) {
+    browser.server.files['assets/textures/wood%20floor.png'] = TEXTURE;
+    browser.server.files['assets/sound.ogg'] = SOUND;
+}
+
+// MARK: - Tests
+
+async function testFetchOnDemand() {
+    const browser = createBrowser();
+    createServer(browser);
+    const page = new FakePage(browser, MANIFEST);
+    assert.strictEqual(browser.server.requests.length, 0);
+
+    assert(await page.requestAsset('textures/wood floor.png'));
+    assert.deepStrictEqual(browser.server.requests, ['assets/textures/wood%20floor.png']);
+    assert.deepStrictEqual(page.files.get('textures/wood floor.png'), TEXTURE);
+    assert.deepStrictEqual(page.directories, ['textures']);
+    assert.deepStrictEqual(new Uint8Array(browser.indexedDB.cached('hash-wood')), TEXTURE);
+
+    // Only requested assets are fetched. A loaded asset is read from the file system.
+    assert(!page.files.has('sound.ogg'));
+    assert(await page.requestAsset('textures/wood floor.png'));
+    assert.strictEqual(browser.server.requests.length, 1);
+
+    // Concurrent requests for the same asset share one fetch
+    const results = await Promise.all([page.requestAsset('sound.ogg'), page.requestAsset('sound.ogg')]);
+    assert.deepStrictEqual(results, [true, true]);
+    assert.deepStrictEqual(browser.server.requests.slice(1), ['assets/sound.ogg']);
+    assert.deepStrictEqual(page.warnings, []);
+}
+
+async function testCacheHit() {
+    const browser = createBrowser();
+    createServer(browser);
+    assert(await new FakePage(browser, MANIFEST).requestAsset('textures/wood floor.png'));
+    assert.strictEqual(browser.server.requests.length, 1);
+
+    // The next page load reads the asset from IndexedDB, even if the server is offline
+    browser.server.offline = true;
+    const page = new FakePage(browser, MANIFEST);
+    assert(await page.requestAsset('textures/wood floor.png'));
+    assert.strictEqual(browser.server.requests.length, 1);
+    assert.deepStrictEqual(page.files.get('textures/wood floor.png'), TEXTURE);
+
+    // A changed asset has a new hash, so the stale entry isn't used
+    browser.server.offline = false;
+    const changed = bytes(TEXTURE.length, 3);
+    browser.server.files['assets/textures/wood%20floor.png'] = changed;
+    const manifest = JSON.parse(JSON.stringify(MANIFEST));
+    manifest.files['textures/wood floor.png'].hash = 'hash-wood-2';
+    const updatedPage = new FakePage(browser, manifest);
+    assert(await updatedPage.requestAsset('textures/wood floor.png'));
+    assert.strictEqual(browser.server.requests.length, 2);
+    assert.deepStrictEqual(updatedPage.files.get('textures/wood floor.png'), changed);
+
+    // A cache entry of the wrong size (for example, a partial write) is fetched again
+    browser.indexedDB.stores['files'].set('hash-sound', bytes(10, 2).buffer);
+    assert(await new FakePage(browser, MANIFEST).requestAsset('sound.ogg'));
+    assert.strictEqual(browser.server.requests.length, 3);
+    assert.strictEqual(browser.indexedDB.cached('hash-sound').byteLength, SOUND.length);
+}
+
+async function testFailure() {
+    const browser = createBrowser();
+    createServer(browser);
+    const page = new FakePage(browser, MANIFEST);
+
+    // Server error: unavailable, and nothing is written or cached
+    browser.server.status = 503;
+    assert(!(await page.requestAsset('sound.ogg')));
+    assert(!page.files.has('sound.ogg'));
+    assert.strictEqual(browser.indexedDB.cached('hash-sound'), undefined);
+    assert.strictEqual(page.warnings.length, 1);
+    assert(page.warnings[0].includes('sound.ogg') && page.warnings[0].includes('503'));
+
+    // A failed request can be retried
+    browser.server.status = 200;
+    assert(await page.requestAsset('sound.ogg'));
+    assert.strictEqual(browser.server.requests.length, 2);
+
+    // Network error
+    browser.server.offline = true;
+    assert(!(await page.requestAsset('textures/wood floor.png')));
+    assert.strictEqual(page.warnings.length, 2);
+
+    // Unexpected size, for example a truncated response
+    browser.server.offline = false;
+    browser.server.files['assets/textures/wood%20floor.png'] = TEXTURE.subarray(0, 100);
+    assert(!(await page.requestAsset('textures/wood floor.png')));
+    assert(!page.files.has('textures/wood floor.png'));
+    assert.strictEqual(browser.indexedDB.cached('hash-wood'), undefined);
+    assert.strictEqual(page.warnings.length, 3);
+
+    // Listed, but missing on the server
+    const manifest = JSON.parse(JSON.stringify(MANIFEST));
+    manifest.files['missing.bin'] = { hash: 'hash-missing', size: 4 };
+    assert(!(await new FakePage(browser, manifest).requestAsset('missing.bin')));
+}
+
+async function testUnlisted() {
+    // Assets that aren't streamed are only checked for existence
+    const browser = createBrowser();
+    createServer(browser);
+    const preloaded = { 'preloaded.txt': bytes(4, 0) };
+    const page = new FakePage(browser, MANIFEST, preloaded);
+    assert(await page.requestAsset('preloaded.txt'));
+    assert(!(await page.requestAsset('unknown.txt')));
+
+    // Without a manifest (no streamed assets)
+    const preloadPage = new FakePage(browser, undefined, preloaded);
+    assert(await preloadPage.requestAsset('preloaded.txt'));
+    assert(!(await preloadPage.requestAsset('sound.ogg')));
+    assert.strictEqual(browser.server.requests.length, 0);
+    assert.strictEqual(browser.indexedDB.stores, null);
+}
+
+async function testWithoutIndexedDB() {
+    // Assets are fetched every time if IndexedDB isn't available or can't be opened
+    const browser = createBrowser();
+    createServer(browser);
+    browser.indexedDB = undefined;
+    assert(await new FakePage(browser, MANIFEST).requestAsset('sound.ogg'));
+    assert(await new FakePage(browser, MANIFEST).requestAsset('sound.ogg'));
+    assert.strictEqual(browser.server.requests.length, 2);
+
+    const blockedBrowser = createBrowser();
+    createServer(blockedBrowser);
+    blockedBrowser.indexedDB.openFails = true;
+    assert(await new FakePage(blockedBrowser, MANIFEST).requestAsset('sound.ogg'));
+    assert.strictEqual(blockedBrowser.server.requests.length, 1);
+    assert.strictEqual(blockedBrowser.indexedDB.getCount, 0);
+}
+
+async function main() {
+    await testFetchOnDemand();
+    await testCacheHit();
+    await testFailure();
+    await testUnlisted();
+    await testWithoutIndexedDB();
+    console.log('Passed');
+}
+
+main().catch((error) => {
+    console.error(error);
+    process.exit(1);
+});
@@ -0,0 +1,156 @@
+// Tests the desynchronized WebGL context request of glfm_emscripten.c under node, with fake
+// canvases whose getContext() supports, ignores, or rejects the `desynchronized` attribute.
+//
+// Usage: node emscripten_context_test.js path/to/glfm_emscripten.c
+//
+// The JavaScript in glfm__setDesynchronizedContextRequested() and glfm__negotiateWebContext() is
+// extracted from the source. Contexts are created like emscripten_webgl_create_context() in
+// main(): WebGL 2 first, then WebGL 1.
+
+'use strict';
+
+const assert = require('assert');
+const harness = require('./emscripten_test_harness.js');
+
+const source = harness.readSource();
+const setRequested = harness.compileScript(
+    harness.extractScript(source, 'glfm__setDesynchronizedContextRequested'),
+    ['HTMLCanvasElement', 'OffscreenCanvas']);
+const negotiate = harness.compileScript(harness.extractScript(source, 'glfm__negotiateWebContext'),
+                                        ['GL']);
+
+// MARK: - Fake browser
+
+/// Creates a canvas class. `desynchronizedSupport` is 'supported', 'ignored' (the attribute is
+/// dropped from the context attributes), or 'rejected' (getContext() returns null).
+function createCanvasClass(desynchronizedSupport, webGL2) {
+    class Canvas {
+        constructor() {
+            this.requests = [];
+        }
+        getContext(type, attributes) {
+            this.requests.push({ type: type, attributes: Object.assign({}, attributes) });
+            if (type === 'webgl2' && !webGL2) {
+                return null;
+            }
+            const desynchronized = !!(attributes && attributes.desynchronized);
+            if (desynchronized && desynchronizedSupport === 'rejected') {
+                return null;
+            }
+            const contextAttributes = Object.assign({}, attributes);
+            if (desynchronizedSupport !== 'supported') {
+                delete contextAttributes.desynchronized;
+            }
+            return { type: type, getContextAttributes: () => contextAttributes };
+        }
+    }
+    Canvas.originalGetContext = Canvas.prototype.getContext;
+    return Canvas;
+}
+
+/// Creates a context like main(), and returns the negotiated `desynchronized` value, like
+/// glfm__negotiateWebContext().
+function createContext(browser, canvas, desynchronized) {
+    setRequested(browser.HTMLCanvasElement, browser.OffscreenCanvas, desynchronized ? 1 : 0);
+    const attributes = { alpha: false, antialias: false, powerPreference: 'high-performance' };
+    let context = canvas.getContext('webgl2', attributes);
+    if (!context) {
+        context = canvas.getContext('webgl', attributes);
+    }
+    setRequested(browser.HTMLCanvasElement, browser.OffscreenCanvas, 0);
+    // The caller's attributes are never changed
+    assert.deepStrictEqual(attributes, { alpha: false, antialias: false, powerPreference: 'high-performance' });
+
+    const GL = { getContext: (handle) => (handle === 1 && context ? { GLctx: context } : null) };
+    return { context: context, desynchronized: negotiate(GL, 1) };
+}
+
+function requestTypes(canvas) {
+    return canvas.requests.map((request) => request.type + (request.attributes.desynchronized ? ' desynchronized' : ''));
+}
+
+// MARK: - Tests
+
+function testSupported() {
+    const Canvas = createCanvasClass('supported', true);
+    const browser = { HTMLCanvasElement: Canvas };
+    const canvas = new Canvas();
+    const result = createContext(browser, canvas, true);
+    assert.strictEqual(result.desynchronized, 1);
+    assert.strictEqual(result.context.type, 'webgl2');
+    assert.deepStrictEqual(requestTypes(canvas), ['webgl2 desynchronized']);
+
+    // The prototype is restored afterwards
+    assert.strictEqual(Canvas.prototype.getContext, Canvas.originalGetContext);
+    assert.strictEqual(Canvas.prototype.glfmGetContext, undefined);
+
+    // Not requested
+    const regularCanvas = new Canvas();
+    assert.strictEqual(createContext(browser, regularCanvas, false).desynchronized, 0);
+    assert.deepStrictEqual(requestTypes(regularCanvas), ['webgl2']);
+
+    // Other context types are unchanged
+    setRequested(Canvas, undefined, 1);
+    const canvas2D = new Canvas();
+    canvas2D.getContext('2d', { alpha: true });
+    assert.deepStrictEqual(canvas2D.requests[0].attributes, { alpha: true });
+    setRequested(Canvas, undefined, 0);
+}
+
+function testRejected() {
+    // A browser that fails to create a desynchronized context falls back to a regular context
+    const Canvas = createCanvasClass('rejected', true);
+    const canvas = new Canvas();
+    const result = createContext({ HTMLCanvasElement: Canvas }, canvas, true);
+    assert(result.context, 'Fallback context');
+    assert.strictEqual(result.context.type, 'webgl2');
+    assert.strictEqual(result.desynchronized, 0);
+    assert.deepStrictEqual(requestTypes(canvas), ['webgl2 desynchronized', 'webgl2']);
+
+    // Without WebGL 2, both the desynchronized and the regular WebGL 2 requests fail before the
+    // WebGL 1 fallback
+    const WebGL1Canvas = createCanvasClass('rejected', false);
+    const webGL1Canvas = new WebGL1Canvas();
+    const webGL1Result = createContext({ HTMLCanvasElement: WebGL1Canvas }, webGL1Canvas, true);
+    assert.strictEqual(webGL1Result.context.type, 'webgl');
+    assert.strictEqual(webGL1Result.desynchronized, 0);
+    assert.deepStrictEqual(requestTypes(webGL1Canvas),
+                           ['webgl2 desynchronized', 'webgl2', 'webgl desynchronized', 'webgl']);
+}
+
+function testIgnored() {
+    // A browser that doesn't know the attribute creates a regular context
+    const Canvas = createCanvasClass('ignored', true);
+    const canvas = new Canvas();
+    const result = createContext({ HTMLCanvasElement: Canvas }, canvas, true);
+    assert.strictEqual(result.context.type, 'webgl2');
+    assert.strictEqual(result.desynchronized, 0);
+    assert.deepStrictEqual(requestTypes(canvas), ['webgl2 desynchronized']);
+}
+
+function testOffscreenCanvas() {
+    // On a worker thread, only OffscreenCanvas exists
+    const Canvas = createCanvasClass('supported', true);
+    const browser = { OffscreenCanvas: Canvas };
+    const canvas = new Canvas();
+    assert.strictEqual(createContext(browser, canvas, true).desynchronized, 1);
+    assert.strictEqual(Canvas.prototype.getContext, Canvas.originalGetContext);
+
+    // Requesting twice doesn't wrap twice
+    setRequested(undefined, Canvas, 1);
+    setRequested(undefined, Canvas, 1);
+    assert.strictEqual(Canvas.prototype.glfmGetContext, Canvas.originalGetContext);
+    setRequested(undefined, Canvas, 0);
+    assert.strictEqual(Canvas.prototype.getContext, Canvas.originalGetContext);
+
+    // No canvas classes, and no context
+    setRequested(undefined, undefined, 1);
+    setRequested(undefined, undefined, 0);
+    assert.strictEqual(negotiate({ getContext: () => null }, 1), 0);
+}
+
+testSupported();
+testRejected();
+testIgnored();
+testOffscreenCanvas();
+console.log('Passed');
@@ -0,0 +1,362 @@
+// Tests the DOM event forwarding of the OffscreenCanvas mode of glfm_emscripten.c under node, with
+// synthetic events.
+//
+// Usage: node emscripten_offscreen_canvas_test.js path/to/glfm_emscripten.c
+//
+// The JavaScript in glfm__startEventForwarding() is extracted from the source and run with a fake
+// window, document, canvas, and heap. Forwarded events are read back from the event ring the same
+// way as glfm__receiveForwardedEvents(), using the GLFMForwardedEvent layout.
+
+'use strict';
+
+const assert = require('assert');
+const harness = require('./emscripten_test_harness.js');
+const FakeTarget = harness.FakeTarget;
+
+const source = harness.readSource();
+const RING_CAPACITY = Number(/#\s*define GLFM_EVENT_RING_CAPACITY (\d+)/.exec(source)[1]);
+const EVENT_SIZE = 112;
+const EVENTS_PTR = 1024;
+const WRITE_INDEX_PTR = EVENTS_PTR + RING_CAPACITY * EVENT_SIZE;
+const READ_INDEX_PTR = WRITE_INDEX_PTR + 4;
+const FLAGS_PTR = WRITE_INDEX_PTR + 8;
+const TIME_ORIGIN = 1700000000000;
+
+// GLFMForwardedEventType
+const Type = {
+    mouseDown: 1, mouseUp: 2, mouseMove: 3, wheel: 4,
+    touchStart: 5, touchMove: 6, touchEnd: 7, touchCancel: 8,
+    keyDown: 9, keyUp: 10, keyPress: 11,
+    focus: 12, blur: 13, visibilityChange: 14, beforeUnload: 15, resize: 16,
+    orientationChange: 17, freeze: 18, resume: 19,
+};
+
+// GLFMForwardedEventFlag
+const Flag = { touch: 1, key: 2, wheel: 4 };
+
+// MARK: - Fake browser
+
+class FakeEvent {
+    constructor(properties) {
+        Object.assign(this, properties);
+        this.defaultPrevented = false;
+    }
+    preventDefault() {
+        this.defaultPrevented = true;
+    }
+}
+
+function createBrowser(options) {
+    const window = new FakeTarget();
+    window.devicePixelRatio = 2;
+    const document = new FakeTarget();
+    document.hidden = false;
+    document.pointerLockElement = null;
+    const canvas = new FakeTarget();
+    canvas.clientWidth = 200;
+    canvas.clientHeight = 100;
+    canvas.getBoundingClientRect = () => ({ left: 10, top: 20, width: 200, height: 100 });
+    const resizeObservers = [];
+    class ResizeObserver {
+        constructor(callback) {
+            this.callback = callback;
+            resizeObservers.push(this);
+        }
+        observe(target) {
+            this.target = target;
+        }
+    }
+    const heap = new harness.FakeHeap(FLAGS_PTR + 64);
+    const browser = {
+        window: window,
+        document: document,
+        canvas: canvas,
+        resizeObservers: resizeObservers,
+        Module: { canvas: canvas },
+        heap: heap,
+        now: 1000,
+        readIndex: 0,
+    };
+    const performance = {
+        timeOrigin: TIME_ORIGIN,
+        now: () => browser.now,
+    };
+    const run = harness.compileScript(harness.extractScript(source, 'glfm__startEventForwarding'),
+                                      ['Module', 'window', 'document', 'HEAP32', 'HEAPU32', 'HEAPF64',
+                                       'stringToUTF8', 'performance', 'ResizeObserver']);
+    run(browser.Module, window, document, heap.HEAP32, heap.HEAPU32, heap.HEAPF64, heap.stringToUTF8,
+        performance, options.resizeObserver === false ? undefined : ResizeObserver,
+        EVENTS_PTR, RING_CAPACITY, EVENT_SIZE, WRITE_INDEX_PTR, READ_INDEX_PTR, FLAGS_PTR,
+        options.keyboard === false ? 0 : 1, options.orientation === false ? 0 : 1);
+    return browser;
+}
+
+/// Sets the flags, like glfm__updateForwardedEventFlags().
+function setFlags(browser, flags) {
+    Atomics.store(browser.heap.HEAP32, FLAGS_PTR >> 2, flags);
+}
+
+/// Reads the events written since the last read, like glfm__receiveForwardedEvents().
+function readEvents(browser) {
+    const heap = browser.heap;
+    const writeIndex = Atomics.load(heap.HEAPU32, WRITE_INDEX_PTR >> 2);
+    const events = [];
+    for (; browser.readIndex !== writeIndex; browser.readIndex = (browser.readIndex + 1) >>> 0) {
+        const offset = EVENTS_PTR + (browser.readIndex % RING_CAPACITY) * EVENT_SIZE;
+        events.push({
+            type: heap.HEAP32[offset >> 2],
+            value0: heap.HEAP32[(offset + 4) >> 2],
+            value1: heap.HEAP32[(offset + 8) >> 2],
+            value2: heap.HEAP32[(offset + 12) >> 2],
+            x: heap.HEAPF64[(offset + 16) >> 3],
+            y: heap.HEAPF64[(offset + 24) >> 3],
+            z: heap.HEAPF64[(offset + 32) >> 3],
+            key: heap.readString(offset + 40, 32),
+            code: heap.readString(offset + 72, 32),
+            time: heap.HEAPF64[(offset + 104) >> 3],
+        });
+        Atomics.store(heap.HEAPU32, READ_INDEX_PTR >> 2, (browser.readIndex + 1) >>> 0);
+    }
+    return events;
+}
+
+// MARK: - Tests
+
+function testStart() {
+    const browser = createBrowser({});
+    // The size is sent when forwarding starts
+    const events = readEvents(browser);
+    assert.strictEqual(events.length, 1);
+    assert.strictEqual(events[0].type, Type.resize);
+    assert.deepStrictEqual([events[0].x, events[0].y, events[0].z], [200, 100, 2]);
+    assert.strictEqual(events[0].time, TIME_ORIGIN + 1000);
+    assert.strictEqual(typeof browser.Module['glfmForwardEvent'], 'function');
+
+    // Mouse events target the window; wheel and touch events target the canvas
+    ['mousedown', 'mouseup', 'mousemove', 'keydown', 'keyup', 'keypress', 'focus', 'blur',
+        'beforeunload', 'resize', 'orientationchange'].forEach((type) => {
+        assert.strictEqual(browser.window.listenerCount(type), 1, type);
+    });
+    ['wheel', 'touchstart', 'touchmove', 'touchend', 'touchcancel'].forEach((type) => {
+        assert.strictEqual(browser.canvas.listenerCount(type), 1, type);
+        // preventDefault() is only possible in a non-passive listener
+        assert.strictEqual(browser.canvas.listenerOptions[type].passive, false, type);
+    });
+    ['visibilitychange', 'freeze', 'resume'].forEach((type) => {
+        assert.strictEqual(browser.document.listenerCount(type), 1, type);
+    });
+    assert.strictEqual(browser.resizeObservers.length, 1);
+    assert.strictEqual(browser.resizeObservers[0].target, browser.canvas);
+
+    // Disabled features don't add listeners
+    const minimal = createBrowser({ keyboard: false, orientation: false, resizeObserver: false });
+    ['keydown', 'keyup', 'keypress', 'orientationchange'].forEach((type) => {
+        assert.strictEqual(minimal.window.listenerCount(type), 0, type);
+    });
+    assert.strictEqual(minimal.window.listenerCount('resize'), 1);
+}
+
+function testMouse() {
+    const browser = createBrowser({});
+    readEvents(browser);
+    setFlags(browser, Flag.touch);
+    const down = new FakeEvent({ button: 2, clientX: 110, clientY: 70, timeStamp: 1500 });
+    const up = new FakeEvent({ button: 2, clientX: 110, clientY: 70, timeStamp: 1516 });
+    const outside = new FakeEvent({ button: 0, clientX: 5, clientY: 70, timeStamp: 1532 });
+    browser.window.dispatch('mousedown', down);
+    browser.window.dispatch('mouseup', up);
+    browser.window.dispatch('mousemove', outside);
+
+    const events = readEvents(browser);
+    assert.strictEqual(events.length, 3);
+    assert.deepStrictEqual([events[0].type, events[0].value0, events[0].value1, events[0].x, events[0].y],
+                           [Type.mouseDown, 2, 1, 100, 50]);
+    assert.strictEqual(events[0].time, TIME_ORIGIN + 1500);
+    assert.strictEqual(events[1].type, Type.mouseUp);
+    assert.deepStrictEqual([events[2].type, events[2].value1, events[2].x], [Type.mouseMove, 0, -5]);
+
+    // Never prevented on mousedown (for iframe support), or outside the canvas
+    assert(!down.defaultPrevented);
+    assert(up.defaultPrevented);
+    assert(!outside.defaultPrevented);
+
+    // Not prevented if the worker doesn't handle touches
+    setFlags(browser, 0);
+    const move = new FakeEvent({ button: 0, clientX: 110, clientY: 70, timeStamp: 1548 });
+    browser.window.dispatch('mousemove', move);
+    assert(!move.defaultPrevented);
+    assert.strictEqual(readEvents(browser).length, 1);
+
+    // With pointer lock, motion is forwarded by the pointer lock listener instead
+    browser.document.pointerLockElement = browser.canvas;
+    browser.window.dispatch('mousemove', new FakeEvent({ button: 0, clientX: 120, clientY: 70 }));
+    assert.strictEqual(readEvents(browser).length, 0);
+}
+
+function testWheel() {
+    const browser = createBrowser({});
+    readEvents(browser);
+    const wheel = new FakeEvent({ clientX: 60, clientY: 45, deltaMode: 1, deltaX: 0.5, deltaY: -3,
+                                  deltaZ: 0, timeStamp: 2000 });
+    browser.canvas.dispatch('wheel', wheel);
+    assert(!wheel.defaultPrevented);
+    setFlags(browser, Flag.wheel);
+    const handledWheel = new FakeEvent({ clientX: 60, clientY: 45, deltaMode: 0, deltaX: 0, deltaY: 1,
+                                         deltaZ: 0, timeStamp: 2016 });
+    browser.canvas.dispatch('wheel', handledWheel);
+    assert(handledWheel.defaultPrevented);
+
+    const events = readEvents(browser);
+    assert.strictEqual(events.length, 2);
+    const event = events[0];
+    assert.deepStrictEqual([event.type, event.value0, event.value2, event.value1],
+                           [Type.wheel, 50, 25, 1]);
+    assert.deepStrictEqual([event.x, event.y, event.z], [0.5, -3, 0]);
+}
+
+function testTouch() {
+    const browser = createBrowser({});
+    readEvents(browser);
+    setFlags(browser, Flag.touch);
+    const start = new FakeEvent({
+        timeStamp: 3000,
+        changedTouches: [
+            { identifier: 7, clientX: 20, clientY: 30 },
+            { identifier: 9, clientX: 110, clientY: 120 },
+        ],
+    });
+    browser.canvas.dispatch('touchstart', start);
+    browser.canvas.dispatch('touchmove', new FakeEvent({
+        timeStamp: 3016, changedTouches: [{ identifier: 9, clientX: 111, clientY: 121 }],
+    }));
+    browser.canvas.dispatch('touchend', new FakeEvent({
+        timeStamp: 3032, changedTouches: [{ identifier: 7, clientX: 20, clientY: 30 }],
+    }));
+    browser.canvas.dispatch('touchcancel', new FakeEvent({
+        timeStamp: 3048, changedTouches: [{ identifier: 9, clientX: 111, clientY: 121 }],
+    }));
+    assert(start.defaultPrevented);
+
+    // One event per changed touch
+    const events = readEvents(browser);
+    assert.deepStrictEqual(events.map((event) => [event.type, event.value0, event.x, event.y]), [
+        [Type.touchStart, 7, 10, 10],
+        [Type.touchStart, 9, 100, 100],
+        [Type.touchMove, 9, 101, 101],
+        [Type.touchEnd, 7, 10, 10],
+        [Type.touchCancel, 9, 101, 101],
+    ]);
+    assert.strictEqual(events[1].time, TIME_ORIGIN + 3000);
+}
+
+function testKeys() {
+    const browser = createBrowser({});
+    readEvents(browser);
+    setFlags(browser, Flag.key);
+    const keyDown = new FakeEvent({ key: 'a', code: 'KeyA', shiftKey: true, altKey: true, repeat: true,
+                                    timeStamp: 4000 });
+    const shortcut = new FakeEvent({ key: 'c', code: 'KeyC', ctrlKey: true, timeStamp: 4016 });
+    const longKey = new FakeEvent({ key: 'x'.repeat(40), code: 'Unidentified', metaKey: true,
+                                    timeStamp: 4032 });
+    browser.window.dispatch('keydown', keyDown);
+    browser.window.dispatch('keydown', shortcut);
+    browser.window.dispatch('keyup', longKey);
+    browser.window.dispatch('keypress', new FakeEvent({ key: 'A', code: 'KeyA', timeStamp: 4048 }));
+
+    // Browser shortcuts keep working
+    assert(keyDown.defaultPrevented);
+    assert(!shortcut.defaultPrevented);
+    assert(!longKey.defaultPrevented);
+
+    const events = readEvents(browser);
+    assert.deepStrictEqual(events.map((event) => [event.type, event.value0, event.value1, event.key, event.code]), [
+        [Type.keyDown, 1 | 4, 1, 'a', 'KeyA'],
+        [Type.keyDown, 2, 0, 'c', 'KeyC'],
+        // Truncated to fit, with a null terminator
+        [Type.keyUp, 8, 0, 'x'.repeat(31), 'Unidentified'],
+        [Type.keyPress, 0, 0, 'A', 'KeyA'],
+    ]);
+
+    // Not prevented if the worker doesn't handle keys
+    setFlags(browser, Flag.touch | Flag.wheel);
+    const unhandled = new FakeEvent({ key: 'b', code: 'KeyB', timeStamp: 4064 });
+    browser.window.dispatch('keydown', unhandled);
+    assert(!unhandled.defaultPrevented);
+}
+
+function testLifecycle() {
+    const browser = createBrowser({});
+    readEvents(browser);
+    browser.window.dispatch('blur', {});
+    browser.window.dispatch('focus', {});
+    browser.document.hidden = true;
+    browser.document.dispatch('visibilitychange', {});
+    browser.document.dispatch('freeze', {});
+    browser.document.dispatch('resume', {});
+    browser.window.dispatch('orientationchange', {});
+    browser.window.dispatch('beforeunload', {});
+    browser.canvas.clientWidth = 300;
+    browser.window.devicePixelRatio = 3;
+    browser.resizeObservers[0].callback([]);
+
+    const events = readEvents(browser);
+    assert.deepStrictEqual(events.map((event) => event.type), [
+        Type.blur, Type.focus, Type.visibilityChange, Type.freeze, Type.resume,
+        Type.orientationChange, Type.beforeUnload, Type.resize,
+    ]);
+    assert.strictEqual(events[2].value0, 1);
+    assert.deepStrictEqual([events[7].x, events[7].y, events[7].z], [300, 100, 3]);
+}
+
+function testFullRing() {
+    const browser = createBrowser({});
+    readEvents(browser);
+    const heap = browser.heap;
+
+    // When the worker thread is busy, new events are dropped, and earlier events are kept
+    const count = RING_CAPACITY + 20;
+    for (let i = 0; i < count; i++) {
+        browser.window.dispatch('mousemove', new FakeEvent({ button: 0, clientX: 10 + i, clientY: 20 }));
+    }
+    let events = readEvents(browser);
+    assert.strictEqual(events.length, RING_CAPACITY);
+    for (let i = 0; i < events.length; i++) {
+        assert.strictEqual(events[i].x, i);
+    }
+
+    // Writing resumes after the worker reads. The write index wraps at 2^32.
+    Atomics.store(heap.HEAPU32, WRITE_INDEX_PTR >> 2, 0xffffffff);
+    Atomics.store(heap.HEAPU32, READ_INDEX_PTR >> 2, 0xffffffff);
+    browser.readIndex = 0xffffffff;
+    browser.window.dispatch('focus', {});
+    browser.window.dispatch('blur', {});
+    assert.strictEqual(Atomics.load(heap.HEAPU32, WRITE_INDEX_PTR >> 2), 1);
+    events = readEvents(browser);
+    assert.deepStrictEqual(events.map((event) => event.type), [Type.focus, Type.blur]);
+}
+
+function benchmark() {
+    const browser = createBrowser({});
+    setFlags(browser, Flag.touch);
+    const event = new FakeEvent({ button: 0, clientX: 100, clientY: 50, timeStamp: 0 });
+    const listener = browser.window.listeners['mousemove'][0];
+    harness.benchmark('Mouse event forward', 1000000, (i) => {
+        event.timeStamp = i;
+        listener(event);
+        if ((i & 127) === 127) {
+            // The worker thread reads once per frame
+            const writeIndex = Atomics.load(browser.heap.HEAPU32, WRITE_INDEX_PTR >> 2);
+            Atomics.store(browser.heap.HEAPU32, READ_INDEX_PTR >> 2, writeIndex);
+        }
+    });
+}
+
+testStart();
+testMouse();
+testWheel();
+testTouch();
+testKeys();
+testLifecycle();
+testFullRing();
+benchmark();
+console.log('Passed');
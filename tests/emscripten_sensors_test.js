@@ -0,0 +1,208 @@
+// Tests the web sensor listeners of glfm_emscripten.c under node, with synthetic events.
+//
+// Usage: node emscripten_sensors_test.js path/to/glfm_emscripten.c
+//
+// The JavaScript in glfm__sensorFuncUpdated() is extracted from the source and run with a fake
+// window and heap. Sensor events are written to the sensor ring, and read back the same way as
+// glfm__sendSensorEvents().
+
+'use strict';
+
+const assert = require('assert');
+const harness = require('./emscripten_test_harness.js');
+const FakeTarget = harness.FakeTarget;
+
+const RING_CAPACITY = 256;
+const RECORD_SIZE = 8;
+const RECORDS_PTR = 1024;
+const WRITE_INDEX_PTR = RECORDS_PTR + RING_CAPACITY * RECORD_SIZE * 8;
+
+// MARK: - Fake browser
+
+function createBrowser(options) {
+    const window = new FakeTarget();
+    if (options.absoluteOrientation) {
+        window.ondeviceorientationabsolute = null;
+    }
+    const magnetometers = [];
+    class Magnetometer extends FakeTarget {
+        constructor(sensorOptions) {
+            super();
+            this.frequency = sensorOptions.frequency;
+            this.started = false;
+            magnetometers.push(this);
+        }
+        start() {
+            this.started = true;
+        }
+        stop() {
+            this.started = false;
+        }
+        read(timestamp, x, y, z) {
+            this.timestamp = timestamp;
+            this.x = x;
+            this.y = y;
+            this.z = z;
+            this.dispatch('reading', {});
+        }
+    }
+    const heap = new harness.FakeHeap(WRITE_INDEX_PTR + 64);
+    return {
+        window: window,
+        magnetometers: magnetometers,
+        Magnetometer: options.magnetometer ? Magnetometer : undefined,
+        Module: {},
+        HEAPU32: heap.HEAPU32,
+        HEAPF64: heap.HEAPF64,
+        readIndex: 0,
+    };
+}
+
+/// Calls the extracted script, like glfm__sensorFuncUpdated() does.
+function updateSensors(script, browser, motionEnabled, orientationEnabled, magnetometerEnabled) {
+    const run = harness.compileScript(script, ['Module', 'window', 'HEAPU32', 'HEAPF64', 'DeviceMotionEvent',
+                                               'DeviceOrientationEvent', 'Magnetometer']);
+    run(browser.Module, browser.window, browser.HEAPU32, browser.HEAPF64, function() {},
+        function() {}, browser.Magnetometer, RECORDS_PTR, WRITE_INDEX_PTR, RING_CAPACITY, RECORD_SIZE,
+        motionEnabled ? 1 : 0, orientationEnabled ? 1 : 0, magnetometerEnabled ? 1 : 0);
+}
+
+/// Reads the records written since the last read, like glfm__sendSensorEvents().
+function readRecords(browser) {
+    const writeIndex = Atomics.load(browser.HEAPU32, WRITE_INDEX_PTR >> 2);
+    if (((writeIndex - browser.readIndex) >>> 0) > RING_CAPACITY) {
+        browser.readIndex = (writeIndex - RING_CAPACITY) >>> 0;
+    }
+    const records = [];
+    for (; browser.readIndex !== writeIndex; browser.readIndex = (browser.readIndex + 1) >>> 0) {
+        const offset = (RECORDS_PTR >> 3) + (browser.readIndex % RING_CAPACITY) * RECORD_SIZE;
+        records.push(Array.from(browser.HEAPF64.subarray(offset, offset + RECORD_SIZE)));
+    }
+    return records;
+}
+
+// MARK: - Tests
+
+function testMotion(script) {
+    const browser = createBrowser({});
+    updateSensors(script, browser, true, false, false);
+    updateSensors(script, browser, true, false, false);
+    assert.strictEqual(browser.window.listenerCount('devicemotion'), 1);
+
+    browser.window.dispatch('devicemotion', {
+        timeStamp: 1500,
+        accelerationIncludingGravity: { x: 1, y: 2, z: 3 },
+        rotationRate: { alpha: 10, beta: 20, gamma: 30 },
+    });
+    browser.window.dispatch('devicemotion', {
+        timeStamp: 1516,
+        accelerationIncludingGravity: { x: 4, y: null, z: 6 },
+        rotationRate: null,
+    });
+    const records = readRecords(browser);
+    assert.deepStrictEqual(records[0], [1, 1.5, 1, 2, 3, 10, 20, 30]);
+    assert.strictEqual(records[1][1], 1.516);
+    assert.strictEqual(records[1][2], 4);
+    assert(isNaN(records[1][3]), 'Missing values are NaN');
+    assert(isNaN(records[1][5]) && isNaN(records[1][6]) && isNaN(records[1][7]));
+    assert.strictEqual(records.length, 2);
+
+    updateSensors(script, browser, false, false, false);
+    assert.strictEqual(browser.window.listenerCount('devicemotion'), 0);
+    browser.window.dispatch('devicemotion', { timeStamp: 1532 });
+    assert.strictEqual(readRecords(browser).length, 0);
+}
+
+function testOrientation(script) {
+    const browser = createBrowser({ absoluteOrientation: true });
+    updateSensors(script, browser, false, true, false);
+    assert.strictEqual(browser.window.listenerCount('deviceorientationabsolute'), 1);
+    assert.strictEqual(browser.window.listenerCount('deviceorientation'), 0);
+    browser.window.dispatch('deviceorientationabsolute', { timeStamp: 2000, alpha: 90, beta: 45, gamma: -30 });
+    // iOS: the compass heading replaces alpha
+    browser.window.dispatch('deviceorientationabsolute', {
+        timeStamp: 2016, alpha: 5, beta: 0, gamma: 0, webkitCompassHeading: 30,
+    });
+    browser.window.dispatch('deviceorientationabsolute', { timeStamp: 2032, alpha: null, beta: null, gamma: null });
+    const records = readRecords(browser);
+    assert.deepStrictEqual(records[0], [2, 2, 90, 45, -30, 0, 0, 0]);
+    assert.strictEqual(records[1][2], 330);
+    assert(isNaN(records[2][2]), 'No orientation hardware');
+    updateSensors(script, browser, false, false, false);
+    assert.strictEqual(browser.window.listenerCount('deviceorientationabsolute'), 0);
+}
+
+function testMagnetometer(script) {
+    const browser = createBrowser({ magnetometer: true });
+    updateSensors(script, browser, true, true, true);
+    updateSensors(script, browser, true, true, true);
+    assert.strictEqual(browser.magnetometers.length, 1);
+    const magnetometer = browser.magnetometers[0];
+    assert(magnetometer.started);
+    magnetometer.read(3000, 20, -5, -40);
+    assert.deepStrictEqual(readRecords(browser), [[3, 3, 20, -5, -40, 0, 0, 0]]);
+
+    // Stopped when only fusion used it, and fusion is no longer needed
+    updateSensors(script, browser, true, true, false);
+    assert(!magnetometer.started);
+    assert.strictEqual(browser.window.listenerCount('devicemotion'), 1);
+
+    // The Generic Sensor API is optional
+    const noSensorApi = createBrowser({ magnetometer: false });
+    updateSensors(script, noSensorApi, false, false, true);
+    assert.strictEqual(noSensorApi.magnetometers.length, 0);
+}
+
+function testBatching(script) {
+    const browser = createBrowser({});
+    updateSensors(script, browser, true, false, false);
+    const count = RING_CAPACITY + 44;
+    for (let i = 0; i < count; i++) {
+        browser.window.dispatch('devicemotion', {
+            timeStamp: i * 10,
+            accelerationIncludingGravity: { x: i, y: 0, z: 0 },
+            rotationRate: null,
+        });
+    }
+    // Samples are batched until read. On overflow, the oldest are dropped.
+    const records = readRecords(browser);
+    assert.strictEqual(records.length, RING_CAPACITY);
+    for (let i = 0; i < records.length; i++) {
+        assert.strictEqual(records[i][2], count - RING_CAPACITY + i);
+    }
+    assert.strictEqual(readRecords(browser).length, 0);
+
+    // The write index wraps at 2^32
+    Atomics.store(browser.HEAPU32, WRITE_INDEX_PTR >> 2, 0xffffffff);
+    browser.readIndex = 0xffffffff;
+    browser.window.dispatch('devicemotion', { timeStamp: 1, accelerationIncludingGravity: { x: 7, y: 0, z: 0 } });
+    browser.window.dispatch('devicemotion', { timeStamp: 2, accelerationIncludingGravity: { x: 8, y: 0, z: 0 } });
+    assert.strictEqual(Atomics.load(browser.HEAPU32, WRITE_INDEX_PTR >> 2), 1);
+    assert.deepStrictEqual(readRecords(browser).map((record) => record[2]), [7, 8]);
+}
+
+function benchmark(script) {
+    const browser = createBrowser({});
+    updateSensors(script, browser, true, false, false);
+    const event = {
+        timeStamp: 0,
+        accelerationIncludingGravity: { x: 1, y: 2, z: 3 },
+        rotationRate: { alpha: 1, beta: 2, gamma: 3 },
+    };
+    const listener = browser.window.listeners['devicemotion'][0];
+    harness.benchmark('Motion event write', 1000000, (i) => {
+        event.timeStamp = i;
+        listener(event);
+        if ((i & 127) === 127) {
+            browser.readIndex = Atomics.load(browser.HEAPU32, WRITE_INDEX_PTR >> 2);
+        }
+    });
+}
+
+const script = harness.extractScript(harness.readSource(), 'glfm__sensorFuncUpdated');
+testMotion(script);
+testOrientation(script);
+testMagnetometer(script);
+testBatching(script);
+benchmark(script);
+console.log('Passed');
@@ -0,0 +1,118 @@
+// Shared code for the node tests of glfm_emscripten.c. The JavaScript in an EM_ASM block of the
+// source is extracted and run with fake browser objects and a fake heap.
+
+'use strict';
+
+const assert = require('assert');
+const fs = require('fs');
+
+/// Returns the source of glfm_emscripten.c, from the path in the command line.
+function readSource() {
+    assert(process.argv.length > 2, 'Usage: node ' + process.argv[1] + ' path/to/glfm_emscripten.c');
+    return fs.readFileSync(process.argv[2], 'utf8');
+}
+
+/// Extracts the JavaScript in the first EM_ASM block of a function. The arguments $0, $1, ... are
+/// renamed to arg0, arg1, ...
+function extractScript(source, functionName) {
+    // The definition, not a declaration: the parameter list is followed by the body
+    const definition = new RegExp('\\n(static )?[\\w ]+\\*?' + functionName + '\\([^;{]*\\)\\s*\\{');
+    const functionStart = source.search(definition);
+    assert(functionStart >= 0, functionName + ' not found');
+    const macro = /EM_ASM\w*\(\s*\{/g;
+    macro.lastIndex = functionStart;
+    const match = macro.exec(source);
+    assert(match, 'EM_ASM not found in ' + functionName);
+    const start = match.index + match[0].length - 1;
+    let depth = 0;
+    let end = start;
+    for (; end < source.length; end++) {
+        if (source[end] === '{') {
+            depth++;
+        } else if (source[end] === '}' && --depth === 0) {
+            break;
+        }
+    }
+    return source.substring(start + 1, end).replace(/\$(\d)/g, 'arg$1');
+}
+
+/// Compiles an extracted script to a function. The names of the globals the script uses are
+/// listed in `globalNames`. The function takes the globals, in order, and then the arguments.
+function compileScript(script, globalNames) {
+    const argNames = [];
+    for (let i = 0; i < 10; i++) {
+        argNames.push('arg' + i);
+    }
+    return new Function(...globalNames, ...argNames, script);
+}
+
+/// An EventTarget that records its listeners, so tests can dispatch events and count listeners.
+class FakeTarget {
+    constructor() {
+        this.listeners = {};
+        this.listenerOptions = {};
+    }
+    addEventListener(type, listener, options) {
+        this.listeners[type] = this.listeners[type] || [];
+        if (this.listeners[type].indexOf(listener) < 0) {
+            this.listeners[type].push(listener);
+            this.listenerOptions[type] = options;
+        }
+    }
+    removeEventListener(type, listener) {
+        this.listeners[type] = (this.listeners[type] || []).filter((l) => l !== listener);
+    }
+    listenerCount(type) {
+        return (this.listeners[type] || []).length;
+    }
+    dispatch(type, event) {
+        (this.listeners[type] || []).slice().forEach((listener) => listener(event));
+    }
+}
+
+/// A fake Emscripten heap with the views and string functions that EM_ASM blocks use.
+class FakeHeap {
+    constructor(size) {
+        this.buffer = new ArrayBuffer(size);
+        this.HEAP32 = new Int32Array(this.buffer);
+        this.HEAPU32 = new Uint32Array(this.buffer);
+        this.HEAPF64 = new Float64Array(this.buffer);
+        this.HEAPU8 = new Uint8Array(this.buffer);
+        this.stringToUTF8 = (string, ptr, maxBytes) => {
+            const bytes = new TextEncoder().encode(string).subarray(0, maxBytes - 1);
+            this.HEAPU8.set(bytes, ptr);
+            this.HEAPU8[ptr + bytes.length] = 0;
+        };
+        this.UTF8ToString = (ptr) => this.readString(ptr, this.HEAPU8.length - ptr);
+    }
+    /// Reads a null-terminated string of at most `maxBytes` bytes.
+    readString(ptr, maxBytes) {
+        let end = ptr;
+        while (end < ptr + maxBytes && this.HEAPU8[end] !== 0) {
+            end++;
+        }
+        return new TextDecoder().decode(this.HEAPU8.subarray(ptr, end));
+    }
+    writeString(ptr, string) {
+        this.stringToUTF8(string, ptr, this.HEAPU8.length - ptr);
+    }
+}
+
+/// Runs `iteration` `count` times, and prints the time per event.
+function benchmark(name, count, iteration) {
+    const start = process.hrtime.bigint();
+    for (let i = 0; i < count; i++) {
+        iteration(i);
+    }
+    const elapsed = Number(process.hrtime.bigint() - start);
+    console.log(name + ': ' + (elapsed / count).toFixed(1) + ' ns/event');
+}
+
+module.exports = {
+    readSource: readSource,
+    extractScript: extractScript,
+    compileScript: compileScript,
+    FakeTarget: FakeTarget,
+    FakeHeap: FakeHeap,
+    benchmark: benchmark,
+};
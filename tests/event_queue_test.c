@@ -0,0 +1,140 @@
+// Tests the event queue used by glfmPollEvents(), and benchmarks its throughput.
+//
+// Events are dispatched with the backend's event time, which is kept in the queued record, not the
+// time the event was queued. When the queue is full, dispatch returns false so that backends report
+// the event to the system as not handled.
+
+#include "glfm_test_platform.h"
+
+#define BENCHMARK_EVENT_COUNT 5000000
+
+static bool onTouch(GLFMDisplay *display, int touch, GLFMTouchPhase phase, double x, double y) {
+    (void)display;
+    (void)touch;
+    (void)phase;
+    (void)x;
+    (void)y;
+    return true;
+}
+
+static void onSensor(GLFMDisplay *display, GLFMSensorEvent event) {
+    (void)display;
+    (void)event;
+}
+
+/// A batch of events that occurred before they are dispatched, like input read once per frame.
+static void testEventTimes(void) {
+    GLFMDisplay *display = glfmTestCreateDisplay();
+    glfmSetEventPollingEnabled(display, true);
+    glfmTestSetTime(10.0);
+    GLFM_TEST_CHECK(glfm__dispatchTouchEvent(display, 9.5, 0, GLFMTouchPhaseBegan, 1.0, 2.0));
+#if GLFM_FEATURE_KEYBOARD
+    GLFM_TEST_CHECK(glfm__dispatchKeyEvent(display, 9.6, GLFMKeyCodeA, GLFMKeyActionPressed, 0));
+    glfm__dispatchCharEvent(display, 9.7, "a");
+#endif
+    GLFM_TEST_CHECK(glfm__dispatchMouseWheelEvent(display, 9.8, 1.0, 2.0, GLFMMouseWheelDeltaLine,
+                                                  0.0, 1.0, 0.0));
+#if GLFM_FEATURE_SENSORS
+    GLFMSensorEvent sensorEvent = { .sensor = GLFMSensorAccelerometer, .timestamp = 1234.0 };
+    glfmSetSensorFunc(display, GLFMSensorAccelerometer, onSensor);
+    glfm__dispatchSensorEvent(display, sensorEvent);
+#endif
+
+    GLFMEvent events[8];
+    int count = glfmPollEvents(display, events, 8);
+    int i = 0;
+    GLFM_TEST_CHECK(events[i].type == GLFMEventTypeTouch && events[i].timestamp == 9.5);
+    i++;
+#if GLFM_FEATURE_KEYBOARD
+    GLFM_TEST_CHECK(events[i].type == GLFMEventTypeKey && events[i].timestamp == 9.6);
+    i++;
+    GLFM_TEST_CHECK(events[i].type == GLFMEventTypeChar && events[i].timestamp == 9.7);
+    i++;
+#endif
+    GLFM_TEST_CHECK(events[i].type == GLFMEventTypeMouseWheel && events[i].timestamp == 9.8);
+    i++;
+#if GLFM_FEATURE_SENSORS
+    // Sensor times may use another timebase, so the queue time is used
+    GLFM_TEST_CHECK(events[i].type == GLFMEventTypeSensor && events[i].timestamp == 10.0);
+    GLFM_TEST_CHECK(events[i].sensor.timestamp == 1234.0);
+    i++;
+#endif
+    GLFM_TEST_CHECK(count == i);
+
+#if GLFM_FEATURE_KEYBOARD
+    // Long strings are split into events with the same time
+    glfm__dispatchCharEvent(display, 9.9, "0123456789abcdefghijklmnopqrstuvwxyz");
+    count = glfmPollEvents(display, events, 8);
+    GLFM_TEST_CHECK(count > 1);
+    for (i = 0; i < count; i++) {
+        GLFM_TEST_CHECK(events[i].timestamp == 9.9);
+    }
+#endif
+    free(display);
+}
+
+static void testFullQueue(void) {
+    GLFMDisplay *display = glfmTestCreateDisplay();
+    glfmSetEventPollingEnabled(display, true);
+    for (int i = 0; i < GLFM_EVENT_QUEUE_CAPACITY; i++) {
+        GLFM_TEST_CHECK(glfm__dispatchTouchEvent(display, (double)i, 0, GLFMTouchPhaseMoved, i, 0.0));
+    }
+    // Dropped, and reported as not handled
+    GLFM_TEST_CHECK(!glfm__dispatchTouchEvent(display, 1000.0, 0, GLFMTouchPhaseEnded, 0.0, 0.0));
+    GLFM_TEST_CHECK(!glfm__dispatchMouseWheelEvent(display, 1000.0, 0.0, 0.0,
+                                                   GLFMMouseWheelDeltaLine, 0.0, 1.0, 0.0));
+#if GLFM_FEATURE_KEYBOARD
+    GLFM_TEST_CHECK(!glfm__dispatchKeyEvent(display, 1000.0, GLFMKeyCodeA, GLFMKeyActionPressed, 0));
+    glfm__dispatchCharEvent(display, 1000.0, "abc");
+#endif
+    GLFM_TEST_CHECK(display->eventQueueCount == GLFM_EVENT_QUEUE_CAPACITY);
+
+    // The oldest events are kept, in order
+    GLFMEvent event;
+    GLFM_TEST_CHECK(glfmPollEvents(display, &event, 1) == 1);
+    GLFM_TEST_CHECK(event.timestamp == 0.0);
+    GLFM_TEST_CHECK(glfm__dispatchTouchEvent(display, 2000.0, 0, GLFMTouchPhaseEnded, 0.0, 0.0));
+    GLFMEvent events[GLFM_EVENT_QUEUE_CAPACITY];
+    GLFM_TEST_CHECK(glfmPollEvents(display, events, GLFM_EVENT_QUEUE_CAPACITY) ==
+                    GLFM_EVENT_QUEUE_CAPACITY);
+    for (int i = 0; i < GLFM_EVENT_QUEUE_CAPACITY - 1; i++) {
+        GLFM_TEST_CHECK(events[i].timestamp == (double)(i + 1));
+    }
+    GLFM_TEST_CHECK(events[GLFM_EVENT_QUEUE_CAPACITY - 1].timestamp == 2000.0);
+
+    // Without polling, the callback's result is returned
+    glfmSetEventPollingEnabled(display, false);
+    GLFM_TEST_CHECK(!glfm__dispatchTouchEvent(display, 0.0, 0, GLFMTouchPhaseBegan, 0.0, 0.0));
+    glfmSetTouchFunc(display, onTouch);
+    GLFM_TEST_CHECK(glfm__dispatchTouchEvent(display, 0.0, 0, GLFMTouchPhaseBegan, 0.0, 0.0));
+    free(display);
+}
+
+/// Dispatches events in batches, polling after each batch like an app polling once per frame.
+static void benchmark(int batchSize) {
+    GLFMDisplay *display = glfmTestCreateDisplay();
+    glfmSetEventPollingEnabled(display, true);
+    GLFMEvent events[GLFM_EVENT_QUEUE_CAPACITY];
+    double checksum = 0.0;
+    const double start = glfmTestGetRealTime();
+    for (int i = 0; i < BENCHMARK_EVENT_COUNT; i += batchSize) {
+        for (int j = 0; j < batchSize; j++) {
+            glfm__dispatchTouchEvent(display, (double)(i + j), 0, GLFMTouchPhaseMoved, (double)j, 0.0);
+        }
+        int count = glfmPollEvents(display, events, GLFM_EVENT_QUEUE_CAPACITY);
+        checksum += events[count - 1].timestamp;
+    }
+    const double elapsed = glfmTestGetRealTime() - start;
+    printf("Batch %3i: %6.2f ns/event, %6.1f million events/s (checksum %g)\n", batchSize,
+           elapsed * 1e9 / BENCHMARK_EVENT_COUNT, BENCHMARK_EVENT_COUNT / elapsed / 1e6, checksum);
+    free(display);
+}
+
+int main(void) {
+    testEventTimes();
+    testFullQueue();
+    benchmark(1);
+    benchmark(16);
+    benchmark(GLFM_EVENT_QUEUE_CAPACITY);
+    return glfmTestResult();
+}
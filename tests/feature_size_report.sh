@@ -0,0 +1,115 @@
+#!/bin/bash
+# Reports the size and startup time of GLFM with each GLFM_FEATURE_* option turned off.
+#
+# Linux: the size is the code and data of libglfm.a, and the startup time is the median time to
+# create a headless display and render its first frame.
+# Emscripten (if emcmake is in the path): the size is the .wasm and .js of the glfm_triangle
+# example. The startup time requires a browser, and isn't measured.
+
+FEATURES="SENSORS CLIPBOARD HAPTICS KEYBOARD MOUSE_CURSOR ORIENTATION KTX2"
+STARTUP_RUNS=21
+GLFM_ROOT=$(cd .. && pwd)
+
+# Usage: feature_options name
+feature_options() {
+    if [ "$1" == "none" ]; then
+        for feature in $FEATURES; do
+            echo "-D GLFM_FEATURE_$feature=OFF"
+        done
+    elif [ "$1" != "all" ]; then
+        echo "-D GLFM_FEATURE_$1=OFF"
+    fi
+}
+
+# Usage: build_linux name
+build_linux() {
+    local dir="build/features/linux_$1"
+    rm -Rf "$dir"
+    mkdir -p "$dir/src"
+    cat > "$dir/src/CMakeLists.txt" << EOF
+cmake_minimum_required(VERSION 3.18.0)
+project(GLFMStartup C)
+add_subdirectory("$GLFM_ROOT" glfm)
+add_executable(startup startup.c)
+target_link_libraries(startup glfm)
+EOF
+    cat > "$dir/src/startup.c" << 'EOF'
+#include "glfm.h"
+#include <stdio.h>
+#include <time.h>
+
+static void onDraw(GLFMDisplay *display) {
+    glfmSwapBuffers(display);
+}
+
+static void startupMain(GLFMDisplay *display) {
+    glfmSetRenderFunc(display, onDraw);
+}
+
+int main(void) {
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    GLFMDisplay *display = glfmCreateDisplay(startupMain, 64, 64, NULL);
+    if (!display || !glfmRunDisplay(display, 1)) {
+        fprintf(stderr, "Couldn't create a headless display\n");
+        return 1;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    glfmDestroyDisplay(display);
+    printf("%ld\n", (long)((end.tv_sec - start.tv_sec) * 1000000 + (end.tv_nsec - start.tv_nsec) / 1000));
+    return 0;
+}
+EOF
+    cmake -S "$dir/src" -B "$dir" -D CMAKE_BUILD_TYPE=Release $(feature_options "$1") > /dev/null || exit $?
+    cmake --build "$dir" > /dev/null 2>&1 || exit $?
+}
+
+# Usage: linux_size name
+linux_size() {
+    size -t "build/features/linux_$1/glfm/libglfm.a" | awk 'END { print $1 + $2 }'
+}
+
+# Usage: linux_startup name. Prints the median startup time in microseconds.
+linux_startup() {
+    for ((i = 0; i < STARTUP_RUNS; i++)); do
+        "build/features/linux_$1/startup" || return
+    done | sort -n | awk '{ times[NR] = $1 } END { if (NR > 0) print times[int((NR + 1) / 2)] }'
+}
+
+echo "Linux"
+printf "%-14s %10s %8s %12s %8s\n" "Build" "Bytes" "Delta" "Startup (us)" "Delta"
+for name in all $FEATURES none; do
+    build_linux "$name"
+    size=$(linux_size "$name")
+    startup=$(linux_startup "$name")
+    if [ "$name" == "all" ]; then
+        base_size=$size
+        base_startup=$startup
+    fi
+    if [ -n "$startup" ] && [ -n "$base_startup" ]; then
+        printf "%-14s %10d %+8d %12d %+8d\n" "$name" "$size" "$((size - base_size))" \
+            "$startup" "$((startup - base_startup))"
+    else
+        printf "%-14s %10d %+8d %12s %8s\n" "$name" "$size" "$((size - base_size))" "n/a" "n/a"
+    fi
+done
+
+echo
+echo "Emscripten"
+if ! type emcmake &> /dev/null; then
+    echo "n/a (emcmake not found)"
+    exit 0
+fi
+printf "%-14s %10s %8s\n" "Build" "Bytes" "Delta"
+for name in all $FEATURES none; do
+    dir="build/features/emscripten_$name"
+    rm -Rf "$dir"
+    emcmake cmake -S .. -B "$dir" -D CMAKE_BUILD_TYPE=Release -D GLFM_BUILD_EXAMPLES=ON \
+        $(feature_options "$name") > /dev/null || exit $?
+    cmake --build "$dir" --target glfm_triangle > /dev/null 2>&1 || exit $?
+    size=$(find "$dir" \( -name "glfm_triangle.wasm" -o -name "glfm_triangle.js" \) -exec cat {} + | wc -c)
+    if [ "$name" == "all" ]; then
+        base_size=$size
+    fi
+    printf "%-14s %10d %+8d\n" "$name" "$size" "$((size - base_size))"
+done
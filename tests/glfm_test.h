@@ -0,0 +1,82 @@
+// GLFM
+// https://github.com/brackeen/glfm
+
+#ifndef GLFM_TEST_H
+#define GLFM_TEST_H
+
+// Checks and timing for the tests in this directory. Tests print their results, and exit with a
+// failure status if any check failed.
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+// The GLFM_FEATURE_* options of the library, passed by CMakeLists.txt when a feature is off. Checks
+// of a feature that is compiled out are skipped.
+#ifndef GLFM_FEATURE_SENSORS
+#define GLFM_FEATURE_SENSORS 1
+#endif
+#ifndef GLFM_FEATURE_CLIPBOARD
+#define GLFM_FEATURE_CLIPBOARD 1
+#endif
+#ifndef GLFM_FEATURE_HAPTICS
+#define GLFM_FEATURE_HAPTICS 1
+#endif
+#ifndef GLFM_FEATURE_KEYBOARD
+#define GLFM_FEATURE_KEYBOARD 1
+#endif
+#ifndef GLFM_FEATURE_MOUSE_CURSOR
+#define GLFM_FEATURE_MOUSE_CURSOR 1
+#endif
+#ifndef GLFM_FEATURE_ORIENTATION
+#define GLFM_FEATURE_ORIENTATION 1
+#endif
+#ifndef GLFM_FEATURE_KTX2
+#define GLFM_FEATURE_KTX2 1
+#endif
+
+static int glfmTestFailureCount = 0;
+
+#define GLFM_TEST_CHECK(condition) do { \
+    if (!(condition)) { \
+        fprintf(stderr, "%s:%i: Check failed: %s\n", __FILE__, __LINE__, #condition); \
+        glfmTestFailureCount++; \
+    } \
+} while (0)
+
+#define GLFM_TEST_CHECK_NEAR(a, b, tolerance) do { \
+    const double glfmTestA = (a); \
+    const double glfmTestB = (b); \
+    if (!(fabs(glfmTestA - glfmTestB) <= (tolerance))) { \
+        fprintf(stderr, "%s:%i: Check failed: %s == %s (%g != %g)\n", __FILE__, __LINE__, #a, #b, \
+                glfmTestA, glfmTestB); \
+        glfmTestFailureCount++; \
+    } \
+} while (0)
+
+/// Returns the exit status of the test.
+static int glfmTestResult(void) {
+    if (glfmTestFailureCount > 0) {
+        fprintf(stderr, "%i check(s) failed\n", glfmTestFailureCount);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+/// Gets the monotonic time, in seconds, for benchmarks.
+static double glfmTestGetRealTime(void) {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (double)time.tv_sec + (double)time.tv_nsec / 1e9;
+}
+
+/// Returns a pseudorandom number from -1 to 1. Deterministic, so that results are repeatable.
+static double glfmTestRandom(void) {
+    static uint32_t state = 1;
+    state = state * 1664525u + 1013904223u;
+    return (double)(state >> 8) / (double)(1u << 23) - 1.0;
+}
+
+#endif
@@ -0,0 +1,58 @@
+// GLFM
+// https://github.com/brackeen/glfm
+
+#ifndef GLFM_TEST_PLATFORM_H
+#define GLFM_TEST_PLATFORM_H
+
+// A fake platform, for testing the code shared by all backends without a display or a GL context.
+// Tests that include this file don't link the glfm library: the shared code is compiled into the
+// test, and this file implements the functions that a backend provides.
+//
+// glfmGetTime() returns a simulated time, which tests set with glfmTestSetTime().
+
+#define GLFM_LOG(...) do { fprintf(stderr, "GLFM: "); fprintf(stderr, __VA_ARGS__); fprintf(stderr, "\n"); } while (0)
+
+#include "glfm_jobs.h"
+#include "glfm_test.h"
+
+static double glfmTestTime = 1.0;
+
+static void glfmTestSetTime(double time) {
+    glfmTestTime = time;
+}
+
+/// Creates a display with no platform data. Destroy with free().
+static GLFMDisplay *glfmTestCreateDisplay(void) {
+    return calloc(1, sizeof(GLFMDisplay));
+}
+
+// MARK: - Backend functions
+
+static void glfm__displayChromeUpdated(GLFMDisplay *display) {
+    (void)display;
+}
+
+static void glfm__sensorFuncUpdated(GLFMDisplay *display) {
+    (void)display;
+}
+
+static void glfm__pointerLockUpdated(GLFMDisplay *display) {
+    display->pointerLocked = display->pointerLockRequested;
+}
+
+double glfmGetTime(void) {
+    return glfmTestTime;
+}
+
+uint64_t glfmSwapBuffers(GLFMDisplay *display) {
+    return display ? glfm__recordSwap(display, 0) : 0;
+}
+
+void glfmSetSupportedInterfaceOrientation(GLFMDisplay *display,
+                                          GLFMInterfaceOrientation supportedOrientations) {
+    if (display) {
+        display->supportedOrientations = supportedOrientations;
+    }
+}
+
+#endif
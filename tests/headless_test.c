@@ -0,0 +1,538 @@
+// Tests headless displays: the output of a rendered scene in each format, the input server, the
+// latency modes, and relative mouse motion.
+//
+// The scene is cleared to a color that changes each frame, with a white 8x4 rectangle in the
+// bottom-left corner. The display size is odd, to test the chroma planes of the Y4M output.
+//
+// Skipped (exit status 77) if no EGL display is available.
+
+#include "glfm.h"
+#include "glfm_test.h"
+#include <errno.h>
+#include <stdbool.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#if GLFM_TEST_HAS_ZLIB
+#  include <zlib.h>
+#endif
+
+#define WIDTH 33
+#define HEIGHT 17
+#define FRAME_COUNT 6
+#define SKIPPED 77
+
+static char tempDir[] = "/tmp/glfm_headless_test_XXXXXX";
+
+typedef struct {
+    GLFMOutputFormat format;
+    char path[256];
+    int frameIndex;
+    bool surfaceError;
+} OutputTest;
+
+static void backgroundColor(int frameIndex, uint8_t rgba[4]) {
+    rgba[0] = (uint8_t)(frameIndex * 16);
+    rgba[1] = 64;
+    rgba[2] = 192;
+    rgba[3] = 255;
+}
+
+static void onSurfaceError(GLFMDisplay *display, const char *message) {
+    OutputTest *test = glfmGetUserData(display);
+    fprintf(stderr, "Surface error: %s\n", message);
+    test->surfaceError = true;
+}
+
+static void onDraw(GLFMDisplay *display) {
+    OutputTest *test = glfmGetUserData(display);
+    uint8_t color[4];
+    backgroundColor(test->frameIndex++, color);
+    glClearColor(color[0] / 255.0f, color[1] / 255.0f, color[2] / 255.0f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+    glEnable(GL_SCISSOR_TEST);
+    glScissor(0, 0, 8, 4);
+    glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+    glDisable(GL_SCISSOR_TEST);
+    glfmSwapBuffers(display);
+}
+
+static void outputMain(GLFMDisplay *display) {
+    OutputTest *test = glfmGetUserData(display);
+    glfmSetDisplayConfig(display, GLFMRenderingAPIOpenGLES3, GLFMColorFormatRGBA8888,
+                         GLFMDepthFormatNone, GLFMStencilFormatNone, GLFMMultisampleNone);
+    glfmSetRenderFunc(display, onDraw);
+    glfmSetSurfaceErrorFunc(display, onSurfaceError);
+    GLFMOutputConfig config = { test->format, test->path, 2, 10.0 };
+    GLFM_TEST_CHECK(glfmSetOutputConfig(display, &config));
+}
+
+/// Renders FRAME_COUNT frames, in two runs. Returns false if no surface could be created.
+static bool renderOutput(GLFMOutputFormat format, const char *fileName) {
+    OutputTest test;
+    memset(&test, 0, sizeof(test));
+    test.format = format;
+    snprintf(test.path, sizeof(test.path), "%s/%s", tempDir, fileName);
+    GLFMDisplay *display = glfmCreateDisplay(outputMain, WIDTH, HEIGHT, &test);
+    if (!glfmRunDisplay(display, FRAME_COUNT / 2) || test.surfaceError) {
+        glfmDestroyDisplay(display);
+        return false;
+    }
+    GLFM_TEST_CHECK(glfmRunDisplay(display, FRAME_COUNT - FRAME_COUNT / 2));
+    glfmDestroyDisplay(display);
+    GLFM_TEST_CHECK(test.frameIndex == FRAME_COUNT);
+    return true;
+}
+
+static uint8_t *readFile(const char *path, size_t *length) {
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        return NULL;
+    }
+    fseek(file, 0, SEEK_END);
+    *length = (size_t)ftell(file);
+    fseek(file, 0, SEEK_SET);
+    uint8_t *data = malloc(*length + 1);
+    if (data && fread(data, 1, *length, file) != *length) {
+        free(data);
+        data = NULL;
+    }
+    fclose(file);
+    return data;
+}
+
+/// Checks a top-to-bottom RGBA frame.
+static void checkFrame(const uint8_t *pixels, int frameIndex) {
+    uint8_t background[4];
+    backgroundColor(frameIndex, background);
+    static const uint8_t white[4] = { 255, 255, 255, 255 };
+    const size_t stride = WIDTH * 4;
+    GLFM_TEST_CHECK(memcmp(pixels, background, 4) == 0);
+    GLFM_TEST_CHECK(memcmp(pixels + (HEIGHT - 1) * stride + (WIDTH - 1) * 4, background, 4) == 0);
+    GLFM_TEST_CHECK(memcmp(pixels + (HEIGHT - 1) * stride, white, 4) == 0);
+    GLFM_TEST_CHECK(memcmp(pixels + (HEIGHT - 4) * stride + 7 * 4, white, 4) == 0);
+    GLFM_TEST_CHECK(memcmp(pixels + (HEIGHT - 5) * stride, background, 4) == 0);
+    GLFM_TEST_CHECK(memcmp(pixels + (HEIGHT - 1) * stride + 8 * 4, background, 4) == 0);
+}
+
+static void testRGBA(void) {
+    char path[256];
+    snprintf(path, sizeof(path), "%s/frames.rgba", tempDir);
+    size_t length = 0;
+    uint8_t *data = readFile(path, &length);
+    GLFM_TEST_CHECK(data != NULL);
+    GLFM_TEST_CHECK(length == (size_t)FRAME_COUNT * WIDTH * HEIGHT * 4);
+    if (data && length == (size_t)FRAME_COUNT * WIDTH * HEIGHT * 4) {
+        for (int i = 0; i < FRAME_COUNT; i++) {
+            checkFrame(data + (size_t)i * WIDTH * HEIGHT * 4, i);
+        }
+    }
+    free(data);
+}
+
+static void testY4M(void) {
+    char path[256];
+    snprintf(path, sizeof(path), "%s/frames.y4m", tempDir);
+    size_t length = 0;
+    uint8_t *data = readFile(path, &length);
+    GLFM_TEST_CHECK(data != NULL);
+    if (!data) {
+        return;
+    }
+    data[length] = '\0';
+    const char *header = "YUV4MPEG2 W33 H17 F10:1 ";
+    GLFM_TEST_CHECK(strncmp((const char *)data, header, strlen(header)) == 0);
+    const uint8_t *frame = memchr(data, '\n', length);
+    const size_t chromaSize = ((WIDTH + 1) / 2) * ((HEIGHT + 1) / 2);
+    const size_t frameSize = WIDTH * HEIGHT + 2 * chromaSize;
+    int frameCount = 0;
+    while (frame && (size_t)(frame + 1 - data) + 6 + frameSize <= length) {
+        frame++;
+        GLFM_TEST_CHECK(memcmp(frame, "FRAME\n", 6) == 0);
+        const uint8_t *yPlane = frame + 6;
+        const uint8_t *uPlane = yPlane + WIDTH * HEIGHT;
+        const uint8_t *vPlane = uPlane + chromaSize;
+
+        // BT.601 limited range: white is Y=235, with neutral chroma
+        uint8_t background[4];
+        backgroundColor(frameCount, background);
+        const double expectedY = 16.0 + (65.481 * background[0] + 128.553 * background[1] +
+                                         24.966 * background[2]) / 255.0;
+        GLFM_TEST_CHECK_NEAR(yPlane[0], expectedY, 1.0);
+        GLFM_TEST_CHECK(yPlane[(HEIGHT - 1) * WIDTH] == 235);
+        GLFM_TEST_CHECK(uPlane[((HEIGHT + 1) / 2 - 1) * ((WIDTH + 1) / 2)] == 128);
+        GLFM_TEST_CHECK(vPlane[((HEIGHT + 1) / 2 - 1) * ((WIDTH + 1) / 2)] == 128);
+        GLFM_TEST_CHECK(uPlane[0] > 128); // Blue
+        frameCount++;
+        frame = yPlane + frameSize - 1;
+    }
+    GLFM_TEST_CHECK(frameCount == FRAME_COUNT);
+    GLFM_TEST_CHECK(frame && (size_t)(frame + 1 - data) == length);
+    free(data);
+}
+
+#if GLFM_TEST_HAS_ZLIB
+
+static uint32_t readBigEndian32(const uint8_t *src) {
+    return ((uint32_t)src[0] << 24) | ((uint32_t)src[1] << 16) | ((uint32_t)src[2] << 8) | src[3];
+}
+
+static void testPNG(void) {
+    static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+    for (int i = 0; i < FRAME_COUNT; i++) {
+        char path[256];
+        snprintf(path, sizeof(path), "%s/frame%03d.png", tempDir, i);
+        size_t length = 0;
+        uint8_t *data = readFile(path, &length);
+        GLFM_TEST_CHECK(data != NULL);
+        if (!data) {
+            continue;
+        }
+        GLFM_TEST_CHECK(length > 8 + 25 + 12 + 12 && memcmp(data, signature, 8) == 0);
+        GLFM_TEST_CHECK(memcmp(data + 12, "IHDR", 4) == 0);
+        GLFM_TEST_CHECK(readBigEndian32(data + 16) == WIDTH);
+        GLFM_TEST_CHECK(readBigEndian32(data + 20) == HEIGHT);
+        GLFM_TEST_CHECK(data[24] == 8 && data[25] == 6);
+        GLFM_TEST_CHECK(readBigEndian32(data + 29) == crc32(0, data + 12, 4 + 13));
+
+        // Decompress the IDAT chunk, and undo the "Up" filter
+        const uint8_t *chunk = data + 33;
+        const uint32_t chunkLength = readBigEndian32(chunk);
+        GLFM_TEST_CHECK(memcmp(chunk + 4, "IDAT", 4) == 0);
+        GLFM_TEST_CHECK(readBigEndian32(chunk + 8 + chunkLength) == crc32(0, chunk + 4, 4 + chunkLength));
+        const size_t stride = WIDTH * 4;
+        uint8_t filtered[(WIDTH * 4 + 1) * HEIGHT];
+        uLongf filteredSize = sizeof(filtered);
+        GLFM_TEST_CHECK(uncompress(filtered, &filteredSize, chunk + 8, chunkLength) == Z_OK);
+        GLFM_TEST_CHECK(filteredSize == sizeof(filtered));
+        uint8_t pixels[WIDTH * 4 * HEIGHT];
+        for (size_t y = 0; y < HEIGHT; y++) {
+            const uint8_t *src = filtered + y * (stride + 1);
+            GLFM_TEST_CHECK(src[0] == 2);
+            for (size_t x = 0; x < stride; x++) {
+                pixels[y * stride + x] = (uint8_t)(src[x + 1] + (y > 0 ? pixels[(y - 1) * stride + x] : 0));
+            }
+        }
+        checkFrame(pixels, i);
+        GLFM_TEST_CHECK(memcmp(chunk + 12 + chunkLength + 4, "IEND", 4) == 0);
+        free(data);
+    }
+}
+
+#endif // GLFM_TEST_HAS_ZLIB
+
+// MARK: - Input server
+
+typedef struct {
+    int touchCount;
+    double touchTime;
+    GLFMSensorEvent accelerometer;
+    int accelerometerCount;
+    GLFMSensorEvent rotation;
+    int rotationCount;
+} InputTest;
+
+static bool onTouch(GLFMDisplay *display, int touch, GLFMTouchPhase phase, double x, double y) {
+    (void)touch;
+    (void)phase;
+    InputTest *test = glfmGetUserData(display);
+    test->touchCount++;
+    GLFM_TEST_CHECK(x == 10.0 && y == 5.0);
+    return true;
+}
+
+static void onSensor(GLFMDisplay *display, GLFMSensorEvent event) {
+    InputTest *test = glfmGetUserData(display);
+    if (event.sensor == GLFMSensorAccelerometer) {
+        test->accelerometer = event;
+        test->accelerometerCount++;
+    } else if (event.sensor == GLFMSensorRotationMatrix) {
+        test->rotation = event;
+        test->rotationCount++;
+    }
+}
+
+static void onInputDraw(GLFMDisplay *display) {
+    glClear(GL_COLOR_BUFFER_BIT);
+    glfmSwapBuffers(display);
+}
+
+static void inputMain(GLFMDisplay *display) {
+    char path[256];
+    snprintf(path, sizeof(path), "%s/input.sock", tempDir);
+    glfmSetRenderFunc(display, onInputDraw);
+    glfmSetTouchFunc(display, onTouch);
+    glfmSetSensorFunc(display, GLFMSensorAccelerometer, onSensor);
+    glfmSetSensorFunc(display, GLFMSensorRotationMatrix, onSensor);
+    GLFM_TEST_CHECK(glfmSetInputServerPath(display, path));
+}
+
+static void otherMain(GLFMDisplay *display) {
+    glfmSetRenderFunc(display, onInputDraw);
+}
+
+static void testInputServer(void) {
+    InputTest test;
+    memset(&test, 0, sizeof(test));
+    GLFMDisplay *display = glfmCreateDisplay(inputMain, WIDTH, HEIGHT, &test);
+
+    int client = socket(AF_UNIX, SOCK_STREAM, 0);
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    snprintf(address.sun_path, sizeof(address.sun_path), "%s/input.sock", tempDir);
+    GLFM_TEST_CHECK(connect(client, (struct sockaddr *)&address, sizeof(address)) == 0);
+
+    // An event with a timestamp, and one without. The device is lying flat, face up.
+    const double sensorTime = glfmGetTime() - 0.5;
+    GLFMInjectedEvent events[2];
+    memset(events, 0, sizeof(events));
+    events[0].type = GLFMInjectedEventTypeSensor;
+    events[0].code = GLFMSensorAccelerometer;
+    events[0].id = 1;
+    events[0].values[2] = -1.0;
+    events[0].timestamp = sensorTime;
+    events[1].type = GLFMInjectedEventTypeTouch;
+    events[1].action = GLFMTouchPhaseBegan;
+    events[1].id = 2;
+    events[1].values[0] = 10.0;
+    events[1].values[1] = 5.0;
+    const double sendTime = glfmGetTime();
+    GLFM_TEST_CHECK(write(client, events, sizeof(events)) == (ssize_t)sizeof(events));
+    GLFM_TEST_CHECK(glfmRunDisplay(display, 1));
+
+    GLFM_TEST_CHECK(test.touchCount == 1);
+#if GLFM_FEATURE_SENSORS
+    GLFM_TEST_CHECK(test.accelerometerCount == 1);
+    GLFM_TEST_CHECK(test.accelerometer.timestamp == sensorTime);
+    GLFM_TEST_CHECK(test.accelerometer.vector.z == -1.0);
+    // Computed with sensor fusion
+    GLFM_TEST_CHECK(test.rotationCount == 1);
+    GLFM_TEST_CHECK(test.rotation.timestamp == sensorTime);
+    GLFM_TEST_CHECK_NEAR(test.rotation.matrix.m22, 1.0, 1e-6);
+#else
+    // Sensor events are acknowledged, but not dispatched
+    GLFM_TEST_CHECK(test.accelerometerCount == 0 && test.rotationCount == 0);
+#endif
+
+    GLFMInjectedEventAck acks[2];
+    size_t received = 0;
+    for (int i = 0; i < 100 && received < sizeof(acks); i++) {
+        ssize_t length = recv(client, (uint8_t *)acks + received, sizeof(acks) - received, MSG_DONTWAIT);
+        if (length > 0) {
+            received += (size_t)length;
+        } else if (length < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+            break;
+        } else {
+            usleep(10000);
+        }
+    }
+    GLFM_TEST_CHECK(received == sizeof(acks));
+    if (received == sizeof(acks)) {
+        GLFM_TEST_CHECK(acks[0].id == 1 && acks[1].id == 2);
+        GLFM_TEST_CHECK(acks[0].eventTime == sensorTime);
+        GLFM_TEST_CHECK(acks[0].receiveTime >= sendTime);
+        GLFM_TEST_CHECK(acks[1].eventTime == acks[1].receiveTime);
+        GLFM_TEST_CHECK(acks[1].presentTime >= acks[1].receiveTime);
+    }
+
+#if GLFM_FEATURE_SENSORS
+    // Remapped to the interface orientation, which is landscape since the display is wider
+    glfmSetSensorRemappingEnabled(display, true);
+    GLFM_TEST_CHECK(glfmGetInterfaceOrientation(display) == GLFMInterfaceOrientationLandscapeRight);
+    events[0].values[0] = 1.0;
+    events[0].values[2] = 0.0;
+    events[0].timestamp = 0.0;
+    GLFM_TEST_CHECK(write(client, events, sizeof(events[0])) == (ssize_t)sizeof(events[0]));
+    GLFM_TEST_CHECK(glfmRunDisplay(display, 1));
+    GLFM_TEST_CHECK(test.accelerometerCount == 2);
+    GLFM_TEST_CHECK(test.accelerometer.timestamp >= sendTime);
+    GLFM_TEST_CHECK_NEAR(test.accelerometer.vector.x, 0.0, 0.0);
+    GLFM_TEST_CHECK_NEAR(test.accelerometer.vector.y, 1.0, 0.0);
+#endif
+
+    // Another display can't take over the socket of a running server, but replaces a stale one
+    GLFMDisplay *other = glfmCreateDisplay(otherMain, WIDTH, HEIGHT, NULL);
+    GLFM_TEST_CHECK(!glfmSetInputServerPath(other, address.sun_path));
+    struct sockaddr_un staleAddress;
+    memset(&staleAddress, 0, sizeof(staleAddress));
+    staleAddress.sun_family = AF_UNIX;
+    snprintf(staleAddress.sun_path, sizeof(staleAddress.sun_path), "%s/stale.sock", tempDir);
+    int stale = socket(AF_UNIX, SOCK_STREAM, 0);
+    GLFM_TEST_CHECK(bind(stale, (struct sockaddr *)&staleAddress, sizeof(staleAddress)) == 0);
+    close(stale);
+    GLFM_TEST_CHECK(glfmSetInputServerPath(other, staleAddress.sun_path));
+    GLFM_TEST_CHECK(glfmSetInputServerPath(other, NULL));
+    glfmDestroyDisplay(other);
+
+    // The running server still works
+    GLFM_TEST_CHECK(write(client, &events[1], sizeof(events[1])) == (ssize_t)sizeof(events[1]));
+    GLFM_TEST_CHECK(glfmRunDisplay(display, 1));
+    GLFM_TEST_CHECK(test.touchCount == 2);
+
+    close(client);
+    glfmDestroyDisplay(display);
+}
+
+// MARK: - Latency modes
+
+typedef struct {
+    double frameTime;
+    double targetPresentTime;
+} LatencyTest;
+
+static void onLatencyDraw(GLFMDisplay *display) {
+    LatencyTest *test = glfmGetUserData(display);
+    test->frameTime = glfmGetFrameTime(display);
+    test->targetPresentTime = glfmGetTargetPresentTime(display);
+    glClear(GL_COLOR_BUFFER_BIT);
+    glfmSwapBuffers(display);
+}
+
+static void latencyMain(GLFMDisplay *display) {
+    glfmSetRenderFunc(display, onLatencyDraw);
+    // A fixed frame rate, so that the frame interval is exact
+    GLFMOutputConfig config = { GLFMOutputFormatRGBA, "/dev/null", 0, 10.0 };
+    GLFM_TEST_CHECK(glfmSetOutputConfig(display, &config));
+}
+
+/// The swap interval and the target present time of each latency mode. The swap interval is set
+/// on the EGL surface each frame.
+static void testLatencyModes(void) {
+    static const struct {
+        GLFMLatencyMode mode;
+        int defaultSwapInterval;
+        int queuedFrameCount;
+    } modes[] = {
+        { GLFMLatencyModeBalanced, 1, 1 },
+        { GLFMLatencyModeLowLatency, 0, 1 },
+        { GLFMLatencyModeThroughput, 1, 2 },
+    };
+    LatencyTest test;
+    memset(&test, 0, sizeof(test));
+    GLFMDisplay *display = glfmCreateDisplay(latencyMain, WIDTH, HEIGHT, &test);
+    GLFM_TEST_CHECK(glfmGetLatencyMode(display) == GLFMLatencyModeBalanced);
+    for (size_t i = 0; i < sizeof(modes) / sizeof(*modes); i++) {
+        glfmSetLatencyMode(display, modes[i].mode);
+        GLFM_TEST_CHECK(glfmGetLatencyMode(display) == modes[i].mode);
+        GLFM_TEST_CHECK(glfmGetSwapInterval(display) == modes[i].defaultSwapInterval);
+        GLFM_TEST_CHECK(glfmRunDisplay(display, 3));
+        GLFM_TEST_CHECK_NEAR(test.targetPresentTime - test.frameTime,
+                             0.1 * modes[i].queuedFrameCount, 1e-9);
+
+        // An explicit interval overrides the mode, until it is reset with a negative interval
+        for (int swapInterval = 0; swapInterval <= 2; swapInterval++) {
+            glfmSetSwapInterval(display, swapInterval);
+            GLFM_TEST_CHECK(glfmGetSwapInterval(display) == swapInterval);
+            GLFM_TEST_CHECK(glfmRunDisplay(display, 1));
+        }
+        glfmSetSwapInterval(display, -1);
+        GLFM_TEST_CHECK(glfmGetSwapInterval(display) == modes[i].defaultSwapInterval);
+    }
+    glfmDestroyDisplay(display);
+}
+
+// MARK: - Relative mouse
+
+typedef struct {
+    int relativeMouseCount;
+    double deltaX, deltaY;
+    double snapshotDeltaX, snapshotDeltaY;
+} RelativeMouseTest;
+
+static void onRelativeMouse(GLFMDisplay *display, double deltaX, double deltaY) {
+    RelativeMouseTest *test = glfmGetUserData(display);
+    test->relativeMouseCount++;
+    test->deltaX = deltaX;
+    test->deltaY = deltaY;
+}
+
+static void onRelativeMouseDraw(GLFMDisplay *display) {
+    RelativeMouseTest *test = glfmGetUserData(display);
+    const GLFMInputSnapshot *snapshot = glfmGetInputSnapshot(display);
+    test->snapshotDeltaX = snapshot->mouseDeltaX;
+    test->snapshotDeltaY = snapshot->mouseDeltaY;
+    glClear(GL_COLOR_BUFFER_BIT);
+    glfmSwapBuffers(display);
+}
+
+static void relativeMouseMain(GLFMDisplay *display) {
+    char path[256];
+    snprintf(path, sizeof(path), "%s/mouse.sock", tempDir);
+    glfmSetRenderFunc(display, onRelativeMouseDraw);
+    glfmSetRelativeMouseFunc(display, onRelativeMouse);
+    glfmSetInputSnapshotEnabled(display, true);
+    glfmSetPointerLocked(display, true);
+    GLFM_TEST_CHECK(glfmSetInputServerPath(display, path));
+}
+
+/// Sub-pixel deltas injected within one frame are sent once, as their sum, at the next frame.
+static void testRelativeMouse(void) {
+    RelativeMouseTest test;
+    memset(&test, 0, sizeof(test));
+    GLFMDisplay *display = glfmCreateDisplay(relativeMouseMain, WIDTH, HEIGHT, &test);
+    GLFM_TEST_CHECK(glfmIsPointerLocked(display));
+
+    int client = socket(AF_UNIX, SOCK_STREAM, 0);
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    snprintf(address.sun_path, sizeof(address.sun_path), "%s/mouse.sock", tempDir);
+    GLFM_TEST_CHECK(connect(client, (struct sockaddr *)&address, sizeof(address)) == 0);
+
+    static const double deltas[3][2] = { { 0.25, -0.5 }, { 0.25, 0.125 }, { 0.3, 0.0 } };
+    GLFMInjectedEvent events[3];
+    memset(events, 0, sizeof(events));
+    for (int i = 0; i < 3; i++) {
+        events[i].type = GLFMInjectedEventTypeRelativeMouse;
+        events[i].id = (uint64_t)i + 1;
+        events[i].values[0] = deltas[i][0];
+        events[i].values[1] = deltas[i][1];
+    }
+    GLFM_TEST_CHECK(write(client, events, sizeof(events)) == (ssize_t)sizeof(events));
+    GLFM_TEST_CHECK(glfmRunDisplay(display, 1));
+    GLFM_TEST_CHECK(test.relativeMouseCount == 1);
+    GLFM_TEST_CHECK_NEAR(test.deltaX, 0.8, 1e-12);
+    GLFM_TEST_CHECK_NEAR(test.deltaY, -0.375, 1e-12);
+    GLFM_TEST_CHECK_NEAR(test.snapshotDeltaX, 0.8, 1e-12);
+    GLFM_TEST_CHECK_NEAR(test.snapshotDeltaY, -0.375, 1e-12);
+
+    // No motion on the next frame
+    GLFM_TEST_CHECK(glfmRunDisplay(display, 1));
+    GLFM_TEST_CHECK(test.relativeMouseCount == 1);
+    GLFM_TEST_CHECK(test.snapshotDeltaX == 0.0 && test.snapshotDeltaY == 0.0);
+
+    close(client);
+    glfmDestroyDisplay(display);
+}
+
+int main(void) {
+    if (!mkdtemp(tempDir)) {
+        perror("mkdtemp");
+        return EXIT_FAILURE;
+    }
+    if (!renderOutput(GLFMOutputFormatRGBA, "frames.rgba")) {
+        printf("Skipped: no EGL display\n");
+        rmdir(tempDir);
+        return SKIPPED;
+    }
+    testRGBA();
+    GLFM_TEST_CHECK(renderOutput(GLFMOutputFormatY4M, "frames.y4m"));
+    testY4M();
+#if GLFM_TEST_HAS_ZLIB
+    GLFM_TEST_CHECK(renderOutput(GLFMOutputFormatPNG, "frame%03d.png"));
+    testPNG();
+#endif
+    testInputServer();
+    testLatencyModes();
+    testRelativeMouse();
+
+    char command[512];
+    snprintf(command, sizeof(command), "rm -rf '%s'", tempDir);
+    if (system(command) != 0) {
+        fprintf(stderr, "Could not remove %s\n", tempDir);
+    }
+    return glfmTestResult();
+}
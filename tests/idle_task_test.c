@@ -0,0 +1,171 @@
+// Tests the idle task scheduler with a simulated clock: priority order, deadlines, cancellation,
+// and the deadline when frame times are simulated, as with a fixed output frame rate on Linux.
+
+#include "glfm_test_platform.h"
+
+#define FRAME_INTERVAL (1.0 / 60.0)
+#define STEP_DURATION 0.002
+
+static char taskLog[256];
+static int taskLogLength;
+
+static void clearLog(void) {
+    taskLogLength = 0;
+    taskLog[0] = '\0';
+}
+
+static void logTask(char tag) {
+    if (taskLogLength < (int)sizeof(taskLog) - 1) {
+        taskLog[taskLogLength++] = tag;
+        taskLog[taskLogLength] = '\0';
+    }
+}
+
+/// Logs its tag, and takes 1 ms.
+static bool taggedTask(GLFMDisplay *display, void *userData, double deadline) {
+    (void)display;
+    (void)deadline;
+    logTask(*(const char *)userData);
+    glfmTestSetTime(glfmGetTime() + 0.001);
+    return true;
+}
+
+/// Does the remaining steps until the deadline. Each step takes STEP_DURATION.
+static bool stepTask(GLFMDisplay *display, void *userData, double deadline) {
+    (void)display;
+    int *remainingSteps = userData;
+    do {
+        glfmTestSetTime(glfmGetTime() + STEP_DURATION);
+        (*remainingSteps)--;
+        logTask('s');
+    } while (*remainingSteps > 0 && glfmGetTime() < deadline);
+    return *remainingSteps == 0;
+}
+
+static bool cancellingTask(GLFMDisplay *display, void *userData, double deadline) {
+    (void)deadline;
+    glfmCancelIdleTask(display, cancellingTask, userData);
+    logTask('X');
+    return false;
+}
+
+static bool reschedulingTask(GLFMDisplay *display, void *userData, double deadline) {
+    (void)deadline;
+    int *count = userData;
+    logTask('R');
+    if (++(*count) < 3) {
+        glfmScheduleIdleTask(display, reschedulingTask, userData, GLFMIdleTaskPriorityLow);
+    }
+    return true;
+}
+
+/// Starts a frame at `frameTime`, and spends `renderDuration` rendering it.
+static void renderFrame(GLFMDisplay *display, double frameTime, double renderDuration) {
+    glfmTestSetTime(frameTime);
+    glfm__setFrameTime(display, frameTime, 0.0);
+    glfmTestSetTime(frameTime + renderDuration);
+}
+
+static void testPriorityOrder(void) {
+    GLFMDisplay *display = glfmTestCreateDisplay();
+    static char a = 'a', b = 'b', c = 'c';
+    GLFM_TEST_CHECK(glfmScheduleIdleTask(display, taggedTask, &a, GLFMIdleTaskPriorityLow));
+    GLFM_TEST_CHECK(glfmScheduleIdleTask(display, taggedTask, &b, GLFMIdleTaskPriorityHigh));
+    GLFM_TEST_CHECK(glfmScheduleIdleTask(display, taggedTask, &c, GLFMIdleTaskPriorityNormal));
+    GLFM_TEST_CHECK(glfmScheduleIdleTask(display, taggedTask, &a, GLFMIdleTaskPriorityHigh));
+    GLFM_TEST_CHECK(glfmGetIdleTaskCount(display) == 4);
+    clearLog();
+    renderFrame(display, 1.0, 0.004);
+    glfm__runIdleTasks(display, glfm__getIdleDeadline(display));
+    GLFM_TEST_CHECK(strcmp(taskLog, "baca") == 0);
+    GLFM_TEST_CHECK(glfmGetIdleTaskCount(display) == 0);
+    free(display);
+}
+
+/// A long task yields at each deadline, and other tasks run after it completes.
+static void testDeadlines(void) {
+    GLFMDisplay *display = glfmTestCreateDisplay();
+    static char c = 'c';
+    int remainingSteps = 20;
+    glfmScheduleIdleTask(display, stepTask, &remainingSteps, GLFMIdleTaskPriorityNormal);
+    glfmScheduleIdleTask(display, taggedTask, &c, GLFMIdleTaskPriorityNormal);
+    clearLog();
+    int frame = 0;
+    for (; frame < 10 && glfmGetIdleTaskCount(display) > 0; frame++) {
+        const double frameTime = 1.0 + frame * FRAME_INTERVAL;
+        renderFrame(display, frameTime, 0.008);
+        glfm__runIdleTasks(display, glfm__getIdleDeadline(display));
+        // At most one step over the deadline
+        GLFM_TEST_CHECK(glfmGetTime() < frameTime + FRAME_INTERVAL - GLFM_IDLE_TASK_MARGIN +
+                        STEP_DURATION);
+    }
+    GLFM_TEST_CHECK(remainingSteps == 0);
+    GLFM_TEST_CHECK(taskLog[taskLogLength - 1] == 'c');
+    GLFM_TEST_CHECK(frame > 2);
+
+    // When the frame is over budget, one task still runs
+    static char a = 'a', b = 'b';
+    glfmScheduleIdleTask(display, taggedTask, &a, GLFMIdleTaskPriorityLow);
+    glfmScheduleIdleTask(display, taggedTask, &b, GLFMIdleTaskPriorityLow);
+    clearLog();
+    renderFrame(display, 2.0, 0.05);
+    glfm__runIdleTasks(display, glfm__getIdleDeadline(display));
+    GLFM_TEST_CHECK(strcmp(taskLog, "a") == 0);
+    glfmCancelIdleTask(display, taggedTask, &b);
+    GLFM_TEST_CHECK(glfmGetIdleTaskCount(display) == 0);
+    free(display);
+}
+
+static void testCancelAndReschedule(void) {
+    GLFMDisplay *display = glfmTestCreateDisplay();
+    int rescheduleCount = 0;
+    glfmScheduleIdleTask(display, cancellingTask, NULL, GLFMIdleTaskPriorityHigh);
+    glfmScheduleIdleTask(display, reschedulingTask, &rescheduleCount, GLFMIdleTaskPriorityLow);
+    clearLog();
+    renderFrame(display, 3.0, 0.0);
+    glfm__runIdleTasks(display, glfm__getIdleDeadline(display));
+    glfm__runIdleTasks(display, glfm__getIdleDeadline(display));
+    GLFM_TEST_CHECK(strcmp(taskLog, "XRRR") == 0);
+    GLFM_TEST_CHECK(glfmGetIdleTaskCount(display) == 0);
+
+    static char a = 'a';
+    int scheduledCount = 0;
+    while (glfmScheduleIdleTask(display, taggedTask, &a, GLFMIdleTaskPriorityLow)) {
+        scheduledCount++;
+    }
+    GLFM_TEST_CHECK(scheduledCount == GLFM_IDLE_TASK_CAPACITY);
+    free(display);
+}
+
+/// With a fixed frame rate, frame times start at zero and advance one interval per frame, however
+/// long the frame takes. The deadline is measured from the real start of the frame.
+static void testSimulatedFrameTime(void) {
+    GLFMDisplay *display = glfmTestCreateDisplay();
+    int remainingSteps = 1000;
+    glfmScheduleIdleTask(display, stepTask, &remainingSteps, GLFMIdleTaskPriorityNormal);
+    double realTime = 50.0;
+    for (int frame = 0; frame < 4; frame++) {
+        const double frameTime = frame * FRAME_INTERVAL;
+        glfmTestSetTime(realTime);
+        glfm__setFrameTime(display, frameTime, frameTime + FRAME_INTERVAL);
+        glfmTestSetTime(realTime + 0.004);
+        const int stepsBefore = remainingSteps;
+        glfm__runIdleTasks(display, glfm__getIdleDeadline(display));
+
+        // The steps fill the rest of the frame interval: (16.7 - 4 - 1) / 2 ms, rounded up
+        GLFM_TEST_CHECK(stepsBefore - remainingSteps == 6);
+        GLFM_TEST_CHECK_NEAR(glfm__getIdleDeadline(display),
+                             realTime + FRAME_INTERVAL - GLFM_IDLE_TASK_MARGIN, 1e-9);
+        realTime += 1.0;
+    }
+    glfmCancelIdleTask(display, stepTask, &remainingSteps);
+    free(display);
+}
+
+int main(void) {
+    testPriorityOrder();
+    testDeadlines();
+    testCancelAndReschedule();
+    testSimulatedFrameTime();
+    return glfmTestResult();
+}
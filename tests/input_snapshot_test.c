@@ -0,0 +1,69 @@
+// Tests the input snapshot returned by glfmGetInputSnapshot().
+//
+// Touch velocity is measured with the time each event occurred, so events that are dispatched
+// together, for example when the platform batches input once per frame, have the same velocity as
+// events dispatched as they occur.
+
+#include "glfm_test_platform.h"
+
+static void testBatchedVelocity(void) {
+    GLFMDisplay *display = glfmTestCreateDisplay();
+    glfmSetInputSnapshotEnabled(display, true);
+    glfmTestSetTime(2.0);
+    glfm__dispatchTouchEvent(display, 1.00, 0, GLFMTouchPhaseBegan, 10.0, 20.0);
+    glfm__dispatchTouchEvent(display, 1.01, 0, GLFMTouchPhaseMoved, 12.0, 19.0);
+    glfm__swapInputSnapshot(display);
+
+    const GLFMTouchState *touch = &glfmGetInputSnapshot(display)->touches[0];
+    GLFM_TEST_CHECK(touch->active);
+    GLFM_TEST_CHECK(touch->phase == GLFMTouchPhaseMoved);
+    GLFM_TEST_CHECK(touch->timestamp == 1.01);
+    GLFM_TEST_CHECK_NEAR(touch->velocityX, 200.0, 1e-6);
+    GLFM_TEST_CHECK_NEAR(touch->velocityY, -100.0, 1e-6);
+
+    // Events with the same time keep the previous velocity
+    glfm__dispatchTouchEvent(display, 1.01, 0, GLFMTouchPhaseMoved, 50.0, 50.0);
+    glfm__swapInputSnapshot(display);
+    GLFM_TEST_CHECK_NEAR(touch->velocityX, 200.0, 1e-6);
+    GLFM_TEST_CHECK(touch->x == 50.0);
+
+    glfm__dispatchTouchEvent(display, 1.02, 0, GLFMTouchPhaseEnded, 50.0, 50.0);
+    glfm__swapInputSnapshot(display);
+    GLFM_TEST_CHECK(!touch->active);
+    GLFM_TEST_CHECK(touch->velocityX == 0.0 && touch->velocityY == 0.0);
+    free(display);
+}
+
+#if GLFM_FEATURE_KEYBOARD
+
+static void testSnapshotIsPerFrame(void) {
+    GLFMDisplay *display = glfmTestCreateDisplay();
+    glfmSetInputSnapshotEnabled(display, true);
+    glfm__dispatchKeyEvent(display, 1.0, GLFMKeyCodeA, GLFMKeyActionPressed, GLFMKeyModifierShift);
+    const GLFMInputSnapshot *snapshot = glfmGetInputSnapshot(display);
+    GLFM_TEST_CHECK(!glfmIsKeyDown(snapshot, GLFMKeyCodeA));
+    glfm__swapInputSnapshot(display);
+    GLFM_TEST_CHECK(glfmIsKeyDown(snapshot, GLFMKeyCodeA));
+    GLFM_TEST_CHECK(snapshot->modifiers == GLFMKeyModifierShift);
+
+    // Out-of-range touches are not tracked
+    glfm__dispatchTouchEvent(display, 1.0, GLFM_INPUT_SNAPSHOT_MAX_TOUCHES, GLFMTouchPhaseBegan,
+                             0.0, 0.0);
+    glfm__releaseInputState(display);
+    glfm__swapInputSnapshot(display);
+    GLFM_TEST_CHECK(!glfmIsKeyDown(snapshot, GLFMKeyCodeA));
+
+    glfmSetInputSnapshotEnabled(display, false);
+    GLFM_TEST_CHECK(snapshot->modifiers == 0);
+    free(display);
+}
+
+#endif // GLFM_FEATURE_KEYBOARD
+
+int main(void) {
+    testBatchedVelocity();
+#if GLFM_FEATURE_KEYBOARD
+    testSnapshotIsPerFrame();
+#endif
+    return glfmTestResult();
+}
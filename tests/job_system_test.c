@@ -0,0 +1,192 @@
+// Tests the job system: counters, dependencies, nested jobs, glfmParallelFor(), and the frame job
+// counter of a headless display. Benchmarks glfmParallelFor() with three worker threads.
+//
+// The display tests are skipped if no EGL display is available.
+
+#include "glfm.h"
+#include "glfm_test.h"
+#include <stdbool.h>
+#include <unistd.h>
+
+#define LOOP_COUNT (1 << 14)
+#define LOOP_WORK 100
+#define NESTED_JOB_COUNT 50
+#define NESTED_CHILD_COUNT 100
+#define FRAME_COUNT 10
+
+static double loopOutput[LOOP_COUNT];
+
+static double loopIteration(int i) {
+    double x = i;
+    for (int k = 0; k < LOOP_WORK; k++) {
+        x = sin(x) + 1.0001;
+    }
+    return x;
+}
+
+static void loopRange(void *userData, int start, int end) {
+    (void)userData;
+    for (int i = start; i < end; i++) {
+        loopOutput[i] = loopIteration(i);
+    }
+}
+
+static void testParallelFor(void) {
+    for (int chunkSize = 0; chunkSize <= 1000; chunkSize += 1000) {
+        for (int i = 0; i < LOOP_COUNT; i++) {
+            loopOutput[i] = 0.0;
+        }
+        glfmParallelFor(LOOP_COUNT, chunkSize, loopRange, NULL);
+        int mismatchCount = 0;
+        for (int i = 0; i < LOOP_COUNT; i++) {
+            mismatchCount += loopOutput[i] != loopIteration(i);
+        }
+        GLFM_TEST_CHECK(mismatchCount == 0);
+    }
+    glfmParallelFor(0, 0, loopRange, NULL);
+}
+
+// MARK: - Dependencies
+
+static int dependencyComplete;
+static int dependentCount;
+static int dependentsAfterDependency;
+
+static void dependencyJob(void *userData) {
+    (void)userData;
+    usleep(20000);
+    __atomic_store_n(&dependencyComplete, 1, __ATOMIC_SEQ_CST);
+}
+
+static void dependentJob(void *userData) {
+    (void)userData;
+    if (__atomic_load_n(&dependencyComplete, __ATOMIC_SEQ_CST)) {
+        __atomic_add_fetch(&dependentsAfterDependency, 1, __ATOMIC_SEQ_CST);
+    }
+    __atomic_add_fetch(&dependentCount, 1, __ATOMIC_SEQ_CST);
+}
+
+static void testDependencies(void) {
+    GLFMJobCounter *dependency = glfmCreateJobCounter();
+    GLFMJobCounter *counter = glfmCreateJobCounter();
+    GLFM_TEST_CHECK(glfmIsJobCounterComplete(dependency));
+    glfmRunJob(dependencyJob, NULL, dependency);
+    glfmRunJobAfter(dependency, dependentJob, NULL, counter);
+    glfmRunJobAfter(dependency, dependentJob, NULL, counter);
+    glfmWaitForJobCounter(counter);
+    GLFM_TEST_CHECK(glfmIsJobCounterComplete(dependency));
+    GLFM_TEST_CHECK(dependentCount == 2);
+    GLFM_TEST_CHECK(dependentsAfterDependency == 2);
+
+    // A complete dependency runs the job like glfmRunJob()
+    glfmRunJobAfter(dependency, dependentJob, NULL, counter);
+    glfmDestroyJobCounter(counter);
+    GLFM_TEST_CHECK(dependentCount == 3);
+    glfmDestroyJobCounter(dependency);
+    glfmDestroyJobCounter(NULL);
+}
+
+// MARK: - Nested jobs
+
+static int nestedCount;
+
+static void childJob(void *userData) {
+    (void)userData;
+    __atomic_add_fetch(&nestedCount, 1, __ATOMIC_SEQ_CST);
+}
+
+static void parentJob(void *userData) {
+    GLFMJobCounter *counter = userData;
+    for (int i = 0; i < NESTED_CHILD_COUNT; i++) {
+        glfmRunJob(childJob, NULL, counter);
+    }
+}
+
+static void testNestedJobs(void) {
+    GLFMJobCounter *counter = glfmCreateJobCounter();
+    for (int i = 0; i < NESTED_JOB_COUNT; i++) {
+        glfmRunJob(parentJob, counter, counter);
+    }
+    glfmWaitForJobCounter(counter);
+    GLFM_TEST_CHECK(nestedCount == NESTED_JOB_COUNT * NESTED_CHILD_COUNT);
+    glfmDestroyJobCounter(counter);
+}
+
+// MARK: - Frame jobs
+
+typedef struct {
+    int frameCount;
+    int frameJobComplete;
+    bool frameJobsCompleteBeforeRender;
+} FrameTest;
+
+static void frameJob(void *userData) {
+    FrameTest *test = userData;
+    usleep(5000);
+    __atomic_store_n(&test->frameJobComplete, 1, __ATOMIC_SEQ_CST);
+}
+
+static void onDraw(GLFMDisplay *display) {
+    FrameTest *test = glfmGetUserData(display);
+    if (test->frameCount > 0 && !__atomic_load_n(&test->frameJobComplete, __ATOMIC_SEQ_CST)) {
+        test->frameJobsCompleteBeforeRender = false;
+    }
+    __atomic_store_n(&test->frameJobComplete, 0, __ATOMIC_SEQ_CST);
+    glfmRunJob(frameJob, test, glfmGetFrameJobCounter(display));
+    test->frameCount++;
+    glfmSwapBuffers(display);
+}
+
+static void frameMain(GLFMDisplay *display) {
+    glfmSetRenderFunc(display, onDraw);
+}
+
+/// The frame job counter is owned by the display, and stays valid when the output changes.
+static void testFrameJobs(void) {
+    FrameTest test = { .frameJobsCompleteBeforeRender = true };
+    GLFMDisplay *display = glfmCreateDisplay(frameMain, 16, 16, &test);
+    if (!glfmRunDisplay(display, FRAME_COUNT / 2)) {
+        printf("Frame job tests skipped: no EGL display\n");
+        glfmDestroyDisplay(display);
+        return;
+    }
+    GLFMJobCounter *counter = glfmGetFrameJobCounter(display);
+    GLFM_TEST_CHECK(glfmSetOutputConfig(display, NULL));
+    GLFM_TEST_CHECK(glfmGetFrameJobCounter(display) == counter);
+    GLFM_TEST_CHECK(glfmRunDisplay(display, FRAME_COUNT - FRAME_COUNT / 2));
+    glfmDestroyDisplay(display);
+    GLFM_TEST_CHECK(test.frameCount == FRAME_COUNT);
+    GLFM_TEST_CHECK(test.frameJobsCompleteBeforeRender);
+    GLFM_TEST_CHECK(test.frameJobComplete);
+}
+
+// MARK: - Benchmark
+
+/// Compares glfmParallelFor() to the same loop on the calling thread.
+static void benchmark(void) {
+    double serialTime = 1e9;
+    double parallelTime = 1e9;
+    for (int run = 0; run < 5; run++) {
+        double start = glfmTestGetRealTime();
+        loopRange(NULL, 0, LOOP_COUNT);
+        const double serialEnd = glfmTestGetRealTime();
+        glfmParallelFor(LOOP_COUNT, 0, loopRange, NULL);
+        const double parallelEnd = glfmTestGetRealTime();
+        serialTime = fmin(serialTime, serialEnd - start);
+        parallelTime = fmin(parallelTime, parallelEnd - serialEnd);
+    }
+    printf("Parallel for, %i workers: %6.2f ms, %.2fx the calling thread (%6.2f ms)\n",
+           glfmGetJobWorkerCount(), parallelTime * 1000.0, serialTime / parallelTime,
+           serialTime * 1000.0);
+}
+
+int main(void) {
+    // Workers are used even on machines with few cores, so that jobs run concurrently
+    glfmSetJobWorkerCount(3);
+    testParallelFor();
+    testDependencies();
+    testNestedJobs();
+    testFrameJobs();
+    benchmark();
+    return glfmTestResult();
+}
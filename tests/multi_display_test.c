@@ -0,0 +1,183 @@
+// Tests headless displays rendering concurrently, each on its own thread, and checks that each
+// display renders its own color. Benchmarks the total frames per second for 1 to 8 threads.
+//
+// Skipped (exit status 77) if no EGL display is available.
+
+#include "glfm.h"
+#include "glfm_test.h"
+#include <pthread.h>
+#include <stdbool.h>
+#include <string.h>
+
+#define WIDTH 256
+#define HEIGHT 256
+#define MAX_DISPLAYS 8
+#define FRAME_COUNT 200
+#define SKIPPED 77
+
+typedef struct {
+    GLFMDisplay *display;
+    pthread_t thread;
+    int index;
+    int frameIndex;
+    int frameCount;
+    int colorMismatchCount;
+    bool surfaceError;
+    GLuint program;
+    GLuint vertexBuffer;
+} DisplayThread;
+
+static void displayColor(int index, uint8_t rgba[4]) {
+    rgba[0] = (uint8_t)(32 * index);
+    rgba[1] = (uint8_t)(255 - 32 * index);
+    rgba[2] = 128;
+    rgba[3] = 255;
+}
+
+static void onSurfaceError(GLFMDisplay *display, const char *message) {
+    DisplayThread *test = glfmGetUserData(display);
+    fprintf(stderr, "Surface error: %s\n", message);
+    test->surfaceError = true;
+}
+
+static GLuint compileShader(GLenum type, const char *source) {
+    GLuint shader = glCreateShader(type);
+    glShaderSource(shader, 1, &source, NULL);
+    glCompileShader(shader);
+    GLint compiled = 0;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
+    GLFM_TEST_CHECK(compiled);
+    return shader;
+}
+
+/// A full-screen triangle with some arithmetic per pixel, so that each frame has work to do.
+static void onSurfaceCreated(GLFMDisplay *display, int width, int height) {
+    (void)width;
+    (void)height;
+    DisplayThread *test = glfmGetUserData(display);
+    static const char *vertexSource =
+        "attribute vec2 position;\n"
+        "varying vec2 coord;\n"
+        "void main() {\n"
+        "    coord = position;\n"
+        "    gl_Position = vec4(position, 0.0, 1.0);\n"
+        "}\n";
+    static const char *fragmentSource =
+        "precision mediump float;\n"
+        "uniform vec4 color;\n"
+        "varying vec2 coord;\n"
+        "void main() {\n"
+        "    float x = coord.x + coord.y;\n"
+        "    for (int i = 0; i < 16; i++) {\n"
+        "        x = sin(x) + 0.5;\n"
+        "    }\n"
+        "    gl_FragColor = color + vec4(x * 0.0);\n"
+        "}\n";
+    static const GLfloat vertices[] = { -1.0f, -1.0f, 3.0f, -1.0f, -1.0f, 3.0f };
+    GLuint vertexShader = compileShader(GL_VERTEX_SHADER, vertexSource);
+    GLuint fragmentShader = compileShader(GL_FRAGMENT_SHADER, fragmentSource);
+    test->program = glCreateProgram();
+    glAttachShader(test->program, vertexShader);
+    glAttachShader(test->program, fragmentShader);
+    glBindAttribLocation(test->program, 0, "position");
+    glLinkProgram(test->program);
+    glDeleteShader(vertexShader);
+    glDeleteShader(fragmentShader);
+    GLint linked = 0;
+    glGetProgramiv(test->program, GL_LINK_STATUS, &linked);
+    GLFM_TEST_CHECK(linked);
+    glGenBuffers(1, &test->vertexBuffer);
+    glBindBuffer(GL_ARRAY_BUFFER, test->vertexBuffer);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+}
+
+static void onDraw(GLFMDisplay *display) {
+    DisplayThread *test = glfmGetUserData(display);
+    uint8_t color[4];
+    displayColor(test->index, color);
+    glClear(GL_COLOR_BUFFER_BIT);
+    glUseProgram(test->program);
+    glUniform4f(glGetUniformLocation(test->program, "color"),
+                color[0] / 255.0f, color[1] / 255.0f, color[2] / 255.0f, 1.0f);
+    glBindBuffer(GL_ARRAY_BUFFER, test->vertexBuffer);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, NULL);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+
+    // Reading back stalls the pipeline, so only check the last frame of each run
+    test->frameIndex++;
+    if (test->frameIndex == test->frameCount) {
+        uint8_t pixel[4] = { 0 };
+        glReadPixels(WIDTH / 2, HEIGHT / 2, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, pixel);
+        if (memcmp(pixel, color, 4) != 0) {
+            test->colorMismatchCount++;
+        }
+    }
+    glfmSwapBuffers(display);
+}
+
+static void displayMain(GLFMDisplay *display) {
+    glfmSetDisplayConfig(display, GLFMRenderingAPIOpenGLES2, GLFMColorFormatRGBA8888,
+                         GLFMDepthFormatNone, GLFMStencilFormatNone, GLFMMultisampleNone);
+    glfmSetSurfaceCreatedFunc(display, onSurfaceCreated);
+    glfmSetRenderFunc(display, onDraw);
+    glfmSetSurfaceErrorFunc(display, onSurfaceError);
+}
+
+/// Renders frames on the calling thread. Returns false if the surface could not be created.
+static bool runDisplay(DisplayThread *test, int frameCount) {
+    test->frameIndex = 0;
+    test->frameCount = frameCount;
+    return glfmRunDisplay(test->display, frameCount) && !test->surfaceError;
+}
+
+static void *threadMain(void *userData) {
+    DisplayThread *test = userData;
+    GLFM_TEST_CHECK(runDisplay(test, FRAME_COUNT));
+    return NULL;
+}
+
+int main(void) {
+    // Create the displays and their surfaces up front, so that only rendering is measured
+    DisplayThread tests[MAX_DISPLAYS];
+    memset(tests, 0, sizeof(tests));
+    for (int i = 0; i < MAX_DISPLAYS; i++) {
+        tests[i].index = i;
+        tests[i].display = glfmCreateDisplay(displayMain, WIDTH, HEIGHT, &tests[i]);
+        GLFM_TEST_CHECK(tests[i].display != NULL);
+        if (!tests[i].display || !runDisplay(&tests[i], 1)) {
+            for (int j = 0; j <= i; j++) {
+                glfmDestroyDisplay(tests[j].display);
+            }
+            if (i == 0) {
+                printf("Skipped: no EGL display\n");
+                return SKIPPED;
+            }
+            return glfmTestResult();
+        }
+    }
+
+    double singleThreadRate = 0.0;
+    for (int threadCount = 1; threadCount <= MAX_DISPLAYS; threadCount *= 2) {
+        const double startTime = glfmTestGetRealTime();
+        for (int i = 0; i < threadCount; i++) {
+            GLFM_TEST_CHECK(pthread_create(&tests[i].thread, NULL, threadMain, &tests[i]) == 0);
+        }
+        for (int i = 0; i < threadCount; i++) {
+            pthread_join(tests[i].thread, NULL);
+        }
+        const double duration = glfmTestGetRealTime() - startTime;
+        const double rate = threadCount * FRAME_COUNT / duration;
+        if (threadCount == 1) {
+            singleThreadRate = rate;
+        }
+        printf("%i display(s) on %i thread(s): %8.1f frames/sec (%7.1f per display), %.2fx one thread\n",
+               threadCount, threadCount, rate, rate / threadCount, rate / singleThreadRate);
+    }
+
+    for (int i = 0; i < MAX_DISPLAYS; i++) {
+        GLFM_TEST_CHECK(tests[i].colorMismatchCount == 0);
+        glfmDestroyDisplay(tests[i].display);
+    }
+    return glfmTestResult();
+}
@@ -0,0 +1,177 @@
+// Tests the performance hint session with fake platform functions, like Android's APerformanceHint:
+// the reported work durations, the target, and session changes when the threads change.
+
+#include "glfm_test_platform.h"
+
+#define NANOS_TOLERANCE 1000
+
+static struct {
+    int createCount;
+    int closeCount;
+    int setThreadsCount;
+    int updateTargetCount;
+    int reportCount;
+    int threadCount;
+    int64_t targetNanos;
+    int64_t actualNanos;
+    int64_t totalActualNanos;
+    bool setThreadsSupported;
+    bool createFails;
+} fakeSession;
+
+static void *fakeCreateSession(const int32_t *threadIds, int threadCount, int64_t targetNanos) {
+    (void)threadIds;
+    if (fakeSession.createFails) {
+        return NULL;
+    }
+    fakeSession.createCount++;
+    fakeSession.threadCount = threadCount;
+    fakeSession.targetNanos = targetNanos;
+    return &fakeSession;
+}
+
+static bool fakeSetThreads(void *session, const int32_t *threadIds, int threadCount) {
+    (void)session;
+    (void)threadIds;
+    if (!fakeSession.setThreadsSupported) {
+        return false;
+    }
+    fakeSession.setThreadsCount++;
+    fakeSession.threadCount = threadCount;
+    return true;
+}
+
+static void fakeUpdateTarget(void *session, int64_t targetNanos) {
+    (void)session;
+    fakeSession.updateTargetCount++;
+    fakeSession.targetNanos = targetNanos;
+}
+
+static void fakeReportActual(void *session, int64_t actualNanos) {
+    (void)session;
+    fakeSession.reportCount++;
+    fakeSession.actualNanos = actualNanos;
+    fakeSession.totalActualNanos += actualNanos;
+}
+
+static void fakeCloseSession(void *session) {
+    (void)session;
+    fakeSession.closeCount++;
+}
+
+static const GLFMPerformanceHintFuncs fakeFuncs = {
+    fakeCreateSession, fakeSetThreads, fakeUpdateTarget, fakeReportActual, fakeCloseSession,
+};
+
+static const int32_t threadIds[3] = { 100, 101, 102 };
+
+/// Simulates a frame that takes `workDuration` of a `frameInterval`. The time blocked in the swap
+/// after the work isn't reported.
+static void renderFrame(GLFMDisplay *display, double frameInterval, double workDuration,
+                        int threadCount) {
+    glfm__setFrameTime(display, glfmGetTime(), 0.0);
+    glfm__performanceHintBeginWork(display);
+    glfmTestSetTime(glfmGetTime() + workDuration);
+    glfm__performanceHintEndWork(display, threadIds, threadCount);
+    glfmTestSetTime(glfmGetTime() + frameInterval - workDuration);
+}
+
+static void testUnsupported(void) {
+    memset(&fakeSession, 0, sizeof(fakeSession));
+    GLFMDisplay *display = glfmTestCreateDisplay();
+    renderFrame(display, 1.0 / 60.0, 0.005, 1);
+    GLFM_TEST_CHECK(!glfmIsPerformanceHintSupported(display));
+    GLFM_TEST_CHECK(fakeSession.createCount == 0 && fakeSession.reportCount == 0);
+    free(display);
+}
+
+static void testWorkDurations(void) {
+    memset(&fakeSession, 0, sizeof(fakeSession));
+    GLFMDisplay *display = glfmTestCreateDisplay();
+    display->performanceHint.funcs = &fakeFuncs;
+    GLFM_TEST_CHECK(glfmIsPerformanceHintSupported(display));
+
+    // Each frame's work is reported, not the frame interval
+    const double workDurations[4] = { 0.005, 0.0021, 0.012, 0.0003 };
+    int64_t expectedTotalNanos = 0;
+    for (int i = 0; i < 120; i++) {
+        const double workDuration = workDurations[i % 4];
+        renderFrame(display, 1.0 / 60.0, workDuration, 1);
+        GLFM_TEST_CHECK(llabs(fakeSession.actualNanos - (int64_t)(workDuration * 1e9)) <=
+                        NANOS_TOLERANCE);
+        expectedTotalNanos += (int64_t)(workDuration * 1e9);
+    }
+    GLFM_TEST_CHECK(fakeSession.createCount == 1);
+    GLFM_TEST_CHECK(fakeSession.reportCount == 120);
+    GLFM_TEST_CHECK(llabs(fakeSession.totalActualNanos - expectedTotalNanos) <=
+                    120 * NANOS_TOLERANCE);
+    GLFM_TEST_CHECK(llabs(fakeSession.targetNanos - 16666667) < 200000);
+
+    // Without a matching begin, nothing is reported
+    glfm__performanceHintEndWork(display, threadIds, 1);
+    GLFM_TEST_CHECK(fakeSession.reportCount == 120);
+
+    // Jitter within 5% doesn't update the target
+    const int updateTargetCount = fakeSession.updateTargetCount;
+    for (int i = 0; i < 60; i++) {
+        renderFrame(display, (i & 1) ? 1.0 / 62.0 : 1.0 / 59.0, 0.004, 1);
+    }
+    GLFM_TEST_CHECK(fakeSession.updateTargetCount == updateTargetCount);
+
+    // A new refresh rate updates it
+    for (int i = 0; i < 120; i++) {
+        renderFrame(display, 1.0 / 120.0, 0.003, 1);
+    }
+    GLFM_TEST_CHECK(fakeSession.updateTargetCount > updateTargetCount);
+    GLFM_TEST_CHECK(llabs(fakeSession.targetNanos - 8333333) < 500000);
+
+    // The app's target replaces the measured target
+    glfmSetPerformanceHintTarget(display, 0.010);
+    renderFrame(display, 1.0 / 120.0, 0.003, 1);
+    GLFM_TEST_CHECK(fakeSession.targetNanos == 10000000);
+    GLFM_TEST_CHECK(glfmGetPerformanceHintTarget(display) == 0.010);
+    glfmSetPerformanceHintTarget(display, 0.0);
+
+    glfm__performanceHintDestroy(display);
+    GLFM_TEST_CHECK(fakeSession.closeCount == 1);
+    free(display);
+}
+
+static void testThreadChanges(void) {
+    memset(&fakeSession, 0, sizeof(fakeSession));
+    GLFMDisplay *display = glfmTestCreateDisplay();
+    display->performanceHint.funcs = &fakeFuncs;
+    renderFrame(display, 1.0 / 60.0, 0.005, 1);
+
+    // Recreated if the threads can't be set
+    renderFrame(display, 1.0 / 60.0, 0.005, 3);
+    GLFM_TEST_CHECK(fakeSession.createCount == 2 && fakeSession.closeCount == 1);
+    GLFM_TEST_CHECK(fakeSession.threadCount == 3);
+
+    fakeSession.setThreadsSupported = true;
+    renderFrame(display, 1.0 / 60.0, 0.005, 2);
+    GLFM_TEST_CHECK(fakeSession.createCount == 2 && fakeSession.setThreadsCount == 1);
+    GLFM_TEST_CHECK(fakeSession.threadCount == 2);
+    GLFM_TEST_CHECK(fakeSession.reportCount == 3);
+
+    // A failed session isn't retried until the threads change
+    glfm__performanceHintDestroy(display);
+    fakeSession.createFails = true;
+    renderFrame(display, 1.0 / 60.0, 0.005, 2);
+    GLFM_TEST_CHECK(!glfmIsPerformanceHintSupported(display));
+    fakeSession.createFails = false;
+    renderFrame(display, 1.0 / 60.0, 0.005, 2);
+    GLFM_TEST_CHECK(fakeSession.reportCount == 3);
+    renderFrame(display, 1.0 / 60.0, 0.005, 1);
+    GLFM_TEST_CHECK(fakeSession.createCount == 3 && fakeSession.reportCount == 4);
+    GLFM_TEST_CHECK(glfmIsPerformanceHintSupported(display));
+    glfm__performanceHintDestroy(display);
+    free(display);
+}
+
+int main(void) {
+    testUnsupported();
+    testWorkDurations();
+    testThreadChanges();
+    return glfmTestResult();
+}
@@ -0,0 +1,155 @@
+// Tests present feedback with a simulated clock and a simulated platform timestamp source, like
+// EGL_ANDROID_get_frame_timestamps: estimated times, the pending to measured transition, frames
+// without platform timestamps, and the range of frame IDs that are kept.
+
+#include "glfm_test_platform.h"
+
+#define FRAME_INTERVAL (1.0 / 60.0)
+#define PLATFORM_FRAME_COUNT 64
+
+/// The simulated platform. Times of a platform frame are pending until it is marked ready.
+static struct {
+    bool ready[PLATFORM_FRAME_COUNT];
+    double gpuCompleteTime[PLATFORM_FRAME_COUNT];
+    double latchTime[PLATFORM_FRAME_COUNT];
+    double presentTime[PLATFORM_FRAME_COUNT];
+    int queryCount;
+} platform;
+
+/// A GLFMFrameTimestampsFunc.
+static void getFrameTimestamps(GLFMDisplay *display, uint64_t platformFrameId,
+                               GLFMPresentFeedback *feedback) {
+    (void)display;
+    platform.queryCount++;
+    feedback->pending = false;
+    if (platformFrameId == 0 || platformFrameId >= PLATFORM_FRAME_COUNT) {
+        // Timestamps unavailable for this frame
+        return;
+    }
+    if (!platform.ready[platformFrameId]) {
+        feedback->pending = true;
+        return;
+    }
+    feedback->gpuCompleteTime = platform.gpuCompleteTime[platformFrameId];
+    feedback->latchTime = platform.latchTime[platformFrameId];
+    feedback->presentTime = platform.presentTime[platformFrameId];
+    feedback->measured = true;
+}
+
+static void setPlatformFrameReady(uint64_t platformFrameId, double presentTime) {
+    platform.ready[platformFrameId] = true;
+    platform.gpuCompleteTime[platformFrameId] = presentTime - 0.010;
+    platform.latchTime[platformFrameId] = presentTime - 0.004;
+    platform.presentTime[platformFrameId] = presentTime;
+}
+
+/// Starts a frame at `frameTime`, renders it for `renderDuration`, and swaps.
+static uint64_t swapFrame(GLFMDisplay *display, double frameTime, double renderDuration,
+                          uint64_t platformFrameId) {
+    glfmTestSetTime(frameTime);
+    glfm__setFrameTime(display, frameTime, frameTime + FRAME_INTERVAL);
+    glfmTestSetTime(frameTime + renderDuration);
+    return glfm__recordSwap(display, platformFrameId);
+}
+
+/// Without a timestamp source, the times are estimated from the target present time, and are
+/// never pending.
+static void testEstimated(void) {
+    GLFMDisplay *display = glfmTestCreateDisplay();
+    const uint64_t frameId = swapFrame(display, 1.0, 0.005, 0);
+    GLFM_TEST_CHECK(frameId == 1);
+    GLFMPresentFeedback feedback;
+    GLFM_TEST_CHECK(glfmGetPresentFeedback(display, frameId, &feedback));
+    GLFM_TEST_CHECK(feedback.frameId == frameId);
+    GLFM_TEST_CHECK(!feedback.pending && !feedback.measured);
+    GLFM_TEST_CHECK_NEAR(feedback.swapTime, 1.005, 1e-12);
+    GLFM_TEST_CHECK_NEAR(feedback.gpuCompleteTime, 1.005, 1e-12);
+    GLFM_TEST_CHECK_NEAR(feedback.presentTime, 1.0 + FRAME_INTERVAL, 1e-12);
+    GLFM_TEST_CHECK_NEAR(feedback.latchTime, 1.005, 1e-12);
+
+    // A frame that misses its target is estimated to be shown at the next refresh
+    const uint64_t lateFrameId = swapFrame(display, 1.0 + FRAME_INTERVAL, 1.5 * FRAME_INTERVAL, 0);
+    GLFM_TEST_CHECK(glfmGetPresentFeedback(display, lateFrameId, &feedback));
+    GLFM_TEST_CHECK_NEAR(feedback.presentTime, 1.0 + 3 * FRAME_INTERVAL, 1e-9);
+    GLFM_TEST_CHECK_NEAR(feedback.latchTime, 1.0 + 2.5 * FRAME_INTERVAL, 1e-9);
+    free(display);
+}
+
+/// Times are estimated and pending until the platform reports them, and then measured.
+static void testPendingToMeasured(void) {
+    memset(&platform, 0, sizeof(platform));
+    GLFMDisplay *display = glfmTestCreateDisplay();
+    display->frameTimestampsFunc = getFrameTimestamps;
+    const uint64_t frameId = swapFrame(display, 1.0, 0.005, 7);
+
+    GLFMPresentFeedback feedback;
+    GLFM_TEST_CHECK(glfmGetPresentFeedback(display, frameId, &feedback));
+    GLFM_TEST_CHECK(platform.queryCount == 1);
+    GLFM_TEST_CHECK(feedback.pending && !feedback.measured);
+    GLFM_TEST_CHECK_NEAR(feedback.presentTime, 1.0 + FRAME_INTERVAL, 1e-12);
+
+    // Reported two frames later, a refresh later than the estimate
+    swapFrame(display, 1.0 + FRAME_INTERVAL, 0.005, 8);
+    const double presentTime = 1.0 + 2 * FRAME_INTERVAL;
+    setPlatformFrameReady(7, presentTime);
+    GLFM_TEST_CHECK(glfmGetPresentFeedback(display, frameId, &feedback));
+    GLFM_TEST_CHECK(platform.queryCount == 2);
+    GLFM_TEST_CHECK(!feedback.pending && feedback.measured);
+    GLFM_TEST_CHECK(feedback.frameId == frameId);
+    GLFM_TEST_CHECK_NEAR(feedback.swapTime, 1.005, 1e-12);
+    GLFM_TEST_CHECK(feedback.gpuCompleteTime == presentTime - 0.010);
+    GLFM_TEST_CHECK(feedback.latchTime == presentTime - 0.004);
+    GLFM_TEST_CHECK(feedback.presentTime == presentTime);
+
+    // Final times aren't queried again
+    GLFM_TEST_CHECK(glfmGetPresentFeedback(display, frameId, &feedback));
+    GLFM_TEST_CHECK(platform.queryCount == 2);
+    GLFM_TEST_CHECK(feedback.measured && feedback.presentTime == presentTime);
+
+    // A frame the platform has no timestamps for keeps its estimates
+    const uint64_t unavailableFrameId = swapFrame(display, 1.0 + 2 * FRAME_INTERVAL, 0.005, 0);
+    GLFM_TEST_CHECK(glfmGetPresentFeedback(display, unavailableFrameId, &feedback));
+    GLFM_TEST_CHECK(!feedback.pending && !feedback.measured);
+    GLFM_TEST_CHECK_NEAR(feedback.presentTime, 1.0 + 3 * FRAME_INTERVAL, 1e-9);
+    free(display);
+}
+
+/// Feedback is kept for the GLFM_PRESENT_FEEDBACK_CAPACITY most recent frames.
+static void testFrameIdRange(void) {
+    memset(&platform, 0, sizeof(platform));
+    GLFMDisplay *display = glfmTestCreateDisplay();
+    display->frameTimestampsFunc = getFrameTimestamps;
+    GLFMPresentFeedback feedback;
+    GLFM_TEST_CHECK(!glfmGetPresentFeedback(display, 0, &feedback));
+    GLFM_TEST_CHECK(!glfmGetPresentFeedback(display, 1, &feedback));
+
+    const int frameCount = GLFM_PRESENT_FEEDBACK_CAPACITY + 4;
+    uint64_t lastFrameId = 0;
+    for (int i = 0; i < frameCount; i++) {
+        lastFrameId = swapFrame(display, 1.0 + i * FRAME_INTERVAL, 0.005, (uint64_t)i + 1);
+        setPlatformFrameReady((uint64_t)i + 1, 1.0 + (i + 1) * FRAME_INTERVAL);
+    }
+    GLFM_TEST_CHECK(lastFrameId == (uint64_t)frameCount);
+    GLFM_TEST_CHECK(!glfmGetPresentFeedback(display, 0, &feedback));
+    GLFM_TEST_CHECK(!glfmGetPresentFeedback(display, lastFrameId + 1, &feedback));
+    const uint64_t oldestFrameId = lastFrameId - GLFM_PRESENT_FEEDBACK_CAPACITY + 1;
+    for (uint64_t frameId = 1; frameId < oldestFrameId; frameId++) {
+        GLFM_TEST_CHECK(!glfmGetPresentFeedback(display, frameId, &feedback));
+    }
+    for (uint64_t frameId = oldestFrameId; frameId <= lastFrameId; frameId++) {
+        // Each slot has the times of its own frame, not of an older frame in the same slot
+        GLFM_TEST_CHECK(glfmGetPresentFeedback(display, frameId, &feedback));
+        GLFM_TEST_CHECK(feedback.frameId == frameId && feedback.measured);
+        GLFM_TEST_CHECK(feedback.presentTime == platform.presentTime[frameId]);
+    }
+    GLFM_TEST_CHECK(!glfmGetPresentFeedback(display, lastFrameId, NULL));
+    GLFM_TEST_CHECK(!glfmGetPresentFeedback(NULL, lastFrameId, &feedback));
+    free(display);
+}
+
+int main(void) {
+    testEstimated();
+    testPendingToMeasured();
+    testFrameIdRange();
+    return glfmTestResult();
+}
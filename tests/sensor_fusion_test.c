@@ -0,0 +1,303 @@
+// Replays IMU logs through the sensor fusion filter, and reports its accuracy and speed.
+//
+// Usage: sensor_fusion_test [log ...]
+//
+// Without arguments, synthetic logs are generated and checked: a device turning smoothly, with
+// sensor noise and a gyroscope bias, with and without a magnetometer.
+//
+// A log is a text file with one sample per line. Times are in seconds, and the vectors are in the
+// Android/W3C device frame:
+//
+//     a <time> <x> <y> <z>      Acceleration including gravity (points up at rest)
+//     g <time> <x> <y> <z>      Rotation rate, in radians/second
+//     m <time> <x> <y> <z>      Magnetic field
+//     q <time> <w> <x> <y> <z>  Optional: the true device-to-world rotation, where the world's
+//                               X axis points North and the Z axis points up
+//
+// Lines starting with '#' are ignored. Accuracy is only reported for logs with 'q' samples.
+
+#include "glfm_test_platform.h"
+
+#define SETTLE_TIME 5.0 // Errors are measured after this many seconds
+#define BENCHMARK_SAMPLE_COUNT 2000000
+#define RADIANS_TO_DEGREES (180.0 / M_PI)
+
+typedef struct {
+    char type;
+    double time;
+    double values[4];
+} Sample;
+
+typedef struct {
+    Sample *samples;
+    size_t count;
+    size_t capacity;
+    bool hasMagnetometer;
+} Log;
+
+typedef struct {
+    double meanError; // Degrees
+    double maxError;
+    double meanTiltError;
+    double maxTiltError;
+    int estimateCount;
+} Accuracy;
+
+static void logAdd(Log *log, char type, double time, double v0, double v1, double v2, double v3) {
+    if (log->count == log->capacity) {
+        log->capacity = log->capacity > 0 ? log->capacity * 2 : 1024;
+        log->samples = realloc(log->samples, log->capacity * sizeof(Sample));
+        if (!log->samples) {
+            fprintf(stderr, "Out of memory\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    Sample *sample = &log->samples[log->count++];
+    sample->type = type;
+    sample->time = time;
+    sample->values[0] = v0;
+    sample->values[1] = v1;
+    sample->values[2] = v2;
+    sample->values[3] = v3;
+    log->hasMagnetometer |= (type == 'm');
+}
+
+static bool logRead(Log *log, const char *path) {
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        return false;
+    }
+    char line[256];
+    while (fgets(line, sizeof(line), file)) {
+        char type;
+        double time, v[4] = { 0 };
+        int count = sscanf(line, " %c %lf %lf %lf %lf %lf", &type, &time, &v[0], &v[1], &v[2], &v[3]);
+        if (count >= 5 && (type == 'a' || type == 'g' || type == 'm' || (type == 'q' && count == 6))) {
+            logAdd(log, type, time, v[0], v[1], v[2], v[3]);
+        }
+    }
+    fclose(file);
+    return true;
+}
+
+// MARK: - Quaternions
+
+typedef struct {
+    double w, x, y, z;
+} Quaternion;
+
+static Quaternion quaternionMultiply(Quaternion a, Quaternion b) {
+    Quaternion q = {
+        a.w * b.w - a.x * b.x - a.y * b.y - a.z * b.z,
+        a.w * b.x + a.x * b.w + a.y * b.z - a.z * b.y,
+        a.w * b.y - a.x * b.z + a.y * b.w + a.z * b.x,
+        a.w * b.z + a.x * b.y - a.y * b.x + a.z * b.w,
+    };
+    return q;
+}
+
+static Quaternion quaternionNormalize(Quaternion q) {
+    const double norm = sqrt(q.w * q.w + q.x * q.x + q.y * q.y + q.z * q.z);
+    Quaternion result = { q.w / norm, q.x / norm, q.y / norm, q.z / norm };
+    return result;
+}
+
+/// Rotates a world vector into device coordinates, with the device-to-world rotation `q`.
+static void quaternionRotateInverse(Quaternion q, const double v[3], double result[3]) {
+    Quaternion p = { 0, v[0], v[1], v[2] };
+    Quaternion inverse = { q.w, -q.x, -q.y, -q.z };
+    Quaternion r = quaternionMultiply(quaternionMultiply(inverse, p), q);
+    result[0] = r.x;
+    result[1] = r.y;
+    result[2] = r.z;
+}
+
+/// Angle between two rotations, in degrees.
+static double quaternionAngle(Quaternion a, Quaternion b) {
+    const double dot = fabs(a.w * b.w + a.x * b.x + a.y * b.y + a.z * b.z);
+    return 2.0 * acos(dot < 1.0 ? dot : 1.0) * RADIANS_TO_DEGREES;
+}
+
+/// Angle between the up directions of two rotations, in degrees. Ignores heading.
+static double quaternionTiltAngle(Quaternion a, Quaternion b) {
+    const double up[3] = { 0, 0, 1 };
+    double upA[3], upB[3];
+    quaternionRotateInverse(a, up, upA);
+    quaternionRotateInverse(b, up, upB);
+    const double dot = upA[0] * upB[0] + upA[1] * upB[1] + upA[2] * upB[2];
+    return acos(dot < 1.0 ? (dot > -1.0 ? dot : -1.0) : 1.0) * RADIANS_TO_DEGREES;
+}
+
+// MARK: - Synthetic logs
+
+/// Generates a log of a device turning smoothly in all three axes, sampled at 100Hz. The sensors
+/// have white noise, and the gyroscope has a constant bias.
+static void logGenerate(Log *log, double duration, bool magnetometer, const double gyroBias[3]) {
+    const double sampleInterval = 0.01;
+    const int substeps = 20;
+    const double gravity[3] = { 0, 0, 9.81 };
+    const double dip = 60.0 / RADIANS_TO_DEGREES;
+    const double field[3] = { 50.0 * cos(dip), 0, -50.0 * sin(dip) };
+    Quaternion q = quaternionNormalize((Quaternion){ 0.9, 0.2, -0.3, 0.25 });
+    for (double time = 0.0; time < duration; time += sampleInterval) {
+        // True rotation rate, in device coordinates
+        const double rate[3] = {
+            0.8 * sin(0.7 * time),
+            0.6 * sin(0.45 * time + 1.0),
+            1.2 * sin(0.3 * time + 2.0),
+        };
+        double a[3], m[3];
+        quaternionRotateInverse(q, gravity, a);
+        quaternionRotateInverse(q, field, m);
+        logAdd(log, 'q', time, q.w, q.x, q.y, q.z);
+        logAdd(log, 'a', time, a[0] + 0.05 * glfmTestRandom(), a[1] + 0.05 * glfmTestRandom(),
+               a[2] + 0.05 * glfmTestRandom(), 0);
+        if (magnetometer) {
+            logAdd(log, 'm', time, m[0] + 0.5 * glfmTestRandom(), m[1] + 0.5 * glfmTestRandom(),
+                   m[2] + 0.5 * glfmTestRandom(), 0);
+        }
+        logAdd(log, 'g', time, rate[0] + gyroBias[0] + 0.005 * glfmTestRandom(),
+               rate[1] + gyroBias[1] + 0.005 * glfmTestRandom(),
+               rate[2] + gyroBias[2] + 0.005 * glfmTestRandom(), 0);
+
+        // Integrate the true rotation
+        const double dt = sampleInterval / substeps;
+        for (int i = 0; i < substeps; i++) {
+            Quaternion delta = { 1.0, 0.5 * rate[0] * dt, 0.5 * rate[1] * dt, 0.5 * rate[2] * dt };
+            q = quaternionNormalize(quaternionMultiply(q, delta));
+        }
+    }
+}
+
+// MARK: - Replay
+
+static bool replaySample(GLFMSensorFusion *fusion, const Sample *sample) {
+    const float x = (float)sample->values[0];
+    const float y = (float)sample->values[1];
+    const float z = (float)sample->values[2];
+    switch (sample->type) {
+        case 'a':
+            glfm__sensorFusionAddAccelerometer(fusion, x, y, z);
+            return false;
+        case 'm':
+            glfm__sensorFusionAddMagnetometer(fusion, x, y, z);
+            return false;
+        case 'g':
+            return glfm__sensorFusionAddGyroscope(fusion, sample->time, x, y, z);
+        default:
+            return false;
+    }
+}
+
+static Accuracy replay(const Log *log, GLFMSensorFusion *fusion) {
+    Accuracy accuracy = { 0 };
+    Quaternion truth = { 1, 0, 0, 0 };
+    bool truthValid = false;
+    const double startTime = log->count > 0 ? log->samples[0].time : 0.0;
+    glfm__sensorFusionReset(fusion);
+    for (size_t i = 0; i < log->count; i++) {
+        const Sample *sample = &log->samples[i];
+        if (sample->type == 'q') {
+            truth = quaternionNormalize((Quaternion){ sample->values[0], sample->values[1],
+                                                      sample->values[2], sample->values[3] });
+            truthValid = true;
+        } else if (replaySample(fusion, sample) && truthValid &&
+                   sample->time - startTime >= SETTLE_TIME) {
+            Quaternion estimate = { fusion->qw, fusion->qx, fusion->qy, fusion->qz };
+            const double error = quaternionAngle(estimate, truth);
+            const double tiltError = quaternionTiltAngle(estimate, truth);
+            accuracy.meanError += error;
+            accuracy.meanTiltError += tiltError;
+            accuracy.maxError = fmax(accuracy.maxError, error);
+            accuracy.maxTiltError = fmax(accuracy.maxTiltError, tiltError);
+            accuracy.estimateCount++;
+        }
+    }
+    if (accuracy.estimateCount > 0) {
+        accuracy.meanError /= accuracy.estimateCount;
+        accuracy.meanTiltError /= accuracy.estimateCount;
+    }
+    return accuracy;
+}
+
+/// Returns the time to replay one sample, in nanoseconds.
+static double benchmark(const Log *log) {
+    GLFMSensorFusion fusion;
+    size_t sampleCount = 0;
+    int estimateCount = 0;
+    const double start = glfmTestGetRealTime();
+    while (sampleCount < BENCHMARK_SAMPLE_COUNT) {
+        glfm__sensorFusionReset(&fusion);
+        for (size_t i = 0; i < log->count; i++) {
+            estimateCount += replaySample(&fusion, &log->samples[i]);
+        }
+        sampleCount += log->count;
+    }
+    const double elapsed = glfmTestGetRealTime() - start;
+    return estimateCount > 0 ? elapsed * 1e9 / (double)sampleCount : 0.0;
+}
+
+static Accuracy report(const char *name, const Log *log) {
+    GLFMSensorFusion fusion;
+    Accuracy accuracy = replay(log, &fusion);
+    printf("%s: %zu samples, %.1f ns/sample", name, log->count, benchmark(log));
+    if (accuracy.estimateCount > 0 && log->hasMagnetometer) {
+        printf(", error mean %.2f max %.2f degrees", accuracy.meanError, accuracy.maxError);
+    }
+    if (accuracy.estimateCount > 0) {
+        // Without a magnetometer, the heading is arbitrary, so only the tilt is compared
+        printf(", tilt error mean %.2f max %.2f degrees", accuracy.meanTiltError, accuracy.maxTiltError);
+    }
+    printf("\n");
+    return accuracy;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc > 1) {
+        for (int i = 1; i < argc; i++) {
+            Log log = { 0 };
+            if (!logRead(&log, argv[i])) {
+                fprintf(stderr, "Couldn't read %s\n", argv[i]);
+                return EXIT_FAILURE;
+            }
+            report(argv[i], &log);
+            free(log.samples);
+        }
+        return EXIT_SUCCESS;
+    }
+
+    const double gyroBias[3] = { 0.02, -0.015, 0.01 };
+
+    // With a magnetometer, the heading is absolute
+    Log log = { 0 };
+    logGenerate(&log, 60.0, true, gyroBias);
+    Accuracy accuracy = report("Synthetic, magnetometer", &log);
+    GLFM_TEST_CHECK(accuracy.estimateCount > 0);
+    GLFM_TEST_CHECK(accuracy.meanError < 2.0);
+    GLFM_TEST_CHECK(accuracy.maxError < 5.0);
+
+    free(log.samples);
+
+    // The integral feedback converges slowly (minutes) to the negated gyroscope bias
+    memset(&log, 0, sizeof(log));
+    logGenerate(&log, 300.0, true, gyroBias);
+    GLFMSensorFusion fusion;
+    replay(&log, &fusion);
+    printf("Gyroscope bias: estimated %.4f %.4f %.4f, actual %.4f %.4f %.4f radians/second\n",
+           -fusion.biasX, -fusion.biasY, -fusion.biasZ, gyroBias[0], gyroBias[1], gyroBias[2]);
+    GLFM_TEST_CHECK_NEAR(-fusion.biasX, gyroBias[0], 0.004);
+    GLFM_TEST_CHECK_NEAR(-fusion.biasY, gyroBias[1], 0.004);
+    GLFM_TEST_CHECK_NEAR(-fusion.biasZ, gyroBias[2], 0.004);
+    free(log.samples);
+
+    // Without a magnetometer, only the tilt is known
+    memset(&log, 0, sizeof(log));
+    logGenerate(&log, 60.0, false, gyroBias);
+    accuracy = report("Synthetic, no magnetometer", &log);
+    GLFM_TEST_CHECK(accuracy.estimateCount > 0);
+    GLFM_TEST_CHECK(accuracy.meanTiltError < 2.0);
+    GLFM_TEST_CHECK(accuracy.maxTiltError < 5.0);
+    free(log.samples);
+
+    return glfmTestResult();
+}
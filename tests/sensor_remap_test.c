@@ -0,0 +1,162 @@
+// Tests glfm__remapSensorEvent(), and benchmarks it.
+//
+// The expected matrices are the remapping that examples/compass.c did by hand before sensor
+// remapping was added: the first two rows are rotated around the Z axis.
+
+#include "glfm_test_platform.h"
+
+#define BENCHMARK_EVENT_COUNT 2000000
+
+static const GLFMInterfaceOrientation orientations[] = {
+    GLFMInterfaceOrientationPortrait,
+    GLFMInterfaceOrientationLandscapeLeft,
+    GLFMInterfaceOrientationPortraitUpsideDown,
+    GLFMInterfaceOrientationLandscapeRight,
+};
+
+static GLFMSensorEvent randomMatrixEvent(void) {
+    GLFMSensorEvent event = { 0 };
+    event.sensor = GLFMSensorRotationMatrix;
+    event.timestamp = 1.0;
+    double qw = glfmTestRandom(), qx = glfmTestRandom(), qy = glfmTestRandom(), qz = glfmTestRandom();
+    double norm = sqrt(qw * qw + qx * qx + qy * qy + qz * qz);
+    glfm__setSensorEventRotation(&event, qw / norm, qx / norm, qy / norm, qz / norm);
+    return event;
+}
+
+static GLFMSensorEvent randomVectorEvent(GLFMSensor sensor) {
+    GLFMSensorEvent event = { 0 };
+    event.sensor = sensor;
+    event.timestamp = 1.0;
+    event.vector.x = glfmTestRandom();
+    event.vector.y = glfmTestRandom();
+    event.vector.z = glfmTestRandom();
+    return event;
+}
+
+static void expectedMatrix(const GLFMSensorEvent *event, GLFMInterfaceOrientation orientation,
+                           double m[3][3]) {
+    const double rows[3][3] = {
+        { event->matrix.m00, event->matrix.m01, event->matrix.m02 },
+        { event->matrix.m10, event->matrix.m11, event->matrix.m12 },
+        { event->matrix.m20, event->matrix.m21, event->matrix.m22 },
+    };
+    for (int i = 0; i < 3; i++) {
+        switch (orientation) {
+            case GLFMInterfaceOrientationLandscapeLeft:
+                m[0][i] = rows[1][i];
+                m[1][i] = -rows[0][i];
+                break;
+            case GLFMInterfaceOrientationPortraitUpsideDown:
+                m[0][i] = -rows[0][i];
+                m[1][i] = -rows[1][i];
+                break;
+            case GLFMInterfaceOrientationLandscapeRight:
+                m[0][i] = -rows[1][i];
+                m[1][i] = rows[0][i];
+                break;
+            case GLFMInterfaceOrientationPortrait: default:
+                m[0][i] = rows[0][i];
+                m[1][i] = rows[1][i];
+                break;
+        }
+        m[2][i] = rows[2][i];
+    }
+}
+
+static void testMatrices(void) {
+    for (int i = 0; i < 100; i++) {
+        for (size_t j = 0; j < sizeof(orientations) / sizeof(*orientations); j++) {
+            GLFMSensorEvent event = randomMatrixEvent();
+            double m[3][3];
+            expectedMatrix(&event, orientations[j], m);
+            glfm__remapSensorEvent(&event, orientations[j]);
+            GLFM_TEST_CHECK(event.sensor == GLFMSensorRotationMatrix);
+            GLFM_TEST_CHECK(event.timestamp == 1.0);
+            GLFM_TEST_CHECK_NEAR(event.matrix.m00, m[0][0], 0.0);
+            GLFM_TEST_CHECK_NEAR(event.matrix.m01, m[0][1], 0.0);
+            GLFM_TEST_CHECK_NEAR(event.matrix.m02, m[0][2], 0.0);
+            GLFM_TEST_CHECK_NEAR(event.matrix.m10, m[1][0], 0.0);
+            GLFM_TEST_CHECK_NEAR(event.matrix.m11, m[1][1], 0.0);
+            GLFM_TEST_CHECK_NEAR(event.matrix.m12, m[1][2], 0.0);
+            GLFM_TEST_CHECK_NEAR(event.matrix.m20, m[2][0], 0.0);
+            GLFM_TEST_CHECK_NEAR(event.matrix.m21, m[2][1], 0.0);
+            GLFM_TEST_CHECK_NEAR(event.matrix.m22, m[2][2], 0.0);
+        }
+    }
+}
+
+/// Vectors are remapped the same way as the rows of the matrix, so a vector remaps like a column.
+static void testVectors(void) {
+    const GLFMSensor sensors[] = { GLFMSensorAccelerometer, GLFMSensorMagnetometer, GLFMSensorGyroscope };
+    for (int i = 0; i < 100; i++) {
+        for (size_t j = 0; j < sizeof(orientations) / sizeof(*orientations); j++) {
+            GLFMSensorEvent event = randomVectorEvent(sensors[i % 3]);
+            GLFMSensorEvent column = { 0 };
+            column.sensor = GLFMSensorRotationMatrix;
+            column.matrix.m00 = event.vector.x;
+            column.matrix.m10 = event.vector.y;
+            column.matrix.m20 = event.vector.z;
+            glfm__remapSensorEvent(&event, orientations[j]);
+            glfm__remapSensorEvent(&column, orientations[j]);
+            GLFM_TEST_CHECK(event.sensor == sensors[i % 3]);
+            GLFM_TEST_CHECK_NEAR(event.vector.x, column.matrix.m00, 0.0);
+            GLFM_TEST_CHECK_NEAR(event.vector.y, column.matrix.m10, 0.0);
+            GLFM_TEST_CHECK_NEAR(event.vector.z, column.matrix.m20, 0.0);
+        }
+    }
+
+    // A device lying flat in landscape-left (turned clockwise, with its natural top edge on the
+    // right of the interface), with its natural top edge pointing North: the magnetic field points
+    // to the top of the device in portrait, and to the right of the interface in landscape-left.
+    GLFMSensorEvent event = { 0 };
+    event.sensor = GLFMSensorMagnetometer;
+    event.vector.y = 1.0;
+    glfm__remapSensorEvent(&event, GLFMInterfaceOrientationLandscapeLeft);
+    GLFM_TEST_CHECK_NEAR(event.vector.x, 1.0, 0.0);
+    GLFM_TEST_CHECK_NEAR(event.vector.y, 0.0, 0.0);
+}
+
+/// Remapping is a rotation: it composes, and four quarter turns are the identity.
+static void testComposition(void) {
+    GLFMSensorEvent event = randomMatrixEvent();
+    GLFMSensorEvent twice = event;
+    GLFMSensorEvent upsideDown = event;
+    glfm__remapSensorEvent(&twice, GLFMInterfaceOrientationLandscapeLeft);
+    glfm__remapSensorEvent(&twice, GLFMInterfaceOrientationLandscapeLeft);
+    glfm__remapSensorEvent(&upsideDown, GLFMInterfaceOrientationPortraitUpsideDown);
+    GLFM_TEST_CHECK(memcmp(&twice, &upsideDown, sizeof(GLFMSensorEvent)) == 0);
+
+    GLFMSensorEvent inverse = event;
+    glfm__remapSensorEvent(&inverse, GLFMInterfaceOrientationLandscapeLeft);
+    glfm__remapSensorEvent(&inverse, GLFMInterfaceOrientationLandscapeRight);
+    GLFM_TEST_CHECK(memcmp(&inverse, &event, sizeof(GLFMSensorEvent)) == 0);
+
+    GLFMSensorEvent fourTimes = event;
+    for (int i = 0; i < 4; i++) {
+        glfm__remapSensorEvent(&fourTimes, GLFMInterfaceOrientationLandscapeRight);
+    }
+    GLFM_TEST_CHECK(memcmp(&fourTimes, &event, sizeof(GLFMSensorEvent)) == 0);
+}
+
+static void benchmark(const char *name, GLFMSensorEvent event) {
+    // Alternate between two orientations so that the compiler can't fold the loop
+    double sum = 0.0;
+    const double start = glfmTestGetRealTime();
+    for (int i = 0; i < BENCHMARK_EVENT_COUNT; i++) {
+        glfm__remapSensorEvent(&event, (i & 1) ? GLFMInterfaceOrientationLandscapeLeft :
+                               GLFMInterfaceOrientationLandscapeRight);
+        sum += event.vector.x;
+    }
+    const double elapsed = glfmTestGetRealTime() - start;
+    printf("%-8s %6.2f ns/event (checksum %g)\n", name, elapsed * 1e9 / BENCHMARK_EVENT_COUNT, sum);
+}
+
+int main(void) {
+    testMatrices();
+    testVectors();
+    testComposition();
+    benchmark("Vector", randomVectorEvent(GLFMSensorAccelerometer));
+    benchmark("Matrix", randomMatrixEvent());
+    return glfmTestResult();
+}
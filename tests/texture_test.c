@@ -0,0 +1,905 @@
+// Tests the texture encoders (glfm_texture.h): encodes blocks and images in each format, decodes
+// them with the reference decoders below, and checks the PSNR, and that blocks of two colors are
+// exact. Checks the mip chain, KTX2 loading, and texture jobs. If an EGL display is available,
+// uploads each format the driver supports, and checks that the driver decodes it like the reference
+// decoders. Benchmarks the encoding speed and the GPU memory saved for each format.
+
+#include "glfm.h"
+#include "glfm_test.h"
+#include <string.h>
+#if GLFM_TEST_HAS_ZLIB
+#  include <zlib.h>
+#endif
+
+#define IMAGE_SIZE 256
+#define BENCHMARK_SIZE 1024
+#define GL_SIZE 64
+
+// MARK: - Reference decoders
+
+static int clamp255(int value) {
+    return value < 0 ? 0 : (value > 255 ? 255 : value);
+}
+
+static void decodeColor565(uint16_t c, int rgb[3]) {
+    const int r = (c >> 11) & 31;
+    const int g = (c >> 5) & 63;
+    const int b = c & 31;
+    rgb[0] = (r << 3) | (r >> 2);
+    rgb[1] = (g << 2) | (g >> 4);
+    rgb[2] = (b << 3) | (b >> 2);
+}
+
+/// Decodes the RGB of a BC1 block to `block`, in row-major order.
+static void decodeBC1(const uint8_t *in, uint8_t block[16][4]) {
+    const uint16_t c0 = (uint16_t)(in[0] | in[1] << 8);
+    const uint16_t c1 = (uint16_t)(in[2] | in[3] << 8);
+    int palette[4][3];
+    decodeColor565(c0, palette[0]);
+    decodeColor565(c1, palette[1]);
+    for (int c = 0; c < 3; c++) {
+        if (c0 > c1) {
+            palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+        } else {
+            palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+            palette[3][c] = 0;
+        }
+    }
+    const uint32_t indices = (uint32_t)in[4] | (uint32_t)in[5] << 8 | (uint32_t)in[6] << 16 |
+                             (uint32_t)in[7] << 24;
+    for (int i = 0; i < 16; i++) {
+        const int p = (indices >> (i * 2)) & 3;
+        for (int c = 0; c < 3; c++) {
+            block[i][c] = (uint8_t)palette[p][c];
+        }
+    }
+}
+
+/// Decodes the alpha of a BC3 block to `block`, in row-major order.
+static void decodeBC3Alpha(const uint8_t *in, uint8_t block[16][4]) {
+    const int a0 = in[0];
+    const int a1 = in[1];
+    int palette[8] = { a0, a1, 0, 0, 0, 0, 0, 255 };
+    if (a0 > a1) {
+        for (int i = 1; i < 7; i++) {
+            palette[i + 1] = ((7 - i) * a0 + i * a1) / 7;
+        }
+    } else {
+        for (int i = 1; i < 5; i++) {
+            palette[i + 1] = ((5 - i) * a0 + i * a1) / 5;
+        }
+    }
+    uint64_t indices = 0;
+    for (int i = 0; i < 6; i++) {
+        indices |= (uint64_t)in[2 + i] << (i * 8);
+    }
+    for (int i = 0; i < 16; i++) {
+        block[i][3] = (uint8_t)palette[(indices >> (i * 3)) & 7];
+    }
+}
+
+static uint64_t readBigEndian64(const uint8_t *in) {
+    uint64_t bits = 0;
+    for (int i = 0; i < 8; i++) {
+        bits = bits << 8 | in[i];
+    }
+    return bits;
+}
+
+/// Decodes the RGB of an ETC2 block in the individual or differential mode to `block`, in
+/// row-major order. Returns false for the other ETC2 modes, which the encoder doesn't use.
+static bool decodeETC2RGB(const uint8_t *in, uint8_t block[16][4]) {
+    static const int modifiers[8][4] = {
+        { 2, 8, -2, -8 }, { 5, 17, -5, -17 }, { 9, 29, -9, -29 }, { 13, 42, -13, -42 },
+        { 18, 60, -18, -60 }, { 24, 80, -24, -80 }, { 33, 106, -33, -106 }, { 47, 183, -47, -183 },
+    };
+    const uint64_t bits = readBigEndian64(in);
+    const bool differential = (bits >> 33) & 1;
+    const bool flip = (bits >> 32) & 1;
+    int base[2][3];
+    for (int c = 0; c < 3; c++) {
+        const int shift = 56 - c * 8;
+        if (differential) {
+            const int base0 = (int)(bits >> (shift + 3)) & 31;
+            int delta = (int)(bits >> shift) & 7;
+            delta = delta >= 4 ? delta - 8 : delta;
+            if (base0 + delta < 0 || base0 + delta > 31) {
+                return false;
+            }
+            base[0][c] = (base0 << 3) | (base0 >> 2);
+            base[1][c] = ((base0 + delta) << 3) | ((base0 + delta) >> 2);
+        } else {
+            const int base0 = (int)(bits >> (shift + 4)) & 15;
+            const int base1 = (int)(bits >> shift) & 15;
+            base[0][c] = (base0 << 4) | base0;
+            base[1][c] = (base1 << 4) | base1;
+        }
+    }
+    const int tables[2] = { (int)(bits >> 37) & 7, (int)(bits >> 34) & 7 };
+    for (int x = 0; x < 4; x++) {
+        for (int y = 0; y < 4; y++) {
+            const int k = x * 4 + y;
+            const int s = flip ? (y >= 2) : (x >= 2);
+            const int index = (int)((bits >> (16 + k)) & 1) << 1 | (int)((bits >> k) & 1);
+            for (int c = 0; c < 3; c++) {
+                block[y * 4 + x][c] = (uint8_t)clamp255(base[s][c] + modifiers[tables[s]][index]);
+            }
+        }
+    }
+    return true;
+}
+
+/// Decodes an EAC alpha block to `block`, in row-major order.
+static void decodeEACAlpha(const uint8_t *in, uint8_t block[16][4]) {
+    static const int modifiers[16][8] = {
+        { -3, -6, -9, -15, 2, 5, 8, 14 }, { -3, -7, -10, -13, 2, 6, 9, 12 },
+        { -2, -5, -8, -13, 1, 4, 7, 12 }, { -2, -4, -6, -13, 1, 3, 5, 12 },
+        { -3, -6, -8, -12, 2, 5, 7, 11 }, { -3, -7, -9, -11, 2, 6, 8, 10 },
+        { -4, -7, -8, -11, 3, 6, 7, 10 }, { -3, -5, -8, -11, 2, 4, 7, 10 },
+        { -2, -6, -8, -10, 1, 5, 7, 9 }, { -2, -5, -8, -10, 1, 4, 7, 9 },
+        { -2, -4, -8, -10, 1, 3, 7, 9 }, { -2, -5, -7, -10, 1, 4, 6, 9 },
+        { -3, -4, -7, -10, 2, 3, 6, 9 }, { -1, -2, -3, -10, 0, 1, 2, 9 },
+        { -4, -6, -8, -9, 3, 5, 7, 8 }, { -3, -5, -7, -9, 2, 4, 6, 8 },
+    };
+    const uint64_t bits = readBigEndian64(in);
+    const int base = (int)(bits >> 56);
+    const int multiplier = (int)(bits >> 52) & 15;
+    const int table = (int)(bits >> 48) & 15;
+    for (int k = 0; k < 16; k++) {
+        const int index = (int)(bits >> (45 - k * 3)) & 7;
+        block[(k & 3) * 4 + (k >> 2)][3] = (uint8_t)clamp255(base + modifiers[table][index] * multiplier);
+    }
+}
+
+static uint32_t readBits(const uint8_t *in, int offset, int count) {
+    uint32_t value = 0;
+    for (int i = 0; i < count; i++) {
+        value |= (uint32_t)((in[(offset + i) >> 3] >> ((offset + i) & 7)) & 1) << i;
+    }
+    return value;
+}
+
+/// Decodes an ASTC 4x4 block to `block`, in row-major order, for the blocks the encoder writes: one
+/// partition, a 4x4 weight grid of one plane with 2-bit or 3-bit weights, and LDR RGB (mode 8) or
+/// RGBA (mode 12) direct endpoints of 8 bits each. Returns false for other blocks.
+static bool decodeASTC(const uint8_t *in, uint8_t block[16][4]) {
+    // Block modes with bits 2-3 clear and bits 0-1 set: D H B B A A R0 0 0 R2 R1
+    const uint32_t blockMode = readBits(in, 0, 11);
+    if ((blockMode & 3) == 0 || (blockMode & 0xc) != 0) {
+        return false;
+    }
+    const int range = (int)((blockMode & 3) << 1 | ((blockMode >> 4) & 1));
+    const int gridWidth = (int)((blockMode >> 7) & 3) + 4;
+    const int gridHeight = (int)((blockMode >> 5) & 3) + 2;
+    const bool highPrecision = (blockMode >> 9) & 1;
+    const bool dualPlane = (blockMode >> 10) & 1;
+    if (gridWidth != 4 || gridHeight != 4 || highPrecision || dualPlane ||
+        (range != 4 && range != 7) || readBits(in, 11, 2) != 0) {
+        return false;
+    }
+    const int weightBits = range == 4 ? 2 : 3;
+    const uint32_t endpointMode = readBits(in, 13, 4);
+    const int channelCount = endpointMode == 8 ? 3 : (endpointMode == 12 ? 4 : 0);
+    if (channelCount == 0) {
+        return false;
+    }
+    int e0[4] = { 0, 0, 0, 255 };
+    int e1[4] = { 0, 0, 0, 255 };
+    for (int c = 0; c < channelCount; c++) {
+        e0[c] = (int)readBits(in, 17 + c * 16, 8);
+        e1[c] = (int)readBits(in, 17 + c * 16 + 8, 8);
+    }
+    if (e0[0] + e0[1] + e0[2] > e1[0] + e1[1] + e1[2]) {
+        // Blue contraction, which the encoder avoids
+        return false;
+    }
+    for (int i = 0; i < 16; i++) {
+        // Weights are stored bit-reversed from the end of the block, and unquantized by bit
+        // replication to 6 bits, plus one if greater than 32.
+        int weight = 0;
+        for (int b = 0; b < weightBits; b++) {
+            weight |= (int)readBits(in, 127 - (i * weightBits + b), 1) << b;
+        }
+        weight = weightBits == 2 ? (weight << 4 | weight << 2 | weight) : (weight << 3 | weight);
+        weight += weight > 32;
+        for (int c = 0; c < 4; c++) {
+            // Endpoints are expanded to 16 bits, and the result is converted back to 8 bits
+            const int color = (e0[c] * 257 * (64 - weight) + e1[c] * 257 * weight + 32) >> 6;
+            block[i][c] = (uint8_t)((color + 128) / 257);
+        }
+    }
+    return true;
+}
+
+static bool hasAlphaChannel(GLFMTextureFormat format) {
+    return (format == GLFMTextureFormatRGBA8 || format == GLFMTextureFormatBC3 ||
+            format == GLFMTextureFormatETC2RGBA8 || format == GLFMTextureFormatASTC4x4);
+}
+
+/// Decodes one level of a texture to RGBA8. Returns false if a block couldn't be decoded.
+static bool decodeLevel(const GLFMTexture *texture, int levelIndex, uint8_t *rgba) {
+    const GLFMTextureLevel *level = &texture->levels[levelIndex];
+    const uint8_t *in = texture->data + level->offset;
+    if (texture->format == GLFMTextureFormatRGBA8) {
+        memcpy(rgba, in, level->size);
+        return true;
+    }
+    for (int by = 0; by < level->height; by += 4) {
+        for (int bx = 0; bx < level->width; bx += 4) {
+            uint8_t block[16][4];
+            memset(block, 255, sizeof(block));
+            switch (texture->format) {
+                case GLFMTextureFormatBC1:
+                    decodeBC1(in, block);
+                    break;
+                case GLFMTextureFormatBC3:
+                    decodeBC3Alpha(in, block);
+                    decodeBC1(in + 8, block);
+                    break;
+                case GLFMTextureFormatETC2RGB8:
+                    if (!decodeETC2RGB(in, block)) {
+                        return false;
+                    }
+                    break;
+                case GLFMTextureFormatETC2RGBA8:
+                    decodeEACAlpha(in, block);
+                    if (!decodeETC2RGB(in + 8, block)) {
+                        return false;
+                    }
+                    break;
+                case GLFMTextureFormatASTC4x4:
+                    if (!decodeASTC(in, block)) {
+                        return false;
+                    }
+                    break;
+                case GLFMTextureFormatRGBA8:
+                default:
+                    return false;
+            }
+            in += texture->format == GLFMTextureFormatBC1 || texture->format == GLFMTextureFormatETC2RGB8 ? 8 : 16;
+            for (int y = 0; y < 4 && by + y < level->height; y++) {
+                for (int x = 0; x < 4 && bx + x < level->width; x++) {
+                    memcpy(rgba + ((size_t)(by + y) * (size_t)level->width + (size_t)(bx + x)) * 4,
+                           block[y * 4 + x], 4);
+                }
+            }
+        }
+    }
+    return true;
+}
+
+// MARK: - Images
+
+/// Gets the PSNR of the RGB channels, or of the alpha channel, in decibels.
+static double psnr(const uint8_t *a, const uint8_t *b, size_t pixelCount, bool alpha) {
+    double sum = 0.0;
+    for (size_t i = 0; i < pixelCount; i++) {
+        for (int c = alpha ? 3 : 0; c < (alpha ? 4 : 3); c++) {
+            const double d = (double)a[i * 4 + (size_t)c] - (double)b[i * 4 + (size_t)c];
+            sum += d * d;
+        }
+    }
+    const double mse = sum / (double)(pixelCount * (alpha ? 1 : 3));
+    return mse > 0.0 ? 10.0 * log10(255.0 * 255.0 / mse) : INFINITY;
+}
+
+/// A smooth image, like a photo: gradients, soft circles, and a little noise, with an alpha
+/// gradient.
+static uint8_t *createImage(int width, int height) {
+    uint8_t *rgba = malloc((size_t)width * (size_t)height * 4);
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            const double u = (double)x / width;
+            const double v = (double)y / height;
+            const double circle = 0.5 + 0.5 * cos(20.0 * hypot(u - 0.4, v - 0.6));
+            uint8_t *pixel = rgba + ((size_t)y * (size_t)width + (size_t)x) * 4;
+            pixel[0] = (uint8_t)clamp255((int)(255.0 * u * circle + 8.0 * glfmTestRandom()));
+            pixel[1] = (uint8_t)clamp255((int)(255.0 * v + 8.0 * glfmTestRandom()));
+            pixel[2] = (uint8_t)clamp255((int)(160.0 * circle + 48.0 + 8.0 * glfmTestRandom()));
+            pixel[3] = (uint8_t)clamp255((int)(255.0 * (1.0 - u * v)));
+        }
+    }
+    return rgba;
+}
+
+/// A font atlas, like the one of the typing example: random glyphs of premultiplied white on
+/// transparent black, or of opaque white on black.
+static uint8_t *createGlyphImage(int width, int height, bool transparent) {
+    uint8_t *rgba = malloc((size_t)width * (size_t)height * 4);
+    for (size_t i = 0; i < (size_t)width * (size_t)height; i++) {
+        const uint8_t value = glfmTestRandom() < 0.4 ? 255 : 0;
+        rgba[i * 4 + 0] = value;
+        rgba[i * 4 + 1] = value;
+        rgba[i * 4 + 2] = value;
+        rgba[i * 4 + 3] = transparent ? value : 255;
+    }
+    return rgba;
+}
+
+// MARK: - Tests
+
+static const GLFMTextureFormat formats[] = {
+    GLFMTextureFormatBC1, GLFMTextureFormatBC3, GLFMTextureFormatETC2RGB8,
+    GLFMTextureFormatETC2RGBA8, GLFMTextureFormatASTC4x4,
+};
+#define FORMAT_COUNT (sizeof(formats) / sizeof(*formats))
+
+/// Encodes a 4x4 image, and decodes it.
+static bool roundTripBlock(const uint8_t block[16][4], GLFMTextureFormat format,
+                           uint8_t decoded[16][4]) {
+    GLFMTexture texture;
+    if (!glfmEncodeTexture(&block[0][0], 4, 4, format, false, &texture)) {
+        return false;
+    }
+    const bool success = decodeLevel(&texture, 0, &decoded[0][0]);
+    glfmFreeTexture(&texture);
+    return success;
+}
+
+/// Known blocks: a solid color encodes exactly in BC1 (where it is representable in RGB565), and
+/// nearly exactly in the other formats. Blocks of two colors, and gradients, stay within a bound.
+static void testBlocks(void) {
+    uint8_t solid[16][4];
+    for (int i = 0; i < 16; i++) {
+        solid[i][0] = 255;
+        solid[i][1] = 0;
+        solid[i][2] = 132;
+        solid[i][3] = 200;
+    }
+    GLFMTexture texture;
+    GLFM_TEST_CHECK(glfmEncodeTexture(&solid[0][0], 4, 4, GLFMTextureFormatBC1, false, &texture));
+    static const uint8_t expectedBC1[8] = { 0x10, 0xf8, 0x10, 0xf8, 0, 0, 0, 0 };
+    GLFM_TEST_CHECK(texture.dataSize == 8 && memcmp(texture.data, expectedBC1, 8) == 0);
+    glfmFreeTexture(&texture);
+
+    uint8_t edge[16][4];
+    uint8_t gradient[16][4];
+    for (int i = 0; i < 16; i++) {
+        const bool left = (i % 4) < 2;
+        edge[i][0] = left ? 20 : 230;
+        edge[i][1] = left ? 40 : 200;
+        edge[i][2] = left ? 60 : 10;
+        edge[i][3] = left ? 255 : 0;
+        gradient[i][0] = (uint8_t)(100 + (i % 4) * 20);
+        gradient[i][1] = (uint8_t)(50 + (i / 4) * 30);
+        gradient[i][2] = 90;
+        gradient[i][3] = (uint8_t)(i * 17);
+    }
+
+    static const struct {
+        const char *name;
+        double minRGB[FORMAT_COUNT];
+        double minAlpha[FORMAT_COUNT];
+    } bounds[] = {
+        // In the order of `formats`. Endpoints are quantized to RGB565 (BC1) or to 4 or 5 bits
+        // (ETC2), so two colors aren't always exact. A block has one line of colors (BC1, ASTC) or
+        // one base color per sub-block (ETC2), so a 2D gradient, and 16 levels of alpha, have
+        // some error. ASTC blocks with alpha have 2-bit weights.
+        { "solid", { 40, 40, 40, 40, 40 }, { 0, INFINITY, 0, INFINITY, 45 } },
+        { "edge", { 30, 30, 30, 30, 40 }, { 0, INFINITY, 0, INFINITY, 45 } },
+        { "gradient", { 22, 22, 23, 23, 24 }, { 0, 26, 0, 26, 20 } },
+    };
+    const uint8_t (*blocks[])[4] = { solid, edge, gradient };
+    for (size_t b = 0; b < sizeof(blocks) / sizeof(*blocks); b++) {
+        for (size_t f = 0; f < FORMAT_COUNT; f++) {
+            uint8_t decoded[16][4];
+            GLFM_TEST_CHECK(roundTripBlock(blocks[b], formats[f], decoded));
+            const double rgb = psnr(&blocks[b][0][0], &decoded[0][0], 16, false);
+            const double alpha = psnr(&blocks[b][0][0], &decoded[0][0], 16, true);
+            if (rgb < bounds[b].minRGB[f] || alpha < bounds[b].minAlpha[f]) {
+                fprintf(stderr, "%s block, %s: RGB %.1f dB, alpha %.1f dB\n", bounds[b].name,
+                        glfmGetTextureFormatName(formats[f]), rgb, alpha);
+            }
+            GLFM_TEST_CHECK(rgb >= bounds[b].minRGB[f]);
+            GLFM_TEST_CHECK(alpha >= bounds[b].minAlpha[f]);
+        }
+    }
+}
+
+/// Blocks of two colors, black and white, are exact in every format, so a font atlas can be
+/// compressed without changing it.
+static void testGlyphs(void) {
+    for (int transparent = 0; transparent < 2; transparent++) {
+        uint8_t *image = createGlyphImage(56, 392, transparent);
+        uint8_t *decoded = malloc(56 * 392 * 4);
+        for (size_t f = 0; f < FORMAT_COUNT; f++) {
+            if (transparent && !hasAlphaChannel(formats[f])) {
+                continue;
+            }
+            GLFMTexture texture;
+            GLFM_TEST_CHECK(glfmEncodeTexture(image, 56, 392, formats[f], false, &texture));
+            const bool exact = (decodeLevel(&texture, 0, decoded) &&
+                                memcmp(image, decoded, 56 * 392 * 4) == 0);
+            if (!exact) {
+                fprintf(stderr, "Glyphs (%s) not exact in %s\n",
+                        transparent ? "transparent" : "opaque", glfmGetTextureFormatName(formats[f]));
+            }
+            GLFM_TEST_CHECK(exact);
+            glfmFreeTexture(&texture);
+        }
+        free(decoded);
+        free(image);
+    }
+}
+
+/// Encodes an image in each format with mipmaps, and checks the PSNR of each level against the
+/// RGBA8 mip chain. Levels smaller than 64x64 aren't checked, since a few blocks cover the image.
+static void testImage(void) {
+    uint8_t *image = createImage(IMAGE_SIZE, IMAGE_SIZE);
+    GLFMTexture reference;
+    GLFM_TEST_CHECK(glfmEncodeTexture(image, IMAGE_SIZE, IMAGE_SIZE, GLFMTextureFormatRGBA8, true,
+                                      &reference));
+    uint8_t *decoded = malloc(IMAGE_SIZE * IMAGE_SIZE * 4);
+    for (size_t f = 0; f < FORMAT_COUNT; f++) {
+        const bool hasAlpha = hasAlphaChannel(formats[f]);
+        GLFMTexture texture;
+        GLFM_TEST_CHECK(glfmEncodeTexture(image, IMAGE_SIZE, IMAGE_SIZE, formats[f], true, &texture));
+        GLFM_TEST_CHECK(texture.levelCount == reference.levelCount);
+        double minRGB = INFINITY;
+        double minAlpha = INFINITY;
+        int checkedCount = 0;
+        for (int i = 0; i < texture.levelCount && i < reference.levelCount; i++) {
+            const GLFMTextureLevel *level = &texture.levels[i];
+            if (level->width < 64 || level->height < 64) {
+                break;
+            }
+            checkedCount++;
+            const size_t pixelCount = (size_t)level->width * (size_t)level->height;
+            GLFM_TEST_CHECK(decodeLevel(&texture, i, decoded));
+            const uint8_t *expected = reference.data + reference.levels[i].offset;
+            minRGB = fmin(minRGB, psnr(expected, decoded, pixelCount, false));
+            if (hasAlpha) {
+                minAlpha = fmin(minAlpha, psnr(expected, decoded, pixelCount, true));
+            }
+        }
+        printf("%-11s min PSNR of %i levels: RGB %5.1f dB", glfmGetTextureFormatName(formats[f]),
+               checkedCount, minRGB);
+        if (hasAlpha) {
+            printf(", alpha %5.1f dB", minAlpha);
+        }
+        printf("\n");
+        // ASTC has the alpha of a block on the same 2-bit weights as the color
+        GLFM_TEST_CHECK(checkedCount == 3);
+        GLFM_TEST_CHECK(minRGB >= 30.0);
+        GLFM_TEST_CHECK(minAlpha >= (formats[f] == GLFMTextureFormatASTC4x4 ? 38.0 : 45.0));
+        glfmFreeTexture(&texture);
+    }
+    free(decoded);
+    glfmFreeTexture(&reference);
+    free(image);
+}
+
+/// The mip chain: level sizes, offsets, and the box filter, for a non-power-of-two size.
+static void testMipChain(void) {
+    static const int expectedSizes[][2] = {
+        { 100, 60 }, { 50, 30 }, { 25, 15 }, { 12, 7 }, { 6, 3 }, { 3, 1 }, { 1, 1 },
+    };
+    const int expectedCount = (int)(sizeof(expectedSizes) / sizeof(*expectedSizes));
+    uint8_t *image = createImage(100, 60);
+    for (int f = -1; f < (int)FORMAT_COUNT; f++) {
+        const GLFMTextureFormat format = f < 0 ? GLFMTextureFormatRGBA8 : formats[f];
+        const size_t blockSize = (format == GLFMTextureFormatBC1 ||
+                                  format == GLFMTextureFormatETC2RGB8) ? 8 : 16;
+        GLFMTexture texture;
+        GLFM_TEST_CHECK(glfmEncodeTexture(image, 100, 60, format, true, &texture));
+        GLFM_TEST_CHECK(texture.format == format);
+        GLFM_TEST_CHECK(texture.levelCount == expectedCount);
+        size_t offset = 0;
+        size_t rgbaSize = 0;
+        for (int i = 0; i < texture.levelCount && i < expectedCount; i++) {
+            const GLFMTextureLevel *level = &texture.levels[i];
+            GLFM_TEST_CHECK(level->width == expectedSizes[i][0]);
+            GLFM_TEST_CHECK(level->height == expectedSizes[i][1]);
+            GLFM_TEST_CHECK(level->offset == offset);
+            const size_t blocks = (size_t)((level->width + 3) / 4) * (size_t)((level->height + 3) / 4);
+            const size_t pixelCount = (size_t)level->width * (size_t)level->height;
+            GLFM_TEST_CHECK(level->size == (format == GLFMTextureFormatRGBA8 ? pixelCount * 4 :
+                                            blocks * blockSize));
+            offset += level->size;
+            rgbaSize += pixelCount * 4;
+        }
+        GLFM_TEST_CHECK(texture.dataSize == offset);
+        GLFM_TEST_CHECK(texture.rgbaSize == rgbaSize);
+
+        if (format == GLFMTextureFormatRGBA8) {
+            // Level 1 is the rounded average of each 2x2 square of level 0
+            const uint8_t *level0 = texture.data;
+            const uint8_t *level1 = texture.data + texture.levels[1].offset;
+            bool averaged = true;
+            for (int y = 0; y < 30; y++) {
+                for (int x = 0; x < 50; x++) {
+                    for (int c = 0; c < 4; c++) {
+                        const int sum = (level0[((y * 2) * 100 + x * 2) * 4 + c] +
+                                         level0[((y * 2) * 100 + x * 2 + 1) * 4 + c] +
+                                         level0[((y * 2 + 1) * 100 + x * 2) * 4 + c] +
+                                         level0[((y * 2 + 1) * 100 + x * 2 + 1) * 4 + c]);
+                        averaged &= level1[(y * 50 + x) * 4 + c] == (sum + 2) / 4;
+                    }
+                }
+            }
+            GLFM_TEST_CHECK(averaged);
+        }
+        glfmFreeTexture(&texture);
+    }
+
+    // Without mipmaps
+    GLFMTexture texture;
+    GLFM_TEST_CHECK(glfmEncodeTexture(image, 100, 60, GLFMTextureFormatBC1, false, &texture));
+    GLFM_TEST_CHECK(texture.levelCount == 1);
+    GLFM_TEST_CHECK(texture.dataSize == 25 * 15 * 8);
+    glfmFreeTexture(&texture);
+    GLFM_TEST_CHECK(texture.data == NULL && texture.levelCount == 0);
+
+    // Invalid parameters
+    GLFM_TEST_CHECK(!glfmEncodeTexture(image, 0, 60, GLFMTextureFormatBC1, true, &texture));
+    GLFM_TEST_CHECK(!glfmEncodeTexture(image, 16385, 1, GLFMTextureFormatBC1, true, &texture));
+    GLFM_TEST_CHECK(!glfmEncodeTexture(image, 100, 60, (GLFMTextureFormat)99, true, &texture));
+    GLFM_TEST_CHECK(!glfmEncodeTexture(NULL, 100, 60, GLFMTextureFormatBC1, true, &texture));
+    GLFM_TEST_CHECK(texture.data == NULL);
+    free(image);
+}
+
+/// Preferred formats: S3TC first, and ASTC before ETC2 only with alpha.
+static void testPreferredFormats(void) {
+    const uint32_t rgba8 = 1u << GLFMTextureFormatRGBA8;
+    const uint32_t s3tc = (1u << GLFMTextureFormatBC1) | (1u << GLFMTextureFormatBC3);
+    const uint32_t etc2 = (1u << GLFMTextureFormatETC2RGB8) | (1u << GLFMTextureFormatETC2RGBA8);
+    const uint32_t astc = 1u << GLFMTextureFormatASTC4x4;
+    GLFM_TEST_CHECK(glfmGetPreferredTextureFormat(rgba8, false) == GLFMTextureFormatRGBA8);
+    GLFM_TEST_CHECK(glfmGetPreferredTextureFormat(rgba8, true) == GLFMTextureFormatRGBA8);
+    GLFM_TEST_CHECK(glfmGetPreferredTextureFormat(rgba8 | s3tc | etc2 | astc, false) == GLFMTextureFormatBC1);
+    GLFM_TEST_CHECK(glfmGetPreferredTextureFormat(rgba8 | s3tc | etc2 | astc, true) == GLFMTextureFormatBC3);
+    GLFM_TEST_CHECK(glfmGetPreferredTextureFormat(rgba8 | etc2 | astc, false) == GLFMTextureFormatETC2RGB8);
+    GLFM_TEST_CHECK(glfmGetPreferredTextureFormat(rgba8 | etc2 | astc, true) == GLFMTextureFormatASTC4x4);
+    GLFM_TEST_CHECK(glfmGetPreferredTextureFormat(rgba8 | etc2, true) == GLFMTextureFormatETC2RGBA8);
+    GLFM_TEST_CHECK(glfmGetPreferredTextureFormat(rgba8 | astc, false) == GLFMTextureFormatASTC4x4);
+}
+
+/// Jobs give the same texture as encoding on the calling thread.
+static void testJobs(void) {
+    uint8_t *image = createImage(100, 60);
+    GLFMTexture expected;
+    GLFM_TEST_CHECK(glfmEncodeTexture(image, 100, 60, GLFMTextureFormatETC2RGBA8, true, &expected));
+    GLFMTextureJob *jobs[4];
+    for (int i = 0; i < 4; i++) {
+        jobs[i] = glfmEncodeTextureAsync(image, 100, 60, GLFMTextureFormatETC2RGBA8, true);
+        GLFM_TEST_CHECK(jobs[i] != NULL);
+    }
+    for (int i = 0; i < 4; i++) {
+        GLFMTexture texture;
+        GLFM_TEST_CHECK(glfmFinishTextureJob(jobs[i], &texture));
+        GLFM_TEST_CHECK(texture.dataSize == expected.dataSize &&
+                        memcmp(texture.data, expected.data, expected.dataSize) == 0);
+        glfmFreeTexture(&texture);
+    }
+    // A failed job
+    GLFMTextureJob *job = glfmEncodeTextureAsync(image, 0, 60, GLFMTextureFormatBC1, true);
+    GLFM_TEST_CHECK(job != NULL);
+    GLFMTexture texture;
+    GLFM_TEST_CHECK(!glfmFinishTextureJob(job, &texture));
+    GLFM_TEST_CHECK(texture.data == NULL);
+    glfmFreeTexture(&expected);
+    free(image);
+}
+
+// MARK: - KTX2
+
+#define VK_FORMAT_R8G8B8A8_UNORM 37
+#define VK_FORMAT_R8G8B8A8_SRGB 43
+#define VK_FORMAT_BC3_UNORM_BLOCK 137
+
+static void writeLE32(uint8_t *out, uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+        out[i] = (uint8_t)(value >> (i * 8));
+    }
+}
+
+static void writeLE64(uint8_t *out, uint64_t value) {
+    writeLE32(out, (uint32_t)value);
+    writeLE32(out + 4, (uint32_t)(value >> 32));
+}
+
+/// Writes a KTX2 file with the levels of a texture, smallest level first. If `levelCount` is zero,
+/// only the first level is written. If `zlib` is true, levels are compressed with zlib.
+static uint8_t *writeKTX2(uint32_t vkFormat, const GLFMTexture *texture, uint32_t levelCount,
+                          bool zlib, size_t *size) {
+    static const uint8_t identifier[12] = {
+        0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A
+    };
+    const uint32_t fileLevelCount = levelCount > 0 ? levelCount : 1;
+    const size_t headerSize = 80 + fileLevelCount * 24;
+    uint8_t *file = calloc(1, headerSize + texture->dataSize * 2 + 1024);
+    memcpy(file, identifier, sizeof(identifier));
+    writeLE32(file + 12, vkFormat);
+    writeLE32(file + 16, 1);
+    writeLE32(file + 20, (uint32_t)texture->levels[0].width);
+    writeLE32(file + 24, (uint32_t)texture->levels[0].height);
+    writeLE32(file + 36, 1);
+    writeLE32(file + 40, levelCount);
+    writeLE32(file + 44, zlib ? 3 : 0);
+    size_t offset = headerSize;
+    for (int i = (int)fileLevelCount - 1; i >= 0; i--) {
+        const GLFMTextureLevel *level = &texture->levels[i];
+        size_t length = level->size;
+#if GLFM_TEST_HAS_ZLIB
+        if (zlib) {
+            uLongf compressedLength = (uLongf)(level->size * 2 + 64);
+            GLFM_TEST_CHECK(compress2(file + offset, &compressedLength, texture->data + level->offset,
+                                      (uLong)level->size, 9) == Z_OK);
+            length = compressedLength;
+        } else
+#endif
+        {
+            memcpy(file + offset, texture->data + level->offset, level->size);
+        }
+        uint8_t *entry = file + 80 + i * 24;
+        writeLE64(entry, offset);
+        writeLE64(entry + 8, length);
+        writeLE64(entry + 16, level->size);
+        offset += length;
+    }
+    *size = offset;
+    return file;
+}
+
+static bool sameTexture(const GLFMTexture *a, const GLFMTexture *b) {
+    return (a->format == b->format && a->levelCount == b->levelCount && a->dataSize == b->dataSize &&
+            memcmp(a->levels, b->levels, sizeof(a->levels)) == 0 &&
+            memcmp(a->data, b->data, a->dataSize) == 0);
+}
+
+static void testKTX2(void) {
+    uint8_t *image = createImage(100, 60);
+    GLFMTexture rgba;
+    GLFMTexture bc1;
+    GLFMTexture bc3;
+    GLFM_TEST_CHECK(glfmEncodeTexture(image, 100, 60, GLFMTextureFormatRGBA8, true, &rgba));
+    GLFM_TEST_CHECK(glfmEncodeTexture(image, 100, 60, GLFMTextureFormatBC1, true, &bc1));
+    GLFM_TEST_CHECK(glfmEncodeTexture(image, 100, 60, GLFMTextureFormatBC3, true, &bc3));
+    size_t size;
+    GLFMTexture texture;
+
+#if GLFM_FEATURE_KTX2
+    // RGBA8 without levels: the mip chain is built, and encoded to the requested format
+    uint8_t *file = writeKTX2(VK_FORMAT_R8G8B8A8_UNORM, &rgba, 0, false, &size);
+    GLFM_TEST_CHECK(glfmLoadKTX2Texture(file, size, GLFMTextureFormatBC1, &texture));
+    GLFM_TEST_CHECK(sameTexture(&texture, &bc1));
+    glfmFreeTexture(&texture);
+
+    // The same file, on a job
+    GLFMTextureJob *job = glfmLoadKTX2TextureAsync(file, size, GLFMTextureFormatBC1);
+    GLFM_TEST_CHECK(glfmFinishTextureJob(job, &texture));
+    GLFM_TEST_CHECK(sameTexture(&texture, &bc1));
+    glfmFreeTexture(&texture);
+
+    // Invalid files, and the requested format
+    file[0] = 0;
+    GLFM_TEST_CHECK(!glfmLoadKTX2Texture(file, size, GLFMTextureFormatBC1, &texture));
+    file[0] = 0xAB;
+    GLFM_TEST_CHECK(!glfmLoadKTX2Texture(file, size - 1, GLFMTextureFormatBC1, &texture));
+    GLFM_TEST_CHECK(!glfmLoadKTX2Texture(file, 79, GLFMTextureFormatBC1, &texture));
+    GLFM_TEST_CHECK(!glfmLoadKTX2Texture(file, size, (GLFMTextureFormat)99, &texture));
+    writeLE32(file + 12, VK_FORMAT_R8G8B8A8_SRGB);
+    GLFM_TEST_CHECK(!glfmLoadKTX2Texture(file, size, GLFMTextureFormatBC1, &texture));
+    writeLE32(file + 12, VK_FORMAT_R8G8B8A8_UNORM);
+    writeLE32(file + 44, 1); // Basis Universal
+    GLFM_TEST_CHECK(!glfmLoadKTX2Texture(file, size, GLFMTextureFormatBC1, &texture));
+    writeLE32(file + 44, 0);
+    writeLE32(file + 36, 6); // Cube map
+    GLFM_TEST_CHECK(!glfmLoadKTX2Texture(file, size, GLFMTextureFormatBC1, &texture));
+    GLFM_TEST_CHECK(texture.data == NULL);
+    free(file);
+
+    // RGBA8 with two levels: the levels of the file are used, and no more are built
+    GLFMTexture twoLevels = rgba;
+    twoLevels.levelCount = 2;
+    memset(twoLevels.data + rgba.levels[1].offset, 128, rgba.levels[1].size);
+    file = writeKTX2(VK_FORMAT_R8G8B8A8_UNORM, &twoLevels, 2, false, &size);
+    GLFM_TEST_CHECK(glfmLoadKTX2Texture(file, size, GLFMTextureFormatRGBA8, &texture));
+    GLFM_TEST_CHECK(texture.levelCount == 2);
+    GLFM_TEST_CHECK(texture.dataSize == rgba.levels[0].size + rgba.levels[1].size);
+    GLFM_TEST_CHECK(memcmp(texture.data, rgba.data, texture.dataSize) == 0);
+    glfmFreeTexture(&texture);
+    free(file);
+
+    // A block format is used as-is, whatever the requested format
+    file = writeKTX2(VK_FORMAT_BC3_UNORM_BLOCK, &bc3, (uint32_t)bc3.levelCount, false, &size);
+    GLFM_TEST_CHECK(glfmLoadKTX2Texture(file, size, GLFMTextureFormatETC2RGB8, &texture));
+    GLFM_TEST_CHECK(sameTexture(&texture, &bc3));
+    glfmFreeTexture(&texture);
+    // A level of the wrong size
+    writeLE64(file + 80 + 16, bc3.levels[0].size + 16);
+    GLFM_TEST_CHECK(!glfmLoadKTX2Texture(file, size, GLFMTextureFormatBC3, &texture));
+    free(file);
+
+#if GLFM_TEST_HAS_ZLIB
+    // Levels supercompressed with zlib
+    file = writeKTX2(VK_FORMAT_BC3_UNORM_BLOCK, &bc3, (uint32_t)bc3.levelCount, true, &size);
+    GLFM_TEST_CHECK(size < bc3.dataSize);
+    GLFM_TEST_CHECK(glfmLoadKTX2Texture(file, size, GLFMTextureFormatBC3, &texture));
+    GLFM_TEST_CHECK(sameTexture(&texture, &bc3));
+    glfmFreeTexture(&texture);
+    // A corrupt stream
+    file[size - 8] ^= 0xff;
+    GLFM_TEST_CHECK(!glfmLoadKTX2Texture(file, size, GLFMTextureFormatBC3, &texture));
+    free(file);
+#endif
+#else
+    uint8_t *file = writeKTX2(VK_FORMAT_R8G8B8A8_UNORM, &rgba, 0, false, &size);
+    GLFM_TEST_CHECK(!glfmLoadKTX2Texture(file, size, GLFMTextureFormatBC1, &texture));
+    GLFM_TEST_CHECK(glfmLoadKTX2TextureAsync(file, size, GLFMTextureFormatBC1) == NULL);
+    free(file);
+#endif
+    glfmFreeTexture(&bc3);
+    glfmFreeTexture(&bc1);
+    glfmFreeTexture(&rgba);
+    free(image);
+}
+
+// MARK: - OpenGL ES
+
+typedef struct {
+    uint8_t *image;
+    bool surfaceError;
+    int checkedCount;
+} DriverTest;
+
+static GLuint compileShader(GLenum type, const char *source) {
+    GLuint shader = glCreateShader(type);
+    glShaderSource(shader, 1, &source, NULL);
+    glCompileShader(shader);
+    return shader;
+}
+
+static void onSurfaceError(GLFMDisplay *display, const char *message) {
+    DriverTest *test = glfmGetUserData(display);
+    fprintf(stderr, "Surface error: %s\n", message);
+    test->surfaceError = true;
+}
+
+/// Draws each supported format at its size, nearest-sampled, and compares the pixels to the
+/// reference decoders. Drivers may convert an ASTC texel to 8 bits with different rounding, so
+/// channels may differ by 1.
+static void onDriverDraw(GLFMDisplay *display) {
+    DriverTest *test = glfmGetUserData(display);
+    const uint32_t supportedFormats = glfmGetSupportedTextureFormats(display);
+    GLFM_TEST_CHECK(supportedFormats & (1u << GLFMTextureFormatRGBA8));
+    GLFM_TEST_CHECK(glfmGetSupportedTextureFormats(display) == supportedFormats);
+
+    GLuint program = glCreateProgram();
+    GLuint vertShader = compileShader(GL_VERTEX_SHADER,
+                                      "#version 100\n"
+                                      "attribute highp vec2 position;\n"
+                                      "varying highp vec2 texCoord;\n"
+                                      "void main() {\n"
+                                      "   texCoord = position * 0.5 + 0.5;\n"
+                                      "   gl_Position = vec4(position, 0.0, 1.0);\n"
+                                      "}");
+    GLuint fragShader = compileShader(GL_FRAGMENT_SHADER,
+                                      "#version 100\n"
+                                      "varying highp vec2 texCoord;\n"
+                                      "uniform lowp sampler2D texture0;\n"
+                                      "void main() {\n"
+                                      "  gl_FragColor = texture2D(texture0, texCoord);\n"
+                                      "}");
+    glAttachShader(program, vertShader);
+    glAttachShader(program, fragShader);
+    glBindAttribLocation(program, 0, "position");
+    glLinkProgram(program);
+    glDeleteShader(vertShader);
+    glDeleteShader(fragShader);
+    static const GLfloat vertices[] = { -1.0f, -1.0f, 1.0f, -1.0f, -1.0f, 1.0f, 1.0f, 1.0f };
+    GLuint vertexBuffer = 0;
+    glGenBuffers(1, &vertexBuffer);
+    glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, 0);
+    glUseProgram(program);
+    glViewport(0, 0, GL_SIZE, GL_SIZE);
+    glDisable(GL_BLEND);
+
+    uint8_t *expected = malloc(GL_SIZE * GL_SIZE * 4);
+    uint8_t *pixels = malloc(GL_SIZE * GL_SIZE * 4);
+    for (int f = GLFMTextureFormatRGBA8; f <= GLFMTextureFormatASTC4x4; f++) {
+        const GLFMTextureFormat format = (GLFMTextureFormat)f;
+        if (!(supportedFormats & (1u << format))) {
+            printf("Driver: %s not supported\n", glfmGetTextureFormatName(format));
+            continue;
+        }
+        GLFMTexture texture;
+        GLFM_TEST_CHECK(glfmEncodeTexture(test->image, GL_SIZE, GL_SIZE, format, false, &texture));
+        GLFM_TEST_CHECK(decodeLevel(&texture, 0, expected));
+        GLuint textureId = 0;
+        glGenTextures(1, &textureId);
+        glBindTexture(GL_TEXTURE_2D, textureId);
+        GLFM_TEST_CHECK(glfmUploadTexture(&texture));
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+        glClear(GL_COLOR_BUFFER_BIT);
+        glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+        glReadPixels(0, 0, GL_SIZE, GL_SIZE, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+        glDeleteTextures(1, &textureId);
+
+        // The bottom row of the framebuffer is the first row of the texture
+        int maxDifference = 0;
+        for (size_t i = 0; i < GL_SIZE * GL_SIZE * 4; i++) {
+            if (!hasAlphaChannel(format) && i % 4 == 3) {
+                continue;
+            }
+            const int difference = abs(pixels[i] - expected[i]);
+            maxDifference = difference > maxDifference ? difference : maxDifference;
+        }
+        printf("Driver: %-11s max difference %i\n", glfmGetTextureFormatName(format),
+               maxDifference);
+        GLFM_TEST_CHECK(maxDifference <= 1);
+        test->checkedCount++;
+        glfmFreeTexture(&texture);
+    }
+    free(pixels);
+    free(expected);
+    glDeleteBuffers(1, &vertexBuffer);
+    glDeleteProgram(program);
+    glfmSwapBuffers(display);
+}
+
+static void driverMain(GLFMDisplay *display) {
+    glfmSetDisplayConfig(display, GLFMRenderingAPIOpenGLES3, GLFMColorFormatRGBA8888,
+                         GLFMDepthFormatNone, GLFMStencilFormatNone, GLFMMultisampleNone);
+    glfmSetRenderFunc(display, onDriverDraw);
+    glfmSetSurfaceErrorFunc(display, onSurfaceError);
+}
+
+static void testDriver(void) {
+    DriverTest test;
+    memset(&test, 0, sizeof(test));
+    test.image = createImage(GL_SIZE, GL_SIZE);
+    GLFMDisplay *display = glfmCreateDisplay(driverMain, GL_SIZE, GL_SIZE, &test);
+    if (!glfmRunDisplay(display, 1) || test.surfaceError) {
+        printf("Driver: skipped, no EGL display\n");
+    } else {
+        GLFM_TEST_CHECK(test.checkedCount > 0);
+    }
+    glfmDestroyDisplay(display);
+    free(test.image);
+}
+
+// MARK: - Benchmark
+
+static void benchmark(void) {
+    printf("Job workers: %i\n", glfmGetJobWorkerCount());
+    uint8_t *image = createImage(BENCHMARK_SIZE, BENCHMARK_SIZE);
+    for (size_t f = 0; f < FORMAT_COUNT; f++) {
+        GLFMTexture texture;
+        if (!glfmEncodeTexture(image, BENCHMARK_SIZE, BENCHMARK_SIZE, formats[f], true, &texture)) {
+            GLFM_TEST_CHECK(false);
+            continue;
+        }
+        // The speed is of the RGBA8 input, including the downsampled levels. The GPU memory is the
+        // size of the encoded levels.
+        printf("%-11s %ix%i with mipmaps: %6.1f MB/s, GPU memory %8zu bytes (%zu saved, %.0f%%)\n",
+               glfmGetTextureFormatName(formats[f]), BENCHMARK_SIZE, BENCHMARK_SIZE,
+               (double)texture.rgbaSize / texture.encodeTime / 1e6, texture.dataSize,
+               texture.rgbaSize - texture.dataSize,
+               100.0 * (double)(texture.rgbaSize - texture.dataSize) / (double)texture.rgbaSize);
+        glfmFreeTexture(&texture);
+    }
+    free(image);
+}
+
+int main(void) {
+    // Workers even on one core, so that blocks are encoded on several threads
+    glfmSetJobWorkerCount(3);
+    testBlocks();
+    testGlyphs();
+    testImage();
+    testMipChain();
+    testPreferredFormats();
+    testJobs();
+    testKTX2();
+    testDriver();
+    benchmark();
+    return glfmTestResult();
+}
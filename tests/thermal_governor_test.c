@@ -0,0 +1,200 @@
+// Tests the thermal governor with synthetic headroom curves and a simulated clock, at 60 frames per
+// second: quality steps down before the device throttles, noise and failed samples are ignored, and
+// quality steps back up only after the device has cooled.
+
+#include "glfm_test_platform.h"
+
+#define FRAME_INTERVAL (1.0 / 60.0)
+#define MAX_CHANGES 32
+
+typedef double (*HeadroomCurve)(double time);
+
+static struct {
+    HeadroomCurve curve;
+    double startTime;
+    GLFMThermalState state;
+    bool stateOnly; // Like Apple platforms, which only report the state
+    bool fails;
+    bool nanHeadroom;
+    int pollCount;
+} platform;
+
+static struct {
+    int count;
+    double times[MAX_CHANGES];
+    int levels[MAX_CHANGES];
+    int maxFrameRate;
+    double renderScale;
+} changes;
+
+/// Reaches 1.0, where the device throttles, at 525 seconds.
+static double heatingCurve(double time) {
+    return time < 600.0 ? 0.3 + 0.8 * time / 600.0 : 1.1;
+}
+
+static double noisyCurve(double time) {
+    (void)time;
+    return 0.6 + glfmTestRandom() * 0.15;
+}
+
+static double heatThenCoolCurve(double time) {
+    return time < 300.0 ? 0.3 + 0.7 * time / 300.0 : (time < 400.0 ? 1.0 : 0.3);
+}
+
+static bool thermalPoll(GLFMDisplay *display, double *headroom, GLFMThermalState *state) {
+    (void)display;
+    platform.pollCount++;
+    if (platform.fails) {
+        return false;
+    }
+    if (platform.nanHeadroom) {
+        *headroom = NAN;
+    } else if (!platform.stateOnly && platform.curve) {
+        *headroom = platform.curve(glfmGetTime() - platform.startTime);
+    }
+    *state = platform.state;
+    return true;
+}
+
+static void onThermalRecommendation(GLFMDisplay *display, int maxFrameRate, double renderScale) {
+    if (changes.count < MAX_CHANGES) {
+        changes.times[changes.count] = glfmGetTime() - platform.startTime;
+        changes.levels[changes.count] = display->thermalGovernor.level;
+        changes.count++;
+    }
+    changes.maxFrameRate = maxFrameRate;
+    changes.renderScale = renderScale;
+}
+
+static GLFMDisplay *createDisplay(HeadroomCurve curve) {
+    memset(&platform, 0, sizeof(platform));
+    memset(&changes, 0, sizeof(changes));
+    platform.curve = curve;
+    platform.state = GLFMThermalStateNominal;
+    platform.startTime = 1000.0;
+    glfmTestSetTime(platform.startTime);
+    GLFMDisplay *display = glfmTestCreateDisplay();
+    display->thermalPollFunc = thermalPoll;
+    glfmSetThermalRecommendationFunc(display, onThermalRecommendation);
+    return display;
+}
+
+static void renderFrames(GLFMDisplay *display, double duration) {
+    const int frameCount = (int)(duration / FRAME_INTERVAL + 0.5);
+    for (int i = 0; i < frameCount; i++) {
+        glfm__setFrameTime(display, glfmGetTime(), 0.0);
+        glfmTestSetTime(glfmGetTime() + FRAME_INTERVAL);
+    }
+}
+
+static void testHeating(void) {
+    GLFMDisplay *display = createDisplay(heatingCurve);
+    GLFM_TEST_CHECK(glfmGetThermalHeadroom(display) == -1.0);
+    renderFrames(display, 700.0);
+    GLFM_TEST_CHECK(changes.count == GLFM_THERMAL_LEVEL_COUNT - 1);
+    GLFM_TEST_CHECK(changes.maxFrameRate == 30 && changes.renderScale == 0.6);
+    for (int i = 0; i < changes.count; i++) {
+        // Each step is before the device throttles
+        GLFM_TEST_CHECK(changes.times[i] < 525.0);
+        if (i > 0) {
+            GLFM_TEST_CHECK(changes.times[i] - changes.times[i - 1] >= GLFM_THERMAL_STEP_UP_INTERVAL);
+        }
+    }
+    GLFM_TEST_CHECK_NEAR(glfmGetThermalHeadroom(display), 1.1, 0.01);
+    GLFM_TEST_CHECK(glfmGetThermalState(display) == GLFMThermalStateNominal);
+    free(display);
+}
+
+static void testNoise(void) {
+    GLFMDisplay *display = createDisplay(noisyCurve);
+    renderFrames(display, 1200.0);
+    GLFM_TEST_CHECK(changes.count == 0);
+    GLFM_TEST_CHECK_NEAR(glfmGetThermalHeadroom(display), 0.6, 0.1);
+    free(display);
+}
+
+static void testCooling(void) {
+    GLFMDisplay *display = createDisplay(heatThenCoolCurve);
+    renderFrames(display, 700.0);
+    GLFM_TEST_CHECK(changes.count > 2);
+    GLFM_TEST_CHECK(changes.levels[changes.count - 1] == 0);
+    GLFM_TEST_CHECK(changes.maxFrameRate == 0 && changes.renderScale == 1.0);
+    for (int i = 1; i < changes.count; i++) {
+        if (changes.levels[i] < changes.levels[i - 1]) {
+            GLFM_TEST_CHECK(changes.times[i] >= 400.0);
+            GLFM_TEST_CHECK(changes.times[i] - changes.times[i - 1] >= GLFM_THERMAL_STEP_DOWN_INTERVAL);
+        }
+    }
+    free(display);
+}
+
+/// The thermal state's level is used immediately.
+static void testStateOnly(void) {
+    GLFMDisplay *display = createDisplay(NULL);
+    platform.stateOnly = true;
+    renderFrames(display, 60.0);
+    GLFM_TEST_CHECK(changes.count == 0);
+    platform.state = GLFMThermalStateFair;
+    renderFrames(display, 60.0);
+    GLFM_TEST_CHECK(display->thermalGovernor.level == 1);
+    platform.state = GLFMThermalStateSerious;
+    renderFrames(display, 3.0);
+    GLFM_TEST_CHECK(display->thermalGovernor.level == 2 && changes.maxFrameRate == 60);
+    platform.state = GLFMThermalStateCritical;
+    renderFrames(display, 3.0);
+    GLFM_TEST_CHECK(display->thermalGovernor.level == 3);
+    platform.state = GLFMThermalStateNominal;
+    renderFrames(display, 200.0);
+    GLFM_TEST_CHECK(display->thermalGovernor.level == 0 && changes.renderScale == 1.0);
+    free(display);
+}
+
+/// Failed and NaN samples are skipped, and polling continues at the same interval.
+static void testSkippedSamples(void) {
+    GLFMDisplay *display = createDisplay(heatingCurve);
+    platform.fails = true;
+    renderFrames(display, 60.0);
+    GLFM_TEST_CHECK(platform.pollCount >= 29 && platform.pollCount <= 30);
+    GLFM_TEST_CHECK(glfmGetThermalHeadroom(display) == -1.0);
+    GLFM_TEST_CHECK(display->thermalPollFunc != NULL);
+
+    platform.fails = false;
+    renderFrames(display, 10.0);
+    GLFM_TEST_CHECK_NEAR(glfmGetThermalHeadroom(display), heatingCurve(65.0), 0.05);
+
+    // No headroom, and an unknown state
+    const double sampleTime = display->thermalGovernor.sampleTime;
+    const double headroom = glfmGetThermalHeadroom(display);
+    platform.nanHeadroom = true;
+    platform.state = GLFMThermalStateUnknown;
+    renderFrames(display, 10.0);
+    GLFM_TEST_CHECK(display->thermalGovernor.sampleTime == sampleTime);
+    GLFM_TEST_CHECK(glfmGetThermalHeadroom(display) == headroom);
+
+    // Samples continue after the failures, and the level steps up as it would have
+    platform.nanHeadroom = false;
+    platform.state = GLFMThermalStateNominal;
+    renderFrames(display, 620.0);
+    GLFM_TEST_CHECK(changes.count == GLFM_THERMAL_LEVEL_COUNT - 1);
+    GLFM_TEST_CHECK(changes.maxFrameRate == 30);
+    free(display);
+}
+
+static void testPollInterval(void) {
+    GLFMDisplay *display = createDisplay(heatingCurve);
+    renderFrames(display, 10.5);
+    platform.pollCount = 0;
+    renderFrames(display, 60.0);
+    GLFM_TEST_CHECK(platform.pollCount >= 29 && platform.pollCount <= 30);
+    free(display);
+}
+
+int main(void) {
+    testHeating();
+    testNoise();
+    testCooling();
+    testStateOnly();
+    testSkippedSamples();
+    testPollInterval();
+    return glfmTestResult();
+}
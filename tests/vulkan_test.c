@@ -0,0 +1,390 @@
+// Tests the Vulkan swapchain code (glfm_vulkan.h) with the system's Vulkan driver, for example
+// lavapipe, and a headless surface. It acquires and presents more frames than are in flight,
+// resizes, and switches latency modes.
+//
+// A headless surface has no size of its own, so the test also wraps it to act like a window:
+// the surface reports the window's size, and acquiring or presenting an image of a different size
+// reports VK_ERROR_OUT_OF_DATE_KHR, as window systems do after a resize.
+//
+// Skipped (exit status 77) if GLFM was built without the Vulkan headers, or if no Vulkan driver
+// supports headless surfaces.
+
+#if GLFM_HAS_VULKAN
+#  define VK_NO_PROTOTYPES
+#  include <vulkan/vulkan.h>
+#endif
+
+#include "glfm_test_platform.h"
+#include "glfm_vulkan.h"
+
+#define SKIPPED 77
+
+// The display size, which glfmAcquireVulkanFrame() requests
+static int displayWidth = 64;
+static int displayHeight = 64;
+
+void glfmGetDisplaySize(const GLFMDisplay *display, int *width, int *height) {
+    (void)display;
+    *width = displayWidth;
+    *height = displayHeight;
+}
+
+#if GLFM_HAS_VULKAN
+
+// MARK: - Simulated window
+
+static struct {
+    bool enabled;
+    VkExtent2D size;
+    int outOfDateCount;
+    GLFMVulkan *vk;
+    PFN_vkGetPhysicalDeviceSurfaceCapabilitiesKHR getSurfaceCapabilities;
+    PFN_vkAcquireNextImageKHR acquireNextImage;
+    PFN_vkQueuePresentKHR queuePresent;
+} window;
+
+static VKAPI_ATTR VkResult VKAPI_CALL getWindowCapabilities(VkPhysicalDevice physicalDevice,
+                                                            VkSurfaceKHR surface,
+                                                            VkSurfaceCapabilitiesKHR *capabilities) {
+    const VkResult result = window.getSurfaceCapabilities(physicalDevice, surface, capabilities);
+    if (result == VK_SUCCESS && window.enabled) {
+        capabilities->currentExtent = window.size;
+    } else if (result == VK_SUCCESS) {
+        // A headless surface has no size of its own. Some drivers (SwiftShader) report a fixed
+        // size instead of the special value that VK_EXT_headless_surface specifies.
+        capabilities->currentExtent.width = UINT32_MAX;
+        capabilities->currentExtent.height = UINT32_MAX;
+    }
+    return result;
+}
+
+static bool isSwapchainOutOfDate(void) {
+    return window.enabled && (window.vk->extent.width != window.size.width ||
+                              window.vk->extent.height != window.size.height);
+}
+
+static VKAPI_ATTR VkResult VKAPI_CALL acquireWindowImage(VkDevice device, VkSwapchainKHR swapchain,
+                                                         uint64_t timeout, VkSemaphore semaphore,
+                                                         VkFence fence, uint32_t *imageIndex) {
+    if (isSwapchainOutOfDate()) {
+        // Nothing is signaled
+        window.outOfDateCount++;
+        return VK_ERROR_OUT_OF_DATE_KHR;
+    }
+    return window.acquireNextImage(device, swapchain, timeout, semaphore, fence, imageIndex);
+}
+
+static VKAPI_ATTR VkResult VKAPI_CALL presentWindowImage(VkQueue queue,
+                                                         const VkPresentInfoKHR *presentInfo) {
+    // Still presented, so that the render semaphore is waited on
+    const VkResult result = window.queuePresent(queue, presentInfo);
+    if (result >= 0 && isSwapchainOutOfDate()) {
+        window.outOfDateCount++;
+        return VK_ERROR_OUT_OF_DATE_KHR;
+    }
+    return result;
+}
+
+/// A GLFMVulkanSurfaceFunc.
+static VkResult createHeadlessSurface(GLFMDisplay *display,
+                                      PFN_vkGetInstanceProcAddr getInstanceProcAddr,
+                                      VkInstance instance, VkSurfaceKHR *surface) {
+    (void)display;
+    PFN_vkCreateHeadlessSurfaceEXT createHeadlessSurface = (PFN_vkCreateHeadlessSurfaceEXT)
+        getInstanceProcAddr(instance, "vkCreateHeadlessSurfaceEXT");
+    if (!createHeadlessSurface) {
+        return VK_ERROR_EXTENSION_NOT_PRESENT;
+    }
+    VkHeadlessSurfaceCreateInfoEXT createInfo;
+    memset(&createInfo, 0, sizeof(createInfo));
+    createInfo.sType = VK_STRUCTURE_TYPE_HEADLESS_SURFACE_CREATE_INFO_EXT;
+    return createHeadlessSurface(instance, &createInfo, NULL, surface);
+}
+
+// MARK: - Rendering
+
+/// Records the app's work for a frame: a transition of the acquired image to the present layout.
+/// There is one command buffer per frame slot, which is free once glfm__vulkanAcquire() has waited
+/// on the slot's fence.
+typedef struct {
+    PFN_vkCreateCommandPool createCommandPool;
+    PFN_vkDestroyCommandPool destroyCommandPool;
+    PFN_vkAllocateCommandBuffers allocateCommandBuffers;
+    PFN_vkBeginCommandBuffer beginCommandBuffer;
+    PFN_vkEndCommandBuffer endCommandBuffer;
+    PFN_vkCmdPipelineBarrier cmdPipelineBarrier;
+    PFN_vkQueueSubmit queueSubmit;
+    VkCommandPool commandPool;
+    VkCommandBuffer commandBuffers[GLFM_VULKAN_MAX_FRAMES_IN_FLIGHT];
+} Renderer;
+
+#define loadDeviceFunction(renderer, vk, var, name) \
+    ((renderer)->var = (PFN_##name)(vk)->getDeviceProcAddr((vk)->device, #name)) != NULL
+
+static bool createRenderer(Renderer *renderer, GLFMVulkan *vk) {
+    memset(renderer, 0, sizeof(Renderer));
+    if (!(loadDeviceFunction(renderer, vk, createCommandPool, vkCreateCommandPool) &&
+          loadDeviceFunction(renderer, vk, destroyCommandPool, vkDestroyCommandPool) &&
+          loadDeviceFunction(renderer, vk, allocateCommandBuffers, vkAllocateCommandBuffers) &&
+          loadDeviceFunction(renderer, vk, beginCommandBuffer, vkBeginCommandBuffer) &&
+          loadDeviceFunction(renderer, vk, endCommandBuffer, vkEndCommandBuffer) &&
+          loadDeviceFunction(renderer, vk, cmdPipelineBarrier, vkCmdPipelineBarrier) &&
+          loadDeviceFunction(renderer, vk, queueSubmit, vkQueueSubmit))) {
+        return false;
+    }
+    VkCommandPoolCreateInfo poolCreateInfo;
+    memset(&poolCreateInfo, 0, sizeof(poolCreateInfo));
+    poolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolCreateInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    poolCreateInfo.queueFamilyIndex = vk->queueFamilyIndex;
+    if (renderer->createCommandPool(vk->device, &poolCreateInfo, NULL,
+                                    &renderer->commandPool) != VK_SUCCESS) {
+        renderer->commandPool = VK_NULL_HANDLE;
+        return false;
+    }
+    VkCommandBufferAllocateInfo allocateInfo;
+    memset(&allocateInfo, 0, sizeof(allocateInfo));
+    allocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocateInfo.commandPool = renderer->commandPool;
+    allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocateInfo.commandBufferCount = GLFM_VULKAN_MAX_FRAMES_IN_FLIGHT;
+    return renderer->allocateCommandBuffers(vk->device, &allocateInfo,
+                                            renderer->commandBuffers) == VK_SUCCESS;
+}
+
+static void destroyRenderer(Renderer *renderer, GLFMVulkan *vk) {
+    if (renderer->commandPool != VK_NULL_HANDLE) {
+        vk->deviceWaitIdle(vk->device);
+        renderer->destroyCommandPool(vk->device, renderer->commandPool, NULL);
+    }
+}
+
+/// Submits the frame's work, which waits on the acquire semaphore, and signals the render
+/// semaphore and the fence.
+static bool submitFrame(Renderer *renderer, GLFMVulkan *vk, const GLFMVulkanFrame *frame) {
+    VkCommandBuffer commandBuffer = renderer->commandBuffers[frame->frameIndex];
+    VkCommandBufferBeginInfo beginInfo;
+    memset(&beginInfo, 0, sizeof(beginInfo));
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    if (renderer->beginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
+        return false;
+    }
+    VkImageMemoryBarrier barrier;
+    memset(&barrier, 0, sizeof(barrier));
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    barrier.newLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = frame->image;
+    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    barrier.subresourceRange.levelCount = 1;
+    barrier.subresourceRange.layerCount = 1;
+    renderer->cmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                                 VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, NULL, 0, NULL,
+                                 1, &barrier);
+    if (renderer->endCommandBuffer(commandBuffer) != VK_SUCCESS) {
+        return false;
+    }
+    const VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    VkSubmitInfo submitInfo;
+    memset(&submitInfo, 0, sizeof(submitInfo));
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.waitSemaphoreCount = 1;
+    submitInfo.pWaitSemaphores = &frame->acquireSemaphore;
+    submitInfo.pWaitDstStageMask = &waitStage;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &commandBuffer;
+    submitInfo.signalSemaphoreCount = 1;
+    submitInfo.pSignalSemaphores = &frame->renderSemaphore;
+    return renderer->queueSubmit(vk->queue, 1, &submitInfo, frame->fence) == VK_SUCCESS;
+}
+
+/// Acquires, submits, and presents a frame, like an app's render function and glfmSwapBuffers().
+static bool drawFrame(GLFMDisplay *display, Renderer *renderer, GLFMVulkanFrame *frame) {
+    return (glfmAcquireVulkanFrame(display, frame) &&
+            submitFrame(renderer, display->vulkan, frame) &&
+            glfm__vulkanPresent(display->vulkan));
+}
+
+static bool frameHasExtent(const GLFMVulkanFrame *frame, uint32_t width, uint32_t height) {
+    return frame->extent.width == width && frame->extent.height == height;
+}
+
+// MARK: - Tests
+
+/// Frame slots are reused once their previous submission is complete.
+static void testFramesInFlight(GLFMDisplay *display, Renderer *renderer) {
+    GLFMVulkan *vk = display->vulkan;
+    GLFMVulkanFrame frame;
+    VkFence fences[GLFM_VULKAN_MAX_FRAMES_IN_FLIGHT];
+    const int frameCount = 4 * GLFM_VULKAN_MAX_FRAMES_IN_FLIGHT + 1;
+    for (int i = 0; i < frameCount; i++) {
+        GLFM_TEST_CHECK(drawFrame(display, renderer, &frame));
+        GLFM_TEST_CHECK(frame.frameIndex == (uint32_t)(i % GLFM_VULKAN_MAX_FRAMES_IN_FLIGHT));
+        GLFM_TEST_CHECK(frameHasExtent(&frame, 64, 64));
+        GLFM_TEST_CHECK(frame.imageIndex < vk->imageCount);
+        GLFM_TEST_CHECK(frame.image == vk->images[frame.imageIndex]);
+        GLFM_TEST_CHECK(frame.renderSemaphore == vk->renderSemaphores[frame.imageIndex]);
+        if (i < GLFM_VULKAN_MAX_FRAMES_IN_FLIGHT) {
+            fences[i] = frame.fence;
+        } else {
+            GLFM_TEST_CHECK(frame.fence == fences[frame.frameIndex]);
+        }
+    }
+    GLFM_TEST_CHECK(fences[0] != fences[1]);
+    GLFM_TEST_CHECK(!vk->swapchainOutOfDate);
+
+    // Acquiring again before presenting returns the same image. Presenting twice fails.
+    GLFMVulkanFrame secondFrame;
+    GLFM_TEST_CHECK(glfmAcquireVulkanFrame(display, &frame));
+    GLFM_TEST_CHECK(glfmAcquireVulkanFrame(display, &secondFrame));
+    GLFM_TEST_CHECK(frame.imageIndex == secondFrame.imageIndex);
+    GLFM_TEST_CHECK(frame.frameIndex == secondFrame.frameIndex);
+    GLFM_TEST_CHECK(submitFrame(renderer, vk, &frame));
+    GLFM_TEST_CHECK(glfm__vulkanPresent(vk));
+    GLFM_TEST_CHECK(!glfm__vulkanPresent(vk));
+}
+
+static void testResize(GLFMDisplay *display, Renderer *renderer) {
+    GLFMVulkan *vk = display->vulkan;
+    GLFMVulkanFrame frame;
+
+    // A headless surface uses the display size
+    displayWidth = 96;
+    displayHeight = 48;
+    GLFM_TEST_CHECK(drawFrame(display, renderer, &frame));
+    GLFM_TEST_CHECK(frameHasExtent(&frame, 96, 48));
+    GLFM_TEST_CHECK(!vk->swapchainOutOfDate);
+
+    // A window resized while a frame is rendered. The window system reports the frame out of date
+    // when it's presented.
+    window.enabled = true;
+    window.size = frame.extent;
+    GLFM_TEST_CHECK(glfmAcquireVulkanFrame(display, &frame));
+    window.size.width = 80;
+    window.size.height = 60;
+    GLFM_TEST_CHECK(submitFrame(renderer, vk, &frame));
+    GLFM_TEST_CHECK(glfm__vulkanPresent(vk));
+    GLFM_TEST_CHECK(vk->swapchainOutOfDate);
+    GLFM_TEST_CHECK(window.outOfDateCount == 1);
+
+    // The next frame recreates the swapchain with the window's size, before the display size is
+    // updated
+    GLFM_TEST_CHECK(drawFrame(display, renderer, &frame));
+    GLFM_TEST_CHECK(frameHasExtent(&frame, 80, 60));
+    GLFM_TEST_CHECK(!vk->swapchainOutOfDate);
+    GLFM_TEST_CHECK(window.outOfDateCount == 1);
+
+    // A window resized between frames. Acquiring reports it out of date, and the swapchain is
+    // recreated in the same call.
+    window.size.width = 72;
+    window.size.height = 40;
+    GLFM_TEST_CHECK(drawFrame(display, renderer, &frame));
+    GLFM_TEST_CHECK(frameHasExtent(&frame, 72, 40));
+    GLFM_TEST_CHECK(window.outOfDateCount == 2);
+    GLFM_TEST_CHECK(!vk->swapchainOutOfDate);
+
+    // A window with no area, for example when minimized
+    window.size.width = 0;
+    window.size.height = 0;
+    GLFM_TEST_CHECK(!glfmAcquireVulkanFrame(display, &frame));
+    window.size.width = 64;
+    window.size.height = 64;
+    GLFM_TEST_CHECK(drawFrame(display, renderer, &frame));
+    GLFM_TEST_CHECK(frameHasExtent(&frame, 64, 64));
+    window.enabled = false;
+    displayWidth = 64;
+    displayHeight = 64;
+}
+
+static void testLatencyModes(GLFMDisplay *display, Renderer *renderer) {
+    GLFMVulkan *vk = display->vulkan;
+    GLFMVulkanFrame frame;
+    GLFM_TEST_CHECK(drawFrame(display, renderer, &frame));
+    const uint32_t balancedImageCount = vk->imageCount;
+
+    // One frame in flight
+    glfmSetLatencyMode(display, GLFMLatencyModeLowLatency);
+    for (int i = 0; i < 2 * GLFM_VULKAN_MAX_FRAMES_IN_FLIGHT + 1; i++) {
+        GLFM_TEST_CHECK(drawFrame(display, renderer, &frame));
+        GLFM_TEST_CHECK(vk->appliedLatencyMode == GLFMLatencyModeLowLatency);
+        if (i > 0) {
+            GLFM_TEST_CHECK(frame.frameIndex == 0);
+        }
+    }
+
+    // One more image
+    glfmSetLatencyMode(display, GLFMLatencyModeThroughput);
+    GLFM_TEST_CHECK(drawFrame(display, renderer, &frame));
+    GLFM_TEST_CHECK(vk->imageCount >= balancedImageCount);
+
+    // Back to two frames in flight
+    glfmSetLatencyMode(display, GLFMLatencyModeBalanced);
+    uint32_t frameIndexMask = 0;
+    for (int i = 0; i < 2 * GLFM_VULKAN_MAX_FRAMES_IN_FLIGHT; i++) {
+        GLFM_TEST_CHECK(drawFrame(display, renderer, &frame));
+        frameIndexMask |= 1u << frame.frameIndex;
+    }
+    GLFM_TEST_CHECK(frameIndexMask == (1u << GLFM_VULKAN_MAX_FRAMES_IN_FLIGHT) - 1);
+
+    // A swap interval of 0 uses the mailbox or immediate present mode
+    glfmSetSwapInterval(display, 0);
+    GLFM_TEST_CHECK(drawFrame(display, renderer, &frame));
+    GLFM_TEST_CHECK(vk->appliedSwapInterval == 0);
+    glfmSetSwapInterval(display, 1);
+}
+
+static void benchmark(GLFMDisplay *display, Renderer *renderer) {
+    GLFMVulkanFrame frame;
+    const int frameCount = 500;
+    const double startTime = glfmTestGetRealTime();
+    for (int i = 0; i < frameCount; i++) {
+        GLFM_TEST_CHECK(drawFrame(display, renderer, &frame));
+    }
+    const double duration = glfmTestGetRealTime() - startTime;
+    printf("Acquire, submit, and present: %8.1f frames/sec\n", frameCount / duration);
+}
+
+#endif // GLFM_HAS_VULKAN
+
+int main(void) {
+#if GLFM_HAS_VULKAN
+    GLFMDisplay *display = glfmTestCreateDisplay();
+    glfmSetSwapInterval(display, 1);
+    GLFMVulkan *vk = glfm__vulkanCreate(VK_EXT_HEADLESS_SURFACE_EXTENSION_NAME,
+                                        createHeadlessSurface);
+    if (!vk || !glfm__vulkanSurfaceInit(display, vk)) {
+        glfm__vulkanDestroy(vk);
+        free(display);
+        printf("Skipped: no Vulkan driver with headless surfaces\n");
+        return SKIPPED;
+    }
+    display->vulkan = vk;
+    window.vk = vk;
+    window.getSurfaceCapabilities = vk->getSurfaceCapabilities;
+    window.acquireNextImage = vk->acquireNextImage;
+    window.queuePresent = vk->queuePresent;
+    vk->getSurfaceCapabilities = getWindowCapabilities;
+    vk->acquireNextImage = acquireWindowImage;
+    vk->queuePresent = presentWindowImage;
+
+    Renderer renderer;
+    const bool rendererCreated = createRenderer(&renderer, vk);
+    GLFM_TEST_CHECK(rendererCreated);
+    if (rendererCreated) {
+        testFramesInFlight(display, &renderer);
+        testResize(display, &renderer);
+        testLatencyModes(display, &renderer);
+        benchmark(display, &renderer);
+    }
+    destroyRenderer(&renderer, vk);
+    glfm__vulkanDestroy(vk);
+    free(display);
+    return glfmTestResult();
+#else
+    printf("Skipped: built without the Vulkan headers\n");
+    return SKIPPED;
+#endif
+}
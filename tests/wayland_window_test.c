@@ -0,0 +1,776 @@
+// Tests the Wayland windowed mode with a minimal compositor, run on a thread of the test with
+// libwayland-server. The compositor configures the window, sends key and pointer input, resizes the
+// window, hides and shows it, and closes it. Checks the callbacks, in order, and the rendered pixels.
+//
+// The test defines glfmMain() and runs in the main() of the library. Mesa renders with its software
+// driver, to wl_shm buffers that the compositor reads.
+//
+// Skipped (exit status 77) if EGL doesn't support the Wayland platform.
+
+#define _GNU_SOURCE // memfd_create()
+#include "glfm.h"
+#include "glfm_test.h"
+#include <EGL/egl.h>
+#include <linux/input-event-codes.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <wayland-server.h>
+#include <xkbcommon/xkbcommon.h>
+#include "xdg-shell-server-protocol.h"
+
+#define RESIZED_WIDTH 200
+#define RESIZED_HEIGHT 150
+#define POINTER_X 10.5
+#define POINTER_Y 20.25
+#define WHEEL_DELTA 15.0
+#define FRAMES_BEFORE_INPUT 3
+#define HIDDEN_DURATION 0.3
+#define TIMEOUT 10.0
+#define SKIPPED 77
+
+// The clear color of onDraw(), as an XRGB8888 pixel
+#define CLEAR_PIXEL 0x004080bfu
+
+typedef enum {
+    StepConfiguring,
+    StepDrawing,
+    StepResizing,
+    StepHidden,
+    StepShown,
+    StepClosing,
+} Step;
+
+// The callbacks, in order
+typedef enum {
+    CallbackSurfaceCreated,
+    CallbackSurfaceResized,
+    CallbackFocusLost,
+    CallbackFocusGained,
+    CallbackSurfaceDestroyed,
+} Callback;
+
+#define MAX_CALLBACKS 64
+
+// The compositor's state. Only used on the compositor thread until it's joined.
+static struct {
+    struct wl_display *wlDisplay;
+    pthread_t thread;
+    volatile bool stopped;
+    char runtimeDir[64];
+
+    struct wl_resource *surface;
+    struct wl_resource *xdgSurface;
+    struct wl_resource *toplevel;
+    struct wl_resource *pointer;
+    struct wl_resource *keyboard;
+    struct wl_resource *pendingBuffer;
+    bool pendingBufferAttached;
+    uint32_t configureSerial;
+    uint32_t ackedSerial;
+
+    Step step;
+    double stepStartTime;
+    int frameCount;
+    int framesWhileHidden;
+    int otherBufferCount;
+    int firstBufferWidth;
+    int firstBufferHeight;
+    uint32_t firstPixel;
+    bool timedOut;
+} compositor;
+
+// The app's state. Only used on the main thread.
+static struct {
+    int frameCount;
+    int createdWidth;
+    int createdHeight;
+    int resizedWidth;
+    int resizedHeight;
+    bool keyPressed;
+    bool keyReleased;
+    char chars[16];
+    bool touchBegan;
+    bool touchEnded;
+    double touchX;
+    double touchY;
+    double wheelDeltaY;
+    Callback callbacks[MAX_CALLBACKS];
+    int callbackCount;
+} app;
+
+// MARK: - Compositor
+
+static void setStep(Step step) {
+    compositor.step = step;
+    compositor.stepStartTime = glfmTestGetRealTime();
+}
+
+static uint32_t getTime(void) {
+    return (uint32_t)(glfmTestGetRealTime() * 1000.0);
+}
+
+/// Sends a toplevel configure sequence. The window is hidden if it is suspended.
+static void sendConfigure(int32_t width, int32_t height, bool activated, bool suspended) {
+    struct wl_array states;
+    wl_array_init(&states);
+    if (activated) {
+        uint32_t *state = wl_array_add(&states, sizeof(uint32_t));
+        *state = XDG_TOPLEVEL_STATE_ACTIVATED;
+    }
+    if (suspended) {
+        uint32_t *state = wl_array_add(&states, sizeof(uint32_t));
+        *state = XDG_TOPLEVEL_STATE_SUSPENDED;
+    }
+    xdg_toplevel_send_configure(compositor.toplevel, width, height, &states);
+    wl_array_release(&states);
+    compositor.configureSerial = wl_display_next_serial(compositor.wlDisplay);
+    xdg_surface_send_configure(compositor.xdgSurface, compositor.configureSerial);
+}
+
+/// Sends a keymap of the default layout, or no keymap if the XKB data isn't installed.
+static void sendKeymap(void) {
+    struct xkb_context *context = xkb_context_new(XKB_CONTEXT_NO_FLAGS);
+    struct xkb_keymap *keymap = NULL;
+    if (context) {
+        keymap = xkb_keymap_new_from_names(context, NULL, XKB_KEYMAP_COMPILE_NO_FLAGS);
+    }
+    char *keymapString = NULL;
+    if (keymap) {
+        keymapString = xkb_keymap_get_as_string(keymap, XKB_KEYMAP_FORMAT_TEXT_V1);
+    }
+    int fd = memfd_create("keymap", MFD_CLOEXEC);
+    if (keymapString && fd >= 0) {
+        size_t size = strlen(keymapString) + 1;
+        if (write(fd, keymapString, size) == (ssize_t)size) {
+            wl_keyboard_send_keymap(compositor.keyboard, WL_KEYBOARD_KEYMAP_FORMAT_XKB_V1, fd,
+                                    (uint32_t)size);
+        }
+    } else if (fd >= 0) {
+        wl_keyboard_send_keymap(compositor.keyboard, WL_KEYBOARD_KEYMAP_FORMAT_NO_KEYMAP, fd, 0);
+    }
+    if (fd >= 0) {
+        close(fd);
+    }
+    free(keymapString);
+    xkb_keymap_unref(keymap);
+    xkb_context_unref(context);
+}
+
+/// Sends a key press and release, and a click and a wheel scroll at the same location.
+static void sendInput(void) {
+    if (compositor.keyboard) {
+        struct wl_array keys;
+        wl_array_init(&keys);
+        wl_keyboard_send_enter(compositor.keyboard, wl_display_next_serial(compositor.wlDisplay),
+                               compositor.surface, &keys);
+        wl_array_release(&keys);
+        wl_keyboard_send_key(compositor.keyboard, wl_display_next_serial(compositor.wlDisplay),
+                             getTime(), KEY_A, WL_KEYBOARD_KEY_STATE_PRESSED);
+        wl_keyboard_send_key(compositor.keyboard, wl_display_next_serial(compositor.wlDisplay),
+                             getTime(), KEY_A, WL_KEYBOARD_KEY_STATE_RELEASED);
+    }
+    if (compositor.pointer) {
+        wl_pointer_send_enter(compositor.pointer, wl_display_next_serial(compositor.wlDisplay),
+                              compositor.surface, wl_fixed_from_double(POINTER_X),
+                              wl_fixed_from_double(POINTER_Y));
+        wl_pointer_send_frame(compositor.pointer);
+        wl_pointer_send_button(compositor.pointer, wl_display_next_serial(compositor.wlDisplay),
+                               getTime(), BTN_LEFT, WL_POINTER_BUTTON_STATE_PRESSED);
+        wl_pointer_send_frame(compositor.pointer);
+        wl_pointer_send_button(compositor.pointer, wl_display_next_serial(compositor.wlDisplay),
+                               getTime(), BTN_LEFT, WL_POINTER_BUTTON_STATE_RELEASED);
+        wl_pointer_send_frame(compositor.pointer);
+        wl_pointer_send_axis(compositor.pointer, getTime(), WL_POINTER_AXIS_VERTICAL_SCROLL,
+                             wl_fixed_from_double(WHEEL_DELTA));
+        wl_pointer_send_frame(compositor.pointer);
+    }
+}
+
+/// Advances the script when a buffer is committed.
+static void bufferCommitted(struct wl_shm_buffer *buffer) {
+    const int width = wl_shm_buffer_get_width(buffer);
+    const int height = wl_shm_buffer_get_height(buffer);
+    compositor.frameCount++;
+    if (compositor.frameCount == 1) {
+        compositor.firstBufferWidth = width;
+        compositor.firstBufferHeight = height;
+        wl_shm_buffer_begin_access(buffer);
+        const uint8_t *data = wl_shm_buffer_get_data(buffer);
+        const int32_t stride = wl_shm_buffer_get_stride(buffer);
+        uint32_t pixel;
+        memcpy(&pixel, data + (height / 2) * stride + (width / 2) * 4, sizeof(pixel));
+        compositor.firstPixel = pixel & 0x00ffffffu;
+        wl_shm_buffer_end_access(buffer);
+    }
+    switch (compositor.step) {
+        case StepConfiguring:
+            break;
+        case StepDrawing:
+            if (compositor.frameCount >= FRAMES_BEFORE_INPUT) {
+                sendInput();
+                sendConfigure(RESIZED_WIDTH, RESIZED_HEIGHT, true, false);
+                setStep(StepResizing);
+            }
+            break;
+        case StepResizing:
+            if (width == RESIZED_WIDTH && height == RESIZED_HEIGHT) {
+                // Deactivated and hidden
+                sendConfigure(RESIZED_WIDTH, RESIZED_HEIGHT, false, true);
+                setStep(StepHidden);
+            }
+            break;
+        case StepHidden:
+            // A frame can be drawn until the configure is acknowledged
+            if (compositor.ackedSerial == compositor.configureSerial) {
+                compositor.framesWhileHidden++;
+            }
+            break;
+        case StepShown:
+            xdg_toplevel_send_close(compositor.toplevel);
+            setStep(StepClosing);
+            break;
+        case StepClosing:
+            break;
+    }
+}
+
+static void regionDestroy(struct wl_client *client, struct wl_resource *resource) {
+    (void)client;
+    wl_resource_destroy(resource);
+}
+
+static void regionChange(struct wl_client *client, struct wl_resource *resource, int32_t x,
+                         int32_t y, int32_t width, int32_t height) {
+    (void)client;
+    (void)resource;
+    (void)x;
+    (void)y;
+    (void)width;
+    (void)height;
+}
+
+static const struct wl_region_interface regionImplementation = {
+    .destroy = regionDestroy,
+    .add = regionChange,
+    .subtract = regionChange,
+};
+
+static void surfaceDestroy(struct wl_client *client, struct wl_resource *resource) {
+    (void)client;
+    if (compositor.surface == resource) {
+        compositor.surface = NULL;
+    }
+    wl_resource_destroy(resource);
+}
+
+static void surfaceAttach(struct wl_client *client, struct wl_resource *resource,
+                          struct wl_resource *buffer, int32_t x, int32_t y) {
+    (void)client;
+    (void)x;
+    (void)y;
+    if (resource == compositor.surface) {
+        compositor.pendingBuffer = buffer;
+        compositor.pendingBufferAttached = true;
+    } else if (buffer) {
+        // Cursor surfaces
+        wl_buffer_send_release(buffer);
+    }
+}
+
+static void surfaceDamage(struct wl_client *client, struct wl_resource *resource, int32_t x,
+                          int32_t y, int32_t width, int32_t height) {
+    (void)client;
+    (void)resource;
+    (void)x;
+    (void)y;
+    (void)width;
+    (void)height;
+}
+
+/// Frames are shown immediately, so frame callbacks are done when they are requested.
+static void surfaceFrame(struct wl_client *client, struct wl_resource *resource, uint32_t id) {
+    (void)resource;
+    struct wl_resource *callback = wl_resource_create(client, &wl_callback_interface, 1, id);
+    wl_callback_send_done(callback, getTime());
+    wl_resource_destroy(callback);
+}
+
+static void surfaceSetRegion(struct wl_client *client, struct wl_resource *resource,
+                             struct wl_resource *region) {
+    (void)client;
+    (void)resource;
+    (void)region;
+}
+
+static void surfaceCommit(struct wl_client *client, struct wl_resource *resource) {
+    (void)client;
+    if (resource != compositor.surface) {
+        return;
+    }
+    if (compositor.step == StepConfiguring && compositor.toplevel) {
+        // The initial commit, without a buffer
+        sendConfigure(0, 0, true, false);
+        setStep(StepDrawing);
+        return;
+    }
+    if (compositor.pendingBufferAttached && compositor.pendingBuffer) {
+        struct wl_shm_buffer *buffer = wl_shm_buffer_get(compositor.pendingBuffer);
+        if (buffer) {
+            bufferCommitted(buffer);
+        } else {
+            compositor.otherBufferCount++;
+        }
+        wl_buffer_send_release(compositor.pendingBuffer);
+    }
+    compositor.pendingBuffer = NULL;
+    compositor.pendingBufferAttached = false;
+}
+
+static void surfaceSetInt(struct wl_client *client, struct wl_resource *resource, int32_t value) {
+    (void)client;
+    (void)resource;
+    (void)value;
+}
+
+static void surfaceOffset(struct wl_client *client, struct wl_resource *resource, int32_t x,
+                          int32_t y) {
+    (void)client;
+    (void)resource;
+    (void)x;
+    (void)y;
+}
+
+static const struct wl_surface_interface surfaceImplementation = {
+    .destroy = surfaceDestroy,
+    .attach = surfaceAttach,
+    .damage = surfaceDamage,
+    .frame = surfaceFrame,
+    .set_opaque_region = surfaceSetRegion,
+    .set_input_region = surfaceSetRegion,
+    .commit = surfaceCommit,
+    .set_buffer_transform = surfaceSetInt,
+    .set_buffer_scale = surfaceSetInt,
+    .damage_buffer = surfaceDamage,
+    .offset = surfaceOffset,
+};
+
+static void compositorCreateSurface(struct wl_client *client, struct wl_resource *resource,
+                                    uint32_t id) {
+    struct wl_resource *surface = wl_resource_create(client, &wl_surface_interface,
+                                                     wl_resource_get_version(resource), id);
+    wl_resource_set_implementation(surface, &surfaceImplementation, NULL, NULL);
+}
+
+static void compositorCreateRegion(struct wl_client *client, struct wl_resource *resource,
+                                   uint32_t id) {
+    (void)resource;
+    struct wl_resource *region = wl_resource_create(client, &wl_region_interface, 1, id);
+    wl_resource_set_implementation(region, &regionImplementation, NULL, NULL);
+}
+
+static const struct wl_compositor_interface compositorImplementation = {
+    .create_surface = compositorCreateSurface,
+    .create_region = compositorCreateRegion,
+};
+
+static void bindCompositor(struct wl_client *client, void *data, uint32_t version, uint32_t id) {
+    (void)data;
+    struct wl_resource *resource = wl_resource_create(client, &wl_compositor_interface,
+                                                      (int)version, id);
+    wl_resource_set_implementation(resource, &compositorImplementation, NULL, NULL);
+}
+
+static void inputDeviceRelease(struct wl_client *client, struct wl_resource *resource) {
+    (void)client;
+    wl_resource_destroy(resource);
+}
+
+static void inputDeviceDestroyed(struct wl_resource *resource) {
+    if (compositor.pointer == resource) {
+        compositor.pointer = NULL;
+    }
+    if (compositor.keyboard == resource) {
+        compositor.keyboard = NULL;
+    }
+}
+
+static void pointerSetCursor(struct wl_client *client, struct wl_resource *resource,
+                             uint32_t serial, struct wl_resource *surface, int32_t hotspotX,
+                             int32_t hotspotY) {
+    (void)client;
+    (void)resource;
+    (void)serial;
+    (void)surface;
+    (void)hotspotX;
+    (void)hotspotY;
+}
+
+static const struct wl_pointer_interface pointerImplementation = {
+    .set_cursor = pointerSetCursor,
+    .release = inputDeviceRelease,
+};
+
+static const struct wl_keyboard_interface keyboardImplementation = {
+    .release = inputDeviceRelease,
+};
+
+static void seatGetPointer(struct wl_client *client, struct wl_resource *resource, uint32_t id) {
+    compositor.pointer = wl_resource_create(client, &wl_pointer_interface,
+                                            wl_resource_get_version(resource), id);
+    wl_resource_set_implementation(compositor.pointer, &pointerImplementation, NULL,
+                                   inputDeviceDestroyed);
+}
+
+static void seatGetKeyboard(struct wl_client *client, struct wl_resource *resource, uint32_t id) {
+    compositor.keyboard = wl_resource_create(client, &wl_keyboard_interface,
+                                             wl_resource_get_version(resource), id);
+    wl_resource_set_implementation(compositor.keyboard, &keyboardImplementation, NULL,
+                                   inputDeviceDestroyed);
+    sendKeymap();
+    // No repeat, so that the key events are exact
+    wl_keyboard_send_repeat_info(compositor.keyboard, 0, 0);
+}
+
+static void seatGetTouch(struct wl_client *client, struct wl_resource *resource, uint32_t id) {
+    // No touch capability
+    (void)client;
+    (void)id;
+    wl_resource_post_error(resource, 0, "No touch");
+}
+
+static const struct wl_seat_interface seatImplementation = {
+    .get_pointer = seatGetPointer,
+    .get_keyboard = seatGetKeyboard,
+    .get_touch = seatGetTouch,
+    .release = inputDeviceRelease,
+};
+
+static void bindSeat(struct wl_client *client, void *data, uint32_t version, uint32_t id) {
+    (void)data;
+    struct wl_resource *resource = wl_resource_create(client, &wl_seat_interface, (int)version, id);
+    wl_resource_set_implementation(resource, &seatImplementation, NULL, NULL);
+    wl_seat_send_capabilities(resource, WL_SEAT_CAPABILITY_POINTER | WL_SEAT_CAPABILITY_KEYBOARD);
+}
+
+static void toplevelDestroy(struct wl_client *client, struct wl_resource *resource) {
+    (void)client;
+    compositor.toplevel = NULL;
+    wl_resource_destroy(resource);
+}
+
+static void toplevelSetString(struct wl_client *client, struct wl_resource *resource,
+                              const char *string) {
+    (void)client;
+    (void)resource;
+    (void)string;
+}
+
+static const struct xdg_toplevel_interface toplevelImplementation = {
+    .destroy = toplevelDestroy,
+    .set_title = toplevelSetString,
+    .set_app_id = toplevelSetString,
+};
+
+static void xdgSurfaceDestroy(struct wl_client *client, struct wl_resource *resource) {
+    (void)client;
+    compositor.xdgSurface = NULL;
+    wl_resource_destroy(resource);
+}
+
+static void xdgSurfaceGetToplevel(struct wl_client *client, struct wl_resource *resource,
+                                  uint32_t id) {
+    compositor.toplevel = wl_resource_create(client, &xdg_toplevel_interface,
+                                             wl_resource_get_version(resource), id);
+    wl_resource_set_implementation(compositor.toplevel, &toplevelImplementation, NULL, NULL);
+}
+
+static void xdgSurfaceAckConfigure(struct wl_client *client, struct wl_resource *resource,
+                                   uint32_t serial) {
+    (void)client;
+    (void)resource;
+    compositor.ackedSerial = serial;
+}
+
+static const struct xdg_surface_interface xdgSurfaceImplementation = {
+    .destroy = xdgSurfaceDestroy,
+    .get_toplevel = xdgSurfaceGetToplevel,
+    .ack_configure = xdgSurfaceAckConfigure,
+};
+
+static void wmBaseDestroy(struct wl_client *client, struct wl_resource *resource) {
+    (void)client;
+    wl_resource_destroy(resource);
+}
+
+static void wmBaseGetXdgSurface(struct wl_client *client, struct wl_resource *resource,
+                                uint32_t id, struct wl_resource *surface) {
+    compositor.surface = surface;
+    compositor.xdgSurface = wl_resource_create(client, &xdg_surface_interface,
+                                               wl_resource_get_version(resource), id);
+    wl_resource_set_implementation(compositor.xdgSurface, &xdgSurfaceImplementation, NULL, NULL);
+}
+
+static void wmBasePong(struct wl_client *client, struct wl_resource *resource, uint32_t serial) {
+    (void)client;
+    (void)resource;
+    (void)serial;
+}
+
+static const struct xdg_wm_base_interface wmBaseImplementation = {
+    .destroy = wmBaseDestroy,
+    .get_xdg_surface = wmBaseGetXdgSurface,
+    .pong = wmBasePong,
+};
+
+static void bindWmBase(struct wl_client *client, void *data, uint32_t version, uint32_t id) {
+    (void)data;
+    struct wl_resource *resource = wl_resource_create(client, &xdg_wm_base_interface, (int)version,
+                                                      id);
+    wl_resource_set_implementation(resource, &wmBaseImplementation, NULL, NULL);
+}
+
+static void *runCompositor(void *arg) {
+    (void)arg;
+    struct wl_event_loop *loop = wl_display_get_event_loop(compositor.wlDisplay);
+    while (!compositor.stopped) {
+        wl_event_loop_dispatch(loop, 10);
+        wl_display_flush_clients(compositor.wlDisplay);
+
+        const double stepDuration = glfmTestGetRealTime() - compositor.stepStartTime;
+        if (compositor.step == StepHidden && stepDuration > HIDDEN_DURATION) {
+            sendConfigure(RESIZED_WIDTH, RESIZED_HEIGHT, true, false);
+            setStep(StepShown);
+        } else if (compositor.step != StepClosing && stepDuration > TIMEOUT) {
+            fprintf(stderr, "Timed out at step %i\n", compositor.step);
+            compositor.timedOut = true;
+            if (compositor.toplevel) {
+                xdg_toplevel_send_close(compositor.toplevel);
+            }
+            setStep(StepClosing);
+        }
+    }
+    return NULL;
+}
+
+// MARK: - App
+
+static void addCallback(Callback callback) {
+    if (app.callbackCount < MAX_CALLBACKS) {
+        app.callbacks[app.callbackCount++] = callback;
+    }
+}
+
+static void onSurfaceCreated(GLFMDisplay *display, int width, int height) {
+    (void)display;
+    addCallback(CallbackSurfaceCreated);
+    app.createdWidth = width;
+    app.createdHeight = height;
+}
+
+static void onSurfaceResized(GLFMDisplay *display, int width, int height) {
+    addCallback(CallbackSurfaceResized);
+    app.resizedWidth = width;
+    app.resizedHeight = height;
+
+    int displayWidth = 0;
+    int displayHeight = 0;
+    glfmGetDisplaySize(display, &displayWidth, &displayHeight);
+    GLFM_TEST_CHECK(displayWidth == width);
+    GLFM_TEST_CHECK(displayHeight == height);
+}
+
+static void onFocus(GLFMDisplay *display, bool focused) {
+    (void)display;
+    addCallback(focused ? CallbackFocusGained : CallbackFocusLost);
+}
+
+static void onSurfaceDestroyed(GLFMDisplay *display) {
+    (void)display;
+    addCallback(CallbackSurfaceDestroyed);
+}
+
+static bool onKey(GLFMDisplay *display, GLFMKeyCode keyCode, GLFMKeyAction action, int modifiers) {
+    (void)display;
+    (void)modifiers;
+    if (keyCode == GLFMKeyCodeA) {
+        app.keyPressed |= (action == GLFMKeyActionPressed);
+        app.keyReleased |= (action == GLFMKeyActionReleased);
+    }
+    return true;
+}
+
+static void onChar(GLFMDisplay *display, const char *string, int modifiers) {
+    (void)display;
+    (void)modifiers;
+    strncat(app.chars, string, sizeof(app.chars) - strlen(app.chars) - 1);
+}
+
+static bool onTouch(GLFMDisplay *display, int touch, GLFMTouchPhase phase, double x, double y) {
+    (void)display;
+    if (touch == 0 && phase == GLFMTouchPhaseBegan) {
+        app.touchBegan = true;
+        app.touchX = x;
+        app.touchY = y;
+    } else if (touch == 0 && phase == GLFMTouchPhaseEnded) {
+        app.touchEnded = true;
+    }
+    return true;
+}
+
+static bool onMouseWheel(GLFMDisplay *display, double x, double y, GLFMMouseWheelDeltaType deltaType,
+                         double deltaX, double deltaY, double deltaZ) {
+    (void)display;
+    (void)x;
+    (void)y;
+    (void)deltaX;
+    (void)deltaZ;
+    if (deltaType == GLFMMouseWheelDeltaPixel) {
+        app.wheelDeltaY += deltaY;
+    }
+    return true;
+}
+
+static void onDraw(GLFMDisplay *display) {
+    app.frameCount++;
+    int width = 0;
+    int height = 0;
+    glfmGetDisplaySize(display, &width, &height);
+    glViewport(0, 0, width, height);
+    glClearColor(0.25f, 0.5f, 0.75f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+    GLFM_TEST_CHECK(glGetError() == GL_NO_ERROR);
+    glfmSwapBuffers(display);
+}
+
+/// Returns true if two XRGB8888 pixels differ by at most 1 in each channel.
+static bool pixelsMatch(uint32_t a, uint32_t b) {
+    for (int shift = 0; shift < 24; shift += 8) {
+        int difference = (int)((a >> shift) & 0xff) - (int)((b >> shift) & 0xff);
+        if (difference < -1 || difference > 1) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/// Stops the compositor and checks the results after the library's main() returns.
+static void checkResults(void) {
+    compositor.stopped = true;
+    pthread_join(compositor.thread, NULL);
+    wl_display_destroy(compositor.wlDisplay);
+    rmdir(compositor.runtimeDir);
+
+    GLFM_TEST_CHECK(!compositor.timedOut);
+    GLFM_TEST_CHECK(compositor.step == StepClosing);
+    GLFM_TEST_CHECK(app.frameCount > 0);
+    GLFM_TEST_CHECK(compositor.frameCount > 0);
+    GLFM_TEST_CHECK(compositor.otherBufferCount == 0);
+    GLFM_TEST_CHECK(app.createdWidth > 0 && app.createdHeight > 0);
+    GLFM_TEST_CHECK(compositor.firstBufferWidth == app.createdWidth);
+    GLFM_TEST_CHECK(compositor.firstBufferHeight == app.createdHeight);
+    if (!pixelsMatch(compositor.firstPixel, CLEAR_PIXEL)) {
+        fprintf(stderr, "Pixel 0x%06x, expected 0x%06x\n", compositor.firstPixel, CLEAR_PIXEL);
+        GLFM_TEST_CHECK(pixelsMatch(compositor.firstPixel, CLEAR_PIXEL));
+    }
+    GLFM_TEST_CHECK(app.resizedWidth == RESIZED_WIDTH);
+    GLFM_TEST_CHECK(app.resizedHeight == RESIZED_HEIGHT);
+    GLFM_TEST_CHECK(compositor.framesWhileHidden == 0);
+
+#if GLFM_FEATURE_KEYBOARD
+    GLFM_TEST_CHECK(app.keyPressed);
+    GLFM_TEST_CHECK(app.keyReleased);
+    // Characters require the XKB data
+    GLFM_TEST_CHECK(app.chars[0] == '\0' || strcmp(app.chars, "a") == 0);
+#endif
+    GLFM_TEST_CHECK(app.touchBegan);
+    GLFM_TEST_CHECK(app.touchEnded);
+    GLFM_TEST_CHECK_NEAR(app.touchX, POINTER_X, 0.01);
+    GLFM_TEST_CHECK_NEAR(app.touchY, POINTER_Y, 0.01);
+    GLFM_TEST_CHECK_NEAR(app.wheelDeltaY, WHEEL_DELTA, 0.01);
+
+    // Created, resized, deactivated while hidden, activated when shown, and then closed: focus is
+    // lost, and then the surface is destroyed.
+    const Callback expected[] = {
+        CallbackSurfaceCreated,
+        CallbackSurfaceResized,
+        CallbackFocusLost,
+        CallbackFocusGained,
+        CallbackFocusLost,
+        CallbackSurfaceDestroyed,
+    };
+    const int expectedCount = (int)(sizeof(expected) / sizeof(*expected));
+    GLFM_TEST_CHECK(app.callbackCount == expectedCount);
+    for (int i = 0; i < app.callbackCount && i < expectedCount; i++) {
+        GLFM_TEST_CHECK(app.callbacks[i] == expected[i]);
+    }
+
+    if (glfmTestFailureCount == 0) {
+        printf("Window created at %ix%i, resized to %ix%i, hidden, shown, and closed after %i "
+               "frames (%i presented)%s\n", app.createdWidth, app.createdHeight, app.resizedWidth,
+               app.resizedHeight, app.frameCount, compositor.frameCount,
+               app.chars[0] ? "" : ". No XKB data: characters not checked");
+    }
+    // The library's main() returns EXIT_SUCCESS, so the result is the exit status of the process
+    fflush(stdout);
+    _exit(glfmTestResult());
+}
+
+/// Starts the compositor before the library's main() connects to it. Skips the test if EGL doesn't
+/// support the Wayland platform.
+__attribute__((constructor)) static void startCompositor(void) {
+    const char *extensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+    if (!extensions || (!strstr(extensions, "EGL_EXT_platform_wayland") &&
+                        !strstr(extensions, "EGL_KHR_platform_wayland"))) {
+        printf("Skipped: EGL doesn't support the Wayland platform\n");
+        exit(SKIPPED);
+    }
+
+    // A private socket directory, so that a running compositor isn't used
+    strcpy(compositor.runtimeDir, "/tmp/glfm-wayland-test-XXXXXX");
+    if (!mkdtemp(compositor.runtimeDir)) {
+        perror("mkdtemp");
+        exit(EXIT_FAILURE);
+    }
+    setenv("XDG_RUNTIME_DIR", compositor.runtimeDir, 1);
+    // Render to wl_shm buffers
+    setenv("LIBGL_ALWAYS_SOFTWARE", "1", 1);
+
+    compositor.wlDisplay = wl_display_create();
+    const char *socketName = NULL;
+    if (compositor.wlDisplay) {
+        socketName = wl_display_add_socket_auto(compositor.wlDisplay);
+    }
+    if (!socketName) {
+        fprintf(stderr, "Couldn't create the compositor\n");
+        exit(EXIT_FAILURE);
+    }
+    setenv("WAYLAND_DISPLAY", socketName, 1);
+    wl_display_init_shm(compositor.wlDisplay);
+    wl_global_create(compositor.wlDisplay, &wl_compositor_interface, 4, NULL, bindCompositor);
+    wl_global_create(compositor.wlDisplay, &wl_seat_interface, 5, NULL, bindSeat);
+    wl_global_create(compositor.wlDisplay, &xdg_wm_base_interface, 6, NULL, bindWmBase);
+
+    setStep(StepConfiguring);
+    if (pthread_create(&compositor.thread, NULL, runCompositor, NULL) != 0) {
+        fprintf(stderr, "Couldn't start the compositor\n");
+        exit(EXIT_FAILURE);
+    }
+}
+
+void glfmMain(GLFMDisplay *display) {
+    atexit(checkResults);
+    glfmSetDisplayConfig(display, GLFMRenderingAPIOpenGLES2, GLFMColorFormatRGBA8888,
+                         GLFMDepthFormatNone, GLFMStencilFormatNone, GLFMMultisampleNone);
+    glfmSetSurfaceCreatedFunc(display, onSurfaceCreated);
+    glfmSetSurfaceResizedFunc(display, onSurfaceResized);
+    glfmSetSurfaceDestroyedFunc(display, onSurfaceDestroyed);
+    glfmSetAppFocusFunc(display, onFocus);
+    glfmSetKeyFunc(display, onKey);
+    glfmSetCharFunc(display, onChar);
+    glfmSetTouchFunc(display, onTouch);
+    glfmSetMouseWheelFunc(display, onMouseWheel);
+    glfmSetRenderFunc(display, onDraw);
+}
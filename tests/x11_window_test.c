@@ -0,0 +1,244 @@
+// Tests the X11 windowed mode: the window is created, resized, and closed by a second X client,
+// like a window manager. Checks the surface and focus callbacks, in order.
+//
+// The test defines glfmMain() and runs in the main() of the library. ctest runs it under xvfb-run
+// if it is installed. Otherwise, run it in an X session, or under Xvfb, for example:
+// xvfb-run -a ctest -R x11_window_test
+//
+// Skipped (exit status 77) if no X display is available.
+
+#include "glfm.h"
+#include "glfm_test.h"
+#include <X11/Xlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+
+// The library names the window after the executable
+#define WINDOW_NAME "x11_window_test"
+#define RESIZED_WIDTH 200
+#define RESIZED_HEIGHT 150
+#define TIMEOUT 10.0
+#define SKIPPED 77
+
+typedef enum {
+    StepCreated,
+    StepResizing,
+    StepClosing,
+} Step;
+
+// The callbacks, in order
+typedef enum {
+    CallbackSurfaceCreated,
+    CallbackSurfaceResized,
+    CallbackFocusLost,
+    CallbackFocusGained,
+    CallbackSurfaceDestroyed,
+} Callback;
+
+#define MAX_CALLBACKS 64
+
+static struct {
+    Display *xDisplay; // The second client
+    Window xWindow;
+    Step step;
+    double stepStartTime;
+    int frameCount;
+    int createdWidth;
+    int createdHeight;
+    int resizedWidth;
+    int resizedHeight;
+    bool renderedAfterResize;
+    Callback callbacks[MAX_CALLBACKS];
+    int callbackCount;
+} test;
+
+static void addCallback(Callback callback) {
+    if (test.callbackCount < MAX_CALLBACKS) {
+        test.callbacks[test.callbackCount++] = callback;
+    }
+}
+
+/// Finds the window of the library's X client by its name. Returns None if not found.
+static Window findWindow(void) {
+    Window root = DefaultRootWindow(test.xDisplay);
+    Window rootReturn = None;
+    Window parent = None;
+    Window *children = NULL;
+    unsigned int childCount = 0;
+    Window window = None;
+    if (XQueryTree(test.xDisplay, root, &rootReturn, &parent, &children, &childCount)) {
+        for (unsigned int i = 0; i < childCount && window == None; i++) {
+            char *name = NULL;
+            if (XFetchName(test.xDisplay, children[i], &name) && name) {
+                if (strcmp(name, WINDOW_NAME) == 0) {
+                    window = children[i];
+                }
+                XFree(name);
+            }
+        }
+        if (children) {
+            XFree(children);
+        }
+    }
+    return window;
+}
+
+/// Closes the window like a window manager, with a WM_DELETE_WINDOW message. With an empty event
+/// mask, the event is sent to the client that created the window.
+static void sendClose(void) {
+    XEvent event;
+    memset(&event, 0, sizeof(event));
+    event.xclient.type = ClientMessage;
+    event.xclient.window = test.xWindow;
+    event.xclient.message_type = XInternAtom(test.xDisplay, "WM_PROTOCOLS", False);
+    event.xclient.format = 32;
+    event.xclient.data.l[0] = (long)XInternAtom(test.xDisplay, "WM_DELETE_WINDOW", False);
+    event.xclient.data.l[1] = CurrentTime;
+    XSendEvent(test.xDisplay, test.xWindow, False, NoEventMask, &event);
+    XFlush(test.xDisplay);
+}
+
+static void setStep(Step step) {
+    test.step = step;
+    test.stepStartTime = glfmTestGetRealTime();
+}
+
+static void onSurfaceCreated(GLFMDisplay *display, int width, int height) {
+    (void)display;
+    addCallback(CallbackSurfaceCreated);
+    test.createdWidth = width;
+    test.createdHeight = height;
+}
+
+static void onSurfaceResized(GLFMDisplay *display, int width, int height) {
+    addCallback(CallbackSurfaceResized);
+    test.resizedWidth = width;
+    test.resizedHeight = height;
+
+    int displayWidth = 0;
+    int displayHeight = 0;
+    glfmGetDisplaySize(display, &displayWidth, &displayHeight);
+    GLFM_TEST_CHECK(displayWidth == width);
+    GLFM_TEST_CHECK(displayHeight == height);
+}
+
+static void onFocus(GLFMDisplay *display, bool focused) {
+    (void)display;
+    addCallback(focused ? CallbackFocusGained : CallbackFocusLost);
+}
+
+static void onSurfaceDestroyed(GLFMDisplay *display) {
+    (void)display;
+    addCallback(CallbackSurfaceDestroyed);
+}
+
+static void onDraw(GLFMDisplay *display) {
+    test.frameCount++;
+    int width = 0;
+    int height = 0;
+    glfmGetDisplaySize(display, &width, &height);
+    glViewport(0, 0, width, height);
+    glClearColor(0.25f, 0.5f, 0.75f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+    GLFM_TEST_CHECK(glGetError() == GL_NO_ERROR);
+    glfmSwapBuffers(display);
+
+    const bool timedOut = glfmTestGetRealTime() - test.stepStartTime > TIMEOUT;
+    switch (test.step) {
+        case StepCreated:
+            test.xWindow = findWindow();
+            if (test.xWindow != None) {
+                XResizeWindow(test.xDisplay, test.xWindow, RESIZED_WIDTH, RESIZED_HEIGHT);
+                XFlush(test.xDisplay);
+                setStep(StepResizing);
+            } else if (timedOut) {
+                fprintf(stderr, "Window \"%s\" not found\n", WINDOW_NAME);
+                GLFM_TEST_CHECK(test.xWindow != None);
+                _exit(glfmTestResult());
+            }
+            break;
+
+        case StepResizing:
+            if (test.resizedWidth == RESIZED_WIDTH && test.resizedHeight == RESIZED_HEIGHT) {
+                test.renderedAfterResize = true;
+                sendClose();
+                setStep(StepClosing);
+            } else if (timedOut) {
+                fprintf(stderr, "No resize to %ix%i\n", RESIZED_WIDTH, RESIZED_HEIGHT);
+                sendClose();
+                setStep(StepClosing);
+            }
+            break;
+
+        case StepClosing:
+            // Frames can be rendered until the message arrives
+            if (timedOut) {
+                fprintf(stderr, "The window wasn't closed\n");
+                GLFM_TEST_CHECK(!timedOut);
+                _exit(glfmTestResult());
+            }
+            break;
+    }
+}
+
+/// Checks the callbacks after the library's main() returns.
+static void checkResults(void) {
+    GLFM_TEST_CHECK(test.frameCount > 0);
+    GLFM_TEST_CHECK(test.createdWidth > 0 && test.createdHeight > 0);
+    GLFM_TEST_CHECK(test.renderedAfterResize);
+    GLFM_TEST_CHECK(test.resizedWidth == RESIZED_WIDTH);
+    GLFM_TEST_CHECK(test.resizedHeight == RESIZED_HEIGHT);
+    GLFM_TEST_CHECK(test.step == StepClosing);
+
+    // Created first, then resized. Closing the window loses focus, and then destroys the surface.
+    // Focus can change in between, depending on the X server's focus policy.
+    GLFM_TEST_CHECK(test.callbackCount >= 4);
+    if (test.callbackCount >= 4) {
+        GLFM_TEST_CHECK(test.callbacks[0] == CallbackSurfaceCreated);
+        int resizedCount = 0;
+        int destroyedCount = 0;
+        for (int i = 0; i < test.callbackCount; i++) {
+            resizedCount += (test.callbacks[i] == CallbackSurfaceResized);
+            destroyedCount += (test.callbacks[i] == CallbackSurfaceDestroyed);
+        }
+        GLFM_TEST_CHECK(resizedCount == 1);
+        GLFM_TEST_CHECK(destroyedCount == 1);
+        GLFM_TEST_CHECK(test.callbacks[test.callbackCount - 2] == CallbackFocusLost);
+        GLFM_TEST_CHECK(test.callbacks[test.callbackCount - 1] == CallbackSurfaceDestroyed);
+    }
+
+    XCloseDisplay(test.xDisplay);
+    if (glfmTestFailureCount == 0) {
+        printf("Window created at %ix%i, resized to %ix%i, and closed after %i frames\n",
+               test.createdWidth, test.createdHeight, test.resizedWidth, test.resizedHeight,
+               test.frameCount);
+    }
+    // The library's main() returns EXIT_SUCCESS, so the result is the exit status of the process
+    fflush(stdout);
+    _exit(glfmTestResult());
+}
+
+/// Skips the test before the library's main() runs, which would fail without an X display.
+__attribute__((constructor)) static void skipWithoutDisplay(void) {
+    const char *name = getenv("DISPLAY");
+    if (name && name[0]) {
+        test.xDisplay = XOpenDisplay(NULL);
+    }
+    if (!test.xDisplay) {
+        printf("Skipped: no X display\n");
+        exit(SKIPPED);
+    }
+}
+
+void glfmMain(GLFMDisplay *display) {
+    atexit(checkResults);
+    setStep(StepCreated);
+    glfmSetDisplayConfig(display, GLFMRenderingAPIOpenGLES2, GLFMColorFormatRGBA8888,
+                         GLFMDepthFormatNone, GLFMStencilFormatNone, GLFMMultisampleNone);
+    glfmSetSurfaceCreatedFunc(display, onSurfaceCreated);
+    glfmSetSurfaceResizedFunc(display, onSurfaceResized);
+    glfmSetSurfaceDestroyedFunc(display, onSurfaceDestroyed);
+    glfmSetAppFocusFunc(display, onFocus);
+    glfmSetRenderFunc(display, onDraw);
+}